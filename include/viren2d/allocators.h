@@ -0,0 +1,162 @@
+#ifndef __VIREN2D_ALLOCATORS_H__
+#define __VIREN2D_ALLOCATORS_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <viren2d/imagebuffer.h>
+
+
+namespace viren2d {
+
+//---------------------------------------------------- Allocator interface
+
+/// Interface of a memory allocator which provides the storage of
+/// (owning) ImageBuffers.
+///
+/// Implementations must be thread-safe, as buffers may be created and
+/// destroyed from different threads. Each memory block must be aligned
+/// to `kImageBufferAlignment`.
+///
+/// Every ImageBuffer keeps a reference to the allocator which provided
+/// its memory, *i.e.* an allocator will outlive all of its blocks.
+class ImageBufferAllocator {
+public:
+  virtual ~ImageBufferAllocator() = default;
+
+
+  /// Returns a memory block which can hold at least `num_bytes`, or
+  /// `nullptr` if the request could not be satisfied.
+  virtual unsigned char *Allocate(std::size_t num_bytes) = 0;
+
+
+  /// Releases a memory block which has previously been obtained via
+  /// `Allocate(num_bytes)` from this allocator. Must not throw.
+  virtual void Deallocate(unsigned char *ptr, std::size_t num_bytes) = 0;
+};
+
+
+/// Returns the default allocator, which requests each
+/// (aligned) memory block from the heap.
+std::shared_ptr<ImageBufferAllocator> DefaultImageBufferAllocator();
+
+
+/// Installs the given allocator globally, *i.e.* all subsequently
+/// allocated ImageBuffers will use it (unless a thread-local
+/// allocator is active, see `ScopedImageBufferAllocator`).
+/// Pass `nullptr` to restore the default allocator.
+///
+/// Each thread caches a reference to the global allocator. Thus, the
+/// previous allocator is released once every thread which used it has
+/// allocated its next buffer (or exited).
+void SetImageBufferAllocator(std::shared_ptr<ImageBufferAllocator> allocator);
+
+
+/// Returns the allocator which is currently used by the calling
+/// thread, *i.e.* a thread-local allocator (if set), or the global one.
+std::shared_ptr<ImageBufferAllocator> GetImageBufferAllocator();
+
+
+/// Temporarily overrides the allocator for the calling thread, *e.g.* to
+/// use a pool for a specific call site:
+///
+///   >>> auto pool = std::make_shared<viren2d::PoolAllocator>();
+///   >>> {
+///   >>>   viren2d::ScopedImageBufferAllocator scope(pool);
+///   >>>   painter->DrawImage(image, ...);
+///   >>> }
+///
+/// The previous thread-local allocator will be restored upon
+/// destruction. Scopes can be nested. The allocator is also used by
+/// the worker threads while they process an image on behalf of the
+/// calling thread.
+class ScopedImageBufferAllocator {
+public:
+  explicit ScopedImageBufferAllocator(
+      std::shared_ptr<ImageBufferAllocator> allocator);
+  ~ScopedImageBufferAllocator();
+
+  ScopedImageBufferAllocator(const ScopedImageBufferAllocator &) = delete;
+  ScopedImageBufferAllocator &operator=(
+      const ScopedImageBufferAllocator &) = delete;
+
+private:
+  std::shared_ptr<ImageBufferAllocator> previous_;
+};
+
+
+//---------------------------------------------------- Pool allocator
+
+/// Usage statistics of a `PoolAllocator`.
+struct PoolAllocatorStatistics {
+  /// Number of requests which reused a cached block.
+  std::size_t hits = 0;
+
+  /// Number of requests which had to allocate a new block.
+  std::size_t misses = 0;
+
+  /// Number of blocks which are currently cached for reuse.
+  std::size_t cached_blocks = 0;
+
+  /// Number of bytes which are currently cached for reuse.
+  std::size_t cached_bytes = 0;
+};
+
+
+/// Thread-safe, size-bucketed memory pool for ImageBuffers.
+///
+/// Released memory blocks are not returned to the heap, but cached for
+/// subsequent requests of the same size class. This is useful to avoid
+/// heap allocations for per-frame temporaries (*e.g.* the color
+/// conversions within `Painter::DrawImage` or colorization results)
+/// in video processing pipelines.
+///
+/// Requests are grouped into size classes, such that a block
+/// is reused for any request of at most 25% smaller size.
+class PoolAllocator : public ImageBufferAllocator {
+public:
+  /// Creates a pool which caches at most `max_cached_bytes`. If
+  /// this limit would be exceeded, released blocks will be freed.
+  explicit PoolAllocator(std::size_t max_cached_bytes = 512UL << 20);
+  ~PoolAllocator() override;
+
+  PoolAllocator(const PoolAllocator &) = delete;
+  PoolAllocator &operator=(const PoolAllocator &) = delete;
+
+
+  unsigned char *Allocate(std::size_t num_bytes) override;
+
+
+  void Deallocate(unsigned char *ptr, std::size_t num_bytes) override;
+
+
+  /// Frees all currently cached blocks.
+  void Clear();
+
+
+  /// Resets the hit/miss counters.
+  void ResetStatistics();
+
+
+  /// Returns the current usage statistics.
+  PoolAllocatorStatistics Statistics() const;
+
+
+  /// Returns the size (in bytes) of the size class which
+  /// will be used to serve a request of `num_bytes`.
+  static std::size_t BucketSize(std::size_t num_bytes);
+
+private:
+  mutable std::mutex mutex_;
+  std::unordered_map<std::size_t, std::vector<unsigned char*>> buckets_;
+  std::size_t max_cached_bytes_;
+  PoolAllocatorStatistics stats_;
+};
+
+}  // namespace viren2d
+
+#endif  // __VIREN2D_ALLOCATORS_H__
@@ -81,7 +81,8 @@ public:
   /// If `copy` is true, the canvas memory is copied into the ImageBuffer (i.e.
   /// you can modify the buffer however you like). Otherwise, the ImageBuffer
   /// shares the Painter's memory (and thus your subsequent memory modifications
-  /// will directly affect the canvas).
+  /// will directly affect the canvas). The shared memory remains valid even
+  /// if the Painter is destroyed or its canvas is replaced.
   virtual ImageBuffer GetCanvas(bool copy) const = 0;
 
 
@@ -268,6 +269,28 @@ public:
   }
 
 
+  /// Fills the set pixels of a bit-packed mask with the given color.
+  ///
+  /// The mask is drawn at its native resolution, i.e. each set bit
+  /// covers one pixel of the canvas. This is useful to overlay the
+  /// result of `MaskRangePacked` or `MaskHSVRangePacked` without
+  /// converting it to an ImageBuffer first.
+  ///
+  /// Args:
+  ///   mask: The packed mask.
+  ///   color: Fill color of the set pixels. Its alpha value
+  ///     defines the opacity of the overlay.
+  ///   position: Reference point where to anchor the mask.
+  ///   anchor: How to orient the mask with respect to ``position``.
+  bool DrawMask(
+      const PackedMask &mask,
+      const Color &color,
+      const Vec2d &position = {0.0, 0.0},
+      Anchor anchor = Anchor::TopLeft) {
+    return DrawMaskImpl(mask, color, position, anchor);
+  }
+
+
   /// Draws multiple (similarly styled) markers/keypoints.
   ///
   /// Args:
@@ -575,6 +598,12 @@ protected:
       const Vec2d &pos, const MarkerStyle &style) = 0;
 
 
+  /// Internal helper to enable default values in public interface.
+  virtual bool DrawMaskImpl(
+      const PackedMask &mask, const Color &color,
+      const Vec2d &position, Anchor anchor) = 0;
+
+
   /// Internal helper to enable default values in public interface.
   virtual bool DrawMarkersImpl(
       const std::vector<std::pair<Vec2d, Color>> &markers,
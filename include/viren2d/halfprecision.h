@@ -0,0 +1,313 @@
+#ifndef __VIREN2D_HALFPRECISION_H__
+#define __VIREN2D_HALFPRECISION_H__
+
+#include <cstdint>
+#include <cstring>  // memcpy
+#include <limits>
+
+
+namespace viren2d {
+
+/// Returns the IEEE 754 binary32 representation of the given float.
+inline uint32_t FloatToBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+
+/// Returns the float which corresponds to the given binary32 representation.
+inline float BitsToFloat(uint32_t bits) {
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+
+/// Converts a float to IEEE 754 half precision (binary16), using
+/// round-to-nearest-even. Values beyond the half precision range become
+/// infinite, NaNs are quieted and keep the upper bits of their payload.
+/// Results are identical to the F16C (`_mm_cvtps_ph`) and NEON
+/// (`vcvt_f16_f32`) conversions.
+inline uint16_t FloatToHalfBits(float value) {
+  uint32_t bits = FloatToBits(value);
+  const uint32_t sign = (bits >> 16) & 0x8000u;
+  bits &= 0x7FFFFFFFu;
+
+  // Infinity & NaN
+  if (bits >= 0x7F800000u) {
+    return static_cast<uint16_t>(
+          sign | ((bits > 0x7F800000u)
+                  ? (0x7E00u | ((bits >> 13) & 0x3FFu)) : 0x7C00u));
+  }
+
+  // Overflow, *i.e.* >= 2^16 (smaller values which round beyond the
+  // largest half, 65504, carry into the exponent below)
+  if (bits >= 0x47800000u) {
+    return static_cast<uint16_t>(sign | 0x7C00u);
+  }
+
+  // Subnormal halves (and zero): Let the FPU round by adding a float
+  // whose ulp equals the smallest subnormal half, 2^-24.
+  if (bits < 0x38800000u) {
+    constexpr uint32_t kMagic = 126u << 23;
+    const float rounded = BitsToFloat(bits) + BitsToFloat(kMagic);
+    return static_cast<uint16_t>(sign | (FloatToBits(rounded) - kMagic));
+  }
+
+  // Normal halves: Rebias the exponent and round the 13 dropped
+  // mantissa bits to nearest even.
+  const uint32_t mantissa_odd = (bits >> 13) & 1u;
+  bits += 0xC8000FFFu + mantissa_odd;  // (15 - 127) << 23, plus 0xFFF
+  return static_cast<uint16_t>(sign | (bits >> 13));
+}
+
+
+/// Converts IEEE 754 half precision (binary16) to float. This conversion
+/// is exact, only signaling NaNs are quieted.
+inline float HalfBitsToFloat(uint16_t half) {
+  const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+  const uint32_t exponent = (half >> 10) & 0x1Fu;
+  uint32_t mantissa = half & 0x3FFu;
+
+  if (exponent == 0x1Fu) {
+    return BitsToFloat(
+          sign | 0x7F800000u | (mantissa << 13)
+          | ((mantissa != 0) ? 0x400000u : 0u));
+  }
+
+  if (exponent == 0) {
+    if (mantissa == 0) {
+      return BitsToFloat(sign);
+    }
+    // Normalize the subnormal half
+    uint32_t shift = 0;
+    while ((mantissa & 0x400u) == 0) {
+      mantissa <<= 1;
+      ++shift;
+    }
+    return BitsToFloat(
+          sign | ((113u - shift) << 23) | ((mantissa & 0x3FFu) << 13));
+  }
+
+  return BitsToFloat(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+}
+
+
+/// Converts a float to bfloat16, *i.e.* the upper 16 bits of its binary32
+/// representation, using round-to-nearest-even. NaNs are quieted.
+inline uint16_t FloatToBFloat16Bits(float value) {
+  const uint32_t bits = FloatToBits(value);
+  if ((bits & 0x7FFFFFFFu) > 0x7F800000u) {
+    return static_cast<uint16_t>((bits >> 16) | 0x40u);
+  }
+  return static_cast<uint16_t>(
+        (bits + 0x7FFFu + ((bits >> 16) & 1u)) >> 16);
+}
+
+
+/// Converts bfloat16 to float, which is exact.
+inline float BFloat16BitsToFloat(uint16_t bfloat) {
+  return BitsToFloat(static_cast<uint32_t>(bfloat) << 16);
+}
+
+
+/// IEEE 754 half precision floating point number, *e.g.* to store the
+/// depth or optical flow predictions of neural networks in an
+/// `ImageBuffer` of type `ImageBufferType::Float16`.
+///
+/// This is a storage type: Arithmetic is performed in single precision
+/// (via the implicit conversion to `float`). To convert whole buffers,
+/// use `ImageBuffer::ToFloat` or `ImageBuffer::AsType`, which are
+/// vectorized if supported by the CPU.
+struct float16_t {
+  /// Binary16 representation.
+  uint16_t bits;
+
+  float16_t() = default;
+
+  /// Rounds the given value to the nearest half precision number.
+  explicit float16_t(float value)
+    : bits(FloatToHalfBits(value)) {}
+
+  inline operator float() const {
+    return HalfBitsToFloat(bits);
+  }
+
+  /// Returns the number with the given binary16 representation.
+  static constexpr float16_t FromBits(uint16_t bits) {
+    return float16_t(bits, 0);
+  }
+
+private:
+  constexpr float16_t(uint16_t b, int) : bits(b) {}
+};
+
+
+/// Brain floating point number, *i.e.* a float with a mantissa truncated
+/// to 7 bits, see `float16_t` for usage.
+struct bfloat16_t {
+  /// Upper 16 bits of the binary32 representation.
+  uint16_t bits;
+
+  bfloat16_t() = default;
+
+  /// Rounds the given value to the nearest bfloat16 number.
+  explicit bfloat16_t(float value)
+    : bits(FloatToBFloat16Bits(value)) {}
+
+  inline operator float() const {
+    return BFloat16BitsToFloat(bits);
+  }
+
+  /// Returns the number with the given bfloat16 representation.
+  static constexpr bfloat16_t FromBits(uint16_t bits) {
+    return bfloat16_t(bits, 0);
+  }
+
+private:
+  constexpr bfloat16_t(uint16_t b, int) : bits(b) {}
+};
+
+static_assert(sizeof(float16_t) == 2, "float16_t must not be padded");
+static_assert(sizeof(bfloat16_t) == 2, "bfloat16_t must not be padded");
+
+}  // namespace viren2d
+
+
+namespace std {
+/// Limits of the half precision types, so that they can be used
+/// with the templated ImageBuffer algorithms, *e.g.* `MinMaxLocation`.
+template <>
+class numeric_limits<viren2d::float16_t> {
+public:
+  static constexpr bool is_specialized = true;
+  static constexpr bool is_signed = true;
+  static constexpr bool is_integer = false;
+  static constexpr bool is_exact = false;
+  static constexpr bool has_infinity = true;
+  static constexpr bool has_quiet_NaN = true;
+  static constexpr bool has_signaling_NaN = true;
+  static constexpr float_denorm_style has_denorm = denorm_present;
+  static constexpr bool has_denorm_loss = false;
+  static constexpr float_round_style round_style = round_to_nearest;
+  static constexpr bool is_iec559 = true;
+  static constexpr bool is_bounded = true;
+  static constexpr bool is_modulo = false;
+  static constexpr int digits = 11;
+  static constexpr int digits10 = 3;
+  static constexpr int max_digits10 = 5;
+  static constexpr int radix = 2;
+  static constexpr int min_exponent = -13;
+  static constexpr int min_exponent10 = -4;
+  static constexpr int max_exponent = 16;
+  static constexpr int max_exponent10 = 4;
+  static constexpr bool traps = false;
+  static constexpr bool tinyness_before = false;
+
+  static constexpr viren2d::float16_t min() noexcept {
+    return viren2d::float16_t::FromBits(0x0400);
+  }
+
+  static constexpr viren2d::float16_t lowest() noexcept {
+    return viren2d::float16_t::FromBits(0xFBFF);
+  }
+
+  static constexpr viren2d::float16_t max() noexcept {
+    return viren2d::float16_t::FromBits(0x7BFF);
+  }
+
+  static constexpr viren2d::float16_t epsilon() noexcept {
+    return viren2d::float16_t::FromBits(0x1400);
+  }
+
+  static constexpr viren2d::float16_t round_error() noexcept {
+    return viren2d::float16_t::FromBits(0x3800);
+  }
+
+  static constexpr viren2d::float16_t infinity() noexcept {
+    return viren2d::float16_t::FromBits(0x7C00);
+  }
+
+  static constexpr viren2d::float16_t quiet_NaN() noexcept {
+    return viren2d::float16_t::FromBits(0x7E00);
+  }
+
+  static constexpr viren2d::float16_t signaling_NaN() noexcept {
+    return viren2d::float16_t::FromBits(0x7D00);
+  }
+
+  static constexpr viren2d::float16_t denorm_min() noexcept {
+    return viren2d::float16_t::FromBits(0x0001);
+  }
+};
+
+
+template <>
+class numeric_limits<viren2d::bfloat16_t> {
+public:
+  // Not a binary interchange format of IEEE 754, but it follows its
+  // semantics (subnormals, infinity, NaNs, rounding) like binary32.
+  static constexpr bool is_specialized = true;
+  static constexpr bool is_signed = true;
+  static constexpr bool is_integer = false;
+  static constexpr bool is_exact = false;
+  static constexpr bool has_infinity = true;
+  static constexpr bool has_quiet_NaN = true;
+  static constexpr bool has_signaling_NaN = true;
+  static constexpr float_denorm_style has_denorm = denorm_present;
+  static constexpr bool has_denorm_loss = false;
+  static constexpr float_round_style round_style = round_to_nearest;
+  static constexpr bool is_iec559 = true;
+  static constexpr bool is_bounded = true;
+  static constexpr bool is_modulo = false;
+  static constexpr int digits = 8;
+  static constexpr int digits10 = 2;
+  static constexpr int max_digits10 = 4;
+  static constexpr int radix = 2;
+  static constexpr int min_exponent = -125;
+  static constexpr int min_exponent10 = -37;
+  static constexpr int max_exponent = 128;
+  static constexpr int max_exponent10 = 38;
+  static constexpr bool traps = false;
+  static constexpr bool tinyness_before = false;
+
+  static constexpr viren2d::bfloat16_t min() noexcept {
+    return viren2d::bfloat16_t::FromBits(0x0080);
+  }
+
+  static constexpr viren2d::bfloat16_t lowest() noexcept {
+    return viren2d::bfloat16_t::FromBits(0xFF7F);
+  }
+
+  static constexpr viren2d::bfloat16_t max() noexcept {
+    return viren2d::bfloat16_t::FromBits(0x7F7F);
+  }
+
+  static constexpr viren2d::bfloat16_t epsilon() noexcept {
+    return viren2d::bfloat16_t::FromBits(0x3C00);
+  }
+
+  static constexpr viren2d::bfloat16_t round_error() noexcept {
+    return viren2d::bfloat16_t::FromBits(0x3F00);
+  }
+
+  static constexpr viren2d::bfloat16_t infinity() noexcept {
+    return viren2d::bfloat16_t::FromBits(0x7F80);
+  }
+
+  static constexpr viren2d::bfloat16_t quiet_NaN() noexcept {
+    return viren2d::bfloat16_t::FromBits(0x7FC0);
+  }
+
+  static constexpr viren2d::bfloat16_t signaling_NaN() noexcept {
+    return viren2d::bfloat16_t::FromBits(0x7FA0);
+  }
+
+  static constexpr viren2d::bfloat16_t denorm_min() noexcept {
+    return viren2d::bfloat16_t::FromBits(0x0001);
+  }
+};
+}  // namespace std
+
+#endif  // __VIREN2D_HALFPRECISION_H__
@@ -11,8 +11,13 @@
 #include <limits> // quiet nan
 #include <initializer_list>
 #include <utility> // pair
+#include <memory> // shared_ptr
+#include <functional>
+#include <vector>
+#include <cmath>
 
 #include <viren2d/primitives.h>
+#include <viren2d/halfprecision.h>
 
 
 namespace viren2d {
@@ -27,13 +32,15 @@ enum class ImageBufferType : int {
   Int64,
   UInt64,
   Float,
-  Double
+  Double,
+  Float16,   ///< IEEE 754 half precision, see `float16_t`.
+  BFloat16   ///< Brain floating point, see `bfloat16_t`.
 };
 
 
 /// Templated type alias which provides the
-/// underlying type (either fixed width integer
-/// or single/double precision float) for an ImageBuffer.
+/// underlying type (either fixed width integer,
+/// half/single/double precision float) for an ImageBuffer.
 template<ImageBufferType T>
 using image_buffer_t = typename std::conditional<
   T == ImageBufferType::UInt8,
@@ -59,7 +66,15 @@ using image_buffer_t = typename std::conditional<
               typename std::conditional<
                 T == ImageBufferType::Float,
                 float,
-                double
+                typename std::conditional<
+                  T == ImageBufferType::Float16,
+                  float16_t,
+                  typename std::conditional<
+                    T == ImageBufferType::BFloat16,
+                    bfloat16_t,
+                    double
+                  >::type
+                >::type
               >::type
             >::type
           >::type
@@ -86,18 +101,288 @@ ImageBufferType ImageBufferTypeFromString(const std::string &s);
 int ElementSizeFromImageBufferType(ImageBufferType t);
 
 
+/// Alignment (in bytes) of the base pointer of each memory block
+/// allocated by an ImageBuffer, *i.e.* the size of a cache line.
+constexpr int kImageBufferAlignment = 64;
+
+
+/// Sets the default row alignment (in bytes) of newly allocated
+/// ImageBuffers. The row stride of such buffers will be padded to a
+/// multiple of this value, which must be a power of two. Use `1` to
+/// allocate tightly packed (contiguous) buffers by default.
+/// The initial default is `kImageBufferAlignment`, which satisfies
+/// Cairo's stride requirements and allows aligned vector loads.
+void SetImageBufferRowAlignment(int alignment);
+
+
+/// Returns the default row alignment (in bytes) of newly allocated
+/// ImageBuffers, see `SetImageBufferRowAlignment`.
+int GetImageBufferRowAlignment();
+
+
 /// Output stream operator to print an ImageBufferType.
 std::ostream &operator<<(std::ostream &os, ImageBufferType t);
 
 
+/// Interpolation modes for resampling an ImageBuffer, see `ImageBuffer::Resize`.
+enum class Interpolation : unsigned char {
+  Nearest = 0,  ///< Nearest neighbor, *i.e.* copies the closest source pixel.
+  Bilinear,     ///< Bilinear interpolation of the 2x2 closest source pixels.
+  Area          ///< Box filter, best for downscaling (bilinear for upscaling).
+};
+
+
+/// Returns the string representation.
+std::string InterpolationToString(Interpolation interpolation);
+
+
+/// Returns the Interpolation corresponding to the given string representation.
+Interpolation InterpolationFromString(const std::string &interpolation);
+
+
+/// Output stream operator to print an Interpolation.
+std::ostream &operator<<(std::ostream &os, Interpolation interpolation);
+
+
+/// Blur filters for anonymization, see `ImageBuffer::Blur`.
+enum class BlurKind : unsigned char {
+  Box = 0,  ///< Running-sum box filter.
+  Gaussian  ///< Approximated by three iterated box filters.
+};
+
+
+/// Returns the string representation.
+std::string BlurKindToString(BlurKind kind);
+
+
+/// Returns the BlurKind corresponding to the given string representation.
+BlurKind BlurKindFromString(const std::string &kind);
+
+
+/// Output stream operator to print a BlurKind.
+std::ostream &operator<<(std::ostream &os, BlurKind kind);
+
+
+/// Memory layout of multi-channel images, see `ImageBuffer::Layout`.
+enum class ImageLayout : unsigned char {
+  Interleaved = 0,  ///< Channels of a pixel are stored next to each other (HWC).
+  Planar            ///< Each channel is stored as separate plane (CHW).
+};
+
+
+/// Returns the string representation.
+std::string ImageLayoutToString(ImageLayout layout);
+
+
+/// Returns the ImageLayout corresponding to the given string representation,
+/// *i.e.* "interleaved"/"hwc"/"nhwc" or "planar"/"chw"/"nchw".
+ImageLayout ImageLayoutFromString(const std::string &layout);
+
+
+/// Output stream operator to print an ImageLayout.
+std::ostream &operator<<(std::ostream &os, ImageLayout layout);
+
+
+//---------------------------------------------------- Statistics
+
+/// Statistics of a single channel, see `ImageBuffer::Statistics`.
+struct ChannelStatistics {
+  /// Minimum value, NaN if the channel contains no valid values.
+  double min = std::numeric_limits<double>::quiet_NaN();
+
+  /// Maximum value, NaN if the channel contains no valid values.
+  double max = std::numeric_limits<double>::quiet_NaN();
+
+  /// Location (x=column, y=row) of the first occurrence of the minimum,
+  /// or (-1, -1) if the channel contains no valid values.
+  Vec2i min_location{-1, -1};
+
+  /// Location of the first occurrence of the maximum.
+  Vec2i max_location{-1, -1};
+
+  /// Mean of the valid values.
+  double mean = std::numeric_limits<double>::quiet_NaN();
+
+  /// Population variance of the valid values.
+  double variance = std::numeric_limits<double>::quiet_NaN();
+
+  /// Number of valid (i.e. not NaN) values.
+  int64_t num_valid = 0;
+
+  /// Number of NaN values (always 0 for integral buffer types).
+  int64_t num_nan = 0;
+
+  /// Number of values per histogram bin, empty if no histogram
+  /// has been requested.
+  std::vector<int64_t> histogram;
+
+
+  /// Returns the standard deviation.
+  inline double StdDev() const {
+    return std::sqrt(variance);
+  }
+
+
+  /// Returns a human readable representation.
+  std::string ToString() const;
+};
+
+
+//---------------------------------------------------- Packed mask
+class ImageBuffer;
+
+
+/// Binary mask which stores a single bit per pixel, *i.e.* it needs
+/// 8x less memory than a uint8 mask with values 0/255.
+///
+/// The bits are packed into 64-bit words, where the first pixel of a word
+/// is its least significant bit. Each row starts at a new word, *i.e.* rows
+/// are padded to a multiple of 64 pixels and padding bits are always 0.
+/// On little endian systems, this layout can be used as a cairo `A1`
+/// surface without copying, see `Painter::DrawMask`.
+class PackedMask {
+public:
+  /// Creates an empty (invalid) mask.
+  PackedMask() = default;
+
+
+  /// Allocates a H x W mask where all bits are set to `value`.
+  PackedMask(int height, int width, bool value = false);
+
+
+  /// Packs a single-channel buffer (of any type), where a bit is set
+  /// iff the corresponding value is not 0.
+  explicit PackedMask(const ImageBuffer &mask);
+
+
+  /// Returns true if the mask has at least 1 pixel.
+  inline bool IsValid() const {
+    return (width_ > 0) && (height_ > 0);
+  }
+
+
+  /// Returns the number of columns.
+  inline int Width() const { return width_; }
+
+
+  /// Returns the number of rows.
+  inline int Height() const { return height_; }
+
+
+  /// Returns the number of 64-bit words per row.
+  inline int64_t WordsPerRow() const { return words_per_row_; }
+
+
+  /// Returns the number of bytes between two rows.
+  inline int64_t RowStride() const {
+    return words_per_row_ * static_cast<int64_t>(sizeof(uint64_t));
+  }
+
+
+  /// Returns the number of bytes used to store the bits.
+  inline int64_t NumBytes() const { return RowStride() * height_; }
+
+
+  /// Returns the words of the given row.
+  inline const uint64_t *RowPtr(int row) const {
+    return words_.data() + row * words_per_row_;
+  }
+
+
+  /// Returns the words of the given row for modification. Padding
+  /// bits (*i.e.* beyond the last column) must remain 0.
+  inline uint64_t *MutableRowPtr(int row) {
+    return words_.data() + row * words_per_row_;
+  }
+
+
+  /// Returns true if the bit at the given position is set. Does not
+  /// perform range checks.
+  inline bool IsSet(int row, int col) const {
+    return (RowPtr(row)[col >> 6] >> (col & 63)) & 1;
+  }
+
+
+  /// Sets or clears the bit at the given position. Does not perform
+  /// range checks.
+  inline void Set(int row, int col, bool value = true) {
+    const uint64_t bit = uint64_t(1) << (col & 63);
+    uint64_t &word = MutableRowPtr(row)[col >> 6];
+    word = value ? (word | bit) : (word & ~bit);
+  }
+
+
+  /// Returns the number of set bits.
+  int64_t CountNonZero() const;
+
+
+  /// Returns the inverted mask.
+  PackedMask Inverted() const;
+
+
+  /// Returns the unpacked single-channel uint8 mask, where set
+  /// bits become 255 and all others 0.
+  ImageBuffer ToImageBuffer() const;
+
+
+  /// Returns a human readable representation.
+  std::string ToString() const;
+
+
+private:
+  /// Number of rows & columns.
+  int height_ = 0;
+  int width_ = 0;
+
+  /// Number of 64-bit words per row.
+  int64_t words_per_row_ = 0;
+
+  /// Row-major bits.
+  std::vector<uint64_t> words_;
+};
+
+
+/// Returns true if both masks have the same size and bits.
+bool operator==(const PackedMask &lhs, const PackedMask &rhs);
+bool operator!=(const PackedMask &lhs, const PackedMask &rhs);
+
+
 //---------------------------------------------------- Image buffer
+class PixelExpression;
+
+namespace helpers {
+class PixelWriter;
+}  // namespace helpers
+
+
+/// Releases memory which has been handed over to an ImageBuffer via
+/// `ImageBuffer::TakeOwnership`. It will be invoked exactly once, with
+/// the buffer's data pointer at the time of the hand-over, after the
+/// last buffer or view referencing the memory has been destroyed.
+using ImageBufferDeleter = std::function<void(unsigned char *)>;
+
 
 /// Holds image data. For supported data types, see `ImageBufferType`.
 ///
 /// Usage: Either copy existing image data via `CreateCopiedBuffer`, or
 ///   share the same memory via `CreateSharedBuffer`. The latter
 ///   does NOT take ownership of the memory (i.e. cleaning up
-///   remains the caller's responsibility).
+///   remains the caller's responsibility), unless the memory is handed
+///   over via `TakeOwnership` or kept alive by an `owner` handle.
+///
+/// Memory allocated by an ImageBuffer is reference-counted and follows
+/// copy-on-write semantics: Copying an owning buffer is O(1), as the
+/// copies share the pixel storage until one of them requests mutable
+/// access (via `MutableData`, `MutablePtr`, `AtUnchecked`, `ROI`, etc.).
+/// At that point, the accessing buffer detaches and creates its own copy.
+/// Because the pointers returned by `MutableData` and `MutablePtr` (or
+/// a ROI) may be used to modify the pixels at any later time, the storage
+/// of this buffer will no longer be shared afterwards, *i.e.* subsequent
+/// copies are deep copies.
+///
+/// The memory layout is described by a (row, pixel, channel) stride
+/// triple in bytes, which allows zero-copy views onto sub-regions, single
+/// channels or flipped images, see `ROIView`, `ChannelView` and `FlipView`.
 class ImageBuffer {
 public:
   /// Creates an empty ImageBuffer.
@@ -105,15 +390,37 @@ public:
 
 
   /// Allocates memory to hold a H x W x CH image of the specified type.
+  /// The base pointer is aligned to `kImageBufferAlignment` and each row
+  /// is padded to the default row alignment, see
+  /// `SetImageBufferRowAlignment`. Thus, the buffer will usually NOT
+  /// be contiguous.
   ImageBuffer(int h, int w, int ch, ImageBufferType buf_type);
 
 
+  /// Allocates memory to hold a H x W x CH image of the specified type,
+  /// where the row stride is padded to a multiple of `row_alignment`
+  /// bytes. The alignment must be a power of two, *i.e.* use `1` to
+  /// allocate a contiguous buffer.
+  ImageBuffer(
+      int h, int w, int ch, ImageBufferType buf_type, int row_alignment);
+
+
+  /// Allocates memory to hold a contiguous H x W x CH image of the
+  /// specified type and layout. A planar buffer stores each channel as
+  /// a separate H x W plane, *e.g.* to pass it to a neural network.
+  ImageBuffer(
+      int h, int w, int ch, ImageBufferType buf_type, ImageLayout layout);
+
+
   /// Destructor frees the memory, if it was allocated
   /// by this ImageBuffer.
   ~ImageBuffer();
 
 
-  /// Copy c'tor: Copies the data IFF other.owns_data is true.
+  /// Copy c'tor: If other.owns_data is true, both buffers will reference
+  /// the same storage until either one is modified (copy-on-write). If
+  /// mutable access to the pixels of `other` has already been handed out
+  /// (see `MutableData`), the pixels will be copied immediately instead.
   /// Otherwise, this ImageBuffer will also be a shared buffer.
   /// For a guaranteed deep copy, use `DeepCopy`!
   ImageBuffer(const ImageBuffer &other) noexcept;
@@ -147,13 +454,18 @@ public:
   /// Number of bytes per subsequent rows in memory.
   /// On a freshly allocated buffer, this
   /// equals `width * channels * item_size`.
-  inline int RowStride() const { return row_stride; }
+  inline int64_t RowStride() const { return row_stride; }
 
 
   /// Number of bytes between subsequent pixels.
   /// On a freshly allocated buffer, this
   /// equals `channels * item_size`.
-  inline int PixelStride() const { return pixel_stride; }
+  inline int64_t PixelStride() const { return pixel_stride; }
+
+
+  /// Number of bytes between subsequent channels of a pixel.
+  /// On a freshly allocated buffer, this equals `item_size`.
+  inline int64_t ChannelStride() const { return channel_stride; }
 
 
   /// Returns the size in bytes of a single element/value.
@@ -166,16 +478,18 @@ public:
 
 
   /// Returns the number of pixels, i.e. W*H.
-  inline int NumPixels() const { return width * height; }
+  inline int64_t NumPixels() const {
+    return static_cast<int64_t>(width) * height;
+  }
 
 
   /// Returns the number of elements (i.e. values of the
   /// chosen data type), i.e. W*H*C.
-  inline int NumElements() const { return NumPixels() * channels; }
+  inline int64_t NumElements() const { return NumPixels() * channels; }
 
 
   /// Returns the number of bytes.
-  inline int NumBytes() const { return NumElements() * element_size; }
+  inline int64_t NumBytes() const { return NumElements() * element_size; }
 
 
   /// Returns true if this ImageBuffer is responsible for
@@ -183,21 +497,80 @@ public:
   inline bool OwnsData() const { return owns_data; }
 
 
-  /// Sets this->owns_data = true;
+  /// Sets this->owns_data = true, *i.e.* the memory will be released via
+  /// `std::free` once the last buffer referencing it is destroyed.
   /// Obviously to be used only, if the calling code ensures that
   /// the former `data` owner will NOT free the memory.
   void TakeOwnership();
 
 
+  /// Takes ownership of the shared memory without copying it, *i.e.* this
+  /// buffer behaves as if it had allocated the memory (including
+  /// copy-on-write), but the memory will be released via the given
+  /// `deleter`. Use this to hand over memory of other allocators, *e.g.*
+  /// `stbi_image_free` or a memory pool.
+  /// Throws a `std::logic_error` if this buffer is invalid, already owns
+  /// its memory, or is a view onto memory managed elsewhere.
+  void TakeOwnership(ImageBufferDeleter deleter);
+
+
+  /// Returns true if this buffer owns its memory and currently shares
+  /// it with at least one other (copy-on-write) ImageBuffer.
+  inline bool IsStorageShared() const {
+    return owns_data && (storage.use_count() > 1);
+  }
+
+
+  /// Returns true if this buffer is a read-only view, see `ROIView`,
+  /// `ChannelView` and `FlipView`. Requesting mutable access to a
+  /// read-only buffer throws a `std::logic_error`.
+  inline bool IsReadOnly() const { return read_only; }
+
+
+  /// Returns true if the channels of each pixel are stored
+  /// next to each other, *i.e.* in increasing order.
+  inline bool HasContiguousChannels() const {
+    return channel_stride == element_size;
+  }
+
+
+  /// Returns `ImageLayout::Planar` if the pixels of each channel are
+  /// stored next to each other (*i.e.* the pixel stride equals the element
+  /// size), which requires at least 2 channels. Otherwise, returns
+  /// `ImageLayout::Interleaved`.
+  inline ImageLayout Layout() const {
+    return ((channels > 1) && (pixel_stride == element_size))
+        ? ImageLayout::Planar : ImageLayout::Interleaved;
+  }
+
+
   /// Returns true if the underlying `data` memory is contiguous.
   inline bool IsContiguous() const {
-    return (row_stride == width * channels * element_size)
-        && (pixel_stride == channels * element_size);
+    return (row_stride == static_cast<int64_t>(width) * channels * element_size)
+        && (pixel_stride == static_cast<int64_t>(channels) * element_size)
+        && HasContiguousChannels();
+  }
+
+
+  /// Returns true if the buffer can be scanned as a single row, *i.e.* if
+  /// its memory is contiguous and all elements can be addressed by an
+  /// `int` column index. Large buffers which exceed this limit must be
+  /// processed row by row instead.
+  inline bool IsFlattenable() const {
+    return IsContiguous()
+        && (NumElements() <= std::numeric_limits<int>::max());
   }
 
 
   /// Returns a mutable pointer to the underlying `data` memory.
-  inline unsigned char *MutableData() { return data; }
+  /// If the storage is shared with other buffers, this buffer will
+  /// first detach, *i.e.* create its own copy. Afterwards, the storage
+  /// will no longer be shared with subsequent copies.
+  inline unsigned char *MutableData() {
+    DetachForWriting();
+    shareable = false;
+    return data;
+  }
 
 
   /// Returns an immutable pointer to the underlying `data` memory.
@@ -208,7 +581,8 @@ public:
   /// underlying `data` memory.
   template<typename _Tp> inline
   _Tp *MutablePtr(int row, int col, int channel=0) {
-    return reinterpret_cast<_Tp *>(data + ByteOffset(row, col, channel));
+    return reinterpret_cast<_Tp *>(
+          MutableData() + ByteOffset(row, col, channel));
   }
 
 
@@ -221,9 +595,13 @@ public:
 
 
   /// Returns a reference to modify the specified pixel element.
+  /// If the storage is shared with other buffers, this buffer will
+  /// first detach. In contrast to `MutablePtr`, the storage remains
+  /// shareable, *i.e.* the reference must not be kept across copies.
   template<typename _Tp> inline
   _Tp& AtUnchecked(int row, int col, int channel=0) {
-    return *MutablePtr<_Tp>(row, col, channel);
+    return *reinterpret_cast<_Tp *>(
+          DetachForWriting() + ByteOffset(row, col, channel));
   }
 
 
@@ -273,15 +651,17 @@ public:
     int rows = height;
     int cols = width;
 
-    if (IsContiguous()) {
+    if (IsFlattenable()) {
       cols *= rows;
       rows = 1;
     }
 
+    unsigned char *writable = DetachForWriting();
     for (int row = 0; row < rows; ++row) {
       for (int col = 0; col < cols; ++col) {
         for (int ch = 0; ch < num_channels; ++ch) {
-          AtUnchecked<_Tp>(row, col, ch) = lst[ch];
+          *reinterpret_cast<_Tp *>(
+                writable + ByteOffset(row, col, ch)) = lst[ch];
         }
       }
     }
@@ -295,15 +675,17 @@ public:
     int rows = height;
     int cols = width;
 
-    if (IsContiguous()) {
+    if (IsFlattenable()) {
       cols *= rows;
       rows = 1;
     }
 
+    unsigned char *writable = DetachForWriting();
     for (int row = 0; row < rows; ++row) {
       for (int col = 0; col < cols; ++col) {
         for (int ch = 0; ch < channels; ++ch) {
-          AtUnchecked<_Tp>(row, col, ch) = element;
+          *reinterpret_cast<_Tp *>(
+                writable + ByteOffset(row, col, ch)) = element;
         }
       }
     }
@@ -333,11 +715,13 @@ public:
     int rows = height;
     int cols = width;
 
-    if (IsContiguous()) {
+    // New buffers may have padded rows, so both must be contiguous.
+    if (IsFlattenable() && mask.IsFlattenable()) {
       cols *= rows;
       rows = 1;
     }
 
+    unsigned char *mask_data = mask.DetachForWriting();
     for (int row = 0; row < rows; ++row) {
       for (int col = 0; col < cols; ++col) {
         bool within_range = true;
@@ -348,13 +732,35 @@ public:
             within_range = false;
           }
         }
-        mask.AtUnchecked<unsigned char>(row, col, 0) = within_range ? 255 : 0;
+        mask_data[mask.ByteOffset(row, col, 0)] = within_range ? 255 : 0;
       }
     }
     return mask;
   }
 
 
+  /// Returns a bit-packed mask which is set where the corresponding pixel
+  /// components are within the given range, see `MaskRange`. Compares
+  /// and packs 16 to 32 uint8 pixels at once if SIMD is available.
+  template <typename _Tp, typename... _Ts> inline
+  PackedMask MaskRangePacked(
+      _Tp min0, _Tp max0, _Ts... min_max_others) const {
+    CheckType<_Tp>();
+
+    const int num_inputs = 2 + sizeof...(min_max_others);
+    if (num_inputs != 2 * channels) {
+      std::ostringstream msg;
+      msg << "`MaskRangePacked` expects min/max per channel, i.e. "
+          << (2 * channels) << " values, but got " << num_inputs << '!';
+      throw std::invalid_argument(msg.str());
+    }
+
+    const _Tp min_max[num_inputs] = {
+      min0, max0, static_cast<_Tp>(min_max_others)...};
+    return MaskRangePackedImpl(min_max);
+  }
+
+
   //TODO impl & doc (any input type, eps equal 0, 0 --> mask = 255)
 //  ImageBuffer Invert() const;
 
@@ -383,18 +789,20 @@ public:
     int rows = height;
     int cols = width;
 
-    if (IsContiguous()) {
+    if (IsFlattenable() && dst.IsFlattenable()) {
       cols *= rows;
       rows = 1;
     }
 
+    unsigned char *dst_data = dst.DetachForWriting();
     for (int row = 0; row < rows; ++row) {
       for (int col = 0; col < cols; ++col) {
         for (int ch = 0; ch < channels; ++ch) {
           const dst_type val = static_cast<dst_type>(
                 ((AtUnchecked<_Tp>(row, col, ch) +  sss[ch * 3]) * sss[(ch * 3) + 1])
               + sss[(ch * 3) + 2]);
-          dst.AtUnchecked<dst_type>(row, col, ch) = val;
+          *reinterpret_cast<dst_type *>(
+                dst_data + dst.ByteOffset(row, col, ch)) = val;
         }
       }
     }
@@ -415,8 +823,40 @@ public:
   ///   buffer_type: Element type.
   void CreateSharedBuffer(
       unsigned char *buffer,
-      int height, int width, int channels, int row_stride,
-      int pixel_stride, ImageBufferType buffer_type);
+      int height, int width, int channels, int64_t row_stride,
+      int64_t pixel_stride, ImageBufferType buffer_type);
+
+
+  /// Reuses the given image data with an arbitrary memory layout, *e.g.*
+  /// planar or channel-reversed data. Strides are given in bytes and
+  /// may be negative. See `CreateSharedBuffer` above for the other
+  /// parameters.
+  void CreateSharedBuffer(
+      unsigned char *buffer,
+      int height, int width, int channels, int64_t row_stride,
+      int64_t pixel_stride, int64_t channel_stride,
+      ImageBufferType buffer_type);
+
+
+  /// Reuses densely packed image data of the given layout, *e.g.* the
+  /// CHW output tensor of a neural network. Does NOT take ownership.
+  void CreateSharedBuffer(
+      unsigned char *buffer,
+      int height, int width, int channels,
+      ImageBufferType buffer_type, ImageLayout layout);
+
+
+  /// Shares the given memory (same as `CreateSharedBuffer` above), but
+  /// keeps the `owner` handle alive until the last buffer or view which
+  /// references the memory has been destroyed. This buffer does not own
+  /// the memory, *i.e.* write access never copies it. Use this to wrap
+  /// memory of other libraries, *e.g.* python arrays or Cairo surfaces,
+  /// without having to track their lifetime.
+  void CreateSharedBuffer(
+      unsigned char *buffer,
+      int height, int width, int channels, int64_t row_stride,
+      int64_t pixel_stride, int64_t channel_stride,
+      ImageBufferType buffer_type, std::shared_ptr<void> owner);
 
 
   /// Copies the given image data.
@@ -427,22 +867,70 @@ public:
   ///   width: Number of columns
   ///   channels: Number of elements at each (row, column) location.
   ///   row_stride: Number of bytes between consecutive rows.
-  ///   pixel_stride: Number of bytes between neighboring pixels.
+  ///   column_stride: Number of bytes between neighboring pixels.
+  ///   channel_stride: Number of bytes between subsequent channels.
   ///   buffer_type: Element type.
   void CreateCopiedBuffer(unsigned char const *buffer,
-      int height, int width, int channels, int row_stride,
-      int column_stride, int channel_stride, ImageBufferType buffer_type);
+      int height, int width, int channels, int64_t row_stride,
+      int64_t column_stride, int64_t channel_stride,
+      ImageBufferType buffer_type);
 
 
-  /// Returns a deep copy.
+  /// Returns a deep copy, which will always be contiguous.
   ImageBuffer DeepCopy() const;
 
 
+  /// Ensures that this buffer can hold a H x W x CH image of the given
+  /// type. If the shape and type already match, the current memory will
+  /// be reused, *i.e.* this also works for shared buffers (such as views
+  /// onto external memory). Otherwise, new memory will be allocated.
+  /// This includes copy-on-write storage which is currently shared with
+  /// other buffers, because the caller is about to overwrite the pixels
+  /// (and this way, the output can be written from multiple threads).
+  /// Storage to which mutable pointers have been handed out (see
+  /// `MutableData`) is reused, too.
+  ///
+  /// Returns true if memory had to be (re-)allocated.
+  bool EnsureShape(int h, int w, int ch, ImageBufferType buf_type);
+
+
   /// Returns a shared ImageBuffer which points to the specified axis-aligned
   /// region-of-interest. This buffer will usually NOT be contiguous.
+  /// If this buffer currently shares its storage with a copy, it will
+  /// detach first, *i.e.* the ROI can only modify this buffer's pixels.
+  /// As for `MutableData`, subsequent copies of this buffer will not
+  /// share the storage, so they never observe writes via the ROI.
   ImageBuffer ROI(int left, int top, int roi_width, int roi_height);
 
 
+  /// Returns a read-only view onto the specified region-of-interest.
+  /// In contrast to `ROI`, this neither copies nor detaches the pixels.
+  ///
+  /// Views keep owning (copy-on-write) storage alive. Thus, if this
+  /// buffer is modified afterwards, it will detach and the view still
+  /// shows the pixels at the time it was created. This does not hold
+  /// if mutable pointers or ROIs have been handed out before (see
+  /// `MutableData`), because then writes via these are also visible
+  /// in the view. Views onto shared memory (such as numpy arrays) must
+  /// not outlive that memory.
+  ImageBuffer ROIView(
+      int left, int top, int roi_width, int roi_height) const;
+
+
+  /// Returns a read-only view onto `num_channels` channels, starting at
+  /// `first_channel` and advancing by `step`. For example, use
+  /// `ChannelView(2, 3, -1)` to view an RGB(A) image as BGR, or
+  /// `ChannelView(3)` to view the alpha channel of an RGBA image.
+  /// The same lifetime considerations as for `ROIView` apply.
+  ImageBuffer ChannelView(
+      int first_channel, int num_channels = 1, int step = 1) const;
+
+
+  /// Returns a read-only view which is flipped left/right and/or
+  /// up/down. The same lifetime considerations as for `ROIView` apply.
+  ImageBuffer FlipView(bool horizontal, bool vertical) const;
+
+
   /// Swaps the specified (0-based) channels *in-place*.
   void SwapChannels(int ch1, int ch2);
 
@@ -460,10 +948,19 @@ public:
   ImageBuffer ToChannels(int output_channels) const;
 
 
+  /// Writes the channel conversion into the given destination buffer, which
+  /// will only be (re-)allocated if its shape or type does not match. This
+  /// also holds for all other transformations which take a `dst` buffer.
+  /// If `dst` overlaps with an input, the result will be computed into a
+  /// temporary buffer first.
+  void ToChannels(ImageBuffer *dst, int output_channels) const;
+
+
   /// Converts this buffer to `uint8_t`.
   /// If the underlying type is `float` or `double`,
-  /// the values will be **multiplied by 255**. Otherwise,
-  /// the values will be clamped into [0, 255].
+  /// the values will be **multiplied by 255**. All
+  /// values will then be clamped into [0, 255] and
+  /// NaN becomes 0 (vectorized if available).
   ///
   /// The following channel configurations are supported:
   /// * 1-channel buffer: output_channels either 1, 3, or 4
@@ -472,18 +969,45 @@ public:
   ImageBuffer ToUInt8(int output_channels) const;
 
 
+  /// Converts this buffer to `uint8_t` and writes the result into `dst`.
+  void ToUInt8(ImageBuffer *dst, int output_channels) const;
+
+
   /// Converts this buffer to `float`.
   /// If the underlying type is integral (`uint8`,
-  /// `int16`, etc.), the values will be **divided by 255**.
+  /// `int16`, etc.), the values will be **divided by 255**
+  /// (more precisely, multiplied by `1.0f/255.0f`).
+  /// Half precision values are converted exactly (vectorized
+  /// via F16C/NEON if available).
   /// Number of channels remains the same.
   ImageBuffer ToFloat() const;
 
 
+  /// Converts this buffer to `float` and writes the result into `dst`.
+  void ToFloat(ImageBuffer *dst) const;
+
+
   /// Returns a copy of this buffer converted to the given type.
-  /// Before type casting (and thus, potential value clipping), the values
-  /// will be scaled by the given scaling factor.
+  /// Before type casting, the values will be scaled by the given scaling
+  /// factor. Conversions between `float` and the half precision types
+  /// (without scaling) round to nearest even.
+  ///
+  /// If `saturate` is true, values outside of the range of an integral
+  /// output type will be clamped and NaN becomes 0. Otherwise, the scaled
+  /// values are simply casted, *i.e.* the results for values outside of
+  /// the output range are undefined.
+  /// Without scaling, casts from `int16`, `uint16`, `int32`, `float` and
+  /// `double` to saturated `uint8`, as well as casts from `uint8`, `int16`,
+  /// `uint16`, `int32` and `double` to `float` are vectorized.
   ImageBuffer AsType(
-      ImageBufferType type, double scaling_factor=1.0) const;
+      ImageBufferType type, double scaling_factor=1.0,
+      bool saturate=false) const;
+
+
+  /// Converts this buffer to the given type and writes the result into `dst`.
+  void AsType(
+      ImageBuffer *dst, ImageBufferType type,
+      double scaling_factor=1.0, bool saturate=false) const;
 
 
   //TODO Gradient (sobel, border handling)
@@ -495,6 +1019,10 @@ public:
   ImageBuffer Magnitude() const;
 
 
+  /// Computes the magnitude and writes the result into `dst`.
+  void Magnitude(ImageBuffer *dst) const;
+
+
   /// Computes the orientation in radians of a dual-channel image, e.g. an
   /// optical flow field or an image gradient. Only implemented for buffers of
   /// type float or double. Output buffer type will be the same as this
@@ -505,6 +1033,12 @@ public:
       float invalid = std::numeric_limits<float>::quiet_NaN()) const;
 
 
+  /// Computes the orientation and writes the result into `dst`.
+  void Orientation(
+      ImageBuffer *dst,
+      float invalid = std::numeric_limits<float>::quiet_NaN()) const;
+
+
   /// Performs **in-place** pixelation of images with **up to 4**
   /// :attr:`channels`. All pixels within a *block* will be set to
   /// the value of the block's center pixel.
@@ -520,6 +1054,28 @@ public:
       int roi_left, int roi_top, int roi_width, int roi_height);
 
 
+  /// Performs **in-place** blurring of the given regions of interest,
+  /// *e.g.* to anonymize faces or license plates. Supports all buffer
+  /// types and any number of channels.
+  ///
+  /// Each filter pass is a running-sum box filter, *i.e.* the cost per
+  /// pixel does not depend on the `radius`. `BlurKind::Box` applies a
+  /// single pass of size `2 * radius + 1`, whereas `BlurKind::Gaussian`
+  /// approximates a Gaussian with standard deviation `radius / 3` by
+  /// three iterated box filters. Pixels outside of a region contribute
+  /// to the filter response, and the image border is replicated.
+  /// Non-finite values (NaN or infinity) only affect the outputs of
+  /// filter windows which contain them.
+  ///
+  /// All regions are blurred based on the original pixels and are
+  /// processed in parallel. If regions overlap, later ones overwrite the
+  /// earlier ones. The axis-aligned regions (their rotation must be 0)
+  /// are clipped to the image, regions outside of the image are ignored.
+  void Blur(
+      const std::vector<Rect> &rois, int radius,
+      BlurKind kind = BlurKind::Gaussian);
+
+
   /// Returns an alpha-blended image.
   ///
   /// Computes ``((1 - alpha) * this) + (alpha * other)``.
@@ -527,9 +1083,18 @@ public:
   /// output channels will be the maximum of ``this.channels``
   /// and ``other.channels``. In this case, *non-blendable* channels
   /// are copied from the input buffer which has more channels.
+  ///
+  /// uint8 buffers are blended in 8.8 fixed-point (vectorized, if
+  /// available), *i.e.* alpha is quantized to multiples of 1/256 and
+  /// the results are rounded. All other integral types are truncated.
   ImageBuffer Blend(const ImageBuffer &other, double alpha_other) const;
 
 
+  /// Writes the alpha-blended image into `dst`.
+  void Blend(
+      ImageBuffer *dst, const ImageBuffer &other, double alpha_other) const;
+
+
   /// Returns an alpha-blended image.
   ///
   /// Creates a new image as the result of
@@ -547,15 +1112,114 @@ public:
       const ImageBuffer &other, const ImageBuffer &weights) const;
 
 
+  /// Writes the alpha-blended image into `dst`.
+  void Blend(
+      ImageBuffer *dst, const ImageBuffer &other,
+      const ImageBuffer &weights) const;
+
+
+  /// Returns an image where `other` is alpha-blended into this buffer
+  /// only at the pixels which are set in the binary `mask`, *i.e.* the
+  /// result is ``(1 - alpha) * this + alpha * other`` at masked pixels and
+  /// ``this`` elsewhere. The same channel handling as for the other
+  /// `Blend` overloads applies.
+  ImageBuffer Blend(
+      const ImageBuffer &other, const PackedMask &mask,
+      double alpha_other = 1.0) const;
+
+
+  /// Writes the masked alpha-blended image into `dst`.
+  void Blend(
+      ImageBuffer *dst, const ImageBuffer &other, const PackedMask &mask,
+      double alpha_other = 1.0) const;
+
+
+  /// Returns the result of compositing the 4-channel `overlay` over
+  /// this 3- or 4-channel image (the *over* operator), *e.g.* to overlay
+  /// a colorized heatmap onto a video frame.
+  ///
+  /// The color channels are blended by the overlay's alpha, *i.e.*
+  /// ``(1 - alpha) * this + alpha * overlay``. If this image has an alpha
+  /// channel, the output alpha is ``alpha + this.alpha * (1 - alpha)``.
+  /// Supported types are uint8, where 255 is fully opaque, and floating
+  /// point buffers with alpha in [0, 1]. uint8 images are composited in
+  /// 8.8 fixed-point, see `Blend`.
+  ImageBuffer AlphaComposite(const ImageBuffer &overlay) const;
+
+
+  /// Writes the composited image into `dst`.
+  void AlphaComposite(ImageBuffer *dst, const ImageBuffer &overlay) const;
+
+
+  /// Composites the 4-channel `overlay` over this buffer **in-place**, see
+  /// `AlphaComposite`. This also modifies shared memory, such as numpy
+  /// views. Copy-on-write storage will be detached first.
+  void AlphaCompositeInPlace(const ImageBuffer &overlay);
+
+
+  /// Alpha-blends `other` into this buffer **in-place**, *i.e.* computes
+  /// ``this = ((1 - alpha) * this) + (alpha * other)`` without allocating
+  /// an output. This also modifies shared memory, such as numpy views.
+  /// Copy-on-write storage will be detached first.
+  ///
+  /// Because the number of channels cannot change, `other` must not
+  /// have more channels than this buffer. Surplus channels of this
+  /// buffer remain unchanged.
+  void BlendInPlace(const ImageBuffer &other, double alpha_other);
+
+
+  /// Alpha-blends `other` into this buffer **in-place** using the given
+  /// weight mask, see the corresponding `Blend` overload. The same
+  /// restrictions as for `BlendInPlace(other, alpha)` apply.
+  void BlendInPlace(const ImageBuffer &other, const ImageBuffer &weights);
+
+
+  /// Returns a resampled copy of this image with the given size. Works
+  /// natively on all buffer types and any number of channels. Bilinear
+  /// and area interpolation are computed as two separable passes, where
+  /// integral types are rounded & saturated. Pixel centers are aligned,
+  /// *i.e.* the same convention as OpenCV's `cv::resize`.
+  ImageBuffer Resize(
+      int new_width, int new_height,
+      Interpolation interpolation = Interpolation::Bilinear) const;
+
+
+  /// Writes the resampled image into `dst`, see `Resize`.
+  void Resize(
+      ImageBuffer *dst, int new_width, int new_height,
+      Interpolation interpolation = Interpolation::Bilinear) const;
+
+
   /// Returns a single-channel buffer deeply copied from this ImageBuffer.
+  /// To avoid the copy, use `ChannelView` instead.
   ImageBuffer Channel(int channel) const;
 
 
+  /// Copies the specified channel into the single-channel buffer `dst`.
+  void Channel(ImageBuffer *dst, int channel) const;
+
+
   /// Returns a dimmed version of this image by element-wise
   /// multiplication of alpha and the corresponding pixel value.
   ImageBuffer Dim(double alpha) const;
 
 
+  /// Writes the dimmed version of this image into `dst`.
+  void Dim(ImageBuffer *dst, double alpha) const;
+
+
+  /// Dims this image **in-place**, *i.e.* without allocating an output.
+  /// This also modifies shared memory, such as numpy views or the
+  /// canvas of a `Painter`. Copy-on-write storage will be detached first.
+  void DimInPlace(double alpha);
+
+
+  /// Returns a lazily evaluated pixel expression on this buffer, which
+  /// allows to apply a chain of element-wise operations in a single
+  /// pass, see `PixelExpression`.
+  PixelExpression Lazy() const;
+
+
   /// Returns true if this buffer points to a valid memory location.
   bool IsValid() const;
 
@@ -571,6 +1235,21 @@ public:
       int channel = -1) const;
 
 
+  /// Computes the statistics of each channel in a single (parallel) pass.
+  ///
+  /// Optionally, a histogram with `num_bins` equally sized bins over
+  /// `[histogram_min, histogram_max]` will be computed, too. All bins
+  /// are half-open, except for the last one, which also includes
+  /// `histogram_max` (same as `numpy.histogram`). Values outside this
+  /// range, as well as NaN values, are not counted.
+  ///
+  /// The results do not depend on the number of threads.
+  std::vector<ChannelStatistics> Statistics(
+      int num_bins = 0,
+      double histogram_min = 0.0,
+      double histogram_max = 256.0) const;
+
+
   /// Returns a human readable representation.
   std::string ToString() const;
 
@@ -582,10 +1261,22 @@ public:
   }
 
 
+  /// Memory-mapped buffers are created via `MapRaw` and `MapNpy`.
+  friend ImageBuffer MapRaw(
+      const std::string &filename, int height, int width, int channels,
+      ImageBufferType buffer_type, int64_t offset, bool copy_on_write);
+  friend ImageBuffer MapNpy(const std::string &filename, bool copy_on_write);
+
+
 private:
   /// Pointer to the image data.
   unsigned char *data;
 
+  /// Reference-counted storage which holds the allocated memory if this
+  /// buffer owns its data. Copies of an owning buffer share the storage
+  /// until one of them requests mutable access.
+  std::shared_ptr<unsigned char> storage;
+
   /// Number of rows.
   int height;
 
@@ -602,10 +1293,13 @@ private:
   int element_size;
 
   /// Number of bytes between subsequent rows.
-  int row_stride;
+  int64_t row_stride;
 
   /// Number of bytes between subsequent pixels.
-  int pixel_stride;
+  int64_t pixel_stride;
+
+  /// Number of bytes between subsequent channels.
+  int64_t channel_stride;
 
   /// This buffer's data type.
   ImageBufferType buffer_type;
@@ -614,12 +1308,88 @@ private:
   /// memory, i.e. if it is responsible for cleaning up.
   bool owns_data;
 
+  /// Flag which indicates if this buffer is a read-only view.
+  bool read_only;
+
+  /// Flag which indicates if copies may share the owned storage. It is
+  /// cleared once mutable access has been handed out (via `MutableData`,
+  /// `MutablePtr` or `ROI`), because writes through such pointers must
+  /// not become visible in (subsequent) copies.
+  bool shareable;
+
 
   /// Frees the memory if needed and resets
   /// the members accordingly.
   void Cleanup();
 
 
+  /// Creates a private copy of the storage if it is
+  /// currently shared with other buffers. Storage which is no longer
+  /// shareable is only referenced by views (and must stay in place,
+  /// because pointers to it have been handed out).
+  inline void DetachIfShared() {
+    if (shareable && IsStorageShared()) {
+      Detach();
+    }
+  }
+
+
+  /// Copies the shared storage, so that this buffer holds
+  /// the only reference to its memory afterwards.
+  void Detach();
+
+
+  /// Checks write access and detaches shared storage once, see
+  /// `helpers::PixelWriter`. Returns the mutable data pointer.
+  inline unsigned char *DetachForWriting() {
+    CheckWriteAccess();
+    DetachIfShared();
+    return data;
+  }
+
+
+  /// Operations write their results via `DetachForWriting`.
+  friend class helpers::PixelWriter;
+
+
+  /// Computes the packed range mask, where `min_max` points to the
+  /// `2 * channels` thresholds of this buffer's type.
+  PackedMask MaskRangePackedImpl(const void *min_max) const;
+
+
+  /// Throws a `std::logic_error` if this buffer is read-only.
+  inline void CheckWriteAccess() const {
+    if (read_only) {
+      ThrowReadOnly();
+    }
+  }
+
+
+  /// Reports an invalid write access to a read-only buffer.
+  [[noreturn]] void ThrowReadOnly() const;
+
+
+  /// Returns a (non-owning) buffer which references the given memory
+  /// mapping. The `mapping` will be released once the last buffer or
+  /// view referencing it is destroyed.
+  static ImageBuffer CreateMappedBuffer(
+      std::shared_ptr<unsigned char> mapping, unsigned char *mapped_data,
+      int height, int width, int channels, int64_t row_stride,
+      int64_t pixel_stride, int64_t channel_stride,
+      ImageBufferType buffer_type, bool read_only);
+
+
+  /// Batches hand out their frames via `CreateMappedBuffer`.
+  friend class ImageBatch;
+
+
+  /// Returns a read-only view onto the given memory of this buffer.
+  ImageBuffer CreateView(
+      unsigned char const *view_data, int view_height, int view_width,
+      int view_channels, int64_t view_row_stride, int64_t view_pixel_stride,
+      int64_t view_channel_stride) const;
+
+
   /// Checks that the given indices are valid.
   inline void CheckIndexedAccess(int row, int col, int channel) const {
     if ((row < 0) || (row >= height)
@@ -649,12 +1419,244 @@ private:
 
 
   /// Returns the offset in bytes to the given indices.
-  inline int ByteOffset(int row, int col, int channel) const {
-    return (row * row_stride) + (col * pixel_stride) + (channel * element_size);
+  inline int64_t ByteOffset(int row, int col, int channel) const {
+    return (row * row_stride) + (col * pixel_stride)
+        + (channel * channel_stride);
   }
 };
 
 
+//---------------------------------------------------- Image batch
+
+/// A batch of equally sized images, *e.g.* the NHWC or NCHW output tensor
+/// of a neural network. Each frame can be accessed as an ImageBuffer
+/// without copying, *i.e.* all ImageBuffer operations (such as `ToUInt8`
+/// or `ColorizeScaled`) read the batch memory directly.
+///
+/// The memory layout is described by a (frame, row, pixel, channel)
+/// stride quadruple in bytes.
+class ImageBatch {
+public:
+  /// Creates an empty (invalid) batch.
+  ImageBatch() = default;
+
+
+  /// Allocates a contiguous batch of `num_frames` H x W x CH images
+  /// of the specified type and layout.
+  ImageBatch(
+      int num_frames, int h, int w, int ch, ImageBufferType buf_type,
+      ImageLayout layout = ImageLayout::Interleaved);
+
+
+  /// Reuses densely packed batch data of the given layout, *i.e.* NHWC
+  /// for `ImageLayout::Interleaved` or NCHW for `ImageLayout::Planar`.
+  /// Does NOT take ownership, thus the memory must outlive this batch
+  /// and all of its frames.
+  void CreateSharedBatch(
+      unsigned char *buffer, int num_frames,
+      int height, int width, int channels,
+      ImageBufferType buffer_type, ImageLayout layout);
+
+
+  /// Reuses the given batch data with an arbitrary memory layout. Strides
+  /// are given in bytes and may be negative. Does NOT take ownership.
+  void CreateSharedBatch(
+      unsigned char *buffer, int num_frames,
+      int height, int width, int channels,
+      int64_t frame_stride, int64_t row_stride,
+      int64_t pixel_stride, int64_t channel_stride,
+      ImageBufferType buffer_type);
+
+
+  /// Returns true if the batch holds at least one frame.
+  inline bool IsValid() const {
+    return (data_ != nullptr) && (num_frames_ > 0);
+  }
+
+
+  /// Returns the number of frames.
+  inline int NumFrames() const { return num_frames_; }
+
+
+  /// Returns the number of rows of each frame.
+  inline int Height() const { return height_; }
+
+
+  /// Returns the number of pixels in each row.
+  inline int Width() const { return width_; }
+
+
+  /// Number of values per pixel.
+  inline int Channels() const { return channels_; }
+
+
+  /// Returns the data type.
+  inline ImageBufferType BufferType() const { return buffer_type_; }
+
+
+  /// Number of bytes between subsequent frames.
+  inline int64_t FrameStride() const { return frame_stride_; }
+
+
+  /// Returns the layout of each frame, see `ImageBuffer::Layout`.
+  inline ImageLayout Layout() const {
+    return ((channels_ > 1)
+            && (pixel_stride_ == ElementSizeFromImageBufferType(buffer_type_)))
+        ? ImageLayout::Planar : ImageLayout::Interleaved;
+  }
+
+
+  /// Returns true if this batch allocated (and thus owns) its memory.
+  inline bool OwnsData() const { return storage_ != nullptr; }
+
+
+  /// Returns the specified (0-based) frame as a shared ImageBuffer, which
+  /// can be used to modify the pixels of this batch. If the batch owns its
+  /// memory, the frame keeps it alive.
+  ImageBuffer Frame(int index);
+
+
+  /// Returns a read-only view onto the specified frame, see `Frame`.
+  ImageBuffer FrameView(int index) const;
+
+
+  /// Returns a human readable representation.
+  std::string ToString() const;
+
+
+private:
+  /// Allocated memory, or nullptr for shared batches.
+  std::shared_ptr<unsigned char> storage_;
+
+  /// Points to the first element of the first frame.
+  unsigned char *data_ = nullptr;
+
+  int num_frames_ = 0;
+  int height_ = 0;
+  int width_ = 0;
+  int channels_ = 0;
+
+  /// Strides in bytes.
+  int64_t frame_stride_ = 0;
+  int64_t row_stride_ = 0;
+  int64_t pixel_stride_ = 0;
+  int64_t channel_stride_ = 0;
+
+  ImageBufferType buffer_type_ = ImageBufferType::UInt8;
+
+
+  /// Throws a `std::out_of_range` if the frame index is invalid.
+  void CheckFrameIndex(int index) const;
+};
+
+
+//---------------------------------------------------- Pixel expressions
+
+/// Records element-wise operations on an ImageBuffer, which will be
+/// applied in a single pass upon evaluation.
+///
+/// Chaining ImageBuffer operations (such as `Normalize`, `Blend`,
+/// `AsType` and `ToUInt8`) requires a full pass over the image and
+/// a separate allocation per step. A pixel expression instead computes
+/// all recorded operations tile by tile (and in parallel, see
+/// `SetNumThreads`), *i.e.* each input is read once and only the final
+/// result is allocated:
+///
+///   ImageBuffer result = image.Lazy()
+///       .Normalize({-0.5}, {2.0}, {0.0})
+///       .Blend(overlay, 0.3)
+///       .Scale(255.0)
+///       .Evaluate(ImageBufferType::UInt8);
+///
+/// Intermediate values are computed in double precision and only the
+/// final result is converted to the output type, saturating values which
+/// exceed its range. Thus, results may slightly differ from a chain of
+/// eager operations, which truncates the values after each step.
+///
+/// An expression holds copies of all involved ImageBuffers. Owning buffers
+/// are copy-on-write, so modifying them afterwards does not change the
+/// expression. Shared buffers (which do not own their memory, such as
+/// numpy views), however, must remain valid until evaluation.
+class PixelExpression {
+public:
+  /// Creates an expression which yields the given source values.
+  explicit PixelExpression(const ImageBuffer &source);
+
+
+  /// Returns the number of rows of the result.
+  int Height() const;
+
+
+  /// Returns the number of columns of the result.
+  int Width() const;
+
+
+  /// Returns the number of channels of the result, *i.e.* after applying
+  /// all recorded operations.
+  int Channels() const;
+
+
+  /// Returns the number of recorded operations.
+  int NumOperations() const;
+
+
+  /// Records `v = (v + shift_pre) * scale + shift_post`, *i.e.* the
+  /// same as `ImageBuffer::Normalize`. Each vector must either provide a
+  /// single value (used for all channels) or one value per channel.
+  PixelExpression &Normalize(
+      const std::vector<double> &shift_pre,
+      const std::vector<double> &scale,
+      const std::vector<double> &shift_post);
+
+
+  /// Records the multiplication by a constant factor, *e.g.*
+  /// to dim the image or to scale the values before `Evaluate`.
+  PixelExpression &Scale(double factor);
+
+
+  /// Records clipping of the values to `[min_value, max_value]`.
+  PixelExpression &Clamp(double min_value, double max_value);
+
+
+  /// Records alpha blending of the current values with `other`, which
+  /// must have the same width & height, but can be of any type. The
+  /// same channel handling as in `ImageBuffer::Blend` applies.
+  PixelExpression &Blend(const ImageBuffer &other, double alpha_other);
+
+
+  /// Records alpha blending of the current values with `other`, using
+  /// a `float` or `double` weight mask, see `ImageBuffer::Blend`.
+  PixelExpression &Blend(const ImageBuffer &other, const ImageBuffer &weights);
+
+
+  /// Applies all recorded operations in a single pass and returns
+  /// the result as a newly allocated buffer of the given type.
+  ImageBuffer Evaluate(ImageBufferType output_type) const;
+
+
+  /// Applies all recorded operations and writes the result into `dst`,
+  /// which will only be (re-)allocated if its shape or type does not match.
+  void Evaluate(ImageBuffer *dst, ImageBufferType output_type) const;
+
+
+private:
+  struct Operation;
+
+  /// Input buffer of the expression.
+  ImageBuffer source_;
+
+  /// Number of channels after applying all operations.
+  int channels_;
+
+  /// Recorded operations, in order of application. These are immutable,
+  /// so copies of an expression can share them.
+  std::vector<std::shared_ptr<const Operation>> operations_;
+
+  /// Throws if `buffer` cannot be used within this expression.
+  void CheckCompatible(const ImageBuffer &buffer, const char *what) const;
+};
+
+
 // TODO(interface) - other color conversions (i.e. rgb2gray,
 // gray2rgb) should be added here, too
 // Then, add "ImageBuffer utils" doc section on RTD
@@ -677,11 +1679,56 @@ ImageBuffer MaskHSVRange(
     const std::pair<float, float> &value_range);
 
 
+/// Returns a uint8 single channel mask where a pixel is set to 255 iff
+/// its color is within the given HSV range.
+///
+/// Equivalent to `MaskHSVRange(ConvertRGB2HSV(image, is_bgr), ...)`, but
+/// the range test is evaluated per pixel in a single pass, *i.e.* without
+/// computing the intermediate HSV image.
+/// Args:
+///   image: Color image in RGB(A)/BGR(A) format (uint8).
+///   hue_range: Hue range as ``(min_hue, max_hue)``, where
+///     hue values are in `[0, 360]`.
+///   saturation_range: Saturation range as
+///     ``(min_saturation, max_saturation)``, where saturation
+///     values are in `[0, 1]`.
+///   value_range: Similar to saturation range, *i.e.* values in `[0, 1]`.
+///   is_bgr: Set to ``true`` if the color image is provided in BGR(A) format.
+ImageBuffer MaskColorRange(
+    const ImageBuffer &image,
+    const std::pair<float, float> &hue_range,
+    const std::pair<float, float> &saturation_range,
+    const std::pair<float, float> &value_range,
+    bool is_bgr = false);
+
+
+/// Returns the bit-packed version of `MaskHSVRange`, *i.e.* the
+/// mask needs only 1 bit per pixel.
+PackedMask MaskHSVRangePacked(
+    const ImageBuffer &hsv,
+    const std::pair<float, float> &hue_range,
+    const std::pair<float, float> &saturation_range,
+    const std::pair<float, float> &value_range);
+
+
+/// Returns the bit-packed version of `MaskColorRange`, *i.e.* the
+/// mask needs only 1 bit per pixel.
+PackedMask MaskColorRangePacked(
+    const ImageBuffer &image,
+    const std::pair<float, float> &hue_range,
+    const std::pair<float, float> &saturation_range,
+    const std::pair<float, float> &value_range,
+    bool is_bgr = false);
+
+
 /// Implements a *color pop* effect, *i.e.* colors within the given HSV
 /// range remain as-is, whereas all other colors are converted to
-/// grayscale.
+/// grayscale (the alpha channel is kept).
+///
+/// The HSV range test and the grayscale conversion are fused into a
+/// single pass over the image.
 /// Args:
-///   rgb: Color image in RGB(A)/BGR(A) format.
+///   image: Color image in RGB(A)/BGR(A) format (uint8).
 ///   hue_range: Hue range as ``(min_hue, max_hue)``, where
 ///     hue values are in `[0, 360]`.
 ///   saturation_range: Saturation range as
@@ -710,6 +1757,15 @@ ImageBuffer ConvertRGB2Gray(
     bool is_bgr_format = false);
 
 
+/// Converts the color image to grayscale and writes the result into `dst`,
+/// which will only be (re-)allocated if its shape or type does not match.
+void ConvertRGB2Gray(
+    const ImageBuffer &color,
+    ImageBuffer *dst,
+    int output_channels = 1,
+    bool is_bgr_format = false);
+
+
 /// Converts a RGB(A)/BGR(A) image to HSV. Input image must be of type uint8.
 ///
 /// Returns:
@@ -720,6 +1776,14 @@ ImageBuffer ConvertRGB2HSV(
     bool is_bgr_format = false);
 
 
+/// Converts the color image to HSV and writes the result into `dst`,
+/// which will only be (re-)allocated if its shape or type does not match.
+void ConvertRGB2HSV(
+    const ImageBuffer &image_rgb,
+    ImageBuffer *dst,
+    bool is_bgr_format = false);
+
+
 /// Converts a HSV image to RGB(A)/BGR(A).
 /// Input image must be of type uint8, where hue in [0, 180], saturation in [0, 255]
 /// and value in [0, 255].
@@ -732,6 +1796,39 @@ ImageBuffer ConvertHSV2RGB(
     bool output_bgr_format = false);
 
 
+/// Converts a RGB(A)/BGR(A) image to CIE L*a*b* (D65 white point).
+/// Input image must be of type uint8 or float, where float values
+/// are expected in [0, 1].
+///
+/// Returns:
+///   A 3-channel image of the same type. For float, L* is in [0, 100]
+///   and a*, b* are roughly in [-128, 127]. For uint8, the channels
+///   follow the OpenCV convention, *i.e.* ``L * 255 / 100``, ``a + 128``
+///   and ``b + 128``.
+ImageBuffer ConvertRGB2Lab(
+    const ImageBuffer &image_rgb,
+    bool is_bgr_format = false);
+
+
+/// Converts the color image to L*a*b* and writes the result into `dst`,
+/// which will only be (re-)allocated if its shape or type does not match.
+void ConvertRGB2Lab(
+    const ImageBuffer &image_rgb,
+    ImageBuffer *dst,
+    bool is_bgr_format = false);
+
+
+/// Converts a L*a*b* image (uint8 or float, see `ConvertRGB2Lab`) to
+/// RGB(A)/BGR(A) of the same type. Out-of-gamut colors are clipped.
+///
+/// If output_channels is 4, the fourth channel will be set to 255
+/// (uint8) or 1 (float), *i.e.* a fully opaque alpha channel.
+ImageBuffer ConvertLab2RGB(
+    const ImageBuffer &image_lab,
+    int output_channels = 3,
+    bool output_bgr_format = false);
+
+
 /// Loads an 8-bit image from disk.
 ///
 /// We use the stb/stb_image library for reading/decoding.
@@ -765,6 +1862,51 @@ ImageBuffer LoadImageUInt8(const std::string &image_filename, int force_num_chan
 void SaveImageUInt8(const std::string &image_filename, const ImageBuffer &image);
 
 
+/// Memory-maps a raw binary file as an ImageBuffer, *i.e.* pixels will
+/// only be paged in once they are accessed. This allows processing
+/// rasters which exceed the available memory (*e.g.* via `ROIView`,
+/// `ColorizeScaled` or `ReliefShading`).
+///
+/// Args:
+///   filename: Path to the file.
+///   height, width, channels: Dimensions of the raster, which must be
+///     stored in row-major order with interleaved channels.
+///   buffer_type: Data type of the stored elements (in host byte order).
+///   offset: Number of bytes to skip at the beginning of the file, *e.g.*
+///     a custom header. Must be a multiple of the element size.
+///   copy_on_write: If false, the returned buffer is read-only. Otherwise,
+///     the mapping is private: the buffer can be modified, but changes
+///     will never be written back to the file. Note that copies of a
+///     writeable mapped buffer share the mapping, analogous to any other
+///     buffer which doesn't own its memory.
+ImageBuffer MapRaw(
+    const std::string &filename, int height, int width, int channels,
+    ImageBufferType buffer_type, int64_t offset = 0,
+    bool copy_on_write = false);
+
+
+/// Memory-maps a 2D (single-channel) or 3D (HxWxC) NumPy array stored in
+/// the `.npy` format as an ImageBuffer. Both C and Fortran order are
+/// supported, the data type and shape are taken from the file's header.
+/// See `MapRaw` for details on the `copy_on_write` behavior.
+ImageBuffer MapNpy(const std::string &filename, bool copy_on_write = false);
+
+
+/// Loads a 2D (single-channel) or 3D (HxWxC) NumPy array stored in the
+/// `.npy` format, *i.e.* via `numpy.save`. The array can be of any data
+/// type which is supported by the ImageBuffer. Fortran-order arrays
+/// will be converted to the default row-major layout.
+ImageBuffer LoadNpy(const std::string &filename);
+
+
+/// Saves the ImageBuffer in the `.npy` format, such that it can be
+/// loaded via `numpy.load` or `LoadNpy`. Single-channel buffers are
+/// stored as 2D arrays.
+/// Rows are written directly from the buffer's memory, *i.e.* neither
+/// padded rows nor views (with packed pixels) require a contiguous copy.
+void SaveNpy(const std::string &filename, const ImageBuffer &image);
+
+
 } // namespace viren2d
 
 #endif // __VIREN2D_IMAGEBUFFER_H__
@@ -32,8 +32,8 @@ void SaveOpticalFlow(const std::string &filename, const ImageBuffer &flow);
 /// `Peter Kovesi <https://doi.org/10.48550/arXiv.1509.03700>`__.
 ///
 /// Args:
-///   flow: The optical flow field as 2-channel ImageBuffer of type float
-///     or double.
+///   flow: The optical flow field as 2-channel ImageBuffer of floating
+///     point type, *i.e.* float, double, float16 or bfloat16.
 ///   colormap: Ideally, a cyclic color map.
 ///   motion_normalizer: Used to divide the flow magnitude. Set to the
 ///     maximum motion magnitude to avoid desaturation in regions where the
@@ -0,0 +1,48 @@
+#ifndef __VIREN2D_PARALLEL_H__
+#define __VIREN2D_PARALLEL_H__
+
+
+namespace viren2d {
+
+/// Sets the number of threads which are used to process the pixels
+/// of an image, *e.g.* for color conversion or colorization.
+/// A value <= 0 selects the number of hardware threads (default),
+/// 1 disables parallel processing.
+///
+/// Small images are always processed by the calling thread, because
+/// the synchronization overhead would exceed the gain.
+void SetNumThreads(int num_threads);
+
+
+/// Returns the number of threads which will be used by the calling
+/// thread, *i.e.* a thread-local override (if set, see
+/// `ScopedNumThreads`), or the global setting.
+int GetNumThreads();
+
+
+/// Temporarily overrides the number of threads for the calling thread,
+/// *e.g.* to process an image serially within an application which
+/// already parallelizes across images:
+///
+///   >>> {
+///   >>>   viren2d::ScopedNumThreads scope(1);
+///   >>>   colorized = viren2d::ColorizeScaled(data, ...);
+///   >>> }
+///
+/// The previous thread-local setting will be restored upon
+/// destruction. Scopes can be nested.
+class ScopedNumThreads {
+public:
+  explicit ScopedNumThreads(int num_threads);
+  ~ScopedNumThreads();
+
+  ScopedNumThreads(const ScopedNumThreads &) = delete;
+  ScopedNumThreads &operator=(const ScopedNumThreads &) = delete;
+
+private:
+  int previous_;
+};
+
+}  // namespace viren2d
+
+#endif  // __VIREN2D_PARALLEL_H__
@@ -0,0 +1,10 @@
+#ifndef __VIREN2D_VERSION_H__
+#define __VIREN2D_VERSION_H__
+
+#define VIREN2D_VERSION  "0.35.5"
+#define VIREN2D_VERSION_MAJOR "0"
+#define VIREN2D_VERSION_MINOR "35"
+#define VIREN2D_VERSION_PATCH "5"
+
+#endif  // __VIREN2D_VERSION_H__
+
@@ -1,6 +1,7 @@
 #ifndef __VIREN2D_VIREN2D_H__
 #define __VIREN2D_VIREN2D_H__
 
+#include <viren2d/allocators.h>
 #include <viren2d/colors.h>
 #include <viren2d/colorgradients.h>
 #include <viren2d/colormaps.h>
@@ -8,6 +9,7 @@
 #include <viren2d/drawing.h>
 #include <viren2d/imagebuffer.h>
 #include <viren2d/opticalflow.h>
+#include <viren2d/parallel.h>
 #include <viren2d/primitives.h>
 #include <viren2d/styles.h>
 #include <viren2d/version.h>
@@ -0,0 +1,331 @@
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <utility>
+
+#ifdef _MSC_VER
+#include <malloc.h> // _aligned_malloc
+#endif  // _MSC_VER
+
+#include <viren2d/allocators.h>
+
+#include <helpers/allocators_helpers.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace helpers {
+/// Rounds up the value to the next multiple of the given
+/// alignment, which must be a power of two.
+inline std::size_t AlignUp(std::size_t value, std::size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+
+/// Allocates a memory block, whose base pointer is aligned to
+/// `kImageBufferAlignment`. Returns nullptr if allocation fails.
+unsigned char *AllocateAligned(std::size_t num_bytes) {
+  // `aligned_alloc` requires the size to be a multiple of the alignment
+  const std::size_t size = AlignUp(
+        std::max(num_bytes, static_cast<std::size_t>(1)),
+        kImageBufferAlignment);
+#ifdef _MSC_VER
+  return static_cast<unsigned char*>(
+        _aligned_malloc(size, kImageBufferAlignment));
+#else  // _MSC_VER
+  return static_cast<unsigned char*>(
+        std::aligned_alloc(kImageBufferAlignment, size));
+#endif  // _MSC_VER
+}
+
+
+/// Releases memory which has been allocated via `AllocateAligned`.
+void FreeAligned(unsigned char *ptr) {
+#ifdef _MSC_VER
+  _aligned_free(ptr);
+#else  // _MSC_VER
+  std::free(ptr);
+#endif  // _MSC_VER
+}
+
+
+/// Default allocator which requests each block from the heap.
+class HeapAllocator : public ImageBufferAllocator {
+public:
+  unsigned char *Allocate(std::size_t num_bytes) override {
+    return AllocateAligned(num_bytes);
+  }
+
+  void Deallocate(unsigned char *ptr, std::size_t /* num_bytes */) override {
+    FreeAligned(ptr);
+  }
+};
+
+
+std::shared_ptr<ImageBufferAllocator> &GlobalAllocator() {
+  static std::shared_ptr<ImageBufferAllocator> allocator =
+      DefaultImageBufferAllocator();
+  return allocator;
+}
+
+
+/// Incremented whenever a new global allocator is installed, so that
+/// threads know when to refresh their cached copy.
+std::atomic<uint64_t> &GlobalAllocatorVersion() {
+  static std::atomic<uint64_t> version(0);
+  return version;
+}
+
+
+std::shared_ptr<ImageBufferAllocator> &ThreadLocalAllocator() {
+  thread_local std::shared_ptr<ImageBufferAllocator> allocator;
+  return allocator;
+}
+
+
+const std::shared_ptr<ImageBufferAllocator> &ActiveAllocator() {
+  const std::shared_ptr<ImageBufferAllocator> &local = ThreadLocalAllocator();
+  if (local) {
+    return local;
+  }
+
+  // Each thread caches the global allocator, because `atomic_load`
+  // would copy the shared pointer for every single allocation.
+  thread_local std::shared_ptr<ImageBufferAllocator> global;
+  thread_local uint64_t global_version = 0;
+  const uint64_t version =
+      GlobalAllocatorVersion().load(std::memory_order_acquire);
+  if (!global || (version != global_version)) {
+    global = std::atomic_load(&GlobalAllocator());
+    global_version = version;
+  }
+  return global;
+}
+
+
+/// Number of bytes in front of the pixels of each storage block, which
+/// hold the `shared_ptr` control block (a multiple of the alignment).
+constexpr std::size_t kStorageHeaderBytes = 2 * kImageBufferAlignment;
+
+
+/// Places the control block of the storage `shared_ptr` into the header
+/// of the memory block, see `AllocateStorage`. The whole memory block is
+/// returned to the ImageBufferAllocator once the control block has been
+/// destroyed, *i.e.* after the last (weak) reference has been released.
+template <typename _Tp>
+class StorageHeaderAllocator {
+public:
+  using value_type = _Tp;
+
+  StorageHeaderAllocator(
+      const std::shared_ptr<ImageBufferAllocator> &allocator,
+      unsigned char *block, std::size_t block_bytes) noexcept
+    : allocator_(allocator), block_(block), block_bytes_(block_bytes) {}
+
+
+  template <typename _Up>
+  StorageHeaderAllocator(const StorageHeaderAllocator<_Up> &other) noexcept
+    : allocator_(other.allocator_), block_(other.block_),
+      block_bytes_(other.block_bytes_) {}
+
+
+  _Tp *allocate(std::size_t n) {
+    static_assert(alignof(_Tp) <= kImageBufferAlignment,
+                  "Control block requires a larger alignment!");
+    if (n * sizeof(_Tp) > kStorageHeaderBytes) {
+      throw std::bad_alloc();
+    }
+    return reinterpret_cast<_Tp *>(block_);
+  }
+
+
+  void deallocate(_Tp * /* ptr */, std::size_t /* n */) noexcept {
+    allocator_->Deallocate(block_, block_bytes_);
+  }
+
+
+  template <typename _Up>
+  bool operator==(const StorageHeaderAllocator<_Up> &other) const noexcept {
+    return block_ == other.block_;
+  }
+
+
+  template <typename _Up>
+  bool operator!=(const StorageHeaderAllocator<_Up> &other) const noexcept {
+    return block_ != other.block_;
+  }
+
+private:
+  template <typename _Up> friend class StorageHeaderAllocator;
+
+  std::shared_ptr<ImageBufferAllocator> allocator_;
+  unsigned char *block_;
+  std::size_t block_bytes_;
+};
+
+
+std::shared_ptr<unsigned char> AllocateStorage(int64_t num_bytes) {
+  const std::shared_ptr<ImageBufferAllocator> &allocator = ActiveAllocator();
+  const std::size_t block_bytes =
+      kStorageHeaderBytes + static_cast<std::size_t>(num_bytes);
+  unsigned char *block = allocator->Allocate(block_bytes);
+  if (!block) {
+    return nullptr;
+  }
+
+  std::shared_ptr<unsigned char> header;
+  try {
+    header = std::allocate_shared<unsigned char>(
+          StorageHeaderAllocator<unsigned char>(
+            allocator, block, block_bytes));
+  } catch (const std::bad_alloc &) {
+    SPDLOG_ERROR(
+          "`shared_ptr` control block exceeds the storage header!");
+    allocator->Deallocate(block, block_bytes);
+    return nullptr;
+  }
+  // The storage shares the reference count of the header.
+  return std::shared_ptr<unsigned char>(header, block + kStorageHeaderBytes);
+}
+}  // namespace helpers
+
+
+//---------------------------------------------------- Allocator management
+std::shared_ptr<ImageBufferAllocator> DefaultImageBufferAllocator() {
+  static std::shared_ptr<ImageBufferAllocator> allocator =
+      std::make_shared<helpers::HeapAllocator>();
+  return allocator;
+}
+
+
+void SetImageBufferAllocator(std::shared_ptr<ImageBufferAllocator> allocator) {
+  SPDLOG_DEBUG(
+        "Setting global ImageBuffer allocator{:s}.",
+        (allocator ? "" : " (restoring the default)"));
+  if (!allocator) {
+    allocator = DefaultImageBufferAllocator();
+  }
+  std::atomic_store(&helpers::GlobalAllocator(), std::move(allocator));
+  helpers::GlobalAllocatorVersion().fetch_add(1, std::memory_order_release);
+}
+
+
+std::shared_ptr<ImageBufferAllocator> GetImageBufferAllocator() {
+  return helpers::ActiveAllocator();
+}
+
+
+ScopedImageBufferAllocator::ScopedImageBufferAllocator(
+    std::shared_ptr<ImageBufferAllocator> allocator)
+  : previous_(std::exchange(
+                helpers::ThreadLocalAllocator(), std::move(allocator))) {
+  SPDLOG_TRACE("Entering ScopedImageBufferAllocator.");
+}
+
+
+ScopedImageBufferAllocator::~ScopedImageBufferAllocator() {
+  SPDLOG_TRACE("Leaving ScopedImageBufferAllocator.");
+  helpers::ThreadLocalAllocator() = std::move(previous_);
+}
+
+
+//---------------------------------------------------- Pool allocator
+PoolAllocator::PoolAllocator(std::size_t max_cached_bytes)
+  : max_cached_bytes_(max_cached_bytes) {
+  SPDLOG_DEBUG(
+        "PoolAllocator constructor, caching up to {:d} bytes.",
+        max_cached_bytes);
+}
+
+
+PoolAllocator::~PoolAllocator() {
+  SPDLOG_DEBUG("PoolAllocator destructor.");
+  Clear();
+}
+
+
+std::size_t PoolAllocator::BucketSize(std::size_t num_bytes) {
+  // Small blocks are grouped by cache lines. Larger blocks use 4 size
+  // classes per power of two, i.e. at most 25% of a block is wasted.
+  if (num_bytes <= 4 * static_cast<std::size_t>(kImageBufferAlignment)) {
+    return helpers::AlignUp(
+          std::max(num_bytes, static_cast<std::size_t>(1)),
+          kImageBufferAlignment);
+  }
+
+  std::size_t power = 1;
+  while ((power << 1) < num_bytes) {
+    power <<= 1;
+  }
+  return helpers::AlignUp(num_bytes, power / 4);
+}
+
+
+unsigned char *PoolAllocator::Allocate(std::size_t num_bytes) {
+  const std::size_t bucket = BucketSize(num_bytes);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = buckets_.find(bucket);
+    if ((it != buckets_.end()) && !it->second.empty()) {
+      unsigned char *ptr = it->second.back();
+      it->second.pop_back();
+      ++stats_.hits;
+      --stats_.cached_blocks;
+      stats_.cached_bytes -= bucket;
+      return ptr;
+    }
+    ++stats_.misses;
+  }
+  SPDLOG_TRACE(
+        "PoolAllocator cache miss, allocating {:d} bytes.", bucket);
+  return helpers::AllocateAligned(bucket);
+}
+
+
+void PoolAllocator::Deallocate(unsigned char *ptr, std::size_t num_bytes) {
+  if (!ptr) {
+    return;
+  }
+
+  const std::size_t bucket = BucketSize(num_bytes);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stats_.cached_bytes + bucket <= max_cached_bytes_) {
+      buckets_[bucket].push_back(ptr);
+      ++stats_.cached_blocks;
+      stats_.cached_bytes += bucket;
+      return;
+    }
+  }
+  SPDLOG_TRACE(
+        "PoolAllocator cache is full, releasing {:d} bytes.", bucket);
+  helpers::FreeAligned(ptr);
+}
+
+
+void PoolAllocator::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &bucket : buckets_) {
+    for (unsigned char *ptr : bucket.second) {
+      helpers::FreeAligned(ptr);
+    }
+  }
+  buckets_.clear();
+  stats_.cached_blocks = 0;
+  stats_.cached_bytes = 0;
+}
+
+
+void PoolAllocator::ResetStatistics() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.hits = 0;
+  stats_.misses = 0;
+}
+
+
+PoolAllocatorStatistics PoolAllocator::Statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+}  // namespace viren2d
@@ -1,3 +1,5 @@
+#include <string>
+
 #include <pybind11/pybind11.h>
 
 #include <viren2d/viren2d.h>
@@ -91,6 +93,27 @@ PYBIND11_MODULE(viren2d_PYMODULE_NAME, m) {
   //------------------------------------------------- Visualization - Optical Flow
   viren2d::bindings::RegisterOpticalFlowUtils(m);
 
+  //------------------------------------------------- Parallelization
+  std::string docstr = R"docstr(
+      Sets the number of threads used for pixel-wise processing.
+
+      Applies to the :class:`~viren2d.ImageBuffer` conversions,
+      colorization and optical flow visualization. Small images are
+      always processed serially. A value ``<= 0`` selects the number
+      of hardware threads (default), ``1`` disables parallelization.
+
+      **Corresponding C++ API:** ``viren2d::SetNumThreads``.
+      )docstr";
+  m.def("set_num_threads", &viren2d::SetNumThreads,
+        docstr.c_str(), pybind11::arg("num_threads"));
+
+  docstr = R"docstr(
+      Returns the number of threads used for pixel-wise processing.
+
+      **Corresponding C++ API:** ``viren2d::GetNumThreads``.
+      )docstr";
+  m.def("get_num_threads", &viren2d::GetNumThreads, docstr.c_str());
+
 //  //TODO(snototter) copy python documentation to cpp
 
 //  //------------------------------------------------- Logging
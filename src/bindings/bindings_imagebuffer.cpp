@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <sstream>
 #include <stdexcept>
 #include <cstdlib>
@@ -6,8 +7,10 @@
 
 #include <pybind11/operators.h>
 #include <pybind11/numpy.h>
+#include <pybind11/stl.h>
 
 #include <bindings/binding_helpers.h>
+#include <helpers/imagebuffer_access.h>
 #include <helpers/logging.h>
 #include <viren2d/imagebuffer.h>
 
@@ -44,6 +47,12 @@ inline ImageBufferType ImageBufferTypeFromPyArray(const py::array &arr) {
     return ImageBufferType::Float;
   } else if (py::isinstance<py::array_t<double>>(arr)) {
     return ImageBufferType::Double;
+  } else if ((arr.dtype().kind() == 'f') && (arr.itemsize() == 2)) {
+    // pybind11 has no C++ type for numpy.float16
+    return ImageBufferType::Float16;
+  } else if (py::cast<std::string>(arr.dtype().attr("name")) == "bfloat16") {
+    // Provided by the ml_dtypes package, e.g. for JAX/TensorFlow outputs
+    return ImageBufferType::BFloat16;
   } else {
     const py::dtype dtype = arr.dtype();
     std::string s("Incompatible `dtype` (");
@@ -67,6 +76,37 @@ inline ImageBufferType ImageBufferTypeFromPyArray(const py::array &arr) {
 }
 
 
+/// Releases a reference which was held by a `PyObjectHandle`. Invoked
+/// by the interpreter via `Py_AddPendingCall`, i.e. with the GIL held.
+int DecRefPyObject(void *ptr) {
+  Py_DECREF(static_cast<PyObject *>(ptr));
+  return 0;
+}
+
+
+/// Returns a handle which keeps the python object alive while an
+/// ImageBuffer (or any of its copies & views) references its memory.
+/// The last reference might be dropped by a C++ worker thread. Acquiring
+/// the GIL there could deadlock, e.g. if a python thread holds the GIL
+/// while it waits for this worker. Thus, threads without the GIL defer
+/// the decref to the interpreter's main thread instead.
+std::shared_ptr<void> PyObjectHandle(const py::object &obj) {
+  return std::shared_ptr<void>(
+        obj.inc_ref().ptr(), [](void *ptr) {
+    if (PyGILState_Check()) {
+      DecRefPyObject(ptr);
+    } else if (Py_IsInitialized()
+               && (Py_AddPendingCall(DecRefPyObject, ptr) != 0)) {
+      // The pending call queue is full. Leaking the object is
+      // preferable over risking a deadlock.
+      SPDLOG_WARN(
+            "Cannot schedule the release of a python object which "
+            "was shared with an ImageBuffer, its memory will be leaked.");
+    }
+  });
+}
+
+
 ImageBuffer CreateImageBuffer(
     py::array &buf, bool copy, bool disable_warnings) {
   // Sanity checks
@@ -93,9 +133,10 @@ ImageBuffer CreateImageBuffer(
 
 
   ImageBuffer img;
-  const int row_stride = static_cast<int>(buf.strides(0));
-  const int col_stride = static_cast<int>(buf.strides(1));
-  const int channel_stride = (buf.ndim() == 2) ? 1 : static_cast<int>(buf.strides(2));
+  const int64_t row_stride = static_cast<int64_t>(buf.strides(0));
+  const int64_t col_stride = static_cast<int64_t>(buf.strides(1));
+  const int64_t channel_stride = (buf.ndim() == 2)
+      ? 1 : static_cast<int64_t>(buf.strides(2));
   const int height = static_cast<int>(buf.shape(0));
   const int width = static_cast<int>(buf.shape(1));
   const int channels = (buf.ndim() == 2) ? 1 : static_cast<int>(buf.shape(2));
@@ -153,19 +194,143 @@ ImageBuffer CreateImageBuffer(
     } else {
       img.CreateSharedBuffer(
             static_cast<unsigned char*>(buf.mutable_data()),
-            height, width, channels, row_stride, col_stride, buffer_type);
+            height, width, channels, row_stride, col_stride, channel_stride,
+            buffer_type, PyObjectHandle(buf));
     }
   }
   return img;
 }
 
 
+/// Creates an ImageBuffer from an array of the given layout. Planar
+/// (C x H x W) arrays, *e.g.* the outputs of neural networks, are shared
+/// without copying whenever possible.
+ImageBuffer CreateImageBufferWithLayout(
+    py::array &buf, bool copy, bool disable_warnings, ImageLayout layout) {
+  if ((layout == ImageLayout::Interleaved) || (buf.ndim() == 2)) {
+    return CreateImageBuffer(buf, copy, disable_warnings);
+  }
+
+  if (buf.ndim() != 3) {
+    std::ostringstream s;
+    s << "Incompatible buffer dimensions - expected a planar (C x H x W) "
+         "array with `ndim` 3, but got: " << buf.ndim() << '!';
+    SPDLOG_ERROR(s.str());
+    throw std::invalid_argument(s.str());
+  }
+
+  const ImageBufferType buffer_type = ImageBufferTypeFromPyArray(buf);
+
+  if (ElementSizeFromImageBufferType(buffer_type) != static_cast<int>(buf.itemsize())) {
+    std::ostringstream s;
+    s << "ImageBuffer `" << ImageBufferTypeToString(buffer_type)
+      << "` expected item size " << ElementSizeFromImageBufferType(buffer_type)
+      << " bytes, but python buffer info states " << buf.itemsize() << "!";
+    SPDLOG_ERROR(s.str());
+    throw std::logic_error(s.str());
+  }
+
+  const int channels = static_cast<int>(buf.shape(0));
+  const int height = static_cast<int>(buf.shape(1));
+  const int width = static_cast<int>(buf.shape(2));
+  const int64_t channel_stride = static_cast<int64_t>(buf.strides(0));
+  const int64_t row_stride = static_cast<int64_t>(buf.strides(1));
+  const int64_t pixel_stride = static_cast<int64_t>(buf.strides(2));
+
+  // ImageBuffers support arbitrary strides, but (same as for interleaved
+  // arrays) sharing requires a mutable array without negative strides.
+  const bool can_share = buf.writeable() && (channel_stride > 0)
+      && (row_stride > 0) && (pixel_stride > 0);
+  if (!copy && !can_share && !disable_warnings) {
+    SPDLOG_WARN(
+          "Input python array is not writeable or has negative strides. The "
+          "`viren2d.ImageBuffer` will be created as a copy, which ignores "
+          "the input parameter `copy=False`.");
+  }
+
+  ImageBuffer img;
+  if (copy || !can_share) {
+    img.CreateCopiedBuffer(
+          static_cast<unsigned char const*>(buf.data()),
+          height, width, channels,
+          row_stride, pixel_stride, channel_stride, buffer_type);
+  } else {
+    img.CreateSharedBuffer(
+          static_cast<unsigned char*>(buf.mutable_data()),
+          height, width, channels,
+          row_stride, pixel_stride, channel_stride, buffer_type,
+          PyObjectHandle(buf));
+  }
+  return img;
+}
+
+
+/// Creates an ImageBatch from an N x H x W (single-channel), NHWC or NCHW
+/// array. The array is shared if possible and `copy` is false.
+ImageBatch CreateImageBatch(py::array &buf, ImageLayout layout, bool copy) {
+  if (buf.ndim() < 3 || buf.ndim() > 4) {
+    std::ostringstream s;
+    s << "Incompatible buffer dimensions - "
+         "expected `ndim` to be 3 or 4, but got: "
+      << buf.ndim() << '!';
+    SPDLOG_ERROR(s.str());
+    throw std::invalid_argument(s.str());
+  }
+
+  const ImageBufferType buffer_type = ImageBufferTypeFromPyArray(buf);
+
+  if (ElementSizeFromImageBufferType(buffer_type) != static_cast<int>(buf.itemsize())) {
+    std::ostringstream s;
+    s << "ImageBuffer `" << ImageBufferTypeToString(buffer_type)
+      << "` expected item size " << ElementSizeFromImageBufferType(buffer_type)
+      << " bytes, but python buffer info states " << buf.itemsize() << "!";
+    SPDLOG_ERROR(s.str());
+    throw std::logic_error(s.str());
+  }
+
+  const bool planar = (layout == ImageLayout::Planar) && (buf.ndim() == 4);
+  const int num_frames = static_cast<int>(buf.shape(0));
+  const int channels = (buf.ndim() == 3)
+      ? 1 : static_cast<int>(buf.shape(planar ? 1 : 3));
+  const int height = static_cast<int>(buf.shape(planar ? 2 : 1));
+  const int width = static_cast<int>(buf.shape(planar ? 3 : 2));
+  const int64_t frame_stride = static_cast<int64_t>(buf.strides(0));
+  const int64_t row_stride = static_cast<int64_t>(buf.strides(planar ? 2 : 1));
+  const int64_t pixel_stride = static_cast<int64_t>(buf.strides(planar ? 3 : 2));
+  const int64_t channel_stride = (buf.ndim() == 3)
+      ? static_cast<int64_t>(buf.itemsize())
+      : static_cast<int64_t>(buf.strides(planar ? 1 : 3));
+
+  ImageBatch batch;
+  if (!copy && buf.writeable() && (frame_stride > 0) && (row_stride > 0)
+      && (pixel_stride > 0) && (channel_stride > 0)) {
+    batch.CreateSharedBatch(
+          static_cast<unsigned char *>(buf.mutable_data()), num_frames,
+          height, width, channels, frame_stride, row_stride, pixel_stride,
+          channel_stride, buffer_type);
+    return batch;
+  }
+
+  // The freshly allocated batch is dense, i.e. it matches the memory
+  // layout of a C-style array of the same shape.
+  const py::array dense = py::array::ensure(buf, py::array::c_style);
+  batch = ImageBatch(
+        num_frames, height, width, channels, buffer_type,
+        planar ? ImageLayout::Planar : ImageLayout::Interleaved);
+  std::memcpy(
+        batch.Frame(0).MutableData(), dense.data(),
+        static_cast<std::size_t>(dense.nbytes()));
+  return batch;
+}
+
+
 //FIXME if input is contiguous, use memcpy!
 template<typename _T>
 ImageBuffer ConvertBufferToUInt8C4Helper(const py::array &buf, _T scale) {
-  const int row_stride = static_cast<int>(buf.strides(0));
-  const int col_stride = static_cast<int>(buf.strides(1));
-  const int channel_stride = (buf.ndim() == 2) ? 1 : static_cast<int>(buf.strides(2));
+  const int64_t row_stride = static_cast<int64_t>(buf.strides(0));
+  const int64_t col_stride = static_cast<int64_t>(buf.strides(1));
+  const int64_t channel_stride = (buf.ndim() == 2)
+      ? 1 : static_cast<int64_t>(buf.strides(2));
   const int height = static_cast<int>(buf.shape(0));
   const int width = static_cast<int>(buf.shape(1));
   const int channels = (buf.ndim() == 2) ? 1 : static_cast<int>(buf.shape(2));
@@ -176,18 +341,22 @@ ImageBuffer ConvertBufferToUInt8C4Helper(const py::array &buf, _T scale) {
 
   // Copy pixel by pixel because the input buffer might be a sliced,
   // transposed, or any other view (e.g. with negative strides)
-  for (int row = 0, src_row_offset = 0;
+  const viren2d::helpers::PixelWriter out(img8u4);
+  int64_t src_row_offset = 0;
+  for (int row = 0;
        row < height;
        ++row, src_row_offset += row_stride) {
     // The destination buffer is freshly allocated, thus the memory
     // is aligned.
-    uint8_t *dst_ptr = img8u4.MutablePtr<uint8_t>(row, 0, 0);
+    uint8_t *dst_ptr = out.Row<uint8_t>(row);
 
-    for (int col = 0, src_col_offset = 0;
+    int64_t src_col_offset = 0;
+    for (int col = 0;
          col < width;
          ++col, src_col_offset += col_stride) {
 
-      for (int ch = 0, src_channel_offset = 0;
+      int64_t src_channel_offset = 0;
+      for (int ch = 0;
            ch < 4;
            ++ch, src_channel_offset += channel_stride) {
         if (ch < channels) {
@@ -200,7 +369,7 @@ ImageBuffer ConvertBufferToUInt8C4Helper(const py::array &buf, _T scale) {
           if (ch == 3) {
             *dst_ptr = 255;
           } else {
-            *dst_ptr = img8u4.AtUnchecked<uint8_t>(row, col, 0);
+            *dst_ptr = out.At<uint8_t>(row, col, 0);
           }
         }
         ++dst_ptr;
@@ -275,6 +444,12 @@ ImageBuffer CastToImageBufferUInt8C4(py::array buf) {
 
     case ImageBufferType::Double:
       return ConvertBufferToUInt8C4Helper<double>(buf, 255);
+
+    case ImageBufferType::Float16:
+      return ConvertBufferToUInt8C4Helper<float16_t>(buf, float16_t(255.0f));
+
+    case ImageBufferType::BFloat16:
+      return ConvertBufferToUInt8C4Helper<bfloat16_t>(buf, bfloat16_t(255.0f));
   }
 
   std::string s("Conversion from python array of type `");
@@ -313,6 +488,15 @@ inline std::string FormatDescriptor(ImageBufferType t) {
 
     case ImageBufferType::Double:
       return py::format_descriptor<double>::format();
+
+    case ImageBufferType::Float16:
+      // Struct-style code of IEEE 754 half precision (numpy.float16)
+      return "e";
+
+    case ImageBufferType::BFloat16:
+      // NumPy has no bfloat16 dtype, so the raw bits are exposed as
+      // uint16. Use `.view(ml_dtypes.bfloat16)` to reinterpret them.
+      return py::format_descriptor<uint16_t>::format();
   }
 
   std::string s("ImageBufferType `");
@@ -324,20 +508,48 @@ inline std::string FormatDescriptor(ImageBufferType t) {
 
 
 py::buffer_info ImageBufferInfo(ImageBuffer &img) {
+  // Read-only views are exposed as non-writeable arrays. Otherwise,
+  // copy-on-write storage must be detached before numpy can modify it.
+  unsigned char *data = img.IsReadOnly()
+      ? const_cast<unsigned char *>(img.ImmutableData())
+      : img.MutableData();
   return py::buffer_info(
-      img.MutableData(),
-      static_cast<std::size_t>(
+      data,
+      static_cast<py::ssize_t>(
           (img.ElementSize() > 0)
           ? img.ElementSize()
           : ElementSizeFromImageBufferType(img.BufferType())), // Size of each element
       FormatDescriptor(img.BufferType()), // Python struct-style format descriptor
       3,  //Always return ndim=3 (by design)
-      { static_cast<std::size_t>(img.Height()),
-        static_cast<std::size_t>(img.Width()),
-        static_cast<std::size_t>(img.Channels()) }, // Buffer dimensions
-      { static_cast<std::size_t>(img.RowStride()),
-        static_cast<std::size_t>(img.PixelStride()),
-        static_cast<std::size_t>(img.ElementSize()) } // Strides (in bytes) per dimension
+      { static_cast<py::ssize_t>(img.Height()),
+        static_cast<py::ssize_t>(img.Width()),
+        static_cast<py::ssize_t>(img.Channels()) }, // Buffer dimensions
+      { static_cast<py::ssize_t>(img.RowStride()),
+        static_cast<py::ssize_t>(img.PixelStride()),
+        static_cast<py::ssize_t>(img.ChannelStride()) }, // Strides (in bytes) per dimension, may be negative for views
+      img.IsReadOnly()
+  );
+}
+
+
+py::buffer_info ImageBatchInfo(ImageBatch &batch) {
+  // The frames share the batch memory, so the first one provides
+  // the strides of all frames.
+  ImageBuffer first = batch.Frame(0);
+  return py::buffer_info(
+      first.MutableData(),
+      static_cast<py::ssize_t>(first.ElementSize()),
+      FormatDescriptor(batch.BufferType()),
+      4,  // Always N x H x W x C, planar batches have a larger channel stride
+      { static_cast<py::ssize_t>(batch.NumFrames()),
+        static_cast<py::ssize_t>(batch.Height()),
+        static_cast<py::ssize_t>(batch.Width()),
+        static_cast<py::ssize_t>(batch.Channels()) },
+      { static_cast<py::ssize_t>(batch.FrameStride()),
+        static_cast<py::ssize_t>(first.RowStride()),
+        static_cast<py::ssize_t>(first.PixelStride()),
+        static_cast<py::ssize_t>(first.ChannelStride()) },
+      false
   );
 }
 
@@ -357,13 +569,429 @@ ImageBuffer LoadImageUInt8Helper(
 }
 
 
+/// Returns the ImageBufferType for the given numpy dtype
+/// (or anything which can be converted to a dtype, such as
+/// `numpy.uint8` or `'float32'`).
+inline ImageBufferType ImageBufferTypeFromDType(const py::object &dtype) {
+  const py::array empty(
+        py::dtype::from_args(dtype), std::vector<py::ssize_t>{0});
+  return ImageBufferTypeFromPyArray(empty);
+}
+
+
+/// Returns a single scalar as a list of one value, or the
+/// values of the given sequence.
+inline std::vector<double> DoublesFromPyObject(const py::object &obj) {
+  if (py::isinstance<py::float_>(obj) || py::isinstance<py::int_>(obj)) {
+    return {obj.cast<double>()};
+  }
+  return obj.cast<std::vector<double>>();
+}
+
+
 void SaveImageUInt8Helper(
     const py::object &path, const ImageBuffer &image) {
   SaveImageUInt8(PathStringFromPyObject(path), image);
 }
 
 
+ImageBuffer MapRawHelper(
+    const py::object &path, int height, int width, int channels,
+    const py::object &dtype, int64_t offset, bool copy_on_write) {
+  return MapRaw(
+        PathStringFromPyObject(path), height, width, channels,
+        ImageBufferTypeFromDType(dtype), offset, copy_on_write);
+}
+
+
+ImageBuffer MapNpyHelper(const py::object &path, bool copy_on_write) {
+  return MapNpy(PathStringFromPyObject(path), copy_on_write);
+}
+
+
+ImageBuffer LoadNpyHelper(const py::object &path) {
+  return LoadNpy(PathStringFromPyObject(path));
+}
+
+
+void SaveNpyHelper(const py::object &path, const ImageBuffer &image) {
+  SaveNpy(PathStringFromPyObject(path), image);
+}
+
+
+/// Shape and type of a transformation's result. This allows us to check a
+/// numpy.ndarray `out` before computing anything, see `TransformInto`.
+struct ResultSpec {
+  int height;
+  int width;
+  int channels;
+  ImageBufferType type;
+
+  /// Returns the spec of a result with the same size and type as `buf`.
+  /// The number of channels is taken from `buf` unless specified.
+  static ResultSpec Like(const ImageBuffer &buf, int channels = -1) {
+    return ResultSpec{
+      buf.Height(), buf.Width(),
+      (channels > 0) ? channels : buf.Channels(), buf.BufferType()};
+  }
+
+
+  /// Returns the spec of a result with the same size as `buf`, but of
+  /// the given type and number of channels.
+  static ResultSpec Like(
+      const ImageBuffer &buf, int channels, ImageBufferType type) {
+    return ResultSpec{buf.Height(), buf.Width(), channels, type};
+  }
+
+  std::string ToString() const {
+    std::ostringstream s;
+    s << height << 'x' << width << 'x' << channels
+      << ' ' << ImageBufferTypeToString(type);
+    return s.str();
+  }
+};
+
+
+/// Invokes a transformation which writes into a destination buffer, *i.e.*
+/// it implements the optional `out` argument of the python API:
+/// * `None`: A new ImageBuffer will be returned.
+/// * ImageBuffer: Its memory will be reused if the shape and type match.
+///   Otherwise, it will be reallocated.
+/// * numpy.ndarray: Must be writeable, row-major and match the `result`
+///   spec, because we cannot reallocate the caller's array. This is
+///   checked before the transformation, which then writes directly into
+///   the array's memory.
+template <typename _Transform>
+py::object TransformInto(
+    const py::object &out, const ResultSpec &result, _Transform transform) {
+  if (out.is_none()) {
+    ImageBuffer dst;
+    transform(&dst);
+    return py::cast(std::move(dst));
+  }
+
+  if (py::isinstance<ImageBuffer>(out)) {
+    transform(out.cast<ImageBuffer *>());
+    return out;
+  }
+
+  if (py::isinstance<py::array>(out)) {
+    py::array arr = out.cast<py::array>();
+    ImageBuffer dst = CreateImageBuffer(arr, false, true);
+    if (dst.OwnsData()) {
+      const std::string msg(
+            "Parameter `out` must be a writeable, row-major (C-contiguous) "
+            "numpy.ndarray!");
+      SPDLOG_ERROR(msg);
+      throw std::invalid_argument(msg);
+    }
+
+    if ((dst.Height() != result.height) || (dst.Width() != result.width)
+        || (dst.Channels() != result.channels)
+        || (dst.BufferType() != result.type)) {
+      std::string msg(
+            "Shape or dtype of parameter `out` does not match the result, "
+            "which is ");
+      msg += result.ToString();
+      msg += ", but got ";
+      msg += dst.ToString();
+      msg += '!';
+      SPDLOG_ERROR(msg);
+      throw std::invalid_argument(msg);
+    }
+
+    const unsigned char *ptr = dst.ImmutableData();
+    transform(&dst);
+    if (dst.ImmutableData() != ptr) {
+      std::string msg(
+            "Transformation reallocated the memory of parameter `out`, "
+            "expected result ");
+      msg += result.ToString();
+      msg += ", got ";
+      msg += dst.ToString();
+      msg += '!';
+      SPDLOG_ERROR(msg);
+      throw std::logic_error(msg);
+    }
+    return out;
+  }
+
+  std::string msg(
+        "Parameter `out` must be None, a viren2d.ImageBuffer or a "
+        "numpy.ndarray, but got ");
+  msg += py::str(out.get_type()).cast<std::string>();
+  msg += '!';
+  SPDLOG_ERROR(msg);
+  throw std::invalid_argument(msg);
+}
+
+
+/// Returns the docstring of the optional `out` parameter, which is shared
+/// by all functions that are implemented via `TransformInto`. It is
+/// indented to be placed within the `Args:` section.
+std::string DocstringOutParameter() {
+  return R"docstr(
+          out: Optional destination as :class:`~viren2d.ImageBuffer` or
+            :class:`numpy.ndarray`. If its shape and type match the result,
+            its memory will be reused and ``out`` will be returned. Otherwise,
+            the :class:`~viren2d.ImageBuffer` will be reallocated, whereas a
+            :class:`numpy.ndarray` raises a :class:`ValueError` (before
+            anything is computed).)docstr";
+}
+
+
+Interpolation InterpolationFromPyObject(const py::object &o) {
+  if (py::isinstance<py::str>(o)) {
+    return InterpolationFromString(py::cast<std::string>(o));
+  } else if (py::isinstance<Interpolation>(o)) {
+    return py::cast<Interpolation>(o);
+  } else {
+    const std::string tp = py::cast<std::string>(
+        o.attr("__class__").attr("__name__"));
+    std::ostringstream str;
+    str << "Cannot cast type `" << tp
+        << "` to `viren2d.Interpolation`!";
+    throw std::invalid_argument(str.str());
+  }
+}
+
+
+void RegisterInterpolation(py::module &m) {
+  py::enum_<Interpolation> interp(m, "Interpolation", R"docstr(
+        Enumeration specifying how to resample an image.
+
+        Explicit instantiation:
+          >>> mode = viren2d.Interpolation.Area
+
+        Implicit conversion:
+          >>> small = img.resize(320, 240, 'area')
+
+        **Corresponding C++ API:** ``viren2d::Interpolation``.
+        )docstr");
+  interp.value(
+        "Nearest",
+        Interpolation::Nearest, R"docstr(
+        Nearest neighbor, *i.e.* copies the closest source pixel.
+        )docstr")
+      .value(
+        "Bilinear",
+        Interpolation::Bilinear, R"docstr(
+        Bilinear interpolation of the 2x2 closest source pixels.
+        )docstr")
+      .value(
+        "Area",
+        Interpolation::Area, R"docstr(
+        Averages all covered source pixels (box filter). Recommended
+        for downscaling, falls back to bilinear interpolation for
+        upscaling.
+        )docstr");
+
+  interp.def(
+        "__str__", [](Interpolation i) -> py::str {
+            return py::str(InterpolationToString(i));
+        }, py::name("__str__"), py::is_method(m));
+
+  interp.def(
+        "__repr__", [](Interpolation i) -> py::str {
+            std::ostringstream s;
+            s << "<Interpolation." << InterpolationToString(i) << '>';
+            return py::str(s.str());
+        }, py::name("__repr__"), py::is_method(m));
+
+  interp.def(py::init<>(&InterpolationFromPyObject),
+        "Custom constructor to support implicit conversion from a :class:`str`.",
+        py::arg("obj"));
+
+  py::implicitly_convertible<py::str, Interpolation>();
+}
+
+
+BlurKind BlurKindFromPyObject(const py::object &o) {
+  if (py::isinstance<py::str>(o)) {
+    return BlurKindFromString(py::cast<std::string>(o));
+  } else if (py::isinstance<BlurKind>(o)) {
+    return py::cast<BlurKind>(o);
+  } else {
+    const std::string tp = py::cast<std::string>(
+        o.attr("__class__").attr("__name__"));
+    std::ostringstream str;
+    str << "Cannot cast type `" << tp
+        << "` to `viren2d.BlurKind`!";
+    throw std::invalid_argument(str.str());
+  }
+}
+
+
+void RegisterBlurKind(py::module &m) {
+  py::enum_<BlurKind> kind(m, "BlurKind", R"docstr(
+        Enumeration specifying the filter of :meth:`~viren2d.ImageBuffer.blur`.
+
+        Explicit instantiation:
+          >>> kind = viren2d.BlurKind.Box
+
+        Implicit conversion:
+          >>> img.blur([(100, 80, 40, 60)], radius=15, kind='box')
+
+        **Corresponding C++ API:** ``viren2d::BlurKind``.
+        )docstr");
+  kind.value(
+        "Box",
+        BlurKind::Box, R"docstr(
+        Running-sum box filter, *i.e.* the average of all pixels
+        within the filter window.
+        )docstr")
+      .value(
+        "Gaussian",
+        BlurKind::Gaussian, R"docstr(
+        Gaussian filter, approximated by three iterated box filters.
+        )docstr");
+
+  kind.def(
+        "__str__", [](BlurKind k) -> py::str {
+            return py::str(BlurKindToString(k));
+        }, py::name("__str__"), py::is_method(m));
+
+  kind.def(
+        "__repr__", [](BlurKind k) -> py::str {
+            std::ostringstream s;
+            s << "<BlurKind." << BlurKindToString(k) << '>';
+            return py::str(s.str());
+        }, py::name("__repr__"), py::is_method(m));
+
+  kind.def(py::init<>(&BlurKindFromPyObject),
+        "Custom constructor to support implicit conversion from a :class:`str`.",
+        py::arg("obj"));
+
+  py::implicitly_convertible<py::str, BlurKind>();
+}
+
+
+ImageLayout ImageLayoutFromPyObject(const py::object &o) {
+  if (py::isinstance<py::str>(o)) {
+    return ImageLayoutFromString(py::cast<std::string>(o));
+  } else if (py::isinstance<ImageLayout>(o)) {
+    return py::cast<ImageLayout>(o);
+  } else {
+    const std::string tp = py::cast<std::string>(
+        o.attr("__class__").attr("__name__"));
+    std::ostringstream str;
+    str << "Cannot cast type `" << tp
+        << "` to `viren2d.ImageLayout`!";
+    throw std::invalid_argument(str.str());
+  }
+}
+
+
+void RegisterImageLayout(py::module &m) {
+  py::enum_<ImageLayout> layout(m, "ImageLayout", R"docstr(
+        Enumeration specifying the memory layout of multi-channel images.
+
+        Explicit instantiation:
+          >>> layout = viren2d.ImageLayout.Planar
+
+        Implicit conversion:
+          >>> img = viren2d.ImageBuffer(chw_array, layout='chw')
+
+        **Corresponding C++ API:** ``viren2d::ImageLayout``.
+        )docstr");
+  layout.value(
+        "Interleaved",
+        ImageLayout::Interleaved, R"docstr(
+        Channels of a pixel are stored next to each other, *i.e.* an
+        ``H x W x C`` (or ``N x H x W x C``) array. Can also be
+        specified as ``'hwc'`` or ``'nhwc'``.
+        )docstr")
+      .value(
+        "Planar",
+        ImageLayout::Planar, R"docstr(
+        Each channel is stored as a separate plane, *i.e.* a
+        ``C x H x W`` (or ``N x C x H x W``) array, as commonly used by
+        neural networks. Can also be specified as ``'chw'`` or ``'nchw'``.
+        )docstr");
+
+  layout.def(
+        "__str__", [](ImageLayout l) -> py::str {
+            return py::str(ImageLayoutToString(l));
+        }, py::name("__str__"), py::is_method(m));
+
+  layout.def(
+        "__repr__", [](ImageLayout l) -> py::str {
+            std::ostringstream s;
+            s << "<ImageLayout." << ImageLayoutToString(l) << '>';
+            return py::str(s.str());
+        }, py::name("__repr__"), py::is_method(m));
+
+  layout.def(py::init<>(&ImageLayoutFromPyObject),
+        "Custom constructor to support implicit conversion from a :class:`str`.",
+        py::arg("obj"));
+
+  py::implicitly_convertible<py::str, ImageLayout>();
+}
+
+
 void RegisterImageBuffer(py::module &m) {
+  RegisterInterpolation(m);
+  RegisterBlurKind(m);
+  RegisterImageLayout(m);
+
+  py::class_<ChannelStatistics>(m, "ChannelStatistics", R"docstr(
+      Statistics of a single image channel.
+
+      See :meth:`~viren2d.ImageBuffer.statistics`.
+
+      **Corresponding C++ API:** ``viren2d::ChannelStatistics``.
+      )docstr")
+      .def(
+        "__repr__",
+        [](const ChannelStatistics &s)
+        { return "<" + s.ToString() + ">"; })
+      .def("__str__", &ChannelStatistics::ToString)
+      .def_readonly(
+        "min", &ChannelStatistics::min,
+        "float: Minimum value, ``nan`` if there are no valid values.")
+      .def_readonly(
+        "max", &ChannelStatistics::max,
+        "float: Maximum value, ``nan`` if there are no valid values.")
+      .def_readonly(
+        "min_location", &ChannelStatistics::min_location,
+        ":class:`~viren2d.Vec2i`: Position of the first minimum.")
+      .def_readonly(
+        "max_location", &ChannelStatistics::max_location,
+        ":class:`~viren2d.Vec2i`: Position of the first maximum.")
+      .def_readonly(
+        "mean", &ChannelStatistics::mean,
+        "float: Mean of the valid values.")
+      .def_readonly(
+        "variance", &ChannelStatistics::variance,
+        "float: Population variance of the valid values.")
+      .def_property_readonly(
+        "std", &ChannelStatistics::StdDev,
+        "float: Standard deviation of the valid values.")
+      .def_readonly(
+        "num_valid", &ChannelStatistics::num_valid,
+        "int: Number of valid (*i.e.* not ``nan``) values.")
+      .def_readonly(
+        "num_nan", &ChannelStatistics::num_nan,
+        "int: Number of ``nan`` values.")
+      .def_readonly(
+        "histogram", &ChannelStatistics::histogram,
+        "list: Number of values per histogram bin (empty if not requested).");
+
+
+  // Methods are added after the ImageBuffer has been registered, so that
+  // the signatures in the generated documentation are resolved properly.
+  py::class_<PackedMask> packed_mask(m, "PackedMask", R"docstr(
+      A binary mask which stores 1 bit per pixel.
+
+      Packed masks are returned by :func:`~viren2d.mask_color_range_packed`
+      and can be consumed by :meth:`~viren2d.ImageBuffer.blend_packed_mask`
+      and :meth:`~viren2d.Painter.draw_mask`. Compared to a
+      :class:`numpy.uint8` mask, they need only an eighth of the memory.
+
+      **Corresponding C++ API:** ``viren2d::PackedMask``.
+      )docstr");
+
+
   py::class_<ImageBuffer> imgbuf(m, "ImageBuffer", py::buffer_protocol(), R"docstr(
         Encapsulates image data.
 
@@ -405,7 +1033,7 @@ void RegisterImageBuffer(py::module &m) {
         )docstr");
 
   imgbuf.def(
-        py::init(&CreateImageBuffer), R"docstr(
+        py::init(&CreateImageBufferWithLayout), R"docstr(
         Creates an *ImageBuffer* from a :class:`numpy.ndarray`.
 
         Note:
@@ -417,16 +1045,25 @@ void RegisterImageBuffer(py::module &m) {
           If this overrides the ``copy`` parameter, a warning message
           will be logged, unless you set ``disable_warnings`` explicitly.
 
+          A shared *ImageBuffer* keeps the ``array`` alive, *i.e.* it
+          remains valid even after all python references to the array
+          have been deleted.
+
         Args:
           array: The :class:`numpy.ndarray` holding the image data.
           copy: If ``True``, the :class:`~viren2d.ImageBuffer` will
             make a deep copy of the given ``array``.
           disable_warnings: If ``True``, warnings about overriding the
             ``copy`` parameter will be silenced.
+          layout: The :class:`~viren2d.ImageLayout` of a 3-dimensional
+            ``array``. A planar ``C x H x W`` array (*e.g.* the output of
+            a neural network) will be shared without transposing it.
+            Copies are always interleaved.
         )docstr",
         py::arg("array"),
         py::arg("copy") = false,
-        py::arg("disable_warnings") = false)
+        py::arg("disable_warnings") = false,
+        py::arg("layout") = ImageLayout::Interleaved)
       .def_buffer(&ImageBufferInfo)
       .def(
         "copy",
@@ -460,6 +1097,63 @@ void RegisterImageBuffer(py::module &m) {
            >>> roi = painter.canvas.roi(left=10, top=50, width=100, height=200)
         )docstr",
         py::arg("left"), py::arg("top"), py::arg("width"), py::arg("height"))
+      .def(
+        "roi_view",
+        &ImageBuffer::ROIView, R"docstr(
+        Returns a read-only view onto the given region of interest.
+
+        In contrast to :meth:`roi`, the pixels are neither copied nor
+        can they be modified via the view. Thus, it can be passed to
+        any function which only reads its input, such as
+        :meth:`statistics` or :func:`~viren2d.colorize_scaled`.
+
+        **Corresponding C++ API:** ``viren2d::ImageBuffer::ROIView``.
+
+        Args:
+           left: Position of the ROI's left edge as :class:`int`.
+           top: Position of the ROI's top edge as :class:`int`.
+           width: Width of the ROI as :class:`int`.
+           height: Height of the ROI as :class:`int`.
+        )docstr",
+        py::arg("left"), py::arg("top"), py::arg("width"), py::arg("height"),
+        py::keep_alive<0, 1>())
+      .def(
+        "channel_view",
+        &ImageBuffer::ChannelView, R"docstr(
+        Returns a read-only view onto a subset of the channels.
+
+        Selects ``num_channels`` channels, starting at ``first_channel``
+        and advancing by ``step``. No pixels will be copied.
+
+        **Corresponding C++ API:** ``viren2d::ImageBuffer::ChannelView``.
+
+        Args:
+          first_channel: The 0-based index of the first channel as
+            :class:`int`.
+          num_channels: Number of channels as :class:`int`.
+          step: Index increment between the selected channels as
+            :class:`int`, may be negative.
+
+        Example:
+          >>> alpha = rgba.channel_view(3)
+          >>> bgr = rgba.channel_view(2, 3, -1)
+        )docstr",
+        py::arg("first_channel"), py::arg("num_channels") = 1,
+        py::arg("step") = 1,
+        py::keep_alive<0, 1>())
+      .def(
+        "flip_view",
+        &ImageBuffer::FlipView, R"docstr(
+        Returns a read-only view which is flipped left/right and/or up/down.
+
+        **Corresponding C++ API:** ``viren2d::ImageBuffer::FlipView``.
+
+        Args:
+          horizontal: If ``True``, the columns will be reversed.
+          vertical: If ``True``, the rows will be reversed.
+        )docstr",
+        py::arg("horizontal") = true, py::arg("vertical") = false,
+        py::keep_alive<0, 1>())
       .def(
         "is_valid",
         &ImageBuffer::IsValid, R"docstr(
@@ -480,7 +1174,13 @@ void RegisterImageBuffer(py::module &m) {
         )docstr", py::arg("ch1"), py::arg("ch2"))
       .def(
         "to_channels",
-        &ImageBuffer::ToChannels, R"docstr(
+        [](const ImageBuffer &self, int output_channels, const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(self, output_channels),
+                [&](ImageBuffer *dst) {
+            self.ToChannels(dst, output_channels);
+          });
+        }, (R"docstr(
         Returns a copy with duplicated channels or removed alpha channel.
 
         This method can only **duplicate channels** or **remove the alpha
@@ -500,8 +1200,13 @@ void RegisterImageBuffer(py::module &m) {
         Important:
           This call will always create a deep copy, even if ``self`` already
           has the same number of channels as requested by ``output_channels``.
-        )docstr",
-        py::arg("output_channels"))
+
+        Args:
+          output_channels: Number of output channels as :class:`int`.)docstr"
+        + DocstringOutParameter() + R"docstr(
+        )docstr").c_str(),
+        py::arg("output_channels"),
+        py::arg("out") = py::none())
       .def(
         "__repr__",
         [](const ImageBuffer &buf)
@@ -543,9 +1248,51 @@ void RegisterImageBuffer(py::module &m) {
         py::arg("top") = -1,
         py::arg("width") = -1,
         py::arg("height") = -1)
+      .def(
+        "blur",
+        &ImageBuffer::Blur, R"docstr(
+        Blurs rectangular regions of interest **in-place**.
+
+        Intended to anonymize many regions (*e.g.* faces or license
+        plates) at once. Supports all data types and any number of
+        :attr:`channels`. The regions are processed in parallel.
+
+        Each filter pass is a running-sum box filter, *i.e.* the cost per
+        pixel does not depend on the ``radius``. Pixels outside of a
+        region contribute to the filter response, and the image border
+        is replicated. All regions are blurred based on the original
+        pixels, *i.e.* if regions overlap, later ones overwrite the
+        earlier ones.
+
+        **Corresponding C++ API:** ``viren2d::ImageBuffer::Blur``.
+
+        Args:
+          rois: A :class:`list` of axis-aligned :class:`~viren2d.Rect`
+            regions (or tuples ``(cx, cy, width, height)``), which will be
+            clipped to the image.
+          radius: Filter radius as :class:`int`. A box filter has the size
+            ``2 * radius + 1``, whereas the Gaussian has the standard
+            deviation ``radius / 3``.
+          kind: The filter as :class:`~viren2d.BlurKind` or its string
+            representation, *i.e.* ``'box'`` or ``'gaussian'``.
+
+        Example:
+          >>> img_buf.blur(
+          >>>     [(100, 80, 40, 60), (300, 120, 30, 40)],
+          >>>     radius=15, kind='gaussian')
+        )docstr",
+        py::arg("rois"), py::arg("radius"),
+        py::arg("kind") = BlurKind::Gaussian)
       .def(
         "to_uint8",
-        &ImageBuffer::ToUInt8, R"docstr(
+        [](const ImageBuffer &self, int output_channels, const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(
+                  self, output_channels, ImageBufferType::UInt8),
+                [&](ImageBuffer *dst) {
+            self.ToUInt8(dst, output_channels);
+          });
+        }, (R"docstr(
         Converts this buffer to ``uint8``.
 
         If the underlying type is :class:`numpy.float32` or :class:`numpy.float64`,
@@ -559,11 +1306,21 @@ void RegisterImageBuffer(py::module &m) {
             configurations are supported:
             * For a single-channel buffer: ``output_channels`` either 1, 3, or 4.
             * For a 3-channel buffer: ``output_channels`` either 3 or 4.
-            * For a 4-channel buffer: ``output_channels`` either 3 or 4.
-        )docstr", py::arg("output_channels"))
+            * For a 4-channel buffer: ``output_channels`` either 3 or 4.)docstr"
+        + DocstringOutParameter() + R"docstr(
+        )docstr").c_str(),
+        py::arg("output_channels"),
+        py::arg("out") = py::none())
       .def(
         "to_float32",
-        &ImageBuffer::ToFloat, R"docstr(
+        [](const ImageBuffer &self, const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(
+                  self, self.Channels(), ImageBufferType::Float),
+                [&](ImageBuffer *dst) {
+            self.ToFloat(dst);
+          });
+        }, (R"docstr(
         Converts this buffer to ``float32``.
 
         If the underlying type is integral (*e.g.* :class:`numpy.uint8`,
@@ -571,10 +1328,19 @@ void RegisterImageBuffer(py::module &m) {
         The number of channels remains the same.
 
         **Corresponding C++ API:** ``viren2d::ImageBuffer::ToFloat``.
-        )docstr")
+
+        Args:)docstr"
+        + DocstringOutParameter() + R"docstr(
+        )docstr").c_str(),
+        py::arg("out") = py::none())
       .def(
         "magnitude",
-        &ImageBuffer::Magnitude, R"docstr(
+        [](const ImageBuffer &self, const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(self, 1), [&](ImageBuffer *dst) {
+            self.Magnitude(dst);
+          });
+        }, (R"docstr(
         Computes the magnitude along the channels.
 
         At each spatial location :math:`(r,c)`, this method computes the
@@ -584,10 +1350,19 @@ void RegisterImageBuffer(py::module &m) {
         :class:`numpy.float64`, *e.g.* optical flow fields or image gradients.
 
         **Corresponding C++ API:** ``viren2d::ImageBuffer::Magnitude``.
-        )docstr")
+
+        Args:)docstr"
+        + DocstringOutParameter() + R"docstr(
+        )docstr").c_str(),
+        py::arg("out") = py::none())
       .def(
         "orientation",
-        &ImageBuffer::Orientation, R"docstr(
+        [](const ImageBuffer &self, float invalid, const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(self, 1), [&](ImageBuffer *dst) {
+            self.Orientation(dst, invalid);
+          });
+        }, (R"docstr(
         Computes the orientation **in radians** as
         :math:`\operatorname{atan2}\left(I(r, c, 1), I(r, c, 0)\right)`.
 
@@ -599,23 +1374,33 @@ void RegisterImageBuffer(py::module &m) {
 
         Args:
           invalid: If both components of an input pixel are 0, the output value
-            will be set to this user-defined `invalid` value.
-        )docstr",
-        py::arg("invalid") = std::numeric_limits<float>::quiet_NaN())
+            will be set to this user-defined `invalid` value.)docstr"
+        + DocstringOutParameter() + R"docstr(
+        )docstr").c_str(),
+        py::arg("invalid") = std::numeric_limits<float>::quiet_NaN(),
+        py::arg("out") = py::none())
       .def(
         "channel",
-        &ImageBuffer::Channel, R"docstr(
+        [](const ImageBuffer &self, int channel, const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(self, 1), [&](ImageBuffer *dst) {
+            self.Channel(dst, channel);
+          });
+        }, (R"docstr(
         Extracts a single channel.
 
         **Corresponding C++ API:** ``viren2d::ImageBuffer::Channel``.
 
         Args:
-          channel: The 0-based channel index as :class:`int`.
+          channel: The 0-based channel index as :class:`int`.)docstr"
+        + DocstringOutParameter() + R"docstr(
 
         Returns:
           A single-channel :class:`~viren2d.ImageBuffer` holding a deep copy of
           the specified channel.
-        )docstr", py::arg("channel"))
+        )docstr").c_str(),
+        py::arg("channel"),
+        py::arg("out") = py::none())
       .def(
         "min_max",
         [](const ImageBuffer &buf, int channel) {
@@ -640,6 +1425,37 @@ void RegisterImageBuffer(py::module &m) {
           :math:`x` and :math:`y` positions as :class:`~viren2d.Vec2i`.
         )docstr",
         py::arg("channel") = -1)
+      .def(
+        "statistics",
+        &ImageBuffer::Statistics, R"docstr(
+        Computes per-channel statistics in a single pass.
+
+        For each channel, computes the minimum & maximum (and their first
+        locations), the mean, the variance, the number of ``nan`` values
+        and, optionally, a histogram. Values are traversed only once and
+        in parallel, see :func:`~viren2d.set_num_threads`.
+
+        **Corresponding C++ API:** ``viren2d::ImageBuffer::Statistics``.
+
+        Args:
+          num_bins: Number of histogram bins as :class:`int`. If 0, no
+            histogram will be computed.
+          histogram_min: Lower bound of the histogram range.
+          histogram_max: Upper bound of the histogram range. Similar to
+            :func:`numpy.histogram`, the last bin includes this value.
+            Values outside the range are not counted.
+
+        Returns:
+          A :class:`list` of :class:`~viren2d.ChannelStatistics`, one
+          per channel.
+
+        Example:
+          >>> stats = img.statistics(num_bins=256)
+          >>> print(stats[0].mean, stats[0].std)
+        )docstr",
+        py::arg("num_bins") = 0,
+        py::arg("histogram_min") = 0.0,
+        py::arg("histogram_max") = 256.0)
       .def_property_readonly(
         "width",
         &ImageBuffer::Width, R"docstr(
@@ -675,6 +1491,22 @@ void RegisterImageBuffer(py::module &m) {
 
           **Corresponding C++ API:** ``viren2d::ImageBuffer::PixelStride``.
         )docstr")
+      .def_property_readonly(
+        "channel_stride",
+        &ImageBuffer::ChannelStride, R"docstr(
+        int: Stride in bytes per channel (read-only).
+
+          **Corresponding C++ API:** ``viren2d::ImageBuffer::ChannelStride``.
+        )docstr")
+      .def_property_readonly(
+        "read_only",
+        &ImageBuffer::IsReadOnly, R"docstr(
+        bool: Flag indicating whether this :class:`~viren2d.ImageBuffer`
+          is a read-only view, see :meth:`roi_view`, :meth:`channel_view`
+          and :meth:`flip_view` (read-only).
+
+          **Corresponding C++ API:** ``viren2d::ImageBuffer::IsReadOnly``.
+        )docstr")
       .def_property_readonly(
         "owns_data",
         &ImageBuffer::OwnsData, R"docstr(
@@ -694,6 +1526,14 @@ void RegisterImageBuffer(py::module &m) {
           **No corresponding C++ API**, retrieve height, width and channels
           separately.
         )docstr")
+      .def_property_readonly(
+        "layout",
+        &ImageBuffer::Layout, R"docstr(
+        :class:`~viren2d.ImageLayout`: Memory layout of the channels
+          (read-only). Note that :attr:`shape` is always ``(H, W, C)``.
+
+          **Corresponding C++ API:** ``viren2d::ImageBuffer::Layout``.
+        )docstr")
       .def_property_readonly(
         "itemsize",
         &ImageBuffer::ElementSize, R"docstr(
@@ -711,10 +1551,69 @@ void RegisterImageBuffer(py::module &m) {
           **Corresponding C++ API:** ``viren2d::ImageBuffer::BufferType``.
         )docstr");
 
+  imgbuf.def(
+        "alpha_composite",
+        [](const ImageBuffer &self, const ImageBuffer &overlay,
+           const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(self), [&](ImageBuffer *dst) {
+            self.AlphaComposite(dst, overlay);
+          });
+        }, (R"docstr(
+        Returns the result of compositing an RGBA overlay over this image.
+
+        The color channels are blended by the overlay's alpha channel, *i.e.*
+        :math:`(1 - \alpha) * \text{self} + \alpha * \text{overlay}`. If this
+        image has 4 channels, the output alpha is
+        :math:`\alpha + \alpha_{\text{self}} * (1 - \alpha)`.
+        :class:`numpy.uint8` images are composited in fixed-point
+        arithmetic, where an alpha of 255 is fully opaque. For
+        floating point images, alpha must be in :math:`[0, 1]`.
+
+        **Corresponding C++ API:** ``viren2d::ImageBuffer::AlphaComposite``.
+
+        Args:
+          overlay: The 4-channel :class:`~viren2d.ImageBuffer` to be
+            overlaid, which must have the same size and type as this
+            3- or 4-channel image.)docstr"
+        + DocstringOutParameter() + R"docstr(
+
+        Example:
+          >>> heatmap = np.array(viren2d.colorize_scaled(
+          >>>     scores, colormap='gouldian', output_channels=4))
+          >>> heatmap[:, :, 3] = 128
+          >>> vis = frame.alpha_composite(heatmap)
+        )docstr").c_str(),
+        py::arg("overlay"),
+        py::arg("out") = py::none())
+      .def(
+        "alpha_composite_inplace",
+        &ImageBuffer::AlphaCompositeInPlace, R"docstr(
+        Composites an RGBA overlay over this buffer **in-place**.
+
+        Same as :meth:`~viren2d.ImageBuffer.alpha_composite`, but modifies
+        this buffer instead of allocating an output.
+
+        **Corresponding C++ API:** ``viren2d::ImageBuffer::AlphaCompositeInPlace``.
+
+        Args:
+          overlay: The 4-channel :class:`~viren2d.ImageBuffer` to be
+            overlaid.
+        )docstr",
+        py::arg("overlay"));
+
+
   imgbuf.def(
         "blend_constant",
-        py::overload_cast<const ImageBuffer &, double>(
-          &ImageBuffer::Blend, py::const_), R"docstr(
+        [](const ImageBuffer &self, const ImageBuffer &other,
+           double alpha, const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(
+                  self, std::max(self.Channels(), other.Channels())),
+                [&](ImageBuffer *dst) {
+            self.Blend(dst, other, alpha);
+          });
+        }, (R"docstr(
         Returns an alpha-blended image.
 
         Creates a new image as the result of
@@ -728,14 +1627,23 @@ void RegisterImageBuffer(py::module &m) {
 
         Args:
           other: The other :class:`~viren2d.ImageBuffer` to blend.
-          alpha: Blending factor as :class:`float` :math:`\in [0,1]`.
-        )docstr",
+          alpha: Blending factor as :class:`float` :math:`\in [0,1]`.)docstr"
+        + DocstringOutParameter() + R"docstr(
+        )docstr").c_str(),
         py::arg("other"),
-        py::arg("alpha"))
+        py::arg("alpha"),
+        py::arg("out") = py::none())
       .def(
         "blend_mask",
-        py::overload_cast<const ImageBuffer &, const ImageBuffer &>(
-          &ImageBuffer::Blend, py::const_), R"docstr(
+        [](const ImageBuffer &self, const ImageBuffer &other,
+           const ImageBuffer &alpha, const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(
+                  self, std::max(self.Channels(), other.Channels())),
+                [&](ImageBuffer *dst) {
+            self.Blend(dst, other, alpha);
+          });
+        }, (R"docstr(
         Returns an alpha-blended image.
 
         Creates a new image as the result of
@@ -757,7 +1665,8 @@ void RegisterImageBuffer(py::module &m) {
           alpha: Blending mask/weights as :class:`~viren2d.ImageBuffer`
             of the same width and height. The mask must be of type
             :class:`numpy.float32` or :class:`numpy.float32` and each
-            :math:`\alpha_{r,c} \in [0,1]`.
+            :math:`\alpha_{r,c} \in [0,1]`.)docstr"
+        + DocstringOutParameter() + R"docstr(
 
         Example:
           >>> grad = viren2d.LinearColorGradient((0, 0), (img.width, img.height))
@@ -771,14 +1680,99 @@ void RegisterImageBuffer(py::module &m) {
 
         Code example to create this blended visualization can be found in the
         :ref:`RTD tutorial section on optical flow colorization<tutorial-optical-flow-blend>`.
+        )docstr").c_str(),
+        py::arg("other"),
+        py::arg("alpha"),
+        py::arg("out") = py::none())
+      .def(
+        "blend_constant_inplace",
+        static_cast<void (ImageBuffer::*)(const ImageBuffer &, double)>(
+          &ImageBuffer::BlendInPlace), R"docstr(
+        Alpha-blends the other image into this buffer **in-place**.
+
+        Computes :math:`(1 - \alpha) * \text{self} + \alpha * \text{other}`
+        without allocating an output, *i.e.* if this buffer is a view onto
+        a :class:`numpy.ndarray`, the array will be modified. The
+        ``other`` buffer must not have more channels than ``self``.
+
+        **Corresponding C++ API:** ``viren2d::ImageBuffer::BlendInPlace``.
+
+        Args:
+          other: The other :class:`~viren2d.ImageBuffer` to blend.
+          alpha: Blending factor as :class:`float` :math:`\in [0,1]`.
+        )docstr",
+        py::arg("other"),
+        py::arg("alpha"))
+      .def(
+        "blend_mask_inplace",
+        static_cast<void (ImageBuffer::*)(const ImageBuffer &, const ImageBuffer &)>(
+          &ImageBuffer::BlendInPlace), R"docstr(
+        Alpha-blends the other image into this buffer **in-place**.
+
+        Same as :meth:`~viren2d.ImageBuffer.blend_mask`, but modifies this
+        buffer instead of allocating an output. The ``other`` buffer must
+        not have more channels than ``self``.
+
+        **Corresponding C++ API:** ``viren2d::ImageBuffer::BlendInPlace``.
+
+        Args:
+          other: The other :class:`~viren2d.ImageBuffer` to be overlaid.
+          alpha: Blending mask/weights as :class:`~viren2d.ImageBuffer`
+            of the same width and height, see
+            :meth:`~viren2d.ImageBuffer.blend_mask`.
         )docstr",
         py::arg("other"),
         py::arg("alpha"));
 
 
+  imgbuf.def(
+        "blend_packed_mask",
+        [](const ImageBuffer &self, const ImageBuffer &other,
+           const PackedMask &mask, double alpha, const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(
+                  self, std::max(self.Channels(), other.Channels())),
+                [&](ImageBuffer *dst) {
+            self.Blend(dst, other, mask, alpha);
+          });
+        }, (R"docstr(
+        Returns an image where the masked pixels are alpha-blended.
+
+        Pixels whose mask bit is set are computed as
+        :math:`(1 - \alpha) * \text{self} + \alpha * \text{other}`, all
+        other pixels are copied from ``self``. Thus, ``alpha = 1`` replaces
+        the masked pixels by ``other``. Non-blendable channels are handled
+        as in :meth:`~viren2d.ImageBuffer.blend_mask`.
+
+        **Corresponding C++ API:** ``viren2d::ImageBuffer::Blend``.
+
+        Args:
+          other: The other :class:`~viren2d.ImageBuffer` to be overlaid.
+          mask: The :class:`~viren2d.PackedMask`, which must have the
+            same width and height.
+          alpha: Blending factor of the masked pixels as :class:`float`
+            :math:`\in [0,1]`.)docstr"
+        + DocstringOutParameter() + R"docstr(
+
+        Example:
+          >>> mask = viren2d.mask_color_range_packed(
+          >>>     image=img, hue_range=(320, 360), saturation_range=(0.4, 1))
+          >>> highlighted = img.blend_packed_mask(overlay, mask, alpha=0.7)
+        )docstr").c_str(),
+        py::arg("other"),
+        py::arg("mask"),
+        py::arg("alpha") = 1.0,
+        py::arg("out") = py::none());
+
+
   imgbuf.def(
         "dim",
-        &ImageBuffer::Dim, R"docstr(
+        [](const ImageBuffer &self, double alpha, const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(self), [&](ImageBuffer *dst) {
+            self.Dim(dst, alpha);
+          });
+        }, (R"docstr(
         Returns a scaled version of this image as
         :math:`\alpha * \text{self}`.
 
@@ -790,18 +1784,375 @@ void RegisterImageBuffer(py::module &m) {
         **Corresponding C++ API:** ``viren2d::ImageBuffer::Dim``.
 
         Args:
-          alpha: Scaling factor as :class:`float`.
+          alpha: Scaling factor as :class:`float`.)docstr"
+        + DocstringOutParameter() + R"docstr(
 
         Example:
           >>> dimmed = img.dim(0.4)
+        )docstr").c_str(),
+        py::arg("alpha"),
+        py::arg("out") = py::none())
+      .def(
+        "dim_inplace",
+        &ImageBuffer::DimInPlace, R"docstr(
+        Scales this image **in-place** as :math:`\alpha * \text{self}`.
+
+        Same as :meth:`~viren2d.ImageBuffer.dim`, but modifies this
+        buffer instead of allocating an output, *i.e.* if this buffer is a
+        view onto a :class:`numpy.ndarray`, the array will be modified.
+
+        **Corresponding C++ API:** ``viren2d::ImageBuffer::DimInPlace``.
+
+        Args:
+          alpha: Scaling factor as :class:`float`.
+
+        Example:
+          >>> frame = viren2d.ImageBuffer(frame_np, copy=False)
+          >>> frame.dim_inplace(0.4)
         )docstr",
         py::arg("alpha"));
 
 
+  imgbuf.def(
+        "resize",
+        [](const ImageBuffer &self, int width, int height,
+           Interpolation interpolation, const py::object &out) {
+          const ResultSpec result{
+            height, width, self.Channels(), self.BufferType()};
+          return TransformInto(out, result, [&](ImageBuffer *dst) {
+            self.Resize(dst, width, height, interpolation);
+          });
+        }, (R"docstr(
+        Returns a resampled version of this image.
+
+        Works on all supported types and any number of channels. Pixel
+        centers are aligned (same convention as ``cv2.resize``) and
+        integral values are rounded.
+
+        **Corresponding C++ API:** ``viren2d::ImageBuffer::Resize``.
+
+        Args:
+          width: Target width as :class:`int`.
+          height: Target height as :class:`int`.
+          interpolation: The :class:`~viren2d.Interpolation` mode, or its
+            string representation (``'nearest'``, ``'bilinear'`` or ``'area'``).)docstr"
+        + DocstringOutParameter() + R"docstr(
+
+        Example:
+          >>> thumbnail = img.resize(320, 180, 'area')
+        )docstr").c_str(),
+        py::arg("width"),
+        py::arg("height"),
+        py::arg("interpolation") = Interpolation::Bilinear,
+        py::arg("out") = py::none());
+
+
+  imgbuf.def(
+        "lazy",
+        &ImageBuffer::Lazy, R"docstr(
+        Returns a :class:`~viren2d.PixelExpression` on this buffer.
+
+        Records element-wise operations which will be applied in a single
+        pass upon :meth:`~viren2d.PixelExpression.evaluate`, instead of
+        allocating and traversing an intermediate image per operation.
+
+        **Corresponding C++ API:** ``viren2d::ImageBuffer::Lazy``.
+
+        Example:
+          >>> result = img.lazy().normalize(-0.5, 2.0, 0.0).blend_constant(
+          >>>     overlay, 0.3).scale(255).evaluate(numpy.uint8)
+        )docstr");
+
+
+  packed_mask.def(
+        py::init<int, int, bool>(), R"docstr(
+        Creates a packed mask of the given size.
+
+        Args:
+          height: Number of rows as :class:`int`.
+          width: Number of columns as :class:`int`.
+          value: Initial value of all bits as :class:`bool`.
+        )docstr",
+        py::arg("height"),
+        py::arg("width"),
+        py::arg("value") = false)
+      .def(
+        py::init<const ImageBuffer &>(), R"docstr(
+        Packs a single-channel mask.
+
+        Each bit is set if the corresponding mask value is non-zero.
+
+        Args:
+          mask: Single-channel :class:`~viren2d.ImageBuffer` (or
+            :class:`numpy.ndarray`) of any supported type.
+        )docstr",
+        py::arg("mask"))
+      .def(
+        "__repr__",
+        [](const PackedMask &mask)
+        { return "<" + mask.ToString() + ">"; })
+      .def("__str__", &PackedMask::ToString)
+      .def(py::self == py::self)
+      .def(py::self != py::self)
+      .def_property_readonly(
+        "width", &PackedMask::Width,
+        "int: Number of columns (read-only).")
+      .def_property_readonly(
+        "height", &PackedMask::Height,
+        "int: Number of rows (read-only).")
+      .def_property_readonly(
+        "nbytes", &PackedMask::NumBytes,
+        "int: Number of bytes occupied by the packed bits (read-only).")
+      .def(
+        "count_nonzero", &PackedMask::CountNonZero, R"docstr(
+        Returns the number of set pixels.
+
+        **Corresponding C++ API:** ``viren2d::PackedMask::CountNonZero``.
+        )docstr")
+      .def(
+        "inverted", &PackedMask::Inverted, R"docstr(
+        Returns a mask where each bit is flipped.
+
+        **Corresponding C++ API:** ``viren2d::PackedMask::Inverted``.
+        )docstr")
+      .def(
+        "to_image", &PackedMask::ToImageBuffer, R"docstr(
+        Returns the mask as single-channel :class:`~viren2d.ImageBuffer` of
+        type :class:`numpy.uint8`, where set pixels are 255.
+
+        **Corresponding C++ API:** ``viren2d::PackedMask::ToImageBuffer``.
+        )docstr");
+
+
+  py::class_<PixelExpression> expr(m, "PixelExpression", R"docstr(
+      Lazily evaluated, element-wise operations on an image.
+
+      Use :meth:`~viren2d.ImageBuffer.lazy` to create an expression, then
+      chain the operations and finally call
+      :meth:`~viren2d.PixelExpression.evaluate`. All operations are
+      computed in double precision and in a single pass, *i.e.* each input
+      is read once and only the final result is allocated. Upon evaluation,
+      the values are saturated to the range of the output type.
+
+      Note that the expression keeps views (*i.e.* no deep copies) of
+      buffers which share the memory of a :class:`numpy.ndarray`. Such
+      arrays must not be modified before the expression is evaluated.
+
+      **Corresponding C++ API:** ``viren2d::PixelExpression``.
+      )docstr");
+
+  expr.def(
+        "__repr__",
+        [](const PixelExpression &e) {
+          std::ostringstream s;
+          s << "<PixelExpression(" << e.Width() << "x" << e.Height()
+            << "x" << e.Channels() << ", " << e.NumOperations()
+            << " operation(s))>";
+          return s.str();
+        })
+      .def_property_readonly(
+        "width",
+        &PixelExpression::Width,
+        "int: Width of the result (read-only).")
+      .def_property_readonly(
+        "height",
+        &PixelExpression::Height,
+        "int: Height of the result (read-only).")
+      .def_property_readonly(
+        "channels",
+        &PixelExpression::Channels,
+        "int: Number of channels of the result (read-only).")
+      .def_property_readonly(
+        "num_operations",
+        &PixelExpression::NumOperations,
+        "int: Number of recorded operations (read-only).")
+      .def(
+        "normalize",
+        [](PixelExpression &self, const py::object &shift_pre,
+           const py::object &scale, const py::object &shift_post)
+            -> PixelExpression & {
+          return self.Normalize(
+                DoublesFromPyObject(shift_pre), DoublesFromPyObject(scale),
+                DoublesFromPyObject(shift_post));
+        }, R"docstr(
+        Records ``v = (v + shift_pre) * scale + shift_post``.
+
+        Each parameter can either be a single :class:`float`, which will
+        be used for all channels, or a :class:`list` with one value per
+        channel.
+
+        **Corresponding C++ API:** ``viren2d::PixelExpression::Normalize``.
+
+        Returns:
+          This :class:`~viren2d.PixelExpression` to chain further operations.
+        )docstr",
+        py::arg("shift_pre"),
+        py::arg("scale"),
+        py::arg("shift_post"),
+        py::return_value_policy::reference_internal)
+      .def(
+        "scale",
+        &PixelExpression::Scale, R"docstr(
+        Records the multiplication by a constant :class:`float` factor.
+
+        **Corresponding C++ API:** ``viren2d::PixelExpression::Scale``.
+        )docstr",
+        py::arg("factor"),
+        py::return_value_policy::reference_internal)
+      .def(
+        "clamp",
+        &PixelExpression::Clamp, R"docstr(
+        Records clipping of the values to ``[min_value, max_value]``.
+
+        **Corresponding C++ API:** ``viren2d::PixelExpression::Clamp``.
+        )docstr",
+        py::arg("min_value"),
+        py::arg("max_value"),
+        py::return_value_policy::reference_internal)
+      .def(
+        "blend_constant",
+        static_cast<PixelExpression &(PixelExpression::*)(const ImageBuffer &, double)>(
+          &PixelExpression::Blend), R"docstr(
+        Records alpha blending with a constant weight.
+
+        Same as :meth:`~viren2d.ImageBuffer.blend_constant`, but ``other``
+        can be of any type.
+
+        **Corresponding C++ API:** ``viren2d::PixelExpression::Blend``.
+        )docstr",
+        py::arg("other"),
+        py::arg("alpha"),
+        py::return_value_policy::reference_internal)
+      .def(
+        "blend_mask",
+        static_cast<PixelExpression &(PixelExpression::*)(const ImageBuffer &, const ImageBuffer &)>(
+          &PixelExpression::Blend), R"docstr(
+        Records alpha blending with a weight mask.
+
+        Same as :meth:`~viren2d.ImageBuffer.blend_mask`, but ``other``
+        can be of any type.
+
+        **Corresponding C++ API:** ``viren2d::PixelExpression::Blend``.
+        )docstr",
+        py::arg("other"),
+        py::arg("alpha"),
+        py::return_value_policy::reference_internal)
+      .def(
+        "evaluate",
+        [](const PixelExpression &self, const py::object &dtype,
+           const py::object &out) {
+          const ImageBufferType output_type = ImageBufferTypeFromDType(dtype);
+          const ResultSpec result{
+            self.Height(), self.Width(), self.Channels(), output_type};
+          return TransformInto(out, result, [&](ImageBuffer *dst) {
+            self.Evaluate(dst, output_type);
+          });
+        }, (R"docstr(
+        Applies all recorded operations in a single pass.
+
+        **Corresponding C++ API:** ``viren2d::PixelExpression::Evaluate``.
+
+        Args:
+          dtype: Output type, *e.g.* :class:`numpy.uint8` or ``'float32'``.)docstr"
+        + DocstringOutParameter() + R"docstr(
+        )docstr").c_str(),
+        py::arg("dtype") = py::dtype::of<uint8_t>(),
+        py::arg("out") = py::none());
+
+
   // An ImageBuffer can be initialized from a numpy array
   py::implicitly_convertible<py::array, ImageBuffer>();
 
 
+  py::class_<ImageBatch> batch(m, "ImageBatch", py::buffer_protocol(), R"docstr(
+        A batch of equally sized images, *e.g.* the output tensor of a
+        neural network.
+
+        Each frame is an :class:`~viren2d.ImageBuffer` which references the
+        batch memory, *i.e.* frames can be visualized without copying or
+        transposing the batch:
+
+        >>> batch = viren2d.ImageBatch(depth_nchw, layout='nchw')
+        >>> vis = [viren2d.colorize_scaled(frame) for frame in batch]
+
+        The buffer protocol always exposes a batch as ``N x H x W x C``
+        array (with the strides of the underlying layout).
+
+        **Corresponding C++ API:** ``viren2d::ImageBatch``.
+        )docstr");
+
+  batch.def(
+        py::init(&CreateImageBatch), R"docstr(
+        Creates an *ImageBatch* from a :class:`numpy.ndarray`.
+
+        Args:
+          array: ``N x H x W`` array of single-channel images, or
+            a 4-dimensional array of the given ``layout``.
+          layout: :class:`~viren2d.ImageLayout` of a 4-dimensional
+            ``array``, *i.e.* ``'nhwc'`` or ``'nchw'``.
+          copy: If ``True``, the batch will copy the ``array``. Otherwise,
+            the memory will be shared if the ``array`` is mutable and has
+            no negative strides.
+        )docstr",
+        py::arg("array"),
+        py::arg("layout") = ImageLayout::Interleaved,
+        py::arg("copy") = false,
+        py::keep_alive<1, 2>())
+      .def_buffer(&ImageBatchInfo)
+      .def(
+        "__repr__",
+        [](const ImageBatch &b)
+        { return "<" + b.ToString() + ">"; })
+      .def("__str__", &ImageBatch::ToString)
+      .def("__len__", &ImageBatch::NumFrames)
+      .def(
+        "__getitem__",
+        [](ImageBatch &self, int index) {
+          return self.Frame((index < 0) ? (index + self.NumFrames()) : index);
+        }, R"docstr(
+        Returns the frame at the given index as shared
+        :class:`~viren2d.ImageBuffer`, *i.e.* modifying the frame
+        modifies this batch.
+
+        **Corresponding C++ API:** ``viren2d::ImageBatch::Frame``.
+        )docstr",
+        py::arg("index"),
+        py::keep_alive<0, 1>())
+      .def(
+        "frame_view",
+        &ImageBatch::FrameView, R"docstr(
+        Returns a read-only view onto the frame at the given index.
+
+        **Corresponding C++ API:** ``viren2d::ImageBatch::FrameView``.
+        )docstr",
+        py::arg("index"),
+        py::keep_alive<0, 1>())
+      .def_property_readonly(
+        "num_frames", &ImageBatch::NumFrames,
+        "int: Number of frames (read-only).")
+      .def_property_readonly(
+        "height", &ImageBatch::Height,
+        "int: Number of rows of each frame (read-only).")
+      .def_property_readonly(
+        "width", &ImageBatch::Width,
+        "int: Number of columns of each frame (read-only).")
+      .def_property_readonly(
+        "channels", &ImageBatch::Channels,
+        "int: Number of channels (read-only).")
+      .def_property_readonly(
+        "layout", &ImageBatch::Layout,
+        ":class:`~viren2d.ImageLayout`: Memory layout of each frame (read-only).")
+      .def_property_readonly(
+        "owns_data", &ImageBatch::OwnsData,
+        "bool: Flag indicating whether the batch allocated its memory (read-only).")
+      .def_property_readonly(
+        "dtype",
+        [](const ImageBatch &b) {
+          return py::dtype(FormatDescriptor(b.BufferType()));
+        },
+        "numpy.dtype: Underlying data type (read-only).");
+
+
   m.def("save_image_uint8",
         &SaveImageUInt8Helper, R"docstr(
         Stores an 8-bit image to disk as either JPEG or PNG.
@@ -856,8 +2207,102 @@ void RegisterImageBuffer(py::module &m) {
         py::arg("force_channels") = 0);
 
 
+  m.def("map_raw",
+        &MapRawHelper, R"docstr(
+        Memory-maps a raw binary file as an :class:`~viren2d.ImageBuffer`.
+
+        Pixels are only paged in from disk once they are accessed. Thus,
+        rasters which exceed the available memory can be processed, *e.g.*
+        via :meth:`~viren2d.ImageBuffer.roi_view` or
+        :func:`~viren2d.colorize_scaled`.
+
+        **Corresponding C++ API:** ``viren2d::MapRaw``.
+
+        Args:
+          filename: The path to the file as :class:`str` or
+            :class:`pathlib.Path`.
+          height: Number of rows as :class:`int`.
+          width: Number of columns as :class:`int`.
+          channels: Number of (interleaved) channels as :class:`int`.
+          dtype: Data type of the stored elements (in host byte order),
+            *e.g.* :class:`numpy.float32`.
+          offset: Number of bytes to skip at the beginning of the file.
+            Must be a multiple of the element size.
+          copy_on_write: If ``False``, the returned buffer is read-only.
+            Otherwise, it can be modified, but the changes will never be
+            written back to the file.
+        )docstr",
+        py::arg("filename"), py::arg("height"), py::arg("width"),
+        py::arg("channels"), py::arg("dtype"), py::arg("offset") = 0,
+        py::arg("copy_on_write") = false);
+
+
+  m.def("map_npy",
+        &MapNpyHelper, R"docstr(
+        Memory-maps a 2D or 3D array stored via :func:`numpy.save`.
+
+        Both C and Fortran order are supported, the data type and shape
+        are taken from the file's header. See :func:`~viren2d.map_raw`
+        for details on memory-mapped buffers.
+
+        **Corresponding C++ API:** ``viren2d::MapNpy``.
+
+        Args:
+          filename: The path to the ``.npy`` file as :class:`str` or
+            :class:`pathlib.Path`.
+          copy_on_write: If ``False``, the returned buffer is read-only.
+            Otherwise, it can be modified, but the changes will never be
+            written back to the file.
+        )docstr",
+        py::arg("filename"), py::arg("copy_on_write") = false);
+
+
+  m.def("load_npy",
+        &LoadNpyHelper, R"docstr(
+        Loads a 2D or 3D array stored via :func:`numpy.save`.
+
+        In contrast to :func:`~viren2d.load_image_uint8`, all data types
+        supported by the :class:`~viren2d.ImageBuffer` can be loaded.
+        Arrays in Fortran order will be converted to row-major layout.
+
+        **Corresponding C++ API:** ``viren2d::LoadNpy``.
+
+        Args:
+          filename: The path to the ``.npy`` file as :class:`str` or
+            :class:`pathlib.Path`.
+        )docstr",
+        py::arg("filename"));
+
+
+  m.def("save_npy",
+        &SaveNpyHelper, R"docstr(
+        Saves an :class:`~viren2d.ImageBuffer` in the ``.npy`` format.
+
+        The file can be loaded via :func:`numpy.load` or
+        :func:`~viren2d.load_npy`. Single-channel buffers are stored as
+        2D arrays. Rows are written directly from the buffer's memory,
+        *i.e.* views will not be copied.
+
+        **Corresponding C++ API:** ``viren2d::SaveNpy``.
+
+        Args:
+          filename: The output filename as :class:`str` or
+            :class:`pathlib.Path`. The calling code must ensure that the
+            directory hierarchy exists.
+          image: The :class:`~viren2d.ImageBuffer` of any data type.
+        )docstr",
+        py::arg("filename"), py::arg("image"));
+
+
   m.def("convert_rgb2gray",
-        &ConvertRGB2Gray, R"docstr(
+        [](const ImageBuffer &color, int output_channels,
+           bool is_bgr, const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(color, output_channels),
+                [&](ImageBuffer *dst) {
+            ConvertRGB2Gray(color, dst, output_channels, is_bgr);
+          });
+        }, (R"docstr(
         Converts RGB(A)/BGR(A) images to grayscale.
 
         **Corresponding C++ API:** ``viren2d::ConvertRGB2Gray``.
@@ -870,11 +2315,13 @@ void RegisterImageBuffer(py::module &m) {
             luminance, whereas the 4th channel will be the alpha channel and
             either fully opaque or a copy of this image's alpha channel.
           is_bgr: Set to ``True`` if the channels of the color image are in
-            BGR format.
-        )docstr",
+            BGR format.)docstr"
+        + DocstringOutParameter() + R"docstr(
+        )docstr").c_str(),
         py::arg("color"),
         py::arg("output_channels") = 1,
-        py::arg("is_bgr") = false);
+        py::arg("is_bgr") = false,
+        py::arg("out") = py::none());
 
 
   m.def("convert_gray2rgb",
@@ -897,7 +2344,13 @@ void RegisterImageBuffer(py::module &m) {
 
 
   m.def("convert_rgb2hsv",
-        &ConvertRGB2HSV, R"docstr(
+        [](const ImageBuffer &image, bool is_bgr, const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(image, 3, ImageBufferType::UInt8),
+                [&](ImageBuffer *dst) {
+            ConvertRGB2HSV(image, dst, is_bgr);
+          });
+        }, (R"docstr(
         Converts a RGB(A)/BGR(A) image to HSV.
 
         **Corresponding C++ API:** ``viren2d::ConvertRGB2HSV``.
@@ -906,15 +2359,17 @@ void RegisterImageBuffer(py::module &m) {
           image: The 3- or 4-channel color :class:`~viren2d.ImageBuffer`
             of type :class:`numpy.uint8`.
           is_bgr: Set to ``True`` if the channels of the color image are in
-            BGR format.
+            BGR format.)docstr"
+        + DocstringOutParameter() + R"docstr(
 
         Returns:
           A 3-channel :class:`~viren2d.ImageBuffer` holding hue, saturation and
           value, with hue :math:`\in [0, 180]`, saturation :math:`\in [0, 255]`
           and value :math:`\in [0, 255]`.
-        )docstr",
+        )docstr").c_str(),
         py::arg("image"),
-        py::arg("is_bgr") = false);
+        py::arg("is_bgr") = false,
+        py::arg("out") = py::none());
 
 
   m.def("convert_hsv2rgb",
@@ -935,6 +2390,59 @@ void RegisterImageBuffer(py::module &m) {
         py::arg("output_channels") = 3,
         py::arg("output_bgr") = false);
 
+
+  m.def("convert_rgb2lab",
+        [](const ImageBuffer &image, bool is_bgr, const py::object &out) {
+          return TransformInto(
+                out, ResultSpec::Like(image, 3), [&](ImageBuffer *dst) {
+            ConvertRGB2Lab(image, dst, is_bgr);
+          });
+        }, (R"docstr(
+        Converts a RGB(A)/BGR(A) image to CIE L*a*b* (D65 white point).
+
+        **Corresponding C++ API:** ``viren2d::ConvertRGB2Lab``.
+
+        Args:
+          image: The 3- or 4-channel color :class:`~viren2d.ImageBuffer`
+            of type :class:`numpy.uint8` or :class:`numpy.float32`. Floating
+            point values are expected to be :math:`\in [0, 1]`.
+          is_bgr: Set to ``True`` if the channels of the color image are in
+            BGR format.)docstr"
+        + DocstringOutParameter() + R"docstr(
+
+        Returns:
+          A 3-channel :class:`~viren2d.ImageBuffer` of the same type as the
+          input. For :class:`numpy.float32`, :math:`L^* \in [0, 100]` and
+          :math:`a^*, b^*` are roughly :math:`\in [-128, 127]`. For
+          :class:`numpy.uint8`, the channels hold :math:`L^* \cdot 255 / 100`,
+          :math:`a^* + 128` and :math:`b^* + 128` (as in OpenCV).
+        )docstr").c_str(),
+        py::arg("image"),
+        py::arg("is_bgr") = false,
+        py::arg("out") = py::none());
+
+
+  m.def("convert_lab2rgb",
+        &ConvertLab2RGB, R"docstr(
+        Converts a CIE L*a*b* image to RGB(A)/BGR(A).
+
+        Colors outside of the sRGB gamut will be clipped.
+
+        **Corresponding C++ API:** ``viren2d::ConvertLab2RGB``.
+
+        Args:
+          lab: The 3-channel :class:`~viren2d.ImageBuffer` of type
+            :class:`numpy.uint8` or :class:`numpy.float32`, see
+            :func:`~viren2d.convert_rgb2lab` for the value ranges.
+          output_channels: The number of output channels, which must be 3 or 4.
+            The optional fourth channel will be fully-opaque, *i.e.* 255 for
+            :class:`numpy.uint8` and 1 for :class:`numpy.float32`.
+          output_bgr: If ``True``, the result will be in BGR(A) format.
+        )docstr",
+        py::arg("lab"),
+        py::arg("output_channels") = 3,
+        py::arg("output_bgr") = false);
+
 //FIXME add python demo + rtd visualization
   m.def("color_pop",
         &ColorPop, R"docstr(
@@ -973,7 +2481,82 @@ void RegisterImageBuffer(py::module &m) {
         py::arg("saturation_range") = std::make_pair<float, float>(0.0f, 1.0f),
         py::arg("value_range") = std::make_pair<float, float>(0.0f, 1.0f),
         py::arg("is_bgr") = false);
+
+
+  m.def("mask_color_range",
+        &MaskColorRange, R"docstr(
+        Returns a mask of the pixels within the specified HSV color range.
+
+        The HSV range test is evaluated per pixel, *i.e.* this is equivalent
+        to thresholding the output of :func:`~viren2d.convert_rgb2hsv`, but
+        does not compute the intermediate HSV image.
+
+        **Corresponding C++ API:** ``viren2d::MaskColorRange``.
+
+        Args:
+          image: Color image in **RGB(A)/BGR(A)** format.
+          hue_range: Hue range as :class:`tuple` ``(min_hue, max_hue)``, where
+            hue values are of type :class:`float` :math:`\in [0, 360]`.
+          saturation_range: Saturation range as :class:`tuple`
+            ``(min_saturation, max_saturation)``, where saturation values are
+            of type :class:`float` :math:`\in [0, 1]`.
+          value_range: Value range as :class:`tuple`
+            ``(min_value, max_value)``, where each value is of type
+            :class:`float` :math:`\in [0, 1]`.
+          is_bgr: Set to ``True`` if the color image is provided in BGR(A)
+            format.
+
+        Returns:
+          A single-channel :class:`~viren2d.ImageBuffer` of type
+          :class:`numpy.uint8`, where pixels within the range are set
+          to 255 and all others to 0.
+
+        Example:
+          >>> mask = viren2d.mask_color_range(
+          >>>     image=img, hue_range=(320, 360), saturation_range=(0.4, 1),
+          >>>     value_range=(0.2, 1), is_bgr=False)
+        )docstr",
+        py::arg("image"),
+        py::arg("hue_range"),
+        py::arg("saturation_range") = std::make_pair<float, float>(0.0f, 1.0f),
+        py::arg("value_range") = std::make_pair<float, float>(0.0f, 1.0f),
+        py::arg("is_bgr") = false);
+
+
+  m.def("mask_color_range_packed",
+        &MaskColorRangePacked, R"docstr(
+        Returns a bit-packed mask of the pixels within the specified
+        HSV color range.
+
+        Same as :func:`~viren2d.mask_color_range`, but returns a
+        :class:`~viren2d.PackedMask`, which requires only 1 bit per pixel.
+
+        **Corresponding C++ API:** ``viren2d::MaskColorRangePacked``.
+
+        Args:
+          image: Color image in **RGB(A)/BGR(A)** format.
+          hue_range: Hue range as :class:`tuple` ``(min_hue, max_hue)``, where
+            hue values are of type :class:`float` :math:`\in [0, 360]`.
+          saturation_range: Saturation range as :class:`tuple`
+            ``(min_saturation, max_saturation)``, where saturation values are
+            of type :class:`float` :math:`\in [0, 1]`.
+          value_range: Value range as :class:`tuple`
+            ``(min_value, max_value)``, where each value is of type
+            :class:`float` :math:`\in [0, 1]`.
+          is_bgr: Set to ``True`` if the color image is provided in BGR(A)
+            format.
+
+        Example:
+          >>> mask = viren2d.mask_color_range_packed(
+          >>>     image=img, hue_range=(320, 360), saturation_range=(0.4, 1),
+          >>>     value_range=(0.2, 1), is_bgr=False)
+          >>> mask.count_nonzero()
+        )docstr",
+        py::arg("image"),
+        py::arg("hue_range"),
+        py::arg("saturation_range") = std::make_pair<float, float>(0.0f, 1.0f),
+        py::arg("value_range") = std::make_pair<float, float>(0.0f, 1.0f),
+        py::arg("is_bgr") = false);
 }
 } // namespace bindings
 } // namespace viren2d
-
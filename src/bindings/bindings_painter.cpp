@@ -202,6 +202,13 @@ public:
   }
 
 
+  bool DrawMask(
+      const PackedMask &mask, const Color &color,
+      const Vec2d &position, Anchor anchor) {
+    return painter_->DrawMask(mask, color, position, anchor);
+  }
+
+
   bool DrawPolygon(
       const std::vector<Vec2d> &polygon, const LineStyle &line_style,
       const Color &fill_color) {
@@ -1107,6 +1114,42 @@ void RegisterPainter(py::module &m) {
         py::arg("marker_style") = MarkerStyle());
 
 
+  painter.def(
+        "draw_mask",
+        &PainterWrapper::DrawMask, R"docstr(
+        Fills the set pixels of a bit-packed mask.
+
+        The mask is drawn at its native resolution, *i.e.* each set bit
+        covers one canvas pixel.
+
+        **Corresponding C++ API:** ``viren2d::Painter::DrawMask``.
+
+        Args:
+          mask: The :class:`~viren2d.PackedMask`, for example computed
+            via :func:`~viren2d.mask_color_range_packed`.
+          color: Fill color as :class:`~viren2d.Color`. Its alpha value
+            defines the opacity of the overlay.
+          position: The position of the reference point where
+            to anchor the mask as :class:`~viren2d.Vec2d`.
+          anchor: How to orient the mask with respect to ``position``.
+            Valid inputs are :class:`~viren2d.Anchor` values
+            and their string representations.
+
+        Returns:
+          ``True`` if drawing completed successfully. Otherwise, check the log
+          messages. Drawing errors are most likely caused by invalid inputs.
+
+        Example:
+          >>> mask = viren2d.mask_color_range_packed(img, hue_range=(90, 150))
+          >>> painter.set_canvas_image(img)
+          >>> painter.draw_mask(mask, color='crimson!60')
+        )docstr",
+        py::arg("mask"),
+        py::arg("color"),
+        py::arg("position") = Vec2d(0.0, 0.0),
+        py::arg("anchor") = Anchor::TopLeft);
+
+
   //----------------------------------------------------------------------
   painter.def(
         "draw_polygon",
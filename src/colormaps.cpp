@@ -11,8 +11,10 @@
 #include <viren2d/colormaps.h>
 
 #include <helpers/colormaps_helpers.h>
+#include <helpers/imagebuffer_access.h>
 #include <helpers/enum.h>
 #include <helpers/logging.h>
+#include <helpers/parallel.h>
 
 namespace wks = werkzeugkiste::strings;
 
@@ -33,20 +35,24 @@ ImageBuffer ColorLookupScaled(
   int rows = data.Height();
   int cols = data.Width();
 
-  if (data.IsContiguous()) {
+  if (data.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
-  for (int row = 0; row < rows; ++row) {
-    const _Tp *data_ptr = data.ImmutablePtr<_Tp>(row, 0, 0);
-    unsigned char *dst_ptr = dst.MutablePtr<unsigned char>(row, 0, 0);
-    for (int col = 0; col < cols; ++col) {
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        rows, cols, 8,
+        [&](int row, int col_begin, int col_end) {
+    // The data may be a view (e.g. a single channel of an interleaved
+    // image), thus it must be accessed via its pixel stride.
+    unsigned char *dst_ptr = out.Ptr<unsigned char>(row, col_begin, 0);
+    for (int col = col_begin; col < col_end; ++col) {
       const double value = std::max(
             limit_low,
             std::min(
               limit_high,
-              static_cast<double>(*data_ptr)));
+              static_cast<double>(data.AtUnchecked<_Tp>(row, col, 0))));
       const int bin = std::max(
             0, std::min(
               map_bins, static_cast<int>(
@@ -58,9 +64,8 @@ ImageBuffer ColorLookupScaled(
       if (output_channels == 4) {
         *dst_ptr++ = 255;
       }
-      ++data_ptr;
     }
-  }
+  });
 
   return dst;
 }
@@ -81,25 +86,27 @@ ImageBuffer Label2Image(
   int rows = data.Height();
   int cols = data.Width();
 
-  if (data.IsContiguous()) {
+  if (data.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
-  for (int row = 0; row < rows; ++row) {
-    const _Tp *data_ptr = data.ImmutablePtr<_Tp>(row, 0, 0);
-    unsigned char *dst_ptr = dst.MutablePtr<unsigned char>(row, 0, 0);
-    for (int col = 0; col < cols; ++col) {
-      const std::size_t bin = static_cast<std::size_t>(*data_ptr) % num_colors;
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        rows, cols, 4,
+        [&](int row, int col_begin, int col_end) {
+    unsigned char *dst_ptr = out.Ptr<unsigned char>(row, col_begin, 0);
+    for (int col = col_begin; col < col_end; ++col) {
+      const std::size_t bin = static_cast<std::size_t>(
+            data.AtUnchecked<_Tp>(row, col, 0)) % num_colors;
       *dst_ptr++ = map[bin].red;
       *dst_ptr++ = map[bin].green;
       *dst_ptr++ = map[bin].blue;
       if (output_channels == 4) {
         *dst_ptr++ = 255;
       }
-      ++data_ptr;
     }
-  }
+  });
 
   return dst;
 }
@@ -588,6 +595,14 @@ ImageBuffer ColorizeScaled(
     case ImageBufferType::Double:
       return helpers::ColorLookupScaled<double>(
             data, map.first, map.second, limit_low, limit_high, output_channels, bins);
+
+    case ImageBufferType::Float16:
+      return helpers::ColorLookupScaled<float16_t>(
+            data, map.first, map.second, limit_low, limit_high, output_channels, bins);
+
+    case ImageBufferType::BFloat16:
+      return helpers::ColorLookupScaled<bfloat16_t>(
+            data, map.first, map.second, limit_low, limit_high, output_channels, bins);
   }
 
   std::string s("Type `");
@@ -650,8 +665,10 @@ ImageBuffer ColorizeLabels(
 
     case ImageBufferType::Float:
     case ImageBufferType::Double:
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16:
         throw std::invalid_argument(
-              "Labels must be of integral type, not float/double!");
+              "Labels must be of integral type, not floating point!");
   }
 
   std::string s("Type `");
@@ -693,26 +710,28 @@ ImageBuffer ReliefShading(const ImageBuffer &relief, const ImageBuffer &colorize
 
   int rows = data_float.Height();
   int cols = data_float.Width();
-  // The deeply copied dst will always be contiguous.
-  if (data_float.IsContiguous()) {
+  // The deeply copied dst may have padded rows.
+  if (data_float.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
-  unsigned char *prow_dst;
-  const float *prow_data;
-  for (int row = 0; row < rows; ++row) {
-    prow_dst = dst.MutablePtr<unsigned char>(row, 0, 0);
-    prow_data = data_float.ImmutablePtr<float>(row, 0, 0);
+  const helpers::PixelWriter out(dst);
+  helpers::ParallelForPixels(
+        rows, cols, 2 * colorized.Channels(),
+        [&](int row, int col_begin, int col_end) {
+    unsigned char *prow_dst = out.Ptr<unsigned char>(row, col_begin, 0);
 
-    for (int data_col = 0, color_idx = 0; data_col < cols; ++data_col) {
+    for (int data_col = col_begin, color_idx = 0;
+         data_col < col_end; ++data_col) {
+      const float shade = data_float.AtUnchecked<float>(row, data_col, 0);
       for (int ch = 0; ch < colorized.Channels(); ++ch) {
         prow_dst[color_idx] = static_cast<unsigned char>(
-              prow_data[data_col] * prow_dst[color_idx]);
+              shade * prow_dst[color_idx]);
         ++color_idx;
       }
     }
-  }
+  });
 
   return dst;
 }
@@ -728,11 +747,12 @@ ImageBuffer Peaks(int height, int width) {
   const double step_x = 6.0 / width;
   const double step_y = 6.0 / height;
 
+  const helpers::PixelWriter out(dst);
   double y = -3.0;
   for (int row = 0; row < height; ++row) {
     double x = -3.0;
     for (int col = 0; col < width; ++col) {
-      dst.AtUnchecked<double>(row, col, 0) =
+      out.At<double>(row, col, 0) =
           (3.0 * ((1.0 - x) * (1.0 - x)) * std::exp(-(x * x) - ((y + 1.0) * (y + 1.0))))
           - (10.0 * (x / 5.0 - (x * x * x) - (y * y * y * y * y)) * std::exp(-(x * x) - (y * y)))
           - (1.0 / 3.0 * std::exp(-((x + 1.0) * (x + 1.0)) - (y * y)));
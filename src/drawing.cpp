@@ -17,6 +17,7 @@
 
 // private viren2d headers
 #include <helpers/drawing_helpers.h>
+#include <helpers/imagebuffer_rgba.h>
 #include <helpers/logging.h>
 
 
@@ -215,6 +216,19 @@ protected:
   }
 
 
+  bool DrawMaskImpl(
+      const PackedMask &mask, const Color &color,
+      const Vec2d &position, Anchor anchor) override {
+    SPDLOG_DEBUG(
+          "DrawMask: {:s}, color={:s} at {:s}, anchor={:s}.",
+          mask.ToString(), color.ToString(), position.ToString(),
+          AnchorToString(anchor));
+
+    return helpers::DrawMask(
+          surface_, context_, mask, color, position, anchor);
+  }
+
+
   bool DrawMarkersImpl(
       const std::vector<std::pair<Vec2d, Color>> &markers,
       const MarkerStyle &style) override {
@@ -529,47 +543,51 @@ void PainterImpl::SetCanvas(const ImageBuffer &image_buffer) {
     throw std::invalid_argument(msg);
   }
 
-  if (image_buffer.Channels() != 4) {
-    SetCanvas(image_buffer.ToChannels(4));
-  } else {
-    // Currently, we clean up previously created contexts/surfaces to
-    // avoid unnecessarily cluttering the implementation. Then, we
-    // copy the given ImageBuffer.
-    // If this becomes a bottleneck, we need to provide a boolean "copy"
-    // flag and distinguish 4 scenarios:
-    // * copy-flag true, existing data --> check if it surface can
-    //   be reused (memcpy)
-    // * copy-flag true, no surface --> malloc(surface create) + memcpy
-    // * copy-flag false, existing data --> clean up data, reuse surface
-    // * copy-flag false, no surface --> surface create_for_data
-    if (context_) {
-      SPDLOG_TRACE("SetCanvas: Releasing previous Cairo context.");
-      cairo_destroy(context_);
-      context_ = nullptr;
-    }
-
-    if (surface_) {
-      SPDLOG_TRACE("SetCanvas: Releasing previous Cairo surface.");
-      cairo_surface_destroy(surface_);
-      surface_ = nullptr;
-    }
+  // Currently, we clean up previously created contexts/surfaces to
+  // avoid unnecessarily cluttering the implementation. Then, we
+  // copy the given ImageBuffer.
+  // If this becomes a bottleneck, we need to provide a boolean "copy"
+  // flag and distinguish 4 scenarios:
+  // * copy-flag true, existing data --> check if it surface can
+  //   be reused (memcpy)
+  // * copy-flag true, no surface --> malloc(surface create) + memcpy
+  // * copy-flag false, existing data --> clean up data, reuse surface
+  // * copy-flag false, no surface --> surface create_for_data
+  SPDLOG_TRACE(
+        "SetCanvas: Creating Cairo surface and context from image buffer.");
+  cairo_surface_t *surface = cairo_image_surface_create(
+        CAIRO_FORMAT_ARGB32, image_buffer.Width(), image_buffer.Height());
+  // Convert (type & number of channels) and copy the image buffer in a
+  // single pass, directly into the surface's memory. This also takes
+  // care of padded rows, differing strides and non-packed pixels.
+  // Invalid inputs (e.g. unsupported number of channels) will throw
+  // before we touch the current canvas.
+  try {
+    helpers::ConvertToRGBA8(
+          image_buffer, cairo_image_surface_get_data(surface),
+          cairo_image_surface_get_stride(surface));
+  } catch (...) {
+    cairo_surface_destroy(surface);
+    throw;
+  }
 
-    SPDLOG_TRACE(
-          "SetCanvas: Creating Cairo surface and context from image buffer.");
-    surface_ = cairo_image_surface_create(
-          CAIRO_FORMAT_ARGB32, image_buffer.Width(), image_buffer.Height());
-    //FIXME refactor - check stride/memory alignment before copying!
-    // make it reusable in DrawImage (create surface_t for image; add flag to
-    // "try" copying (if the memory alignment is suitable)
-    std::memcpy(
-          cairo_image_surface_get_data(surface_),
-          image_buffer.ImmutableData(),
-          4 * image_buffer.Width() * image_buffer.Height());
-    context_ = cairo_create(surface_);
+  if (context_) {
+    SPDLOG_TRACE("SetCanvas: Releasing previous Cairo context.");
+    cairo_destroy(context_);
+    context_ = nullptr;
+  }
 
-    // Ensure that the underlying image surface will be rendered immediately:
-    cairo_surface_mark_dirty(surface_);
+  if (surface_) {
+    SPDLOG_TRACE("SetCanvas: Releasing previous Cairo surface.");
+    cairo_surface_destroy(surface_);
+    surface_ = nullptr;
   }
+
+  surface_ = surface;
+  context_ = cairo_create(surface_);
+
+  // Ensure that the underlying image surface will be rendered immediately:
+  cairo_surface_mark_dirty(surface_);
 }
 
 
@@ -606,9 +624,14 @@ ImageBuffer PainterImpl::GetCanvas(bool copy) const {
           data, height, width, channels,
           row_stride, channels, 1, ImageBufferType::UInt8);
   } else {
+    // The buffer keeps the surface alive, even if the painter
+    // switches to a new canvas in the meantime.
+    std::shared_ptr<void> surface(
+          cairo_surface_reference(surface_), cairo_surface_destroy);
     buffer.CreateSharedBuffer(
           data, height, width, channels,
-          row_stride, channels, ImageBufferType::UInt8);
+          row_stride, channels, 1, ImageBufferType::UInt8,
+          std::move(surface));
   }
   return buffer;
 }
@@ -0,0 +1,38 @@
+#ifndef __VIREN2D_ALLOCATORS_HELPERS_H__
+#define __VIREN2D_ALLOCATORS_HELPERS_H__
+
+#include <cstdint>
+#include <memory>
+
+#include <viren2d/allocators.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Returns the thread-local allocator override, which is empty unless a
+/// `ScopedImageBufferAllocator` is active on the calling thread.
+std::shared_ptr<ImageBufferAllocator> &ThreadLocalAllocator();
+
+
+/// Returns the allocator which is currently used by the calling thread,
+/// see `GetImageBufferAllocator`. In contrast to the latter, this neither
+/// copies the shared pointer nor loads the global allocator atomically
+/// (unless it has been replaced since the last call on this thread).
+const std::shared_ptr<ImageBufferAllocator> &ActiveAllocator();
+
+
+/// Allocates the storage for an ImageBuffer via the currently active
+/// allocator. The `shared_ptr` control block is placed in front of the
+/// pixels, *i.e.* within the same memory block. Thus, a buffer requires
+/// a single allocation (or none at all, if served by a `PoolAllocator`).
+/// The returned pointer is aligned to `kImageBufferAlignment`. The
+/// storage keeps a reference to the allocator, so the memory will be
+/// returned to the allocator it came from.
+/// Returns an empty pointer if allocation fails.
+std::shared_ptr<unsigned char> AllocateStorage(int64_t num_bytes);
+
+}  // namespace helpers
+}  // namespace viren2d
+
+#endif  // __VIREN2D_ALLOCATORS_HELPERS_H__
@@ -1,6 +1,10 @@
 #ifndef __VIREN2D_COLOR_CONVERSION_HELPERS_H__
 #define __VIREN2D_COLOR_CONVERSION_HELPERS_H__
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <utility>
 #include <tuple>
 
@@ -60,12 +64,32 @@ inline std::tuple<float, float, float> CvtHelperRGB2HSV(
 }
 
 
+/// Converts one r,g,b (in [0, 255]) value to the uint8 HSV representation
+/// of `ConvertRGB2HSV`, *i.e.* hue in [0, 180], saturation & value
+/// in [0, 255].
+template <typename _Tp> inline
+void CvtHelperRGB2HSVUInt8(
+    _Tp red, _Tp green, _Tp blue, unsigned char *hsv) {
+  float hue, sat, val;
+  std::tie(hue, sat, val) = CvtHelperRGB2HSV(
+        red / 255.0f, green / 255.0f, blue / 255.0f);
+
+  // Sacrifice angular resolution to fit into uint8:
+  hsv[0] = static_cast<unsigned char>(hue / 2.0f);
+  hsv[1] = static_cast<unsigned char>(255.0f * sat);
+  hsv[2] = static_cast<unsigned char>(255.0f * val);
+}
+
+
 /// Converts one HSV value (hue in [0, 360], saturation & value in [0, 1]) to
 /// r,g,b (in [0, 1]).
 inline std::tuple<float, float, float> CvtHelperHSV2RGB(
     float hue, float sat, float val) {
-  const int hue_bin = static_cast<int>(hue / 60.0f) % 6;
-  const float rem = (hue / 60.0f) - hue_bin;
+  // The remainder must be computed before wrapping the sector, otherwise
+  // hue = 360 would yield invalid colors.
+  const int hue_sector = static_cast<int>(hue / 60.0f);
+  const int hue_bin = hue_sector % 6;
+  const float rem = (hue / 60.0f) - hue_sector;
   const float p  = val * (1.0f - sat);
   const float q  = val * (1.0f - sat * rem);
   const float t  = val * (1.0f - sat * (1.0f - rem));
@@ -110,6 +134,185 @@ _Tp CvtHelperRGB2Gray(_Tp red, _Tp green, _Tp blue) {
       (0.2989 * red) + (0.5870 * green) + (0.1141 * blue));
 }
 
+
+//-------------------------------------------------------------------- Lab
+// Conversion between sRGB and CIE L*a*b* (D65 white point), see
+// http://www.brucelindbloom.com for the formulas and constants. The
+// helpers below are shared by the scalar and the vectorized kernels:
+// they only use operations which exist as SIMD instructions, in the same
+// order, so that all kernels yield identical results.
+
+/// D65 reference white.
+constexpr double kWhiteX = 0.95047;
+constexpr double kWhiteZ = 1.08883;
+
+/// Linear sRGB to XYZ, where the rows are normalized by the reference
+/// white (*i.e.* white maps to (1, 1, 1)).
+constexpr float kRGB2XYZ[9] = {
+  static_cast<float>(0.4124564 / kWhiteX),
+  static_cast<float>(0.3575761 / kWhiteX),
+  static_cast<float>(0.1804375 / kWhiteX),
+  0.2126729f, 0.7151522f, 0.0721750f,
+  static_cast<float>(0.0193339 / kWhiteZ),
+  static_cast<float>(0.1191920 / kWhiteZ),
+  static_cast<float>(0.9503041 / kWhiteZ)
+};
+
+/// Inverse of `kRGB2XYZ`, *i.e.* from white-normalized XYZ to linear sRGB.
+constexpr float kXYZ2RGB[9] = {
+  static_cast<float>(3.2404542 * kWhiteX), -1.5371385f,
+  static_cast<float>(-0.4985314 * kWhiteZ),
+  static_cast<float>(-0.9692660 * kWhiteX), 1.8760108f,
+  static_cast<float>(0.0415560 * kWhiteZ),
+  static_cast<float>(0.0556434 * kWhiteX), -0.2040259f,
+  static_cast<float>(1.0572252 * kWhiteZ)
+};
+
+/// CIE constants, *i.e.* 216/24389 and 24389/27.
+constexpr float kLabEpsilon = static_cast<float>(216.0 / 24389.0);
+constexpr float kLabKappa = static_cast<float>(24389.0 / 27.0);
+
+/// Scaling of the uint8 L*a*b* representation, which uses the
+/// full range for L* and shifts a* and b* by 128.
+constexpr float kLabLToUInt8 = 255.0f / 100.0f;
+constexpr float kLabLFromUInt8 = 100.0f / 255.0f;
+constexpr float kLabABOffset = 128.0f;
+
+
+/// Number of intervals of the sRGB gamma lookup tables, which
+/// are linearly interpolated for float inputs.
+constexpr int kGammaLUTSize = 4096;
+
+
+/// Lookup tables for the sRGB transfer function.
+struct SRGBGammaLUT {
+  /// Linear values of all uint8 inputs (exact).
+  float linearize_uint8[256];
+
+  /// Samples of the sRGB to linear transfer function on [0, 1].
+  float linearize[kGammaLUTSize + 1];
+
+  /// Samples of the linear to sRGB transfer function on [0, 1].
+  float compress[kGammaLUTSize + 1];
+
+  SRGBGammaLUT() {
+    const auto to_linear = [](double v) {
+      return static_cast<float>((v <= 0.04045)
+          ? (v / 12.92) : std::pow((v + 0.055) / 1.055, 2.4));
+    };
+    const auto to_srgb = [](double v) {
+      return static_cast<float>((v <= 0.0031308)
+          ? (12.92 * v) : (1.055 * std::pow(v, 1.0 / 2.4) - 0.055));
+    };
+
+    for (int i = 0; i < 256; ++i) {
+      linearize_uint8[i] = to_linear(i / 255.0);
+    }
+    for (int i = 0; i <= kGammaLUTSize; ++i) {
+      linearize[i] = to_linear(static_cast<double>(i) / kGammaLUTSize);
+      compress[i] = to_srgb(static_cast<double>(i) / kGammaLUTSize);
+    }
+  }
+};
+
+
+/// Returns the (lazily initialized) sRGB gamma lookup tables.
+inline const SRGBGammaLUT &SRGBGamma() {
+  static const SRGBGammaLUT lut;
+  return lut;
+}
+
+
+/// Clamps to [0, 1], where NaN maps to 0. Written to match the
+/// semantics of the SSE/AVX max & min instructions.
+inline float ClampUnit(float x) {
+  x = (x > 0.0f) ? x : 0.0f;
+  return (x < 1.0f) ? x : 1.0f;
+}
+
+
+/// Rounds (half up) and saturates to [0, 255].
+inline unsigned char RoundSaturateUInt8(float x) {
+  x = std::floor(x + 0.5f);
+  x = (x > 0.0f) ? x : 0.0f;
+  x = (x < 255.0f) ? x : 255.0f;
+  return static_cast<unsigned char>(x);
+}
+
+
+/// Linearly interpolates the gamma lookup table at x in [0, 1].
+inline float InterpolateGammaLUT(const float *lut, float x) {
+  const float pos = x * static_cast<float>(kGammaLUTSize);
+  const int idx = std::min(static_cast<int>(pos), kGammaLUTSize - 1);
+  const float frac = pos - static_cast<float>(idx);
+  return lut[idx] + frac * (lut[idx + 1] - lut[idx]);
+}
+
+
+/// Cube root of a positive value. The initial guess is computed from the
+/// float representation and refined by 3 Newton iterations, which
+/// yields (almost) full float precision without `std::cbrt`.
+inline float CubeRoot(float x) {
+  int32_t bits;
+  std::memcpy(&bits, &x, sizeof(float));
+  bits = static_cast<int32_t>(static_cast<float>(bits) * (1.0f / 3.0f))
+      + 709921077;
+  float y;
+  std::memcpy(&y, &bits, sizeof(float));
+  for (int iter = 0; iter < 3; ++iter) {
+    y = (2.0f * y + x / (y * y)) / 3.0f;
+  }
+  return y;
+}
+
+
+/// The nonlinear compression of the L*a*b* transform.
+inline float LabF(float t) {
+  return (t > kLabEpsilon)
+      ? CubeRoot(t) : ((kLabKappa * t + 16.0f) / 116.0f);
+}
+
+
+/// Inverse of `LabF`.
+inline float LabFInv(float f) {
+  const float f3 = f * f * f;
+  return (f3 > kLabEpsilon) ? f3 : ((116.0f * f - 16.0f) / kLabKappa);
+}
+
+
+/// Converts one linear r,g,b value (in [0, 1]) to L*a*b*, with
+/// L* in [0, 100] and a*, b* approximately in [-128, 127].
+inline void CvtHelperLinearRGB2Lab(
+    float red, float green, float blue, float *lab) {
+  const float x = (kRGB2XYZ[0] * red + kRGB2XYZ[1] * green)
+      + kRGB2XYZ[2] * blue;
+  const float y = (kRGB2XYZ[3] * red + kRGB2XYZ[4] * green)
+      + kRGB2XYZ[5] * blue;
+  const float z = (kRGB2XYZ[6] * red + kRGB2XYZ[7] * green)
+      + kRGB2XYZ[8] * blue;
+  const float fx = LabF(x);
+  const float fy = LabF(y);
+  const float fz = LabF(z);
+  lab[0] = 116.0f * fy - 16.0f;
+  lab[1] = 500.0f * (fx - fy);
+  lab[2] = 200.0f * (fy - fz);
+}
+
+
+/// Converts one L*a*b* value to linear r,g,b (not clamped).
+inline void CvtHelperLab2LinearRGB(
+    float l, float a, float b, float *rgb) {
+  const float fy = (l + 16.0f) / 116.0f;
+  const float fx = fy + a / 500.0f;
+  const float fz = fy - b / 200.0f;
+  const float x = LabFInv(fx);
+  const float y = LabFInv(fy);
+  const float z = LabFInv(fz);
+  rgb[0] = (kXYZ2RGB[0] * x + kXYZ2RGB[1] * y) + kXYZ2RGB[2] * z;
+  rgb[1] = (kXYZ2RGB[3] * x + kXYZ2RGB[4] * y) + kXYZ2RGB[5] * z;
+  rgb[2] = (kXYZ2RGB[6] * x + kXYZ2RGB[7] * y) + kXYZ2RGB[8] * z;
+}
+
 } // namespace helpers
 } // namespace viren2d
 
@@ -477,6 +477,12 @@ bool DrawMarker(
     Vec2d pos, const MarkerStyle &style);
 
 
+bool DrawMask(
+    cairo_surface_t *surface, cairo_t *context,
+    const PackedMask &mask, const Color &color,
+    const Vec2d &position, Anchor anchor);
+
+
 bool DrawPolygon(
     cairo_surface_t *surface, cairo_t *context,
     const std::vector<Vec2d> &points,
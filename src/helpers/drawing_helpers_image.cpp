@@ -1,35 +1,34 @@
 // STL
 #include <string>
 #include <exception>
+#include <cstdint>
+#include <vector>
 
 // Non-STL external
 #include <helpers/drawing_helpers.h>
+#include <helpers/imagebuffer_rgba.h>
 #include <helpers/logging.h>
 
 namespace viren2d {
 namespace helpers {
-/// Internal helper which is invoked with a 4-channel uint8 ImageBuffer. Thus,
-/// no buffer conversion is needed.
-bool DrawImageHelper(
-    cairo_t *context, const ImageBuffer &img_u8_c4,
-    const Vec2d &position, Anchor anchor,
-    double alpha, double scale_x, double scale_y,
-    double rotation, double clip_factor,
-    LineStyle line_style) {
-  const int stride = cairo_format_stride_for_width(
+/// Returns true if the 4-channel uint8 ImageBuffer can be used as
+/// the data of a cairo image surface (i.e. without copying). This
+/// requires 4-byte aligned pixels and a sufficiently large row stride
+/// which is a multiple of 4 bytes (such as the default padded rows).
+bool IsCairoCompatible(const ImageBuffer &img_u8_c4) {
+  const int min_stride = cairo_format_stride_for_width(
       CAIRO_FORMAT_ARGB32, img_u8_c4.Width());
-  if (stride != img_u8_c4.RowStride()) {
-    SPDLOG_ERROR(
-        "ImageBuffer stride {} does not match optimal cairo stride {}!",
-        img_u8_c4.RowStride(), stride);
-    return false;
-  }
+  return (img_u8_c4.PixelStride() == 4)
+      && img_u8_c4.HasContiguousChannels()
+      && (img_u8_c4.RowStride() >= min_stride)
+      && ((img_u8_c4.RowStride() % 4) == 0)
+      && ((reinterpret_cast<std::uintptr_t>(img_u8_c4.ImmutableData()) % 4) == 0);
+}
 
-  cairo_save(context);
-  cairo_translate(context, position.X(), position.Y());
-  cairo_rotate(context, rotation * 3.14159 / 180.0);
-  cairo_scale(context, scale_x, scale_y);
 
+/// Returns the offset of an image's top-left corner with respect
+/// to the given anchor point.
+Vec2d ImageAnchorOffset(Anchor anchor, int width, int height) {
   Vec2d pattern_offset{0, 0};
   switch(anchor) {
     case Anchor::TopLeft:
@@ -37,37 +36,64 @@ bool DrawImageHelper(
       break;
 
     case Anchor::Top:
-      pattern_offset = Vec2d(-img_u8_c4.Width() / 2.0, 0.0);
+      pattern_offset = Vec2d(-width / 2.0, 0.0);
       break;
 
     case Anchor::TopRight:
-      pattern_offset = Vec2d(-img_u8_c4.Width(), 0.0);
+      pattern_offset = Vec2d(-width, 0.0);
       break;
 
     case Anchor::Right:
-      pattern_offset = Vec2d(-img_u8_c4.Width(), -img_u8_c4.Height() / 2.0);
+      pattern_offset = Vec2d(-width, -height / 2.0);
       break;
 
     case Anchor::BottomRight:
-      pattern_offset = Vec2d(-img_u8_c4.Width(), -img_u8_c4.Height());
+      pattern_offset = Vec2d(-width, -height);
       break;
 
     case Anchor::Bottom:
-      pattern_offset = Vec2d(-img_u8_c4.Width() / 2.0, -img_u8_c4.Height());
+      pattern_offset = Vec2d(-width / 2.0, -height);
       break;
 
     case Anchor::BottomLeft:
-      pattern_offset = Vec2d(0.0, -img_u8_c4.Height());
+      pattern_offset = Vec2d(0.0, -height);
       break;
 
     case Anchor::Left:
-      pattern_offset = Vec2d(0.0, -img_u8_c4.Height() / 2.0);
+      pattern_offset = Vec2d(0.0, -height / 2.0);
       break;
 
     case Anchor::Center:
-      pattern_offset = Vec2d(-img_u8_c4.Width() / 2.0, -img_u8_c4.Height() / 2.0);
+      pattern_offset = Vec2d(-width / 2.0, -height / 2.0);
       break;
   }
+  return pattern_offset;
+}
+
+
+/// Internal helper which is invoked with a 4-channel uint8 ImageBuffer. Thus,
+/// no buffer conversion is needed.
+bool DrawImageHelper(
+    cairo_t *context, const ImageBuffer &img_u8_c4,
+    const Vec2d &position, Anchor anchor,
+    double alpha, double scale_x, double scale_y,
+    double rotation, double clip_factor,
+    LineStyle line_style) {
+  if (!IsCairoCompatible(img_u8_c4)) {
+    SPDLOG_ERROR(
+        "ImageBuffer layout (row stride {}, pixel stride {}) is not "
+        "compatible with cairo!",
+        img_u8_c4.RowStride(), img_u8_c4.PixelStride());
+    return false;
+  }
+
+  cairo_save(context);
+  cairo_translate(context, position.X(), position.Y());
+  cairo_rotate(context, rotation * 3.14159 / 180.0);
+  cairo_scale(context, scale_x, scale_y);
+
+  const Vec2d pattern_offset = ImageAnchorOffset(
+        anchor, img_u8_c4.Width(), img_u8_c4.Height());
 
   cairo_path_t *image_contour = nullptr;
   const bool need_contour = line_style.IsValid();
@@ -124,13 +150,14 @@ bool DrawImageHelper(
   // Paint the image onto the (already clipped) canvas.
   // Removing the const-ness is not a problem, because the cairo image
   // surface is only used to copy the data onto the canvas. There will be
-  // no write access.
+  // no write access. Thus, we also don't need to detach a (potentially)
+  // shared copy-on-write storage via `MutableData`.
   cairo_surface_t *imsurf = cairo_image_surface_create_for_data(
-        const_cast<ImageBuffer &>(img_u8_c4).MutableData(),
+        const_cast<unsigned char *>(img_u8_c4.ImmutableData()),
         CAIRO_FORMAT_ARGB32,
         img_u8_c4.Width(),
         img_u8_c4.Height(),
-        img_u8_c4.RowStride());
+        static_cast<int>(img_u8_c4.RowStride()));
   cairo_set_source_surface(
         context, imsurf, pattern_offset.X(), pattern_offset.Y());
   cairo_paint_with_alpha(context, alpha);
@@ -166,19 +193,94 @@ bool DrawImage(
     return false;
   }
 
+  // Buffers allocated by viren2d have padded rows which are
+  // suitable for cairo. All other types & layouts (e.g. channel
+  // views) are converted and copied in a single pass.
   if ((image.BufferType() == ImageBufferType::UInt8)
-      && (image.Channels() == 4)) {
+      && (image.Channels() == 4)
+      && IsCairoCompatible(image)) {
     return DrawImageHelper(
           context, image, position, anchor,
           alpha, scale_x, scale_y, rotation, clip_factor,
           line_style);
-  } else {
-    ImageBuffer img_u8_c4 = image.ToUInt8(4);
-    return DrawImageHelper(
-          context, img_u8_c4, position, anchor,
-          alpha, scale_x, scale_y, rotation, clip_factor,
-          line_style);
   }
+
+  return DrawImageHelper(
+        context, ToRGBA8(image), position, anchor,
+        alpha, scale_x, scale_y, rotation, clip_factor,
+        line_style);
+}
+
+
+bool DrawMask(
+    cairo_surface_t *surface, cairo_t *context,
+    const PackedMask &mask, const Color &color,
+    const Vec2d &position, Anchor anchor) {
+  if (!CheckCanvas(surface, context)) {
+    return false;
+  }
+
+  if (!mask.IsValid()) {
+    SPDLOG_ERROR("Cannot draw an invalid PackedMask!");
+    return false;
+  }
+
+  if (!color.IsValid()) {
+    SPDLOG_ERROR("Cannot draw a PackedMask with an invalid color!");
+    return false;
+  }
+
+  // The packed mask stores its bits LSB-first within 64-bit words and
+  // its rows are padded to a multiple of 8 bytes. On little endian
+  // systems, this is exactly cairo's A1 layout, so the mask can be used
+  // without copying. Otherwise, the bits have to be reordered within
+  // each 32-bit word.
+  const int width = mask.Width();
+  const int height = mask.Height();
+  const uint16_t endian_probe = 1;
+  const bool is_little_endian =
+      (*reinterpret_cast<const uint8_t *>(&endian_probe) == 1);
+
+  std::vector<uint32_t> repacked;
+  int stride = static_cast<int>(mask.RowStride());
+  unsigned char *data = const_cast<unsigned char *>(
+        reinterpret_cast<const unsigned char *>(mask.RowPtr(0)));
+
+  if (!is_little_endian) {
+    stride = cairo_format_stride_for_width(CAIRO_FORMAT_A1, width);
+    const int words_per_row = stride / 4;
+    repacked.resize(static_cast<std::size_t>(words_per_row) * height, 0);
+    for (int row = 0; row < height; ++row) {
+      uint32_t *dst_row = repacked.data()
+          + static_cast<std::size_t>(row) * words_per_row;
+      for (int col = 0; col < width; ++col) {
+        if (mask.IsSet(row, col)) {
+          // Cairo stores A1 pixels MSB-first on big endian systems.
+          dst_row[col >> 5] |= (0x80000000u >> (col & 31));
+        }
+      }
+    }
+    data = reinterpret_cast<unsigned char *>(repacked.data());
+  }
+
+  cairo_surface_t *mask_surf = cairo_image_surface_create_for_data(
+        data, CAIRO_FORMAT_A1, width, height, stride);
+  if (cairo_surface_status(mask_surf) != CAIRO_STATUS_SUCCESS) {
+    SPDLOG_ERROR(
+        "Could not create a cairo A1 surface for {:s}!", mask.ToString());
+    cairo_surface_destroy(mask_surf);
+    return false;
+  }
+
+  const Vec2d offset = ImageAnchorOffset(anchor, width, height);
+  cairo_save(context);
+  cairo_translate(context, position.X(), position.Y());
+  ApplyColor(context, color);
+  cairo_mask_surface(context, mask_surf, offset.X(), offset.Y());
+  cairo_restore(context);
+
+  cairo_surface_destroy(mask_surf);
+  return true;
 }
 } // namespace helpers
 } // namespace viren2d
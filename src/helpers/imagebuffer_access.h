@@ -0,0 +1,73 @@
+#ifndef __VIREN2D_IMAGEBUFFER_ACCESS_H__
+#define __VIREN2D_IMAGEBUFFER_ACCESS_H__
+
+#include <cstdint>
+
+#include <viren2d/imagebuffer.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Writable access to the pixels of an ImageBuffer for the duration of a
+/// single operation. The (copy-on-write) storage is detached once upon
+/// construction, so that the rows can afterwards be written from multiple
+/// threads without the per-access checks of `MutablePtr`.
+///
+/// In contrast to `MutableData`, the buffer remains shareable. Thus, the
+/// pointers must not be used after the operation has finished.
+class PixelWriter {
+public:
+  /// Throws a `std::logic_error` if the buffer is read-only.
+  explicit PixelWriter(ImageBuffer &buffer)
+    : data_(buffer.DetachForWriting()),
+      row_stride_(buffer.RowStride()),
+      pixel_stride_(buffer.PixelStride()),
+      channel_stride_(buffer.ChannelStride()) {}
+
+
+  /// Returns a pointer to the first byte of the pixel memory.
+  inline unsigned char *Data() const { return data_; }
+
+
+  /// Returns the number of bytes between two consecutive pixels.
+  inline int64_t PixelStride() const { return pixel_stride_; }
+
+
+  /// Returns the number of bytes between two consecutive channels.
+  inline int64_t ChannelStride() const { return channel_stride_; }
+
+
+  /// Returns a pointer to the specified element.
+  template <typename _Tp> inline
+  _Tp *Ptr(int row, int col, int channel = 0) const {
+    return reinterpret_cast<_Tp *>(
+          data_ + row * row_stride_ + col * pixel_stride_
+          + channel * channel_stride_);
+  }
+
+
+  /// Returns a pointer to the first element of the given row.
+  template <typename _Tp> inline
+  _Tp *Row(int row) const {
+    return reinterpret_cast<_Tp *>(data_ + row * row_stride_);
+  }
+
+
+  /// Returns a reference to the specified element.
+  template <typename _Tp> inline
+  _Tp &At(int row, int col, int channel = 0) const {
+    return *Ptr<_Tp>(row, col, channel);
+  }
+
+private:
+  unsigned char *data_;
+  int64_t row_stride_;
+  int64_t pixel_stride_;
+  int64_t channel_stride_;
+};
+
+}  // namespace helpers
+}  // namespace viren2d
+
+#endif  // __VIREN2D_IMAGEBUFFER_ACCESS_H__
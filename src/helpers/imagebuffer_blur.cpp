@@ -0,0 +1,485 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <helpers/imagebuffer_blur.h>
+#include <helpers/imagebuffer_access.h>
+#include <helpers/logging.h>
+#include <helpers/parallel.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// An axis-aligned pixel region, *i.e.* [left, left + width) x
+/// [top, top + height).
+struct PixelRegion {
+  int left = 0;
+  int top = 0;
+  int width = 0;
+  int height = 0;
+
+  inline int Right() const { return left + width; }
+  inline int Bottom() const { return top + height; }
+
+  inline bool Overlaps(const PixelRegion &other) const {
+    return (left < other.Right()) && (other.left < Right())
+        && (top < other.Bottom()) && (other.top < Bottom());
+  }
+};
+
+
+/// A region which will be blurred and its working memory. The `source`
+/// region is extended by the filter's reach, so that the blurred `target`
+/// pixels also take the surrounding pixels into account.
+template <typename _Acc>
+struct BlurTask {
+  PixelRegion target;
+  PixelRegion source;
+  std::vector<_Acc> values;
+  std::vector<_Acc> temp;
+};
+
+
+inline int ClampIndex(int idx, int size) {
+  return std::min(std::max(idx, 0), size - 1);
+}
+
+
+/// Converts the averaged value, rounding & saturating integral types.
+template <typename _Tp, typename _Acc> inline
+_Tp CastAveraged(_Acc value) {
+  if constexpr (!std::numeric_limits<_Tp>::is_integer) {
+    return static_cast<_Tp>(value);
+  } else {
+    const _Acc rounded = std::floor(value + static_cast<_Acc>(0.5));
+    if (!(rounded > static_cast<_Acc>(std::numeric_limits<_Tp>::lowest()))) {
+      return std::numeric_limits<_Tp>::lowest();
+    }
+    if (rounded >= static_cast<_Acc>(std::numeric_limits<_Tp>::max())) {
+      return std::numeric_limits<_Tp>::max();
+    }
+    return static_cast<_Tp>(rounded);
+  }
+}
+
+
+/// Updates a running window sum by the entering value `add` and the
+/// leaving value `sub`. If enabled, non-finite values are only counted,
+/// because they would corrupt the sums of all subsequent windows (*e.g.*
+/// `inf - inf` is NaN). Windows which contain such values must then be
+/// summed explicitly.
+template <bool _CheckFinite, typename _Acc> inline
+void UpdateWindowSum(_Acc add, _Acc sub, double &sum, int &num_nonfinite) {
+  if constexpr (_CheckFinite) {
+    const bool add_finite = std::isfinite(add);
+    const bool sub_finite = std::isfinite(sub);
+    if (!add_finite || !sub_finite) {
+      num_nonfinite += (add_finite ? 0 : 1) - (sub_finite ? 0 : 1);
+      if (add_finite) {
+        sum += add;
+      }
+      if (sub_finite) {
+        sum -= sub;
+      }
+      return;
+    }
+  }
+  sum += add - sub;
+}
+
+
+/// Horizontal running-sum box filter of a packed row with `num_pixels`
+/// pixels. The running sums are kept in double precision, so that the
+/// accumulated rounding error doesn't depend on the row length.
+template <bool _CheckFinite, typename _Acc>
+void BoxFilterRow(
+    const _Acc *in, _Acc *out, int num_pixels, int channels, int radius) {
+  const double scale = 1.0 / (2 * radius + 1);
+  for (int ch = 0; ch < channels; ++ch) {
+    const auto value = [&](int idx) -> _Acc {
+      return in[ClampIndex(idx, num_pixels) * channels + ch];
+    };
+
+    double sum = 0.0;
+    int num_nonfinite = 0;
+    for (int idx = -radius; idx <= radius; ++idx) {
+      UpdateWindowSum<_CheckFinite>(
+            value(idx), static_cast<_Acc>(0), sum, num_nonfinite);
+    }
+    for (int idx = 0; idx < num_pixels; ++idx) {
+      if (num_nonfinite > 0) {
+        double window = 0.0;
+        for (int k = idx - radius; k <= idx + radius; ++k) {
+          window += value(k);
+        }
+        out[idx * channels + ch] = static_cast<_Acc>(window * scale);
+      } else {
+        out[idx * channels + ch] = static_cast<_Acc>(sum * scale);
+      }
+      UpdateWindowSum<_CheckFinite>(
+            value(idx + radius + 1), value(idx - radius), sum, num_nonfinite);
+    }
+  }
+}
+
+
+/// Vertical running-sum box filter of the values [value_begin, value_end)
+/// of all `num_rows` packed rows. The sums of a whole row segment are
+/// updated at once to access the memory sequentially.
+template <bool _CheckFinite, typename _Acc>
+void BoxFilterColumns(
+    const _Acc *in, _Acc *out, int num_rows, int64_t row_values,
+    int64_t value_begin, int64_t value_end, int radius) {
+  const double scale = 1.0 / (2 * radius + 1);
+  std::vector<double> sums(value_end - value_begin, 0.0);
+  std::vector<int> num_nonfinite(
+        _CheckFinite ? (value_end - value_begin) : 0, 0);
+  int unused = 0;
+  const auto nonfinite = [&](int64_t val) -> int & {
+    return _CheckFinite ? num_nonfinite[val - value_begin] : unused;
+  };
+
+  for (int idx = -radius; idx <= radius; ++idx) {
+    const _Acc *in_row = in + ClampIndex(idx, num_rows) * row_values;
+    for (int64_t val = value_begin; val < value_end; ++val) {
+      UpdateWindowSum<_CheckFinite>(
+            in_row[val], static_cast<_Acc>(0),
+            sums[val - value_begin], nonfinite(val));
+    }
+  }
+
+  for (int row = 0; row < num_rows; ++row) {
+    _Acc *out_row = out + row * row_values;
+    const _Acc *in_add = in + ClampIndex(row + radius + 1, num_rows) * row_values;
+    const _Acc *in_sub = in + ClampIndex(row - radius, num_rows) * row_values;
+    for (int64_t val = value_begin; val < value_end; ++val) {
+      double &sum = sums[val - value_begin];
+      if (_CheckFinite && (nonfinite(val) > 0)) {
+        double window = 0.0;
+        for (int k = row - radius; k <= row + radius; ++k) {
+          window += in[ClampIndex(k, num_rows) * row_values + val];
+        }
+        out_row[val] = static_cast<_Acc>(window * scale);
+      } else {
+        out_row[val] = static_cast<_Acc>(sum * scale);
+      }
+      UpdateWindowSum<_CheckFinite>(
+            in_add[val], in_sub[val], sum, nonfinite(val));
+    }
+  }
+}
+
+
+/// Loads the task's source region and applies the separable box filters.
+/// Only reads from the image, so all tasks can run concurrently.
+template <typename _Tp, typename _Acc>
+void BlurSource(
+    const ImageBuffer &image, const unsigned char *data,
+    BlurTask<_Acc> &task, const std::vector<int> &radii) {
+  const int channels = image.Channels();
+  const int num_rows = task.source.height;
+  const int num_pixels = task.source.width;
+  const int64_t row_values = static_cast<int64_t>(num_pixels) * channels;
+  task.values.resize(num_rows * row_values);
+  task.temp.resize(num_rows * row_values);
+
+  ParallelFor(
+        0, num_rows, row_values,
+        [&](int64_t row_begin, int64_t row_end) {
+    for (int64_t row = row_begin; row < row_end; ++row) {
+      const unsigned char *src_ptr = data
+          + (task.source.top + row) * image.RowStride()
+          + task.source.left * image.PixelStride();
+      _Acc *dst_ptr = task.values.data() + row * row_values;
+      for (int col = 0; col < num_pixels; ++col) {
+        for (int ch = 0; ch < channels; ++ch) {
+          *dst_ptr++ = static_cast<_Acc>(*reinterpret_cast<const _Tp *>(
+                src_ptr + ch * image.ChannelStride()));
+        }
+        src_ptr += image.PixelStride();
+      }
+    }
+  });
+
+  // Only floating point images can contain NaN or infinity.
+  constexpr bool check_finite = !std::is_integral<_Tp>::value;
+  for (int radius : radii) {
+    if (radius <= 0) {
+      continue;
+    }
+
+    ParallelFor(
+          0, num_rows, 4 * row_values,
+          [&](int64_t row_begin, int64_t row_end) {
+      for (int64_t row = row_begin; row < row_end; ++row) {
+        BoxFilterRow<check_finite>(
+              task.values.data() + row * row_values,
+              task.temp.data() + row * row_values,
+              num_pixels, channels, radius);
+      }
+    });
+
+    ParallelFor(
+          0, row_values, 4 * num_rows,
+          [&](int64_t value_begin, int64_t value_end) {
+      BoxFilterColumns<check_finite>(
+            task.temp.data(), task.values.data(), num_rows, row_values,
+            value_begin, value_end, radius);
+    });
+  }
+}
+
+
+/// Writes the blurred target region back into the image.
+template <typename _Tp, typename _Acc>
+void StoreTarget(
+    const ImageBuffer &image, unsigned char *data,
+    const BlurTask<_Acc> &task) {
+  const int channels = image.Channels();
+  const int64_t row_values = static_cast<int64_t>(task.source.width) * channels;
+  const int offset_x = task.target.left - task.source.left;
+  const int offset_y = task.target.top - task.source.top;
+
+  ParallelFor(
+        0, task.target.height, static_cast<int64_t>(task.target.width) * channels,
+        [&](int64_t row_begin, int64_t row_end) {
+    for (int64_t row = row_begin; row < row_end; ++row) {
+      unsigned char *dst_ptr = data
+          + (task.target.top + row) * image.RowStride()
+          + task.target.left * image.PixelStride();
+      const _Acc *src_ptr = task.values.data()
+          + (offset_y + row) * row_values + offset_x * channels;
+      for (int col = 0; col < task.target.width; ++col) {
+        for (int ch = 0; ch < channels; ++ch) {
+          *reinterpret_cast<_Tp *>(dst_ptr + ch * image.ChannelStride()) =
+              CastAveraged<_Tp, _Acc>(*src_ptr++);
+        }
+        dst_ptr += image.PixelStride();
+      }
+    }
+  });
+}
+
+
+template <typename _Tp, typename _Acc>
+void BlurRegions(
+    ImageBuffer &image, const std::vector<PixelRegion> &targets,
+    const std::vector<int> &radii) {
+  int reach = 0;
+  for (int radius : radii) {
+    reach += radius;
+  }
+
+  std::vector<BlurTask<_Acc>> tasks(targets.size());
+  int64_t total_pixels = 0;
+  for (std::size_t idx = 0; idx < targets.size(); ++idx) {
+    BlurTask<_Acc> &task = tasks[idx];
+    task.target = targets[idx];
+    task.source.left = std::max(0, task.target.left - reach);
+    task.source.top = std::max(0, task.target.top - reach);
+    task.source.width = std::min(
+          image.Width(), task.target.Right() + reach) - task.source.left;
+    task.source.height = std::min(
+          image.Height(), task.target.Bottom() + reach) - task.source.top;
+    total_pixels += static_cast<int64_t>(task.source.width)
+        * task.source.height;
+  }
+
+  // Ensure write access (and detach a shared storage) once, before
+  // any worker thread accesses the pixels.
+  unsigned char *data = PixelWriter(image).Data();
+
+  // Many small regions (e.g. faces) are processed in parallel, whereas
+  // the rows/columns of a single (large) region are split across the
+  // threads otherwise (nested `ParallelFor` calls run serially).
+  const int64_t cost_per_task = std::max<int64_t>(
+        1, (total_pixels / static_cast<int64_t>(tasks.size()))
+           * image.Channels() * (8 * static_cast<int64_t>(radii.size()) + 1));
+  ParallelFor(
+        0, static_cast<int64_t>(tasks.size()), cost_per_task,
+        [&](int64_t task_begin, int64_t task_end) {
+    for (int64_t idx = task_begin; idx < task_end; ++idx) {
+      BlurSource<_Tp, _Acc>(image, data, tasks[idx], radii);
+    }
+  });
+
+  // Overlapping targets must be written in order (later ones win).
+  bool overlapping = false;
+  for (std::size_t i = 0; (i < tasks.size()) && !overlapping; ++i) {
+    for (std::size_t j = i + 1; j < tasks.size(); ++j) {
+      if (tasks[i].target.Overlaps(tasks[j].target)) {
+        overlapping = true;
+        break;
+      }
+    }
+  }
+
+  if (overlapping) {
+    for (const auto &task : tasks) {
+      StoreTarget<_Tp, _Acc>(image, data, task);
+    }
+  } else {
+    ParallelFor(
+          0, static_cast<int64_t>(tasks.size()),
+          std::max<int64_t>(1, total_pixels / static_cast<int64_t>(tasks.size())),
+          [&](int64_t task_begin, int64_t task_end) {
+      for (int64_t idx = task_begin; idx < task_end; ++idx) {
+        StoreTarget<_Tp, _Acc>(image, data, tasks[idx]);
+      }
+    });
+  }
+}
+}  // anonymous namespace
+
+
+std::vector<int> GaussianBoxRadii(double sigma, int num_boxes) {
+  // Ideal (real-valued) width of the boxes.
+  const double sigma_sq = sigma * sigma;
+  const double ideal_width = std::sqrt(12.0 * sigma_sq / num_boxes + 1.0);
+  int lower_width = static_cast<int>(std::floor(ideal_width));
+  if ((lower_width % 2) == 0) {
+    --lower_width;
+  }
+  const int upper_width = lower_width + 2;
+
+  // The first `num_lower` boxes use the smaller width, so that the
+  // variance of the cascade matches the requested one best.
+  const double ideal_num_lower = (12.0 * sigma_sq
+      - num_boxes * lower_width * lower_width
+      - 4.0 * num_boxes * lower_width - 3.0 * num_boxes)
+      / (-4.0 * lower_width - 4.0);
+  const int num_lower = static_cast<int>(std::round(ideal_num_lower));
+
+  // Small sigmas would result in boxes of width 1, i.e. no blur at all.
+  // Thus, we use a radius of at least 1 for any positive sigma.
+  const int min_radius = (sigma > 0.0) ? 1 : 0;
+  std::vector<int> radii(num_boxes);
+  for (int idx = 0; idx < num_boxes; ++idx) {
+    radii[idx] = std::max(
+          min_radius,
+          (((idx < num_lower) ? lower_width : upper_width) - 1) / 2);
+  }
+  return radii;
+}
+
+
+void Blur(
+    ImageBuffer &image, const std::vector<Rect> &rois,
+    int radius, BlurKind kind) {
+  SPDLOG_DEBUG(
+        "Blur {:d} region(s) of {:s}, radius={:d}, kind={:s}.",
+        rois.size(), image.ToString(), radius, BlurKindToString(kind));
+
+  if (!image.IsValid()) {
+    const std::string msg("Cannot blur an invalid ImageBuffer!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  if (radius <= 0) {
+    std::ostringstream msg;
+    msg << "Blur radius must be > 0, but got " << radius << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  std::vector<PixelRegion> targets;
+  targets.reserve(rois.size());
+  for (const Rect &roi : rois) {
+    if (roi.rotation != 0.0) {
+      std::ostringstream msg;
+      msg << "Blur only supports axis-aligned regions, but got a "
+          << "rotation of " << roi.rotation << " degrees!";
+      SPDLOG_ERROR(msg.str());
+      throw std::invalid_argument(msg.str());
+    }
+
+    // Include all pixels which are (partially) covered by the rectangle.
+    PixelRegion target;
+    target.left = std::max(
+          0, static_cast<int>(std::floor(roi.cx - roi.HalfWidth())));
+    target.top = std::max(
+          0, static_cast<int>(std::floor(roi.cy - roi.HalfHeight())));
+    target.width = std::min(
+          image.Width(),
+          static_cast<int>(std::ceil(roi.cx + roi.HalfWidth()))) - target.left;
+    target.height = std::min(
+          image.Height(),
+          static_cast<int>(std::ceil(roi.cy + roi.HalfHeight()))) - target.top;
+    if ((target.width > 0) && (target.height > 0)) {
+      targets.push_back(target);
+    }
+  }
+
+  if (targets.empty()) {
+    return;
+  }
+
+  const std::vector<int> radii = (kind == BlurKind::Box)
+      ? std::vector<int>{radius}
+      : GaussianBoxRadii(radius / 3.0);
+
+  // Single precision suffices for types with up to 16 bit.
+  switch (image.BufferType()) {
+    case ImageBufferType::UInt8:
+      BlurRegions<uint8_t, float>(image, targets, radii);
+      return;
+
+    case ImageBufferType::Int16:
+      BlurRegions<int16_t, float>(image, targets, radii);
+      return;
+
+    case ImageBufferType::UInt16:
+      BlurRegions<uint16_t, float>(image, targets, radii);
+      return;
+
+    case ImageBufferType::Int32:
+      BlurRegions<int32_t, double>(image, targets, radii);
+      return;
+
+    case ImageBufferType::UInt32:
+      BlurRegions<uint32_t, double>(image, targets, radii);
+      return;
+
+    case ImageBufferType::Int64:
+      BlurRegions<int64_t, double>(image, targets, radii);
+      return;
+
+    case ImageBufferType::UInt64:
+      BlurRegions<uint64_t, double>(image, targets, radii);
+      return;
+
+    case ImageBufferType::Float:
+      BlurRegions<float, float>(image, targets, radii);
+      return;
+
+    case ImageBufferType::Double:
+      BlurRegions<double, double>(image, targets, radii);
+      return;
+
+    case ImageBufferType::Float16:
+      BlurRegions<float16_t, float>(image, targets, radii);
+      return;
+
+    case ImageBufferType::BFloat16:
+      BlurRegions<bfloat16_t, float>(image, targets, radii);
+      return;
+  }
+
+  // Throw an exception as fallback, because ending up here would be an
+  // implementation error (i.e. we ignored the warning about missing value
+  // in the switch/case above).
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(image.BufferType());
+  msg += "` not handled in `Blur` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+}  // namespace helpers
+}  // namespace viren2d
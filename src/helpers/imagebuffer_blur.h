@@ -0,0 +1,28 @@
+#ifndef __VIREN2D_IMAGEBUFFER_BLUR_H__
+#define __VIREN2D_IMAGEBUFFER_BLUR_H__
+
+#include <vector>
+
+#include <viren2d/imagebuffer.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Returns the radii of the box filters which approximate a Gaussian with
+/// the given standard deviation when applied iteratively, see
+/// W. Wells, "Efficient synthesis of Gaussian filters by cascaded uniform
+/// filters", TPAMI 1986. For any positive `sigma`, the radii are at
+/// least 1, so that small sigmas still blur.
+std::vector<int> GaussianBoxRadii(double sigma, int num_boxes = 3);
+
+
+/// Blurs the given regions of `image` in-place, see `ImageBuffer::Blur`.
+void Blur(
+    ImageBuffer &image, const std::vector<Rect> &rois,
+    int radius, BlurKind kind);
+
+}  // namespace helpers
+}  // namespace viren2d
+
+#endif  // __VIREN2D_IMAGEBUFFER_BLUR_H__
@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <helpers/imagebuffer_copy.h>
+#include <helpers/parallel.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// Side length (in pixels) of the tiles of the transposed copy, such
+/// that the source and destination lines of a tile fit into L1.
+constexpr int kTransposeTileSize = 32;
+
+
+/// Pixel copy functors: Each copies a single pixel from the source to
+/// the packed destination. The constant sizes allow the compiler to
+/// replace the `memcpy` calls by plain (unaligned) loads and stores.
+template <int _Bytes>
+struct PackedPixelCopy {
+  inline void operator()(
+      unsigned char *dst, unsigned char const *src) const {
+    std::memcpy(dst, src, _Bytes);
+  }
+};
+
+
+struct DynamicPackedPixelCopy {
+  std::size_t pixel_bytes;
+
+  inline void operator()(
+      unsigned char *dst, unsigned char const *src) const {
+    std::memcpy(dst, src, pixel_bytes);
+  }
+};
+
+
+/// Channels are reversed, *i.e.* channel `ch` of the output is read from
+/// `src - ch * sizeof(_Tp)`, where `src` points to the first output channel.
+template <typename _Tp, int _Channels>
+struct ReversedPixelCopy {
+  inline void operator()(
+      unsigned char *dst, unsigned char const *src) const {
+    for (int ch = 0; ch < _Channels; ++ch) {
+      std::memcpy(dst + ch * sizeof(_Tp),
+                  src - ch * static_cast<int64_t>(sizeof(_Tp)), sizeof(_Tp));
+    }
+  }
+};
+
+
+template <typename _Tp>
+struct StridedPixelCopy {
+  int channels;
+  int64_t channel_stride;
+
+  inline void operator()(
+      unsigned char *dst, unsigned char const *src) const {
+    for (int ch = 0; ch < channels; ++ch, src += channel_stride) {
+      std::memcpy(dst + ch * sizeof(_Tp), src, sizeof(_Tp));
+    }
+  }
+};
+
+
+struct DynamicStridedPixelCopy {
+  int channels;
+  int64_t channel_stride;
+  std::size_t element_size;
+
+  inline void operator()(
+      unsigned char *dst, unsigned char const *src) const {
+    for (int ch = 0; ch < channels; ++ch, src += channel_stride) {
+      std::memcpy(dst + ch * element_size, src, element_size);
+    }
+  }
+};
+
+
+/// Input layout, shared by all copy kernels.
+struct StridedSource {
+  unsigned char const *data;
+  int height;
+  int width;
+  int64_t row_stride;
+  int64_t pixel_stride;
+  int64_t pixel_bytes;
+};
+
+
+template <typename _Copy> inline
+void CopyRow(
+    const StridedSource &src, int row, unsigned char *dst_row,
+    const _Copy &copy) {
+  unsigned char const *src_ptr = src.data + row * src.row_stride;
+  for (int col = 0; col < src.width; ++col) {
+    copy(dst_row + col * src.pixel_bytes, src_ptr);
+    src_ptr += src.pixel_stride;
+  }
+}
+
+
+/// Copies row by row.
+template <typename _Copy>
+void CopyRows(const StridedSource &src, unsigned char *dst, const _Copy &copy) {
+  const int64_t dst_row_stride = src.width * src.pixel_bytes;
+  ParallelFor(
+        0, src.height, dst_row_stride,
+        [&](int64_t row_begin, int64_t row_end) {
+    for (int64_t row = row_begin; row < row_end; ++row) {
+      CopyRow(src, static_cast<int>(row), dst + row * dst_row_stride, copy);
+    }
+  });
+}
+
+
+/// Copies tile by tile, where the pixels of a tile are visited column by
+/// column. Thus, the source is read along its contiguous axis and the
+/// few destination rows of a tile remain cached until they are filled.
+template <typename _Copy>
+void CopyTransposed(
+    const StridedSource &src, unsigned char *dst, const _Copy &copy) {
+  const int64_t dst_row_stride = src.width * src.pixel_bytes;
+  const int num_bands = (src.height + kTransposeTileSize - 1)
+      / kTransposeTileSize;
+  ParallelFor(
+        0, num_bands,
+        dst_row_stride * kTransposeTileSize,
+        [&](int64_t band_begin, int64_t band_end) {
+    for (int64_t band = band_begin; band < band_end; ++band) {
+      const int row_begin = static_cast<int>(band) * kTransposeTileSize;
+      const int row_end = std::min(row_begin + kTransposeTileSize, src.height);
+      for (int col_begin = 0; col_begin < src.width;
+           col_begin += kTransposeTileSize) {
+        const int col_end = std::min(
+              col_begin + kTransposeTileSize, src.width);
+        for (int col = col_begin; col < col_end; ++col) {
+          unsigned char const *src_ptr = src.data
+              + row_begin * src.row_stride + col * src.pixel_stride;
+          unsigned char *dst_ptr = dst + row_begin * dst_row_stride
+              + col * src.pixel_bytes;
+          for (int row = row_begin; row < row_end; ++row) {
+            copy(dst_ptr, src_ptr);
+            src_ptr += src.row_stride;
+            dst_ptr += dst_row_stride;
+          }
+        }
+      }
+    }
+  });
+}
+
+
+template <typename _Copy>
+void CopyPixels(
+    const StridedSource &src, unsigned char *dst,
+    StridedCopyKind kind, const _Copy &copy) {
+  if (kind == StridedCopyKind::Transposed) {
+    CopyTransposed(src, dst, copy);
+  } else {
+    CopyRows(src, dst, copy);
+  }
+}
+
+
+/// Dispatches the copy of pixels with packed channels, *i.e.* each pixel
+/// is a contiguous block of `pixel_bytes`.
+void CopyPackedPixels(
+    const StridedSource &src, unsigned char *dst, StridedCopyKind kind) {
+  switch (src.pixel_bytes) {
+    case 1:
+      return CopyPixels(src, dst, kind, PackedPixelCopy<1>());
+    case 2:
+      return CopyPixels(src, dst, kind, PackedPixelCopy<2>());
+    case 3:
+      return CopyPixels(src, dst, kind, PackedPixelCopy<3>());
+    case 4:
+      return CopyPixels(src, dst, kind, PackedPixelCopy<4>());
+    case 6:
+      return CopyPixels(src, dst, kind, PackedPixelCopy<6>());
+    case 8:
+      return CopyPixels(src, dst, kind, PackedPixelCopy<8>());
+    case 12:
+      return CopyPixels(src, dst, kind, PackedPixelCopy<12>());
+    case 16:
+      return CopyPixels(src, dst, kind, PackedPixelCopy<16>());
+    default:
+      return CopyPixels(
+            src, dst, kind,
+            DynamicPackedPixelCopy{static_cast<std::size_t>(src.pixel_bytes)});
+  }
+}
+
+
+template <typename _Tp>
+void CopyReversedPixels(
+    const StridedSource &src, unsigned char *dst, int channels) {
+  // The source pointer must address the first output channel, which
+  // is the last one in memory.
+  switch (channels) {
+    case 3:
+      return CopyRows(src, dst, ReversedPixelCopy<_Tp, 3>());
+    case 4:
+      return CopyRows(src, dst, ReversedPixelCopy<_Tp, 4>());
+    default:
+      return CopyRows(
+            src, dst,
+            StridedPixelCopy<_Tp>{
+              channels, -static_cast<int64_t>(sizeof(_Tp))});
+  }
+}
+
+
+template <typename _Tp>
+void CopyStridedPixels(
+    const StridedSource &src, unsigned char *dst, StridedCopyKind kind,
+    int channels, int64_t channel_stride) {
+  CopyPixels(src, dst, kind, StridedPixelCopy<_Tp>{channels, channel_stride});
+}
+}  // anonymous namespace
+
+
+StridedCopyKind SelectStridedCopy(
+    int height, int width, int channels, int64_t row_stride,
+    int64_t pixel_stride, int64_t channel_stride, int element_size) {
+  const int64_t pixel_bytes = static_cast<int64_t>(channels) * element_size;
+  // The channel stride of a single-channel buffer is irrelevant, and
+  // so is the pixel stride of a single column.
+  const bool packed_channels = (channels == 1)
+      || (channel_stride == element_size);
+  const bool packed_pixels = packed_channels
+      && ((width == 1) || (pixel_stride == pixel_bytes));
+
+  if (packed_pixels) {
+    return ((height == 1) || (row_stride == width * pixel_bytes))
+        ? StridedCopyKind::Contiguous
+        : StridedCopyKind::PackedRows;
+  }
+
+  if ((height > 1) && (std::llabs(row_stride) < std::llabs(pixel_stride))) {
+    return StridedCopyKind::Transposed;
+  }
+
+  if (packed_channels) {
+    return StridedCopyKind::PackedPixels;
+  }
+
+  if (channel_stride == -element_size) {
+    return StridedCopyKind::ReversedChannels;
+  }
+  return StridedCopyKind::Generic;
+}
+
+
+void CopyStridedToPacked(
+    unsigned char const *src, int height, int width, int channels,
+    int64_t row_stride, int64_t pixel_stride, int64_t channel_stride,
+    int element_size, unsigned char *dst) {
+  const StridedCopyKind kind = SelectStridedCopy(
+        height, width, channels, row_stride, pixel_stride,
+        channel_stride, element_size);
+  const int64_t pixel_bytes = static_cast<int64_t>(channels) * element_size;
+  const int64_t num_bytes = static_cast<int64_t>(height) * width * pixel_bytes;
+
+  StridedSource source{src, height, width, row_stride, pixel_stride, pixel_bytes};
+  switch (kind) {
+    case StridedCopyKind::Contiguous:
+      std::memcpy(dst, src, static_cast<std::size_t>(num_bytes));
+      return;
+
+    case StridedCopyKind::PackedRows: {
+        const int64_t dst_row_stride = width * pixel_bytes;
+        ParallelFor(
+              0, height, dst_row_stride,
+              [&](int64_t row_begin, int64_t row_end) {
+          for (int64_t row = row_begin; row < row_end; ++row) {
+            std::memcpy(dst + row * dst_row_stride, src + row * row_stride,
+                        static_cast<std::size_t>(dst_row_stride));
+          }
+        });
+        return;
+      }
+
+    case StridedCopyKind::PackedPixels:
+      return CopyPackedPixels(source, dst, kind);
+
+    case StridedCopyKind::ReversedChannels:
+      switch (element_size) {
+        case 1:
+          return CopyReversedPixels<uint8_t>(source, dst, channels);
+        case 2:
+          return CopyReversedPixels<uint16_t>(source, dst, channels);
+        case 4:
+          return CopyReversedPixels<uint32_t>(source, dst, channels);
+        case 8:
+          return CopyReversedPixels<uint64_t>(source, dst, channels);
+        default:
+          break;
+      }
+      break;
+
+    case StridedCopyKind::Transposed:
+      if ((channels == 1) || (channel_stride == element_size)) {
+        return CopyPackedPixels(source, dst, kind);
+      }
+      break;
+
+    case StridedCopyKind::Generic:
+      break;
+  }
+
+  // Element by element, using the typed copies where possible
+  switch (element_size) {
+    case 1:
+      return CopyStridedPixels<uint8_t>(source, dst, kind, channels, channel_stride);
+    case 2:
+      return CopyStridedPixels<uint16_t>(source, dst, kind, channels, channel_stride);
+    case 4:
+      return CopyStridedPixels<uint32_t>(source, dst, kind, channels, channel_stride);
+    case 8:
+      return CopyStridedPixels<uint64_t>(source, dst, kind, channels, channel_stride);
+    default:
+      return CopyPixels(
+            source, dst, kind,
+            DynamicStridedPixelCopy{
+              channels, channel_stride,
+              static_cast<std::size_t>(element_size)});
+  }
+}
+
+}  // namespace helpers
+}  // namespace viren2d
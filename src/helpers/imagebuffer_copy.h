@@ -0,0 +1,54 @@
+#ifndef __VIREN2D_IMAGEBUFFER_COPY_H__
+#define __VIREN2D_IMAGEBUFFER_COPY_H__
+
+#include <cstdint>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Copy kernels for strided inputs, see `SelectStridedCopy`.
+enum class StridedCopyKind : unsigned char {
+  /// Input is packed, *i.e.* a single `memcpy`.
+  Contiguous = 0,
+
+  /// Pixels within a row are packed, *i.e.* one `memcpy` per row.
+  PackedRows,
+
+  /// Channels of a pixel are packed, but pixels are not. For example,
+  /// column slices, horizontally flipped images, or the RGB view of
+  /// an RGBA image (fixed pixel stride with a channel gap).
+  PackedPixels,
+
+  /// Channels are stored in reverse order, *e.g.* `[..., ::-1]` views
+  /// which convert between RGB and BGR.
+  ReversedChannels,
+
+  /// Pixels of a column are closer in memory than pixels of a row,
+  /// *e.g.* transposed images. Copied in cache-sized tiles.
+  Transposed,
+
+  /// Any other strides, copied element by element.
+  Generic
+};
+
+
+/// Returns the kernel which `CopyStridedToPacked` uses for the given
+/// input layout. Strides are in bytes and may be negative.
+StridedCopyKind SelectStridedCopy(
+    int height, int width, int channels, int64_t row_stride,
+    int64_t pixel_stride, int64_t channel_stride, int element_size);
+
+
+/// Copies the strided input image into the freshly allocated, packed
+/// (interleaved & without row padding) destination. Input and output
+/// must not overlap.
+void CopyStridedToPacked(
+    unsigned char const *src, int height, int width, int channels,
+    int64_t row_stride, int64_t pixel_stride, int64_t channel_stride,
+    int element_size, unsigned char *dst);
+
+}  // namespace helpers
+}  // namespace viren2d
+
+#endif  // __VIREN2D_IMAGEBUFFER_COPY_H__
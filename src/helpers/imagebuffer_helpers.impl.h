@@ -3,74 +3,523 @@
 
 #include <stdexcept>
 #include <sstream>
+#include <cstring>
+#include <algorithm>
+#include <initializer_list>
+#include <utility>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <mutex>
+#include <type_traits>
 
 #include <werkzeugkiste/geometry/utils.h>
 
 #include <viren2d/colors.h>
 #include <viren2d/styles.h>
 
+#include <helpers/imagebuffer_access.h>
 #include <helpers/logging.h>
 #include <helpers/color_conversion.h>
+#include <helpers/imagebuffer_rgba.h>
+#include <helpers/parallel.h>
+#include <helpers/simd_kernels.h>
 
 namespace wkg = werkzeugkiste::geometry;
 
 namespace viren2d {
 namespace helpers {
 
+/// Returns true if the memory regions of the two buffers overlap.
+inline bool Overlaps(const ImageBuffer &a, const ImageBuffer &b) {
+  if (!a.IsValid() || !b.IsValid()) {
+    return false;
+  }
+
+  // Strides of shared buffers could be negative, thus we need to
+  // check the offsets of the first and last pixel in both directions.
+  auto extent = [](const ImageBuffer &buf) {
+    const int64_t rows = (buf.Height() - 1) * buf.RowStride();
+    const int64_t cols = (buf.Width() - 1) * buf.PixelStride();
+    const int64_t chans = (buf.Channels() - 1) * buf.ChannelStride();
+    const int64_t first = std::min<int64_t>(0, rows)
+        + std::min<int64_t>(0, cols) + std::min<int64_t>(0, chans);
+    const int64_t last = std::max<int64_t>(0, rows)
+        + std::max<int64_t>(0, cols) + std::max<int64_t>(0, chans)
+        + buf.ElementSize();
+    return std::make_pair(
+          buf.ImmutableData() + first, buf.ImmutableData() + last);
+  };
+
+  const auto ext_a = extent(a);
+  const auto ext_b = extent(b);
+  return (ext_a.first < ext_b.second) && (ext_b.first < ext_a.second);
+}
+
+
+/// Checks the destination buffer of an "into" transformation and returns
+/// true if it overlaps with any of the inputs, *i.e.* if the result must
+/// be computed into a temporary buffer first (see `AssignOutput`).
+inline bool IsAliasedOutput(
+    const ImageBuffer *dst, std::initializer_list<const ImageBuffer *> inputs) {
+  if (!dst) {
+    const std::string msg("Destination ImageBuffer must not be nullptr!");
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
+
+  for (const ImageBuffer *input : inputs) {
+    if (Overlaps(*dst, *input)) {
+      SPDLOG_DEBUG(
+            "Destination {:s} overlaps with input {:s}.",
+            dst->ToString(), input->ToString());
+      return true;
+    }
+  }
+  return false;
+}
+
+
+/// Copies all pixels of `src` into `dst`, which will be
+/// (re-)allocated if its shape or type does not match.
+inline void CopyPixels(const ImageBuffer &src, ImageBuffer &dst) {
+  dst.EnsureShape(
+        src.Height(), src.Width(), src.Channels(), src.BufferType());
+
+  const PixelWriter out(dst);
+  const int64_t pixel_bytes =
+      static_cast<int64_t>(src.Channels()) * src.ElementSize();
+  if (src.IsContiguous() && dst.IsContiguous()) {
+    std::memcpy(
+          out.Data(), src.ImmutableData(),
+          static_cast<std::size_t>(src.NumBytes()));
+  } else if ((src.PixelStride() == pixel_bytes)
+             && (dst.PixelStride() == pixel_bytes)
+             && src.HasContiguousChannels() && dst.HasContiguousChannels()) {
+    for (int row = 0; row < src.Height(); ++row) {
+      std::memcpy(
+            out.Row<unsigned char>(row),
+            src.ImmutablePtr<unsigned char>(row, 0, 0),
+            static_cast<std::size_t>(src.Width() * pixel_bytes));
+    }
+  } else if (src.HasContiguousChannels() && dst.HasContiguousChannels()) {
+    for (int row = 0; row < src.Height(); ++row) {
+      for (int col = 0; col < src.Width(); ++col) {
+        std::memcpy(
+              out.Ptr<unsigned char>(row, col, 0),
+              src.ImmutablePtr<unsigned char>(row, col, 0),
+              static_cast<std::size_t>(pixel_bytes));
+      }
+    }
+  } else {
+    const std::size_t element_size =
+        static_cast<std::size_t>(src.ElementSize());
+    for (int row = 0; row < src.Height(); ++row) {
+      for (int col = 0; col < src.Width(); ++col) {
+        for (int ch = 0; ch < src.Channels(); ++ch) {
+          std::memcpy(
+                out.Ptr<unsigned char>(row, col, ch),
+                src.ImmutablePtr<unsigned char>(row, col, ch),
+                element_size);
+        }
+      }
+    }
+  }
+}
+
+
+/// Moves the (temporary) result of a transformation into the destination.
+/// If the destination is a view onto external memory (*e.g.* a shared
+/// numpy array) of the correct shape & type, the pixels will be copied
+/// instead, so that the caller's memory receives the result.
+inline void AssignOutput(ImageBuffer *dst, ImageBuffer &&result) {
+  if (dst->IsValid() && !dst->OwnsData() && !dst->IsReadOnly()
+      && (dst->Height() == result.Height())
+      && (dst->Width() == result.Width())
+      && (dst->Channels() == result.Channels())
+      && (dst->BufferType() == result.BufferType())) {
+    CopyPixels(result, *dst);
+  } else {
+    *dst = std::move(result);
+  }
+}
+
+
+/// Returns true if vectorized conversion kernels exist for this type.
+template <typename _Tp>
+constexpr bool HasConversionKernels() {
+  return std::is_same<_Tp, uint8_t>::value || std::is_same<_Tp, float>::value;
+}
+
+
+/// Returns true if there are no gaps between the pixels of a row and
+/// the channels are in order, which is required by the vectorized
+/// conversion kernels.
+inline bool HasPackedPixels(const ImageBuffer &buffer) {
+  return buffer.HasContiguousChannels()
+      && (buffer.PixelStride()
+          == static_cast<int64_t>(buffer.Channels()) * buffer.ElementSize());
+}
+
+
+/// Returns true for the half precision storage types.
+template <typename _Tp>
+constexpr bool IsHalfPrecision() {
+  return std::is_same<_Tp, float16_t>::value
+      || std::is_same<_Tp, bfloat16_t>::value;
+}
+
+
+/// Half precision buffers only support storage, type conversion and a
+/// few read-only operations (*e.g.* `MinMaxLocation` or colorization).
+/// Throws an `std::invalid_argument` for all other operations.
+[[noreturn]] inline void ThrowHalfPrecisionNotSupported(
+    const ImageBuffer &buffer, const char *operation) {
+  std::string msg("`");
+  msg += operation;
+  msg += "` is not supported for half precision buffers, but got ";
+  msg += buffer.ToString();
+  msg += ". Convert it via `ToFloat` or `AsType` first!";
+  SPDLOG_ERROR(msg);
+  throw std::invalid_argument(msg);
+}
+
+
+/// Converts `num_elements` packed values between `float` and one
+/// of the half precision types via the vectorized kernels.
+template <typename _Tsrc, typename _Tdst> inline
+void ConvertHalfPrecisionElements(
+    const _Tsrc *src, _Tdst *dst, int64_t num_elements) {
+  const auto &kernels = simd::HalfKernels();
+  if constexpr (std::is_same<_Tsrc, float16_t>::value) {
+    kernels.float16_to_float(src, dst, num_elements);
+  } else if constexpr (std::is_same<_Tsrc, bfloat16_t>::value) {
+    kernels.bfloat16_to_float(src, dst, num_elements);
+  } else if constexpr (std::is_same<_Tdst, float16_t>::value) {
+    kernels.float_to_float16(src, dst, num_elements);
+  } else {
+    kernels.float_to_bfloat16(src, dst, num_elements);
+  }
+}
+
+
+/// Converts between `float` and a half precision buffer of the same
+/// shape if both have packed pixels. Returns false otherwise, *i.e.*
+/// if the caller must fall back to the element-wise conversion.
+template <typename _Tsrc, typename _Tdst>
+bool ConvertHalfPrecisionPacked(const ImageBuffer &src, ImageBuffer &dst) {
+  if (!HasPackedPixels(src) || !HasPackedPixels(dst)) {
+    return false;
+  }
+
+  const PixelWriter out(dst);
+  int rows = src.Height();
+  int cols = src.Width();
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
+    cols *= rows;
+    rows = 1;
+  }
+
+  const int channels = src.Channels();
+  ParallelForPixels(
+        rows, cols, channels,
+        [&](int row, int col_begin, int col_end) {
+    ConvertHalfPrecisionElements(
+          src.ImmutablePtr<_Tsrc>(row, col_begin, 0),
+          out.Ptr<_Tdst>(row, col_begin, 0),
+          static_cast<int64_t>(col_end - col_begin) * channels);
+  });
+  return true;
+}
+
+
+/// Converts the value to the output type, saturating values outside of
+/// its range (NaN becomes 0 for integral types).
+template <typename _Tp> inline
+_Tp SaturateCast(double value) {
+  // Also true for the half precision types
+  if constexpr (!std::numeric_limits<_Tp>::is_integer) {
+    return static_cast<_Tp>(value);
+  } else {
+    if (std::isnan(value)) {
+      return static_cast<_Tp>(0);
+    }
+    if (value <= static_cast<double>(std::numeric_limits<_Tp>::lowest())) {
+      return std::numeric_limits<_Tp>::lowest();
+    }
+    if (value >= static_cast<double>(std::numeric_limits<_Tp>::max())) {
+      return std::numeric_limits<_Tp>::max();
+    }
+    return static_cast<_Tp>(value);
+  }
+}
+
+
+/// Returns true if the vectorized type cast kernels support the given
+/// pair, *i.e.* casts from `int16`, `uint16`, `int32`, `float` and `double`
+/// to (saturated) `uint8`, and from `uint8`, `int16`, `uint16`, `int32`
+/// and `double` to `float`.
+template <typename _Tsrc, typename _Tdst>
+constexpr bool HasCastKernel() {
+  if constexpr (std::is_same<_Tdst, uint8_t>::value) {
+    return std::is_same<_Tsrc, int16_t>::value
+        || std::is_same<_Tsrc, uint16_t>::value
+        || std::is_same<_Tsrc, int32_t>::value
+        || std::is_same<_Tsrc, float>::value
+        || std::is_same<_Tsrc, double>::value;
+  } else if constexpr (std::is_same<_Tdst, float>::value) {
+    return std::is_same<_Tsrc, uint8_t>::value
+        || std::is_same<_Tsrc, int16_t>::value
+        || std::is_same<_Tsrc, uint16_t>::value
+        || std::is_same<_Tsrc, int32_t>::value
+        || std::is_same<_Tsrc, double>::value;
+  } else {
+    return false;
+  }
+}
+
+
+/// Casts `num_elements` packed values via the vectorized kernels, see
+/// `simd::TypeCastKernels`. Integral values are not scaled when casting
+/// to `uint8`, *i.e.* `scale` must be 1 in this case.
+template <typename _Tsrc, typename _Tdst> inline
+void CastElements(
+    const _Tsrc *src, _Tdst *dst, int64_t num_elements, double scale) {
+  static_assert(
+        HasCastKernel<_Tsrc, _Tdst>(), "Type cast is not vectorized!");
+  const auto &kernels = simd::CastKernels();
+  if constexpr (std::is_same<_Tdst, uint8_t>::value) {
+    if constexpr (std::is_same<_Tsrc, int16_t>::value) {
+      kernels.int16_to_uint8(src, dst, num_elements);
+    } else if constexpr (std::is_same<_Tsrc, uint16_t>::value) {
+      kernels.uint16_to_uint8(src, dst, num_elements);
+    } else if constexpr (std::is_same<_Tsrc, int32_t>::value) {
+      kernels.int32_to_uint8(src, dst, num_elements);
+    } else if constexpr (std::is_same<_Tsrc, float>::value) {
+      kernels.float_to_uint8(
+            src, dst, num_elements, static_cast<float>(scale));
+    } else {
+      kernels.double_to_uint8(src, dst, num_elements, scale);
+    }
+  } else {
+    if constexpr (std::is_same<_Tsrc, uint8_t>::value) {
+      kernels.uint8_to_float(
+            src, dst, num_elements, static_cast<float>(scale));
+    } else if constexpr (std::is_same<_Tsrc, int16_t>::value) {
+      kernels.int16_to_float(
+            src, dst, num_elements, static_cast<float>(scale));
+    } else if constexpr (std::is_same<_Tsrc, uint16_t>::value) {
+      kernels.uint16_to_float(
+            src, dst, num_elements, static_cast<float>(scale));
+    } else if constexpr (std::is_same<_Tsrc, int32_t>::value) {
+      kernels.int32_to_float(
+            src, dst, num_elements, static_cast<float>(scale));
+    } else {
+      kernels.double_to_float(src, dst, num_elements, scale);
+    }
+  }
+}
+
+
+/// Casts all values into the destination buffer of the same shape via
+/// `CastElements` if both have packed pixels. Returns false otherwise,
+/// *i.e.* if the caller must fall back to the element-wise conversion.
+template <typename _Tsrc, typename _Tdst>
+bool CastPacked(const ImageBuffer &src, ImageBuffer &dst, double scale) {
+  if (!HasPackedPixels(src) || !HasPackedPixels(dst)) {
+    return false;
+  }
+
+  const PixelWriter out(dst);
+  int rows = src.Height();
+  int cols = src.Width();
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
+    cols *= rows;
+    rows = 1;
+  }
+
+  const int channels = src.Channels();
+  ParallelForPixels(
+        rows, cols, channels,
+        [&](int row, int col_begin, int col_end) {
+    CastElements(
+          src.ImmutablePtr<_Tsrc>(row, col_begin, 0),
+          out.Ptr<_Tdst>(row, col_begin, 0),
+          static_cast<int64_t>(col_end - col_begin) * channels, scale);
+  });
+  return true;
+}
+
+
+/// Invokes `kernel(src_ptr, dst_ptr, num_pixels)` on chunks of the
+/// (flattened, if both buffers are contiguous) rows, which are
+/// distributed across the worker threads. Pixels must be packed.
+template <typename _Tp, typename _Kernel> inline
+void ApplyRowKernel(const ImageBuffer &src, ImageBuffer &dst, _Kernel kernel) {
+  const PixelWriter out(dst);
+  int rows = src.Height();
+  int cols = src.Width();
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
+    cols *= rows;
+    rows = 1;
+  }
+
+  ParallelForPixels(
+        rows, cols, src.Channels(),
+        [&](int row, int col_begin, int col_end) {
+    kernel(
+          src.ImmutablePtr<_Tp>(row, col_begin, 0),
+          out.Ptr<_Tp>(row, col_begin, 0),
+          static_cast<int64_t>(col_end - col_begin));
+  });
+}
+
+
+/// Variant of `ApplyRowKernel` for buffers with arbitrary pixel and
+/// channel strides (*e.g.* views): Each chunk is packed into a scratch
+/// row before `kernel(src_ptr, dst_ptr, num_pixels)` is invoked, and the
+/// results are scattered into `dst` afterwards.
+template <typename _Tp, typename _Kernel> inline
+void ApplyRowKernelStrided(
+    const ImageBuffer &src, ImageBuffer &dst, _Kernel kernel) {
+  if (HasPackedPixels(src) && HasPackedPixels(dst)) {
+    ApplyRowKernel<_Tp>(src, dst, kernel);
+    return;
+  }
+
+  const PixelWriter out(dst);
+  int rows = src.Height();
+  int cols = src.Width();
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
+    cols *= rows;
+    rows = 1;
+  }
+
+  const int src_channels = src.Channels();
+  const int dst_channels = dst.Channels();
+  ParallelForPixels(
+        rows, cols, src_channels,
+        [&](int row, int col_begin, int col_end) {
+    const int num_pixels = col_end - col_begin;
+    std::vector<_Tp> src_row(static_cast<std::size_t>(num_pixels) * src_channels);
+    std::vector<_Tp> dst_row(static_cast<std::size_t>(num_pixels) * dst_channels);
+    _Tp *src_ptr = src_row.data();
+    for (int col = col_begin; col < col_end; ++col) {
+      for (int ch = 0; ch < src_channels; ++ch) {
+        *src_ptr++ = src.AtUnchecked<_Tp>(row, col, ch);
+      }
+    }
+
+    kernel(src_row.data(), dst_row.data(), static_cast<int64_t>(num_pixels));
+
+    const _Tp *dst_ptr = dst_row.data();
+    for (int col = col_begin; col < col_end; ++col) {
+      for (int ch = 0; ch < dst_channels; ++ch) {
+        out.At<_Tp>(row, col, ch) = *dst_ptr++;
+      }
+    }
+  });
+}
+
+
+/// Computes each row of the packed `mask` (which must already have the
+/// same size as `src`) via `kernel(src_ptr, bits, num_pixels)`, where the
+/// rows are distributed across the worker threads. Rows of non-packed
+/// buffers (*e.g.* channel views) are copied into a scratch row first.
+template <typename _Tp, typename _Kernel> inline
+void ApplyBitKernel(const ImageBuffer &src, PackedMask &mask, _Kernel kernel) {
+  const int width = src.Width();
+  const int channels = src.Channels();
+  const bool packed = HasPackedPixels(src);
+  ParallelFor(
+        0, src.Height(), static_cast<int64_t>(width) * channels,
+        [&](int64_t row_begin, int64_t row_end) {
+    std::vector<_Tp> scratch(
+          packed ? 0 : static_cast<std::size_t>(width) * channels);
+    for (int64_t r = row_begin; r < row_end; ++r) {
+      const int row = static_cast<int>(r);
+      const _Tp *src_ptr = scratch.data();
+      if (packed) {
+        src_ptr = src.ImmutablePtr<_Tp>(row, 0, 0);
+      } else {
+        _Tp *dst_ptr = scratch.data();
+        for (int col = 0; col < width; ++col) {
+          for (int ch = 0; ch < channels; ++ch) {
+            *dst_ptr++ = src.AtUnchecked<_Tp>(row, col, ch);
+          }
+        }
+      }
+      kernel(src_ptr, mask.MutableRowPtr(row), static_cast<int64_t>(width));
+    }
+  });
+}
+
+
 template<typename _Tp> inline
 void SwapChannels(ImageBuffer &buffer, int ch1, int ch2) {
+  if constexpr (HasConversionKernels<_Tp>()) {
+    if (HasPackedPixels(buffer)) {
+      const auto &kernels = simd::Kernels<_Tp>();
+      const int channels = buffer.Channels();
+      ApplyRowKernel<_Tp>(
+            buffer, buffer,
+            [&kernels, channels, ch1, ch2](
+              const _Tp *, _Tp *ptr, int64_t num_pixels) {
+        kernels.swap_channels(ptr, num_pixels, channels, ch1, ch2);
+      });
+      return;
+    }
+  }
+
   int rows = buffer.Height();
-  int values_per_row = buffer.Width() * buffer.Channels();
+  int cols = buffer.Width();
 
   // If the memory is contiguous, we can speed up the
   // following loop, similar to the efficient OpenCV matrix scan:
   // https://docs.opencv.org/2.4/doc/tutorials/core/how_to_scan_images/how_to_scan_images.html#the-efficient-way
-  if (buffer.IsContiguous()) {
-    values_per_row *= rows;
+  if (buffer.IsFlattenable()) {
+    cols *= rows;
     rows = 1;
   }
 
-  _Tp *ptr_row;
-  for (int row = 0; row < rows; ++row) {
-    ptr_row = buffer.MutablePtr<_Tp>(row, 0, 0);
-    for (int col = 0; col < values_per_row; col += buffer.Channels()) {
-      _Tp tmp = ptr_row[col + ch1];
-      ptr_row[col + ch1] = ptr_row[col + ch2];
-      ptr_row[col + ch2] = tmp;
+  const PixelWriter out(buffer);
+  ParallelForPixels(
+        rows, cols, 2,
+        [&](int row, int col_begin, int col_end) {
+    for (int col = col_begin; col < col_end; ++col) {
+      std::swap(out.At<_Tp>(row, col, ch1), out.At<_Tp>(row, col, ch2));
     }
-  }
+  });
 }
 
 
 template<typename _Tp>
-ImageBuffer ExtractChannel(const ImageBuffer &src, int channel) {
-  ImageBuffer dst(src.Height(), src.Width(), 1, src.BufferType());
+void ExtractChannel(const ImageBuffer &src, ImageBuffer &dst, int channel) {
+  dst.EnsureShape(src.Height(), src.Width(), 1, src.BufferType());
 
   int rows = src.Height();
-  int values_per_row = src.Width() * src.Channels();
-  if (src.IsContiguous()) {
-    values_per_row *= rows;
+  int cols = src.Width();
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
+    cols *= rows;
     rows = 1;
   }
 
-  _Tp const *src_row;
-  _Tp *dst_ptr = dst.MutablePtr<_Tp>(0, 0, 0);
-  int dst_col = 0;
-  for (int row = 0; row < rows; ++row) {
-    src_row = src.ImmutablePtr<_Tp>(row, 0, 0);
-    for (int col = channel; col < values_per_row; col += src.Channels()) {
-      dst_ptr[dst_col] = src_row[col];
-      ++dst_col;
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        rows, cols, 1,
+        [&](int row, int col_begin, int col_end) {
+    _Tp *dst_ptr = out.Ptr<_Tp>(row, col_begin, 0);
+    for (int col = col_begin; col < col_end; ++col) {
+      *dst_ptr++ = src.AtUnchecked<_Tp>(row, col, channel);
     }
-  }
-  return dst;
+  });
 }
 
 //TODO/FIXME - implement blend
 
 template<typename _Tp>
-ImageBuffer ConversionHelperGray(
-    const ImageBuffer &src, int channels_out) {
+void ConversionHelperGray(
+    const ImageBuffer &src, ImageBuffer &dst, int channels_out) {
   SPDLOG_DEBUG(
         "ImageBuffer converting grayscale to {:d} channels.",
         channels_out);
@@ -101,62 +550,89 @@ ImageBuffer ConversionHelperGray(
     throw std::invalid_argument(msg.str());
   }
 
-  // Create destination buffer (will have contiguous memory)
-  ImageBuffer dst(src.Height(), src.Width(), channels_out, src.BufferType());
+  // Reuse or create destination buffer (rows may be padded)
+  dst.EnsureShape(src.Height(), src.Width(), channels_out, src.BufferType());
+
+  if constexpr (HasConversionKernels<_Tp>()) {
+    if (HasPackedPixels(src) && HasPackedPixels(dst)) {
+      const auto &kernels = simd::Kernels<_Tp>();
+      ApplyRowKernel<_Tp>(
+            src, dst, (channels_out == 4) ? kernels.gray2rgba : kernels.gray2rgb);
+      return;
+    }
+  }
 
   int rows = src.Height();
   int cols = src.Width(); // src channels is 1
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
+  // Rows of dst may be padded, so it must be contiguous, too
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
-  for (int row = 0; row < rows; ++row) {
-    for (int col = 0; col < cols; ++col) {
-      dst.AtUnchecked<_Tp>(row, col, 0) = src.AtUnchecked<_Tp>(row, col, 0);
-      dst.AtUnchecked<_Tp>(row, col, 1) = src.AtUnchecked<_Tp>(row, col, 0);
-      dst.AtUnchecked<_Tp>(row, col, 2) = src.AtUnchecked<_Tp>(row, col, 0);
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        rows, cols, channels_out,
+        [&](int row, int col_begin, int col_end) {
+    for (int col = col_begin; col < col_end; ++col) {
+      out.At<_Tp>(row, col, 0) = src.AtUnchecked<_Tp>(row, col, 0);
+      out.At<_Tp>(row, col, 1) = src.AtUnchecked<_Tp>(row, col, 0);
+      out.At<_Tp>(row, col, 2) = src.AtUnchecked<_Tp>(row, col, 0);
       if (channels_out == 4) {
-        dst.AtUnchecked<_Tp>(row, col, 3) = 255;
+        out.At<_Tp>(row, col, 3) = static_cast<_Tp>(255);
       }
     }
-  }
-
-  return dst;
+  });
 }
 
 
 /// Selects the corresponding templated ConversionHelper
-inline ImageBuffer Gray2RGBx(
-    const ImageBuffer &img, int num_channels_out) {
+inline void Gray2RGBx(
+    const ImageBuffer &img, ImageBuffer &dst, int num_channels_out) {
   switch(img.BufferType()) {
     case ImageBufferType::UInt8:
-      return ConversionHelperGray<uint8_t>(img, num_channels_out);
+      ConversionHelperGray<uint8_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::Int16:
-      return ConversionHelperGray<int16_t>(img, num_channels_out);
+      ConversionHelperGray<int16_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::UInt16:
-      return ConversionHelperGray<uint16_t>(img, num_channels_out);
+      ConversionHelperGray<uint16_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::Int32:
-      return ConversionHelperGray<int32_t>(img, num_channels_out);
+      ConversionHelperGray<int32_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::UInt32:
-      return ConversionHelperGray<uint32_t>(img, num_channels_out);
+      ConversionHelperGray<uint32_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::Int64:
-      return ConversionHelperGray<int64_t>(img, num_channels_out);
+      ConversionHelperGray<int64_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::UInt64:
-      return ConversionHelperGray<uint64_t>(img, num_channels_out);
+      ConversionHelperGray<uint64_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::Float:
-      return ConversionHelperGray<float>(img, num_channels_out);
+      ConversionHelperGray<float>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::Double:
-      return ConversionHelperGray<double>(img, num_channels_out);
+      ConversionHelperGray<double>(img, dst, num_channels_out);
+      return;
+
+    case ImageBufferType::Float16:
+      ConversionHelperGray<float16_t>(img, dst, num_channels_out);
+      return;
+
+    case ImageBufferType::BFloat16:
+      ConversionHelperGray<bfloat16_t>(img, dst, num_channels_out);
+      return;
   }
 
   // Throw an exception as fallback, because ending up here would be an
@@ -172,8 +648,8 @@ inline ImageBuffer Gray2RGBx(
 
 
 template <typename _Tp>
-ImageBuffer ConversionHelperRGB(
-    const ImageBuffer &src, int channels_out) {
+void ConversionHelperRGB(
+    const ImageBuffer &src, ImageBuffer &dst, int channels_out) {
   SPDLOG_DEBUG(
         "ImageBuffer converting RGB(A) to {:d} channels.",
         channels_out);
@@ -198,75 +674,103 @@ ImageBuffer ConversionHelperRGB(
     throw std::invalid_argument(msg.str());
   }
 
-  // Create destination buffer (will have contiguous memory)
-  ImageBuffer dst(src.Height(), src.Width(), channels_out, src.BufferType());
+  // Reuse or create destination buffer (rows may be padded)
+  dst.EnsureShape(src.Height(), src.Width(), channels_out, src.BufferType());
+
+  if constexpr (HasConversionKernels<_Tp>()) {
+    if ((src.Channels() != channels_out)
+        && HasPackedPixels(src) && HasPackedPixels(dst)) {
+      const auto &kernels = simd::Kernels<_Tp>();
+      ApplyRowKernel<_Tp>(
+            src, dst, (channels_out == 4) ? kernels.rgb2rgba : kernels.rgba2rgb);
+      return;
+    }
+  }
 
   int rows = src.Height();
   int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
+  // Rows of dst may be padded, so it must be contiguous, too
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
   const bool add_alpha = (channels_out == 4);
-  for (int row = 0; row < rows; ++row) {
-//    _Tp *dst_ptr = dst.MutablePtr<_Tp>(row, 0);
-//    const _Tp *src_ptr = src.ImmutablePtr<_Tp>(row, 0);
-    for (int col = 0; col < cols; ++col) {
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        rows, cols, channels_out,
+        [&](int row, int col_begin, int col_end) {
+//    _Tp *dst_ptr = out.Ptr<_Tp>(row, col_begin, 0);
+//    const _Tp *src_ptr = src.ImmutablePtr<_Tp>(row, col_begin, 0);
+    for (int col = col_begin; col < col_end; ++col) {
       // FIXME: pointer access is much faster, but we need to take care
       //   of strided memory (e.g. numpy slices/views). Could implement a
       //   generic "pixelwise iterator"
 //      *dst_ptr++ = *src_ptr++;
 //      *dst_ptr++ = *src_ptr++;
 //      *dst_ptr++ = *src_ptr++;
-      dst.AtUnchecked<_Tp>(row, col, 0) = src.AtUnchecked<_Tp>(row, col, 0);
-      dst.AtUnchecked<_Tp>(row, col, 1) = src.AtUnchecked<_Tp>(row, col, 1);
-      dst.AtUnchecked<_Tp>(row, col, 2) = src.AtUnchecked<_Tp>(row, col, 2);
+      out.At<_Tp>(row, col, 0) = src.AtUnchecked<_Tp>(row, col, 0);
+      out.At<_Tp>(row, col, 1) = src.AtUnchecked<_Tp>(row, col, 1);
+      out.At<_Tp>(row, col, 2) = src.AtUnchecked<_Tp>(row, col, 2);
       // Two cases:
       // * RGBA --> RGB, we're already done
       // * RGB  --> RGBA, we must add the alpha channel
       if (add_alpha) {
-        dst.AtUnchecked<_Tp>(0, col, 3) = 255;
+        out.At<_Tp>(row, col, 3) = static_cast<_Tp>(255);
 //        *dst_ptr++ = 255;
       }
     }
-  }
-
-  return dst;
+  });
 }
 
 
 /// Selects the corresponding templated ConversionHelper
-inline ImageBuffer RGBx2RGBx(
-    const ImageBuffer &img, int num_channels_out) {
+inline void RGBx2RGBx(
+    const ImageBuffer &img, ImageBuffer &dst, int num_channels_out) {
   switch(img.BufferType()) {
     case ImageBufferType::UInt8:
-      return ConversionHelperRGB<uint8_t>(img, num_channels_out);
+      ConversionHelperRGB<uint8_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::Int16:
-      return ConversionHelperRGB<int16_t>(img, num_channels_out);
+      ConversionHelperRGB<int16_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::UInt16:
-      return ConversionHelperRGB<uint16_t>(img, num_channels_out);
+      ConversionHelperRGB<uint16_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::Int32:
-      return ConversionHelperRGB<int32_t>(img, num_channels_out);
+      ConversionHelperRGB<int32_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::UInt32:
-      return ConversionHelperRGB<uint32_t>(img, num_channels_out);
+      ConversionHelperRGB<uint32_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::Int64:
-      return ConversionHelperRGB<int64_t>(img, num_channels_out);
+      ConversionHelperRGB<int64_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::UInt64:
-      return ConversionHelperRGB<uint64_t>(img, num_channels_out);
+      ConversionHelperRGB<uint64_t>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::Float:
-      return ConversionHelperRGB<float>(img, num_channels_out);
+      ConversionHelperRGB<float>(img, dst, num_channels_out);
+      return;
 
     case ImageBufferType::Double:
-      return ConversionHelperRGB<double>(img, num_channels_out);
+      ConversionHelperRGB<double>(img, dst, num_channels_out);
+      return;
+
+    case ImageBufferType::Float16:
+      ConversionHelperRGB<float16_t>(img, dst, num_channels_out);
+      return;
+
+    case ImageBufferType::BFloat16:
+      ConversionHelperRGB<bfloat16_t>(img, dst, num_channels_out);
+      return;
   }
 
   // Throw an exception as fallback, because due to the default
@@ -282,33 +786,52 @@ inline ImageBuffer RGBx2RGBx(
 
 
 template <typename _Tp>
-ImageBuffer RGBx2Gray(
+void RGBx2Gray(
     const ImageBuffer &src,
+    ImageBuffer &dst,
     int channels_out,
     bool is_bgr_format) {
   SPDLOG_DEBUG(
         "ImageBuffer converting {:s} to {:d}-channel grayscale.",
         (is_bgr_format ? "BGR(A)" : "RGB(A)"), channels_out);
 
-  // Create destination buffer (will have contiguous memory)
-  ImageBuffer dst(src.Height(), src.Width(), channels_out, src.BufferType());
+  // Reuse or create destination buffer (rows may be padded)
+  dst.EnsureShape(src.Height(), src.Width(), channels_out, src.BufferType());
+
+  if constexpr (HasConversionKernels<_Tp>()) {
+    if (HasPackedPixels(src) && HasPackedPixels(dst)) {
+      const auto &kernels = simd::Kernels<_Tp>();
+      const int channels_in = src.Channels();
+      ApplyRowKernel<_Tp>(
+            src, dst,
+            [&kernels, channels_in, channels_out, is_bgr_format](
+              const _Tp *src_ptr, _Tp *dst_ptr, int64_t num_pixels) {
+        kernels.rgbx2gray(
+              src_ptr, dst_ptr, num_pixels, channels_in,
+              channels_out, is_bgr_format);
+      });
+      return;
+    }
+  }
 
   int rows = src.Height();
   int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
+  // Rows of dst may be padded, so it must be contiguous, too
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
   const int ch_r = is_bgr_format ? 2 : 0;
   const int ch_b = is_bgr_format ? 0 : 2;
-  _Tp luminance;
 
-  for (int row = 0; row < rows; ++row) {
-    _Tp *dst_ptr = dst.MutablePtr<_Tp>(row, 0, 0);
-    for (int col = 0; col < cols; ++col) {
-      luminance = CvtHelperRGB2Gray(
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        rows, cols, 8,
+        [&](int row, int col_begin, int col_end) {
+    _Tp *dst_ptr = out.Ptr<_Tp>(row, col_begin, 0);
+    for (int col = col_begin; col < col_end; ++col) {
+      const _Tp luminance = CvtHelperRGB2Gray(
             src.AtUnchecked<_Tp>(row, col, ch_r),
             src.AtUnchecked<_Tp>(row, col, 1),
             src.AtUnchecked<_Tp>(row, col, ch_b));
@@ -328,9 +851,7 @@ ImageBuffer RGBx2Gray(
         }
       }
     }
-  }
-
-  return dst;
+  });
 }
 
 
@@ -381,24 +902,25 @@ void PixelateImpl(ImageBuffer &roi, int block_width, int block_height) {
              ? (block_width + extend_right)
              : block_width);
       const int cx = left + bwidth / 2;
+      const viren2d::ImageBuffer &center = roi;
       viren2d::ImageBuffer block = roi.ROI(left, top, bwidth, bheight);
       if (C == 1) {
-        block.SetToScalar<_Tp>(roi.AtUnchecked<_Tp>(cy, cx, 0));
+        block.SetToScalar<_Tp>(center.AtUnchecked<_Tp>(cy, cx, 0));
       } else if (C == 2) {
         block.SetToPixel<_Tp>(
-              roi.AtUnchecked<_Tp>(cy, cx, 0),
-              roi.AtUnchecked<_Tp>(cy, cx, 1));
+              center.AtUnchecked<_Tp>(cy, cx, 0),
+              center.AtUnchecked<_Tp>(cy, cx, 1));
       } else if (C == 3) {
         block.SetToPixel<_Tp>(
-              roi.AtUnchecked<_Tp>(cy, cx, 0),
-              roi.AtUnchecked<_Tp>(cy, cx, 1),
-              roi.AtUnchecked<_Tp>(cy, cx, 2));
+              center.AtUnchecked<_Tp>(cy, cx, 0),
+              center.AtUnchecked<_Tp>(cy, cx, 1),
+              center.AtUnchecked<_Tp>(cy, cx, 2));
       } else {
         block.SetToPixel<_Tp>(
-              roi.AtUnchecked<_Tp>(cy, cx, 0),
-              roi.AtUnchecked<_Tp>(cy, cx, 1),
-              roi.AtUnchecked<_Tp>(cy, cx, 2),
-              roi.AtUnchecked<_Tp>(cy, cx, 3));
+              center.AtUnchecked<_Tp>(cy, cx, 0),
+              center.AtUnchecked<_Tp>(cy, cx, 1),
+              center.AtUnchecked<_Tp>(cy, cx, 2),
+              center.AtUnchecked<_Tp>(cy, cx, 3));
       }
 
       left += bwidth;
@@ -461,7 +983,7 @@ void MinMaxLocation(
 
   int rows = buf.Height();
   int cols = buf.Width();
-  if (buf.IsContiguous()) {
+  if (buf.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
@@ -506,10 +1028,308 @@ void MinMaxLocation(
 }
 
 
+/// Number of pixels which contribute to a single partial result of
+/// `ComputeStatistics`. This is independent of the number of threads,
+/// so that the results are reproducible.
+constexpr int64_t kStatisticsBlockSize = 1 << 14;
+
+
+/// Partial statistics of a single channel over a block of pixels. Sums
+/// are computed relative to the block's first valid value to reduce
+/// cancellation errors of the variance.
+template <typename _Tp>
+struct StatisticsBlock {
+  int64_t num_valid = 0;
+  int64_t num_nan = 0;
+  double offset = 0.0;
+  double sum = 0.0;
+  double sum_squares = 0.0;
+  _Tp min_val{};
+  _Tp max_val{};
+  int64_t min_idx = -1;
+  int64_t max_idx = -1;
+};
+
+
+/// Adds `num` consecutive values of a single channel, starting at pixel
+/// index `idx`, to the partial statistics via the SIMD reduction kernels.
+template <typename _Tp>
+void AccumulateStatistics(
+    const _Tp *values, int64_t num, int64_t idx, StatisticsBlock<_Tp> *s) {
+  static_assert(HasConversionKernels<_Tp>(),
+                "Reduction kernels only exist for uint8 and float!");
+  int64_t first = 0;
+  if (s->num_valid == 0) {
+    // Sums are relative to the block's first valid value, so leading
+    // NaNs must be skipped before invoking the kernel.
+    if constexpr (std::is_floating_point<_Tp>::value) {
+      while ((first < num) && std::isnan(values[first])) {
+        ++s->num_nan;
+        ++first;
+      }
+    }
+    if (first == num) {
+      return;
+    }
+    s->offset = static_cast<double>(values[first]);
+  }
+
+  simd::RangeStatistics<_Tp> range;
+  if constexpr (std::is_same<_Tp, uint8_t>::value) {
+    simd::ReduceKernels().uint8_statistics(
+          values + first, num - first, s->offset, &range);
+  } else {
+    simd::ReduceKernels().float_statistics(
+          values + first, num - first, s->offset, &range);
+  }
+
+  s->num_nan += range.num_nan;
+  if (range.num_valid == 0) {
+    return;
+  }
+  // Ties keep the first location, as in the scalar loop.
+  if ((s->num_valid == 0) || (range.min_val < s->min_val)) {
+    s->min_val = range.min_val;
+    s->min_idx = idx + first + range.min_idx;
+  }
+  if ((s->num_valid == 0) || (range.max_val > s->max_val)) {
+    s->max_val = range.max_val;
+    s->max_idx = idx + first + range.max_idx;
+  }
+  s->num_valid += range.num_valid;
+  s->sum += range.sum;
+  s->sum_squares += range.sum_squares;
+}
+
+
 template <typename _Tp>
-ImageBuffer BlendConstant(
+std::vector<ChannelStatistics> ComputeStatistics(
+    const ImageBuffer &buf, int num_bins,
+    double histogram_min, double histogram_max) {
+  SPDLOG_DEBUG(
+        "Computing statistics of {:s}, {:d} histogram bins.",
+        buf.ToString(), num_bins);
+
+  if ((num_bins < 0)
+      || ((num_bins > 0) && !(histogram_min < histogram_max))) {
+    std::ostringstream msg;
+    msg << "Invalid histogram configuration: " << num_bins
+        << " bins over [" << histogram_min << ", " << histogram_max << "]!";
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  const int channels = buf.Channels();
+  const int width = buf.Width();
+  const int64_t num_pixels = static_cast<int64_t>(width) * buf.Height();
+  // Strides are applied explicitly, so that views (e.g. single
+  // channels of an interleaved image) can be processed without copies.
+  const int64_t pixel_stride = buf.PixelStride();
+  const int64_t channel_stride = buf.ChannelStride();
+  const int64_t num_blocks =
+      (num_pixels + kStatisticsBlockSize - 1) / kStatisticsBlockSize;
+  const double bin_scale = (num_bins > 0)
+      ? (num_bins / (histogram_max - histogram_min)) : 0.0;
+
+  std::vector<StatisticsBlock<_Tp>> blocks(num_blocks * channels);
+  std::vector<int64_t> histogram(
+        static_cast<std::size_t>(num_bins) * channels, 0);
+  std::mutex histogram_mutex;
+
+  ParallelFor(
+        0, num_blocks, kStatisticsBlockSize * channels,
+        [&](int64_t block_begin, int64_t block_end) {
+    // Counts can be merged in any order, thus each chunk
+    // accumulates its own histogram.
+    std::vector<int64_t> local_hist(histogram.size(), 0);
+    auto add_to_histogram = [&](double dval, int ch) {
+      if ((dval >= histogram_min) && (dval <= histogram_max)) {
+        const int bin = std::min(
+              num_bins - 1,
+              static_cast<int>((dval - histogram_min) * bin_scale));
+        ++local_hist[ch * num_bins + bin];
+      }
+    };
+
+    for (int64_t block = block_begin; block < block_end; ++block) {
+      StatisticsBlock<_Tp> *stats = &blocks[block * channels];
+      const int64_t idx_end = std::min(
+            num_pixels, (block + 1) * kStatisticsBlockSize);
+      int64_t idx = block * kStatisticsBlockSize;
+      while (idx < idx_end) {
+        // Process the remaining pixels of the current row at once.
+        const int row = static_cast<int>(idx / width);
+        const int col = static_cast<int>(idx % width);
+        const int64_t num = std::min(idx_end - idx, int64_t(width - col));
+        const unsigned char *ptr = buf.ImmutablePtr<unsigned char>(row, col, 0);
+        if constexpr (HasConversionKernels<_Tp>()) {
+          // The min/max/sum reductions of a single packed channel are
+          // vectorized, only the histogram needs a scalar pass.
+          if ((channels == 1)
+              && (pixel_stride == static_cast<int64_t>(sizeof(_Tp)))) {
+            const _Tp *values = reinterpret_cast<const _Tp *>(ptr);
+            AccumulateStatistics(values, num, idx, stats);
+            if (num_bins > 0) {
+              for (int64_t i = 0; i < num; ++i) {
+                add_to_histogram(static_cast<double>(values[i]), 0);
+              }
+            }
+            idx += num;
+            continue;
+          }
+        }
+
+        for (int64_t i = 0; i < num; ++i, ptr += pixel_stride) {
+          for (int ch = 0; ch < channels; ++ch) {
+            const _Tp val = *reinterpret_cast<const _Tp *>(
+                  ptr + ch * channel_stride);
+            StatisticsBlock<_Tp> &s = stats[ch];
+            if constexpr (std::is_floating_point<_Tp>::value) {
+              if (std::isnan(val)) {
+                ++s.num_nan;
+                continue;
+              }
+            }
+
+            const double dval = static_cast<double>(val);
+            if (s.num_valid == 0) {
+              s.offset = dval;
+              s.min_val = val;
+              s.max_val = val;
+              s.min_idx = idx + i;
+              s.max_idx = idx + i;
+            } else if (val < s.min_val) {
+              s.min_val = val;
+              s.min_idx = idx + i;
+            } else if (val > s.max_val) {
+              s.max_val = val;
+              s.max_idx = idx + i;
+            }
+            ++s.num_valid;
+            const double centered = dval - s.offset;
+            s.sum += centered;
+            s.sum_squares += centered * centered;
+
+            if (num_bins > 0) {
+              add_to_histogram(dval, ch);
+            }
+          }
+        }
+        idx += num;
+      }
+    }
+
+    if (num_bins > 0) {
+      std::lock_guard<std::mutex> lock(histogram_mutex);
+      for (std::size_t bin = 0; bin < histogram.size(); ++bin) {
+        histogram[bin] += local_hist[bin];
+      }
+    }
+  });
+
+  // Merge the partial results in a fixed order (Chan et al.'s
+  // pairwise update of mean & sum of squared differences).
+  std::vector<ChannelStatistics> result(channels);
+  for (int ch = 0; ch < channels; ++ch) {
+    ChannelStatistics &cs = result[ch];
+    double mean = 0.0;
+    double m2 = 0.0;
+    _Tp min_val{};
+    _Tp max_val{};
+    int64_t min_idx = -1;
+    int64_t max_idx = -1;
+    for (int64_t block = 0; block < num_blocks; ++block) {
+      const StatisticsBlock<_Tp> &s = blocks[block * channels + ch];
+      cs.num_nan += s.num_nan;
+      if (s.num_valid == 0) {
+        continue;
+      }
+
+      const double n_block = static_cast<double>(s.num_valid);
+      const double mean_block = s.offset + (s.sum / n_block);
+      const double m2_block =
+          std::max(0.0, s.sum_squares - (s.sum * s.sum / n_block));
+      if (cs.num_valid == 0) {
+        mean = mean_block;
+        m2 = m2_block;
+        min_val = s.min_val;
+        max_val = s.max_val;
+        min_idx = s.min_idx;
+        max_idx = s.max_idx;
+      } else {
+        const double n_prev = static_cast<double>(cs.num_valid);
+        const double n_total = n_prev + n_block;
+        const double delta = mean_block - mean;
+        mean += delta * (n_block / n_total);
+        m2 += m2_block + (delta * delta * n_prev * n_block / n_total);
+        // Blocks are merged in order, so ties keep the first location.
+        if (s.min_val < min_val) {
+          min_val = s.min_val;
+          min_idx = s.min_idx;
+        }
+        if (s.max_val > max_val) {
+          max_val = s.max_val;
+          max_idx = s.max_idx;
+        }
+      }
+      cs.num_valid += s.num_valid;
+    }
+
+    if (cs.num_valid > 0) {
+      cs.min = static_cast<double>(min_val);
+      cs.max = static_cast<double>(max_val);
+      cs.min_location = Vec2i(
+            static_cast<int>(min_idx % width),
+            static_cast<int>(min_idx / width));
+      cs.max_location = Vec2i(
+            static_cast<int>(max_idx % width),
+            static_cast<int>(max_idx / width));
+      cs.mean = mean;
+      cs.variance = m2 / static_cast<double>(cs.num_valid);
+    }
+
+    if (num_bins > 0) {
+      cs.histogram.assign(
+            histogram.begin() + ch * num_bins,
+            histogram.begin() + (ch + 1) * num_bins);
+    }
+  }
+  return result;
+}
+
+
+/// Returns `(1 - alpha2) * value1 + alpha2 * value2`, where integral
+/// results are truncated.
+template <typename _Tp> inline
+_Tp BlendValues(_Tp value1, _Tp value2, double alpha2) {
+  return static_cast<_Tp>(((1.0 - alpha2) * value1) + (alpha2 * value2));
+}
+
+
+/// uint8 values are blended in 8.8 fixed-point, which rounds to the
+/// nearest integer, see `simd::BlendFixedPoint`.
+inline uint8_t BlendValues(uint8_t value1, uint8_t value2, double alpha2) {
+  return simd::BlendFixedPoint(
+        value1, value2, simd::FixedPointWeight(alpha2));
+}
+
+
+/// Returns true if both inputs and the output have packed pixels with
+/// the same number of channels, *i.e.* the rows can be blended by
+/// the element-wise kernels.
+inline bool CanUseBlendKernels(
+    const ImageBuffer &src1, const ImageBuffer &src2, const ImageBuffer &dst) {
+  return (src1.Channels() == src2.Channels())
+      && HasPackedPixels(src1) && HasPackedPixels(src2)
+      && HasPackedPixels(dst);
+}
+
+
+template <typename _Tp>
+void BlendConstant(
     const ImageBuffer &src1,
     const ImageBuffer &src2,
+    ImageBuffer &dst,
     double alpha2) {
   SPDLOG_DEBUG(
         "Blending {:s} and {:s} with alpha2={:f}.",
@@ -530,8 +1350,9 @@ ImageBuffer BlendConstant(
 
   const int channels_out = std::max(src1.Channels(), src2.Channels());
   const int channels_to_blend = std::min(src1.Channels(), src2.Channels());
-  // Create destination buffer (will have contiguous memory)
-  ImageBuffer dst(src1.Height(), src1.Width(), channels_out, src1.BufferType());
+  // Reuse or create destination buffer (rows may be padded)
+  dst.EnsureShape(
+        src1.Height(), src1.Width(), channels_out, src1.BufferType());
 
   // If the number of input channels are not the same, we fill the result
   // with values from the buffer that has more channels.
@@ -539,38 +1360,58 @@ ImageBuffer BlendConstant(
 
   int rows = src1.Height();
   int cols = src1.Width();
-  if (src1.IsContiguous() && src2.IsContiguous()) {
+  if (src1.IsFlattenable() && src2.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
-  for (int row = 0; row < rows; ++row) {
-    for (int col = 0; col < cols; ++col) {
+  const PixelWriter out(dst);
+  if constexpr (std::is_same<_Tp, uint8_t>::value) {
+    if (CanUseBlendKernels(src1, src2, dst)) {
+      const auto &kernels = simd::Kernels<uint8_t>();
+      const uint16_t weight2 = simd::FixedPointWeight(alpha2);
+      ParallelForPixels(
+            rows, cols, channels_out,
+            [&](int row, int col_begin, int col_end) {
+        kernels.blend_constant(
+              src1.ImmutablePtr<uint8_t>(row, col_begin, 0),
+              src2.ImmutablePtr<uint8_t>(row, col_begin, 0),
+              out.Ptr<uint8_t>(row, col_begin, 0),
+              static_cast<int64_t>(col_end - col_begin) * channels_out,
+              weight2);
+      });
+      return;
+    }
+  }
+
+  ParallelForPixels(
+        rows, cols, 2 * channels_out,
+        [&](int row, int col_begin, int col_end) {
+    for (int col = col_begin; col < col_end; ++col) {
       for (int ch = 0; ch < channels_out; ++ch) {
         if (ch < channels_to_blend) {
-          dst.AtUnchecked<_Tp>(row, col, ch) = static_cast<_Tp>(
-                ((1.0 - alpha2) * src1.AtUnchecked<_Tp>(row, col, ch))
-                + (alpha2 * src2.AtUnchecked<_Tp>(row, col, ch)));
+          out.At<_Tp>(row, col, ch) = BlendValues(
+                src1.AtUnchecked<_Tp>(row, col, ch),
+                src2.AtUnchecked<_Tp>(row, col, ch), alpha2);
         } else {
-          dst.AtUnchecked<_Tp>(row, col, ch) =
+          out.At<_Tp>(row, col, ch) =
               rem_channels.AtUnchecked<_Tp>(row, col, ch);
         }
       }
     }
-  }
-
-  return dst;
+  });
 }
 
 template <typename _TImage, typename _TWeights>
-ImageBuffer BlendWeightsImpl(
+void BlendWeightsImpl(
     const ImageBuffer &src1,
     const ImageBuffer &src2,
+    ImageBuffer &dst,
     const ImageBuffer &alpha2) {
   const int channels_out = std::max(src1.Channels(), src2.Channels());
   const int channels_to_blend = std::min(src1.Channels(), src2.Channels());
-  // Create destination buffer (will have contiguous memory)
-  ImageBuffer dst(
+  // Reuse or create destination buffer (rows may be padded)
+  dst.EnsureShape(
         src1.Height(), src1.Width(), channels_out, src1.BufferType());
 
   // If the number of input channels are not the same, we fill the result
@@ -580,36 +1421,62 @@ ImageBuffer BlendWeightsImpl(
 
   int rows = src1.Height();
   int cols = src1.Width();
-  if (src1.IsContiguous() && src2.IsContiguous() && alpha2.IsContiguous()) {
+  if (src1.IsFlattenable() && src2.IsFlattenable()
+      && alpha2.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
-  for (int row = 0; row < rows; ++row) {
-    for (int col = 0; col < cols; ++col) {
+  const PixelWriter out(dst);
+  // The kernels read float weights directly from the weight rows, either
+  // one per pixel or one per element.
+  if constexpr (std::is_same<_TImage, uint8_t>::value
+                && std::is_same<_TWeights, float>::value) {
+    const int weight_channels = alpha2.Channels();
+    if (CanUseBlendKernels(src1, src2, dst) && HasPackedPixels(alpha2)
+        && ((weight_channels == 1) || (weight_channels == channels_out))) {
+      const auto &kernels = simd::Kernels<uint8_t>();
+      ParallelForPixels(
+            rows, cols, channels_out,
+            [&](int row, int col_begin, int col_end) {
+        kernels.blend_weights(
+              src1.ImmutablePtr<uint8_t>(row, col_begin, 0),
+              src2.ImmutablePtr<uint8_t>(row, col_begin, 0),
+              alpha2.ImmutablePtr<float>(row, col_begin, 0),
+              out.Ptr<uint8_t>(row, col_begin, 0),
+              col_end - col_begin, channels_out, weight_channels);
+      });
+      return;
+    }
+  }
+
+  ParallelForPixels(
+        rows, cols, 2 * channels_out,
+        [&](int row, int col_begin, int col_end) {
+    for (int col = col_begin; col < col_end; ++col) {
       for (int ch = 0; ch < channels_out; ++ch) {
         if (ch < channels_to_blend) {
           const _TWeights a2 = alpha2.AtUnchecked<_TWeights>(
                 row, col, (ch < alpha2.Channels()) ? ch : 0);
-          dst.AtUnchecked<_TImage>(row, col, ch) = static_cast<_TImage>(
-                ((1.0 - a2) * src1.AtUnchecked<_TImage>(row, col, ch))
-                + (a2 * src2.AtUnchecked<_TImage>(row, col, ch)));
+          out.At<_TImage>(row, col, ch) = BlendValues(
+                src1.AtUnchecked<_TImage>(row, col, ch),
+                src2.AtUnchecked<_TImage>(row, col, ch),
+                static_cast<double>(a2));
         } else {
-          dst.AtUnchecked<_TImage>(row, col, ch) =
+          out.At<_TImage>(row, col, ch) =
               rem_channels.AtUnchecked<_TImage>(row, col, ch);
         }
       }
     }
-  }
-
-  return dst;
+  });
 }
 
 
 template <typename _Tp>
-ImageBuffer BlendWeights(
+void BlendWeights(
     const ImageBuffer &src1,
     const ImageBuffer &src2,
+    ImageBuffer &dst,
     const ImageBuffer &alpha2) {
   SPDLOG_DEBUG(
         "Blending {:s} and {:s} with alpha2={:s}.",
@@ -646,10 +1513,12 @@ ImageBuffer BlendWeights(
 
   switch (alpha2.BufferType()) {
     case ImageBufferType::Double:
-      return BlendWeightsImpl<_Tp, double>(src1, src2, alpha2);
+      BlendWeightsImpl<_Tp, double>(src1, src2, dst, alpha2);
+      return;
 
     case ImageBufferType::Float:
-      return BlendWeightsImpl<_Tp, float>(src1, src2, alpha2);
+      BlendWeightsImpl<_Tp, float>(src1, src2, dst, alpha2);
+      return;
 
     default: {
         std::string msg(
@@ -663,41 +1532,251 @@ ImageBuffer BlendWeights(
 }
 
 
-template <typename _T>
-ImageBuffer DimImpl(
+template <typename _Tp>
+void BlendPackedMask(
+    const ImageBuffer &src1,
+    const ImageBuffer &src2,
+    ImageBuffer &dst,
+    const PackedMask &mask,
+    double alpha2) {
+  SPDLOG_DEBUG(
+        "Blending {:s} and {:s} with alpha2={:f} and {:s}.",
+        src1.ToString(), src2.ToString(), alpha2, mask.ToString());
+
+  if ((src1.Width() != src2.Width())
+      || (src1.Height() != src2.Height())
+      || (src1.BufferType() != src2.BufferType())) {
+    std::string msg(
+          "Blending is only supported for ImageBuffers with same size and "
+          "type, but got: ");
+    msg += src1.ToString();
+    msg += " vs. ";
+    msg += src2.ToString();
+    msg += '!';
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  if ((src1.Width() != mask.Width()) || (src1.Height() != mask.Height())) {
+    std::string msg(
+          "Blending mask must have the same size as the inputs, but got: ");
+    msg += mask.ToString();
+    msg += " vs. ";
+    msg += src1.ToString();
+    msg += '!';
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  const int channels_out = std::max(src1.Channels(), src2.Channels());
+  const int channels_to_blend = std::min(src1.Channels(), src2.Channels());
+  // Reuse or create destination buffer (rows may be padded)
+  dst.EnsureShape(
+        src1.Height(), src1.Width(), channels_out, src1.BufferType());
+
+  // If the number of input channels are not the same, we fill the result
+  // with values from the buffer that has more channels.
+  const ImageBuffer &rem_channels =
+      (src1.Channels() > src2.Channels()) ? src1 : src2;
+
+  const int width = src1.Width();
+  // The mask is processed word-wise, i.e. the rows are not flattened.
+  const PixelWriter out(dst);
+  ParallelFor(
+        0, src1.Height(), 2 * static_cast<int64_t>(channels_out) * width,
+        [&](int64_t row_begin, int64_t row_end) {
+    for (int64_t r = row_begin; r < row_end; ++r) {
+      const int row = static_cast<int>(r);
+      const uint64_t *bits = mask.RowPtr(row);
+      for (int col_begin = 0; col_begin < width; col_begin += 64) {
+        const uint64_t word = bits[col_begin >> 6];
+        const int col_end = std::min(width, col_begin + 64);
+        for (int col = col_begin; col < col_end; ++col) {
+          const bool is_set = (word >> (col - col_begin)) & 1;
+          for (int ch = 0; ch < channels_out; ++ch) {
+            if (ch >= channels_to_blend) {
+              out.At<_Tp>(row, col, ch) =
+                  rem_channels.AtUnchecked<_Tp>(row, col, ch);
+            } else if (is_set) {
+              out.At<_Tp>(row, col, ch) = BlendValues(
+                    src1.AtUnchecked<_Tp>(row, col, ch),
+                    src2.AtUnchecked<_Tp>(row, col, ch), alpha2);
+            } else {
+              out.At<_Tp>(row, col, ch) =
+                  src1.AtUnchecked<_Tp>(row, col, ch);
+            }
+          }
+        }
+      }
+    }
+  });
+}
+
+
+/// Returns the color of a pixel composited by the overlay's `alpha`.
+template <typename _Tp> inline
+_Tp CompositeColor(_Tp value, _Tp overlay, _Tp alpha) {
+  return (static_cast<_Tp>(1) - alpha) * value + alpha * overlay;
+}
+
+
+inline uint8_t CompositeColor(uint8_t value, uint8_t overlay, uint8_t alpha) {
+  return simd::BlendFixedPoint(
+        value, overlay, simd::FixedPointWeight(alpha));
+}
+
+
+/// Returns the alpha value of a composited pixel.
+template <typename _Tp> inline
+_Tp CompositeAlpha(_Tp alpha, _Tp alpha_overlay) {
+  return alpha_overlay + alpha * (static_cast<_Tp>(1) - alpha_overlay);
+}
+
+
+inline uint8_t CompositeAlpha(uint8_t alpha, uint8_t alpha_overlay) {
+  return static_cast<uint8_t>(
+        alpha_overlay + simd::BlendFixedPoint(
+          alpha, 0, simd::FixedPointWeight(alpha_overlay)));
+}
+
+
+/// Composites the 4-channel `overlay` over the 3- or 4-channel `src`,
+/// see `ImageBuffer::AlphaComposite`.
+template <typename _Tp>
+void AlphaCompositeImpl(
     const ImageBuffer &src,
-    double &alpha) {
-  // Create destination buffer (will have contiguous memory)
-  ImageBuffer dst(src.Height(), src.Width(), src.Channels(), src.BufferType());
+    const ImageBuffer &overlay,
+    ImageBuffer &dst) {
+  SPDLOG_DEBUG(
+        "Compositing {:s} over {:s}.", overlay.ToString(), src.ToString());
+
+  if ((src.Width() != overlay.Width())
+      || (src.Height() != overlay.Height())
+      || (src.BufferType() != overlay.BufferType())) {
+    std::string msg(
+          "Alpha compositing is only supported for ImageBuffers with same "
+          "size and type, but got: ");
+    msg += src.ToString();
+    msg += " vs. ";
+    msg += overlay.ToString();
+    msg += '!';
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  if ((overlay.Channels() != 4)
+      || ((src.Channels() != 3) && (src.Channels() != 4))) {
+    std::string msg(
+          "Alpha compositing requires a 4-channel overlay and a 3- or "
+          "4-channel image, but got: ");
+    msg += overlay.ToString();
+    msg += " over ";
+    msg += src.ToString();
+    msg += '!';
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
+
+  const int channels = src.Channels();
+  // Reuse or create destination buffer (rows may be padded)
+  dst.EnsureShape(src.Height(), src.Width(), channels, src.BufferType());
+  const PixelWriter out(dst);
 
   int rows = src.Height();
   int cols = src.Width();
-  if (src.IsContiguous()) {
+  if (src.IsFlattenable() && overlay.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
-  for (int row = 0; row < rows; ++row) {
-    const _T *src_ptr = src.ImmutablePtr<_T>(row, 0);
-    _T *dst_ptr = dst.MutablePtr<_T>(row, 0);
-    for (int col = 0; col < cols; ++col) {
-      for (int ch = 0; ch < src.Channels(); ++ch) {
-        *dst_ptr = static_cast<_T>(alpha * (*src_ptr));
-        ++dst_ptr;
-        ++src_ptr;
+  if constexpr (HasConversionKernels<_Tp>()) {
+    if (HasPackedPixels(src) && HasPackedPixels(overlay)
+        && HasPackedPixels(dst)) {
+      const auto &kernels = simd::Kernels<_Tp>();
+      ParallelForPixels(
+            rows, cols, channels,
+            [&](int row, int col_begin, int col_end) {
+        kernels.alpha_composite(
+              src.ImmutablePtr<_Tp>(row, col_begin, 0),
+              overlay.ImmutablePtr<_Tp>(row, col_begin, 0),
+              out.Ptr<_Tp>(row, col_begin, 0),
+              static_cast<int64_t>(col_end - col_begin), channels);
+      });
+      return;
+    }
+  }
+
+  ParallelForPixels(
+        rows, cols, 2 * channels,
+        [&](int row, int col_begin, int col_end) {
+    for (int col = col_begin; col < col_end; ++col) {
+      const _Tp alpha = overlay.AtUnchecked<_Tp>(row, col, 3);
+      _Tp values[4];
+      for (int ch = 0; ch < 3; ++ch) {
+        values[ch] = CompositeColor(
+              src.AtUnchecked<_Tp>(row, col, ch),
+              overlay.AtUnchecked<_Tp>(row, col, ch), alpha);
+      }
+      if (channels == 4) {
+        values[3] = CompositeAlpha(src.AtUnchecked<_Tp>(row, col, 3), alpha);
+      }
+      // Write after reading all channels, because `dst` may be `src`
+      for (int ch = 0; ch < channels; ++ch) {
+        out.At<_Tp>(row, col, ch) = values[ch];
       }
     }
+  });
+}
+
+
+template <typename _T>
+void DimImpl(
+    const ImageBuffer &src,
+    ImageBuffer &dst,
+    double alpha) {
+  // Reuse or create destination buffer (rows may be padded)
+  dst.EnsureShape(src.Height(), src.Width(), src.Channels(), src.BufferType());
+
+  int rows = src.Height();
+  int cols = src.Width();
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
+    cols *= rows;
+    rows = 1;
   }
 
-  return dst;
+  const int channels = src.Channels();
+  const int64_t src_pixel_stride = src.PixelStride();
+  const int64_t src_channel_stride = src.ChannelStride();
+  const int64_t dst_pixel_stride = dst.PixelStride();
+  const int64_t dst_channel_stride = dst.ChannelStride();
+
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        rows, cols, channels,
+        [&](int row, int col_begin, int col_end) {
+    // Strides are applied explicitly, because both buffers could
+    // be views (and this is also used for in-place dimming).
+    const unsigned char *src_ptr =
+        src.ImmutablePtr<unsigned char>(row, col_begin, 0);
+    unsigned char *dst_ptr = out.Ptr<unsigned char>(row, col_begin, 0);
+    for (int col = col_begin; col < col_end; ++col) {
+      for (int ch = 0; ch < channels; ++ch) {
+        *reinterpret_cast<_T *>(dst_ptr + ch * dst_channel_stride) =
+            static_cast<_T>(alpha * *reinterpret_cast<const _T *>(
+                              src_ptr + ch * src_channel_stride));
+      }
+      src_ptr += src_pixel_stride;
+      dst_ptr += dst_pixel_stride;
+    }
+  });
 }
 
 
 template <typename _Tp>
-ImageBuffer ToUInt8(const ImageBuffer &src, int channels_out, uint8_t scale) {
+void ToUInt8(const ImageBuffer &src, ImageBuffer &dst, int channels_out) {
   SPDLOG_DEBUG(
-        "Converting {:s} to {:d}-channel `uint8`, scale={}.",
-        src.ToString(), channels_out, (int)scale);
+        "Converting {:s} to {:d}-channel `uint8`.",
+        src.ToString(), channels_out);
 
   if ((channels_out < 1)
       || (channels_out == 2)
@@ -712,134 +1791,225 @@ ImageBuffer ToUInt8(const ImageBuffer &src, int channels_out, uint8_t scale) {
   }
 
   if (src.BufferType() == ImageBufferType::UInt8) {
-    return src.ToChannels(channels_out);
+    src.ToChannels(&dst, channels_out);
+    return;
+  }
+
+  // Reuse or create destination buffer (rows may be padded)
+  dst.EnsureShape(
+        src.Height(), src.Width(), channels_out, ImageBufferType::UInt8);
+
+  // RGBA outputs with packed pixels are converted in a single pass by
+  // the fused kernel (which is also used to prepare cairo surfaces). It
+  // only supports gray, RGB and RGBA inputs.
+  if ((channels_out == 4) && (src.Channels() != 2)
+      && (dst.PixelStride() == 4) && dst.HasContiguousChannels()) {
+    ConvertToRGBA8(src, PixelWriter(dst).Data(), dst.RowStride());
+    return;
   }
 
-  // Create destination buffer (will have contiguous memory)
-  ImageBuffer dst(src.Height(), src.Width(), channels_out, ImageBufferType::UInt8);
+  if constexpr (HasCastKernel<_Tp, uint8_t>()) {
+    if ((channels_out == src.Channels())
+        && CastPacked<_Tp, uint8_t>(
+          src, dst, std::numeric_limits<_Tp>::is_integer ? 1.0 : 255.0)) {
+      return;
+    }
+  }
 
   int rows = src.Height();
   int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
+  // Rows of dst may be padded, so it must be contiguous, too
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
-  for (int row = 0; row < rows; ++row) {
-    for (int col = 0; col < cols; ++col) {
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        rows, cols, channels_out,
+        [&](int row, int col_begin, int col_end) {
+    for (int col = col_begin; col < col_end; ++col) {
       for (int ch = 0; ch < channels_out; ++ch) {
         if (ch < src.Channels()) {
-          dst.AtUnchecked<uint8_t>(row, col, ch) = static_cast<uint8_t>(
-                scale * src.AtUnchecked<_Tp>(row, col, ch));
+          out.At<uint8_t>(row, col, ch) = simd::SaturateUInt8(
+                src.AtUnchecked<_Tp>(row, col, ch));
         } else {
           if (ch == 3) {
-            dst.AtUnchecked<uint8_t>(row, col, ch) = 255;
+            out.At<uint8_t>(row, col, ch) = 255;
           } else {
-            dst.AtUnchecked<uint8_t>(row, col, ch) = *(dst.ImmutablePtr<uint8_t>(row, col, 0));
+            out.At<uint8_t>(row, col, ch) = *(dst.ImmutablePtr<uint8_t>(row, col, 0));
           }
         }
       }
     }
-  }
-
-  return dst;
+  });
 }
 
 
 template <typename _Tp>
-ImageBuffer ToFloat(const ImageBuffer &src, float scale) {
+void ToFloat(const ImageBuffer &src, ImageBuffer &dst, float scale) {
   SPDLOG_DEBUG("Converting {:s} to `float`, scale={}.", src.ToString(), scale);
 
   if (src.BufferType() == ImageBufferType::Float) {
-    return src.DeepCopy();
+    CopyPixels(src, dst);
+    return;
   }
 
-  // Create destination buffer (will have contiguous memory)
-  ImageBuffer dst(src.Height(), src.Width(), src.Channels(), ImageBufferType::Float);
+  // Reuse or create destination buffer (rows may be padded)
+  dst.EnsureShape(
+        src.Height(), src.Width(), src.Channels(), ImageBufferType::Float);
+
+  if constexpr (IsHalfPrecision<_Tp>()) {
+    if ((scale == 1.0f) && ConvertHalfPrecisionPacked<_Tp, float>(src, dst)) {
+      return;
+    }
+  } else if constexpr (HasCastKernel<_Tp, float>()) {
+    if (CastPacked<_Tp, float>(src, dst, scale)) {
+      return;
+    }
+  }
 
   int rows = src.Height();
   int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
+  // Rows of dst may be padded, so it must be contiguous, too
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
-  for (int row = 0; row < rows; ++row) {
-    for (int col = 0; col < cols; ++col) {
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        rows, cols, src.Channels(),
+        [&](int row, int col_begin, int col_end) {
+    for (int col = col_begin; col < col_end; ++col) {
       for (int ch = 0; ch < src.Channels(); ++ch) {
-        dst.AtUnchecked<float>(row, col, ch) = static_cast<float>(
+        out.At<float>(row, col, ch) = static_cast<float>(
                 scale * src.AtUnchecked<_Tp>(row, col, ch));
       }
     }
-  }
-
-  return dst;
+  });
 }
 
 
 
 template <typename _Tp_src, ImageBufferType _BTp_dst>
-ImageBuffer ConvertTypeImpl(
-    const ImageBuffer &src, double scale) {
-  ImageBuffer dst(src.Height(), src.Width(), src.Channels(), _BTp_dst);
+void ConvertTypeImpl(
+    const ImageBuffer &src, ImageBuffer &dst, double scale, bool saturate) {
+  dst.EnsureShape(src.Height(), src.Width(), src.Channels(), _BTp_dst);
+
+  using _Tp_dst = image_buffer_t<_BTp_dst>;
+  // Conversions between float & half precision are vectorized
+  if constexpr ((IsHalfPrecision<_Tp_src>()
+                 && std::is_same<_Tp_dst, float>::value)
+                || (std::is_same<_Tp_src, float>::value
+                    && IsHalfPrecision<_Tp_dst>())) {
+    if ((scale == 1.0)
+        && ConvertHalfPrecisionPacked<_Tp_src, _Tp_dst>(src, dst)) {
+      return;
+    }
+  }
+
+  // Without scaling, the vectorized kernels match the scalar casts.
+  // Casts to `uint8` always saturate, thus they are only used if
+  // requested (otherwise, out of range values are undefined anyways).
+  if constexpr (HasCastKernel<_Tp_src, _Tp_dst>()) {
+    if ((scale == 1.0)
+        && (saturate || std::is_same<_Tp_dst, float>::value)
+        && CastPacked<_Tp_src, _Tp_dst>(src, dst, scale)) {
+      return;
+    }
+  }
+
   int rows = src.Height();
   int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
+  // Rows of dst may be padded, so it must be contiguous, too
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
-  using _Tp_dst = image_buffer_t<_BTp_dst>;
-  for (int row = 0; row < rows; ++row) {
-    for (int col = 0; col < cols; ++col) {
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        rows, cols, src.Channels(),
+        [&](int row, int col_begin, int col_end) {
+    for (int col = col_begin; col < col_end; ++col) {
       for (int ch = 0; ch < src.Channels(); ++ch) {
-        dst.AtUnchecked<_Tp_dst>(row, col, ch) = static_cast<_Tp_dst>(
+        if (saturate) {
+          out.At<_Tp_dst>(row, col, ch) = SaturateCast<_Tp_dst>(
+                scale * src.AtUnchecked<_Tp_src>(row, col, ch));
+        } else {
+          out.At<_Tp_dst>(row, col, ch) = static_cast<_Tp_dst>(
                 scale * src.AtUnchecked<_Tp_src>(row, col, ch));
+        }
       }
     }
-  }
-
-  return dst;
+  });
 }
 
 
 template <typename _Tsrc>
-ImageBuffer ConvertType(
-    const ImageBuffer &src, ImageBufferType dst_type, double scale) {
+void ConvertType(
+    const ImageBuffer &src, ImageBuffer &dst,
+    ImageBufferType dst_type, double scale, bool saturate) {
   SPDLOG_DEBUG(
         "Converting {:s} to `{:s}`, scale={:.2f}.",
         src.ToString(), dst_type, scale);
 
   switch (dst_type) {
     case ImageBufferType::UInt8:
-      return ConvertTypeImpl<_Tsrc, ImageBufferType::UInt8>(src, scale);
+      ConvertTypeImpl<_Tsrc, ImageBufferType::UInt8>(
+          src, dst, scale, saturate);
+      return;
 
     case ImageBufferType::Int16:
-      return ConvertTypeImpl<_Tsrc, ImageBufferType::Int16>(src, scale);
+      ConvertTypeImpl<_Tsrc, ImageBufferType::Int16>(
+          src, dst, scale, saturate);
+      return;
 
     case ImageBufferType::UInt16:
-      return ConvertTypeImpl<_Tsrc, ImageBufferType::UInt16>(src, scale);
+      ConvertTypeImpl<_Tsrc, ImageBufferType::UInt16>(
+          src, dst, scale, saturate);
+      return;
 
     case ImageBufferType::Int32:
-      return ConvertTypeImpl<_Tsrc, ImageBufferType::Int32>(src, scale);
+      ConvertTypeImpl<_Tsrc, ImageBufferType::Int32>(
+          src, dst, scale, saturate);
+      return;
 
     case ImageBufferType::UInt32:
-      return ConvertTypeImpl<_Tsrc, ImageBufferType::UInt32>(src, scale);
+      ConvertTypeImpl<_Tsrc, ImageBufferType::UInt32>(
+          src, dst, scale, saturate);
+      return;
 
     case ImageBufferType::Int64:
-      return ConvertTypeImpl<_Tsrc, ImageBufferType::Int64>(src, scale);
+      ConvertTypeImpl<_Tsrc, ImageBufferType::Int64>(
+          src, dst, scale, saturate);
+      return;
 
     case ImageBufferType::UInt64:
-      return ConvertTypeImpl<_Tsrc, ImageBufferType::UInt64>(src, scale);
+      ConvertTypeImpl<_Tsrc, ImageBufferType::UInt64>(
+          src, dst, scale, saturate);
+      return;
 
     case ImageBufferType::Float:
-      return ConvertTypeImpl<_Tsrc, ImageBufferType::Float>(src, scale);
+      ConvertTypeImpl<_Tsrc, ImageBufferType::Float>(
+          src, dst, scale, saturate);
+      return;
 
     case ImageBufferType::Double:
-      return ConvertTypeImpl<_Tsrc, ImageBufferType::Double>(src, scale);
+      ConvertTypeImpl<_Tsrc, ImageBufferType::Double>(
+          src, dst, scale, saturate);
+      return;
+
+    case ImageBufferType::Float16:
+      ConvertTypeImpl<_Tsrc, ImageBufferType::Float16>(
+          src, dst, scale, saturate);
+      return;
+
+    case ImageBufferType::BFloat16:
+      ConvertTypeImpl<_Tsrc, ImageBufferType::BFloat16>(
+          src, dst, scale, saturate);
+      return;
   }
 
   // Throw an exception as fallback, because ending up here would be an
@@ -854,38 +2024,38 @@ ImageBuffer ConvertType(
 
 
 template <typename _Tp>
-ImageBuffer Magnitude(const ImageBuffer &src) {
+void Magnitude(const ImageBuffer &src, ImageBuffer &dst) {
   SPDLOG_DEBUG("Computing magnitude of {:s}.", src.ToString());
 
-  ImageBuffer dst(src.Height(), src.Width(), 1, src.BufferType());
+  dst.EnsureShape(src.Height(), src.Width(), 1, src.BufferType());
 
   int rows = src.Height();
   int cols = src.Width();
-  if (src.IsContiguous()) {
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
-  for (int row = 0; row < rows; ++row) {
-    _Tp *dst_ptr = dst.MutablePtr<_Tp>(row, 0, 0);
-    const _Tp *src_ptr = src.ImmutablePtr<_Tp>(row, 0, 0);
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        rows, cols, 4 * src.Channels(),
+        [&](int row, int col_begin, int col_end) {
+    _Tp *dst_ptr = out.Ptr<_Tp>(row, col_begin, 0);
 
-    for (int col = 0; col < cols; ++col) {
+    for (int col = col_begin; col < col_end; ++col) {
       _Tp sqr_sum = 0.0f;
       for (int ch = 0; ch < src.Channels(); ++ch) {
-        const _Tp val = *src_ptr++;
+        const _Tp val = src.AtUnchecked<_Tp>(row, col, ch);
         sqr_sum += (val * val);
       }
       *dst_ptr++ = std::sqrt(sqr_sum);
     }
-  }
-
-  return dst;
+  });
 }
 
 
 template <typename _Tp>
-ImageBuffer Orientation(const ImageBuffer &src, float invalid) {
+void Orientation(const ImageBuffer &src, ImageBuffer &dst, float invalid) {
   SPDLOG_DEBUG("Computing orientation of {:s}.", src.ToString());
 
   if (src.Channels() != 2) {
@@ -897,31 +2067,31 @@ ImageBuffer Orientation(const ImageBuffer &src, float invalid) {
     throw std::invalid_argument(msg);
   }
 
-  ImageBuffer dst(src.Height(), src.Width(), 1, src.BufferType());
+  dst.EnsureShape(src.Height(), src.Width(), 1, src.BufferType());
 
   int rows = src.Height();
   int cols = src.Width();
-  if (src.IsContiguous()) {
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
-  for (int row = 0; row < rows; ++row) {
-    _Tp *dst_ptr = dst.MutablePtr<_Tp>(row, 0, 0);
-    const _Tp *src_ptr = src.ImmutablePtr<_Tp>(row, 0, 0);
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        rows, cols, 32,
+        [&](int row, int col_begin, int col_end) {
+    _Tp *dst_ptr = out.Ptr<_Tp>(row, col_begin, 0);
 
-    for (int col = 0; col < cols; ++col) {
-      _Tp u = *src_ptr++;
-      _Tp v = *src_ptr++;
+    for (int col = col_begin; col < col_end; ++col) {
+      const _Tp u = src.AtUnchecked<_Tp>(row, col, 0);
+      const _Tp v = src.AtUnchecked<_Tp>(row, col, 1);
       if (wkg::IsEpsZero(u) && wkg::IsEpsZero(v)) {
         *dst_ptr++ = static_cast<_Tp>(invalid);
       } else {
         *dst_ptr++ = std::atan2(v, u);
       }
     }
-  }
-
-  return dst;
+  });
 }
 
 
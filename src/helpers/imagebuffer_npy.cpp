@@ -0,0 +1,347 @@
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <helpers/imagebuffer_npy.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// Magic string at the beginning of each `.npy` file.
+constexpr char kNpyMagic[] = "\x93NUMPY";
+constexpr std::size_t kNpyMagicLength = 6;
+
+
+[[noreturn]] void ThrowMalformedNpy(
+    const std::string &filename, const std::string &reason) {
+  std::string msg("Invalid NPY file \"");
+  msg += filename;
+  msg += "\": ";
+  msg += reason;
+  msg += '!';
+  SPDLOG_ERROR(msg);
+  throw std::runtime_error(msg);
+}
+
+
+[[noreturn]] void ThrowUnsupportedNpy(
+    const std::string &filename, const std::string &reason) {
+  std::string msg("Unsupported NPY file \"");
+  msg += filename;
+  msg += "\": ";
+  msg += reason;
+  msg += '!';
+  SPDLOG_ERROR(msg);
+  throw std::invalid_argument(msg);
+}
+
+
+inline bool IsLittleEndianHost() {
+  const uint16_t probe = 1;
+  return *reinterpret_cast<const uint8_t *>(&probe) == 1;
+}
+
+
+/// Returns the (trimmed) value of the given key within the header's
+/// python dictionary literal, *e.g.* `'<f4'` for key `descr`.
+std::string DictValue(
+    const std::string &dict, const std::string &key,
+    const std::string &filename) {
+  std::size_t pos = dict.find("'" + key + "'");
+  if (pos == std::string::npos) {
+    pos = dict.find("\"" + key + "\"");
+  }
+  if (pos == std::string::npos) {
+    ThrowMalformedNpy(filename, "header lacks key '" + key + "'");
+  }
+
+  pos = dict.find(':', pos + key.length() + 2);
+  if (pos == std::string::npos) {
+    ThrowMalformedNpy(filename, "header lacks value of '" + key + "'");
+  }
+  ++pos;
+  while ((pos < dict.length())
+         && std::isspace(static_cast<unsigned char>(dict[pos]))) {
+    ++pos;
+  }
+  if (pos >= dict.length()) {
+    ThrowMalformedNpy(filename, "header lacks value of '" + key + "'");
+  }
+
+  std::size_t end;
+  if ((dict[pos] == '\'') || (dict[pos] == '"')) {
+    end = dict.find(dict[pos], pos + 1);
+    if (end == std::string::npos) {
+      ThrowMalformedNpy(filename, "unterminated string in header");
+    }
+    return dict.substr(pos + 1, end - pos - 1);
+  } else if (dict[pos] == '(') {
+    end = dict.find(')', pos);
+    if (end == std::string::npos) {
+      ThrowMalformedNpy(filename, "unterminated tuple in header");
+    }
+    return dict.substr(pos + 1, end - pos - 1);
+  }
+
+  end = dict.find_first_of(",}", pos);
+  if (end == std::string::npos) {
+    end = dict.length();
+  }
+  while ((end > pos)
+         && std::isspace(static_cast<unsigned char>(dict[end - 1]))) {
+    --end;
+  }
+  return dict.substr(pos, end - pos);
+}
+
+
+ImageBufferType BufferTypeFromDescr(
+    const std::string &descr, const std::string &filename) {
+  if (descr.length() < 3) {
+    ThrowUnsupportedNpy(filename, "invalid dtype '" + descr + "'");
+  }
+
+  const char byte_order = descr[0];
+  const char kind = descr[1];
+  const std::string size = descr.substr(2);
+
+  ImageBufferType type;
+  if (((kind == 'u') || (kind == 'b')) && (size == "1")) {
+    // Boolean arrays are stored as one byte per value.
+    type = ImageBufferType::UInt8;
+  } else if ((kind == 'i') && (size == "2")) {
+    type = ImageBufferType::Int16;
+  } else if ((kind == 'u') && (size == "2")) {
+    type = ImageBufferType::UInt16;
+  } else if ((kind == 'i') && (size == "4")) {
+    type = ImageBufferType::Int32;
+  } else if ((kind == 'u') && (size == "4")) {
+    type = ImageBufferType::UInt32;
+  } else if ((kind == 'i') && (size == "8")) {
+    type = ImageBufferType::Int64;
+  } else if ((kind == 'u') && (size == "8")) {
+    type = ImageBufferType::UInt64;
+  } else if ((kind == 'f') && (size == "2")) {
+    type = ImageBufferType::Float16;
+  } else if ((kind == 'f') && (size == "4")) {
+    type = ImageBufferType::Float;
+  } else if ((kind == 'f') && (size == "8")) {
+    type = ImageBufferType::Double;
+  } else {
+    ThrowUnsupportedNpy(filename, "dtype '" + descr + "' has no ImageBufferType");
+  }
+
+  const bool little_endian = (byte_order == '<')
+      || ((byte_order == '=') && IsLittleEndianHost());
+  if ((byte_order != '|') && (size != "1")
+      && (little_endian != IsLittleEndianHost())) {
+    ThrowUnsupportedNpy(
+          filename, "byte order of dtype '" + descr + "' differs from host");
+  }
+  return type;
+}
+
+
+/// Returns the type code of a NumPy `descr`, *i.e.* without byte order.
+const char *NpyTypeCode(ImageBufferType buffer_type) {
+  switch (buffer_type) {
+    case ImageBufferType::UInt8:
+      return "u1";
+
+    case ImageBufferType::Int16:
+      return "i2";
+
+    case ImageBufferType::UInt16:
+      return "u2";
+
+    case ImageBufferType::Int32:
+      return "i4";
+
+    case ImageBufferType::UInt32:
+      return "u4";
+
+    case ImageBufferType::Int64:
+      return "i8";
+
+    case ImageBufferType::UInt64:
+      return "u8";
+
+    case ImageBufferType::Float:
+      return "f4";
+
+    case ImageBufferType::Double:
+      return "f8";
+
+    case ImageBufferType::Float16:
+      return "f2";
+
+    case ImageBufferType::BFloat16: {
+        // NumPy has no bfloat16 dtype.
+        const std::string msg(
+              "Cannot save a bfloat16 ImageBuffer as .npy file. Convert it "
+              "via `ToFloat` or `AsType` first!");
+        SPDLOG_ERROR(msg);
+        throw std::invalid_argument(msg);
+      }
+  }
+
+  // Throw an exception as fallback, because ending up here would be an
+  // implementation error (i.e. we ignored the warning about missing value
+  // in the switch/case above).
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(buffer_type);
+  msg += "` not handled in `NpyTypeCode` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
+std::vector<int64_t> ParseShape(
+    const std::string &shape, const std::string &filename) {
+  std::vector<int64_t> dims;
+  std::istringstream stream(shape);
+  std::string token;
+  while (std::getline(stream, token, ',')) {
+    std::size_t first = token.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+      // Trailing comma of a single-element tuple.
+      continue;
+    }
+    try {
+      dims.push_back(std::stoll(token.substr(first)));
+    } catch (const std::exception &) {
+      ThrowMalformedNpy(filename, "invalid shape (" + shape + ")");
+    }
+  }
+  return dims;
+}
+}  // anonymous namespace
+
+
+int64_t NpyHeader::NumBytes() const {
+  return static_cast<int64_t>(height) * width * channels
+      * ElementSizeFromImageBufferType(buffer_type);
+}
+
+
+void NpyHeader::Strides(
+    int64_t *row_stride, int64_t *pixel_stride,
+    int64_t *channel_stride) const {
+  const int64_t element_size = ElementSizeFromImageBufferType(buffer_type);
+  if (fortran_order) {
+    *row_stride = element_size;
+    *pixel_stride = element_size * height;
+    *channel_stride = element_size * height * width;
+  } else {
+    *channel_stride = element_size;
+    *pixel_stride = element_size * channels;
+    *row_stride = element_size * channels * width;
+  }
+}
+
+
+std::size_t NpyHeaderSize(
+    const unsigned char *data, std::size_t size,
+    const std::string &filename) {
+  if ((size < kNpyMagicLength + 6)
+      || (std::memcmp(data, kNpyMagic, kNpyMagicLength) != 0)) {
+    ThrowMalformedNpy(filename, "missing magic string");
+  }
+
+  // Version 1.0 stores the header length as uint16, later versions
+  // as uint32 (both little endian).
+  const int major_version = data[kNpyMagicLength];
+  if (major_version == 1) {
+    return kNpyMagicLength + 4
+        + (static_cast<std::size_t>(data[8])
+           | (static_cast<std::size_t>(data[9]) << 8));
+  } else if ((major_version == 2) || (major_version == 3)) {
+    return kNpyMagicLength + 6
+        + (static_cast<std::size_t>(data[8])
+           | (static_cast<std::size_t>(data[9]) << 8)
+           | (static_cast<std::size_t>(data[10]) << 16)
+           | (static_cast<std::size_t>(data[11]) << 24));
+  }
+  ThrowUnsupportedNpy(
+        filename, "format version " + std::to_string(major_version));
+}
+
+
+NpyHeader ParseNpyHeader(
+    const unsigned char *data, std::size_t size,
+    const std::string &filename) {
+  const std::size_t header_end = NpyHeaderSize(data, size, filename);
+  if (header_end > size) {
+    ThrowMalformedNpy(filename, "truncated header");
+  }
+  const std::size_t header_start = (data[kNpyMagicLength] == 1)
+      ? (kNpyMagicLength + 4) : (kNpyMagicLength + 6);
+  const std::size_t header_length = header_end - header_start;
+
+  const std::string dict(
+        reinterpret_cast<const char *>(data + header_start), header_length);
+  NpyHeader header;
+  header.buffer_type = BufferTypeFromDescr(
+        DictValue(dict, "descr", filename), filename);
+  header.fortran_order = (DictValue(dict, "fortran_order", filename) == "True");
+  header.data_offset = static_cast<int64_t>(header_end);
+
+  const std::vector<int64_t> shape = ParseShape(
+        DictValue(dict, "shape", filename), filename);
+  if ((shape.size() != 2) && (shape.size() != 3)) {
+    std::ostringstream msg;
+    msg << "only 2D or 3D arrays are supported, but array has "
+        << shape.size() << " dimension(s)";
+    ThrowUnsupportedNpy(filename, msg.str());
+  }
+  for (int64_t dim : shape) {
+    if ((dim <= 0) || (dim > std::numeric_limits<int>::max())) {
+      ThrowUnsupportedNpy(
+            filename, "invalid dimension " + std::to_string(dim));
+    }
+  }
+
+  header.height = static_cast<int>(shape[0]);
+  header.width = static_cast<int>(shape[1]);
+  header.channels = (shape.size() == 3) ? static_cast<int>(shape[2]) : 1;
+  return header;
+}
+
+std::string NpyHeaderString(
+    ImageBufferType buffer_type, int height, int width, int channels) {
+  std::string descr(1, IsLittleEndianHost() ? '<' : '>');
+  if (buffer_type == ImageBufferType::UInt8) {
+    descr[0] = '|';
+  }
+  descr += NpyTypeCode(buffer_type);
+
+  std::ostringstream dict;
+  dict << "{'descr': '" << descr << "', 'fortran_order': False, 'shape': ("
+       << height << ", " << width;
+  if (channels > 1) {
+    dict << ", " << channels;
+  }
+  dict << "), }";
+
+  // The preamble (magic string, version and header length) takes 10
+  // bytes and the header must be terminated by a newline.
+  std::string header = dict.str();
+  const std::size_t unpadded = kNpyMagicLength + 4 + header.length() + 1;
+  header.append((64 - unpadded % 64) % 64, ' ');
+  header += '\n';
+
+  std::string npy(kNpyMagic, kNpyMagicLength);
+  npy += '\x01';
+  npy += '\x00';
+  npy += static_cast<char>(header.length() & 0xFF);
+  npy += static_cast<char>((header.length() >> 8) & 0xFF);
+  return npy + header;
+}
+
+}  // namespace helpers
+}  // namespace viren2d
@@ -0,0 +1,70 @@
+#ifndef __VIREN2D_IMAGEBUFFER_NPY_H__
+#define __VIREN2D_IMAGEBUFFER_NPY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <viren2d/imagebuffer.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Describes an array stored in NumPy's `.npy` format, see
+/// https://numpy.org/doc/stable/reference/generated/numpy.lib.format.html
+struct NpyHeader {
+  ImageBufferType buffer_type = ImageBufferType::UInt8;
+
+  int height = 0;
+  int width = 0;
+  int channels = 0;
+
+  /// If true, the array is stored in column-major order.
+  bool fortran_order = false;
+
+  /// Offset in bytes from the beginning of the file to the array data.
+  int64_t data_offset = 0;
+
+
+  /// Returns the number of bytes of the array data.
+  int64_t NumBytes() const;
+
+
+  /// Returns the strides (row, pixel, channel) in bytes.
+  void Strides(
+      int64_t *row_stride, int64_t *pixel_stride,
+      int64_t *channel_stride) const;
+};
+
+
+/// Returns the number of bytes of the preamble and header of a `.npy`
+/// file, *i.e.* the offset of the array data. Requires at least the
+/// first 12 bytes of the file and throws a `std::runtime_error` if they
+/// don't start with the `.npy` magic string.
+std::size_t NpyHeaderSize(
+    const unsigned char *data, std::size_t size,
+    const std::string &filename);
+
+
+/// Parses the header at the beginning of a `.npy` file, which must be
+/// fully contained in the given `size` bytes. Only 2D (single-channel)
+/// and 3D (HxWxC) arrays of a supported `ImageBufferType` in little
+/// endian byte order can be parsed. Throws a `std::runtime_error` for
+/// malformed headers and a `std::invalid_argument` for unsupported
+/// arrays. The `filename` is only used for error messages.
+NpyHeader ParseNpyHeader(
+    const unsigned char *data, std::size_t size,
+    const std::string &filename);
+
+/// Returns the version 1.0 `.npy` preamble and header which describe a
+/// C-order array of the given type and shape in host byte order. A
+/// single-channel buffer is described as a 2D array. The header is
+/// padded such that the array data will be aligned to 64 bytes.
+std::string NpyHeaderString(
+    ImageBufferType buffer_type, int height, int width, int channels);
+
+}  // namespace helpers
+}  // namespace viren2d
+
+#endif  // __VIREN2D_IMAGEBUFFER_NPY_H__
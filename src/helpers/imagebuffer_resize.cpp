@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <helpers/imagebuffer_resize.h>
+#include <helpers/imagebuffer_access.h>
+#include <helpers/logging.h>
+#include <helpers/parallel.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// Number of output rows which are computed from the same block of
+/// horizontally resampled source rows.
+constexpr int kResizeRowBatch = 16;
+
+
+/// Filter taps of a separable resampling pass along one axis. Output
+/// index `i` is computed from the `count[i]` input indices starting
+/// at `first[i]`, weighted by `weights[i * max_taps + t]`.
+template <typename _Acc>
+struct ResizeTaps {
+  int max_taps = 0;
+  std::vector<int> first;
+  std::vector<int> count;
+  std::vector<_Acc> weights;
+};
+
+
+/// Returns the index of the nearest input sample (centers aligned).
+inline int NearestIndex(int idx_out, double scale, int size_in) {
+  const int idx = static_cast<int>(std::floor((idx_out + 0.5) * scale));
+  return std::min(std::max(idx, 0), size_in - 1);
+}
+
+
+template <typename _Acc>
+ResizeTaps<_Acc> ComputeTaps(
+    int size_in, int size_out, Interpolation interpolation) {
+  const double scale = static_cast<double>(size_in) / size_out;
+  // Area interpolation is only a box filter when downscaling.
+  const bool box = (interpolation == Interpolation::Area) && (scale > 1.0);
+
+  ResizeTaps<_Acc> taps;
+  taps.max_taps = box ? (static_cast<int>(std::ceil(scale)) + 1) : 2;
+  taps.first.resize(size_out);
+  taps.count.resize(size_out);
+  taps.weights.assign(static_cast<std::size_t>(size_out) * taps.max_taps, 0);
+
+  std::vector<double> weights(taps.max_taps);
+  for (int idx = 0; idx < size_out; ++idx) {
+    int first = 0;
+    int count = 0;
+    if (box) {
+      // Source interval [start, end) covered by this output sample.
+      const double start = idx * scale;
+      const double end = std::min(start + scale, static_cast<double>(size_in));
+      first = static_cast<int>(std::floor(start));
+      for (int in = first; (in < end) && (count < taps.max_taps); ++in) {
+        const double overlap =
+            std::min(end, in + 1.0) - std::max(start, static_cast<double>(in));
+        weights[count++] = overlap;
+      }
+      // Drop negligible contributions at the interval borders.
+      while ((count > 1) && (weights[count - 1] < 1e-6)) {
+        --count;
+      }
+      if ((count > 1) && (weights[0] < 1e-6)) {
+        ++first;
+        --count;
+        std::copy(weights.begin() + 1, weights.begin() + count + 1,
+                  weights.begin());
+      }
+    } else {
+      const double pos = std::min(
+            std::max((idx + 0.5) * scale - 0.5, 0.0),
+            static_cast<double>(size_in - 1));
+      first = static_cast<int>(std::floor(pos));
+      const double frac = pos - first;
+      if ((first + 1 < size_in) && (frac > 0.0)) {
+        weights[0] = 1.0 - frac;
+        weights[1] = frac;
+        count = 2;
+      } else {
+        weights[0] = 1.0;
+        count = 1;
+      }
+    }
+
+    double sum = 0.0;
+    for (int t = 0; t < count; ++t) {
+      sum += weights[t];
+    }
+    taps.first[idx] = first;
+    taps.count[idx] = count;
+    for (int t = 0; t < count; ++t) {
+      taps.weights[idx * taps.max_taps + t] =
+          static_cast<_Acc>(weights[t] / sum);
+    }
+  }
+  return taps;
+}
+
+
+/// Converts the interpolated value, rounding & saturating integral types.
+template <typename _Tp, typename _Acc> inline
+_Tp CastInterpolated(_Acc value) {
+  if constexpr (!std::numeric_limits<_Tp>::is_integer) {
+    return static_cast<_Tp>(value);
+  } else {
+    const _Acc rounded = std::floor(value + static_cast<_Acc>(0.5));
+    if (!(rounded > static_cast<_Acc>(std::numeric_limits<_Tp>::lowest()))) {
+      return std::numeric_limits<_Tp>::lowest();
+    }
+    if (rounded >= static_cast<_Acc>(std::numeric_limits<_Tp>::max())) {
+      return std::numeric_limits<_Tp>::max();
+    }
+    return static_cast<_Tp>(rounded);
+  }
+}
+
+
+void ResizeNearest(
+    const ImageBuffer &src, ImageBuffer &dst,
+    int new_width, int new_height) {
+  const double scale_x = static_cast<double>(src.Width()) / new_width;
+  const double scale_y = static_cast<double>(src.Height()) / new_height;
+  std::vector<int64_t> offsets(new_width);
+  for (int col = 0; col < new_width; ++col) {
+    offsets[col] = NearestIndex(col, scale_x, src.Width()) * src.PixelStride();
+  }
+
+  // Pixels can only be copied at once if their channels are
+  // contiguous. Otherwise (e.g. for a channel view), we copy
+  // one element after the other.
+  const bool packed_channels =
+      src.HasContiguousChannels() && dst.HasContiguousChannels();
+  const int num_copies = packed_channels ? 1 : src.Channels();
+  const std::size_t copy_bytes = static_cast<std::size_t>(
+        packed_channels ? src.Channels() : 1) * src.ElementSize();
+  const int64_t src_channel_stride = src.ChannelStride();
+  const int64_t dst_channel_stride = dst.ChannelStride();
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        new_height, new_width, src.Channels(),
+        [&](int row, int col_begin, int col_end) {
+    const unsigned char *src_row = src.ImmutablePtr<unsigned char>(
+          NearestIndex(row, scale_y, src.Height()), 0, 0);
+    unsigned char *dst_ptr = out.Ptr<unsigned char>(row, col_begin, 0);
+    for (int col = col_begin; col < col_end; ++col) {
+      for (int ch = 0; ch < num_copies; ++ch) {
+        std::memcpy(
+              dst_ptr + ch * dst_channel_stride,
+              src_row + offsets[col] + ch * src_channel_stride, copy_bytes);
+      }
+      dst_ptr += dst.PixelStride();
+    }
+  });
+}
+
+
+/// Separable resampling: Source rows are first resampled horizontally into
+/// a temporary block (of `_Acc` values), which is then resampled vertically.
+/// Both passes operate on packed rows, so the vertical pass (a weighted
+/// sum of contiguous rows) can be vectorized by the compiler.
+template <typename _Tp, typename _Acc>
+void ResizeSeparable(
+    const ImageBuffer &src, ImageBuffer &dst,
+    int new_width, int new_height, Interpolation interpolation) {
+  const ResizeTaps<_Acc> taps_x = ComputeTaps<_Acc>(
+        src.Width(), new_width, interpolation);
+  const ResizeTaps<_Acc> taps_y = ComputeTaps<_Acc>(
+        src.Height(), new_height, interpolation);
+
+  const int channels = src.Channels();
+  const int64_t row_values = static_cast<int64_t>(new_width) * channels;
+  const int64_t pixel_stride = src.PixelStride();
+  const int64_t channel_stride = src.ChannelStride();
+  const int64_t dst_channel_stride = dst.ChannelStride();
+  const PixelWriter out(dst);
+
+  ParallelFor(
+        0, new_height,
+        row_values * (taps_x.max_taps + taps_y.max_taps),
+        [&](int64_t row_begin, int64_t row_end) {
+    std::vector<_Acc> block;
+    std::vector<_Acc> out_row(row_values);
+
+    for (int64_t batch = row_begin; batch < row_end; batch += kResizeRowBatch) {
+      const int batch_end = static_cast<int>(
+            std::min<int64_t>(batch + kResizeRowBatch, row_end));
+      const int src_first = taps_y.first[batch];
+      const int src_last = taps_y.first[batch_end - 1]
+          + taps_y.count[batch_end - 1];
+
+      // Horizontal pass over all source rows required by this batch.
+      block.resize((src_last - src_first) * row_values);
+      for (int src_row = src_first; src_row < src_last; ++src_row) {
+        const unsigned char *src_ptr =
+            src.ImmutablePtr<unsigned char>(src_row, 0, 0);
+        _Acc *block_ptr = block.data() + (src_row - src_first) * row_values;
+        for (int col = 0; col < new_width; ++col) {
+          const _Acc *weights = taps_x.weights.data() + col * taps_x.max_taps;
+          const unsigned char *px_ptr = src_ptr + taps_x.first[col] * pixel_stride;
+          for (int ch = 0; ch < channels; ++ch) {
+            block_ptr[ch] = 0;
+          }
+          for (int t = 0; t < taps_x.count[col]; ++t) {
+            for (int ch = 0; ch < channels; ++ch) {
+              const _Tp value = *reinterpret_cast<const _Tp *>(
+                    px_ptr + ch * channel_stride);
+              block_ptr[ch] += weights[t] * static_cast<_Acc>(value);
+            }
+            px_ptr += pixel_stride;
+          }
+          block_ptr += channels;
+        }
+      }
+
+      // Vertical pass.
+      for (int row = static_cast<int>(batch); row < batch_end; ++row) {
+        const _Acc *weights = taps_y.weights.data() + row * taps_y.max_taps;
+        const _Acc *block_row =
+            block.data() + (taps_y.first[row] - src_first) * row_values;
+        std::fill(out_row.begin(), out_row.end(), static_cast<_Acc>(0));
+        for (int t = 0; t < taps_y.count[row]; ++t) {
+          const _Acc weight = weights[t];
+          for (int64_t i = 0; i < row_values; ++i) {
+            out_row[i] += weight * block_row[i];
+          }
+          block_row += row_values;
+        }
+
+        unsigned char *dst_ptr = out.Row<unsigned char>(row);
+        const _Acc *out_ptr = out_row.data();
+        for (int col = 0; col < new_width; ++col) {
+          for (int ch = 0; ch < channels; ++ch) {
+            *reinterpret_cast<_Tp *>(dst_ptr + ch * dst_channel_stride) =
+                CastInterpolated<_Tp, _Acc>(out_ptr[ch]);
+          }
+          out_ptr += channels;
+          dst_ptr += dst.PixelStride();
+        }
+      }
+    }
+  });
+}
+}  // anonymous namespace
+
+
+void Resize(
+    const ImageBuffer &src, ImageBuffer &dst,
+    int new_width, int new_height, Interpolation interpolation) {
+  SPDLOG_DEBUG(
+        "Resizing {:s} to {:d}x{:d}, interpolation={:s}.",
+        src.ToString(), new_width, new_height,
+        InterpolationToString(interpolation));
+
+  if (!src.IsValid()) {
+    const std::string msg("Cannot resize an invalid ImageBuffer!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  if ((new_width <= 0) || (new_height <= 0)) {
+    std::ostringstream msg;
+    msg << "Invalid target size " << new_width << "x" << new_height
+        << " to resize " << src.ToString() << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  // Reuse or create destination buffer (rows may be padded)
+  dst.EnsureShape(new_height, new_width, src.Channels(), src.BufferType());
+
+  if (interpolation == Interpolation::Nearest) {
+    ResizeNearest(src, dst, new_width, new_height);
+    return;
+  }
+
+  // Single precision accumulators suffice for types with up to 16 bit.
+  switch (src.BufferType()) {
+    case ImageBufferType::UInt8:
+      ResizeSeparable<uint8_t, float>(
+            src, dst, new_width, new_height, interpolation);
+      return;
+
+    case ImageBufferType::Int16:
+      ResizeSeparable<int16_t, float>(
+            src, dst, new_width, new_height, interpolation);
+      return;
+
+    case ImageBufferType::UInt16:
+      ResizeSeparable<uint16_t, float>(
+            src, dst, new_width, new_height, interpolation);
+      return;
+
+    case ImageBufferType::Int32:
+      ResizeSeparable<int32_t, double>(
+            src, dst, new_width, new_height, interpolation);
+      return;
+
+    case ImageBufferType::UInt32:
+      ResizeSeparable<uint32_t, double>(
+            src, dst, new_width, new_height, interpolation);
+      return;
+
+    case ImageBufferType::Int64:
+      ResizeSeparable<int64_t, double>(
+            src, dst, new_width, new_height, interpolation);
+      return;
+
+    case ImageBufferType::UInt64:
+      ResizeSeparable<uint64_t, double>(
+            src, dst, new_width, new_height, interpolation);
+      return;
+
+    case ImageBufferType::Float:
+      ResizeSeparable<float, float>(
+            src, dst, new_width, new_height, interpolation);
+      return;
+
+    case ImageBufferType::Double:
+      ResizeSeparable<double, double>(
+            src, dst, new_width, new_height, interpolation);
+      return;
+
+    case ImageBufferType::Float16:
+      ResizeSeparable<float16_t, float>(
+            src, dst, new_width, new_height, interpolation);
+      return;
+
+    case ImageBufferType::BFloat16:
+      ResizeSeparable<bfloat16_t, float>(
+            src, dst, new_width, new_height, interpolation);
+      return;
+  }
+
+  // Throw an exception as fallback, because ending up here would be an
+  // implementation error (i.e. we ignored the warning about missing value
+  // in the switch/case above).
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(src.BufferType());
+  msg += "` not handled in `Resize` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+}  // namespace helpers
+}  // namespace viren2d
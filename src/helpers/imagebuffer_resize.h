@@ -0,0 +1,19 @@
+#ifndef __VIREN2D_IMAGEBUFFER_RESIZE_H__
+#define __VIREN2D_IMAGEBUFFER_RESIZE_H__
+
+#include <viren2d/imagebuffer.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Resamples `src` into `dst`, which will be (re-)allocated if its shape
+/// or type does not match. Input and output must not overlap.
+void Resize(
+    const ImageBuffer &src, ImageBuffer &dst,
+    int new_width, int new_height, Interpolation interpolation);
+
+}  // namespace helpers
+}  // namespace viren2d
+
+#endif  // __VIREN2D_IMAGEBUFFER_RESIZE_H__
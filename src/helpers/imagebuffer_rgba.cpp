@@ -0,0 +1,267 @@
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <helpers/imagebuffer_rgba.h>
+#include <helpers/imagebuffer_access.h>
+#include <helpers/logging.h>
+#include <helpers/parallel.h>
+#include <helpers/simd_kernels.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// Returns true if packed rows of this type can be saturated to uint8
+/// via the SIMD type casts.
+template <typename _Tp>
+constexpr bool HasUInt8CastKernel() {
+  return std::is_same<_Tp, int16_t>::value
+      || std::is_same<_Tp, uint16_t>::value
+      || std::is_same<_Tp, int32_t>::value
+      || std::is_same<_Tp, float>::value
+      || std::is_same<_Tp, double>::value
+      || std::is_same<_Tp, float16_t>::value
+      || std::is_same<_Tp, bfloat16_t>::value;
+}
+
+
+/// Temporary rows of a single worker, which are reused for all rows
+/// of its chunk.
+struct RowScratch {
+  std::vector<uint8_t> uint8_values;
+  std::vector<float> float_values;
+};
+
+
+/// Saturates `num_elements` consecutive values to uint8 (identical to
+/// `simd::SaturateUInt8`). Half precision values are widened to float
+/// first.
+template <typename _Tp>
+void CastToUInt8(
+    const _Tp *src, uint8_t *dst, int64_t num_elements, RowScratch *scratch) {
+  const auto &casts = simd::CastKernels();
+  if constexpr (std::is_same<_Tp, int16_t>::value) {
+    casts.int16_to_uint8(src, dst, num_elements);
+  } else if constexpr (std::is_same<_Tp, uint16_t>::value) {
+    casts.uint16_to_uint8(src, dst, num_elements);
+  } else if constexpr (std::is_same<_Tp, int32_t>::value) {
+    casts.int32_to_uint8(src, dst, num_elements);
+  } else if constexpr (std::is_same<_Tp, float>::value) {
+    casts.float_to_uint8(src, dst, num_elements, 255.0f);
+  } else if constexpr (std::is_same<_Tp, double>::value) {
+    casts.double_to_uint8(src, dst, num_elements, 255.0);
+  } else {
+    scratch->float_values.resize(static_cast<std::size_t>(num_elements));
+    float *widened = scratch->float_values.data();
+    if constexpr (std::is_same<_Tp, float16_t>::value) {
+      simd::HalfKernels().float16_to_float(src, widened, num_elements);
+    } else {
+      simd::HalfKernels().bfloat16_to_float(src, widened, num_elements);
+    }
+    casts.float_to_uint8(widened, dst, num_elements, 255.0f);
+  }
+}
+
+
+/// Expands a row of packed `C`-channel uint8 pixels to RGBA.
+template <int C>
+void ExpandToRGBA8(const uint8_t *src, unsigned char *dst, int width) {
+  const auto &kernels = simd::Kernels<uint8_t>();
+  if (C == 1) {
+    kernels.gray2rgba(src, dst, width);
+  } else if (C == 3) {
+    kernels.rgb2rgba(src, dst, width);
+  } else {
+    std::memcpy(dst, src, static_cast<std::size_t>(4) * width);
+  }
+}
+
+
+/// Converts a single row of `C`-channel pixels. Packed rows are converted
+/// by the SIMD kernels: uint8 pixels only need to be expanded, other
+/// types are saturated into a temporary uint8 row first. The remaining
+/// rows (views with gaps or reordered channels, 32/64-bit integers) are
+/// converted element-wise.
+template <typename _Tp, int C>
+void ConvertRowToRGBA8(
+    const unsigned char *src, int64_t pixel_stride, int64_t channel_stride,
+    unsigned char *dst, int width, RowScratch *scratch) {
+  constexpr int64_t element_size = static_cast<int64_t>(sizeof(_Tp));
+  const bool packed = (pixel_stride == C * element_size)
+      && ((C == 1) || (channel_stride == element_size));
+  if constexpr (std::is_same<_Tp, uint8_t>::value) {
+    if (packed) {
+      ExpandToRGBA8<C>(src, dst, width);
+      return;
+    }
+  } else if constexpr (HasUInt8CastKernel<_Tp>()) {
+    if (packed) {
+      const int64_t num_elements = static_cast<int64_t>(C) * width;
+      scratch->uint8_values.resize(static_cast<std::size_t>(num_elements));
+      CastToUInt8(
+            reinterpret_cast<const _Tp *>(src), scratch->uint8_values.data(),
+            num_elements, scratch);
+      ExpandToRGBA8<C>(scratch->uint8_values.data(), dst, width);
+      return;
+    }
+  }
+
+  // Channels are addressed via their byte offset, so that
+  // views (e.g. BGR of an RGB image) need no copy.
+  auto value = [channel_stride](const unsigned char *px, int ch) {
+    return simd::SaturateUInt8(
+          *reinterpret_cast<const _Tp *>(px + ch * channel_stride));
+  };
+
+  for (int col = 0; col < width; ++col, src += pixel_stride, dst += 4) {
+    if (C == 1) {
+      const uint8_t gray = value(src, 0);
+      dst[0] = gray;
+      dst[1] = gray;
+      dst[2] = gray;
+      dst[3] = 255;
+    } else {
+      dst[0] = value(src, 0);
+      dst[1] = value(src, 1);
+      dst[2] = value(src, 2);
+      dst[3] = (C == 4) ? value(src, C - 1) : 255;
+    }
+  }
+}
+
+
+template <typename _Tp, int C>
+void ConvertToRGBA8Impl(
+    const ImageBuffer &src, unsigned char *dst, int64_t dst_row_stride) {
+  const int width = src.Width();
+  const int64_t pixel_stride = src.PixelStride();
+  const int64_t channel_stride = src.ChannelStride();
+  ParallelFor(
+        0, src.Height(), 4 * static_cast<int64_t>(width),
+        [&](int64_t row_begin, int64_t row_end) {
+    RowScratch scratch;
+    for (int64_t row = row_begin; row < row_end; ++row) {
+      ConvertRowToRGBA8<_Tp, C>(
+            src.ImmutablePtr<unsigned char>(static_cast<int>(row), 0, 0),
+            pixel_stride, channel_stride, dst + row * dst_row_stride, width,
+            &scratch);
+    }
+  });
+}
+
+
+template <typename _Tp>
+void ConvertToRGBA8(
+    const ImageBuffer &src, unsigned char *dst, int64_t dst_row_stride) {
+  switch (src.Channels()) {
+    case 1:
+      ConvertToRGBA8Impl<_Tp, 1>(src, dst, dst_row_stride);
+      return;
+
+    case 3:
+      ConvertToRGBA8Impl<_Tp, 3>(src, dst, dst_row_stride);
+      return;
+
+    case 4:
+      ConvertToRGBA8Impl<_Tp, 4>(src, dst, dst_row_stride);
+      return;
+
+    default: {
+        std::string msg(
+              "Conversion to RGBA requires a 1-, 3- or 4-channel "
+              "ImageBuffer, but got ");
+        msg += src.ToString();
+        msg += '!';
+        SPDLOG_ERROR(msg);
+        throw std::invalid_argument(msg);
+      }
+  }
+}
+}  // anonymous namespace
+
+
+void ConvertToRGBA8(
+    const ImageBuffer &src, unsigned char *dst, int64_t dst_row_stride) {
+  if (!src.IsValid()) {
+    const std::string msg("Cannot convert an invalid ImageBuffer to RGBA!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  if (!dst || (dst_row_stride < 4 * static_cast<int64_t>(src.Width()))) {
+    std::ostringstream msg;
+    msg << "Invalid destination for RGBA conversion of " << src.ToString()
+        << ": row stride " << dst_row_stride << " is too small, or nullptr!";
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  switch (src.BufferType()) {
+    case ImageBufferType::UInt8:
+      ConvertToRGBA8<uint8_t>(src, dst, dst_row_stride);
+      return;
+
+    case ImageBufferType::Int16:
+      ConvertToRGBA8<int16_t>(src, dst, dst_row_stride);
+      return;
+
+    case ImageBufferType::UInt16:
+      ConvertToRGBA8<uint16_t>(src, dst, dst_row_stride);
+      return;
+
+    case ImageBufferType::Int32:
+      ConvertToRGBA8<int32_t>(src, dst, dst_row_stride);
+      return;
+
+    case ImageBufferType::UInt32:
+      ConvertToRGBA8<uint32_t>(src, dst, dst_row_stride);
+      return;
+
+    case ImageBufferType::Int64:
+      ConvertToRGBA8<int64_t>(src, dst, dst_row_stride);
+      return;
+
+    case ImageBufferType::UInt64:
+      ConvertToRGBA8<uint64_t>(src, dst, dst_row_stride);
+      return;
+
+    case ImageBufferType::Float:
+      ConvertToRGBA8<float>(src, dst, dst_row_stride);
+      return;
+
+    case ImageBufferType::Double:
+      ConvertToRGBA8<double>(src, dst, dst_row_stride);
+      return;
+
+    case ImageBufferType::Float16:
+      ConvertToRGBA8<float16_t>(src, dst, dst_row_stride);
+      return;
+
+    case ImageBufferType::BFloat16:
+      ConvertToRGBA8<bfloat16_t>(src, dst, dst_row_stride);
+      return;
+  }
+
+  // Throw an exception as fallback, because ending up here would be an
+  // implementation error (i.e. we ignored the warning about missing value
+  // in the switch/case above).
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(src.BufferType());
+  msg += "` not handled in `ConvertToRGBA8` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
+ImageBuffer ToRGBA8(const ImageBuffer &src) {
+  ImageBuffer dst(src.Height(), src.Width(), 4, ImageBufferType::UInt8);
+  ConvertToRGBA8(src, PixelWriter(dst).Data(), dst.RowStride());
+  return dst;
+}
+
+}  // namespace helpers
+}  // namespace viren2d
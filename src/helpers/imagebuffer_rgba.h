@@ -0,0 +1,36 @@
+#ifndef __VIREN2D_IMAGEBUFFER_RGBA_H__
+#define __VIREN2D_IMAGEBUFFER_RGBA_H__
+
+#include <cstdint>
+
+#include <viren2d/imagebuffer.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Converts a 1-, 3- or 4-channel ImageBuffer of any type into 4-channel
+/// `uint8` pixels in a single pass, *i.e.* without intermediate images.
+/// This is the layout which we use for cairo image surfaces. Rows with
+/// packed pixels are converted by the SIMD type casts & channel kernels
+/// (via a temporary row), views are converted element-wise.
+///
+/// The output rows start at `dst` and are `dst_row_stride` bytes apart,
+/// so this can write directly into externally managed memory (such as
+/// the data of a cairo surface). Pixels will be converted as in
+/// `ImageBuffer::ToUInt8`, *i.e.* floating point values are multiplied
+/// by 255 and all values are saturated to [0, 255]. Missing alpha
+/// channels will be set to 255.
+void ConvertToRGBA8(
+    const ImageBuffer &src, unsigned char *dst, int64_t dst_row_stride);
+
+
+/// Returns a newly allocated 4-channel `uint8` buffer, which holds the
+/// result of `ConvertToRGBA8`. Its rows are padded (see
+/// `SetImageBufferRowAlignment`), which is suitable for cairo.
+ImageBuffer ToRGBA8(const ImageBuffer &src);
+
+}  // namespace helpers
+}  // namespace viren2d
+
+#endif  // __VIREN2D_IMAGEBUFFER_RGBA_H__
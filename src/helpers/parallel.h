@@ -0,0 +1,62 @@
+#ifndef __VIREN2D_PARALLEL_HELPERS_H__
+#define __VIREN2D_PARALLEL_HELPERS_H__
+
+#include <cstdint>
+#include <functional>
+
+#include <viren2d/parallel.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Approximate number of (scalar) operations which a single task should
+/// perform at least. Below this, the synchronization overhead dominates.
+constexpr int64_t kParallelGrainSize = int64_t(1) << 15;
+
+
+/// Splits the range [begin, end) into contiguous chunks and invokes
+/// `body(chunk_begin, chunk_end)` for each of them, using the calling
+/// thread plus the worker pool. Returns once all chunks have been
+/// processed. If a chunk throws, the first exception is rethrown.
+///
+/// `cost_per_item` approximates the number of operations per item, and
+/// is used to decide how many chunks are worthwhile (at least
+/// `kParallelGrainSize` operations each). Each thread claims several
+/// of these chunks in turn, to balance the load. Nested calls (from
+/// within a `body`) are executed serially. The workers use the
+/// thread-local settings of the calling thread, see
+/// `ScopedImageBufferAllocator` and `ScopedNumThreads`.
+void ParallelFor(
+    int64_t begin, int64_t end, int64_t cost_per_item,
+    const std::function<void(int64_t, int64_t)> &body);
+
+
+/// Parallelizes the typical (possibly flattened) row loop over an
+/// ImageBuffer by invoking `body(row, col_begin, col_end)`. If the
+/// buffer has been flattened into a single row, the columns are split
+/// across the threads, otherwise the rows.
+template <typename _Body> inline
+void ParallelForPixels(
+    int rows, int cols, int64_t cost_per_pixel, const _Body &body) {
+  if (rows == 1) {
+    ParallelFor(
+          0, cols, cost_per_pixel,
+          [&body](int64_t col_begin, int64_t col_end) {
+      body(0, static_cast<int>(col_begin), static_cast<int>(col_end));
+    });
+  } else {
+    ParallelFor(
+          0, rows, cost_per_pixel * cols,
+          [&body, cols](int64_t row_begin, int64_t row_end) {
+      for (int64_t row = row_begin; row < row_end; ++row) {
+        body(static_cast<int>(row), 0, cols);
+      }
+    });
+  }
+}
+
+}  // namespace helpers
+}  // namespace viren2d
+
+#endif  // __VIREN2D_PARALLEL_HELPERS_H__
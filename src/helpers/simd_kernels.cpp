@@ -0,0 +1,797 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <tuple>
+#include <type_traits>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h> // __cpuid, _xgetbv
+#endif  // _MSC_VER
+
+#include <helpers/simd_kernels.h>
+#include <helpers/color_conversion.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace simd {
+//---------------------------------------------------- Scalar kernels
+template <typename _Tp>
+void RGB2RGBAScalar(const _Tp *src, _Tp *dst, int64_t num_pixels) {
+  for (int64_t i = 0; i < num_pixels; ++i, src += 3, dst += 4) {
+    dst[0] = src[0];
+    dst[1] = src[1];
+    dst[2] = src[2];
+    dst[3] = static_cast<_Tp>(255);
+  }
+}
+
+
+template <typename _Tp>
+void RGBA2RGBScalar(const _Tp *src, _Tp *dst, int64_t num_pixels) {
+  for (int64_t i = 0; i < num_pixels; ++i, src += 4, dst += 3) {
+    dst[0] = src[0];
+    dst[1] = src[1];
+    dst[2] = src[2];
+  }
+}
+
+
+template <typename _Tp>
+void Gray2RGBScalar(const _Tp *src, _Tp *dst, int64_t num_pixels) {
+  for (int64_t i = 0; i < num_pixels; ++i, dst += 3) {
+    const _Tp val = src[i];
+    dst[0] = val;
+    dst[1] = val;
+    dst[2] = val;
+  }
+}
+
+
+template <typename _Tp>
+void Gray2RGBAScalar(const _Tp *src, _Tp *dst, int64_t num_pixels) {
+  for (int64_t i = 0; i < num_pixels; ++i, dst += 4) {
+    const _Tp val = src[i];
+    dst[0] = val;
+    dst[1] = val;
+    dst[2] = val;
+    dst[3] = static_cast<_Tp>(255);
+  }
+}
+
+
+template <typename _Tp>
+void SwapChannelsScalar(
+    _Tp *data, int64_t num_pixels, int channels, int ch1, int ch2) {
+  for (int64_t i = 0; i < num_pixels; ++i, data += channels) {
+    const _Tp tmp = data[ch1];
+    data[ch1] = data[ch2];
+    data[ch2] = tmp;
+  }
+}
+
+
+template <typename _Tp>
+void RGBx2GrayScalar(
+    const _Tp *src, _Tp *dst, int64_t num_pixels,
+    int src_channels, int dst_channels, bool is_bgr_format) {
+  const int ch_r = is_bgr_format ? 2 : 0;
+  const int ch_b = is_bgr_format ? 0 : 2;
+  for (int64_t i = 0; i < num_pixels; ++i) {
+    const _Tp luminance = CvtHelperRGB2Gray(src[ch_r], src[1], src[ch_b]);
+    for (int ch = 0; ch < std::min(dst_channels, 3); ++ch) {
+      dst[ch] = luminance;
+    }
+    if (dst_channels == 4) {
+      dst[3] = (src_channels == 4) ? src[3] : static_cast<_Tp>(255);
+    }
+    src += src_channels;
+    dst += dst_channels;
+  }
+}
+
+
+template <typename _Tp>
+void MaskHSVRangeScalar(
+    const _Tp *src, uint8_t *mask, int64_t num_pixels,
+    int src_channels, bool is_bgr_format, const HSVRange &range) {
+  const int ch_r = is_bgr_format ? 2 : 0;
+  const int ch_b = is_bgr_format ? 0 : 2;
+  uint8_t hsv[3];
+  for (int64_t i = 0; i < num_pixels; ++i, src += src_channels) {
+    CvtHelperRGB2HSVUInt8(src[ch_r], src[1], src[ch_b], hsv);
+    mask[i] = range.Contains(hsv) ? 255 : 0;
+  }
+}
+
+
+template <typename _Tp>
+void ColorPopScalar(
+    const _Tp *src, _Tp *dst, int64_t num_pixels,
+    int channels, bool is_bgr_format, const HSVRange &range) {
+  const int ch_r = is_bgr_format ? 2 : 0;
+  const int ch_b = is_bgr_format ? 0 : 2;
+  uint8_t hsv[3];
+  for (int64_t i = 0; i < num_pixels; ++i) {
+    CvtHelperRGB2HSVUInt8(src[ch_r], src[1], src[ch_b], hsv);
+    if (range.Contains(hsv)) {
+      for (int ch = 0; ch < channels; ++ch) {
+        dst[ch] = src[ch];
+      }
+    } else {
+      const _Tp luminance = CvtHelperRGB2Gray(src[ch_r], src[1], src[ch_b]);
+      dst[0] = luminance;
+      dst[1] = luminance;
+      dst[2] = luminance;
+      if (channels == 4) {
+        dst[3] = src[3];
+      }
+    }
+    src += channels;
+    dst += channels;
+  }
+}
+
+
+template <typename _Tp>
+void RGBx2HSVScalar(
+    const _Tp *src, _Tp *dst, int64_t num_pixels,
+    int src_channels, bool is_bgr_format) {
+  const int ch_r = is_bgr_format ? 2 : 0;
+  const int ch_b = is_bgr_format ? 0 : 2;
+  uint8_t hsv[3];
+  for (int64_t i = 0; i < num_pixels; ++i, src += src_channels, dst += 3) {
+    CvtHelperRGB2HSVUInt8(src[ch_r], src[1], src[ch_b], hsv);
+    dst[0] = static_cast<_Tp>(hsv[0]);
+    dst[1] = static_cast<_Tp>(hsv[1]);
+    dst[2] = static_cast<_Tp>(hsv[2]);
+  }
+}
+
+
+template <typename _Tp>
+void HSV2RGBxScalar(
+    const _Tp *src, _Tp *dst, int64_t num_pixels,
+    int dst_channels, bool is_bgr_format) {
+  const int ch_r = is_bgr_format ? 2 : 0;
+  const int ch_b = is_bgr_format ? 0 : 2;
+  float r, g, b;
+  for (int64_t i = 0; i < num_pixels; ++i, src += 3, dst += dst_channels) {
+    std::tie(r, g, b) = CvtHelperHSV2RGB(
+          src[0] * 2.0f,  // Hue input in [0, 180]
+          src[1] / 255.0f,  // Saturation input in [0, 255]
+          src[2] / 255.0f); // Value input in [0, 255]
+
+    dst[ch_r] = static_cast<_Tp>(static_cast<uint8_t>(255.0f * r));
+    dst[1] = static_cast<_Tp>(static_cast<uint8_t>(255.0f * g));
+    dst[ch_b] = static_cast<_Tp>(static_cast<uint8_t>(255.0f * b));
+    if (dst_channels == 4) {
+      dst[3] = static_cast<_Tp>(255);
+    }
+  }
+}
+
+
+/// Returns the linear value of a uint8 (in [0, 255]) or float
+/// (in [0, 1]) sRGB value.
+inline float LinearizeSRGB(const SRGBGammaLUT &gamma, uint8_t val) {
+  return gamma.linearize_uint8[val];
+}
+
+
+inline float LinearizeSRGB(const SRGBGammaLUT &gamma, float val) {
+  return InterpolateGammaLUT(gamma.linearize, ClampUnit(val));
+}
+
+
+/// Converts a linear value to uint8 (in [0, 255]) or float (in [0, 1]) sRGB.
+inline void CompressSRGB(const SRGBGammaLUT &gamma, float val, uint8_t &dst) {
+  dst = RoundSaturateUInt8(
+        255.0f * InterpolateGammaLUT(gamma.compress, ClampUnit(val)));
+}
+
+
+inline void CompressSRGB(const SRGBGammaLUT &gamma, float val, float &dst) {
+  dst = InterpolateGammaLUT(gamma.compress, ClampUnit(val));
+}
+
+
+/// Converts between L*a*b* and its uint8 or float representation.
+inline void EncodeLab(const float *lab, uint8_t *dst) {
+  dst[0] = RoundSaturateUInt8(kLabLToUInt8 * lab[0]);
+  dst[1] = RoundSaturateUInt8(lab[1] + kLabABOffset);
+  dst[2] = RoundSaturateUInt8(lab[2] + kLabABOffset);
+}
+
+
+inline void EncodeLab(const float *lab, float *dst) {
+  dst[0] = lab[0];
+  dst[1] = lab[1];
+  dst[2] = lab[2];
+}
+
+
+inline void DecodeLab(const uint8_t *src, float *lab) {
+  lab[0] = kLabLFromUInt8 * src[0];
+  lab[1] = src[1] - kLabABOffset;
+  lab[2] = src[2] - kLabABOffset;
+}
+
+
+inline void DecodeLab(const float *src, float *lab) {
+  lab[0] = src[0];
+  lab[1] = src[1];
+  lab[2] = src[2];
+}
+
+
+template <typename _Tp>
+void RGBx2LabScalar(
+    const _Tp *src, _Tp *dst, int64_t num_pixels,
+    int src_channels, bool is_bgr_format) {
+  const SRGBGammaLUT &gamma = SRGBGamma();
+  const int ch_r = is_bgr_format ? 2 : 0;
+  const int ch_b = is_bgr_format ? 0 : 2;
+  float lab[3];
+  for (int64_t i = 0; i < num_pixels; ++i, src += src_channels, dst += 3) {
+    CvtHelperLinearRGB2Lab(
+          LinearizeSRGB(gamma, src[ch_r]), LinearizeSRGB(gamma, src[1]),
+          LinearizeSRGB(gamma, src[ch_b]), lab);
+    EncodeLab(lab, dst);
+  }
+}
+
+
+template <typename _Tp>
+void Lab2RGBxScalar(
+    const _Tp *src, _Tp *dst, int64_t num_pixels,
+    int dst_channels, bool is_bgr_format) {
+  const SRGBGammaLUT &gamma = SRGBGamma();
+  const int ch_r = is_bgr_format ? 2 : 0;
+  const int ch_b = is_bgr_format ? 0 : 2;
+  float lab[3];
+  float rgb[3];
+  for (int64_t i = 0; i < num_pixels; ++i, src += 3, dst += dst_channels) {
+    DecodeLab(src, lab);
+    CvtHelperLab2LinearRGB(lab[0], lab[1], lab[2], rgb);
+    CompressSRGB(gamma, rgb[0], dst[ch_r]);
+    CompressSRGB(gamma, rgb[1], dst[1]);
+    CompressSRGB(gamma, rgb[2], dst[ch_b]);
+    if (dst_channels == 4) {
+      dst[3] = std::is_floating_point<_Tp>::value
+          ? static_cast<_Tp>(1) : static_cast<_Tp>(255);
+    }
+  }
+}
+
+
+template <typename _Tp>
+void MaskRangeBitsScalar(
+    const _Tp *src, uint64_t *bits, int64_t num_pixels,
+    int channels, const _Tp *min_max) {
+  for (int64_t i = 0; i < num_pixels; i += 64, ++bits) {
+    const int64_t num_bits = std::min<int64_t>(64, num_pixels - i);
+    uint64_t word = 0;
+    for (int64_t k = 0; k < num_bits; ++k, src += channels) {
+      bool within_range = true;
+      for (int ch = 0; ch < channels; ++ch) {
+        if ((src[ch] < min_max[2 * ch]) || (src[ch] > min_max[2 * ch + 1])) {
+          within_range = false;
+        }
+      }
+      word |= static_cast<uint64_t>(within_range) << k;
+    }
+    *bits = word;
+  }
+}
+
+
+template <typename _Tp>
+void PackBitsScalar(
+    const _Tp *src, uint64_t *bits, int64_t num_pixels, int channels) {
+  for (int64_t i = 0; i < num_pixels; i += 64, ++bits) {
+    const int64_t num_bits = std::min<int64_t>(64, num_pixels - i);
+    uint64_t word = 0;
+    for (int64_t k = 0; k < num_bits; ++k, src += channels) {
+      word |= static_cast<uint64_t>(src[0] != static_cast<_Tp>(0)) << k;
+    }
+    *bits = word;
+  }
+}
+
+
+inline uint8_t BlendScalar(uint8_t value1, uint8_t value2, uint16_t weight2) {
+  return BlendFixedPoint(value1, value2, weight2);
+}
+
+
+inline float BlendScalar(float value1, float value2, uint16_t weight2) {
+  const float alpha2 = weight2 / 256.0f;
+  return (1.0f - alpha2) * value1 + alpha2 * value2;
+}
+
+
+template <typename _Tp>
+void BlendConstantScalar(
+    const _Tp *src1, const _Tp *src2, _Tp *dst,
+    int64_t num_elements, uint16_t weight2) {
+  for (int64_t i = 0; i < num_elements; ++i) {
+    dst[i] = BlendScalar(src1[i], src2[i], weight2);
+  }
+}
+
+
+template <typename _Tp>
+void BlendWeightsScalar(
+    const _Tp *src1, const _Tp *src2, const float *weights2,
+    _Tp *dst, int64_t num_pixels, int channels, int weight_channels) {
+  for (int64_t pixel = 0; pixel < num_pixels; ++pixel) {
+    for (int ch = 0; ch < channels; ++ch) {
+      const float alpha2 = weights2[(weight_channels == 1) ? 0 : ch];
+      dst[ch] = BlendScalar(
+            src1[ch], src2[ch], FixedPointWeight(static_cast<double>(alpha2)));
+    }
+    src1 += channels;
+    src2 += channels;
+    dst += channels;
+    weights2 += weight_channels;
+  }
+}
+
+
+inline void CompositePixelScalar(
+    const uint8_t *src, const uint8_t *overlay, uint8_t *dst, int channels) {
+  const uint16_t weight = FixedPointWeight(overlay[3]);
+  for (int ch = 0; ch < 3; ++ch) {
+    dst[ch] = BlendFixedPoint(src[ch], overlay[ch], weight);
+  }
+  if (channels == 4) {
+    dst[3] = static_cast<uint8_t>(
+          overlay[3] + ((src[3] * (256 - weight) + 128) >> 8));
+  }
+}
+
+
+inline void CompositePixelScalar(
+    const float *src, const float *overlay, float *dst, int channels) {
+  const float alpha = overlay[3];
+  for (int ch = 0; ch < 3; ++ch) {
+    dst[ch] = (1.0f - alpha) * src[ch] + alpha * overlay[ch];
+  }
+  if (channels == 4) {
+    dst[3] = alpha + src[3] * (1.0f - alpha);
+  }
+}
+
+
+template <typename _Tp>
+void AlphaCompositeScalar(
+    const _Tp *src, const _Tp *overlay, _Tp *dst,
+    int64_t num_pixels, int channels) {
+  for (int64_t i = 0; i < num_pixels; ++i) {
+    CompositePixelScalar(src, overlay, dst, channels);
+    src += channels;
+    dst += channels;
+    overlay += 4;
+  }
+}
+
+
+template <typename _Tp>
+const ConversionKernels<_Tp> &KernelsScalar() {
+  static const ConversionKernels<_Tp> kernels = {
+    RGB2RGBAScalar<_Tp>,
+    RGBA2RGBScalar<_Tp>,
+    Gray2RGBScalar<_Tp>,
+    Gray2RGBAScalar<_Tp>,
+    SwapChannelsScalar<_Tp>,
+    RGBx2GrayScalar<_Tp>,
+    MaskHSVRangeScalar<_Tp>,
+    ColorPopScalar<_Tp>,
+    RGBx2HSVScalar<_Tp>,
+    HSV2RGBxScalar<_Tp>,
+    RGBx2LabScalar<_Tp>,
+    Lab2RGBxScalar<_Tp>,
+    MaskRangeBitsScalar<_Tp>,
+    PackBitsScalar<_Tp>,
+    BlendConstantScalar<_Tp>,
+    BlendWeightsScalar<_Tp>,
+    AlphaCompositeScalar<_Tp>
+  };
+  return kernels;
+}
+
+template const ConversionKernels<uint8_t> &KernelsScalar<uint8_t>();
+template const ConversionKernels<float> &KernelsScalar<float>();
+
+
+void Float16ToFloatScalar(
+    const float16_t *src, float *dst, int64_t num_elements) {
+  for (int64_t i = 0; i < num_elements; ++i) {
+    dst[i] = HalfBitsToFloat(src[i].bits);
+  }
+}
+
+
+void FloatToFloat16Scalar(
+    const float *src, float16_t *dst, int64_t num_elements) {
+  for (int64_t i = 0; i < num_elements; ++i) {
+    dst[i].bits = FloatToHalfBits(src[i]);
+  }
+}
+
+
+void BFloat16ToFloatScalar(
+    const bfloat16_t *src, float *dst, int64_t num_elements) {
+  for (int64_t i = 0; i < num_elements; ++i) {
+    dst[i] = BFloat16BitsToFloat(src[i].bits);
+  }
+}
+
+
+void FloatToBFloat16Scalar(
+    const float *src, bfloat16_t *dst, int64_t num_elements) {
+  for (int64_t i = 0; i < num_elements; ++i) {
+    dst[i].bits = FloatToBFloat16Bits(src[i]);
+  }
+}
+
+
+const HalfPrecisionKernels &HalfKernelsScalar() {
+  static const HalfPrecisionKernels kernels = {
+    Float16ToFloatScalar,
+    FloatToFloat16Scalar,
+    BFloat16ToFloatScalar,
+    FloatToBFloat16Scalar
+  };
+  return kernels;
+}
+
+
+
+template <typename _Tsrc>
+void IntegerToUInt8Scalar(
+    const _Tsrc *src, uint8_t *dst, int64_t num_elements) {
+  for (int64_t i = 0; i < num_elements; ++i) {
+    dst[i] = SaturateUInt8(src[i]);
+  }
+}
+
+
+template <typename _Tsrc>
+void FloatingToUInt8Scalar(
+    const _Tsrc *src, uint8_t *dst, int64_t num_elements, _Tsrc scale) {
+  for (int64_t i = 0; i < num_elements; ++i) {
+    // The negated comparison also maps NaN to 0.
+    const _Tsrc value = src[i] * scale;
+    dst[i] = !(value > 0) ? 0
+        : ((value >= 255) ? 255 : static_cast<uint8_t>(value));
+  }
+}
+
+
+template <typename _Tsrc>
+void IntegerToFloatScalar(
+    const _Tsrc *src, float *dst, int64_t num_elements, float scale) {
+  for (int64_t i = 0; i < num_elements; ++i) {
+    dst[i] = static_cast<float>(src[i]) * scale;
+  }
+}
+
+
+void DoubleToFloatScalar(
+    const double *src, float *dst, int64_t num_elements, double scale) {
+  for (int64_t i = 0; i < num_elements; ++i) {
+    dst[i] = static_cast<float>(src[i] * scale);
+  }
+}
+
+
+const TypeCastKernels &CastKernelsScalar() {
+  static const TypeCastKernels kernels = {
+    IntegerToUInt8Scalar<int16_t>,
+    IntegerToUInt8Scalar<uint16_t>,
+    IntegerToUInt8Scalar<int32_t>,
+    FloatingToUInt8Scalar<float>,
+    FloatingToUInt8Scalar<double>,
+    IntegerToFloatScalar<uint8_t>,
+    IntegerToFloatScalar<int16_t>,
+    IntegerToFloatScalar<uint16_t>,
+    IntegerToFloatScalar<int32_t>,
+    DoubleToFloatScalar
+  };
+  return kernels;
+}
+
+template <typename _Tp>
+void StatisticsScalar(
+    const _Tp *src, int64_t num_elements, double offset,
+    RangeStatistics<_Tp> *stats) {
+  RangeStatistics<_Tp> result;
+  for (int64_t i = 0; i < num_elements; ++i) {
+    const _Tp val = src[i];
+    if constexpr (std::is_floating_point<_Tp>::value) {
+      if (std::isnan(val)) {
+        ++result.num_nan;
+        continue;
+      }
+    }
+
+    if (result.num_valid == 0) {
+      result.min_val = val;
+      result.max_val = val;
+      result.min_idx = i;
+      result.max_idx = i;
+    } else if (val < result.min_val) {
+      result.min_val = val;
+      result.min_idx = i;
+    } else if (val > result.max_val) {
+      result.max_val = val;
+      result.max_idx = i;
+    }
+    ++result.num_valid;
+    const double centered = static_cast<double>(val) - offset;
+    result.sum += centered;
+    result.sum_squares += centered * centered;
+  }
+  *stats = result;
+}
+
+
+const ReductionKernels &ReduceKernelsScalar() {
+  static const ReductionKernels kernels = {
+    StatisticsScalar<uint8_t>,
+    StatisticsScalar<float>
+  };
+  return kernels;
+}
+
+
+//---------------------------------------------------- CPU feature detection
+namespace {
+bool IsSupportedByCPU(InstructionSet isa) {
+  switch (isa) {
+    case InstructionSet::Scalar:
+      return true;
+
+    case InstructionSet::SSE41:
+    case InstructionSet::AVX2: {
+#if (defined(__GNUC__) || defined(__clang__)) \
+      && (defined(__x86_64__) || defined(__i386__))
+        __builtin_cpu_init();
+        return (isa == InstructionSet::SSE41)
+            ? __builtin_cpu_supports("sse4.1")
+            : __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        int info[4];
+        __cpuid(info, 0);
+        const int num_ids = info[0];
+        __cpuid(info, 1);
+        const bool sse41 = (info[2] & (1 << 19)) != 0;
+        if (isa == InstructionSet::SSE41) {
+          return sse41;
+        }
+        // AVX requires the OS to save the YMM registers
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        if ((num_ids < 7) || !osxsave || ((_xgetbv(0) & 6) != 6)) {
+          return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return false;
+#endif
+      }
+
+    case InstructionSet::NEON:
+      // NEON is mandatory on AArch64. The kernels are only
+      // compiled for this architecture.
+      return KernelsNEON<uint8_t>() != nullptr;
+  }
+  return false;
+}
+
+
+/// The half precision conversions of the AVX2 kernels require F16C,
+/// which is a separate CPUID feature flag.
+bool IsF16CSupportedByCPU() {
+#if (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("f16c");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 29)) != 0;
+#else
+  return false;
+#endif
+}
+
+
+bool IsCompiled(InstructionSet isa) {
+  switch (isa) {
+    case InstructionSet::Scalar:
+      return true;
+
+    case InstructionSet::SSE41:
+      return KernelsSSE41<uint8_t>() != nullptr;
+
+    case InstructionSet::AVX2:
+      return KernelsAVX2<uint8_t>() != nullptr;
+
+    case InstructionSet::NEON:
+      return KernelsNEON<uint8_t>() != nullptr;
+  }
+  return false;
+}
+
+
+bool IsAvailable(InstructionSet isa) {
+  return IsCompiled(isa) && IsSupportedByCPU(isa);
+}
+
+
+std::atomic<InstructionSet> &ActiveInstructionSetRef() {
+  static std::atomic<InstructionSet> isa(DetectInstructionSet());
+  return isa;
+}
+
+
+template <typename _Tp>
+const ConversionKernels<_Tp> &SelectKernels() {
+  const ConversionKernels<_Tp> *kernels = nullptr;
+  switch (ActiveInstructionSet()) {
+    case InstructionSet::AVX2:
+      kernels = KernelsAVX2<_Tp>();
+      break;
+
+    case InstructionSet::SSE41:
+      kernels = KernelsSSE41<_Tp>();
+      break;
+
+    case InstructionSet::NEON:
+      kernels = KernelsNEON<_Tp>();
+      break;
+
+    case InstructionSet::Scalar:
+      break;
+  }
+  return kernels ? *kernels : KernelsScalar<_Tp>();
+}
+}  // anonymous namespace
+
+
+std::string InstructionSetToString(InstructionSet isa) {
+  switch (isa) {
+    case InstructionSet::Scalar:
+      return "scalar";
+
+    case InstructionSet::SSE41:
+      return "sse4.1";
+
+    case InstructionSet::AVX2:
+      return "avx2";
+
+    case InstructionSet::NEON:
+      return "neon";
+  }
+  return "unknown";
+}
+
+
+InstructionSet DetectInstructionSet() {
+  for (InstructionSet isa : {InstructionSet::AVX2, InstructionSet::SSE41,
+                             InstructionSet::NEON}) {
+    if (IsAvailable(isa)) {
+      SPDLOG_DEBUG(
+            "Using `{:s}` ImageBuffer kernels.",
+            InstructionSetToString(isa));
+      return isa;
+    }
+  }
+  return InstructionSet::Scalar;
+}
+
+
+InstructionSet ActiveInstructionSet() {
+  return ActiveInstructionSetRef().load(std::memory_order_relaxed);
+}
+
+
+InstructionSet SetInstructionSet(InstructionSet isa) {
+  if (!IsAvailable(isa)) {
+    SPDLOG_WARN(
+          "Instruction set `{:s}` is not available, falling back to "
+          "the detected one.", InstructionSetToString(isa));
+    isa = DetectInstructionSet();
+  }
+  ActiveInstructionSetRef().store(isa, std::memory_order_relaxed);
+  return isa;
+}
+
+
+template <>
+const ConversionKernels<uint8_t> &Kernels<uint8_t>() {
+  return SelectKernels<uint8_t>();
+}
+
+
+template <>
+const ConversionKernels<float> &Kernels<float>() {
+  return SelectKernels<float>();
+}
+
+
+const HalfPrecisionKernels &HalfKernels() {
+  const HalfPrecisionKernels *kernels = nullptr;
+  switch (ActiveInstructionSet()) {
+    case InstructionSet::AVX2: {
+        static const bool f16c = IsF16CSupportedByCPU();
+        kernels = f16c ? HalfKernelsAVX2() : HalfKernelsSSE41();
+        break;
+      }
+
+    case InstructionSet::SSE41:
+      kernels = HalfKernelsSSE41();
+      break;
+
+    case InstructionSet::NEON:
+      kernels = HalfKernelsNEON();
+      break;
+
+    case InstructionSet::Scalar:
+      break;
+  }
+  return kernels ? *kernels : HalfKernelsScalar();
+}
+
+
+const TypeCastKernels &CastKernels() {
+  const TypeCastKernels *kernels = nullptr;
+  switch (ActiveInstructionSet()) {
+    case InstructionSet::AVX2:
+      kernels = CastKernelsAVX2();
+      break;
+
+    case InstructionSet::SSE41:
+      kernels = CastKernelsSSE41();
+      break;
+
+    case InstructionSet::NEON:
+      kernels = CastKernelsNEON();
+      break;
+
+    case InstructionSet::Scalar:
+      break;
+  }
+  return kernels ? *kernels : CastKernelsScalar();
+}
+
+
+const ReductionKernels &ReduceKernels() {
+  const ReductionKernels *kernels = nullptr;
+  switch (ActiveInstructionSet()) {
+    case InstructionSet::AVX2:
+      kernels = ReduceKernelsAVX2();
+      break;
+
+    case InstructionSet::SSE41:
+      kernels = ReduceKernelsSSE41();
+      break;
+
+    case InstructionSet::NEON:
+      kernels = ReduceKernelsNEON();
+      break;
+
+    case InstructionSet::Scalar:
+      break;
+  }
+  return kernels ? *kernels : ReduceKernelsScalar();
+}
+
+}  // namespace simd
+}  // namespace helpers
+}  // namespace viren2d
@@ -0,0 +1,412 @@
+#ifndef __VIREN2D_SIMD_KERNELS_H__
+#define __VIREN2D_SIMD_KERNELS_H__
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include <viren2d/halfprecision.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace simd {
+
+/// Instruction sets for which we provide vectorized ImageBuffer kernels.
+enum class InstructionSet : int {
+  Scalar = 0,
+  SSE41,
+  AVX2,
+  NEON
+};
+
+
+/// Returns the string representation.
+std::string InstructionSetToString(InstructionSet isa);
+
+
+/// Returns the best instruction set which is supported by the CPU
+/// (detected at runtime) and has been compiled into this library.
+InstructionSet DetectInstructionSet();
+
+
+/// Returns the instruction set which is currently used to select
+/// the conversion kernels. Defaults to `DetectInstructionSet()`.
+InstructionSet ActiveInstructionSet();
+
+
+/// Overrides the instruction set, *e.g.* to compare the vectorized
+/// kernels against the scalar fallback. If the requested instruction
+/// set is not supported, the detected one will be used instead.
+/// Returns the instruction set which is active afterwards.
+InstructionSet SetInstructionSet(InstructionSet isa);
+
+
+/// Inclusive HSV thresholds in the uint8 representation of
+/// `ConvertRGB2HSV`, *i.e.* hue in [0, 180], saturation & value
+/// in [0, 255].
+struct HSVRange {
+  uint8_t hue_min;
+  uint8_t hue_max;
+  uint8_t saturation_min;
+  uint8_t saturation_max;
+  uint8_t value_min;
+  uint8_t value_max;
+
+  /// Returns true if the given uint8 HSV triplet is within this range.
+  inline bool Contains(const uint8_t *hsv) const {
+    return (hsv[0] >= hue_min) && (hsv[0] <= hue_max)
+        && (hsv[1] >= saturation_min) && (hsv[1] <= saturation_max)
+        && (hsv[2] >= value_min) && (hsv[2] <= value_max);
+  }
+};
+
+
+/// Converts a blending weight in [0, 1] to 8.8 fixed-point, *i.e.* to
+/// [0, 256], where 256 corresponds to 1. Values outside are clamped.
+inline uint16_t FixedPointWeight(double alpha) {
+  if (!(alpha > 0.0)) {
+    return 0;
+  }
+  if (alpha >= 1.0) {
+    return 256;
+  }
+  return static_cast<uint16_t>(alpha * 256.0 + 0.5);
+}
+
+
+/// Converts a uint8 alpha value to its 8.8 fixed-point weight, such
+/// that 0 maps to 0 and 255 maps to 256.
+inline uint16_t FixedPointWeight(uint8_t alpha) {
+  return static_cast<uint16_t>(alpha + (alpha >> 7));
+}
+
+
+/// Returns the rounded fixed-point blend `(1 - w) * value1 + w * value2`,
+/// where the weight of `value2` is given in 8.8 fixed-point.
+inline uint8_t BlendFixedPoint(
+    uint8_t value1, uint8_t value2, uint16_t weight2) {
+  return static_cast<uint8_t>(
+        (value1 * (256 - weight2) + value2 * weight2 + 128) >> 8);
+}
+
+
+/// Converts a single value to `uint8`, see `ImageBuffer::ToUInt8`.
+/// Floating point values are expected to be in [0, 1], *i.e.* they are
+/// scaled by 255 and truncated. All results saturate and NaN becomes 0.
+template <typename _Tp> inline
+uint8_t SaturateUInt8(_Tp value) {
+  if constexpr (std::is_same<_Tp, uint8_t>::value) {
+    return value;
+  } else if constexpr (!std::numeric_limits<_Tp>::is_integer) {
+    // The negated comparison also maps NaN to 0. Half precision
+    // values are scaled in single precision.
+    const auto scaled = value * static_cast<_Tp>(255);
+    if (!(scaled > 0)) {
+      return 0;
+    }
+    return (scaled >= 255) ? 255 : static_cast<uint8_t>(scaled);
+  } else {
+    if constexpr (std::is_signed<_Tp>::value) {
+      if (value < 0) {
+        return 0;
+      }
+    }
+    return (value > static_cast<_Tp>(255))
+        ? 255 : static_cast<uint8_t>(value);
+  }
+}
+
+
+/// Function table of the channel & color conversion kernels. Each kernel
+/// processes `num_pixels` consecutive pixels, *i.e.* the pixels of the
+/// input and output rows must be packed (no gaps between pixels). Input
+/// and output memory must not overlap.
+template <typename _Tp>
+struct ConversionKernels {
+  /// Copies the color channels and sets the alpha channel to 255.
+  void (*rgb2rgba)(const _Tp *src, _Tp *dst, int64_t num_pixels);
+
+  /// Copies the color channels, *i.e.* drops the alpha channel.
+  void (*rgba2rgb)(const _Tp *src, _Tp *dst, int64_t num_pixels);
+
+  /// Replicates the intensity into 3 channels.
+  void (*gray2rgb)(const _Tp *src, _Tp *dst, int64_t num_pixels);
+
+  /// Replicates the intensity into 3 channels and sets alpha to 255.
+  void (*gray2rgba)(const _Tp *src, _Tp *dst, int64_t num_pixels);
+
+  /// Swaps the two channels of each pixel in-place.
+  void (*swap_channels)(
+      _Tp *data, int64_t num_pixels, int channels, int ch1, int ch2);
+
+  /// Computes the luminance of 3- or 4-channel inputs. The output can
+  /// have up to 4 channels (repeated luminance + alpha), see
+  /// `ConvertRGB2Gray`. Results are identical to `CvtHelperRGB2Gray`.
+  void (*rgbx2gray)(
+      const _Tp *src, _Tp *dst, int64_t num_pixels,
+      int src_channels, int dst_channels, bool is_bgr_format);
+
+  /// Sets the mask to 255 iff the HSV representation of a 3- or 4-channel
+  /// pixel is within the given range (0 otherwise), without computing the
+  /// full HSV image. Results are identical to `CvtHelperRGB2HSVUInt8`,
+  /// thus color values must be in [0, 255].
+  void (*mask_hsv_range)(
+      const _Tp *src, uint8_t *mask, int64_t num_pixels,
+      int src_channels, bool is_bgr_format, const HSVRange &range);
+
+  /// Copies 3- or 4-channel pixels which are within the given HSV range
+  /// and replaces the color channels of all others by their luminance
+  /// (the alpha channel is kept), *i.e.* the fused version of
+  /// `mask_hsv_range` and `rgbx2gray`.
+  void (*color_pop)(
+      const _Tp *src, _Tp *dst, int64_t num_pixels,
+      int channels, bool is_bgr_format, const HSVRange &range);
+
+  /// Converts 3- or 4-channel pixels (in [0, 255]) to the uint8 HSV
+  /// representation, see `ConvertRGB2HSV`. Results are identical to
+  /// `CvtHelperRGB2HSVUInt8`.
+  void (*rgbx2hsv)(
+      const _Tp *src, _Tp *dst, int64_t num_pixels,
+      int src_channels, bool is_bgr_format);
+
+  /// Converts uint8 HSV pixels to RGB(A)/BGR(A), where the optional
+  /// alpha channel is set to 255, see `ConvertHSV2RGB`.
+  void (*hsv2rgbx)(
+      const _Tp *src, _Tp *dst, int64_t num_pixels,
+      int dst_channels, bool is_bgr_format);
+
+  /// Converts 3- or 4-channel sRGB pixels to L*a*b*. For uint8, the
+  /// output uses the full range for L* and shifts a* & b* by 128. For
+  /// float, color values must be in [0, 1] and the output is unscaled,
+  /// *i.e.* L* in [0, 100].
+  void (*rgbx2lab)(
+      const _Tp *src, _Tp *dst, int64_t num_pixels,
+      int src_channels, bool is_bgr_format);
+
+  /// Converts L*a*b* pixels (see `rgbx2lab`) to RGB(A)/BGR(A), where the
+  /// optional alpha channel is set to 255 (uint8) or 1 (float).
+  void (*lab2rgbx)(
+      const _Tp *src, _Tp *dst, int64_t num_pixels,
+      int dst_channels, bool is_bgr_format);
+
+  /// Packs the range test of each pixel into a bit mask, *i.e.* bit
+  /// `i % 64` of `bits[i / 64]` is set unless a channel of the i-th pixel
+  /// is below `min_max[2 * ch]` or above `min_max[2 * ch + 1]` (same
+  /// semantics as `ImageBuffer::MaskRange`). Writes all words of the
+  /// row, where the bits beyond `num_pixels` are 0.
+  void (*mask_range_bits)(
+      const _Tp *src, uint64_t *bits, int64_t num_pixels,
+      int channels, const _Tp *min_max);
+
+  /// Packs the first channel into a bit mask, where a bit is set iff
+  /// the value is not 0. The bit layout is the same as for
+  /// `mask_range_bits`.
+  void (*pack_bits)(
+      const _Tp *src, uint64_t *bits, int64_t num_pixels, int channels);
+
+  /// Blends `num_elements` values with a constant weight of `src2`
+  /// given in 8.8 fixed-point (see `FixedPointWeight`). For uint8,
+  /// results are identical to `BlendFixedPoint`, whereas float values
+  /// are blended without rounding. Unlike the other kernels, `dst` may
+  /// be identical to `src1` or `src2`.
+  void (*blend_constant)(
+      const _Tp *src1, const _Tp *src2, _Tp *dst,
+      int64_t num_elements, uint16_t weight2);
+
+  /// Same as `blend_constant`, but with a weight per pixel (if
+  /// `weight_channels` is 1) or per element (if `weight_channels` equals
+  /// `channels`). The weights are given as float and converted to
+  /// fixed-point within the kernel, with the same results as
+  /// `FixedPointWeight(double)`.
+  void (*blend_weights)(
+      const _Tp *src1, const _Tp *src2, const float *weights2,
+      _Tp *dst, int64_t num_pixels, int channels, int weight_channels);
+
+  /// Composites the 4-channel `overlay` over the 3- or 4-channel `src`,
+  /// *i.e.* the color channels are blended by the overlay's alpha and
+  /// the output alpha (if `channels` is 4) is
+  /// `alpha_overlay + alpha_src * (1 - alpha_overlay)`. For uint8, the
+  /// overlay alpha is converted via `FixedPointWeight(uint8_t)`, for
+  /// float it must be in [0, 1]. `dst` may be identical to `src`.
+  void (*alpha_composite)(
+      const _Tp *src, const _Tp *overlay, _Tp *dst,
+      int64_t num_pixels, int channels);
+};
+
+
+/// Returns the kernels for the currently active instruction set.
+template <typename _Tp>
+const ConversionKernels<_Tp> &Kernels();
+
+template <>
+const ConversionKernels<uint8_t> &Kernels<uint8_t>();
+
+template <>
+const ConversionKernels<float> &Kernels<float>();
+
+
+/// Function table of the conversions between `float` and the half
+/// precision types, which process `num_elements` consecutive values.
+/// Results are bit-identical to `FloatToHalfBits`, `HalfBitsToFloat`,
+/// etc. Input and output memory must not overlap.
+struct HalfPrecisionKernels {
+  void (*float16_to_float)(
+      const float16_t *src, float *dst, int64_t num_elements);
+
+  void (*float_to_float16)(
+      const float *src, float16_t *dst, int64_t num_elements);
+
+  void (*bfloat16_to_float)(
+      const bfloat16_t *src, float *dst, int64_t num_elements);
+
+  void (*float_to_bfloat16)(
+      const float *src, bfloat16_t *dst, int64_t num_elements);
+};
+
+
+/// Returns the half precision kernels for the currently active
+/// instruction set. The AVX2 kernels additionally require F16C, otherwise
+/// the SSE4.1 kernels (which only vectorize bfloat16) are used.
+const HalfPrecisionKernels &HalfKernels();
+
+
+/// Function table of the type casts of `ImageBuffer::ToUInt8`, `ToFloat`
+/// and `AsType`, which process `num_elements` consecutive values. Input
+/// and output memory must not overlap. All kernels are bit-identical to
+/// their scalar counterparts:
+/// * Casts to `uint8` saturate, *i.e.* integers are clamped to [0, 255].
+///   Floating point values are multiplied by `scale` (in their own
+///   precision), truncated and clamped, where NaN becomes 0.
+/// * Casts to `float` compute `static_cast<float>(value) * scale` in single
+///   precision, except for `double` inputs, which are scaled in double
+///   precision before rounding.
+struct TypeCastKernels {
+  void (*int16_to_uint8)(
+      const int16_t *src, uint8_t *dst, int64_t num_elements);
+
+  void (*uint16_to_uint8)(
+      const uint16_t *src, uint8_t *dst, int64_t num_elements);
+
+  void (*int32_to_uint8)(
+      const int32_t *src, uint8_t *dst, int64_t num_elements);
+
+  void (*float_to_uint8)(
+      const float *src, uint8_t *dst, int64_t num_elements, float scale);
+
+  void (*double_to_uint8)(
+      const double *src, uint8_t *dst, int64_t num_elements, double scale);
+
+  void (*uint8_to_float)(
+      const uint8_t *src, float *dst, int64_t num_elements, float scale);
+
+  void (*int16_to_float)(
+      const int16_t *src, float *dst, int64_t num_elements, float scale);
+
+  void (*uint16_to_float)(
+      const uint16_t *src, float *dst, int64_t num_elements, float scale);
+
+  void (*int32_to_float)(
+      const int32_t *src, float *dst, int64_t num_elements, float scale);
+
+  void (*double_to_float)(
+      const double *src, float *dst, int64_t num_elements, double scale);
+};
+
+
+/// Returns the type cast kernels for the currently active instruction set.
+const TypeCastKernels &CastKernels();
+
+
+/// Partial statistics of `num_elements` consecutive values, see
+/// `ReductionKernels`. Indices are relative to the first value.
+template <typename _Tp>
+struct RangeStatistics {
+  /// Number of valid (*i.e.* not NaN) values.
+  int64_t num_valid = 0;
+
+  /// Number of NaN values (always 0 for integral types).
+  int64_t num_nan = 0;
+
+  /// Sum of `value - offset` over all valid values.
+  double sum = 0.0;
+
+  /// Sum of `(value - offset)^2` over all valid values.
+  double sum_squares = 0.0;
+
+  /// Extrema and the index of their first occurrence, only set if there
+  /// is at least one valid value.
+  _Tp min_val{};
+  _Tp max_val{};
+  int64_t min_idx = -1;
+  int64_t max_idx = -1;
+};
+
+
+/// Function table of the min/max/sum reductions of
+/// `ImageBuffer::Statistics`, which process `num_elements` consecutive
+/// values of a single channel. The sums are computed relative to
+/// `offset`, which must be an integer for `uint8`. `uint8` results are
+/// exact, *i.e.* identical to the scalar kernel. For `float`, NaN values
+/// are skipped and the sums are accumulated in double precision, but in
+/// a different order than the scalar kernel.
+struct ReductionKernels {
+  void (*uint8_statistics)(
+      const uint8_t *src, int64_t num_elements, double offset,
+      RangeStatistics<uint8_t> *stats);
+
+  void (*float_statistics)(
+      const float *src, int64_t num_elements, double offset,
+      RangeStatistics<float> *stats);
+};
+
+
+/// Returns the reduction kernels for the currently active instruction set.
+const ReductionKernels &ReduceKernels();
+
+
+/// Returns the kernels of the instruction set specific translation units,
+/// or nullptr if the instruction set is not available on the target
+/// architecture. Missing kernels fall back to the scalar ones.
+template <typename _Tp>
+const ConversionKernels<_Tp> *KernelsSSE41();
+
+template <typename _Tp>
+const ConversionKernels<_Tp> *KernelsAVX2();
+
+template <typename _Tp>
+const ConversionKernels<_Tp> *KernelsNEON();
+
+template <typename _Tp>
+const ConversionKernels<_Tp> &KernelsScalar();
+
+const HalfPrecisionKernels *HalfKernelsSSE41();
+
+const HalfPrecisionKernels *HalfKernelsAVX2();
+
+const HalfPrecisionKernels *HalfKernelsNEON();
+
+const HalfPrecisionKernels &HalfKernelsScalar();
+
+const TypeCastKernels *CastKernelsSSE41();
+
+const TypeCastKernels *CastKernelsAVX2();
+
+const TypeCastKernels *CastKernelsNEON();
+
+const TypeCastKernels &CastKernelsScalar();
+
+const ReductionKernels *ReduceKernelsSSE41();
+
+const ReductionKernels *ReduceKernelsAVX2();
+
+const ReductionKernels *ReduceKernelsNEON();
+
+const ReductionKernels &ReduceKernelsScalar();
+
+}  // namespace simd
+}  // namespace helpers
+}  // namespace viren2d
+
+#endif  // __VIREN2D_SIMD_KERNELS_H__
@@ -0,0 +1,861 @@
+#include <algorithm>
+#include <limits>
+
+#include <helpers/simd_kernels.h>
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define VIREN2D_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+
+namespace viren2d {
+namespace helpers {
+namespace simd {
+#ifdef VIREN2D_SIMD_NEON
+namespace {
+inline const ConversionKernels<uint8_t> &ScalarUInt8() {
+  return KernelsScalar<uint8_t>();
+}
+
+
+inline const ConversionKernels<float> &ScalarFloat() {
+  return KernelsScalar<float>();
+}
+
+
+//---------------------------------------------------- NEON uint8
+void RGB2RGBAUInt8NEON(const uint8_t *src, uint8_t *dst, int64_t num_pixels) {
+  int64_t i = 0;
+  for (; i + 16 <= num_pixels; i += 16) {
+    const uint8x16x3_t rgb = vld3q_u8(src + 3 * i);
+    uint8x16x4_t rgba;
+    rgba.val[0] = rgb.val[0];
+    rgba.val[1] = rgb.val[1];
+    rgba.val[2] = rgb.val[2];
+    rgba.val[3] = vdupq_n_u8(255);
+    vst4q_u8(dst + 4 * i, rgba);
+  }
+  ScalarUInt8().rgb2rgba(src + 3 * i, dst + 4 * i, num_pixels - i);
+}
+
+
+void RGBA2RGBUInt8NEON(const uint8_t *src, uint8_t *dst, int64_t num_pixels) {
+  int64_t i = 0;
+  for (; i + 16 <= num_pixels; i += 16) {
+    const uint8x16x4_t rgba = vld4q_u8(src + 4 * i);
+    uint8x16x3_t rgb;
+    rgb.val[0] = rgba.val[0];
+    rgb.val[1] = rgba.val[1];
+    rgb.val[2] = rgba.val[2];
+    vst3q_u8(dst + 3 * i, rgb);
+  }
+  ScalarUInt8().rgba2rgb(src + 4 * i, dst + 3 * i, num_pixels - i);
+}
+
+
+void Gray2RGBUInt8NEON(const uint8_t *src, uint8_t *dst, int64_t num_pixels) {
+  int64_t i = 0;
+  for (; i + 16 <= num_pixels; i += 16) {
+    const uint8x16_t gray = vld1q_u8(src + i);
+    uint8x16x3_t rgb;
+    rgb.val[0] = gray;
+    rgb.val[1] = gray;
+    rgb.val[2] = gray;
+    vst3q_u8(dst + 3 * i, rgb);
+  }
+  ScalarUInt8().gray2rgb(src + i, dst + 3 * i, num_pixels - i);
+}
+
+
+void Gray2RGBAUInt8NEON(const uint8_t *src, uint8_t *dst, int64_t num_pixels) {
+  int64_t i = 0;
+  for (; i + 16 <= num_pixels; i += 16) {
+    const uint8x16_t gray = vld1q_u8(src + i);
+    uint8x16x4_t rgba;
+    rgba.val[0] = gray;
+    rgba.val[1] = gray;
+    rgba.val[2] = gray;
+    rgba.val[3] = vdupq_n_u8(255);
+    vst4q_u8(dst + 4 * i, rgba);
+  }
+  ScalarUInt8().gray2rgba(src + i, dst + 4 * i, num_pixels - i);
+}
+
+
+void SwapChannelsUInt8NEON(
+    uint8_t *data, int64_t num_pixels, int channels, int ch1, int ch2) {
+  int64_t i = 0;
+  if (channels == 3) {
+    for (; i + 16 <= num_pixels; i += 16) {
+      uint8x16x3_t px = vld3q_u8(data + 3 * i);
+      const uint8x16_t tmp = px.val[ch1];
+      px.val[ch1] = px.val[ch2];
+      px.val[ch2] = tmp;
+      vst3q_u8(data + 3 * i, px);
+    }
+  } else if (channels == 4) {
+    for (; i + 16 <= num_pixels; i += 16) {
+      uint8x16x4_t px = vld4q_u8(data + 4 * i);
+      const uint8x16_t tmp = px.val[ch1];
+      px.val[ch1] = px.val[ch2];
+      px.val[ch2] = tmp;
+      vst4q_u8(data + 4 * i, px);
+    }
+  }
+  ScalarUInt8().swap_channels(
+        data + channels * i, num_pixels - i, channels, ch1, ch2);
+}
+
+
+/// Fixed-point blend of 8 values, see `BlendFixedPoint`.
+inline uint8x8_t BlendUInt8x8NEON(
+    uint8x8_t value1, uint8x8_t value2, uint16x8_t weight1, uint16x8_t weight2) {
+  const uint16x8_t sum = vmlaq_u16(
+        vmlaq_u16(vdupq_n_u16(128), vmovl_u8(value1), weight1),
+        vmovl_u8(value2), weight2);
+  return vshrn_n_u16(sum, 8);
+}
+
+
+/// Fixed-point blend of 16 values with separate weights for the
+/// lower and upper 8 values.
+inline uint8x16_t BlendUInt8x16NEON(
+    uint8x16_t value1, uint8x16_t value2,
+    uint16x8_t weight2_low, uint16x8_t weight2_high) {
+  const uint16x8_t full = vdupq_n_u16(256);
+  return vcombine_u8(
+        BlendUInt8x8NEON(
+          vget_low_u8(value1), vget_low_u8(value2),
+          vsubq_u16(full, weight2_low), weight2_low),
+        BlendUInt8x8NEON(
+          vget_high_u8(value1), vget_high_u8(value2),
+          vsubq_u16(full, weight2_high), weight2_high));
+}
+
+
+void BlendConstantUInt8NEON(
+    const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
+    int64_t num_elements, uint16_t weight2) {
+  int64_t i = 0;
+  const uint16x8_t weight = vdupq_n_u16(weight2);
+  for (; i + 16 <= num_elements; i += 16) {
+    vst1q_u8(dst + i, BlendUInt8x16NEON(
+               vld1q_u8(src1 + i), vld1q_u8(src2 + i), weight, weight));
+  }
+  ScalarUInt8().blend_constant(
+        src1 + i, src2 + i, dst + i, num_elements - i, weight2);
+}
+
+
+/// Blends `num_elements` values with a fixed-point weight per element.
+void BlendFixedPointWeightsUInt8NEON(
+    const uint8_t *src1, const uint8_t *src2, const uint16_t *weights2,
+    uint8_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    vst1q_u8(dst + i, BlendUInt8x16NEON(
+               vld1q_u8(src1 + i), vld1q_u8(src2 + i),
+               vld1q_u16(weights2 + i), vld1q_u16(weights2 + i + 8)));
+  }
+  for (; i < num_elements; ++i) {
+    dst[i] = BlendFixedPoint(src1[i], src2[i], weights2[i]);
+  }
+}
+
+
+/// Converts 4 blending weights to 8.8 fixed-point, with the same results
+/// as `FixedPointWeight(double)`.
+inline uint16x4_t FixedPointWeightsNEON(float32x4_t alpha) {
+  // Scaling by 256 is exact. The comparison fails for NaN, i.e. such
+  // weights become 0.
+  const float32x4_t scaled = vminq_f32(
+        vmulq_n_f32(alpha, 256.0f), vdupq_n_f32(256.0f));
+  const uint32x4_t positive = vcgtq_f32(scaled, vdupq_n_f32(0.0f));
+  // Round half up without adding 0.5 (which could round in float)
+  const uint32x4_t truncated = vcvtq_u32_f32(scaled);
+  const float32x4_t fraction = vsubq_f32(scaled, vcvtq_f32_u32(truncated));
+  const uint32x4_t round_up = vcgeq_f32(fraction, vdupq_n_f32(0.5f));
+  return vmovn_u32(vandq_u32(vsubq_u32(truncated, round_up), positive));
+}
+
+
+/// Number of fixed-point weights which are converted (on the stack) at
+/// once by `BlendWeightsUInt8NEON`.
+constexpr int64_t kBlendWeightsBlockSize = 256;
+
+
+void BlendWeightsUInt8NEON(
+    const uint8_t *src1, const uint8_t *src2, const float *weights2,
+    uint8_t *dst, int64_t num_pixels, int channels, int weight_channels) {
+  const int64_t repeat = channels / weight_channels;
+  if (((weight_channels != 1) && (weight_channels != channels))
+      || (repeat > kBlendWeightsBlockSize / 8)) {
+    ScalarUInt8().blend_weights(
+          src1, src2, weights2, dst, num_pixels, channels, weight_channels);
+    return;
+  }
+
+  uint16_t fixed[kBlendWeightsBlockSize];
+  const int64_t num_weights = num_pixels * weight_channels;
+  // Number of weights per block, such that the broadcast ones still fit
+  const int64_t block_size = (kBlendWeightsBlockSize / repeat) & ~int64_t(7);
+  for (int64_t start = 0; start < num_weights; start += block_size) {
+    const int64_t count = std::min(block_size, num_weights - start);
+    const float *weights = weights2 + start;
+    int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+      vst1q_u16(fixed + i, vcombine_u16(
+                  FixedPointWeightsNEON(vld1q_f32(weights + i)),
+                  FixedPointWeightsNEON(vld1q_f32(weights + i + 4))));
+    }
+    for (; i < count; ++i) {
+      fixed[i] = FixedPointWeight(static_cast<double>(weights[i]));
+    }
+
+    if (repeat > 1) {
+      // In-place broadcast, back to front
+      for (int64_t idx = count - 1; idx >= 0; --idx) {
+        const uint16_t weight = fixed[idx];
+        for (int64_t ch = repeat - 1; ch >= 0; --ch) {
+          fixed[idx * repeat + ch] = weight;
+        }
+      }
+    }
+
+    const int64_t offset = start * repeat;
+    BlendFixedPointWeightsUInt8NEON(
+          src1 + offset, src2 + offset, fixed, dst + offset, count * repeat);
+  }
+}
+
+
+/// Composites the first 3 channels and returns the weights of the
+/// overlay's alpha channel, see `FixedPointWeight(uint8_t)`.
+inline void CompositeColorsNEON(
+    const uint8x16x4_t &overlay, uint8x16_t *colors,
+    uint16x8_t *weight_low, uint16x8_t *weight_high) {
+  const uint16x8_t alpha_low = vmovl_u8(vget_low_u8(overlay.val[3]));
+  const uint16x8_t alpha_high = vmovl_u8(vget_high_u8(overlay.val[3]));
+  *weight_low = vaddq_u16(alpha_low, vshrq_n_u16(alpha_low, 7));
+  *weight_high = vaddq_u16(alpha_high, vshrq_n_u16(alpha_high, 7));
+  for (int ch = 0; ch < 3; ++ch) {
+    colors[ch] = BlendUInt8x16NEON(
+          colors[ch], overlay.val[ch], *weight_low, *weight_high);
+  }
+}
+
+
+void AlphaCompositeUInt8NEON(
+    const uint8_t *src, const uint8_t *overlay, uint8_t *dst,
+    int64_t num_pixels, int channels) {
+  int64_t i = 0;
+  uint16x8_t weight_low, weight_high;
+  if (channels == 3) {
+    for (; i + 16 <= num_pixels; i += 16) {
+      const uint8x16x4_t over = vld4q_u8(overlay + 4 * i);
+      uint8x16x3_t px = vld3q_u8(src + 3 * i);
+      CompositeColorsNEON(over, px.val, &weight_low, &weight_high);
+      vst3q_u8(dst + 3 * i, px);
+    }
+  } else if (channels == 4) {
+    const uint16x8_t full = vdupq_n_u16(256);
+    const uint8x8_t zero = vdup_n_u8(0);
+    for (; i + 16 <= num_pixels; i += 16) {
+      const uint8x16x4_t over = vld4q_u8(overlay + 4 * i);
+      uint8x16x4_t px = vld4q_u8(src + 4 * i);
+      CompositeColorsNEON(over, px.val, &weight_low, &weight_high);
+      // alpha_overlay + alpha_src * (1 - weight)
+      const uint8x16_t remaining = vcombine_u8(
+            BlendUInt8x8NEON(
+              vget_low_u8(px.val[3]), zero,
+              vsubq_u16(full, weight_low), weight_low),
+            BlendUInt8x8NEON(
+              vget_high_u8(px.val[3]), zero,
+              vsubq_u16(full, weight_high), weight_high));
+      px.val[3] = vaddq_u8(over.val[3], remaining);
+      vst4q_u8(dst + 4 * i, px);
+    }
+  }
+  ScalarUInt8().alpha_composite(
+        src + channels * i, overlay + 4 * i, dst + channels * i,
+        num_pixels - i, channels);
+}
+
+
+//---------------------------------------------------- NEON float
+void RGB2RGBAFloatNEON(const float *src, float *dst, int64_t num_pixels) {
+  int64_t i = 0;
+  for (; i + 4 <= num_pixels; i += 4) {
+    const float32x4x3_t rgb = vld3q_f32(src + 3 * i);
+    float32x4x4_t rgba;
+    rgba.val[0] = rgb.val[0];
+    rgba.val[1] = rgb.val[1];
+    rgba.val[2] = rgb.val[2];
+    rgba.val[3] = vdupq_n_f32(255.0f);
+    vst4q_f32(dst + 4 * i, rgba);
+  }
+  ScalarFloat().rgb2rgba(src + 3 * i, dst + 4 * i, num_pixels - i);
+}
+
+
+void RGBA2RGBFloatNEON(const float *src, float *dst, int64_t num_pixels) {
+  int64_t i = 0;
+  for (; i + 4 <= num_pixels; i += 4) {
+    const float32x4x4_t rgba = vld4q_f32(src + 4 * i);
+    float32x4x3_t rgb;
+    rgb.val[0] = rgba.val[0];
+    rgb.val[1] = rgba.val[1];
+    rgb.val[2] = rgba.val[2];
+    vst3q_f32(dst + 3 * i, rgb);
+  }
+  ScalarFloat().rgba2rgb(src + 4 * i, dst + 3 * i, num_pixels - i);
+}
+
+
+void Gray2RGBFloatNEON(const float *src, float *dst, int64_t num_pixels) {
+  int64_t i = 0;
+  for (; i + 4 <= num_pixels; i += 4) {
+    const float32x4_t gray = vld1q_f32(src + i);
+    float32x4x3_t rgb;
+    rgb.val[0] = gray;
+    rgb.val[1] = gray;
+    rgb.val[2] = gray;
+    vst3q_f32(dst + 3 * i, rgb);
+  }
+  ScalarFloat().gray2rgb(src + i, dst + 3 * i, num_pixels - i);
+}
+
+
+void Gray2RGBAFloatNEON(const float *src, float *dst, int64_t num_pixels) {
+  int64_t i = 0;
+  for (; i + 4 <= num_pixels; i += 4) {
+    const float32x4_t gray = vld1q_f32(src + i);
+    float32x4x4_t rgba;
+    rgba.val[0] = gray;
+    rgba.val[1] = gray;
+    rgba.val[2] = gray;
+    rgba.val[3] = vdupq_n_f32(255.0f);
+    vst4q_f32(dst + 4 * i, rgba);
+  }
+  ScalarFloat().gray2rgba(src + i, dst + 4 * i, num_pixels - i);
+}
+
+
+//---------------------------------------------------- NEON half precision
+// AArch64 converts binary16 natively (with the default round-to-nearest
+// mode of FPCR), whereas bfloat16 is rounded via integer arithmetic.
+void Float16ToFloatNEON(
+    const float16_t *src, float *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const uint16x8_t half = vld1q_u16(
+          reinterpret_cast<const uint16_t *>(src + i));
+    vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vget_low_u16(half))));
+    vst1q_f32(
+          dst + i + 4, vcvt_f32_f16(vreinterpret_f16_u16(vget_high_u16(half))));
+  }
+  HalfKernelsScalar().float16_to_float(src + i, dst + i, num_elements - i);
+}
+
+
+void FloatToFloat16NEON(
+    const float *src, float16_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const uint16x4_t low = vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i)));
+    const uint16x4_t high = vreinterpret_u16_f16(
+          vcvt_f16_f32(vld1q_f32(src + i + 4)));
+    vst1q_u16(reinterpret_cast<uint16_t *>(dst + i), vcombine_u16(low, high));
+  }
+  HalfKernelsScalar().float_to_float16(src + i, dst + i, num_elements - i);
+}
+
+
+void BFloat16ToFloatNEON(
+    const bfloat16_t *src, float *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const uint16x8_t bfloat = vld1q_u16(
+          reinterpret_cast<const uint16_t *>(src + i));
+    vst1q_f32(
+          dst + i, vreinterpretq_f32_u32(vshll_n_u16(vget_low_u16(bfloat), 16)));
+    vst1q_f32(
+          dst + i + 4,
+          vreinterpretq_f32_u32(vshll_n_u16(vget_high_u16(bfloat), 16)));
+  }
+  HalfKernelsScalar().bfloat16_to_float(src + i, dst + i, num_elements - i);
+}
+
+
+/// Rounds to nearest even, NaNs are quieted, see `FloatToBFloat16Bits`.
+inline uint16x4_t RoundToBFloat16NEON(float32x4_t values) {
+  const uint32x4_t bits = vreinterpretq_u32_f32(values);
+  const uint32x4_t upper = vshrq_n_u32(bits, 16);
+  const uint32x4_t bias = vaddq_u32(
+        vandq_u32(upper, vdupq_n_u32(1)), vdupq_n_u32(0x7FFF));
+  const uint32x4_t rounded = vshrq_n_u32(vaddq_u32(bits, bias), 16);
+  const uint32x4_t is_nan = vcgtq_u32(
+        vandq_u32(bits, vdupq_n_u32(0x7FFFFFFF)), vdupq_n_u32(0x7F800000));
+  return vmovn_u32(vbslq_u32(
+        is_nan, vorrq_u32(upper, vdupq_n_u32(0x40)), rounded));
+}
+
+
+void FloatToBFloat16NEON(
+    const float *src, bfloat16_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    vst1q_u16(
+          reinterpret_cast<uint16_t *>(dst + i),
+          vcombine_u16(
+            RoundToBFloat16NEON(vld1q_f32(src + i)),
+            RoundToBFloat16NEON(vld1q_f32(src + i + 4))));
+  }
+  HalfKernelsScalar().float_to_bfloat16(src + i, dst + i, num_elements - i);
+}
+
+
+//---------------------------------------------------- NEON type casts
+// The float to unsigned conversions truncate and saturate, mapping NaN
+// and negative values to 0. Thus, all casts to uint8 boil down to
+// saturating narrows.
+void Int16ToUInt8NEON(
+    const int16_t *src, uint8_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    vst1q_u8(dst + i, vcombine_u8(vqmovun_s16(vld1q_s16(src + i)),
+                                  vqmovun_s16(vld1q_s16(src + i + 8))));
+  }
+  CastKernelsScalar().int16_to_uint8(src + i, dst + i, num_elements - i);
+}
+
+
+void UInt16ToUInt8NEON(
+    const uint16_t *src, uint8_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    vst1q_u8(dst + i, vcombine_u8(vqmovn_u16(vld1q_u16(src + i)),
+                                  vqmovn_u16(vld1q_u16(src + i + 8))));
+  }
+  CastKernelsScalar().uint16_to_uint8(src + i, dst + i, num_elements - i);
+}
+
+
+void Int32ToUInt8NEON(
+    const int32_t *src, uint8_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const uint16x8_t narrowed = vcombine_u16(
+          vqmovun_s32(vld1q_s32(src + i)), vqmovun_s32(vld1q_s32(src + i + 4)));
+    vst1_u8(dst + i, vqmovn_u16(narrowed));
+  }
+  CastKernelsScalar().int32_to_uint8(src + i, dst + i, num_elements - i);
+}
+
+
+void FloatToUInt8NEON(
+    const float *src, uint8_t *dst, int64_t num_elements, float scale) {
+  const float32x4_t vscale = vdupq_n_f32(scale);
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const uint32x4_t low = vcvtq_u32_f32(vmulq_f32(vld1q_f32(src + i), vscale));
+    const uint32x4_t high = vcvtq_u32_f32(
+          vmulq_f32(vld1q_f32(src + i + 4), vscale));
+    vst1_u8(dst + i, vqmovn_u16(vcombine_u16(vqmovn_u32(low), vqmovn_u32(high))));
+  }
+  CastKernelsScalar().float_to_uint8(
+        src + i, dst + i, num_elements - i, scale);
+}
+
+
+/// Scales & converts 4 doubles, saturated to uint16.
+inline uint16x4_t ScaleDoubleToUInt16NEON(const double *src, float64x2_t scale) {
+  const uint64x2_t low = vcvtq_u64_f64(vmulq_f64(vld1q_f64(src), scale));
+  const uint64x2_t high = vcvtq_u64_f64(vmulq_f64(vld1q_f64(src + 2), scale));
+  return vqmovn_u32(vcombine_u32(vqmovn_u64(low), vqmovn_u64(high)));
+}
+
+
+void DoubleToUInt8NEON(
+    const double *src, uint8_t *dst, int64_t num_elements, double scale) {
+  const float64x2_t vscale = vdupq_n_f64(scale);
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    vst1_u8(dst + i, vqmovn_u16(vcombine_u16(
+                                  ScaleDoubleToUInt16NEON(src + i, vscale),
+                                  ScaleDoubleToUInt16NEON(src + i + 4, vscale))));
+  }
+  CastKernelsScalar().double_to_uint8(
+        src + i, dst + i, num_elements - i, scale);
+}
+
+
+void UInt8ToFloatNEON(
+    const uint8_t *src, float *dst, int64_t num_elements, float scale) {
+  const float32x4_t vscale = vdupq_n_f32(scale);
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const uint16x8_t values = vmovl_u8(vld1_u8(src + i));
+    vst1q_f32(dst + i, vmulq_f32(
+                vcvtq_f32_u32(vmovl_u16(vget_low_u16(values))), vscale));
+    vst1q_f32(dst + i + 4, vmulq_f32(
+                vcvtq_f32_u32(vmovl_u16(vget_high_u16(values))), vscale));
+  }
+  CastKernelsScalar().uint8_to_float(src + i, dst + i, num_elements - i, scale);
+}
+
+
+void Int16ToFloatNEON(
+    const int16_t *src, float *dst, int64_t num_elements, float scale) {
+  const float32x4_t vscale = vdupq_n_f32(scale);
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const int16x8_t values = vld1q_s16(src + i);
+    vst1q_f32(dst + i, vmulq_f32(
+                vcvtq_f32_s32(vmovl_s16(vget_low_s16(values))), vscale));
+    vst1q_f32(dst + i + 4, vmulq_f32(
+                vcvtq_f32_s32(vmovl_s16(vget_high_s16(values))), vscale));
+  }
+  CastKernelsScalar().int16_to_float(src + i, dst + i, num_elements - i, scale);
+}
+
+
+void UInt16ToFloatNEON(
+    const uint16_t *src, float *dst, int64_t num_elements, float scale) {
+  const float32x4_t vscale = vdupq_n_f32(scale);
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const uint16x8_t values = vld1q_u16(src + i);
+    vst1q_f32(dst + i, vmulq_f32(
+                vcvtq_f32_u32(vmovl_u16(vget_low_u16(values))), vscale));
+    vst1q_f32(dst + i + 4, vmulq_f32(
+                vcvtq_f32_u32(vmovl_u16(vget_high_u16(values))), vscale));
+  }
+  CastKernelsScalar().uint16_to_float(
+        src + i, dst + i, num_elements - i, scale);
+}
+
+
+void Int32ToFloatNEON(
+    const int32_t *src, float *dst, int64_t num_elements, float scale) {
+  const float32x4_t vscale = vdupq_n_f32(scale);
+  int64_t i = 0;
+  for (; i + 4 <= num_elements; i += 4) {
+    vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vld1q_s32(src + i)), vscale));
+  }
+  CastKernelsScalar().int32_to_float(src + i, dst + i, num_elements - i, scale);
+}
+
+
+void DoubleToFloatNEON(
+    const double *src, float *dst, int64_t num_elements, double scale) {
+  const float64x2_t vscale = vdupq_n_f64(scale);
+  int64_t i = 0;
+  for (; i + 4 <= num_elements; i += 4) {
+    const float32x2_t low = vcvt_f32_f64(vmulq_f64(vld1q_f64(src + i), vscale));
+    vst1q_f32(dst + i, vcvt_high_f32_f64(
+                low, vmulq_f64(vld1q_f64(src + i + 2), vscale)));
+  }
+  CastKernelsScalar().double_to_float(
+        src + i, dst + i, num_elements - i, scale);
+}
+
+
+//---------------------------------------------------- Reductions
+/// Returns the index of the first value in [begin, end) which equals
+/// `value`, or -1.
+template <typename _Tp> inline
+int64_t FindFirstScalar(
+    const _Tp *src, int64_t begin, int64_t end, _Tp value) {
+  for (int64_t i = begin; i < end; ++i) {
+    if (src[i] == value) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+int64_t FindFirstUInt8NEON(
+    const uint8_t *src, int64_t num_elements, uint8_t value) {
+  const uint8x16_t target = vdupq_n_u8(value);
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    if (vmaxvq_u8(vceqq_u8(vld1q_u8(src + i), target)) != 0) {
+      return FindFirstScalar(src, i, i + 16, value);
+    }
+  }
+  return FindFirstScalar(src, i, num_elements, value);
+}
+
+
+int64_t FindFirstFloatNEON(
+    const float *src, int64_t num_elements, float value) {
+  const float32x4_t target = vdupq_n_f32(value);
+  int64_t i = 0;
+  for (; i + 4 <= num_elements; i += 4) {
+    if (vmaxvq_u32(vceqq_f32(vld1q_f32(src + i), target)) != 0) {
+      return FindFirstScalar(src, i, i + 4, value);
+    }
+  }
+  return FindFirstScalar(src, i, num_elements, value);
+}
+
+
+/// Number of 16-byte vectors whose squares can be summed up in 32-bit
+/// lanes without overflow: 4096 * 4 * 255^2 < 2^32.
+constexpr int64_t kSquaresBlockSize = 4096;
+
+
+void StatisticsUInt8NEON(
+    const uint8_t *src, int64_t num_elements, double offset,
+    RangeStatistics<uint8_t> *stats) {
+  uint8x16_t vmin = vdupq_n_u8(255);
+  uint8x16_t vmax = vdupq_n_u8(0);
+  uint64x2_t vsum = vdupq_n_u64(0);
+  uint64x2_t vsum_squares = vdupq_n_u64(0);
+  int64_t i = 0;
+  while (i + 16 <= num_elements) {
+    const int64_t block_end = std::min(
+          num_elements, i + 16 * kSquaresBlockSize);
+    uint32x4_t sums = vdupq_n_u32(0);
+    uint32x4_t squares = vdupq_n_u32(0);
+    for (; i + 16 <= block_end; i += 16) {
+      const uint8x16_t v = vld1q_u8(src + i);
+      vmin = vminq_u8(vmin, v);
+      vmax = vmaxq_u8(vmax, v);
+      sums = vpadalq_u16(sums, vpaddlq_u8(v));
+      const uint8x8_t lo = vget_low_u8(v);
+      squares = vpadalq_u16(squares, vmull_u8(lo, lo));
+      squares = vpadalq_u16(squares, vmull_high_u8(v, v));
+    }
+    vsum = vpadalq_u32(vsum, sums);
+    vsum_squares = vpadalq_u32(vsum_squares, squares);
+  }
+
+  uint8_t min_val = vminvq_u8(vmin);
+  uint8_t max_val = vmaxvq_u8(vmax);
+  uint64_t sum = vaddvq_u64(vsum);
+  uint64_t sum_squares = vaddvq_u64(vsum_squares);
+  for (; i < num_elements; ++i) {
+    const uint8_t val = src[i];
+    min_val = std::min(min_val, val);
+    max_val = std::max(max_val, val);
+    sum += val;
+    sum_squares += static_cast<uint64_t>(val) * val;
+  }
+
+  // The centered sums are exact integers, thus identical to the scalar
+  // results.
+  RangeStatistics<uint8_t> result;
+  if (num_elements > 0) {
+    const int64_t off = static_cast<int64_t>(offset);
+    const int64_t total = static_cast<int64_t>(sum);
+    result.num_valid = num_elements;
+    result.sum = static_cast<double>(total - num_elements * off);
+    result.sum_squares = static_cast<double>(
+          static_cast<int64_t>(sum_squares) - 2 * off * total
+          + num_elements * off * off);
+    result.min_val = min_val;
+    result.max_val = max_val;
+    result.min_idx = FindFirstUInt8NEON(src, num_elements, min_val);
+    result.max_idx = FindFirstUInt8NEON(src, num_elements, max_val);
+  }
+  *stats = result;
+}
+
+
+void StatisticsFloatNEON(
+    const float *src, int64_t num_elements, double offset,
+    RangeStatistics<float> *stats) {
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  const float64x2_t voffset = vdupq_n_f64(offset);
+  float32x4_t vmin = vdupq_n_f32(inf);
+  float32x4_t vmax = vdupq_n_f32(-inf);
+  float64x2_t vsum = vdupq_n_f64(0.0);
+  float64x2_t vsum_squares = vdupq_n_f64(0.0);
+  uint32x4_t vnum_nan = vdupq_n_u32(0);
+  int64_t i = 0;
+  for (; i + 4 <= num_elements; i += 4) {
+    const float32x4_t v = vld1q_f32(src + i);
+    // FMINNM/FMAXNM return the number if the other operand is NaN
+    vmin = vminnmq_f32(vmin, v);
+    vmax = vmaxnmq_f32(vmax, v);
+    const uint32x4_t valid = vceqq_f32(v, v);
+    // The inverted mask is all ones (i.e. -1) for NaN
+    vnum_nan = vsubq_u32(vnum_nan, vmvnq_u32(valid));
+    const int32x4_t mask = vreinterpretq_s32_u32(valid);
+    const float64x2_t lo = vreinterpretq_f64_s64(vandq_s64(
+          vreinterpretq_s64_f64(
+            vsubq_f64(vcvt_f64_f32(vget_low_f32(v)), voffset)),
+          vmovl_s32(vget_low_s32(mask))));
+    const float64x2_t hi = vreinterpretq_f64_s64(vandq_s64(
+          vreinterpretq_s64_f64(vsubq_f64(vcvt_high_f64_f32(v), voffset)),
+          vmovl_high_s32(mask)));
+    vsum = vaddq_f64(vsum, vaddq_f64(lo, hi));
+    vsum_squares = vaddq_f64(
+          vsum_squares, vaddq_f64(vmulq_f64(lo, lo), vmulq_f64(hi, hi)));
+  }
+
+  RangeStatistics<float> result;
+  result.min_val = vminvq_f32(vmin);
+  result.max_val = vmaxvq_f32(vmax);
+  result.num_nan = static_cast<int64_t>(vgetq_lane_u32(vnum_nan, 0))
+      + vgetq_lane_u32(vnum_nan, 1) + vgetq_lane_u32(vnum_nan, 2)
+      + vgetq_lane_u32(vnum_nan, 3);
+  result.sum = vaddvq_f64(vsum);
+  result.sum_squares = vaddvq_f64(vsum_squares);
+  for (; i < num_elements; ++i) {
+    const float val = src[i];
+    if (val != val) {
+      ++result.num_nan;
+      continue;
+    }
+    result.min_val = std::min(result.min_val, val);
+    result.max_val = std::max(result.max_val, val);
+    const double centered = static_cast<double>(val) - offset;
+    result.sum += centered;
+    result.sum_squares += centered * centered;
+  }
+
+  result.num_valid = num_elements - result.num_nan;
+  if (result.num_valid > 0) {
+    // Take the values from the input, so equal values of different sign
+    // (i.e. +0 and -0) are reported just like by the scalar kernel.
+    result.min_idx = FindFirstFloatNEON(src, num_elements, result.min_val);
+    result.max_idx = FindFirstFloatNEON(src, num_elements, result.max_val);
+    result.min_val = src[result.min_idx];
+    result.max_val = src[result.max_idx];
+  } else {
+    result.min_val = 0.0f;
+    result.max_val = 0.0f;
+  }
+  *stats = result;
+}
+
+}  // anonymous namespace
+
+
+//---------------------------------------------------- Kernel tables
+template <>
+const ConversionKernels<uint8_t> *KernelsNEON<uint8_t>() {
+  // The luminance, HSV & L*a*b* computations use the scalar kernels,
+  // because they must match `CvtHelperRGB2Gray`, `CvtHelperRGB2HSVUInt8`
+  // and the lookup-table interpolation exactly.
+  static const ConversionKernels<uint8_t> kernels = {
+    RGB2RGBAUInt8NEON,
+    RGBA2RGBUInt8NEON,
+    Gray2RGBUInt8NEON,
+    Gray2RGBAUInt8NEON,
+    SwapChannelsUInt8NEON,
+    ScalarUInt8().rgbx2gray,
+    ScalarUInt8().mask_hsv_range,
+    ScalarUInt8().color_pop,
+    ScalarUInt8().rgbx2hsv,
+    ScalarUInt8().hsv2rgbx,
+    ScalarUInt8().rgbx2lab,
+    ScalarUInt8().lab2rgbx,
+    ScalarUInt8().mask_range_bits,
+    ScalarUInt8().pack_bits,
+    BlendConstantUInt8NEON,
+    BlendWeightsUInt8NEON,
+    AlphaCompositeUInt8NEON
+  };
+  return &kernels;
+}
+
+
+template <>
+const ConversionKernels<float> *KernelsNEON<float>() {
+  static const ConversionKernels<float> kernels = {
+    RGB2RGBAFloatNEON,
+    RGBA2RGBFloatNEON,
+    Gray2RGBFloatNEON,
+    Gray2RGBAFloatNEON,
+    ScalarFloat().swap_channels,
+    ScalarFloat().rgbx2gray,
+    ScalarFloat().mask_hsv_range,
+    ScalarFloat().color_pop,
+    ScalarFloat().rgbx2hsv,
+    ScalarFloat().hsv2rgbx,
+    ScalarFloat().rgbx2lab,
+    ScalarFloat().lab2rgbx,
+    ScalarFloat().mask_range_bits,
+    ScalarFloat().pack_bits,
+    ScalarFloat().blend_constant,
+    ScalarFloat().blend_weights,
+    ScalarFloat().alpha_composite
+  };
+  return &kernels;
+}
+
+
+const HalfPrecisionKernels *HalfKernelsNEON() {
+  static const HalfPrecisionKernels kernels = {
+    Float16ToFloatNEON,
+    FloatToFloat16NEON,
+    BFloat16ToFloatNEON,
+    FloatToBFloat16NEON
+  };
+  return &kernels;
+}
+
+
+const TypeCastKernels *CastKernelsNEON() {
+  static const TypeCastKernels kernels = {
+    Int16ToUInt8NEON,
+    UInt16ToUInt8NEON,
+    Int32ToUInt8NEON,
+    FloatToUInt8NEON,
+    DoubleToUInt8NEON,
+    UInt8ToFloatNEON,
+    Int16ToFloatNEON,
+    UInt16ToFloatNEON,
+    Int32ToFloatNEON,
+    DoubleToFloatNEON
+  };
+  return &kernels;
+}
+
+
+const ReductionKernels *ReduceKernelsNEON() {
+  static const ReductionKernels kernels = {
+    StatisticsUInt8NEON,
+    StatisticsFloatNEON
+  };
+  return &kernels;
+}
+
+#else  // VIREN2D_SIMD_NEON
+
+template <>
+const ConversionKernels<uint8_t> *KernelsNEON<uint8_t>() {
+  return nullptr;
+}
+
+
+template <>
+const ConversionKernels<float> *KernelsNEON<float>() {
+  return nullptr;
+}
+
+
+const HalfPrecisionKernels *HalfKernelsNEON() {
+  return nullptr;
+}
+
+
+const TypeCastKernels *CastKernelsNEON() {
+  return nullptr;
+}
+
+
+const ReductionKernels *ReduceKernelsNEON() {
+  return nullptr;
+}
+#endif  // VIREN2D_SIMD_NEON
+
+}  // namespace simd
+}  // namespace helpers
+}  // namespace viren2d
@@ -0,0 +1,3428 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <helpers/simd_kernels.h>
+#include <helpers/color_conversion.h>
+
+#if defined(__x86_64__) || defined(__i386__) \
+    || defined(_M_X64) || defined(_M_IX86)
+#define VIREN2D_SIMD_X86
+#include <immintrin.h>
+#endif
+
+// GCC & Clang only allow intrinsics of instruction sets which are enabled
+// for the surrounding function. We enable them per function (instead of
+// compiling the whole library for a specific CPU), because the kernels
+// are selected at runtime. MSVC doesn't require this.
+#if defined(__GNUC__) || defined(__clang__)
+#define VIREN2D_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define VIREN2D_TARGET_AVX2 __attribute__((target("avx2")))
+#define VIREN2D_TARGET_AVX2_F16C __attribute__((target("avx2,f16c")))
+#else
+#define VIREN2D_TARGET_SSE41
+#define VIREN2D_TARGET_AVX2
+#define VIREN2D_TARGET_AVX2_F16C
+#endif
+
+
+namespace viren2d {
+namespace helpers {
+namespace simd {
+#ifdef VIREN2D_SIMD_X86
+namespace {
+// Luminance weights, see `CvtHelperRGB2Gray`. To obtain the exact same
+// results as the scalar implementation, we also compute the weighted sum
+// in double precision (and in the same order).
+constexpr double kWeightRed = 0.2989;
+constexpr double kWeightGreen = 0.5870;
+constexpr double kWeightBlue = 0.1141;
+
+
+inline const ConversionKernels<uint8_t> &ScalarUInt8() {
+  return KernelsScalar<uint8_t>();
+}
+
+
+inline const ConversionKernels<float> &ScalarFloat() {
+  return KernelsScalar<float>();
+}
+
+
+//---------------------------------------------------- SSE4.1 uint8
+VIREN2D_TARGET_SSE41
+void RGB2RGBAUInt8SSE41(const uint8_t *src, uint8_t *dst, int64_t num_pixels) {
+  const __m128i shuffle = _mm_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i alpha = _mm_setr_epi8(
+        0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+  int64_t i = 0;
+  // Each load reads 16 bytes, but only 4 pixels (12 bytes) are converted.
+  for (; i + 6 <= num_pixels; i += 4) {
+    const __m128i px = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src + 3 * i));
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst + 4 * i),
+          _mm_or_si128(_mm_shuffle_epi8(px, shuffle), alpha));
+  }
+  ScalarUInt8().rgb2rgba(src + 3 * i, dst + 4 * i, num_pixels - i);
+}
+
+
+VIREN2D_TARGET_SSE41
+void RGBA2RGBUInt8SSE41(const uint8_t *src, uint8_t *dst, int64_t num_pixels) {
+  const __m128i shuffle = _mm_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  int64_t i = 0;
+  // Each store writes 16 bytes, i.e. 4 bytes beyond the 4 converted
+  // pixels. These will be overwritten by the next iteration.
+  for (; i + 6 <= num_pixels; i += 4) {
+    const __m128i px = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src + 4 * i));
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst + 3 * i),
+          _mm_shuffle_epi8(px, shuffle));
+  }
+  ScalarUInt8().rgba2rgb(src + 4 * i, dst + 3 * i, num_pixels - i);
+}
+
+
+VIREN2D_TARGET_SSE41
+void Gray2RGBUInt8SSE41(const uint8_t *src, uint8_t *dst, int64_t num_pixels) {
+  const __m128i shuffle0 = _mm_setr_epi8(
+        0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+  const __m128i shuffle1 = _mm_setr_epi8(
+        5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+  const __m128i shuffle2 = _mm_setr_epi8(
+        10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+  int64_t i = 0;
+  for (; i + 16 <= num_pixels; i += 16) {
+    const __m128i gray = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src + i));
+    __m128i *out = reinterpret_cast<__m128i *>(dst + 3 * i);
+    _mm_storeu_si128(out, _mm_shuffle_epi8(gray, shuffle0));
+    _mm_storeu_si128(out + 1, _mm_shuffle_epi8(gray, shuffle1));
+    _mm_storeu_si128(out + 2, _mm_shuffle_epi8(gray, shuffle2));
+  }
+  ScalarUInt8().gray2rgb(src + i, dst + 3 * i, num_pixels - i);
+}
+
+
+VIREN2D_TARGET_SSE41
+void Gray2RGBAUInt8SSE41(const uint8_t *src, uint8_t *dst, int64_t num_pixels) {
+  const __m128i alpha = _mm_setr_epi8(
+        0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+  const __m128i shuffle0 = _mm_setr_epi8(
+        0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1);
+  const __m128i step = _mm_setr_epi8(
+        4, 4, 4, 0, 4, 4, 4, 0, 4, 4, 4, 0, 4, 4, 4, 0);
+  const __m128i shuffle1 = _mm_add_epi8(shuffle0, step);
+  const __m128i shuffle2 = _mm_add_epi8(shuffle1, step);
+  const __m128i shuffle3 = _mm_add_epi8(shuffle2, step);
+  int64_t i = 0;
+  for (; i + 16 <= num_pixels; i += 16) {
+    const __m128i gray = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src + i));
+    __m128i *out = reinterpret_cast<__m128i *>(dst + 4 * i);
+    _mm_storeu_si128(out, _mm_or_si128(_mm_shuffle_epi8(gray, shuffle0), alpha));
+    _mm_storeu_si128(out + 1, _mm_or_si128(_mm_shuffle_epi8(gray, shuffle1), alpha));
+    _mm_storeu_si128(out + 2, _mm_or_si128(_mm_shuffle_epi8(gray, shuffle2), alpha));
+    _mm_storeu_si128(out + 3, _mm_or_si128(_mm_shuffle_epi8(gray, shuffle3), alpha));
+  }
+  ScalarUInt8().gray2rgba(src + i, dst + 4 * i, num_pixels - i);
+}
+
+
+/// Returns the byte shuffle mask which swaps the channels of
+/// all pixels within a 16 byte register.
+inline void SwapChannelsMask(
+    int8_t *mask, int element_size, int channels, int ch1, int ch2) {
+  for (int b = 0; b < 16; ++b) {
+    mask[b] = static_cast<int8_t>(b);
+  }
+
+  const int pixel_bytes = channels * element_size;
+  for (int px = 0; (px + 1) * pixel_bytes <= 16; ++px) {
+    for (int b = 0; b < element_size; ++b) {
+      const int idx1 = px * pixel_bytes + ch1 * element_size + b;
+      const int idx2 = px * pixel_bytes + ch2 * element_size + b;
+      mask[idx1] = static_cast<int8_t>(idx2);
+      mask[idx2] = static_cast<int8_t>(idx1);
+    }
+  }
+}
+
+
+VIREN2D_TARGET_SSE41
+void SwapChannelsUInt8SSE41(
+    uint8_t *data, int64_t num_pixels, int channels, int ch1, int ch2) {
+  int64_t i = 0;
+  if ((channels == 3) || (channels == 4)) {
+    int8_t mask[16];
+    SwapChannelsMask(mask, 1, channels, ch1, ch2);
+    const __m128i shuffle = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(mask));
+    // A register holds 4 RGBA or 5 RGB pixels (+1 unchanged byte).
+    const int64_t step = (channels == 4) ? 4 : 5;
+    const int64_t min_remaining = (channels == 4) ? 4 : 6;
+    for (; i + min_remaining <= num_pixels; i += step) {
+      __m128i *ptr = reinterpret_cast<__m128i *>(data + channels * i);
+      _mm_storeu_si128(
+            ptr, _mm_shuffle_epi8(_mm_loadu_si128(ptr), shuffle));
+    }
+  }
+  ScalarUInt8().swap_channels(
+        data + channels * i, num_pixels - i, channels, ch1, ch2);
+}
+
+
+/// Extracts the red, green and blue values of 4 pixels (which must
+/// be within the first 16 bytes of `px`) as 32-bit integers.
+VIREN2D_TARGET_SSE41 inline
+void DeinterleaveRGBUInt8(
+    __m128i px, const __m128i *shuffles,
+    __m128i &red, __m128i &green, __m128i &blue) {
+  red = _mm_cvtepu8_epi32(_mm_shuffle_epi8(px, shuffles[0]));
+  green = _mm_cvtepu8_epi32(_mm_shuffle_epi8(px, shuffles[1]));
+  blue = _mm_cvtepu8_epi32(_mm_shuffle_epi8(px, shuffles[2]));
+}
+
+
+/// Computes the shuffle masks for `DeinterleaveRGBUInt8` and
+/// the alpha channel.
+VIREN2D_TARGET_SSE41 inline
+void RGBx2GrayShuffles(
+    __m128i *shuffles, int src_channels, bool is_bgr_format) {
+  const int channel_order[4] = {
+    is_bgr_format ? 2 : 0, 1, is_bgr_format ? 0 : 2, 3};
+  for (int k = 0; k < 4; ++k) {
+    int8_t mask[16];
+    for (int b = 0; b < 16; ++b) {
+      mask[b] = -1;
+    }
+    if ((k < 3) || (src_channels == 4)) {
+      for (int px = 0; px < 4; ++px) {
+        if (k < 3) {
+          // Pack the values of the 4 pixels into the lowest bytes:
+          mask[px] = static_cast<int8_t>(px * src_channels + channel_order[k]);
+        } else {
+          // Alpha is moved to the 4th byte of each output pixel:
+          mask[4 * px + 3] = static_cast<int8_t>(px * src_channels + 3);
+        }
+      }
+    }
+    shuffles[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask));
+  }
+}
+
+
+/// Stores the luminance of 4 pixels (given as 32-bit integers).
+VIREN2D_TARGET_SSE41 inline
+void StoreGrayUInt8(
+    __m128i luminance, __m128i px, const __m128i *shuffles,
+    int src_channels, int dst_channels, uint8_t *dst) {
+  const __m128i gray = _mm_packus_epi16(
+        _mm_packus_epi32(luminance, luminance), _mm_setzero_si128());
+  if (dst_channels == 1) {
+    const int32_t val = _mm_cvtsi128_si32(gray);
+    std::memcpy(dst, &val, 4);
+  } else if (dst_channels == 3) {
+    const __m128i rgb = _mm_shuffle_epi8(gray, _mm_setr_epi8(
+          0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, -1, -1, -1, -1));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst), rgb);
+    const int32_t val = _mm_cvtsi128_si32(_mm_srli_si128(rgb, 8));
+    std::memcpy(dst + 8, &val, 4);
+  } else {
+    const __m128i rgb = _mm_shuffle_epi8(gray, _mm_setr_epi8(
+          0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1));
+    const __m128i alpha = (src_channels == 4)
+        ? _mm_shuffle_epi8(px, shuffles[3])
+        : _mm_setr_epi8(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst), _mm_or_si128(rgb, alpha));
+  }
+}
+
+
+/// Computes the (truncated) luminance of 4 pixels, given as 32-bit integers.
+VIREN2D_TARGET_SSE41 inline
+__m128i LuminanceUInt8SSE41(__m128i red, __m128i green, __m128i blue) {
+  const __m128d wr = _mm_set1_pd(kWeightRed);
+  const __m128d wg = _mm_set1_pd(kWeightGreen);
+  const __m128d wb = _mm_set1_pd(kWeightBlue);
+  // Lower & upper 2 pixels:
+  const __m128d lum_lo = _mm_add_pd(
+        _mm_add_pd(
+          _mm_mul_pd(wr, _mm_cvtepi32_pd(red)),
+          _mm_mul_pd(wg, _mm_cvtepi32_pd(green))),
+        _mm_mul_pd(wb, _mm_cvtepi32_pd(blue)));
+  const __m128d lum_hi = _mm_add_pd(
+        _mm_add_pd(
+          _mm_mul_pd(wr, _mm_cvtepi32_pd(_mm_srli_si128(red, 8))),
+          _mm_mul_pd(wg, _mm_cvtepi32_pd(_mm_srli_si128(green, 8)))),
+        _mm_mul_pd(wb, _mm_cvtepi32_pd(_mm_srli_si128(blue, 8))));
+  return _mm_unpacklo_epi64(
+        _mm_cvttpd_epi32(lum_lo), _mm_cvttpd_epi32(lum_hi));
+}
+
+
+VIREN2D_TARGET_SSE41
+void RGBx2GrayUInt8SSE41(
+    const uint8_t *src, uint8_t *dst, int64_t num_pixels,
+    int src_channels, int dst_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if (((src_channels == 3) || (src_channels == 4))
+      && (dst_channels != 2)) {
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, src_channels, is_bgr_format);
+    // Loads read 16 bytes, so we need at least 6 remaining RGB pixels
+    const int64_t min_remaining = (src_channels == 4) ? 4 : 6;
+    for (; i + min_remaining <= num_pixels; i += 4) {
+      const __m128i px = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + src_channels * i));
+      __m128i red, green, blue;
+      DeinterleaveRGBUInt8(px, shuffles, red, green, blue);
+
+      StoreGrayUInt8(
+            LuminanceUInt8SSE41(red, green, blue), px, shuffles,
+            src_channels, dst_channels, dst + dst_channels * i);
+    }
+  }
+  ScalarUInt8().rgbx2gray(
+        src + src_channels * i, dst + dst_channels * i, num_pixels - i,
+        src_channels, dst_channels, is_bgr_format);
+}
+
+
+/// Sets the HSV thresholds (as 32-bit integers) in the order of
+/// the `HSVRange` members.
+VIREN2D_TARGET_SSE41 inline
+void HSVBoundsSSE41(const HSVRange &range, __m128i *bounds) {
+  bounds[0] = _mm_set1_epi32(range.hue_min);
+  bounds[1] = _mm_set1_epi32(range.hue_max);
+  bounds[2] = _mm_set1_epi32(range.saturation_min);
+  bounds[3] = _mm_set1_epi32(range.saturation_max);
+  bounds[4] = _mm_set1_epi32(range.value_min);
+  bounds[5] = _mm_set1_epi32(range.value_max);
+}
+
+
+/// Computes the uint8 HSV representation of 4 pixels (given as 32-bit
+/// integers). This uses the same sequence of float operations as
+/// `CvtHelperRGB2HSVUInt8`, thus the results are identical.
+VIREN2D_TARGET_SSE41 inline
+void HSVUInt8SSE41(__m128i red, __m128i green, __m128i blue, __m128i *hsv) {
+  // Inputs are integers, so the epsilon checks of the scalar
+  // implementation reduce to max == 0 or max == min.
+  const __m128i max_int = _mm_max_epi32(red, _mm_max_epi32(green, blue));
+  const __m128i min_int = _mm_min_epi32(red, _mm_min_epi32(green, blue));
+  const __m128 achromatic = _mm_castsi128_ps(_mm_or_si128(
+        _mm_cmpeq_epi32(max_int, _mm_setzero_si128()),
+        _mm_cmpeq_epi32(max_int, min_int)));
+
+  const __m128 scale = _mm_set1_ps(255.0f);
+  const __m128 r = _mm_div_ps(_mm_cvtepi32_ps(red), scale);
+  const __m128 g = _mm_div_ps(_mm_cvtepi32_ps(green), scale);
+  const __m128 b = _mm_div_ps(_mm_cvtepi32_ps(blue), scale);
+  const __m128 max_val = _mm_max_ps(r, _mm_max_ps(g, b));
+  const __m128 delta = _mm_sub_ps(max_val, _mm_min_ps(r, _mm_min_ps(g, b)));
+
+  // Ties are resolved in favor of red, then green (see `MaxValueIndex`).
+  // Divisions by zero only occur in achromatic lanes, which are masked.
+  const __m128 sixty = _mm_set1_ps(60.0f);
+  const __m128 max_is_red = _mm_and_ps(_mm_cmpge_ps(r, g), _mm_cmpge_ps(r, b));
+  const __m128 max_is_green = _mm_cmpge_ps(g, b);
+  const __m128 hue_red = _mm_mul_ps(sixty, _mm_div_ps(_mm_sub_ps(g, b), delta));
+  const __m128 hue_green = _mm_add_ps(
+        _mm_mul_ps(sixty, _mm_div_ps(_mm_sub_ps(b, r), delta)),
+        _mm_set1_ps(120.0f));
+  const __m128 hue_blue = _mm_add_ps(
+        _mm_mul_ps(sixty, _mm_div_ps(_mm_sub_ps(r, g), delta)),
+        _mm_set1_ps(240.0f));
+  __m128 hue = _mm_blendv_ps(
+        _mm_blendv_ps(hue_blue, hue_green, max_is_green),
+        hue_red, max_is_red);
+  hue = _mm_andnot_ps(achromatic, hue);
+  hue = _mm_add_ps(hue, _mm_and_ps(
+          _mm_cmplt_ps(hue, _mm_setzero_ps()), _mm_set1_ps(360.0f)));
+  const __m128 sat = _mm_andnot_ps(achromatic, _mm_div_ps(delta, max_val));
+
+  hsv[0] = _mm_cvttps_epi32(_mm_div_ps(hue, _mm_set1_ps(2.0f)));
+  hsv[1] = _mm_cvttps_epi32(_mm_mul_ps(scale, sat));
+  hsv[2] = _mm_cvttps_epi32(_mm_mul_ps(scale, max_val));
+}
+
+
+/// Returns all-ones lanes for the pixels (given as 32-bit integers)
+/// whose HSV representation is outside of the bounds.
+VIREN2D_TARGET_SSE41 inline
+__m128i OutsideHSVRangeSSE41(
+    __m128i red, __m128i green, __m128i blue, const __m128i *bounds) {
+  __m128i hsv[3];
+  HSVUInt8SSE41(red, green, blue, hsv);
+  __m128i outside = _mm_setzero_si128();
+  for (int k = 0; k < 3; ++k) {
+    outside = _mm_or_si128(outside, _mm_or_si128(
+          _mm_cmpgt_epi32(bounds[2 * k], hsv[k]),
+          _mm_cmpgt_epi32(hsv[k], bounds[2 * k + 1])));
+  }
+  return outside;
+}
+
+
+/// Stores the mask values of 4 pixels, given as all-ones
+/// (outside of the range) or zero 32-bit lanes.
+VIREN2D_TARGET_SSE41 inline
+void StoreHSVMaskUInt8(__m128i outside, uint8_t *mask) {
+  const __m128i inside = _mm_xor_si128(outside, _mm_set1_epi32(-1));
+  const __m128i bytes = _mm_packs_epi16(
+        _mm_packs_epi32(inside, inside), _mm_setzero_si128());
+  const int32_t val = _mm_cvtsi128_si32(bytes);
+  std::memcpy(mask, &val, 4);
+}
+
+
+/// Stores 4 pixels, where the color channels of pixels outside of the
+/// HSV range are replaced by their luminance (32-bit integers).
+VIREN2D_TARGET_SSE41 inline
+void StoreColorPopUInt8(
+    __m128i px, __m128i outside, __m128i luminance,
+    int channels, uint8_t *dst) {
+  const __m128i gray = _mm_packus_epi16(
+        _mm_packus_epi32(luminance, luminance), _mm_setzero_si128());
+  if (channels == 3) {
+    const __m128i gray_px = _mm_shuffle_epi8(gray, _mm_setr_epi8(
+          0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, -1, -1, -1, -1));
+    const __m128i select = _mm_shuffle_epi8(outside, _mm_setr_epi8(
+          0, 0, 0, 4, 4, 4, 8, 8, 8, 12, 12, 12, -1, -1, -1, -1));
+    const __m128i pop = _mm_blendv_epi8(px, gray_px, select);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst), pop);
+    const int32_t val = _mm_cvtsi128_si32(_mm_srli_si128(pop, 8));
+    std::memcpy(dst + 8, &val, 4);
+  } else {
+    // Each 32-bit lane holds exactly one RGBA pixel
+    const __m128i alpha = _mm_setr_epi8(
+          0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+    const __m128i gray_px = _mm_or_si128(
+          _mm_shuffle_epi8(gray, _mm_setr_epi8(
+            0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1)),
+          _mm_and_si128(px, alpha));
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst),
+          _mm_blendv_epi8(px, gray_px, outside));
+  }
+}
+
+
+VIREN2D_TARGET_SSE41
+void MaskHSVRangeUInt8SSE41(
+    const uint8_t *src, uint8_t *mask, int64_t num_pixels,
+    int src_channels, bool is_bgr_format, const HSVRange &range) {
+  int64_t i = 0;
+  if ((src_channels == 3) || (src_channels == 4)) {
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, src_channels, is_bgr_format);
+    __m128i bounds[6];
+    HSVBoundsSSE41(range, bounds);
+    const int64_t min_remaining = (src_channels == 4) ? 4 : 6;
+    for (; i + min_remaining <= num_pixels; i += 4) {
+      const __m128i px = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + src_channels * i));
+      __m128i red, green, blue;
+      DeinterleaveRGBUInt8(px, shuffles, red, green, blue);
+      StoreHSVMaskUInt8(
+            OutsideHSVRangeSSE41(red, green, blue, bounds), mask + i);
+    }
+  }
+  ScalarUInt8().mask_hsv_range(
+        src + src_channels * i, mask + i, num_pixels - i,
+        src_channels, is_bgr_format, range);
+}
+
+
+VIREN2D_TARGET_SSE41
+void ColorPopUInt8SSE41(
+    const uint8_t *src, uint8_t *dst, int64_t num_pixels,
+    int channels, bool is_bgr_format, const HSVRange &range) {
+  int64_t i = 0;
+  if ((channels == 3) || (channels == 4)) {
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, channels, is_bgr_format);
+    __m128i bounds[6];
+    HSVBoundsSSE41(range, bounds);
+    const int64_t min_remaining = (channels == 4) ? 4 : 6;
+    for (; i + min_remaining <= num_pixels; i += 4) {
+      const __m128i px = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + channels * i));
+      __m128i red, green, blue;
+      DeinterleaveRGBUInt8(px, shuffles, red, green, blue);
+      StoreColorPopUInt8(
+            px, OutsideHSVRangeSSE41(red, green, blue, bounds),
+            LuminanceUInt8SSE41(red, green, blue), channels,
+            dst + channels * i);
+    }
+  }
+  ScalarUInt8().color_pop(
+        src + channels * i, dst + channels * i, num_pixels - i,
+        channels, is_bgr_format, range);
+}
+
+
+/// Stores 4 pixels with 3 or 4 channels, where each channel is
+/// given as 32-bit integers in [0, 255].
+VIREN2D_TARGET_SSE41 inline
+void StoreInterleavedUInt8(
+    __m128i ch0, __m128i ch1, __m128i ch2, __m128i ch3,
+    int channels, uint8_t *dst) {
+  // Bytes are ordered by channel, i.e. 4 bytes of ch0, then ch1, etc.
+  const __m128i planar = _mm_packus_epi16(
+        _mm_packus_epi32(ch0, ch1), _mm_packus_epi32(ch2, ch3));
+  if (channels == 3) {
+    const __m128i px = _mm_shuffle_epi8(planar, _mm_setr_epi8(
+          0, 4, 8, 1, 5, 9, 2, 6, 10, 3, 7, 11, -1, -1, -1, -1));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst), px);
+    const int32_t val = _mm_cvtsi128_si32(_mm_srli_si128(px, 8));
+    std::memcpy(dst + 8, &val, 4);
+  } else {
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst),
+          _mm_shuffle_epi8(planar, _mm_setr_epi8(
+            0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15)));
+  }
+}
+
+
+VIREN2D_TARGET_SSE41
+void RGBx2HSVUInt8SSE41(
+    const uint8_t *src, uint8_t *dst, int64_t num_pixels,
+    int src_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((src_channels == 3) || (src_channels == 4)) {
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, src_channels, is_bgr_format);
+    const int64_t min_remaining = (src_channels == 4) ? 4 : 6;
+    for (; i + min_remaining <= num_pixels; i += 4) {
+      const __m128i px = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + src_channels * i));
+      __m128i red, green, blue, hsv[3];
+      DeinterleaveRGBUInt8(px, shuffles, red, green, blue);
+      HSVUInt8SSE41(red, green, blue, hsv);
+      StoreInterleavedUInt8(
+            hsv[0], hsv[1], hsv[2], _mm_setzero_si128(), 3, dst + 3 * i);
+    }
+  }
+  ScalarUInt8().rgbx2hsv(
+        src + src_channels * i, dst + 3 * i, num_pixels - i,
+        src_channels, is_bgr_format);
+}
+
+
+/// Computes the RGB values (in [0, 1]) of 4 HSV pixels, using the same
+/// sequence of float operations as `CvtHelperHSV2RGB`.
+VIREN2D_TARGET_SSE41 inline
+void RGBFromHSVSSE41(
+    __m128 hue, __m128 sat, __m128 val, __m128 *rgb) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 hue60 = _mm_div_ps(hue, _mm_set1_ps(60.0f));
+  const __m128i sector = _mm_cvttps_epi32(hue60);
+  const __m128 rem = _mm_sub_ps(hue60, _mm_cvtepi32_ps(sector));
+  // Hue of uint8 inputs is at most 510, i.e. sector <= 8
+  const __m128i bin = _mm_sub_epi32(sector, _mm_and_si128(
+        _mm_cmpgt_epi32(sector, _mm_set1_epi32(5)), _mm_set1_epi32(6)));
+
+  const __m128 p = _mm_mul_ps(val, _mm_sub_ps(one, sat));
+  const __m128 q = _mm_mul_ps(val, _mm_sub_ps(one, _mm_mul_ps(sat, rem)));
+  const __m128 t = _mm_mul_ps(
+        val, _mm_sub_ps(one, _mm_mul_ps(sat, _mm_sub_ps(one, rem))));
+
+  __m128 is_bin[6];
+  for (int k = 0; k < 6; ++k) {
+    is_bin[k] = _mm_castsi128_ps(_mm_cmpeq_epi32(bin, _mm_set1_epi32(k)));
+  }
+  // Per bin: r = {v, q, p, p, t, v}, g = {t, v, v, q, p, p},
+  // b = {p, p, t, v, v, q}
+  rgb[0] = _mm_blendv_ps(
+        _mm_blendv_ps(
+          _mm_blendv_ps(val, q, is_bin[1]),
+          p, _mm_or_ps(is_bin[2], is_bin[3])),
+        t, is_bin[4]);
+  rgb[1] = _mm_blendv_ps(
+        _mm_blendv_ps(
+          _mm_blendv_ps(p, t, is_bin[0]),
+          val, _mm_or_ps(is_bin[1], is_bin[2])),
+        q, is_bin[3]);
+  rgb[2] = _mm_blendv_ps(
+        _mm_blendv_ps(
+          _mm_blendv_ps(p, t, is_bin[2]),
+          val, _mm_or_ps(is_bin[3], is_bin[4])),
+        q, is_bin[5]);
+}
+
+
+VIREN2D_TARGET_SSE41
+void HSV2RGBxUInt8SSE41(
+    const uint8_t *src, uint8_t *dst, int64_t num_pixels,
+    int dst_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((dst_channels == 3) || (dst_channels == 4)) {
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, 3, false);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128i alpha = _mm_set1_epi32(255);
+    for (; i + 6 <= num_pixels; i += 4) {
+      const __m128i px = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + 3 * i));
+      __m128i h, s, v;
+      DeinterleaveRGBUInt8(px, shuffles, h, s, v);
+      __m128 rgb[3];
+      RGBFromHSVSSE41(
+            _mm_mul_ps(_mm_cvtepi32_ps(h), _mm_set1_ps(2.0f)),
+            _mm_div_ps(_mm_cvtepi32_ps(s), scale),
+            _mm_div_ps(_mm_cvtepi32_ps(v), scale), rgb);
+      const __m128i red = _mm_cvttps_epi32(_mm_mul_ps(scale, rgb[0]));
+      const __m128i green = _mm_cvttps_epi32(_mm_mul_ps(scale, rgb[1]));
+      const __m128i blue = _mm_cvttps_epi32(_mm_mul_ps(scale, rgb[2]));
+      StoreInterleavedUInt8(
+            is_bgr_format ? blue : red, green, is_bgr_format ? red : blue,
+            alpha, dst_channels, dst + dst_channels * i);
+    }
+  }
+  ScalarUInt8().hsv2rgbx(
+        src + 3 * i, dst + dst_channels * i, num_pixels - i,
+        dst_channels, is_bgr_format);
+}
+
+
+/// Looks up 4 values of a float table.
+VIREN2D_TARGET_SSE41 inline
+__m128 GatherSSE41(const float *lut, __m128i idx) {
+  alignas(16) int32_t indices[4];
+  _mm_store_si128(reinterpret_cast<__m128i *>(indices), idx);
+  return _mm_setr_ps(
+        lut[indices[0]], lut[indices[1]], lut[indices[2]], lut[indices[3]]);
+}
+
+
+/// Vectorized `ClampUnit`.
+VIREN2D_TARGET_SSE41 inline
+__m128 ClampUnitSSE41(__m128 x) {
+  return _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+}
+
+
+/// Vectorized `RoundSaturateUInt8`, returns 32-bit integers.
+VIREN2D_TARGET_SSE41 inline
+__m128i RoundSaturateUInt8SSE41(__m128 x) {
+  x = _mm_floor_ps(_mm_add_ps(x, _mm_set1_ps(0.5f)));
+  x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+  return _mm_cvttps_epi32(x);
+}
+
+
+/// Vectorized `InterpolateGammaLUT`.
+VIREN2D_TARGET_SSE41 inline
+__m128 InterpolateGammaLUTSSE41(const float *lut, __m128 x) {
+  const __m128 pos = _mm_mul_ps(
+        x, _mm_set1_ps(static_cast<float>(kGammaLUTSize)));
+  const __m128i idx = _mm_min_epi32(
+        _mm_cvttps_epi32(pos), _mm_set1_epi32(kGammaLUTSize - 1));
+  const __m128 frac = _mm_sub_ps(pos, _mm_cvtepi32_ps(idx));
+  const __m128 lower = GatherSSE41(lut, idx);
+  const __m128 upper = GatherSSE41(lut + 1, idx);
+  return _mm_add_ps(lower, _mm_mul_ps(frac, _mm_sub_ps(upper, lower)));
+}
+
+
+/// Vectorized `LabF` (including `CubeRoot`).
+VIREN2D_TARGET_SSE41 inline
+__m128 LabFSSE41(__m128 t) {
+  const __m128i bits = _mm_add_epi32(
+        _mm_cvttps_epi32(_mm_mul_ps(
+          _mm_cvtepi32_ps(_mm_castps_si128(t)), _mm_set1_ps(1.0f / 3.0f))),
+        _mm_set1_epi32(709921077));
+  __m128 y = _mm_castsi128_ps(bits);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 three = _mm_set1_ps(3.0f);
+  for (int iter = 0; iter < 3; ++iter) {
+    y = _mm_div_ps(
+          _mm_add_ps(_mm_mul_ps(two, y), _mm_div_ps(t, _mm_mul_ps(y, y))),
+          three);
+  }
+  const __m128 linear = _mm_div_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kLabKappa), t), _mm_set1_ps(16.0f)),
+        _mm_set1_ps(116.0f));
+  return _mm_blendv_ps(
+        linear, y, _mm_cmpgt_ps(t, _mm_set1_ps(kLabEpsilon)));
+}
+
+
+/// Vectorized `LabFInv`.
+VIREN2D_TARGET_SSE41 inline
+__m128 LabFInvSSE41(__m128 f) {
+  const __m128 f3 = _mm_mul_ps(_mm_mul_ps(f, f), f);
+  const __m128 linear = _mm_div_ps(
+        _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(116.0f), f), _mm_set1_ps(16.0f)),
+        _mm_set1_ps(kLabKappa));
+  return _mm_blendv_ps(
+        linear, f3, _mm_cmpgt_ps(f3, _mm_set1_ps(kLabEpsilon)));
+}
+
+
+/// Computes `m * (c0, c1, c2)` for the given row of a 3x3 matrix.
+VIREN2D_TARGET_SSE41 inline
+__m128 MatrixRowSSE41(const float *row, __m128 c0, __m128 c1, __m128 c2) {
+  return _mm_add_ps(
+        _mm_add_ps(
+          _mm_mul_ps(_mm_set1_ps(row[0]), c0),
+          _mm_mul_ps(_mm_set1_ps(row[1]), c1)),
+        _mm_mul_ps(_mm_set1_ps(row[2]), c2));
+}
+
+
+/// Vectorized `CvtHelperLinearRGB2Lab`.
+VIREN2D_TARGET_SSE41 inline
+void LinearRGB2LabSSE41(__m128 red, __m128 green, __m128 blue, __m128 *lab) {
+  const __m128 fx = LabFSSE41(MatrixRowSSE41(kRGB2XYZ, red, green, blue));
+  const __m128 fy = LabFSSE41(MatrixRowSSE41(kRGB2XYZ + 3, red, green, blue));
+  const __m128 fz = LabFSSE41(MatrixRowSSE41(kRGB2XYZ + 6, red, green, blue));
+  lab[0] = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(116.0f), fy), _mm_set1_ps(16.0f));
+  lab[1] = _mm_mul_ps(_mm_set1_ps(500.0f), _mm_sub_ps(fx, fy));
+  lab[2] = _mm_mul_ps(_mm_set1_ps(200.0f), _mm_sub_ps(fy, fz));
+}
+
+
+/// Vectorized `CvtHelperLab2LinearRGB`.
+VIREN2D_TARGET_SSE41 inline
+void Lab2LinearRGBSSE41(__m128 l, __m128 a, __m128 b, __m128 *rgb) {
+  const __m128 fy = _mm_div_ps(
+        _mm_add_ps(l, _mm_set1_ps(16.0f)), _mm_set1_ps(116.0f));
+  const __m128 fx = _mm_add_ps(fy, _mm_div_ps(a, _mm_set1_ps(500.0f)));
+  const __m128 fz = _mm_sub_ps(fy, _mm_div_ps(b, _mm_set1_ps(200.0f)));
+  const __m128 x = LabFInvSSE41(fx);
+  const __m128 y = LabFInvSSE41(fy);
+  const __m128 z = LabFInvSSE41(fz);
+  for (int k = 0; k < 3; ++k) {
+    rgb[k] = MatrixRowSSE41(kXYZ2RGB + 3 * k, x, y, z);
+  }
+}
+
+
+VIREN2D_TARGET_SSE41
+void RGBx2LabUInt8SSE41(
+    const uint8_t *src, uint8_t *dst, int64_t num_pixels,
+    int src_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((src_channels == 3) || (src_channels == 4)) {
+    const float *linearize = SRGBGamma().linearize_uint8;
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, src_channels, is_bgr_format);
+    const int64_t min_remaining = (src_channels == 4) ? 4 : 6;
+    for (; i + min_remaining <= num_pixels; i += 4) {
+      const __m128i px = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + src_channels * i));
+      __m128i red, green, blue;
+      DeinterleaveRGBUInt8(px, shuffles, red, green, blue);
+      __m128 lab[3];
+      LinearRGB2LabSSE41(
+            GatherSSE41(linearize, red), GatherSSE41(linearize, green),
+            GatherSSE41(linearize, blue), lab);
+      const __m128 offset = _mm_set1_ps(kLabABOffset);
+      StoreInterleavedUInt8(
+            RoundSaturateUInt8SSE41(
+              _mm_mul_ps(_mm_set1_ps(kLabLToUInt8), lab[0])),
+            RoundSaturateUInt8SSE41(_mm_add_ps(lab[1], offset)),
+            RoundSaturateUInt8SSE41(_mm_add_ps(lab[2], offset)),
+            _mm_setzero_si128(), 3, dst + 3 * i);
+    }
+  }
+  ScalarUInt8().rgbx2lab(
+        src + src_channels * i, dst + 3 * i, num_pixels - i,
+        src_channels, is_bgr_format);
+}
+
+
+VIREN2D_TARGET_SSE41
+void Lab2RGBxUInt8SSE41(
+    const uint8_t *src, uint8_t *dst, int64_t num_pixels,
+    int dst_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((dst_channels == 3) || (dst_channels == 4)) {
+    const float *compress = SRGBGamma().compress;
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, 3, false);
+    const __m128 offset = _mm_set1_ps(kLabABOffset);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    for (; i + 6 <= num_pixels; i += 4) {
+      const __m128i px = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + 3 * i));
+      __m128i l, a, b;
+      DeinterleaveRGBUInt8(px, shuffles, l, a, b);
+      __m128 rgb[3];
+      Lab2LinearRGBSSE41(
+            _mm_mul_ps(_mm_set1_ps(kLabLFromUInt8), _mm_cvtepi32_ps(l)),
+            _mm_sub_ps(_mm_cvtepi32_ps(a), offset),
+            _mm_sub_ps(_mm_cvtepi32_ps(b), offset), rgb);
+      __m128i out[3];
+      for (int k = 0; k < 3; ++k) {
+        out[k] = RoundSaturateUInt8SSE41(_mm_mul_ps(
+              scale, InterpolateGammaLUTSSE41(
+                compress, ClampUnitSSE41(rgb[k]))));
+      }
+      StoreInterleavedUInt8(
+            out[is_bgr_format ? 2 : 0], out[1], out[is_bgr_format ? 0 : 2],
+            _mm_set1_epi32(255), dst_channels, dst + dst_channels * i);
+    }
+  }
+  ScalarUInt8().lab2rgbx(
+        src + 3 * i, dst + dst_channels * i, num_pixels - i,
+        dst_channels, is_bgr_format);
+}
+
+
+/// Sets up the per-byte bounds for the range mask of 16 single-channel
+/// pixels or 4 pixels with 4 channels. 3-channel pixels are expanded to
+/// 4 bytes by repeating the first channel, see `kExpandRGBUInt8`.
+void RangeBoundsUInt8(
+    const uint8_t *min_max, int channels, uint8_t *lower, uint8_t *upper) {
+  for (int b = 0; b < 16; ++b) {
+    int ch = (channels == 1) ? 0 : (b % 4);
+    if (ch >= channels) {
+      ch = 0;
+    }
+    lower[b] = min_max[2 * ch];
+    upper[b] = min_max[2 * ch + 1];
+  }
+}
+
+
+/// Shuffle to expand 4 packed RGB pixels into 4-byte lanes.
+VIREN2D_TARGET_SSE41 inline
+__m128i ExpandRGBShuffle() {
+  return _mm_setr_epi8(0, 1, 2, 0, 3, 4, 5, 3, 6, 7, 8, 6, 9, 10, 11, 9);
+}
+
+
+/// Returns 0xFF for each (unsigned) byte within [lower, upper].
+VIREN2D_TARGET_SSE41 inline
+__m128i WithinRangeUInt8SSE41(__m128i x, __m128i lower, __m128i upper) {
+  return _mm_and_si128(
+        _mm_cmpeq_epi8(_mm_max_epu8(x, lower), x),
+        _mm_cmpeq_epi8(_mm_min_epu8(x, upper), x));
+}
+
+
+VIREN2D_TARGET_SSE41
+void MaskRangeBitsUInt8SSE41(
+    const uint8_t *src, uint64_t *bits, int64_t num_pixels,
+    int channels, const uint8_t *min_max) {
+  int64_t i = 0;
+  if ((channels == 1) || (channels == 3) || (channels == 4)) {
+    alignas(16) uint8_t lower_bytes[16];
+    alignas(16) uint8_t upper_bytes[16];
+    RangeBoundsUInt8(min_max, channels, lower_bytes, upper_bytes);
+    const __m128i lower = _mm_load_si128(
+          reinterpret_cast<const __m128i *>(lower_bytes));
+    const __m128i upper = _mm_load_si128(
+          reinterpret_cast<const __m128i *>(upper_bytes));
+    const __m128i expand = ExpandRGBShuffle();
+    const __m128i all_set = _mm_set1_epi32(-1);
+    // The 3-channel loads read 4 bytes beyond the last pixel of a word
+    const int64_t overlap = (channels == 3) ? 2 : 0;
+    for (; i + 64 + overlap <= num_pixels; i += 64) {
+      uint64_t word = 0;
+      if (channels == 1) {
+        for (int k = 0; k < 4; ++k) {
+          const __m128i x = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(src + i + 16 * k));
+          const uint32_t within = static_cast<uint32_t>(_mm_movemask_epi8(
+                WithinRangeUInt8SSE41(x, lower, upper)));
+          word |= static_cast<uint64_t>(within) << (16 * k);
+        }
+      } else {
+        for (int k = 0; k < 16; ++k) {
+          __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+                src + channels * (i + 4 * k)));
+          if (channels == 3) {
+            x = _mm_shuffle_epi8(x, expand);
+          }
+          // A pixel is within range iff all 4 bytes are
+          const __m128i within = _mm_cmpeq_epi32(
+                WithinRangeUInt8SSE41(x, lower, upper), all_set);
+          word |= static_cast<uint64_t>(
+                _mm_movemask_ps(_mm_castsi128_ps(within))) << (4 * k);
+        }
+      }
+      bits[i / 64] = word;
+    }
+  }
+  ScalarUInt8().mask_range_bits(
+        src + channels * i, bits + i / 64, num_pixels - i, channels, min_max);
+}
+
+
+VIREN2D_TARGET_SSE41
+void PackBitsUInt8SSE41(
+    const uint8_t *src, uint64_t *bits, int64_t num_pixels, int channels) {
+  int64_t i = 0;
+  if (channels == 1) {
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 64 <= num_pixels; i += 64) {
+      uint64_t word = 0;
+      for (int k = 0; k < 4; ++k) {
+        const __m128i x = _mm_loadu_si128(
+              reinterpret_cast<const __m128i *>(src + i + 16 * k));
+        const uint32_t is_zero = static_cast<uint32_t>(
+              _mm_movemask_epi8(_mm_cmpeq_epi8(x, zero)));
+        word |= static_cast<uint64_t>(~is_zero & 0xFFFFu) << (16 * k);
+      }
+      bits[i / 64] = word;
+    }
+  }
+  ScalarUInt8().pack_bits(
+        src + channels * i, bits + i / 64, num_pixels - i, channels);
+}
+
+
+/// Fixed-point blend of 8 values which have been widened to 16 bit,
+/// see `BlendFixedPoint`. The intermediate sum is at most 65408, so the
+/// 16-bit wrap-around of the (signed) multiplication does not matter.
+VIREN2D_TARGET_SSE41 inline
+__m128i BlendUInt16x8SSE41(__m128i value1, __m128i value2, __m128i weight2) {
+  const __m128i weight1 = _mm_sub_epi16(_mm_set1_epi16(256), weight2);
+  const __m128i sum = _mm_add_epi16(
+        _mm_add_epi16(
+          _mm_mullo_epi16(value1, weight1), _mm_mullo_epi16(value2, weight2)),
+        _mm_set1_epi16(128));
+  return _mm_srli_epi16(sum, 8);
+}
+
+
+/// Fixed-point blend of 16 values with separate weights for the
+/// lower and upper 8 values.
+VIREN2D_TARGET_SSE41 inline
+__m128i BlendUInt8x16SSE41(
+    __m128i value1, __m128i value2,
+    __m128i weight2_low, __m128i weight2_high) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i low = BlendUInt16x8SSE41(
+        _mm_cvtepu8_epi16(value1), _mm_cvtepu8_epi16(value2), weight2_low);
+  const __m128i high = BlendUInt16x8SSE41(
+        _mm_unpackhi_epi8(value1, zero), _mm_unpackhi_epi8(value2, zero),
+        weight2_high);
+  return _mm_packus_epi16(low, high);
+}
+
+
+VIREN2D_TARGET_SSE41
+void BlendConstantUInt8SSE41(
+    const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
+    int64_t num_elements, uint16_t weight2) {
+  int64_t i = 0;
+  const __m128i weight = _mm_set1_epi16(static_cast<int16_t>(weight2));
+  for (; i + 16 <= num_elements; i += 16) {
+    const __m128i value1 = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src1 + i));
+    const __m128i value2 = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src2 + i));
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst + i),
+          BlendUInt8x16SSE41(value1, value2, weight, weight));
+  }
+  ScalarUInt8().blend_constant(
+        src1 + i, src2 + i, dst + i, num_elements - i, weight2);
+}
+
+
+/// Blends `num_elements` values with a fixed-point weight per element.
+VIREN2D_TARGET_SSE41
+void BlendFixedPointWeightsUInt8SSE41(
+    const uint8_t *src1, const uint8_t *src2, const uint16_t *weights2,
+    uint8_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    const __m128i value1 = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src1 + i));
+    const __m128i value2 = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src2 + i));
+    const __m128i weight_low = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(weights2 + i));
+    const __m128i weight_high = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(weights2 + i + 8));
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst + i),
+          BlendUInt8x16SSE41(value1, value2, weight_low, weight_high));
+  }
+  for (; i < num_elements; ++i) {
+    dst[i] = BlendFixedPoint(src1[i], src2[i], weights2[i]);
+  }
+}
+
+
+/// Converts 4 blending weights to 8.8 fixed-point (as 32-bit integers),
+/// with the same results as `FixedPointWeight(double)`.
+VIREN2D_TARGET_SSE41 inline
+__m128i FixedPointWeightsSSE41(__m128 alpha) {
+  // Scaling by 256 is exact. If the first operand is NaN, max returns
+  // the second one, i.e. NaN becomes 0.
+  const __m128 scaled = _mm_min_ps(
+        _mm_max_ps(_mm_mul_ps(alpha, _mm_set1_ps(256.0f)), _mm_setzero_ps()),
+        _mm_set1_ps(256.0f));
+  // Round half up without adding 0.5 (which could round in float)
+  const __m128i truncated = _mm_cvttps_epi32(scaled);
+  const __m128 fraction = _mm_sub_ps(scaled, _mm_cvtepi32_ps(truncated));
+  const __m128i round_up = _mm_castps_si128(
+        _mm_cmpge_ps(fraction, _mm_set1_ps(0.5f)));
+  return _mm_sub_epi32(truncated, round_up);
+}
+
+
+/// Number of fixed-point weights which are converted (on the stack) at
+/// once by `BlendFloatWeightsUInt8`.
+constexpr int64_t kBlendWeightsBlockSize = 256;
+
+
+/// Implements `blend_weights` for uint8: converts blocks of float weights
+/// to fixed-point, broadcasts per-pixel weights across the channels and
+/// blends them via the given fixed-point kernel.
+VIREN2D_TARGET_SSE41
+void BlendFloatWeightsUInt8(
+    const uint8_t *src1, const uint8_t *src2, const float *weights2,
+    uint8_t *dst, int64_t num_pixels, int channels, int weight_channels,
+    void (*blend_fixed_point)(
+      const uint8_t *, const uint8_t *, const uint16_t *,
+      uint8_t *, int64_t)) {
+  const int64_t repeat = channels / weight_channels;
+  if (((weight_channels != 1) && (weight_channels != channels))
+      || (repeat > kBlendWeightsBlockSize / 8)) {
+    ScalarUInt8().blend_weights(
+          src1, src2, weights2, dst, num_pixels, channels, weight_channels);
+    return;
+  }
+
+  alignas(16) uint16_t fixed[kBlendWeightsBlockSize];
+  const int64_t num_weights = num_pixels * weight_channels;
+  // Number of weights per block, such that the broadcast ones still fit
+  const int64_t block_size = (kBlendWeightsBlockSize / repeat) & ~int64_t(7);
+  for (int64_t start = 0; start < num_weights; start += block_size) {
+    const int64_t count = std::min(block_size, num_weights - start);
+    const float *weights = weights2 + start;
+    int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+      _mm_store_si128(
+            reinterpret_cast<__m128i *>(fixed + i),
+            _mm_packus_epi32(
+              FixedPointWeightsSSE41(_mm_loadu_ps(weights + i)),
+              FixedPointWeightsSSE41(_mm_loadu_ps(weights + i + 4))));
+    }
+    for (; i < count; ++i) {
+      fixed[i] = FixedPointWeight(static_cast<double>(weights[i]));
+    }
+
+    if (repeat > 1) {
+      // In-place broadcast, back to front
+      for (int64_t idx = count - 1; idx >= 0; --idx) {
+        const uint16_t weight = fixed[idx];
+        for (int64_t ch = repeat - 1; ch >= 0; --ch) {
+          fixed[idx * repeat + ch] = weight;
+        }
+      }
+    }
+
+    const int64_t offset = start * repeat;
+    blend_fixed_point(
+          src1 + offset, src2 + offset, fixed, dst + offset, count * repeat);
+  }
+}
+
+
+VIREN2D_TARGET_SSE41
+void BlendWeightsUInt8SSE41(
+    const uint8_t *src1, const uint8_t *src2, const float *weights2,
+    uint8_t *dst, int64_t num_pixels, int channels, int weight_channels) {
+  BlendFloatWeightsUInt8(
+        src1, src2, weights2, dst, num_pixels, channels, weight_channels,
+        BlendFixedPointWeightsUInt8SSE41);
+}
+
+
+/// Composites 2 overlay pixels over 2 pixels with 4-byte lanes, where
+/// all values have been widened to 16 bit. The 4th lane of each pixel
+/// is the alpha channel.
+VIREN2D_TARGET_SSE41 inline
+__m128i CompositeUInt16x8SSE41(__m128i src, __m128i overlay) {
+  // Broadcast the overlay's alpha & convert it to fixed-point
+  __m128i weight = _mm_shuffle_epi8(
+        overlay, _mm_setr_epi8(6, 7, 6, 7, 6, 7, 6, 7,
+                               14, 15, 14, 15, 14, 15, 14, 15));
+  weight = _mm_add_epi16(weight, _mm_srli_epi16(weight, 7));
+  // src * (1 - weight), incl. the rounding offset
+  const __m128i remaining = _mm_add_epi16(
+        _mm_mullo_epi16(src, _mm_sub_epi16(_mm_set1_epi16(256), weight)),
+        _mm_set1_epi16(128));
+  const __m128i colors = _mm_srli_epi16(
+        _mm_add_epi16(remaining, _mm_mullo_epi16(overlay, weight)), 8);
+  const __m128i alpha = _mm_add_epi16(
+        overlay, _mm_srli_epi16(remaining, 8));
+  return _mm_blend_epi16(colors, alpha, 0x88);
+}
+
+
+/// Composites 4 RGBA overlay pixels over 4 pixels with 4-byte lanes.
+VIREN2D_TARGET_SSE41 inline
+__m128i CompositeUInt8x16SSE41(__m128i src, __m128i overlay) {
+  const __m128i zero = _mm_setzero_si128();
+  return _mm_packus_epi16(
+        CompositeUInt16x8SSE41(
+          _mm_cvtepu8_epi16(src), _mm_cvtepu8_epi16(overlay)),
+        CompositeUInt16x8SSE41(
+          _mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(overlay, zero)));
+}
+
+
+VIREN2D_TARGET_SSE41
+void AlphaCompositeUInt8SSE41(
+    const uint8_t *src, const uint8_t *overlay, uint8_t *dst,
+    int64_t num_pixels, int channels) {
+  int64_t i = 0;
+  if (channels == 3) {
+    const __m128i expand = ExpandRGBShuffle();
+    const __m128i compress = _mm_setr_epi8(
+          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    // Each load reads 4 bytes beyond the 4th pixel
+    for (; i + 6 <= num_pixels; i += 4) {
+      const __m128i px = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3 * i)),
+            expand);
+      const __m128i over = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(overlay + 4 * i));
+      const __m128i result = _mm_shuffle_epi8(
+            CompositeUInt8x16SSE41(px, over), compress);
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + 3 * i), result);
+      const int32_t tail = _mm_extract_epi32(result, 2);
+      std::memcpy(dst + 3 * i + 8, &tail, 4);
+    }
+  } else if (channels == 4) {
+    for (; i + 4 <= num_pixels; i += 4) {
+      const __m128i px = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + 4 * i));
+      const __m128i over = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(overlay + 4 * i));
+      _mm_storeu_si128(
+            reinterpret_cast<__m128i *>(dst + 4 * i),
+            CompositeUInt8x16SSE41(px, over));
+    }
+  }
+  ScalarUInt8().alpha_composite(
+        src + channels * i, overlay + 4 * i, dst + channels * i,
+        num_pixels - i, channels);
+}
+
+
+//---------------------------------------------------- SSE4.1 float
+VIREN2D_TARGET_SSE41
+void RGB2RGBAFloatSSE41(const float *src, float *dst, int64_t num_pixels) {
+  const __m128 alpha = _mm_set1_ps(255.0f);
+  int64_t i = 0;
+  // Each load reads 4 floats, i.e. we cannot load the last pixel.
+  for (; i + 1 < num_pixels; ++i) {
+    _mm_storeu_ps(
+          dst + 4 * i, _mm_blend_ps(_mm_loadu_ps(src + 3 * i), alpha, 0x8));
+  }
+  ScalarFloat().rgb2rgba(src + 3 * i, dst + 4 * i, num_pixels - i);
+}
+
+
+VIREN2D_TARGET_SSE41
+void RGBA2RGBFloatSSE41(const float *src, float *dst, int64_t num_pixels) {
+  int64_t i = 0;
+  // Each store writes 4 floats, i.e. the alpha value will be overwritten
+  // by the next iteration. Thus, the last pixel is handled separately.
+  for (; i + 1 < num_pixels; ++i) {
+    _mm_storeu_ps(dst + 3 * i, _mm_loadu_ps(src + 4 * i));
+  }
+  ScalarFloat().rgba2rgb(src + 4 * i, dst + 3 * i, num_pixels - i);
+}
+
+
+VIREN2D_TARGET_SSE41
+void Gray2RGBFloatSSE41(const float *src, float *dst, int64_t num_pixels) {
+  int64_t i = 0;
+  for (; i + 4 <= num_pixels; i += 4) {
+    const __m128 gray = _mm_loadu_ps(src + i);
+    float *out = dst + 3 * i;
+    _mm_storeu_ps(out, _mm_shuffle_ps(gray, gray, _MM_SHUFFLE(1, 0, 0, 0)));
+    _mm_storeu_ps(out + 4, _mm_shuffle_ps(gray, gray, _MM_SHUFFLE(2, 2, 1, 1)));
+    _mm_storeu_ps(out + 8, _mm_shuffle_ps(gray, gray, _MM_SHUFFLE(3, 3, 3, 2)));
+  }
+  ScalarFloat().gray2rgb(src + i, dst + 3 * i, num_pixels - i);
+}
+
+
+VIREN2D_TARGET_SSE41
+void Gray2RGBAFloatSSE41(const float *src, float *dst, int64_t num_pixels) {
+  const __m128 alpha = _mm_set1_ps(255.0f);
+  int64_t i = 0;
+  for (; i + 4 <= num_pixels; i += 4) {
+    const __m128 gray = _mm_loadu_ps(src + i);
+    float *out = dst + 4 * i;
+    _mm_storeu_ps(out, _mm_blend_ps(
+          _mm_shuffle_ps(gray, gray, _MM_SHUFFLE(0, 0, 0, 0)), alpha, 0x8));
+    _mm_storeu_ps(out + 4, _mm_blend_ps(
+          _mm_shuffle_ps(gray, gray, _MM_SHUFFLE(1, 1, 1, 1)), alpha, 0x8));
+    _mm_storeu_ps(out + 8, _mm_blend_ps(
+          _mm_shuffle_ps(gray, gray, _MM_SHUFFLE(2, 2, 2, 2)), alpha, 0x8));
+    _mm_storeu_ps(out + 12, _mm_blend_ps(
+          _mm_shuffle_ps(gray, gray, _MM_SHUFFLE(3, 3, 3, 3)), alpha, 0x8));
+  }
+  ScalarFloat().gray2rgba(src + i, dst + 4 * i, num_pixels - i);
+}
+
+
+VIREN2D_TARGET_SSE41
+void SwapChannelsFloatSSE41(
+    float *data, int64_t num_pixels, int channels, int ch1, int ch2) {
+  int64_t i = 0;
+  if ((channels == 3) || (channels == 4)) {
+    int8_t mask[16];
+    SwapChannelsMask(mask, 4, channels, ch1, ch2);
+    const __m128i shuffle = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(mask));
+    // A register holds a single pixel. For RGB, it also
+    // holds the (unchanged) first value of the next pixel.
+    const int64_t min_remaining = (channels == 4) ? 1 : 2;
+    for (; i + min_remaining <= num_pixels; ++i) {
+      __m128i *ptr = reinterpret_cast<__m128i *>(data + channels * i);
+      _mm_storeu_si128(
+            ptr, _mm_shuffle_epi8(_mm_loadu_si128(ptr), shuffle));
+    }
+  }
+  ScalarFloat().swap_channels(
+        data + channels * i, num_pixels - i, channels, ch1, ch2);
+}
+
+
+/// Stores the luminance of 4 pixels.
+inline void StoreGrayFloat(
+    const float *luminance, const float *src, int src_channels,
+    int dst_channels, float *dst) {
+  for (int px = 0; px < 4; ++px) {
+    for (int ch = 0; ch < std::min(dst_channels, 3); ++ch) {
+      dst[ch] = luminance[px];
+    }
+    if (dst_channels == 4) {
+      dst[3] = (src_channels == 4) ? src[3] : 255.0f;
+    }
+    src += src_channels;
+    dst += dst_channels;
+  }
+}
+
+
+VIREN2D_TARGET_SSE41
+void RGBx2GrayFloatSSE41(
+    const float *src, float *dst, int64_t num_pixels,
+    int src_channels, int dst_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((src_channels == 3) || (src_channels == 4)) {
+    const int ch_r = is_bgr_format ? 2 : 0;
+    const int ch_b = is_bgr_format ? 0 : 2;
+    const int c = src_channels;
+    const __m128d wr = _mm_set1_pd(kWeightRed);
+    const __m128d wg = _mm_set1_pd(kWeightGreen);
+    const __m128d wb = _mm_set1_pd(kWeightBlue);
+    alignas(16) float luminance[4];
+    for (; i + 4 <= num_pixels; i += 4) {
+      const float *px = src + c * i;
+      const __m128 red = _mm_setr_ps(
+            px[ch_r], px[c + ch_r], px[2 * c + ch_r], px[3 * c + ch_r]);
+      const __m128 green = _mm_setr_ps(
+            px[1], px[c + 1], px[2 * c + 1], px[3 * c + 1]);
+      const __m128 blue = _mm_setr_ps(
+            px[ch_b], px[c + ch_b], px[2 * c + ch_b], px[3 * c + ch_b]);
+
+      const __m128d lum_lo = _mm_add_pd(
+            _mm_add_pd(
+              _mm_mul_pd(wr, _mm_cvtps_pd(red)),
+              _mm_mul_pd(wg, _mm_cvtps_pd(green))),
+            _mm_mul_pd(wb, _mm_cvtps_pd(blue)));
+      const __m128d lum_hi = _mm_add_pd(
+            _mm_add_pd(
+              _mm_mul_pd(wr, _mm_cvtps_pd(_mm_movehl_ps(red, red))),
+              _mm_mul_pd(wg, _mm_cvtps_pd(_mm_movehl_ps(green, green)))),
+            _mm_mul_pd(wb, _mm_cvtps_pd(_mm_movehl_ps(blue, blue))));
+      const __m128 lum = _mm_movelh_ps(
+            _mm_cvtpd_ps(lum_lo), _mm_cvtpd_ps(lum_hi));
+      if (dst_channels == 1) {
+        _mm_storeu_ps(dst + i, lum);
+      } else {
+        _mm_store_ps(luminance, lum);
+        StoreGrayFloat(
+              luminance, px, src_channels, dst_channels,
+              dst + dst_channels * i);
+      }
+    }
+  }
+  ScalarFloat().rgbx2gray(
+        src + src_channels * i, dst + dst_channels * i, num_pixels - i,
+        src_channels, dst_channels, is_bgr_format);
+}
+
+
+VIREN2D_TARGET_SSE41
+void RGBx2LabFloatSSE41(
+    const float *src, float *dst, int64_t num_pixels,
+    int src_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((src_channels == 3) || (src_channels == 4)) {
+    const float *linearize = SRGBGamma().linearize;
+    const int ch_r = is_bgr_format ? 2 : 0;
+    const int ch_b = is_bgr_format ? 0 : 2;
+    const int c = src_channels;
+    alignas(16) float lab_values[3][4];
+    for (; i + 4 <= num_pixels; i += 4) {
+      const float *px = src + c * i;
+      const __m128 red = _mm_setr_ps(
+            px[ch_r], px[c + ch_r], px[2 * c + ch_r], px[3 * c + ch_r]);
+      const __m128 green = _mm_setr_ps(
+            px[1], px[c + 1], px[2 * c + 1], px[3 * c + 1]);
+      const __m128 blue = _mm_setr_ps(
+            px[ch_b], px[c + ch_b], px[2 * c + ch_b], px[3 * c + ch_b]);
+      __m128 lab[3];
+      LinearRGB2LabSSE41(
+            InterpolateGammaLUTSSE41(linearize, ClampUnitSSE41(red)),
+            InterpolateGammaLUTSSE41(linearize, ClampUnitSSE41(green)),
+            InterpolateGammaLUTSSE41(linearize, ClampUnitSSE41(blue)), lab);
+      for (int k = 0; k < 3; ++k) {
+        _mm_store_ps(lab_values[k], lab[k]);
+      }
+      float *out = dst + 3 * i;
+      for (int p = 0; p < 4; ++p, out += 3) {
+        out[0] = lab_values[0][p];
+        out[1] = lab_values[1][p];
+        out[2] = lab_values[2][p];
+      }
+    }
+  }
+  ScalarFloat().rgbx2lab(
+        src + src_channels * i, dst + 3 * i, num_pixels - i,
+        src_channels, is_bgr_format);
+}
+
+
+VIREN2D_TARGET_SSE41
+void Lab2RGBxFloatSSE41(
+    const float *src, float *dst, int64_t num_pixels,
+    int dst_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((dst_channels == 3) || (dst_channels == 4)) {
+    const float *compress = SRGBGamma().compress;
+    const int ch_r = is_bgr_format ? 2 : 0;
+    const int ch_b = is_bgr_format ? 0 : 2;
+    alignas(16) float rgb_values[3][4];
+    for (; i + 4 <= num_pixels; i += 4) {
+      const float *px = src + 3 * i;
+      __m128 rgb[3];
+      Lab2LinearRGBSSE41(
+            _mm_setr_ps(px[0], px[3], px[6], px[9]),
+            _mm_setr_ps(px[1], px[4], px[7], px[10]),
+            _mm_setr_ps(px[2], px[5], px[8], px[11]), rgb);
+      for (int k = 0; k < 3; ++k) {
+        _mm_store_ps(rgb_values[k], InterpolateGammaLUTSSE41(
+                       compress, ClampUnitSSE41(rgb[k])));
+      }
+      float *out = dst + dst_channels * i;
+      for (int p = 0; p < 4; ++p, out += dst_channels) {
+        out[ch_r] = rgb_values[0][p];
+        out[1] = rgb_values[1][p];
+        out[ch_b] = rgb_values[2][p];
+        if (dst_channels == 4) {
+          out[3] = 1.0f;
+        }
+      }
+    }
+  }
+  ScalarFloat().lab2rgbx(
+        src + 3 * i, dst + dst_channels * i, num_pixels - i,
+        dst_channels, is_bgr_format);
+}
+
+
+//---------------------------------------------------- AVX2 uint8
+VIREN2D_TARGET_AVX2
+void RGB2RGBAUInt8AVX2(const uint8_t *src, uint8_t *dst, int64_t num_pixels) {
+  const __m256i shuffle = _mm256_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m256i alpha = _mm256_set1_epi32(-16777216);  // 0xFF000000
+  int64_t i = 0;
+  // Each lane converts 4 pixels, but the upper load reads 16 bytes
+  // starting at pixel 4, i.e. we need 10 remaining pixels.
+  for (; i + 10 <= num_pixels; i += 8) {
+    const uint8_t *ptr = src + 3 * i;
+    const __m256i px = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr))),
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + 12)), 1);
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(dst + 4 * i),
+          _mm256_or_si256(_mm256_shuffle_epi8(px, shuffle), alpha));
+  }
+  RGB2RGBAUInt8SSE41(src + 3 * i, dst + 4 * i, num_pixels - i);
+}
+
+
+VIREN2D_TARGET_AVX2
+void RGBA2RGBUInt8AVX2(const uint8_t *src, uint8_t *dst, int64_t num_pixels) {
+  const __m256i shuffle = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  // After the in-lane shuffle, each lane holds 12 valid bytes, which
+  // need to be moved next to each other:
+  const __m256i pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+  int64_t i = 0;
+  // Each store writes 32 bytes, i.e. 8 bytes beyond the 8 converted pixels.
+  for (; i + 11 <= num_pixels; i += 8) {
+    const __m256i px = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(src + 4 * i));
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(dst + 3 * i),
+          _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(px, shuffle), pack));
+  }
+  RGBA2RGBUInt8SSE41(src + 4 * i, dst + 3 * i, num_pixels - i);
+}
+
+
+VIREN2D_TARGET_AVX2
+void Gray2RGBAUInt8AVX2(const uint8_t *src, uint8_t *dst, int64_t num_pixels) {
+  const __m256i shuffle = _mm256_setr_epi8(
+        0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1,
+        4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+  const __m256i alpha = _mm256_set1_epi32(-16777216);  // 0xFF000000
+  int64_t i = 0;
+  for (; i + 8 <= num_pixels; i += 8) {
+    const __m256i gray = _mm256_broadcastsi128_si256(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i)));
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(dst + 4 * i),
+          _mm256_or_si256(_mm256_shuffle_epi8(gray, shuffle), alpha));
+  }
+  Gray2RGBAUInt8SSE41(src + i, dst + 4 * i, num_pixels - i);
+}
+
+
+VIREN2D_TARGET_AVX2
+void SwapChannelsUInt8AVX2(
+    uint8_t *data, int64_t num_pixels, int channels, int ch1, int ch2) {
+  int64_t i = 0;
+  if (channels == 4) {
+    int8_t mask[16];
+    SwapChannelsMask(mask, 1, channels, ch1, ch2);
+    const __m256i shuffle = _mm256_broadcastsi128_si256(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask)));
+    for (; i + 8 <= num_pixels; i += 8) {
+      __m256i *ptr = reinterpret_cast<__m256i *>(data + 4 * i);
+      _mm256_storeu_si256(
+            ptr, _mm256_shuffle_epi8(_mm256_loadu_si256(ptr), shuffle));
+    }
+  }
+  SwapChannelsUInt8SSE41(
+        data + channels * i, num_pixels - i, channels, ch1, ch2);
+}
+
+
+/// Computes the (truncated) luminance of 4 pixels, given as 32-bit integers.
+VIREN2D_TARGET_AVX2 inline
+__m128i LuminanceUInt8AVX2(__m128i red, __m128i green, __m128i blue) {
+  const __m256d lum = _mm256_add_pd(
+        _mm256_add_pd(
+          _mm256_mul_pd(_mm256_set1_pd(kWeightRed), _mm256_cvtepi32_pd(red)),
+          _mm256_mul_pd(_mm256_set1_pd(kWeightGreen), _mm256_cvtepi32_pd(green))),
+        _mm256_mul_pd(_mm256_set1_pd(kWeightBlue), _mm256_cvtepi32_pd(blue)));
+  return _mm256_cvttpd_epi32(lum);
+}
+
+
+VIREN2D_TARGET_AVX2
+void RGBx2GrayUInt8AVX2(
+    const uint8_t *src, uint8_t *dst, int64_t num_pixels,
+    int src_channels, int dst_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if (((src_channels == 3) || (src_channels == 4))
+      && (dst_channels != 2)) {
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, src_channels, is_bgr_format);
+    const int64_t min_remaining = (src_channels == 4) ? 4 : 6;
+    for (; i + min_remaining <= num_pixels; i += 4) {
+      const __m128i px = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + src_channels * i));
+      __m128i red, green, blue;
+      DeinterleaveRGBUInt8(px, shuffles, red, green, blue);
+      StoreGrayUInt8(
+            LuminanceUInt8AVX2(red, green, blue), px, shuffles,
+            src_channels, dst_channels, dst + dst_channels * i);
+    }
+  }
+  ScalarUInt8().rgbx2gray(
+        src + src_channels * i, dst + dst_channels * i, num_pixels - i,
+        src_channels, dst_channels, is_bgr_format);
+}
+
+
+/// AVX2 version of `HSVUInt8SSE41` for 8 pixels.
+VIREN2D_TARGET_AVX2 inline
+void HSVUInt8AVX2(__m256i red, __m256i green, __m256i blue, __m256i *hsv) {
+  const __m256i max_int = _mm256_max_epi32(
+        red, _mm256_max_epi32(green, blue));
+  const __m256i min_int = _mm256_min_epi32(
+        red, _mm256_min_epi32(green, blue));
+  const __m256 achromatic = _mm256_castsi256_ps(_mm256_or_si256(
+        _mm256_cmpeq_epi32(max_int, _mm256_setzero_si256()),
+        _mm256_cmpeq_epi32(max_int, min_int)));
+
+  const __m256 scale = _mm256_set1_ps(255.0f);
+  const __m256 r = _mm256_div_ps(_mm256_cvtepi32_ps(red), scale);
+  const __m256 g = _mm256_div_ps(_mm256_cvtepi32_ps(green), scale);
+  const __m256 b = _mm256_div_ps(_mm256_cvtepi32_ps(blue), scale);
+  const __m256 max_val = _mm256_max_ps(r, _mm256_max_ps(g, b));
+  const __m256 delta = _mm256_sub_ps(
+        max_val, _mm256_min_ps(r, _mm256_min_ps(g, b)));
+
+  const __m256 sixty = _mm256_set1_ps(60.0f);
+  const __m256 max_is_red = _mm256_and_ps(
+        _mm256_cmp_ps(r, g, _CMP_GE_OQ), _mm256_cmp_ps(r, b, _CMP_GE_OQ));
+  const __m256 max_is_green = _mm256_cmp_ps(g, b, _CMP_GE_OQ);
+  const __m256 hue_red = _mm256_mul_ps(
+        sixty, _mm256_div_ps(_mm256_sub_ps(g, b), delta));
+  const __m256 hue_green = _mm256_add_ps(
+        _mm256_mul_ps(sixty, _mm256_div_ps(_mm256_sub_ps(b, r), delta)),
+        _mm256_set1_ps(120.0f));
+  const __m256 hue_blue = _mm256_add_ps(
+        _mm256_mul_ps(sixty, _mm256_div_ps(_mm256_sub_ps(r, g), delta)),
+        _mm256_set1_ps(240.0f));
+  __m256 hue = _mm256_blendv_ps(
+        _mm256_blendv_ps(hue_blue, hue_green, max_is_green),
+        hue_red, max_is_red);
+  hue = _mm256_andnot_ps(achromatic, hue);
+  hue = _mm256_add_ps(hue, _mm256_and_ps(
+          _mm256_cmp_ps(hue, _mm256_setzero_ps(), _CMP_LT_OQ),
+          _mm256_set1_ps(360.0f)));
+  const __m256 sat = _mm256_andnot_ps(
+        achromatic, _mm256_div_ps(delta, max_val));
+
+  hsv[0] = _mm256_cvttps_epi32(_mm256_div_ps(hue, _mm256_set1_ps(2.0f)));
+  hsv[1] = _mm256_cvttps_epi32(_mm256_mul_ps(scale, sat));
+  hsv[2] = _mm256_cvttps_epi32(_mm256_mul_ps(scale, max_val));
+}
+
+
+/// AVX2 version of `OutsideHSVRangeSSE41` for 8 pixels.
+VIREN2D_TARGET_AVX2 inline
+__m256i OutsideHSVRangeAVX2(
+    __m256i red, __m256i green, __m256i blue, const __m256i *bounds) {
+  __m256i hsv[3];
+  HSVUInt8AVX2(red, green, blue, hsv);
+  __m256i outside = _mm256_setzero_si256();
+  for (int k = 0; k < 3; ++k) {
+    outside = _mm256_or_si256(outside, _mm256_or_si256(
+          _mm256_cmpgt_epi32(bounds[2 * k], hsv[k]),
+          _mm256_cmpgt_epi32(hsv[k], bounds[2 * k + 1])));
+  }
+  return outside;
+}
+
+
+/// AVX2 version of `HSVBoundsSSE41`.
+VIREN2D_TARGET_AVX2 inline
+void HSVBoundsAVX2(const HSVRange &range, __m256i *bounds) {
+  bounds[0] = _mm256_set1_epi32(range.hue_min);
+  bounds[1] = _mm256_set1_epi32(range.hue_max);
+  bounds[2] = _mm256_set1_epi32(range.saturation_min);
+  bounds[3] = _mm256_set1_epi32(range.saturation_max);
+  bounds[4] = _mm256_set1_epi32(range.value_min);
+  bounds[5] = _mm256_set1_epi32(range.value_max);
+}
+
+
+/// Loads & deinterleaves 8 consecutive pixels, *i.e.* 2 registers
+/// with 4 pixels each.
+VIREN2D_TARGET_AVX2 inline
+void DeinterleaveRGBUInt8x8(
+    const uint8_t *src, int channels, const __m128i *shuffles,
+    __m128i *px, __m256i &red, __m256i &green, __m256i &blue) {
+  __m128i r[2], g[2], b[2];
+  for (int k = 0; k < 2; ++k) {
+    px[k] = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src + 4 * k * channels));
+    DeinterleaveRGBUInt8(px[k], shuffles, r[k], g[k], b[k]);
+  }
+  red = _mm256_inserti128_si256(_mm256_castsi128_si256(r[0]), r[1], 1);
+  green = _mm256_inserti128_si256(_mm256_castsi128_si256(g[0]), g[1], 1);
+  blue = _mm256_inserti128_si256(_mm256_castsi128_si256(b[0]), b[1], 1);
+}
+
+
+VIREN2D_TARGET_AVX2
+void MaskHSVRangeUInt8AVX2(
+    const uint8_t *src, uint8_t *mask, int64_t num_pixels,
+    int src_channels, bool is_bgr_format, const HSVRange &range) {
+  int64_t i = 0;
+  if ((src_channels == 3) || (src_channels == 4)) {
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, src_channels, is_bgr_format);
+    __m256i bounds[6];
+    HSVBoundsAVX2(range, bounds);
+    // The second load starts at the 5th pixel and reads 16 bytes
+    const int64_t min_remaining = (src_channels == 4) ? 8 : 10;
+    for (; i + min_remaining <= num_pixels; i += 8) {
+      __m128i px[2];
+      __m256i red, green, blue;
+      DeinterleaveRGBUInt8x8(
+            src + src_channels * i, src_channels, shuffles,
+            px, red, green, blue);
+      const __m256i outside = OutsideHSVRangeAVX2(red, green, blue, bounds);
+      StoreHSVMaskUInt8(_mm256_castsi256_si128(outside), mask + i);
+      StoreHSVMaskUInt8(_mm256_extracti128_si256(outside, 1), mask + i + 4);
+    }
+  }
+  ScalarUInt8().mask_hsv_range(
+        src + src_channels * i, mask + i, num_pixels - i,
+        src_channels, is_bgr_format, range);
+}
+
+
+VIREN2D_TARGET_AVX2
+void ColorPopUInt8AVX2(
+    const uint8_t *src, uint8_t *dst, int64_t num_pixels,
+    int channels, bool is_bgr_format, const HSVRange &range) {
+  int64_t i = 0;
+  if ((channels == 3) || (channels == 4)) {
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, channels, is_bgr_format);
+    __m256i bounds[6];
+    HSVBoundsAVX2(range, bounds);
+    const int64_t min_remaining = (channels == 4) ? 8 : 10;
+    for (; i + min_remaining <= num_pixels; i += 8) {
+      __m128i px[2];
+      __m256i red, green, blue;
+      DeinterleaveRGBUInt8x8(
+            src + channels * i, channels, shuffles, px, red, green, blue);
+      const __m256i outside = OutsideHSVRangeAVX2(red, green, blue, bounds);
+      for (int k = 0; k < 2; ++k) {
+        const __m128i lum = (k == 0)
+            ? LuminanceUInt8AVX2(
+                _mm256_castsi256_si128(red), _mm256_castsi256_si128(green),
+                _mm256_castsi256_si128(blue))
+            : LuminanceUInt8AVX2(
+                _mm256_extracti128_si256(red, 1),
+                _mm256_extracti128_si256(green, 1),
+                _mm256_extracti128_si256(blue, 1));
+        const __m128i out = (k == 0)
+            ? _mm256_castsi256_si128(outside)
+            : _mm256_extracti128_si256(outside, 1);
+        StoreColorPopUInt8(
+              px[k], out, lum, channels, dst + channels * (i + 4 * k));
+      }
+    }
+  }
+  ScalarUInt8().color_pop(
+        src + channels * i, dst + channels * i, num_pixels - i,
+        channels, is_bgr_format, range);
+}
+
+
+/// Stores 8 pixels with 3 or 4 channels, see `StoreInterleavedUInt8`.
+VIREN2D_TARGET_AVX2 inline
+void StoreInterleavedUInt8x8(
+    __m256i ch0, __m256i ch1, __m256i ch2, __m256i ch3,
+    int channels, uint8_t *dst) {
+  StoreInterleavedUInt8(
+        _mm256_castsi256_si128(ch0), _mm256_castsi256_si128(ch1),
+        _mm256_castsi256_si128(ch2), _mm256_castsi256_si128(ch3),
+        channels, dst);
+  StoreInterleavedUInt8(
+        _mm256_extracti128_si256(ch0, 1), _mm256_extracti128_si256(ch1, 1),
+        _mm256_extracti128_si256(ch2, 1), _mm256_extracti128_si256(ch3, 1),
+        channels, dst + 4 * channels);
+}
+
+
+VIREN2D_TARGET_AVX2
+void RGBx2HSVUInt8AVX2(
+    const uint8_t *src, uint8_t *dst, int64_t num_pixels,
+    int src_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((src_channels == 3) || (src_channels == 4)) {
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, src_channels, is_bgr_format);
+    const int64_t min_remaining = (src_channels == 4) ? 8 : 10;
+    for (; i + min_remaining <= num_pixels; i += 8) {
+      __m128i px[2];
+      __m256i red, green, blue, hsv[3];
+      DeinterleaveRGBUInt8x8(
+            src + src_channels * i, src_channels, shuffles,
+            px, red, green, blue);
+      HSVUInt8AVX2(red, green, blue, hsv);
+      StoreInterleavedUInt8x8(
+            hsv[0], hsv[1], hsv[2], _mm256_setzero_si256(), 3, dst + 3 * i);
+    }
+  }
+  ScalarUInt8().rgbx2hsv(
+        src + src_channels * i, dst + 3 * i, num_pixels - i,
+        src_channels, is_bgr_format);
+}
+
+
+/// AVX2 version of `RGBFromHSVSSE41` for 8 pixels.
+VIREN2D_TARGET_AVX2 inline
+void RGBFromHSVAVX2(
+    __m256 hue, __m256 sat, __m256 val, __m256 *rgb) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 hue60 = _mm256_div_ps(hue, _mm256_set1_ps(60.0f));
+  const __m256i sector = _mm256_cvttps_epi32(hue60);
+  const __m256 rem = _mm256_sub_ps(hue60, _mm256_cvtepi32_ps(sector));
+  const __m256i bin = _mm256_sub_epi32(sector, _mm256_and_si256(
+        _mm256_cmpgt_epi32(sector, _mm256_set1_epi32(5)),
+        _mm256_set1_epi32(6)));
+
+  const __m256 p = _mm256_mul_ps(val, _mm256_sub_ps(one, sat));
+  const __m256 q = _mm256_mul_ps(
+        val, _mm256_sub_ps(one, _mm256_mul_ps(sat, rem)));
+  const __m256 t = _mm256_mul_ps(
+        val, _mm256_sub_ps(
+          one, _mm256_mul_ps(sat, _mm256_sub_ps(one, rem))));
+
+  __m256 is_bin[6];
+  for (int k = 0; k < 6; ++k) {
+    is_bin[k] = _mm256_castsi256_ps(
+          _mm256_cmpeq_epi32(bin, _mm256_set1_epi32(k)));
+  }
+  rgb[0] = _mm256_blendv_ps(
+        _mm256_blendv_ps(
+          _mm256_blendv_ps(val, q, is_bin[1]),
+          p, _mm256_or_ps(is_bin[2], is_bin[3])),
+        t, is_bin[4]);
+  rgb[1] = _mm256_blendv_ps(
+        _mm256_blendv_ps(
+          _mm256_blendv_ps(p, t, is_bin[0]),
+          val, _mm256_or_ps(is_bin[1], is_bin[2])),
+        q, is_bin[3]);
+  rgb[2] = _mm256_blendv_ps(
+        _mm256_blendv_ps(
+          _mm256_blendv_ps(p, t, is_bin[2]),
+          val, _mm256_or_ps(is_bin[3], is_bin[4])),
+        q, is_bin[5]);
+}
+
+
+VIREN2D_TARGET_AVX2
+void HSV2RGBxUInt8AVX2(
+    const uint8_t *src, uint8_t *dst, int64_t num_pixels,
+    int dst_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((dst_channels == 3) || (dst_channels == 4)) {
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, 3, false);
+    const __m256 scale = _mm256_set1_ps(255.0f);
+    const __m256i alpha = _mm256_set1_epi32(255);
+    for (; i + 10 <= num_pixels; i += 8) {
+      __m128i px[2];
+      __m256i h, s, v;
+      DeinterleaveRGBUInt8x8(src + 3 * i, 3, shuffles, px, h, s, v);
+      __m256 rgb[3];
+      RGBFromHSVAVX2(
+            _mm256_mul_ps(_mm256_cvtepi32_ps(h), _mm256_set1_ps(2.0f)),
+            _mm256_div_ps(_mm256_cvtepi32_ps(s), scale),
+            _mm256_div_ps(_mm256_cvtepi32_ps(v), scale), rgb);
+      const __m256i red = _mm256_cvttps_epi32(_mm256_mul_ps(scale, rgb[0]));
+      const __m256i green = _mm256_cvttps_epi32(_mm256_mul_ps(scale, rgb[1]));
+      const __m256i blue = _mm256_cvttps_epi32(_mm256_mul_ps(scale, rgb[2]));
+      StoreInterleavedUInt8x8(
+            is_bgr_format ? blue : red, green, is_bgr_format ? red : blue,
+            alpha, dst_channels, dst + dst_channels * i);
+    }
+  }
+  ScalarUInt8().hsv2rgbx(
+        src + 3 * i, dst + dst_channels * i, num_pixels - i,
+        dst_channels, is_bgr_format);
+}
+
+
+/// AVX2 versions of the L*a*b* helpers, see the SSE4.1 implementations.
+VIREN2D_TARGET_AVX2 inline
+__m256 ClampUnitAVX2(__m256 x) {
+  return _mm256_min_ps(
+        _mm256_max_ps(x, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+}
+
+
+VIREN2D_TARGET_AVX2 inline
+__m256i RoundSaturateUInt8AVX2(__m256 x) {
+  x = _mm256_floor_ps(_mm256_add_ps(x, _mm256_set1_ps(0.5f)));
+  x = _mm256_min_ps(
+        _mm256_max_ps(x, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+  return _mm256_cvttps_epi32(x);
+}
+
+
+VIREN2D_TARGET_AVX2 inline
+__m256 InterpolateGammaLUTAVX2(const float *lut, __m256 x) {
+  const __m256 pos = _mm256_mul_ps(
+        x, _mm256_set1_ps(static_cast<float>(kGammaLUTSize)));
+  const __m256i idx = _mm256_min_epi32(
+        _mm256_cvttps_epi32(pos), _mm256_set1_epi32(kGammaLUTSize - 1));
+  const __m256 frac = _mm256_sub_ps(pos, _mm256_cvtepi32_ps(idx));
+  const __m256 lower = _mm256_i32gather_ps(lut, idx, 4);
+  const __m256 upper = _mm256_i32gather_ps(lut + 1, idx, 4);
+  return _mm256_add_ps(
+        lower, _mm256_mul_ps(frac, _mm256_sub_ps(upper, lower)));
+}
+
+
+VIREN2D_TARGET_AVX2 inline
+__m256 LabFAVX2(__m256 t) {
+  const __m256i bits = _mm256_add_epi32(
+        _mm256_cvttps_epi32(_mm256_mul_ps(
+          _mm256_cvtepi32_ps(_mm256_castps_si256(t)),
+          _mm256_set1_ps(1.0f / 3.0f))),
+        _mm256_set1_epi32(709921077));
+  __m256 y = _mm256_castsi256_ps(bits);
+  const __m256 two = _mm256_set1_ps(2.0f);
+  const __m256 three = _mm256_set1_ps(3.0f);
+  for (int iter = 0; iter < 3; ++iter) {
+    y = _mm256_div_ps(
+          _mm256_add_ps(
+            _mm256_mul_ps(two, y), _mm256_div_ps(t, _mm256_mul_ps(y, y))),
+          three);
+  }
+  const __m256 linear = _mm256_div_ps(
+        _mm256_add_ps(
+          _mm256_mul_ps(_mm256_set1_ps(kLabKappa), t), _mm256_set1_ps(16.0f)),
+        _mm256_set1_ps(116.0f));
+  return _mm256_blendv_ps(
+        linear, y, _mm256_cmp_ps(t, _mm256_set1_ps(kLabEpsilon), _CMP_GT_OQ));
+}
+
+
+VIREN2D_TARGET_AVX2 inline
+__m256 LabFInvAVX2(__m256 f) {
+  const __m256 f3 = _mm256_mul_ps(_mm256_mul_ps(f, f), f);
+  const __m256 linear = _mm256_div_ps(
+        _mm256_sub_ps(
+          _mm256_mul_ps(_mm256_set1_ps(116.0f), f), _mm256_set1_ps(16.0f)),
+        _mm256_set1_ps(kLabKappa));
+  return _mm256_blendv_ps(
+        linear, f3, _mm256_cmp_ps(f3, _mm256_set1_ps(kLabEpsilon), _CMP_GT_OQ));
+}
+
+
+VIREN2D_TARGET_AVX2 inline
+__m256 MatrixRowAVX2(const float *row, __m256 c0, __m256 c1, __m256 c2) {
+  return _mm256_add_ps(
+        _mm256_add_ps(
+          _mm256_mul_ps(_mm256_set1_ps(row[0]), c0),
+          _mm256_mul_ps(_mm256_set1_ps(row[1]), c1)),
+        _mm256_mul_ps(_mm256_set1_ps(row[2]), c2));
+}
+
+
+VIREN2D_TARGET_AVX2 inline
+void LinearRGB2LabAVX2(__m256 red, __m256 green, __m256 blue, __m256 *lab) {
+  const __m256 fx = LabFAVX2(MatrixRowAVX2(kRGB2XYZ, red, green, blue));
+  const __m256 fy = LabFAVX2(MatrixRowAVX2(kRGB2XYZ + 3, red, green, blue));
+  const __m256 fz = LabFAVX2(MatrixRowAVX2(kRGB2XYZ + 6, red, green, blue));
+  lab[0] = _mm256_sub_ps(
+        _mm256_mul_ps(_mm256_set1_ps(116.0f), fy), _mm256_set1_ps(16.0f));
+  lab[1] = _mm256_mul_ps(_mm256_set1_ps(500.0f), _mm256_sub_ps(fx, fy));
+  lab[2] = _mm256_mul_ps(_mm256_set1_ps(200.0f), _mm256_sub_ps(fy, fz));
+}
+
+
+VIREN2D_TARGET_AVX2 inline
+void Lab2LinearRGBAVX2(__m256 l, __m256 a, __m256 b, __m256 *rgb) {
+  const __m256 fy = _mm256_div_ps(
+        _mm256_add_ps(l, _mm256_set1_ps(16.0f)), _mm256_set1_ps(116.0f));
+  const __m256 fx = _mm256_add_ps(
+        fy, _mm256_div_ps(a, _mm256_set1_ps(500.0f)));
+  const __m256 fz = _mm256_sub_ps(
+        fy, _mm256_div_ps(b, _mm256_set1_ps(200.0f)));
+  const __m256 x = LabFInvAVX2(fx);
+  const __m256 y = LabFInvAVX2(fy);
+  const __m256 z = LabFInvAVX2(fz);
+  for (int k = 0; k < 3; ++k) {
+    rgb[k] = MatrixRowAVX2(kXYZ2RGB + 3 * k, x, y, z);
+  }
+}
+
+
+VIREN2D_TARGET_AVX2
+void RGBx2LabUInt8AVX2(
+    const uint8_t *src, uint8_t *dst, int64_t num_pixels,
+    int src_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((src_channels == 3) || (src_channels == 4)) {
+    const float *linearize = SRGBGamma().linearize_uint8;
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, src_channels, is_bgr_format);
+    const __m256 offset = _mm256_set1_ps(kLabABOffset);
+    const int64_t min_remaining = (src_channels == 4) ? 8 : 10;
+    for (; i + min_remaining <= num_pixels; i += 8) {
+      __m128i px[2];
+      __m256i red, green, blue;
+      DeinterleaveRGBUInt8x8(
+            src + src_channels * i, src_channels, shuffles,
+            px, red, green, blue);
+      __m256 lab[3];
+      LinearRGB2LabAVX2(
+            _mm256_i32gather_ps(linearize, red, 4),
+            _mm256_i32gather_ps(linearize, green, 4),
+            _mm256_i32gather_ps(linearize, blue, 4), lab);
+      StoreInterleavedUInt8x8(
+            RoundSaturateUInt8AVX2(
+              _mm256_mul_ps(_mm256_set1_ps(kLabLToUInt8), lab[0])),
+            RoundSaturateUInt8AVX2(_mm256_add_ps(lab[1], offset)),
+            RoundSaturateUInt8AVX2(_mm256_add_ps(lab[2], offset)),
+            _mm256_setzero_si256(), 3, dst + 3 * i);
+    }
+  }
+  ScalarUInt8().rgbx2lab(
+        src + src_channels * i, dst + 3 * i, num_pixels - i,
+        src_channels, is_bgr_format);
+}
+
+
+VIREN2D_TARGET_AVX2
+void Lab2RGBxUInt8AVX2(
+    const uint8_t *src, uint8_t *dst, int64_t num_pixels,
+    int dst_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((dst_channels == 3) || (dst_channels == 4)) {
+    const float *compress = SRGBGamma().compress;
+    __m128i shuffles[4];
+    RGBx2GrayShuffles(shuffles, 3, false);
+    const __m256 offset = _mm256_set1_ps(kLabABOffset);
+    const __m256 scale = _mm256_set1_ps(255.0f);
+    for (; i + 10 <= num_pixels; i += 8) {
+      __m128i px[2];
+      __m256i l, a, b;
+      DeinterleaveRGBUInt8x8(src + 3 * i, 3, shuffles, px, l, a, b);
+      __m256 rgb[3];
+      Lab2LinearRGBAVX2(
+            _mm256_mul_ps(
+              _mm256_set1_ps(kLabLFromUInt8), _mm256_cvtepi32_ps(l)),
+            _mm256_sub_ps(_mm256_cvtepi32_ps(a), offset),
+            _mm256_sub_ps(_mm256_cvtepi32_ps(b), offset), rgb);
+      __m256i out[3];
+      for (int k = 0; k < 3; ++k) {
+        out[k] = RoundSaturateUInt8AVX2(_mm256_mul_ps(
+              scale, InterpolateGammaLUTAVX2(
+                compress, ClampUnitAVX2(rgb[k]))));
+      }
+      StoreInterleavedUInt8x8(
+            out[is_bgr_format ? 2 : 0], out[1], out[is_bgr_format ? 0 : 2],
+            _mm256_set1_epi32(255), dst_channels, dst + dst_channels * i);
+    }
+  }
+  ScalarUInt8().lab2rgbx(
+        src + 3 * i, dst + dst_channels * i, num_pixels - i,
+        dst_channels, is_bgr_format);
+}
+
+
+VIREN2D_TARGET_AVX2 inline
+__m256i WithinRangeUInt8AVX2(__m256i x, __m256i lower, __m256i upper) {
+  return _mm256_and_si256(
+        _mm256_cmpeq_epi8(_mm256_max_epu8(x, lower), x),
+        _mm256_cmpeq_epi8(_mm256_min_epu8(x, upper), x));
+}
+
+
+VIREN2D_TARGET_AVX2
+void MaskRangeBitsUInt8AVX2(
+    const uint8_t *src, uint64_t *bits, int64_t num_pixels,
+    int channels, const uint8_t *min_max) {
+  int64_t i = 0;
+  if ((channels == 1) || (channels == 3) || (channels == 4)) {
+    alignas(16) uint8_t lower_bytes[16];
+    alignas(16) uint8_t upper_bytes[16];
+    RangeBoundsUInt8(min_max, channels, lower_bytes, upper_bytes);
+    const __m256i lower = _mm256_broadcastsi128_si256(_mm_load_si128(
+          reinterpret_cast<const __m128i *>(lower_bytes)));
+    const __m256i upper = _mm256_broadcastsi128_si256(_mm_load_si128(
+          reinterpret_cast<const __m128i *>(upper_bytes)));
+    const __m256i expand = _mm256_broadcastsi128_si256(ExpandRGBShuffle());
+    const __m256i all_set = _mm256_set1_epi32(-1);
+    const int64_t overlap = (channels == 3) ? 2 : 0;
+    for (; i + 64 + overlap <= num_pixels; i += 64) {
+      uint64_t word = 0;
+      if (channels == 1) {
+        for (int k = 0; k < 2; ++k) {
+          const __m256i x = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(src + i + 32 * k));
+          const uint32_t within = static_cast<uint32_t>(_mm256_movemask_epi8(
+                WithinRangeUInt8AVX2(x, lower, upper)));
+          word |= static_cast<uint64_t>(within) << (32 * k);
+        }
+      } else {
+        for (int k = 0; k < 8; ++k) {
+          const uint8_t *px = src + channels * (i + 8 * k);
+          __m256i x;
+          if (channels == 3) {
+            // Each lane holds 4 pixels, i.e. 12 bytes
+            x = _mm256_shuffle_epi8(
+                  _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(_mm_loadu_si128(
+                      reinterpret_cast<const __m128i *>(px))),
+                    _mm_loadu_si128(
+                      reinterpret_cast<const __m128i *>(px + 12)), 1),
+                  expand);
+          } else {
+            x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(px));
+          }
+          const __m256i within = _mm256_cmpeq_epi32(
+                WithinRangeUInt8AVX2(x, lower, upper), all_set);
+          word |= static_cast<uint64_t>(
+                _mm256_movemask_ps(_mm256_castsi256_ps(within))) << (8 * k);
+        }
+      }
+      bits[i / 64] = word;
+    }
+  }
+  ScalarUInt8().mask_range_bits(
+        src + channels * i, bits + i / 64, num_pixels - i, channels, min_max);
+}
+
+
+VIREN2D_TARGET_AVX2
+void PackBitsUInt8AVX2(
+    const uint8_t *src, uint64_t *bits, int64_t num_pixels, int channels) {
+  int64_t i = 0;
+  if (channels == 1) {
+    const __m256i zero = _mm256_setzero_si256();
+    for (; i + 64 <= num_pixels; i += 64) {
+      uint64_t word = 0;
+      for (int k = 0; k < 2; ++k) {
+        const __m256i x = _mm256_loadu_si256(
+              reinterpret_cast<const __m256i *>(src + i + 32 * k));
+        const uint32_t is_zero = static_cast<uint32_t>(
+              _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, zero)));
+        word |= static_cast<uint64_t>(~is_zero) << (32 * k);
+      }
+      bits[i / 64] = word;
+    }
+  }
+  ScalarUInt8().pack_bits(
+        src + channels * i, bits + i / 64, num_pixels - i, channels);
+}
+
+
+/// Fixed-point blend of 16 values (widened to 16 bit), see
+/// `BlendUInt16x8SSE41`.
+VIREN2D_TARGET_AVX2 inline
+__m256i BlendUInt16x16AVX2(__m256i value1, __m256i value2, __m256i weight2) {
+  const __m256i weight1 = _mm256_sub_epi16(_mm256_set1_epi16(256), weight2);
+  const __m256i sum = _mm256_add_epi16(
+        _mm256_add_epi16(
+          _mm256_mullo_epi16(value1, weight1),
+          _mm256_mullo_epi16(value2, weight2)),
+        _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(sum, 8);
+}
+
+
+/// Fixed-point blend of 32 values with separate weights for the
+/// lower and upper 16 values.
+VIREN2D_TARGET_AVX2 inline
+__m256i BlendUInt8x32AVX2(
+    __m256i value1, __m256i value2,
+    __m256i weight2_low, __m256i weight2_high) {
+  const __m256i low = BlendUInt16x16AVX2(
+        _mm256_cvtepu8_epi16(_mm256_castsi256_si128(value1)),
+        _mm256_cvtepu8_epi16(_mm256_castsi256_si128(value2)),
+        weight2_low);
+  const __m256i high = BlendUInt16x16AVX2(
+        _mm256_cvtepu8_epi16(_mm256_extracti128_si256(value1, 1)),
+        _mm256_cvtepu8_epi16(_mm256_extracti128_si256(value2, 1)),
+        weight2_high);
+  // Packing interleaves the 128-bit lanes
+  return _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+}
+
+
+VIREN2D_TARGET_AVX2
+void BlendConstantUInt8AVX2(
+    const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
+    int64_t num_elements, uint16_t weight2) {
+  int64_t i = 0;
+  const __m256i weight = _mm256_set1_epi16(static_cast<int16_t>(weight2));
+  for (; i + 32 <= num_elements; i += 32) {
+    const __m256i value1 = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(src1 + i));
+    const __m256i value2 = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(src2 + i));
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(dst + i),
+          BlendUInt8x32AVX2(value1, value2, weight, weight));
+  }
+  BlendConstantUInt8SSE41(
+        src1 + i, src2 + i, dst + i, num_elements - i, weight2);
+}
+
+
+/// Blends `num_elements` values with a fixed-point weight per element.
+VIREN2D_TARGET_AVX2
+void BlendFixedPointWeightsUInt8AVX2(
+    const uint8_t *src1, const uint8_t *src2, const uint16_t *weights2,
+    uint8_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 32 <= num_elements; i += 32) {
+    const __m256i value1 = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(src1 + i));
+    const __m256i value2 = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(src2 + i));
+    const __m256i weight_low = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(weights2 + i));
+    const __m256i weight_high = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(weights2 + i + 16));
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(dst + i),
+          BlendUInt8x32AVX2(value1, value2, weight_low, weight_high));
+  }
+  BlendFixedPointWeightsUInt8SSE41(
+        src1 + i, src2 + i, weights2 + i, dst + i, num_elements - i);
+}
+
+
+VIREN2D_TARGET_AVX2
+void BlendWeightsUInt8AVX2(
+    const uint8_t *src1, const uint8_t *src2, const float *weights2,
+    uint8_t *dst, int64_t num_pixels, int channels, int weight_channels) {
+  BlendFloatWeightsUInt8(
+        src1, src2, weights2, dst, num_pixels, channels, weight_channels,
+        BlendFixedPointWeightsUInt8AVX2);
+}
+
+
+/// Composites 4 overlay pixels over 4 pixels with 4-byte lanes, where
+/// all values have been widened to 16 bit, see `CompositeUInt16x8SSE41`.
+VIREN2D_TARGET_AVX2 inline
+__m256i CompositeUInt16x16AVX2(__m256i src, __m256i overlay) {
+  __m256i weight = _mm256_shuffle_epi8(
+        overlay, _mm256_setr_epi8(
+          6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15,
+          6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15));
+  weight = _mm256_add_epi16(weight, _mm256_srli_epi16(weight, 7));
+  const __m256i remaining = _mm256_add_epi16(
+        _mm256_mullo_epi16(
+          src, _mm256_sub_epi16(_mm256_set1_epi16(256), weight)),
+        _mm256_set1_epi16(128));
+  const __m256i colors = _mm256_srli_epi16(
+        _mm256_add_epi16(remaining, _mm256_mullo_epi16(overlay, weight)), 8);
+  const __m256i alpha = _mm256_add_epi16(
+        overlay, _mm256_srli_epi16(remaining, 8));
+  return _mm256_blend_epi16(colors, alpha, 0x88);
+}
+
+
+VIREN2D_TARGET_AVX2
+void AlphaCompositeUInt8AVX2(
+    const uint8_t *src, const uint8_t *overlay, uint8_t *dst,
+    int64_t num_pixels, int channels) {
+  int64_t i = 0;
+  // 3-channel inputs are expanded per 4 pixels, which does not
+  // benefit from the wider registers.
+  if (channels == 4) {
+    for (; i + 8 <= num_pixels; i += 8) {
+      const __m256i px = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(src + 4 * i));
+      const __m256i over = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(overlay + 4 * i));
+      const __m256i low = CompositeUInt16x16AVX2(
+            _mm256_cvtepu8_epi16(_mm256_castsi256_si128(px)),
+            _mm256_cvtepu8_epi16(_mm256_castsi256_si128(over)));
+      const __m256i high = CompositeUInt16x16AVX2(
+            _mm256_cvtepu8_epi16(_mm256_extracti128_si256(px, 1)),
+            _mm256_cvtepu8_epi16(_mm256_extracti128_si256(over, 1)));
+      _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(dst + 4 * i),
+            _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8));
+    }
+  }
+  AlphaCompositeUInt8SSE41(
+        src + channels * i, overlay + 4 * i, dst + channels * i,
+        num_pixels - i, channels);
+}
+
+
+//---------------------------------------------------- AVX2 float
+VIREN2D_TARGET_AVX2
+void RGBx2GrayFloatAVX2(
+    const float *src, float *dst, int64_t num_pixels,
+    int src_channels, int dst_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((src_channels == 3) || (src_channels == 4)) {
+    const int ch_r = is_bgr_format ? 2 : 0;
+    const int ch_b = is_bgr_format ? 0 : 2;
+    const int c = src_channels;
+    const __m256d wr = _mm256_set1_pd(kWeightRed);
+    const __m256d wg = _mm256_set1_pd(kWeightGreen);
+    const __m256d wb = _mm256_set1_pd(kWeightBlue);
+    alignas(16) float luminance[4];
+    for (; i + 4 <= num_pixels; i += 4) {
+      const float *px = src + c * i;
+      const __m128 red = _mm_setr_ps(
+            px[ch_r], px[c + ch_r], px[2 * c + ch_r], px[3 * c + ch_r]);
+      const __m128 green = _mm_setr_ps(
+            px[1], px[c + 1], px[2 * c + 1], px[3 * c + 1]);
+      const __m128 blue = _mm_setr_ps(
+            px[ch_b], px[c + ch_b], px[2 * c + ch_b], px[3 * c + ch_b]);
+      const __m128 lum = _mm256_cvtpd_ps(_mm256_add_pd(
+            _mm256_add_pd(
+              _mm256_mul_pd(wr, _mm256_cvtps_pd(red)),
+              _mm256_mul_pd(wg, _mm256_cvtps_pd(green))),
+            _mm256_mul_pd(wb, _mm256_cvtps_pd(blue))));
+      if (dst_channels == 1) {
+        _mm_storeu_ps(dst + i, lum);
+      } else {
+        _mm_store_ps(luminance, lum);
+        StoreGrayFloat(
+              luminance, px, src_channels, dst_channels,
+              dst + dst_channels * i);
+      }
+    }
+  }
+  ScalarFloat().rgbx2gray(
+        src + src_channels * i, dst + dst_channels * i, num_pixels - i,
+        src_channels, dst_channels, is_bgr_format);
+}
+
+
+VIREN2D_TARGET_AVX2
+void RGBx2LabFloatAVX2(
+    const float *src, float *dst, int64_t num_pixels,
+    int src_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((src_channels == 3) || (src_channels == 4)) {
+    const float *linearize = SRGBGamma().linearize;
+    const int ch_r = is_bgr_format ? 2 : 0;
+    const int ch_b = is_bgr_format ? 0 : 2;
+    const int c = src_channels;
+    const __m256i offsets = _mm256_mullo_epi32(
+          _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(c));
+    alignas(32) float lab_values[3][8];
+    for (; i + 8 <= num_pixels; i += 8) {
+      const float *px = src + c * i;
+      __m256 lab[3];
+      LinearRGB2LabAVX2(
+            InterpolateGammaLUTAVX2(linearize, ClampUnitAVX2(
+              _mm256_i32gather_ps(px + ch_r, offsets, 4))),
+            InterpolateGammaLUTAVX2(linearize, ClampUnitAVX2(
+              _mm256_i32gather_ps(px + 1, offsets, 4))),
+            InterpolateGammaLUTAVX2(linearize, ClampUnitAVX2(
+              _mm256_i32gather_ps(px + ch_b, offsets, 4))), lab);
+      for (int k = 0; k < 3; ++k) {
+        _mm256_store_ps(lab_values[k], lab[k]);
+      }
+      float *out = dst + 3 * i;
+      for (int p = 0; p < 8; ++p, out += 3) {
+        out[0] = lab_values[0][p];
+        out[1] = lab_values[1][p];
+        out[2] = lab_values[2][p];
+      }
+    }
+  }
+  ScalarFloat().rgbx2lab(
+        src + src_channels * i, dst + 3 * i, num_pixels - i,
+        src_channels, is_bgr_format);
+}
+
+
+VIREN2D_TARGET_AVX2
+void Lab2RGBxFloatAVX2(
+    const float *src, float *dst, int64_t num_pixels,
+    int dst_channels, bool is_bgr_format) {
+  int64_t i = 0;
+  if ((dst_channels == 3) || (dst_channels == 4)) {
+    const float *compress = SRGBGamma().compress;
+    const int ch_r = is_bgr_format ? 2 : 0;
+    const int ch_b = is_bgr_format ? 0 : 2;
+    const __m256i offsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    alignas(32) float rgb_values[3][8];
+    for (; i + 8 <= num_pixels; i += 8) {
+      const float *px = src + 3 * i;
+      __m256 rgb[3];
+      Lab2LinearRGBAVX2(
+            _mm256_i32gather_ps(px, offsets, 4),
+            _mm256_i32gather_ps(px + 1, offsets, 4),
+            _mm256_i32gather_ps(px + 2, offsets, 4), rgb);
+      for (int k = 0; k < 3; ++k) {
+        _mm256_store_ps(rgb_values[k], InterpolateGammaLUTAVX2(
+                          compress, ClampUnitAVX2(rgb[k])));
+      }
+      float *out = dst + dst_channels * i;
+      for (int p = 0; p < 8; ++p, out += dst_channels) {
+        out[ch_r] = rgb_values[0][p];
+        out[1] = rgb_values[1][p];
+        out[ch_b] = rgb_values[2][p];
+        if (dst_channels == 4) {
+          out[3] = 1.0f;
+        }
+      }
+    }
+  }
+  ScalarFloat().lab2rgbx(
+        src + 3 * i, dst + dst_channels * i, num_pixels - i,
+        dst_channels, is_bgr_format);
+}
+
+
+//---------------------------------------------------- SSE4.1 half precision
+// Without F16C, only bfloat16 can be converted efficiently, because it
+// just requires integer shifts & rounding.
+VIREN2D_TARGET_SSE41
+void BFloat16ToFloatSSE41(
+    const bfloat16_t *src, float *dst, int64_t num_elements) {
+  const __m128i zero = _mm_setzero_si128();
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const __m128i bfloat = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src + i));
+    _mm_storeu_ps(dst + i, _mm_castsi128_ps(_mm_unpacklo_epi16(zero, bfloat)));
+    _mm_storeu_ps(
+          dst + i + 4, _mm_castsi128_ps(_mm_unpackhi_epi16(zero, bfloat)));
+  }
+  HalfKernelsScalar().bfloat16_to_float(src + i, dst + i, num_elements - i);
+}
+
+
+/// Rounds to nearest even, NaNs are quieted, see `FloatToBFloat16Bits`.
+/// Returns the bfloat16 bits in the lower half of each 32-bit lane.
+VIREN2D_TARGET_SSE41
+inline __m128i RoundToBFloat16SSE41(__m128 values) {
+  const __m128i bits = _mm_castps_si128(values);
+  const __m128i upper = _mm_srli_epi32(bits, 16);
+  const __m128i bias = _mm_add_epi32(
+        _mm_and_si128(upper, _mm_set1_epi32(1)), _mm_set1_epi32(0x7FFF));
+  const __m128i rounded = _mm_srli_epi32(_mm_add_epi32(bits, bias), 16);
+  const __m128i is_nan = _mm_cmpgt_epi32(
+        _mm_and_si128(bits, _mm_set1_epi32(0x7FFFFFFF)),
+        _mm_set1_epi32(0x7F800000));
+  return _mm_blendv_epi8(
+        rounded, _mm_or_si128(upper, _mm_set1_epi32(0x40)), is_nan);
+}
+
+
+VIREN2D_TARGET_SSE41
+void FloatToBFloat16SSE41(
+    const float *src, bfloat16_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const __m128i low = RoundToBFloat16SSE41(_mm_loadu_ps(src + i));
+    const __m128i high = RoundToBFloat16SSE41(_mm_loadu_ps(src + i + 4));
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi32(low, high));
+  }
+  HalfKernelsScalar().float_to_bfloat16(src + i, dst + i, num_elements - i);
+}
+
+
+//---------------------------------------------------- AVX2 half precision
+// Binary16 conversions use F16C, which rounds to nearest even (regardless
+// of MXCSR) and handles subnormals, infinity & NaN like the scalar
+// implementation.
+VIREN2D_TARGET_AVX2_F16C
+void Float16ToFloatAVX2(
+    const float16_t *src, float *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    _mm256_storeu_ps(
+          dst + i, _mm256_cvtph_ps(_mm_loadu_si128(
+                                     reinterpret_cast<const __m128i *>(src + i))));
+  }
+  HalfKernelsScalar().float16_to_float(src + i, dst + i, num_elements - i);
+}
+
+
+VIREN2D_TARGET_AVX2_F16C
+void FloatToFloat16AVX2(
+    const float *src, float16_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst + i),
+          _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+  }
+  HalfKernelsScalar().float_to_float16(src + i, dst + i, num_elements - i);
+}
+
+
+VIREN2D_TARGET_AVX2
+void BFloat16ToFloatAVX2(
+    const bfloat16_t *src, float *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const __m256i bits = _mm256_slli_epi32(
+          _mm256_cvtepu16_epi32(_mm_loadu_si128(
+                                  reinterpret_cast<const __m128i *>(src + i))),
+          16);
+    _mm256_storeu_ps(dst + i, _mm256_castsi256_ps(bits));
+  }
+  HalfKernelsScalar().bfloat16_to_float(src + i, dst + i, num_elements - i);
+}
+
+
+/// AVX2 version of `RoundToBFloat16SSE41`.
+VIREN2D_TARGET_AVX2
+inline __m256i RoundToBFloat16AVX2(__m256 values) {
+  const __m256i bits = _mm256_castps_si256(values);
+  const __m256i upper = _mm256_srli_epi32(bits, 16);
+  const __m256i bias = _mm256_add_epi32(
+        _mm256_and_si256(upper, _mm256_set1_epi32(1)),
+        _mm256_set1_epi32(0x7FFF));
+  const __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(bits, bias), 16);
+  const __m256i is_nan = _mm256_cmpgt_epi32(
+        _mm256_and_si256(bits, _mm256_set1_epi32(0x7FFFFFFF)),
+        _mm256_set1_epi32(0x7F800000));
+  return _mm256_blendv_epi8(
+        rounded, _mm256_or_si256(upper, _mm256_set1_epi32(0x40)), is_nan);
+}
+
+
+VIREN2D_TARGET_AVX2
+void FloatToBFloat16AVX2(
+    const float *src, bfloat16_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    const __m256i low = RoundToBFloat16AVX2(_mm256_loadu_ps(src + i));
+    const __m256i high = RoundToBFloat16AVX2(_mm256_loadu_ps(src + i + 8));
+    // Packing operates on 128-bit lanes, thus the 64-bit blocks must
+    // be reordered afterwards.
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(dst + i),
+          _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), 0xD8));
+  }
+  FloatToBFloat16SSE41(src + i, dst + i, num_elements - i);
+}
+
+
+//---------------------------------------------------- SSE4.1 type casts
+// Casts to uint8 rely on the saturating packs. Floating point values are
+// clamped before truncation: `max(value, 0)` returns the second operand
+// if the comparison fails, which also maps NaN to 0.
+VIREN2D_TARGET_SSE41
+void Int16ToUInt8SSE41(
+    const int16_t *src, uint8_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    const __m128i low = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src + i));
+    const __m128i high = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src + i + 8));
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(low, high));
+  }
+  CastKernelsScalar().int16_to_uint8(src + i, dst + i, num_elements - i);
+}
+
+
+VIREN2D_TARGET_SSE41
+void UInt16ToUInt8SSE41(
+    const uint16_t *src, uint8_t *dst, int64_t num_elements) {
+  const __m128i max_value = _mm_set1_epi16(255);
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    const __m128i low = _mm_min_epu16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)),
+          max_value);
+    const __m128i high = _mm_min_epu16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8)),
+          max_value);
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(low, high));
+  }
+  CastKernelsScalar().uint16_to_uint8(src + i, dst + i, num_elements - i);
+}
+
+
+/// Packs 16 int32 values into uint8 with saturation.
+VIREN2D_TARGET_SSE41
+inline __m128i PackInt32ToUInt8SSE41(
+    __m128i v0, __m128i v1, __m128i v2, __m128i v3) {
+  return _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3));
+}
+
+
+VIREN2D_TARGET_SSE41
+void Int32ToUInt8SSE41(
+    const int32_t *src, uint8_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    const __m128i *ptr = reinterpret_cast<const __m128i *>(src + i);
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst + i),
+          PackInt32ToUInt8SSE41(
+            _mm_loadu_si128(ptr), _mm_loadu_si128(ptr + 1),
+            _mm_loadu_si128(ptr + 2), _mm_loadu_si128(ptr + 3)));
+  }
+  CastKernelsScalar().int32_to_uint8(src + i, dst + i, num_elements - i);
+}
+
+
+/// Scales, clamps to [0, 255] and truncates 4 floats.
+VIREN2D_TARGET_SSE41
+inline __m128i ScaleFloatToUInt8RangeSSE41(__m128 values, __m128 scale) {
+  const __m128 clamped = _mm_min_ps(
+        _mm_max_ps(_mm_mul_ps(values, scale), _mm_setzero_ps()),
+        _mm_set1_ps(255.0f));
+  return _mm_cvttps_epi32(clamped);
+}
+
+
+VIREN2D_TARGET_SSE41
+void FloatToUInt8SSE41(
+    const float *src, uint8_t *dst, int64_t num_elements, float scale) {
+  const __m128 vscale = _mm_set1_ps(scale);
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst + i),
+          PackInt32ToUInt8SSE41(
+            ScaleFloatToUInt8RangeSSE41(_mm_loadu_ps(src + i), vscale),
+            ScaleFloatToUInt8RangeSSE41(_mm_loadu_ps(src + i + 4), vscale),
+            ScaleFloatToUInt8RangeSSE41(_mm_loadu_ps(src + i + 8), vscale),
+            ScaleFloatToUInt8RangeSSE41(_mm_loadu_ps(src + i + 12), vscale)));
+  }
+  CastKernelsScalar().float_to_uint8(
+        src + i, dst + i, num_elements - i, scale);
+}
+
+
+/// Scales, clamps to [0, 255] and truncates 4 doubles.
+VIREN2D_TARGET_SSE41
+inline __m128i ScaleDoubleToUInt8RangeSSE41(const double *src, __m128d scale) {
+  const __m128d zero = _mm_setzero_pd();
+  const __m128d max_value = _mm_set1_pd(255.0);
+  const __m128d low = _mm_min_pd(
+        _mm_max_pd(_mm_mul_pd(_mm_loadu_pd(src), scale), zero), max_value);
+  const __m128d high = _mm_min_pd(
+        _mm_max_pd(_mm_mul_pd(_mm_loadu_pd(src + 2), scale), zero), max_value);
+  return _mm_unpacklo_epi64(_mm_cvttpd_epi32(low), _mm_cvttpd_epi32(high));
+}
+
+
+VIREN2D_TARGET_SSE41
+void DoubleToUInt8SSE41(
+    const double *src, uint8_t *dst, int64_t num_elements, double scale) {
+  const __m128d vscale = _mm_set1_pd(scale);
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst + i),
+          PackInt32ToUInt8SSE41(
+            ScaleDoubleToUInt8RangeSSE41(src + i, vscale),
+            ScaleDoubleToUInt8RangeSSE41(src + i + 4, vscale),
+            ScaleDoubleToUInt8RangeSSE41(src + i + 8, vscale),
+            ScaleDoubleToUInt8RangeSSE41(src + i + 12, vscale)));
+  }
+  CastKernelsScalar().double_to_uint8(
+        src + i, dst + i, num_elements - i, scale);
+}
+
+
+VIREN2D_TARGET_SSE41
+void UInt8ToFloatSSE41(
+    const uint8_t *src, float *dst, int64_t num_elements, float scale) {
+  const __m128 vscale = _mm_set1_ps(scale);
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    for (int block = 0; block < 4; ++block) {
+      _mm_storeu_ps(
+            dst + i + 4 * block,
+            _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(values)), vscale));
+      values = _mm_srli_si128(values, 4);
+    }
+  }
+  CastKernelsScalar().uint8_to_float(src + i, dst + i, num_elements - i, scale);
+}
+
+
+VIREN2D_TARGET_SSE41
+void Int16ToFloatSSE41(
+    const int16_t *src, float *dst, int64_t num_elements, float scale) {
+  const __m128 vscale = _mm_set1_ps(scale);
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const __m128i values = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src + i));
+    _mm_storeu_ps(
+          dst + i,
+          _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(values)), vscale));
+    _mm_storeu_ps(
+          dst + i + 4,
+          _mm_mul_ps(_mm_cvtepi32_ps(
+                       _mm_cvtepi16_epi32(_mm_srli_si128(values, 8))), vscale));
+  }
+  CastKernelsScalar().int16_to_float(src + i, dst + i, num_elements - i, scale);
+}
+
+
+VIREN2D_TARGET_SSE41
+void UInt16ToFloatSSE41(
+    const uint16_t *src, float *dst, int64_t num_elements, float scale) {
+  const __m128 vscale = _mm_set1_ps(scale);
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const __m128i values = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src + i));
+    _mm_storeu_ps(
+          dst + i,
+          _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu16_epi32(values)), vscale));
+    _mm_storeu_ps(
+          dst + i + 4,
+          _mm_mul_ps(_mm_cvtepi32_ps(
+                       _mm_cvtepu16_epi32(_mm_srli_si128(values, 8))), vscale));
+  }
+  CastKernelsScalar().uint16_to_float(
+        src + i, dst + i, num_elements - i, scale);
+}
+
+
+VIREN2D_TARGET_SSE41
+void Int32ToFloatSSE41(
+    const int32_t *src, float *dst, int64_t num_elements, float scale) {
+  const __m128 vscale = _mm_set1_ps(scale);
+  int64_t i = 0;
+  for (; i + 4 <= num_elements; i += 4) {
+    _mm_storeu_ps(
+          dst + i,
+          _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(
+                                       reinterpret_cast<const __m128i *>(src + i))),
+                     vscale));
+  }
+  CastKernelsScalar().int32_to_float(src + i, dst + i, num_elements - i, scale);
+}
+
+
+VIREN2D_TARGET_SSE41
+void DoubleToFloatSSE41(
+    const double *src, float *dst, int64_t num_elements, double scale) {
+  const __m128d vscale = _mm_set1_pd(scale);
+  int64_t i = 0;
+  for (; i + 4 <= num_elements; i += 4) {
+    const __m128 low = _mm_cvtpd_ps(_mm_mul_pd(_mm_loadu_pd(src + i), vscale));
+    const __m128 high = _mm_cvtpd_ps(
+          _mm_mul_pd(_mm_loadu_pd(src + i + 2), vscale));
+    _mm_storeu_ps(dst + i, _mm_movelh_ps(low, high));
+  }
+  CastKernelsScalar().double_to_float(
+        src + i, dst + i, num_elements - i, scale);
+}
+
+
+//---------------------------------------------------- AVX2 type casts
+// Packing operates on 128-bit lanes, thus the results are reordered
+// afterwards (like in `FloatToBFloat16AVX2`).
+VIREN2D_TARGET_AVX2
+void Int16ToUInt8AVX2(
+    const int16_t *src, uint8_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 32 <= num_elements; i += 32) {
+    const __m256i low = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(src + i));
+    const __m256i high = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(src + i + 16));
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(dst + i),
+          _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8));
+  }
+  Int16ToUInt8SSE41(src + i, dst + i, num_elements - i);
+}
+
+
+VIREN2D_TARGET_AVX2
+void UInt16ToUInt8AVX2(
+    const uint16_t *src, uint8_t *dst, int64_t num_elements) {
+  const __m256i max_value = _mm256_set1_epi16(255);
+  int64_t i = 0;
+  for (; i + 32 <= num_elements; i += 32) {
+    const __m256i low = _mm256_min_epu16(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)),
+          max_value);
+    const __m256i high = _mm256_min_epu16(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 16)),
+          max_value);
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(dst + i),
+          _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8));
+  }
+  UInt16ToUInt8SSE41(src + i, dst + i, num_elements - i);
+}
+
+
+/// Packs 32 int32 values into uint8 with saturation. After both packs,
+/// each lane holds 4-byte blocks in the order (v0, v1, v2, v3) of its
+/// half, which are then interleaved across lanes.
+VIREN2D_TARGET_AVX2
+inline __m256i PackInt32ToUInt8AVX2(
+    __m256i v0, __m256i v1, __m256i v2, __m256i v3) {
+  const __m256i packed = _mm256_packus_epi16(
+        _mm256_packs_epi32(v0, v1), _mm256_packs_epi32(v2, v3));
+  return _mm256_permutevar8x32_epi32(
+        packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+
+VIREN2D_TARGET_AVX2
+void Int32ToUInt8AVX2(
+    const int32_t *src, uint8_t *dst, int64_t num_elements) {
+  int64_t i = 0;
+  for (; i + 32 <= num_elements; i += 32) {
+    const __m256i *ptr = reinterpret_cast<const __m256i *>(src + i);
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(dst + i),
+          PackInt32ToUInt8AVX2(
+            _mm256_loadu_si256(ptr), _mm256_loadu_si256(ptr + 1),
+            _mm256_loadu_si256(ptr + 2), _mm256_loadu_si256(ptr + 3)));
+  }
+  Int32ToUInt8SSE41(src + i, dst + i, num_elements - i);
+}
+
+
+/// AVX2 version of `ScaleFloatToUInt8RangeSSE41`.
+VIREN2D_TARGET_AVX2
+inline __m256i ScaleFloatToUInt8RangeAVX2(__m256 values, __m256 scale) {
+  const __m256 clamped = _mm256_min_ps(
+        _mm256_max_ps(_mm256_mul_ps(values, scale), _mm256_setzero_ps()),
+        _mm256_set1_ps(255.0f));
+  return _mm256_cvttps_epi32(clamped);
+}
+
+
+VIREN2D_TARGET_AVX2
+void FloatToUInt8AVX2(
+    const float *src, uint8_t *dst, int64_t num_elements, float scale) {
+  const __m256 vscale = _mm256_set1_ps(scale);
+  int64_t i = 0;
+  for (; i + 32 <= num_elements; i += 32) {
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(dst + i),
+          PackInt32ToUInt8AVX2(
+            ScaleFloatToUInt8RangeAVX2(_mm256_loadu_ps(src + i), vscale),
+            ScaleFloatToUInt8RangeAVX2(_mm256_loadu_ps(src + i + 8), vscale),
+            ScaleFloatToUInt8RangeAVX2(_mm256_loadu_ps(src + i + 16), vscale),
+            ScaleFloatToUInt8RangeAVX2(_mm256_loadu_ps(src + i + 24), vscale)));
+  }
+  FloatToUInt8SSE41(src + i, dst + i, num_elements - i, scale);
+}
+
+
+/// Scales, clamps to [0, 255] and truncates 4 doubles.
+VIREN2D_TARGET_AVX2
+inline __m128i ScaleDoubleToUInt8RangeAVX2(const double *src, __m256d scale) {
+  const __m256d clamped = _mm256_min_pd(
+        _mm256_max_pd(_mm256_mul_pd(_mm256_loadu_pd(src), scale),
+                      _mm256_setzero_pd()),
+        _mm256_set1_pd(255.0));
+  return _mm256_cvttpd_epi32(clamped);
+}
+
+
+VIREN2D_TARGET_AVX2
+void DoubleToUInt8AVX2(
+    const double *src, uint8_t *dst, int64_t num_elements, double scale) {
+  const __m256d vscale = _mm256_set1_pd(scale);
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst + i),
+          PackInt32ToUInt8SSE41(
+            ScaleDoubleToUInt8RangeAVX2(src + i, vscale),
+            ScaleDoubleToUInt8RangeAVX2(src + i + 4, vscale),
+            ScaleDoubleToUInt8RangeAVX2(src + i + 8, vscale),
+            ScaleDoubleToUInt8RangeAVX2(src + i + 12, vscale)));
+  }
+  CastKernelsScalar().double_to_uint8(
+        src + i, dst + i, num_elements - i, scale);
+}
+
+
+VIREN2D_TARGET_AVX2
+void UInt8ToFloatAVX2(
+    const uint8_t *src, float *dst, int64_t num_elements, float scale) {
+  const __m256 vscale = _mm256_set1_ps(scale);
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    const __m128i values = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src + i));
+    _mm256_storeu_ps(
+          dst + i,
+          _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(values)),
+                        vscale));
+    _mm256_storeu_ps(
+          dst + i + 8,
+          _mm256_mul_ps(_mm256_cvtepi32_ps(
+                          _mm256_cvtepu8_epi32(_mm_srli_si128(values, 8))),
+                        vscale));
+  }
+  UInt8ToFloatSSE41(src + i, dst + i, num_elements - i, scale);
+}
+
+
+VIREN2D_TARGET_AVX2
+void Int16ToFloatAVX2(
+    const int16_t *src, float *dst, int64_t num_elements, float scale) {
+  const __m256 vscale = _mm256_set1_ps(scale);
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const __m256i values = _mm256_cvtepi16_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(values), vscale));
+  }
+  CastKernelsScalar().int16_to_float(src + i, dst + i, num_elements - i, scale);
+}
+
+
+VIREN2D_TARGET_AVX2
+void UInt16ToFloatAVX2(
+    const uint16_t *src, float *dst, int64_t num_elements, float scale) {
+  const __m256 vscale = _mm256_set1_ps(scale);
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const __m256i values = _mm256_cvtepu16_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(values), vscale));
+  }
+  CastKernelsScalar().uint16_to_float(
+        src + i, dst + i, num_elements - i, scale);
+}
+
+
+VIREN2D_TARGET_AVX2
+void Int32ToFloatAVX2(
+    const int32_t *src, float *dst, int64_t num_elements, float scale) {
+  const __m256 vscale = _mm256_set1_ps(scale);
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const __m256i values = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(values), vscale));
+  }
+  Int32ToFloatSSE41(src + i, dst + i, num_elements - i, scale);
+}
+
+
+VIREN2D_TARGET_AVX2
+void DoubleToFloatAVX2(
+    const double *src, float *dst, int64_t num_elements, double scale) {
+  const __m256d vscale = _mm256_set1_pd(scale);
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    _mm_storeu_ps(
+          dst + i,
+          _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_loadu_pd(src + i), vscale)));
+    _mm_storeu_ps(
+          dst + i + 4,
+          _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_loadu_pd(src + i + 4), vscale)));
+  }
+  DoubleToFloatSSE41(src + i, dst + i, num_elements - i, scale);
+}
+
+
+//---------------------------------------------------- Reductions
+/// Returns the index of the first value in [begin, end) which equals
+/// `value`, or -1.
+template <typename _Tp> inline
+int64_t FindFirstScalar(
+    const _Tp *src, int64_t begin, int64_t end, _Tp value) {
+  for (int64_t i = begin; i < end; ++i) {
+    if (src[i] == value) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+VIREN2D_TARGET_SSE41
+int64_t FindFirstUInt8SSE41(
+    const uint8_t *src, int64_t num_elements, uint8_t value) {
+  const __m128i target = _mm_set1_epi8(static_cast<char>(value));
+  int64_t i = 0;
+  for (; i + 16 <= num_elements; i += 16) {
+    const __m128i eq = _mm_cmpeq_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), target);
+    if (_mm_movemask_epi8(eq) != 0) {
+      return FindFirstScalar(src, i, i + 16, value);
+    }
+  }
+  return FindFirstScalar(src, i, num_elements, value);
+}
+
+
+VIREN2D_TARGET_SSE41
+int64_t FindFirstFloatSSE41(
+    const float *src, int64_t num_elements, float value) {
+  const __m128 target = _mm_set1_ps(value);
+  int64_t i = 0;
+  for (; i + 4 <= num_elements; i += 4) {
+    if (_mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(src + i), target)) != 0) {
+      return FindFirstScalar(src, i, i + 4, value);
+    }
+  }
+  return FindFirstScalar(src, i, num_elements, value);
+}
+
+
+/// Number of 16-byte vectors whose squares can be summed up in the 32-bit
+/// lanes of `_mm_madd_epi16` without overflow: 4096 * 4 * 255^2 < 2^31.
+constexpr int64_t kSquaresBlockSize = 4096;
+
+
+/// Finishes the uint8 statistics from the (uncentered) integer sums and
+/// the extrema of all `num_elements` values. The centered sums are exact
+/// integers, thus identical to the scalar results.
+VIREN2D_TARGET_SSE41
+void FinishStatisticsUInt8SSE41(
+    const uint8_t *src, int64_t num_elements, double offset,
+    uint64_t sum, uint64_t sum_squares, uint8_t min_val, uint8_t max_val,
+    RangeStatistics<uint8_t> *stats) {
+  RangeStatistics<uint8_t> result;
+  if (num_elements > 0) {
+    const int64_t off = static_cast<int64_t>(offset);
+    const int64_t total = static_cast<int64_t>(sum);
+    result.num_valid = num_elements;
+    result.sum = static_cast<double>(total - num_elements * off);
+    result.sum_squares = static_cast<double>(
+          static_cast<int64_t>(sum_squares) - 2 * off * total
+          + num_elements * off * off);
+    result.min_val = min_val;
+    result.max_val = max_val;
+    result.min_idx = FindFirstUInt8SSE41(src, num_elements, min_val);
+    result.max_idx = FindFirstUInt8SSE41(src, num_elements, max_val);
+  }
+  *stats = result;
+}
+
+
+VIREN2D_TARGET_SSE41
+void StatisticsUInt8SSE41(
+    const uint8_t *src, int64_t num_elements, double offset,
+    RangeStatistics<uint8_t> *stats) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i vmin = _mm_set1_epi8(-1);
+  __m128i vmax = zero;
+  __m128i vsum = zero;
+  __m128i vsum_squares = zero;
+  int64_t i = 0;
+  while (i + 16 <= num_elements) {
+    const int64_t block_end = std::min(
+          num_elements, i + 16 * kSquaresBlockSize);
+    __m128i squares = zero;
+    for (; i + 16 <= block_end; i += 16) {
+      const __m128i v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + i));
+      vmin = _mm_min_epu8(vmin, v);
+      vmax = _mm_max_epu8(vmax, v);
+      vsum = _mm_add_epi64(vsum, _mm_sad_epu8(v, zero));
+      const __m128i lo = _mm_cvtepu8_epi16(v);
+      const __m128i hi = _mm_unpackhi_epi8(v, zero);
+      squares = _mm_add_epi32(
+            squares,
+            _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+    }
+    vsum_squares = _mm_add_epi64(
+          vsum_squares,
+          _mm_add_epi64(
+            _mm_cvtepu32_epi64(squares),
+            _mm_cvtepu32_epi64(_mm_srli_si128(squares, 8))));
+  }
+
+  alignas(16) uint8_t mins[16];
+  alignas(16) uint8_t maxs[16];
+  alignas(16) uint64_t sums[2];
+  alignas(16) uint64_t sums_squares[2];
+  _mm_store_si128(reinterpret_cast<__m128i*>(mins), vmin);
+  _mm_store_si128(reinterpret_cast<__m128i*>(maxs), vmax);
+  _mm_store_si128(reinterpret_cast<__m128i*>(sums), vsum);
+  _mm_store_si128(reinterpret_cast<__m128i*>(sums_squares), vsum_squares);
+  uint8_t min_val = 255;
+  uint8_t max_val = 0;
+  for (int lane = 0; lane < 16; ++lane) {
+    min_val = std::min(min_val, mins[lane]);
+    max_val = std::max(max_val, maxs[lane]);
+  }
+  uint64_t sum = sums[0] + sums[1];
+  uint64_t sum_squares = sums_squares[0] + sums_squares[1];
+  for (; i < num_elements; ++i) {
+    const uint8_t val = src[i];
+    min_val = std::min(min_val, val);
+    max_val = std::max(max_val, val);
+    sum += val;
+    sum_squares += static_cast<uint64_t>(val) * val;
+  }
+  FinishStatisticsUInt8SSE41(
+        src, num_elements, offset, sum, sum_squares, min_val, max_val, stats);
+}
+
+
+VIREN2D_TARGET_AVX2
+void StatisticsUInt8AVX2(
+    const uint8_t *src, int64_t num_elements, double offset,
+    RangeStatistics<uint8_t> *stats) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i vmin = _mm256_set1_epi8(-1);
+  __m256i vmax = zero;
+  __m256i vsum = zero;
+  __m256i vsum_squares = zero;
+  int64_t i = 0;
+  while (i + 32 <= num_elements) {
+    const int64_t block_end = std::min(
+          num_elements, i + 32 * kSquaresBlockSize);
+    __m256i squares = zero;
+    for (; i + 32 <= block_end; i += 32) {
+      const __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + i));
+      vmin = _mm256_min_epu8(vmin, v);
+      vmax = _mm256_max_epu8(vmax, v);
+      vsum = _mm256_add_epi64(vsum, _mm256_sad_epu8(v, zero));
+      // Interleaving with zero permutes the values across the lanes,
+      // which doesn't matter for the sum
+      const __m256i lo = _mm256_unpacklo_epi8(v, zero);
+      const __m256i hi = _mm256_unpackhi_epi8(v, zero);
+      squares = _mm256_add_epi32(
+            squares,
+            _mm256_add_epi32(
+              _mm256_madd_epi16(lo, lo), _mm256_madd_epi16(hi, hi)));
+    }
+    vsum_squares = _mm256_add_epi64(
+          vsum_squares,
+          _mm256_add_epi64(
+            _mm256_cvtepu32_epi64(_mm256_castsi256_si128(squares)),
+            _mm256_cvtepu32_epi64(_mm256_extracti128_si256(squares, 1))));
+  }
+
+  alignas(32) uint8_t mins[32];
+  alignas(32) uint8_t maxs[32];
+  alignas(32) uint64_t sums[4];
+  alignas(32) uint64_t sums_squares[4];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(mins), vmin);
+  _mm256_store_si256(reinterpret_cast<__m256i*>(maxs), vmax);
+  _mm256_store_si256(reinterpret_cast<__m256i*>(sums), vsum);
+  _mm256_store_si256(reinterpret_cast<__m256i*>(sums_squares), vsum_squares);
+  uint8_t min_val = 255;
+  uint8_t max_val = 0;
+  for (int lane = 0; lane < 32; ++lane) {
+    min_val = std::min(min_val, mins[lane]);
+    max_val = std::max(max_val, maxs[lane]);
+  }
+  uint64_t sum = sums[0] + sums[1] + sums[2] + sums[3];
+  uint64_t sum_squares = sums_squares[0] + sums_squares[1]
+      + sums_squares[2] + sums_squares[3];
+  for (; i < num_elements; ++i) {
+    const uint8_t val = src[i];
+    min_val = std::min(min_val, val);
+    max_val = std::max(max_val, val);
+    sum += val;
+    sum_squares += static_cast<uint64_t>(val) * val;
+  }
+  FinishStatisticsUInt8SSE41(
+        src, num_elements, offset, sum, sum_squares, min_val, max_val, stats);
+}
+
+
+/// Finishes the float statistics from the partial results of all
+/// `num_elements` values, *i.e.* looks up the first occurrence of the
+/// extrema.
+VIREN2D_TARGET_SSE41
+void FinishStatisticsFloatSSE41(
+    const float *src, int64_t num_elements, RangeStatistics<float> *result) {
+  result->num_valid = num_elements - result->num_nan;
+  if (result->num_valid > 0) {
+    // Take the values from the input, so equal values of different sign
+    // (i.e. +0 and -0) are reported just like by the scalar kernel.
+    result->min_idx = FindFirstFloatSSE41(src, num_elements, result->min_val);
+    result->max_idx = FindFirstFloatSSE41(src, num_elements, result->max_val);
+    result->min_val = src[result->min_idx];
+    result->max_val = src[result->max_idx];
+  } else {
+    result->min_val = 0.0f;
+    result->max_val = 0.0f;
+  }
+}
+
+
+/// Accumulates the scalar tail of the float statistics.
+inline void StatisticsFloatTail(
+    const float *src, int64_t begin, int64_t end, double offset,
+    RangeStatistics<float> *result) {
+  for (int64_t i = begin; i < end; ++i) {
+    const float val = src[i];
+    if (val != val) {
+      ++result->num_nan;
+      continue;
+    }
+    result->min_val = std::min(result->min_val, val);
+    result->max_val = std::max(result->max_val, val);
+    const double centered = static_cast<double>(val) - offset;
+    result->sum += centered;
+    result->sum_squares += centered * centered;
+  }
+}
+
+
+VIREN2D_TARGET_SSE41
+void StatisticsFloatSSE41(
+    const float *src, int64_t num_elements, double offset,
+    RangeStatistics<float> *stats) {
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  const __m128d voffset = _mm_set1_pd(offset);
+  __m128 vmin = _mm_set1_ps(inf);
+  __m128 vmax = _mm_set1_ps(-inf);
+  __m128d vsum = _mm_setzero_pd();
+  __m128d vsum_squares = _mm_setzero_pd();
+  __m128i vnum_nan = _mm_setzero_si128();
+  int64_t i = 0;
+  for (; i + 4 <= num_elements; i += 4) {
+    const __m128 v = _mm_loadu_ps(src + i);
+    // MINPS/MAXPS return the second operand if the first one is NaN
+    vmin = _mm_min_ps(v, vmin);
+    vmax = _mm_max_ps(v, vmax);
+    const __m128i valid = _mm_castps_si128(_mm_cmpord_ps(v, v));
+    // The mask is -1 for NaN
+    vnum_nan = _mm_sub_epi32(vnum_nan, _mm_castps_si128(_mm_cmpunord_ps(v, v)));
+    const __m128d lo = _mm_and_pd(
+          _mm_sub_pd(_mm_cvtps_pd(v), voffset),
+          _mm_castsi128_pd(_mm_cvtepi32_epi64(valid)));
+    const __m128d hi = _mm_and_pd(
+          _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), voffset),
+          _mm_castsi128_pd(_mm_cvtepi32_epi64(_mm_srli_si128(valid, 8))));
+    vsum = _mm_add_pd(vsum, _mm_add_pd(lo, hi));
+    vsum_squares = _mm_add_pd(
+          vsum_squares, _mm_add_pd(_mm_mul_pd(lo, lo), _mm_mul_pd(hi, hi)));
+  }
+
+  alignas(16) float mins[4];
+  alignas(16) float maxs[4];
+  alignas(16) double sums[2];
+  alignas(16) double sums_squares[2];
+  alignas(16) uint32_t nans[4];
+  _mm_store_ps(mins, vmin);
+  _mm_store_ps(maxs, vmax);
+  _mm_store_pd(sums, vsum);
+  _mm_store_pd(sums_squares, vsum_squares);
+  _mm_store_si128(reinterpret_cast<__m128i*>(nans), vnum_nan);
+  RangeStatistics<float> result;
+  result.min_val = inf;
+  result.max_val = -inf;
+  for (int lane = 0; lane < 4; ++lane) {
+    result.min_val = std::min(result.min_val, mins[lane]);
+    result.max_val = std::max(result.max_val, maxs[lane]);
+    result.num_nan += nans[lane];
+  }
+  result.sum = sums[0] + sums[1];
+  result.sum_squares = sums_squares[0] + sums_squares[1];
+  StatisticsFloatTail(src, i, num_elements, offset, &result);
+  FinishStatisticsFloatSSE41(src, num_elements, &result);
+  *stats = result;
+}
+
+
+VIREN2D_TARGET_AVX2
+void StatisticsFloatAVX2(
+    const float *src, int64_t num_elements, double offset,
+    RangeStatistics<float> *stats) {
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  const __m256d voffset = _mm256_set1_pd(offset);
+  __m256 vmin = _mm256_set1_ps(inf);
+  __m256 vmax = _mm256_set1_ps(-inf);
+  __m256d vsum = _mm256_setzero_pd();
+  __m256d vsum_squares = _mm256_setzero_pd();
+  __m256i vnum_nan = _mm256_setzero_si256();
+  int64_t i = 0;
+  for (; i + 8 <= num_elements; i += 8) {
+    const __m256 v = _mm256_loadu_ps(src + i);
+    vmin = _mm256_min_ps(v, vmin);
+    vmax = _mm256_max_ps(v, vmax);
+    const __m256i valid = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_ORD_Q));
+    vnum_nan = _mm256_sub_epi32(
+          vnum_nan, _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q)));
+    const __m256d lo = _mm256_and_pd(
+          _mm256_sub_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(v)), voffset),
+          _mm256_castsi256_pd(
+            _mm256_cvtepi32_epi64(_mm256_castsi256_si128(valid))));
+    const __m256d hi = _mm256_and_pd(
+          _mm256_sub_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)), voffset),
+          _mm256_castsi256_pd(
+            _mm256_cvtepi32_epi64(_mm256_extracti128_si256(valid, 1))));
+    vsum = _mm256_add_pd(vsum, _mm256_add_pd(lo, hi));
+    vsum_squares = _mm256_add_pd(
+          vsum_squares,
+          _mm256_add_pd(_mm256_mul_pd(lo, lo), _mm256_mul_pd(hi, hi)));
+  }
+
+  alignas(32) float mins[8];
+  alignas(32) float maxs[8];
+  alignas(32) double sums[4];
+  alignas(32) double sums_squares[4];
+  alignas(32) uint32_t nans[8];
+  _mm256_store_ps(mins, vmin);
+  _mm256_store_ps(maxs, vmax);
+  _mm256_store_pd(sums, vsum);
+  _mm256_store_pd(sums_squares, vsum_squares);
+  _mm256_store_si256(reinterpret_cast<__m256i*>(nans), vnum_nan);
+  RangeStatistics<float> result;
+  result.min_val = inf;
+  result.max_val = -inf;
+  for (int lane = 0; lane < 8; ++lane) {
+    result.min_val = std::min(result.min_val, mins[lane]);
+    result.max_val = std::max(result.max_val, maxs[lane]);
+    result.num_nan += nans[lane];
+  }
+  result.sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+  result.sum_squares = (sums_squares[0] + sums_squares[1])
+      + (sums_squares[2] + sums_squares[3]);
+  StatisticsFloatTail(src, i, num_elements, offset, &result);
+  FinishStatisticsFloatSSE41(src, num_elements, &result);
+  *stats = result;
+}
+
+}  // anonymous namespace
+
+
+//---------------------------------------------------- Kernel tables
+template <>
+const ConversionKernels<uint8_t> *KernelsSSE41<uint8_t>() {
+  static const ConversionKernels<uint8_t> kernels = {
+    RGB2RGBAUInt8SSE41,
+    RGBA2RGBUInt8SSE41,
+    Gray2RGBUInt8SSE41,
+    Gray2RGBAUInt8SSE41,
+    SwapChannelsUInt8SSE41,
+    RGBx2GrayUInt8SSE41,
+    MaskHSVRangeUInt8SSE41,
+    ColorPopUInt8SSE41,
+    RGBx2HSVUInt8SSE41,
+    HSV2RGBxUInt8SSE41,
+    RGBx2LabUInt8SSE41,
+    Lab2RGBxUInt8SSE41,
+    MaskRangeBitsUInt8SSE41,
+    PackBitsUInt8SSE41,
+    BlendConstantUInt8SSE41,
+    BlendWeightsUInt8SSE41,
+    AlphaCompositeUInt8SSE41
+  };
+  return &kernels;
+}
+
+
+template <>
+const ConversionKernels<float> *KernelsSSE41<float>() {
+  static const ConversionKernels<float> kernels = {
+    RGB2RGBAFloatSSE41,
+    RGBA2RGBFloatSSE41,
+    Gray2RGBFloatSSE41,
+    Gray2RGBAFloatSSE41,
+    SwapChannelsFloatSSE41,
+    RGBx2GrayFloatSSE41,
+    ScalarFloat().mask_hsv_range,
+    ScalarFloat().color_pop,
+    ScalarFloat().rgbx2hsv,
+    ScalarFloat().hsv2rgbx,
+    RGBx2LabFloatSSE41,
+    Lab2RGBxFloatSSE41,
+    ScalarFloat().mask_range_bits,
+    ScalarFloat().pack_bits,
+    ScalarFloat().blend_constant,
+    ScalarFloat().blend_weights,
+    ScalarFloat().alpha_composite
+  };
+  return &kernels;
+}
+
+
+template <>
+const ConversionKernels<uint8_t> *KernelsAVX2<uint8_t>() {
+  // Gray to RGB is already bandwidth-bound with SSE4.1
+  static const ConversionKernels<uint8_t> kernels = {
+    RGB2RGBAUInt8AVX2,
+    RGBA2RGBUInt8AVX2,
+    Gray2RGBUInt8SSE41,
+    Gray2RGBAUInt8AVX2,
+    SwapChannelsUInt8AVX2,
+    RGBx2GrayUInt8AVX2,
+    MaskHSVRangeUInt8AVX2,
+    ColorPopUInt8AVX2,
+    RGBx2HSVUInt8AVX2,
+    HSV2RGBxUInt8AVX2,
+    RGBx2LabUInt8AVX2,
+    Lab2RGBxUInt8AVX2,
+    MaskRangeBitsUInt8AVX2,
+    PackBitsUInt8AVX2,
+    BlendConstantUInt8AVX2,
+    BlendWeightsUInt8AVX2,
+    AlphaCompositeUInt8AVX2
+  };
+  return &kernels;
+}
+
+
+template <>
+const ConversionKernels<float> *KernelsAVX2<float>() {
+  // The float conversions are bandwidth-bound with SSE4.1,
+  // only the luminance & L*a*b* computations benefit from AVX. The
+  // HSV, bit mask & blending kernels are only vectorized for uint8.
+  static const ConversionKernels<float> kernels = {
+    RGB2RGBAFloatSSE41,
+    RGBA2RGBFloatSSE41,
+    Gray2RGBFloatSSE41,
+    Gray2RGBAFloatSSE41,
+    SwapChannelsFloatSSE41,
+    RGBx2GrayFloatAVX2,
+    ScalarFloat().mask_hsv_range,
+    ScalarFloat().color_pop,
+    ScalarFloat().rgbx2hsv,
+    ScalarFloat().hsv2rgbx,
+    RGBx2LabFloatAVX2,
+    Lab2RGBxFloatAVX2,
+    ScalarFloat().mask_range_bits,
+    ScalarFloat().pack_bits,
+    ScalarFloat().blend_constant,
+    ScalarFloat().blend_weights,
+    ScalarFloat().alpha_composite
+  };
+  return &kernels;
+}
+
+
+const HalfPrecisionKernels *HalfKernelsSSE41() {
+  static const HalfPrecisionKernels kernels = {
+    HalfKernelsScalar().float16_to_float,
+    HalfKernelsScalar().float_to_float16,
+    BFloat16ToFloatSSE41,
+    FloatToBFloat16SSE41
+  };
+  return &kernels;
+}
+
+
+const HalfPrecisionKernels *HalfKernelsAVX2() {
+  static const HalfPrecisionKernels kernels = {
+    Float16ToFloatAVX2,
+    FloatToFloat16AVX2,
+    BFloat16ToFloatAVX2,
+    FloatToBFloat16AVX2
+  };
+  return &kernels;
+}
+
+
+const TypeCastKernels *CastKernelsSSE41() {
+  static const TypeCastKernels kernels = {
+    Int16ToUInt8SSE41,
+    UInt16ToUInt8SSE41,
+    Int32ToUInt8SSE41,
+    FloatToUInt8SSE41,
+    DoubleToUInt8SSE41,
+    UInt8ToFloatSSE41,
+    Int16ToFloatSSE41,
+    UInt16ToFloatSSE41,
+    Int32ToFloatSSE41,
+    DoubleToFloatSSE41
+  };
+  return &kernels;
+}
+
+
+const TypeCastKernels *CastKernelsAVX2() {
+  static const TypeCastKernels kernels = {
+    Int16ToUInt8AVX2,
+    UInt16ToUInt8AVX2,
+    Int32ToUInt8AVX2,
+    FloatToUInt8AVX2,
+    DoubleToUInt8AVX2,
+    UInt8ToFloatAVX2,
+    Int16ToFloatAVX2,
+    UInt16ToFloatAVX2,
+    Int32ToFloatAVX2,
+    DoubleToFloatAVX2
+  };
+  return &kernels;
+}
+
+
+const ReductionKernels *ReduceKernelsSSE41() {
+  static const ReductionKernels kernels = {
+    StatisticsUInt8SSE41,
+    StatisticsFloatSSE41
+  };
+  return &kernels;
+}
+
+
+const ReductionKernels *ReduceKernelsAVX2() {
+  static const ReductionKernels kernels = {
+    StatisticsUInt8AVX2,
+    StatisticsFloatAVX2
+  };
+  return &kernels;
+}
+
+#else  // VIREN2D_SIMD_X86
+
+template <>
+const ConversionKernels<uint8_t> *KernelsSSE41<uint8_t>() {
+  return nullptr;
+}
+
+
+template <>
+const ConversionKernels<float> *KernelsSSE41<float>() {
+  return nullptr;
+}
+
+
+template <>
+const ConversionKernels<uint8_t> *KernelsAVX2<uint8_t>() {
+  return nullptr;
+}
+
+
+template <>
+const ConversionKernels<float> *KernelsAVX2<float>() {
+  return nullptr;
+}
+
+
+const HalfPrecisionKernels *HalfKernelsSSE41() {
+  return nullptr;
+}
+
+
+const HalfPrecisionKernels *HalfKernelsAVX2() {
+  return nullptr;
+}
+
+
+const TypeCastKernels *CastKernelsSSE41() {
+  return nullptr;
+}
+
+
+const TypeCastKernels *CastKernelsAVX2() {
+  return nullptr;
+}
+
+
+const ReductionKernels *ReduceKernelsSSE41() {
+  return nullptr;
+}
+
+
+const ReductionKernels *ReduceKernelsAVX2() {
+  return nullptr;
+}
+#endif  // VIREN2D_SIMD_X86
+
+}  // namespace simd
+}  // namespace helpers
+}  // namespace viren2d
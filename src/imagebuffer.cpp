@@ -9,6 +9,7 @@
 #include <utility> // pair
 #include <tuple>
 #include <functional> // std::function
+#include <atomic>
 
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -32,17 +33,24 @@
 #include <werkzeugkiste/strings/strings.h>
 
 #include <viren2d/imagebuffer.h>
+#include <viren2d/allocators.h>
+#include <helpers/allocators_helpers.h>
 #include <helpers/imagebuffer_helpers.impl.h>
+#include <helpers/imagebuffer_blur.h>
+#include <helpers/imagebuffer_copy.h>
+#include <helpers/imagebuffer_resize.h>
 
 
 #include <helpers/logging.h>
 #include <helpers/color_conversion.h>
+#include <helpers/simd_kernels.h>
 
 
 namespace viren2d {
 namespace helpers {
-ImageBuffer RGBx2HSV(
+void RGBx2HSV(
     const ImageBuffer &src,
+    ImageBuffer &dst,
     bool is_bgr_format) {
   SPDLOG_DEBUG(
         "ImageBuffer converting {:s} to HSV.",
@@ -55,7 +63,7 @@ ImageBuffer RGBx2HSV(
   }
 
   if ((src.BufferType() != ImageBufferType::UInt8)
-      || (src.Channels() < 2)
+      || (src.Channels() < 3)
       || (src.Channels() > 4)) {
     std::string msg(
           "Input to `RGB2HSV` must be 3- or 4-channel buffer of type `uint8`, "
@@ -66,37 +74,17 @@ ImageBuffer RGBx2HSV(
     throw std::invalid_argument(msg);
   }
 
-  // Create destination buffer (will have contiguous memory)
-  ImageBuffer dst(src.Height(), src.Width(), 3, ImageBufferType::UInt8);
-
-  int rows = src.Height();
-  int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
-  }
-
-  const int ch_r = is_bgr_format ? 2 : 0;
-  const int ch_b = is_bgr_format ? 0 : 2;
-
-  float hue, sat, val;
-  for (int row = 0; row < rows; ++row) {
-    unsigned char *dst_ptr = dst.MutablePtr<unsigned char>(row, 0, 0);
-    for (int col = 0; col < cols; ++col) {
-      std::tie(hue, sat, val) = CvtHelperRGB2HSV(
-            src.AtUnchecked<unsigned char>(row, col, ch_r) / 255.0f,
-            src.AtUnchecked<unsigned char>(row, col, 1) / 255.0f,
-            src.AtUnchecked<unsigned char>(row, col, ch_b) / 255.0f);
-
-      // Sacrifice angular resolution to fit into uint8:
-      *dst_ptr++ = static_cast<unsigned char>(hue / 2.0f);
-      *dst_ptr++ = static_cast<unsigned char>(255.0f * sat);
-      *dst_ptr++ = static_cast<unsigned char>(255.0f * val);
-    }
-  }
-
-  return dst;
+  // Reuse or create destination buffer (rows may be padded)
+  dst.EnsureShape(src.Height(), src.Width(), 3, ImageBufferType::UInt8);
+
+  const auto &kernels = simd::Kernels<uint8_t>();
+  const int channels = src.Channels();
+  ApplyRowKernelStrided<uint8_t>(
+        src, dst,
+        [&kernels, channels, is_bgr_format](
+          const uint8_t *src_ptr, uint8_t *dst_ptr, int64_t num_pixels) {
+    kernels.rgbx2hsv(src_ptr, dst_ptr, num_pixels, channels, is_bgr_format);
+  });
 }
 
 
@@ -125,43 +113,354 @@ ImageBuffer HSV2RGBx(
     throw std::invalid_argument(msg);
   }
 
-  // Create destination buffer (will have contiguous memory)
+  if ((output_channels < 3) || (output_channels > 4)) {
+    std::ostringstream msg;
+    msg << "Number of output channels in `HSV2RGB` must be 3 or 4, but got "
+        << output_channels << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  // Create destination buffer (rows may be padded)
   ImageBuffer dst(
         src.Height(), src.Width(), output_channels, ImageBufferType::UInt8);
 
+  const auto &kernels = simd::Kernels<uint8_t>();
+  ApplyRowKernelStrided<uint8_t>(
+        src, dst,
+        [&kernels, output_channels, request_bgr_format](
+          const uint8_t *src_ptr, uint8_t *dst_ptr, int64_t num_pixels) {
+    kernels.hsv2rgbx(
+          src_ptr, dst_ptr, num_pixels, output_channels, request_bgr_format);
+  });
+  return dst;
+}
+
+
+template <typename _Tp>
+void RGBx2LabHelper(
+    const ImageBuffer &src, ImageBuffer &dst, bool is_bgr_format) {
+  dst.EnsureShape(src.Height(), src.Width(), 3, src.BufferType());
+
+  const auto &kernels = simd::Kernels<_Tp>();
+  const int channels = src.Channels();
+  ApplyRowKernelStrided<_Tp>(
+        src, dst,
+        [&kernels, channels, is_bgr_format](
+          const _Tp *src_ptr, _Tp *dst_ptr, int64_t num_pixels) {
+    kernels.rgbx2lab(src_ptr, dst_ptr, num_pixels, channels, is_bgr_format);
+  });
+}
+
+
+void RGBx2Lab(
+    const ImageBuffer &src, ImageBuffer &dst, bool is_bgr_format) {
+  SPDLOG_DEBUG(
+        "ImageBuffer converting {:s} to L*a*b*.",
+        (is_bgr_format ? "BGR(A)" : "RGB(A)"));
+
+  if (!src.IsValid()) {
+    const std::string msg("Input ImageBuffer is invalid in `RGBx2Lab`!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  if ((src.Channels() < 3) || (src.Channels() > 4)) {
+    std::string msg(
+          "Input to `RGB2Lab` must be a 3- or 4-channel buffer, but got ");
+    msg += src.ToString();
+    msg += '!';
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
+
+  switch (src.BufferType()) {
+    case ImageBufferType::UInt8:
+      RGBx2LabHelper<uint8_t>(src, dst, is_bgr_format);
+      return;
+
+    case ImageBufferType::Float:
+      RGBx2LabHelper<float>(src, dst, is_bgr_format);
+      return;
+
+    case ImageBufferType::Int16:
+    case ImageBufferType::UInt16:
+    case ImageBufferType::Int32:
+    case ImageBufferType::UInt32:
+    case ImageBufferType::Int64:
+    case ImageBufferType::UInt64:
+    case ImageBufferType::Double:
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16: {
+        std::string msg(
+              "Conversion to L*a*b* is only supported for buffers of type "
+              "`uint8` or `float`, but got ");
+        msg += src.ToString();
+        msg += '!';
+        SPDLOG_ERROR(msg);
+        throw std::invalid_argument(msg);
+      }
+  }
+
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(src.BufferType());
+  msg += "` not handled in `RGBx2Lab` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
+template <typename _Tp>
+ImageBuffer Lab2RGBxHelper(
+    const ImageBuffer &src, int output_channels, bool request_bgr_format) {
+  ImageBuffer dst(
+        src.Height(), src.Width(), output_channels, src.BufferType());
+
+  const auto &kernels = simd::Kernels<_Tp>();
+  ApplyRowKernelStrided<_Tp>(
+        src, dst,
+        [&kernels, output_channels, request_bgr_format](
+          const _Tp *src_ptr, _Tp *dst_ptr, int64_t num_pixels) {
+    kernels.lab2rgbx(
+          src_ptr, dst_ptr, num_pixels, output_channels, request_bgr_format);
+  });
+  return dst;
+}
+
+
+ImageBuffer Lab2RGBx(
+    const ImageBuffer &src, int output_channels, bool request_bgr_format) {
+  SPDLOG_DEBUG(
+        "ImageBuffer converting L*a*b* to {:s}.",
+        (request_bgr_format ? "BGR(A)" : "RGB(A)"));
+
+  if (!src.IsValid()) {
+    const std::string msg("Input ImageBuffer is invalid in `Lab2RGBx`!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  if (src.Channels() != 3) {
+    std::string msg(
+          "Input to `Lab2RGB` must be a 3-channel buffer, but got ");
+    msg += src.ToString();
+    msg += '!';
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
+
+  if ((output_channels < 3) || (output_channels > 4)) {
+    std::ostringstream msg;
+    msg << "Number of output channels in `Lab2RGB` must be 3 or 4, but got "
+        << output_channels << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  switch (src.BufferType()) {
+    case ImageBufferType::UInt8:
+      return Lab2RGBxHelper<uint8_t>(src, output_channels, request_bgr_format);
+
+    case ImageBufferType::Float:
+      return Lab2RGBxHelper<float>(src, output_channels, request_bgr_format);
+
+    case ImageBufferType::Int16:
+    case ImageBufferType::UInt16:
+    case ImageBufferType::Int32:
+    case ImageBufferType::UInt32:
+    case ImageBufferType::Int64:
+    case ImageBufferType::UInt64:
+    case ImageBufferType::Double:
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16: {
+        std::string msg(
+              "Conversion from L*a*b* is only supported for buffers of type "
+              "`uint8` or `float`, but got ");
+        msg += src.ToString();
+        msg += '!';
+        SPDLOG_ERROR(msg);
+        throw std::invalid_argument(msg);
+      }
+  }
+
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(src.BufferType());
+  msg += "` not handled in `Lab2RGBx` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
+/// Quantizes the HSV thresholds (hue in [0, 360], saturation & value
+/// in [0, 1]) to the uint8 representation of `ConvertRGB2HSV`.
+simd::HSVRange QuantizeHSVRange(
+    const std::pair<float, float> &hue_range,
+    const std::pair<float, float> &saturation_range,
+    const std::pair<float, float> &value_range) {
+  const auto cvt_hue = [](float h) {
+    return static_cast<uint8_t>(std::max(0.0f, std::min(h, 360.0f)) / 2.0f);
+  };
+
+  const auto cvt_sv = [](float v) {
+    return static_cast<uint8_t>(255.0f * std::max(0.0f, std::min(v, 1.0f)));
+  };
+
+  return simd::HSVRange{
+    cvt_hue(hue_range.first), cvt_hue(hue_range.second),
+    cvt_sv(saturation_range.first), cvt_sv(saturation_range.second),
+    cvt_sv(value_range.first), cvt_sv(value_range.second)};
+}
+
+
+/// Sanity checks for the fused HSV range functions, which
+/// require a 3- or 4-channel uint8 color image.
+void CheckHSVRangeInput(const ImageBuffer &image, const char *func) {
+  if (!image.IsValid()) {
+    std::string msg("Cannot apply `");
+    msg += func;
+    msg += "` on invalid ImageBuffer!";
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  if ((image.Channels() < 3) || (image.Channels() > 4)
+      || (image.BufferType() != ImageBufferType::UInt8)) {
+    std::ostringstream msg;
+    msg << '`' << func << "` can only be applied on RGB(A)/BGR(A) input "
+           "buffers of type `uint8`, but got: " << image.ToString() << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+}
+
+
+/// Computes the mask of an RGB(A)/BGR(A) image (the HSV range test is
+/// evaluated per pixel, *i.e.* without an intermediate HSV image).
+void MaskRGBxHSVRange(
+    const ImageBuffer &src, ImageBuffer &mask,
+    const simd::HSVRange &range, bool is_bgr_format) {
+  mask.EnsureShape(src.Height(), src.Width(), 1, ImageBufferType::UInt8);
+
+  const int channels = src.Channels();
+  if (HasPackedPixels(src) && HasPackedPixels(mask)) {
+    const auto &kernels = simd::Kernels<uint8_t>();
+    ApplyRowKernel<uint8_t>(
+          src, mask,
+          [&kernels, &range, channels, is_bgr_format](
+            const uint8_t *src_ptr, uint8_t *mask_ptr, int64_t num_pixels) {
+      kernels.mask_hsv_range(
+            src_ptr, mask_ptr, num_pixels, channels, is_bgr_format, range);
+    });
+    return;
+  }
+
+  int rows = src.Height();
+  int cols = src.Width();
+  if (src.IsFlattenable() && mask.IsFlattenable()) {
+    cols *= rows;
+    rows = 1;
+  }
+
+  const int ch_r = is_bgr_format ? 2 : 0;
+  const int ch_b = is_bgr_format ? 0 : 2;
+
+  const PixelWriter out(mask);
+  ParallelForPixels(
+        rows, cols, 16,
+        [&](int row, int col_begin, int col_end) {
+    unsigned char *mask_ptr = out.Ptr<unsigned char>(row, col_begin, 0);
+    unsigned char hsv[3];
+    for (int col = col_begin; col < col_end; ++col) {
+      CvtHelperRGB2HSVUInt8(
+            src.AtUnchecked<unsigned char>(row, col, ch_r),
+            src.AtUnchecked<unsigned char>(row, col, 1),
+            src.AtUnchecked<unsigned char>(row, col, ch_b), hsv);
+      *mask_ptr++ = range.Contains(hsv) ? 255 : 0;
+    }
+  });
+}
+
+
+/// Fused color pop, *i.e.* each pixel is either copied or replaced
+/// by its luminance, depending on the per-pixel HSV range test.
+void ColorPopRGBx(
+    const ImageBuffer &src, ImageBuffer &dst,
+    const simd::HSVRange &range, bool is_bgr_format) {
+  const int channels = src.Channels();
+  dst.EnsureShape(src.Height(), src.Width(), channels, ImageBufferType::UInt8);
+
+  if (HasPackedPixels(src) && HasPackedPixels(dst)) {
+    const auto &kernels = simd::Kernels<uint8_t>();
+    ApplyRowKernel<uint8_t>(
+          src, dst,
+          [&kernels, &range, channels, is_bgr_format](
+            const uint8_t *src_ptr, uint8_t *dst_ptr, int64_t num_pixels) {
+      kernels.color_pop(
+            src_ptr, dst_ptr, num_pixels, channels, is_bgr_format, range);
+    });
+    return;
+  }
+
   int rows = src.Height();
   int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
+  if (src.IsFlattenable() && dst.IsFlattenable()) {
     cols *= rows;
     rows = 1;
   }
 
-  const int ch_r = request_bgr_format ? 2 : 0;
-  const int ch_b = request_bgr_format ? 0 : 2;
-
-  float r, g, b;
-  for (int row = 0; row < rows; ++row) {
-    unsigned char *dst_ptr = dst.MutablePtr<unsigned char>(row, 0, 0);
-    const unsigned char *src_ptr = dst.ImmutablePtr<unsigned char>(row, 0, 0);
-    for (int col = 0; col < cols; ++col) {
-      std::tie(r, g, b) = CvtHelperHSV2RGB(
-          src_ptr[0] * 2.0f,  // Hue input in [0, 180]
-          src_ptr[1] / 255.0f,  // Saturation input in [0, 255]
-          src_ptr[2] / 255.0f); // Value input in [0, 255]
-
-      dst_ptr[ch_r] = static_cast<unsigned char>(255.0f * r);
-      dst_ptr[1] = static_cast<unsigned char>(255.0f * g);
-      dst_ptr[ch_b] = static_cast<unsigned char>(255.0f * b);
-      if (output_channels == 4) {
-        dst_ptr[3] = 255;
+  const int ch_r = is_bgr_format ? 2 : 0;
+  const int ch_b = is_bgr_format ? 0 : 2;
+
+  const PixelWriter out(dst);
+  ParallelForPixels(
+        rows, cols, 16,
+        [&](int row, int col_begin, int col_end) {
+    unsigned char *dst_ptr = out.Ptr<unsigned char>(row, col_begin, 0);
+    unsigned char hsv[3];
+    for (int col = col_begin; col < col_end; ++col) {
+      const unsigned char red = src.AtUnchecked<unsigned char>(row, col, ch_r);
+      const unsigned char green = src.AtUnchecked<unsigned char>(row, col, 1);
+      const unsigned char blue = src.AtUnchecked<unsigned char>(row, col, ch_b);
+      CvtHelperRGB2HSVUInt8(red, green, blue, hsv);
+      if (range.Contains(hsv)) {
+        for (int ch = 0; ch < channels; ++ch) {
+          dst_ptr[ch] = src.AtUnchecked<unsigned char>(row, col, ch);
+        }
+      } else {
+        const unsigned char luminance = CvtHelperRGB2Gray(red, green, blue);
+        dst_ptr[0] = luminance;
+        dst_ptr[1] = luminance;
+        dst_ptr[2] = luminance;
+        if (channels == 4) {
+          dst_ptr[3] = src.AtUnchecked<unsigned char>(row, col, 3);
+        }
       }
-      dst_ptr += output_channels;
-      src_ptr += 3;
+      dst_ptr += channels;
     }
+  });
+}
+
+
+/// Sanity checks for `BlendInPlace`: Both buffers must be valid and
+/// the number of channels of the blended buffer cannot increase.
+void CheckInPlaceBlending(const ImageBuffer &buf, const ImageBuffer &other) {
+  if (!buf.IsValid() || !other.IsValid()) {
+    const std::string msg("Cannot blend invalid ImageBuffers!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
   }
 
-  return dst;
+  if (other.Channels() > buf.Channels()) {
+    std::string msg(
+          "In-place blending requires the other ImageBuffer to have at "
+          "most as many channels, but got: ");
+    msg += buf.ToString();
+    msg += " vs. ";
+    msg += other.ToString();
+    msg += '!';
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
 }
 }  // namespace helpers
 
@@ -194,6 +493,12 @@ const std::type_info &ImageBufferTypeInfo(ImageBufferType t) {
 
     case ImageBufferType::Double:
       return typeid(image_buffer_t<ImageBufferType::Double>);
+
+    case ImageBufferType::Float16:
+      return typeid(image_buffer_t<ImageBufferType::Float16>);
+
+    case ImageBufferType::BFloat16:
+      return typeid(image_buffer_t<ImageBufferType::BFloat16>);
   }
 
   // Throw an exception as fallback, because ending up here would be an
@@ -235,6 +540,12 @@ std::string ImageBufferTypeToString(ImageBufferType t) {
 
     case ImageBufferType::Double:
       return "double";
+
+    case ImageBufferType::Float16:
+      return "float16";
+
+    case ImageBufferType::BFloat16:
+      return "bfloat16";
   }
   //TODO(dev) Include newly added string representation also in
   //  `ImageBufferFromString`!
@@ -274,6 +585,11 @@ ImageBufferType ImageBufferTypeFromString(const std::string &s) {
   } else if ((srep.compare("double") == 0)
              || (srep.compare("float64") == 0)) {
     return ImageBufferType::Double;
+  } else if ((srep.compare("float16") == 0)
+             || (srep.compare("half") == 0)) {
+    return ImageBufferType::Float16;
+  } else if (srep.compare("bfloat16") == 0) {
+    return ImageBufferType::BFloat16;
   } else {
     std::string msg("Could not look up `ImageBufferType` corresponding to \"");
     msg += s;
@@ -312,6 +628,12 @@ int ElementSizeFromImageBufferType(ImageBufferType t) {
 
     case ImageBufferType::Double:
       return static_cast<int>(sizeof(double));
+
+    case ImageBufferType::Float16:
+      return static_cast<int>(sizeof(float16_t));
+
+    case ImageBufferType::BFloat16:
+      return static_cast<int>(sizeof(bfloat16_t));
   }
 
   // Throw an exception as fallback, because ending up here would be an
@@ -330,130 +652,362 @@ std::ostream &operator<<(std::ostream &os, ImageBufferType t) {
 }
 
 
-//---------------------------------------------------- ImageBuffer
-ImageBuffer::ImageBuffer()
-  : data(nullptr),
-    height(0),
-    width(0),
-    channels(0),
-    element_size(0),
-    row_stride(0),
-    pixel_stride(0),
-    buffer_type(ImageBufferType::UInt8),
-    owns_data(false) {
-  SPDLOG_DEBUG("ImageBuffer default constructor.");
+std::string InterpolationToString(Interpolation interpolation) {
+  switch (interpolation) {
+    case Interpolation::Nearest:
+      return "nearest";
+
+    case Interpolation::Bilinear:
+      return "bilinear";
+
+    case Interpolation::Area:
+      return "area";
+  }
+
+  std::ostringstream msg;
+  msg << "Interpolation (" << static_cast<int>(interpolation)
+      << ") not handled in `InterpolationToString` switch!";
+  SPDLOG_ERROR(msg.str());
+  throw std::logic_error(msg.str());
 }
 
 
-ImageBuffer::ImageBuffer(
-    int h, int w, int ch, ImageBufferType buf_type) {
-  SPDLOG_DEBUG(
-        "ImageBuffer constructor allocating memory for a "
-        "{:d}x{:d}x{:d} {:s} image.",
-        h, w, ch, ImageBufferTypeToString(buf_type));
-  height = h;
-  width = w;
-  channels = ch;
-  buffer_type = buf_type;
-  element_size = ElementSizeFromImageBufferType(buf_type);
-  pixel_stride = channels * element_size;
-  row_stride = width * pixel_stride;
-  const int num_bytes = height * row_stride;
-  owns_data = true;
-  data = static_cast<unsigned char*>(std::malloc(num_bytes));
-  if (!data) {
-    SPDLOG_CRITICAL(
-          "Cannot allocate {:d} bytes to construct a {:d}x{:d}x{:d} {:s} ImageBuffer!",
-          num_bytes, w, h, ch, ImageBufferTypeToString(buf_type));
-    // Reset this ImageBuffer:
-    owns_data = false;
-    Cleanup();
+Interpolation InterpolationFromString(const std::string &interpolation) {
+  const std::string srep = werkzeugkiste::strings::Trim(
+        werkzeugkiste::strings::Lower(interpolation));
+  if ((srep.compare("nearest") == 0)
+      || (srep.compare("nn") == 0)) {
+    return Interpolation::Nearest;
+  } else if ((srep.compare("bilinear") == 0)
+             || (srep.compare("linear") == 0)) {
+    return Interpolation::Bilinear;
+  } else if ((srep.compare("area") == 0)
+             || (srep.compare("box") == 0)) {
+    return Interpolation::Area;
   }
+
+  std::string msg("Could not look up `Interpolation` corresponding to \"");
+  msg += interpolation;
+  msg += "\"!";
+  SPDLOG_ERROR(msg);
+  throw std::invalid_argument(msg);
 }
 
 
-ImageBuffer::~ImageBuffer() {
-  SPDLOG_DEBUG("ImageBuffer destructor.");
-  Cleanup();
+std::ostream &operator<<(std::ostream &os, Interpolation interpolation) {
+  os << InterpolationToString(interpolation);
+  return os;
 }
 
 
-ImageBuffer::ImageBuffer(const ImageBuffer &other) noexcept {
-  SPDLOG_DEBUG(
-        "ImageBuffer copy constructor, with other: {:s}.", other.ToString());
-  height = other.height;
-  width = other.width;
-  channels = other.channels;
-  element_size = other.element_size;
-  buffer_type = other.buffer_type;
-  row_stride = other.row_stride;
-  pixel_stride = other.pixel_stride;
-  owns_data = other.owns_data;
-
-  if (other.owns_data) {
-    const int num_bytes = other.NumBytes();
-    data = static_cast<unsigned char*>(std::malloc(num_bytes));
-    if (data) {
-      std::memcpy(data, other.data, num_bytes);
-    } else {
-      SPDLOG_CRITICAL(
-            "Cannot allocate {:d} bytes to copy construct an ImageBuffer "
-            "from {:s}!", num_bytes, other.ToString());
-      // Reset this ImageBuffer:
-      owns_data = false;
-      Cleanup();
-    }
-  } else {
-    data = other.data;
+std::string BlurKindToString(BlurKind kind) {
+  switch (kind) {
+    case BlurKind::Box:
+      return "box";
+
+    case BlurKind::Gaussian:
+      return "gaussian";
   }
+
+  std::ostringstream msg;
+  msg << "BlurKind (" << static_cast<int>(kind)
+      << ") not handled in `BlurKindToString` switch!";
+  SPDLOG_ERROR(msg.str());
+  throw std::logic_error(msg.str());
 }
 
 
-ImageBuffer::ImageBuffer(ImageBuffer &&other) noexcept
-  : data(other.data),
-    height(other.height),
-    width(other.width),
-    channels(other.channels),
-    element_size(other.element_size),
-    row_stride(other.row_stride),
-    pixel_stride(other.pixel_stride),
-    buffer_type(other.buffer_type),
-    owns_data(other.owns_data) {
-  SPDLOG_DEBUG("ImageBuffer move constructor.");
-  // Reset "other", but ensure that the memory won't be freed:
-  other.owns_data = false;
-  other.Cleanup();
+BlurKind BlurKindFromString(const std::string &kind) {
+  const std::string srep = werkzeugkiste::strings::Trim(
+        werkzeugkiste::strings::Lower(kind));
+  if (srep.compare("box") == 0) {
+    return BlurKind::Box;
+  } else if ((srep.compare("gaussian") == 0)
+             || (srep.compare("gauss") == 0)) {
+    return BlurKind::Gaussian;
+  }
+
+  std::string msg("Could not look up `BlurKind` corresponding to \"");
+  msg += kind;
+  msg += "\"!";
+  SPDLOG_ERROR(msg);
+  throw std::invalid_argument(msg);
 }
 
 
-ImageBuffer &ImageBuffer::operator=(const ImageBuffer &other) {
-  SPDLOG_DEBUG("ImageBuffer copy assignment operator.");
-  return *this = ImageBuffer(other);
+std::ostream &operator<<(std::ostream &os, BlurKind kind) {
+  os << BlurKindToString(kind);
+  return os;
 }
 
 
-ImageBuffer &ImageBuffer::operator=(ImageBuffer &&other) noexcept {
-  SPDLOG_DEBUG("ImageBuffer move assignment operator.");
-  std::swap(data, other.data);
-  std::swap(width, other.width);
-  std::swap(height, other.height);
-  std::swap(channels, other.channels);
-  std::swap(element_size, other.element_size);
-  std::swap(row_stride, other.row_stride);
-  std::swap(pixel_stride, other.pixel_stride);
+std::string ImageLayoutToString(ImageLayout layout) {
+  switch (layout) {
+    case ImageLayout::Interleaved:
+      return "interleaved";
+
+    case ImageLayout::Planar:
+      return "planar";
+  }
+
+  std::ostringstream msg;
+  msg << "ImageLayout (" << static_cast<int>(layout)
+      << ") not handled in `ImageLayoutToString` switch!";
+  SPDLOG_ERROR(msg.str());
+  throw std::logic_error(msg.str());
+}
+
+
+ImageLayout ImageLayoutFromString(const std::string &layout) {
+  const std::string srep = werkzeugkiste::strings::Trim(
+        werkzeugkiste::strings::Lower(layout));
+  if ((srep.compare("interleaved") == 0)
+      || (srep.compare("hwc") == 0)
+      || (srep.compare("nhwc") == 0)) {
+    return ImageLayout::Interleaved;
+  } else if ((srep.compare("planar") == 0)
+             || (srep.compare("chw") == 0)
+             || (srep.compare("nchw") == 0)) {
+    return ImageLayout::Planar;
+  }
+
+  std::string msg("Could not look up `ImageLayout` corresponding to \"");
+  msg += layout;
+  msg += "\"!";
+  SPDLOG_ERROR(msg);
+  throw std::invalid_argument(msg);
+}
+
+
+std::ostream &operator<<(std::ostream &os, ImageLayout layout) {
+  os << ImageLayoutToString(layout);
+  return os;
+}
+
+
+//---------------------------------------------------- Memory allocation
+namespace helpers {
+/// Default row alignment (in bytes) of newly allocated ImageBuffers.
+std::atomic<int> default_row_alignment(kImageBufferAlignment);
+
+
+inline bool IsPowerOfTwo(int value) {
+  return (value > 0) && ((value & (value - 1)) == 0);
+}
+
+
+/// Rounds up the value to the next multiple of the given
+/// alignment, which must be a power of two.
+inline int64_t AlignUp(int64_t value, int64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+
+void CheckRowAlignment(int alignment) {
+  if (!IsPowerOfTwo(alignment)) {
+    std::ostringstream msg;
+    msg << "Row alignment must be a power of two, but got "
+        << alignment << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+}
+}  // namespace helpers
+
+
+void SetImageBufferRowAlignment(int alignment) {
+  SPDLOG_DEBUG("Setting ImageBuffer row alignment to {:d}.", alignment);
+  helpers::CheckRowAlignment(alignment);
+  helpers::default_row_alignment = alignment;
+}
+
+
+int GetImageBufferRowAlignment() {
+  return helpers::default_row_alignment;
+}
+
+
+//---------------------------------------------------- ImageBuffer
+ImageBuffer::ImageBuffer()
+  : data(nullptr),
+    height(0),
+    width(0),
+    channels(0),
+    element_size(0),
+    row_stride(0),
+    pixel_stride(0),
+    channel_stride(0),
+    buffer_type(ImageBufferType::UInt8),
+    owns_data(false),
+    read_only(false),
+    shareable(true) {
+  SPDLOG_DEBUG("ImageBuffer default constructor.");
+}
+
+
+ImageBuffer::ImageBuffer(
+    int h, int w, int ch, ImageBufferType buf_type)
+  : ImageBuffer(h, w, ch, buf_type, helpers::default_row_alignment)
+{}
+
+
+ImageBuffer::ImageBuffer(
+    int h, int w, int ch, ImageBufferType buf_type, int row_alignment) {
+  SPDLOG_DEBUG(
+        "ImageBuffer constructor allocating memory for a "
+        "{:d}x{:d}x{:d} {:s} image, row alignment {:d}.",
+        h, w, ch, ImageBufferTypeToString(buf_type), row_alignment);
+  helpers::CheckRowAlignment(row_alignment);
+  height = h;
+  width = w;
+  channels = ch;
+  buffer_type = buf_type;
+  element_size = ElementSizeFromImageBufferType(buf_type);
+  pixel_stride = static_cast<int64_t>(channels) * element_size;
+  channel_stride = element_size;
+  row_stride = helpers::AlignUp(width * pixel_stride, row_alignment);
+  const int64_t num_bytes = height * row_stride;
+  owns_data = true;
+  read_only = false;
+  shareable = true;
+  storage = helpers::AllocateStorage(num_bytes);
+  data = storage.get();
+  if (!data) {
+    SPDLOG_CRITICAL(
+          "Cannot allocate {:d} bytes to construct a {:d}x{:d}x{:d} {:s} ImageBuffer!",
+          num_bytes, w, h, ch, ImageBufferTypeToString(buf_type));
+    // Reset this ImageBuffer:
+    owns_data = false;
+    Cleanup();
+  }
+}
+
+
+ImageBuffer::ImageBuffer(
+    int h, int w, int ch, ImageBufferType buf_type, ImageLayout layout)
+  : ImageBuffer() {
+  SPDLOG_DEBUG(
+        "ImageBuffer constructor allocating memory for a "
+        "{:d}x{:d}x{:d} {:s} image, {:s} layout.",
+        h, w, ch, ImageBufferTypeToString(buf_type),
+        ImageLayoutToString(layout));
+  const int64_t num_bytes = static_cast<int64_t>(h) * w * ch
+      * ElementSizeFromImageBufferType(buf_type);
+  std::shared_ptr<unsigned char> memory = helpers::AllocateStorage(num_bytes);
+  if (!memory) {
+    SPDLOG_CRITICAL(
+          "Cannot allocate {:d} bytes to construct a {:d}x{:d}x{:d} {:s} ImageBuffer!",
+          num_bytes, w, h, ch, ImageBufferTypeToString(buf_type));
+    return;
+  }
+
+  CreateSharedBuffer(memory.get(), h, w, ch, buf_type, layout);
+  storage = std::move(memory);
+  owns_data = true;
+}
+
+
+ImageBuffer::~ImageBuffer() {
+  SPDLOG_DEBUG("ImageBuffer destructor.");
+  Cleanup();
+}
+
+
+ImageBuffer::ImageBuffer(const ImageBuffer &other) noexcept
+  : data(other.data),
+    storage(other.storage),
+    height(other.height),
+    width(other.width),
+    channels(other.channels),
+    element_size(other.element_size),
+    row_stride(other.row_stride),
+    pixel_stride(other.pixel_stride),
+    channel_stride(other.channel_stride),
+    buffer_type(other.buffer_type),
+    owns_data(other.owns_data),
+    read_only(other.read_only),
+    shareable(true) {
+  // If `other` owns its data, we now reference the same storage. The
+  // pixels will only be copied once either buffer requests write access.
+  SPDLOG_DEBUG(
+        "ImageBuffer copy constructor, with other: {:s}.", other.ToString());
+  if (owns_data && !other.shareable) {
+    // Mutable pointers to the pixels of `other` have been handed out, so
+    // we cannot know when they will be modified.
+    try {
+      Detach();
+    } catch (const std::exception &) {
+      SPDLOG_CRITICAL(
+            "Cannot allocate memory to copy {:s}!", other.ToString());
+      Cleanup();
+    }
+  }
+}
+
+
+ImageBuffer::ImageBuffer(ImageBuffer &&other) noexcept
+  : data(other.data),
+    storage(std::move(other.storage)),
+    height(other.height),
+    width(other.width),
+    channels(other.channels),
+    element_size(other.element_size),
+    row_stride(other.row_stride),
+    pixel_stride(other.pixel_stride),
+    channel_stride(other.channel_stride),
+    buffer_type(other.buffer_type),
+    owns_data(other.owns_data),
+    read_only(other.read_only),
+    shareable(other.shareable) {
+  SPDLOG_DEBUG("ImageBuffer move constructor.");
+  // Reset "other", but ensure that the memory won't be freed:
+  other.owns_data = false;
+  other.Cleanup();
+}
+
+
+ImageBuffer &ImageBuffer::operator=(const ImageBuffer &other) {
+  SPDLOG_DEBUG("ImageBuffer copy assignment operator.");
+  return *this = ImageBuffer(other);
+}
+
+
+ImageBuffer &ImageBuffer::operator=(ImageBuffer &&other) noexcept {
+  SPDLOG_DEBUG("ImageBuffer move assignment operator.");
+  std::swap(data, other.data);
+  std::swap(storage, other.storage);
+  std::swap(width, other.width);
+  std::swap(height, other.height);
+  std::swap(channels, other.channels);
+  std::swap(element_size, other.element_size);
+  std::swap(row_stride, other.row_stride);
+  std::swap(pixel_stride, other.pixel_stride);
+  std::swap(channel_stride, other.channel_stride);
   std::swap(buffer_type, other.buffer_type);
   std::swap(owns_data, other.owns_data);
+  std::swap(read_only, other.read_only);
+  std::swap(shareable, other.shareable);
   return *this;
 }
 
 
 void ImageBuffer::CreateSharedBuffer(unsigned char *buffer, int height, int width, int channels,
-    int row_stride, int pixel_stride, ImageBufferType buffer_type) {
+    int64_t row_stride, int64_t pixel_stride, ImageBufferType buffer_type) {
+  CreateSharedBuffer(
+        buffer, height, width, channels, row_stride, pixel_stride,
+        ElementSizeFromImageBufferType(buffer_type), buffer_type);
+}
+
+
+void ImageBuffer::CreateSharedBuffer(unsigned char *buffer, int height, int width, int channels,
+    int64_t row_stride, int64_t pixel_stride, int64_t channel_stride,
+    ImageBufferType buffer_type) {
   SPDLOG_DEBUG(
         "ImageBuffer::CreateSharedBuffer: h={:d}, w={:d},"
-        " ch={:d}, {:s}, row_stride={:d}, col_stride={:d}.",
+        " ch={:d}, {:s}, row_stride={:d}, col_stride={:d},"
+        " ch_stride={:d}.",
         height, width, channels, ImageBufferTypeToString(buffer_type),
-        row_stride, pixel_stride);
+        row_stride, pixel_stride, channel_stride);
   // Clean up first (if this instance already holds image data)
   Cleanup();
 
@@ -466,12 +1020,44 @@ void ImageBuffer::CreateSharedBuffer(unsigned char *buffer, int height, int widt
   this->buffer_type = buffer_type;
   this->element_size = ElementSizeFromImageBufferType(buffer_type);
   this->pixel_stride = pixel_stride;
+  // The channel stride of a single-channel buffer is irrelevant. Thus,
+  // we normalize it to mark its channels as contiguous.
+  this->channel_stride = (channels == 1) ? element_size : channel_stride;
+}
+
+
+void ImageBuffer::CreateSharedBuffer(unsigned char *buffer, int height, int width, int channels,
+    ImageBufferType buffer_type, ImageLayout layout) {
+  const int64_t element_size = ElementSizeFromImageBufferType(buffer_type);
+  if (layout == ImageLayout::Planar) {
+    CreateSharedBuffer(
+          buffer, height, width, channels, width * element_size,
+          element_size, static_cast<int64_t>(height) * width * element_size,
+          buffer_type);
+  } else {
+    CreateSharedBuffer(
+          buffer, height, width, channels,
+          static_cast<int64_t>(width) * channels * element_size,
+          channels * element_size, element_size, buffer_type);
+  }
+}
+
+
+void ImageBuffer::CreateSharedBuffer(unsigned char *buffer, int height, int width, int channels,
+    int64_t row_stride, int64_t pixel_stride, int64_t channel_stride,
+    ImageBufferType buffer_type, std::shared_ptr<void> owner) {
+  CreateSharedBuffer(
+        buffer, height, width, channels, row_stride, pixel_stride,
+        channel_stride, buffer_type);
+  // The aliasing constructor shares the owner's reference count, i.e.
+  // copies and views of this buffer keep the owner alive, too.
+  storage = std::shared_ptr<unsigned char>(std::move(owner), buffer);
 }
 
 
 void ImageBuffer::CreateCopiedBuffer(
     unsigned char const *buffer, int height, int width, int channels,
-    int row_stride, int column_stride, int channel_stride,
+    int64_t row_stride, int64_t column_stride, int64_t channel_stride,
     ImageBufferType buffer_type) {
   SPDLOG_DEBUG(
         "ImageBuffer::CreateCopiedBuffer: h={:d}, w={:d},"
@@ -483,8 +1069,11 @@ void ImageBuffer::CreateCopiedBuffer(
   Cleanup();
 
   this->element_size = ElementSizeFromImageBufferType(buffer_type);
-  const int num_bytes = height * width * channels * element_size;
-  data = static_cast<unsigned char*>(std::malloc(num_bytes));
+  const int64_t packed_row_stride =
+      static_cast<int64_t>(width) * channels * element_size;
+  const int64_t num_bytes = height * packed_row_stride;
+  storage = helpers::AllocateStorage(num_bytes);
+  data = storage.get();
   if (!data) {
     std::ostringstream msg;
     msg << "Cannot allocate " << num_bytes << " bytes to copy ImageBuffer!";
@@ -495,59 +1084,16 @@ void ImageBuffer::CreateCopiedBuffer(
   this->width = width;
   this->height = height;
   this->channels = channels;
-  this->row_stride = width * channels * element_size;
+  this->row_stride = packed_row_stride;
   this->buffer_type = buffer_type;
-  this->pixel_stride = channels * element_size;
-
-  if ((row_stride == (width * channels * element_size))
-      && (column_stride > 0) && (channel_stride > 0)) {
-    // Buffer is contiguous, only need a single memcpy:
-    std::memcpy(data, buffer, num_bytes);
-  } else {
-    // Is a single row contiguous?
-    if ((column_stride == (channels * element_size))
-        && (channel_stride > 0)) {
-      for (int row = 0; row < height; ++row) {
-        std::memcpy(
-              data + (row * this->row_stride),
-              buffer + (row * row_stride),
-              width * column_stride);
-      }
-    } else {
-      // Copy pixel by pixel because the input buffer might be a sliced,
-      // transposed, or any other view (e.g. with negative strides)
-      for (int row = 0, src_row_offset = 0;
-           row < height;
-           ++row, src_row_offset += row_stride) {
-        // The destination buffer is freshly allocated, thus the memory
-        // is nicely aligned.
-        unsigned char *dst_ptr = MutablePtr<unsigned char>(row, 0, 0);
-
-        for (int col = 0, src_col_offset = 0;
-             col < width;
-             ++col, src_col_offset += column_stride) {
-
-          for (int ch = 0, src_channel_offset = 0;
-               ch < channels;
-               ++ch, src_channel_offset += channel_stride) {
-            // We can only copy one element after the other
-            std::memcpy(
-                  dst_ptr, buffer + src_row_offset + src_col_offset + src_channel_offset, element_size);
-            dst_ptr += element_size;
-          }
-        }
-      }
-//      for (int row = 0; row < height; ++row) {
-//        for (int col = 0; col < width; ++col) {
-//          for (int ch = 0; ch < channels; ++ch) {
-//            const int dst_idx = (row * this->row_stride) + (col * this->pixel_stride) + (ch * this->element_size);
-//            const int src_idx = (row * row_stride) + (col * column_stride) + (ch * channel_stride);
-//            std::memcpy(data + dst_idx, buffer + src_idx, element_size);
-//          }
-//        }
-//      }
-    }
-  }
+  this->pixel_stride = static_cast<int64_t>(channels) * element_size;
+  this->channel_stride = element_size;
+
+  // Numpy transposes, flipped/sliced views, etc. are copied by
+  // specialized kernels, see `helpers::SelectStridedCopy`.
+  helpers::CopyStridedToPacked(
+        buffer, height, width, channels, row_stride, column_stride,
+        channel_stride, element_size, data);
 }
 
 
@@ -555,11 +1101,34 @@ ImageBuffer ImageBuffer::DeepCopy() const {
   ImageBuffer cp;
   cp.CreateCopiedBuffer(
         data, height, width, channels,
-        row_stride, pixel_stride, element_size, buffer_type);
+        row_stride, pixel_stride, channel_stride, buffer_type);
   return cp;
 }
 
 
+bool ImageBuffer::EnsureShape(
+    int h, int w, int ch, ImageBufferType buf_type) {
+  if (IsValid() && (height == h) && (width == w)
+      && (channels == ch) && (buffer_type == buf_type)
+      && (!shareable || !IsStorageShared()) && !read_only) {
+    return false;
+  }
+
+  SPDLOG_DEBUG(
+        "ImageBuffer::EnsureShape reallocates {:s} as {:d}x{:d}x{:d} {:s}.",
+        ToString(), h, w, ch, ImageBufferTypeToString(buf_type));
+  *this = ImageBuffer(h, w, ch, buf_type);
+  if (!IsValid()) {
+    std::ostringstream msg;
+    msg << "Cannot allocate a " << h << "x" << w << "x" << ch << ' '
+        << ImageBufferTypeToString(buf_type) << " ImageBuffer!";
+    SPDLOG_ERROR(msg.str());
+    throw std::runtime_error(msg.str());
+  }
+  return true;
+}
+
+
 ImageBuffer ImageBuffer::ROI(int left, int top, int roi_width, int roi_height) {
   if ((roi_width <= 0) || (roi_height <= 0)) {
     std::ostringstream msg;
@@ -579,15 +1148,123 @@ ImageBuffer ImageBuffer::ROI(int left, int top, int roi_width, int roi_height) {
     throw std::out_of_range(msg.str());
   }
 
+  // The ROI is a (non-owning) view which will be used to modify
+  // the pixels. Thus, we must not share the storage with any
+  // copy-on-write sibling of this buffer, neither now nor later
+  // (`MutableData` marks the storage as no longer shareable).
   ImageBuffer roi;
-  unsigned char *roi_data = data + ByteOffset(top, left, 0);
+  unsigned char *roi_data = MutableData() + ByteOffset(top, left, 0);
   roi.CreateSharedBuffer(
         roi_data, roi_height, roi_width, channels,
-        row_stride, pixel_stride, buffer_type);
+        row_stride, pixel_stride, channel_stride, buffer_type);
+  if (!owns_data) {
+    // Keep an external resource (such as a memory mapping) alive.
+    roi.storage = storage;
+  }
   return roi;
 }
 
 
+ImageBuffer ImageBuffer::ROIView(
+    int left, int top, int roi_width, int roi_height) const {
+  if ((roi_width <= 0) || (roi_height <= 0)
+      || (left < 0) || ((left + roi_width) > width)
+      || (top < 0) || ((top + roi_height) > height)) {
+    std::ostringstream msg;
+    msg << "Invalid ROIView(l=" << left << ", t=" << top << ", w="
+        << roi_width << ", h=" << roi_height << ") for ImageBuffer of size w="
+        << width << ", h=" << height << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::out_of_range(msg.str());
+  }
+
+  return CreateView(
+        data + ByteOffset(top, left, 0), roi_height, roi_width, channels,
+        row_stride, pixel_stride, channel_stride);
+}
+
+
+ImageBuffer ImageBuffer::ChannelView(
+    int first_channel, int num_channels, int step) const {
+  const int last_channel = first_channel + (num_channels - 1) * step;
+  if ((num_channels <= 0) || (step == 0)
+      || (first_channel < 0) || (first_channel >= channels)
+      || (last_channel < 0) || (last_channel >= channels)) {
+    std::ostringstream msg;
+    msg << "Invalid ChannelView(first=" << first_channel << ", num="
+        << num_channels << ", step=" << step << ") for ImageBuffer with "
+        << channels << " channels!";
+    SPDLOG_ERROR(msg.str());
+    throw std::out_of_range(msg.str());
+  }
+
+  return CreateView(
+        data + ByteOffset(0, 0, first_channel), height, width, num_channels,
+        row_stride, pixel_stride, step * channel_stride);
+}
+
+
+ImageBuffer ImageBuffer::FlipView(bool horizontal, bool vertical) const {
+  if (!IsValid()) {
+    const std::string msg("Cannot create a FlipView of an invalid ImageBuffer!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  const int first_row = vertical ? (height - 1) : 0;
+  const int first_col = horizontal ? (width - 1) : 0;
+  return CreateView(
+        data + ByteOffset(first_row, first_col, 0), height, width, channels,
+        vertical ? -row_stride : row_stride,
+        horizontal ? -pixel_stride : pixel_stride,
+        channel_stride);
+}
+
+
+ImageBuffer ImageBuffer::CreateView(
+    unsigned char const *view_data, int view_height, int view_width,
+    int view_channels, int64_t view_row_stride, int64_t view_pixel_stride,
+    int64_t view_channel_stride) const {
+  ImageBuffer view;
+  // The view never writes through this pointer, see `CheckWriteAccess`.
+  view.CreateSharedBuffer(
+        const_cast<unsigned char *>(view_data), view_height, view_width,
+        view_channels, view_row_stride, view_pixel_stride,
+        view_channel_stride, buffer_type);
+  // Keep the (copy-on-write) storage alive. This buffer will thus detach
+  // before its pixels are modified, so the view can never observe changes.
+  view.storage = storage;
+  view.read_only = true;
+  return view;
+}
+
+
+ImageBuffer ImageBuffer::CreateMappedBuffer(
+    std::shared_ptr<unsigned char> mapping, unsigned char *mapped_data,
+    int height, int width, int channels, int64_t row_stride,
+    int64_t pixel_stride, int64_t channel_stride,
+    ImageBufferType buffer_type, bool read_only) {
+  ImageBuffer buffer;
+  buffer.CreateSharedBuffer(
+        mapped_data, height, width, channels, row_stride, pixel_stride,
+        channel_stride, buffer_type);
+  // The mapping is not owned in the copy-on-write sense, i.e. writing to
+  // a (private) mapping never triggers a `Detach`.
+  buffer.storage = std::move(mapping);
+  buffer.read_only = read_only;
+  return buffer;
+}
+
+
+void ImageBuffer::ThrowReadOnly() const {
+  std::string msg("Cannot modify the read-only ");
+  msg += ToString();
+  msg += ", use `DeepCopy` to obtain a writeable copy!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
 void ImageBuffer::SwapChannels(int ch1, int ch2) {
   SPDLOG_DEBUG("ImageBuffer::SwapChannels {:d} & {:d}.", ch1, ch2);
 
@@ -641,6 +1318,12 @@ void ImageBuffer::SwapChannels(int ch1, int ch2) {
     case ImageBufferType::Double:
       helpers::SwapChannels<double>(*this, ch1, ch2);
       return;
+
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16:
+      // Channels are swapped bitwise, thus the storage type suffices
+      helpers::SwapChannels<uint16_t>(*this, ch1, ch2);
+      return;
   }
 
   // Throw an exception as fallback, because ending up here would be an
@@ -655,11 +1338,49 @@ void ImageBuffer::SwapChannels(int ch1, int ch2) {
 
 
 void ImageBuffer::TakeOwnership() {
+  if (owns_data || !data) {
+    return;
+  }
+  TakeOwnership([](unsigned char *ptr) { std::free(ptr); });
+}
+
+
+void ImageBuffer::TakeOwnership(ImageBufferDeleter deleter) {
+  if (!data || owns_data) {
+    std::string msg("Cannot take ownership of ");
+    msg += ToString();
+    msg += data ? ", it already owns its memory!" : "!";
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  if (!deleter) {
+    const std::string msg(
+          "ImageBuffer::TakeOwnership requires a valid deleter!");
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
+
+  if (storage) {
+    std::string msg("Cannot take ownership of the view ");
+    msg += ToString();
+    msg += ", its memory is managed by another ImageBuffer!";
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+  storage = std::shared_ptr<unsigned char>(data, std::move(deleter));
   owns_data = true;
 }
 
 
 ImageBuffer ImageBuffer::ToChannels(int output_channels) const {
+  ImageBuffer dst;
+  ToChannels(&dst, output_channels);
+  return dst;
+}
+
+
+void ImageBuffer::ToChannels(ImageBuffer *dst, int output_channels) const {
   SPDLOG_DEBUG(
         "ImageBuffer::ToChannels converting {:d} to {:d} channels.",
         channels, output_channels);
@@ -679,13 +1400,18 @@ ImageBuffer ImageBuffer::ToChannels(int output_channels) const {
     throw std::invalid_argument(msg.str());
   }
 
+  if (helpers::IsAliasedOutput(dst, {this})) {
+    helpers::AssignOutput(dst, ToChannels(output_channels));
+    return;
+  }
+
   if (channels == 1) {
     // Grayscale-to-something
     if (output_channels == 1) {
-      return DeepCopy();
+      helpers::CopyPixels(*this, *dst);
     } else if ((output_channels == 3)
                || (output_channels == 4)){
-      return helpers::Gray2RGBx(*this, output_channels);
+      helpers::Gray2RGBx(*this, *dst, output_channels);
     } else {
       std::ostringstream msg;
       msg << "Conversion from single-channel ImageBuffer to "
@@ -696,9 +1422,9 @@ ImageBuffer ImageBuffer::ToChannels(int output_channels) const {
   } else if (channels == 3) {
     // RGB-to-something
     if (output_channels == 3) {
-      return DeepCopy();
+      helpers::CopyPixels(*this, *dst);
     } else if (output_channels == 4) {
-      return helpers::RGBx2RGBx(*this, 4);
+      helpers::RGBx2RGBx(*this, *dst, 4);
     } else {
       std::ostringstream msg;
       msg << "Conversion from 3-channel ImageBuffer to "
@@ -709,9 +1435,9 @@ ImageBuffer ImageBuffer::ToChannels(int output_channels) const {
   } else {
     // RGBA-to-something
     if (output_channels == 3) {
-      return helpers::RGBx2RGBx(*this, 3);
+      helpers::RGBx2RGBx(*this, *dst, 3);
     } else if (output_channels == 4) {
-      return DeepCopy();
+      helpers::CopyPixels(*this, *dst);
     } else {
       std::ostringstream msg;
       msg << "Conversion from 4-channel ImageBuffer to "
@@ -724,39 +1450,68 @@ ImageBuffer ImageBuffer::ToChannels(int output_channels) const {
 
 
 ImageBuffer ImageBuffer::ToUInt8(int output_channels) const {
+  ImageBuffer dst;
+  ToUInt8(&dst, output_channels);
+  return dst;
+}
+
+
+void ImageBuffer::ToUInt8(ImageBuffer *dst, int output_channels) const {
   if (!IsValid()) {
     const std::string msg("Cannot convert an invalid ImageBuffer to `uint8`!");
     SPDLOG_ERROR(msg);
     throw std::logic_error(msg);
   }
 
-  switch (buffer_type) {
-    case ImageBufferType::UInt8:
-      return helpers::ToUInt8<uint8_t>(*this, output_channels, 1);
+  if (helpers::IsAliasedOutput(dst, {this})) {
+    helpers::AssignOutput(dst, ToUInt8(output_channels));
+    return;
+  }
+
+  switch (buffer_type) {
+    case ImageBufferType::UInt8:
+      helpers::ToUInt8<uint8_t>(*this, *dst, output_channels);
+      return;
 
     case ImageBufferType::Int16:
-      return helpers::ToUInt8<int16_t>(*this, output_channels, 1);
+      helpers::ToUInt8<int16_t>(*this, *dst, output_channels);
+      return;
 
     case ImageBufferType::UInt16:
-      return helpers::ToUInt8<uint16_t>(*this, output_channels, 1);
+      helpers::ToUInt8<uint16_t>(*this, *dst, output_channels);
+      return;
 
     case ImageBufferType::Int32:
-      return helpers::ToUInt8<int32_t>(*this, output_channels, 1);
+      helpers::ToUInt8<int32_t>(*this, *dst, output_channels);
+      return;
 
     case ImageBufferType::UInt32:
-      return helpers::ToUInt8<uint32_t>(*this, output_channels, 1);
+      helpers::ToUInt8<uint32_t>(*this, *dst, output_channels);
+      return;
 
     case ImageBufferType::Int64:
-      return helpers::ToUInt8<int64_t>(*this, output_channels, 1);
+      helpers::ToUInt8<int64_t>(*this, *dst, output_channels);
+      return;
 
     case ImageBufferType::UInt64:
-      return helpers::ToUInt8<uint64_t>(*this, output_channels, 1);
+      helpers::ToUInt8<uint64_t>(*this, *dst, output_channels);
+      return;
 
     case ImageBufferType::Float:
-      return helpers::ToUInt8<float>(*this, output_channels, 255);
+      helpers::ToUInt8<float>(*this, *dst, output_channels);
+      return;
 
     case ImageBufferType::Double:
-      return helpers::ToUInt8<double>(*this, output_channels, 255);
+      helpers::ToUInt8<double>(*this, *dst, output_channels);
+      return;
+
+    case ImageBufferType::Float16:
+      helpers::ToUInt8<float16_t>(*this, *dst, output_channels);
+      return;
+
+    case ImageBufferType::BFloat16:
+      helpers::ToUInt8<bfloat16_t>(*this, *dst, output_channels);
+      return;
   }
 
   // Throw an exception as fallback, because ending up here would be an
@@ -771,39 +1526,68 @@ ImageBuffer ImageBuffer::ToUInt8(int output_channels) const {
 
 
 ImageBuffer ImageBuffer::ToFloat() const {
+  ImageBuffer dst;
+  ToFloat(&dst);
+  return dst;
+}
+
+
+void ImageBuffer::ToFloat(ImageBuffer *dst) const {
   if (!IsValid()) {
     const std::string msg("Cannot convert an invalid ImageBuffer to `float`!");
     SPDLOG_ERROR(msg);
     throw std::logic_error(msg);
   }
 
+  if (helpers::IsAliasedOutput(dst, {this})) {
+    helpers::AssignOutput(dst, ToFloat());
+    return;
+  }
+
   switch (buffer_type) {
     case ImageBufferType::UInt8:
-      return helpers::ToFloat<uint8_t>(*this, 1.0f/255.0f);
+      helpers::ToFloat<uint8_t>(*this, *dst, 1.0f/255.0f);
+      return;
 
     case ImageBufferType::Int16:
-      return helpers::ToFloat<int16_t>(*this, 1.0f/255.0f);
+      helpers::ToFloat<int16_t>(*this, *dst, 1.0f/255.0f);
+      return;
 
     case ImageBufferType::UInt16:
-      return helpers::ToFloat<uint16_t>(*this, 1.0f/255.0f);
+      helpers::ToFloat<uint16_t>(*this, *dst, 1.0f/255.0f);
+      return;
 
     case ImageBufferType::Int32:
-      return helpers::ToFloat<int32_t>(*this, 1.0f/255.0f);
+      helpers::ToFloat<int32_t>(*this, *dst, 1.0f/255.0f);
+      return;
 
     case ImageBufferType::UInt32:
-      return helpers::ToFloat<uint32_t>(*this, 1.0f/255.0f);
+      helpers::ToFloat<uint32_t>(*this, *dst, 1.0f/255.0f);
+      return;
 
     case ImageBufferType::Int64:
-      return helpers::ToFloat<int64_t>(*this, 1.0f/255.0f);
+      helpers::ToFloat<int64_t>(*this, *dst, 1.0f/255.0f);
+      return;
 
     case ImageBufferType::UInt64:
-      return helpers::ToFloat<uint64_t>(*this, 1.0f/255.0f);
+      helpers::ToFloat<uint64_t>(*this, *dst, 1.0f/255.0f);
+      return;
 
     case ImageBufferType::Float:
-      return helpers::ToFloat<float>(*this, 1.0f);
+      helpers::ToFloat<float>(*this, *dst, 1.0f);
+      return;
 
     case ImageBufferType::Double:
-      return helpers::ToFloat<double>(*this, 1.0f);
+      helpers::ToFloat<double>(*this, *dst, 1.0f);
+      return;
+
+    case ImageBufferType::Float16:
+      helpers::ToFloat<float16_t>(*this, *dst, 1.0f);
+      return;
+
+    case ImageBufferType::BFloat16:
+      helpers::ToFloat<bfloat16_t>(*this, *dst, 1.0f);
+      return;
   }
 
   // Throw an exception as fallback, because ending up here would be an
@@ -818,40 +1602,82 @@ ImageBuffer ImageBuffer::ToFloat() const {
 
 
 ImageBuffer ImageBuffer::AsType(
-    ImageBufferType type, double scaling_factor) const {
+    ImageBufferType type, double scaling_factor, bool saturate) const {
+  ImageBuffer dst;
+  AsType(&dst, type, scaling_factor, saturate);
+  return dst;
+}
+
+
+void ImageBuffer::AsType(
+    ImageBuffer *dst, ImageBufferType type, double scaling_factor,
+    bool saturate) const {
   if (!IsValid()) {
     const std::string msg("Cannot type-convert an invalid ImageBuffer!");
     SPDLOG_ERROR(msg);
     throw std::logic_error(msg);
   }
 
+  if (helpers::IsAliasedOutput(dst, {this})) {
+    helpers::AssignOutput(dst, AsType(type, scaling_factor, saturate));
+    return;
+  }
+
   switch (buffer_type) {
     case ImageBufferType::UInt8:
-      return helpers::ConvertType<uint8_t>(*this, type, scaling_factor);
+      helpers::ConvertType<uint8_t>(
+            *this, *dst, type, scaling_factor, saturate);
+      return;
 
     case ImageBufferType::Int16:
-      return helpers::ConvertType<int16_t>(*this, type, scaling_factor);
+      helpers::ConvertType<int16_t>(
+            *this, *dst, type, scaling_factor, saturate);
+      return;
 
     case ImageBufferType::UInt16:
-      return helpers::ConvertType<uint16_t>(*this, type, scaling_factor);
+      helpers::ConvertType<uint16_t>(
+            *this, *dst, type, scaling_factor, saturate);
+      return;
 
     case ImageBufferType::Int32:
-      return helpers::ConvertType<int32_t>(*this, type, scaling_factor);
+      helpers::ConvertType<int32_t>(
+            *this, *dst, type, scaling_factor, saturate);
+      return;
 
     case ImageBufferType::UInt32:
-      return helpers::ConvertType<uint32_t>(*this, type, scaling_factor);
+      helpers::ConvertType<uint32_t>(
+            *this, *dst, type, scaling_factor, saturate);
+      return;
 
     case ImageBufferType::Int64:
-      return helpers::ConvertType<int64_t>(*this, type, scaling_factor);
+      helpers::ConvertType<int64_t>(
+            *this, *dst, type, scaling_factor, saturate);
+      return;
 
     case ImageBufferType::UInt64:
-      return helpers::ConvertType<uint64_t>(*this, type, scaling_factor);
+      helpers::ConvertType<uint64_t>(
+            *this, *dst, type, scaling_factor, saturate);
+      return;
 
     case ImageBufferType::Float:
-      return helpers::ConvertType<float>(*this, type, scaling_factor);
+      helpers::ConvertType<float>(
+            *this, *dst, type, scaling_factor, saturate);
+      return;
 
     case ImageBufferType::Double:
-      return helpers::ConvertType<double>(*this, type, scaling_factor);
+      helpers::ConvertType<double>(
+            *this, *dst, type, scaling_factor, saturate);
+      return;
+
+    case ImageBufferType::Float16:
+      helpers::ConvertType<float16_t>(
+            *this, *dst, type, scaling_factor, saturate);
+      return;
+
+    case ImageBufferType::BFloat16:
+      helpers::ConvertType<bfloat16_t>(
+            *this, *dst, type, scaling_factor, saturate);
+      return;
   }
 
   // Throw an exception as fallback, because ending up here would be an
@@ -867,6 +1693,13 @@ ImageBuffer ImageBuffer::AsType(
 
 
 ImageBuffer ImageBuffer::Magnitude() const {
+  ImageBuffer dst;
+  Magnitude(&dst);
+  return dst;
+}
+
+
+void ImageBuffer::Magnitude(ImageBuffer *dst) const {
   if (!IsValid()) {
     const std::string msg(
           "Cannot compute `Magnitude` of an invalid ImageBuffer!");
@@ -874,12 +1707,19 @@ ImageBuffer ImageBuffer::Magnitude() const {
     throw std::logic_error(msg);
   }
 
+  if (helpers::IsAliasedOutput(dst, {this})) {
+    helpers::AssignOutput(dst, Magnitude());
+    return;
+  }
+
   switch (buffer_type) {
     case ImageBufferType::Float:
-      return helpers::Magnitude<float>(*this);
+      helpers::Magnitude<float>(*this, *dst);
+      return;
 
     case ImageBufferType::Double:
-      return helpers::Magnitude<double>(*this);
+      helpers::Magnitude<double>(*this, *dst);
+      return;
 
     default: {
         std::ostringstream msg;
@@ -893,6 +1733,13 @@ ImageBuffer ImageBuffer::Magnitude() const {
 
 
 ImageBuffer ImageBuffer::Orientation(float invalid) const {
+  ImageBuffer dst;
+  Orientation(&dst, invalid);
+  return dst;
+}
+
+
+void ImageBuffer::Orientation(ImageBuffer *dst, float invalid) const {
   if (!IsValid()) {
     const std::string msg(
           "Cannot compute `Orientation` of an invalid ImageBuffer!");
@@ -900,12 +1747,19 @@ ImageBuffer ImageBuffer::Orientation(float invalid) const {
     throw std::logic_error(msg);
   }
 
+  if (helpers::IsAliasedOutput(dst, {this})) {
+    helpers::AssignOutput(dst, Orientation(invalid));
+    return;
+  }
+
   switch (buffer_type) {
     case ImageBufferType::Float:
-      return helpers::Orientation<float>(*this, invalid);
+      helpers::Orientation<float>(*this, *dst, invalid);
+      return;
 
     case ImageBufferType::Double:
-      return helpers::Orientation<double>(*this, invalid);
+      helpers::Orientation<double>(*this, *dst, invalid);
+      return;
 
     default: {
         std::ostringstream msg;
@@ -979,6 +1833,10 @@ void ImageBuffer::Pixelate(
     case ImageBufferType::Double:
       helpers::Pixelate<double>(roi, block_width, block_height);
       return;
+
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16:
+      helpers::ThrowHalfPrecisionNotSupported(roi, "Pixelate");
   }
 
   // Throw an exception as fallback, because ending up here would be an
@@ -992,89 +1850,483 @@ void ImageBuffer::Pixelate(
 }
 
 
+void ImageBuffer::Blur(
+    const std::vector<Rect> &rois, int radius, BlurKind kind) {
+  helpers::Blur(*this, rois, radius, kind);
+}
+
+
 ImageBuffer ImageBuffer::Blend(
     const ImageBuffer &other, double alpha_other) const {
+  ImageBuffer dst;
+  Blend(&dst, other, alpha_other);
+  return dst;
+}
+
+
+void ImageBuffer::Blend(
+    ImageBuffer *dst, const ImageBuffer &other, double alpha_other) const {
   if (!IsValid() || !other.IsValid()) {
     const std::string msg("Cannot blend invalid ImageBuffers!");
     SPDLOG_ERROR(msg);
     throw std::logic_error(msg);
   }
 
+  if (helpers::IsAliasedOutput(dst, {this, &other})) {
+    helpers::AssignOutput(dst, Blend(other, alpha_other));
+    return;
+  }
+
+  switch(buffer_type) {
+    case ImageBufferType::UInt8:
+      helpers::BlendConstant<uint8_t>(*this, other, *dst, alpha_other);
+      return;
+
+    case ImageBufferType::Int16:
+      helpers::BlendConstant<int16_t>(*this, other, *dst, alpha_other);
+      return;
+
+    case ImageBufferType::UInt16:
+      helpers::BlendConstant<uint16_t>(*this, other, *dst, alpha_other);
+      return;
+
+    case ImageBufferType::Int32:
+      helpers::BlendConstant<int32_t>(*this, other, *dst, alpha_other);
+      return;
+
+    case ImageBufferType::UInt32:
+      helpers::BlendConstant<uint32_t>(*this, other, *dst, alpha_other);
+      return;
+
+    case ImageBufferType::Int64:
+      helpers::BlendConstant<int64_t>(*this, other, *dst, alpha_other);
+      return;
+
+    case ImageBufferType::UInt64:
+      helpers::BlendConstant<uint64_t>(*this, other, *dst, alpha_other);
+      return;
+
+    case ImageBufferType::Float:
+      helpers::BlendConstant<float>(*this, other, *dst, alpha_other);
+      return;
+
+    case ImageBufferType::Double:
+      helpers::BlendConstant<double>(*this, other, *dst, alpha_other);
+      return;
+
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16:
+      helpers::ThrowHalfPrecisionNotSupported(*this, "Blend");
+  }
+
+  // Throw an exception as fallback, because due to the default
+  // compiler settings, we would have ignored the warning about
+  // missing case values.
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(buffer_type);
+  msg += "` was not handled in `Blend` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
+ImageBuffer ImageBuffer::Blend(
+    const ImageBuffer &other, const ImageBuffer &weights) const {
+  ImageBuffer dst;
+  Blend(&dst, other, weights);
+  return dst;
+}
+
+
+void ImageBuffer::Blend(
+    ImageBuffer *dst, const ImageBuffer &other,
+    const ImageBuffer &weights) const {
+  if (!IsValid() || !other.IsValid() || !weights.IsValid()) {
+    const std::string msg("Cannot blend invalid ImageBuffers!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  if (helpers::IsAliasedOutput(dst, {this, &other, &weights})) {
+    helpers::AssignOutput(dst, Blend(other, weights));
+    return;
+  }
+
+  switch(buffer_type) {
+    case ImageBufferType::UInt8:
+      helpers::BlendWeights<uint8_t>(*this, other, *dst, weights);
+      return;
+
+    case ImageBufferType::Int16:
+      helpers::BlendWeights<int16_t>(*this, other, *dst, weights);
+      return;
+
+    case ImageBufferType::UInt16:
+      helpers::BlendWeights<uint16_t>(*this, other, *dst, weights);
+      return;
+
+    case ImageBufferType::Int32:
+      helpers::BlendWeights<int32_t>(*this, other, *dst, weights);
+      return;
+
+    case ImageBufferType::UInt32:
+      helpers::BlendWeights<uint32_t>(*this, other, *dst, weights);
+      return;
+
+    case ImageBufferType::Int64:
+      helpers::BlendWeights<int64_t>(*this, other, *dst, weights);
+      return;
+
+    case ImageBufferType::UInt64:
+      helpers::BlendWeights<uint64_t>(*this, other, *dst, weights);
+      return;
+
+    case ImageBufferType::Float:
+      helpers::BlendWeights<float>(*this, other, *dst, weights);
+      return;
+
+    case ImageBufferType::Double:
+      helpers::BlendWeights<double>(*this, other, *dst, weights);
+      return;
+
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16:
+      helpers::ThrowHalfPrecisionNotSupported(*this, "Blend");
+  }
+
+  // Throw an exception as fallback, because ending up here would be an
+  // implementation error (i.e. we ignored the warning about missing value
+  // in the switch/case above).
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(buffer_type);
+  msg += "` was not handled in `Blend` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
+ImageBuffer ImageBuffer::Blend(
+    const ImageBuffer &other, const PackedMask &mask,
+    double alpha_other) const {
+  ImageBuffer dst;
+  Blend(&dst, other, mask, alpha_other);
+  return dst;
+}
+
+
+void ImageBuffer::Blend(
+    ImageBuffer *dst, const ImageBuffer &other, const PackedMask &mask,
+    double alpha_other) const {
+  if (!IsValid() || !other.IsValid() || !mask.IsValid()) {
+    const std::string msg("Cannot blend invalid ImageBuffers or masks!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  if (helpers::IsAliasedOutput(dst, {this, &other})) {
+    helpers::AssignOutput(dst, Blend(other, mask, alpha_other));
+    return;
+  }
+
   switch(buffer_type) {
     case ImageBufferType::UInt8:
-      return helpers::BlendConstant<uint8_t>(*this, other, alpha_other);
+      helpers::BlendPackedMask<uint8_t>(
+            *this, other, *dst, mask, alpha_other);
+      return;
 
     case ImageBufferType::Int16:
-      return helpers::BlendConstant<int16_t>(*this, other, alpha_other);
+      helpers::BlendPackedMask<int16_t>(
+            *this, other, *dst, mask, alpha_other);
+      return;
+
+    case ImageBufferType::UInt16:
+      helpers::BlendPackedMask<uint16_t>(
+            *this, other, *dst, mask, alpha_other);
+      return;
+
+    case ImageBufferType::Int32:
+      helpers::BlendPackedMask<int32_t>(
+            *this, other, *dst, mask, alpha_other);
+      return;
+
+    case ImageBufferType::UInt32:
+      helpers::BlendPackedMask<uint32_t>(
+            *this, other, *dst, mask, alpha_other);
+      return;
+
+    case ImageBufferType::Int64:
+      helpers::BlendPackedMask<int64_t>(
+            *this, other, *dst, mask, alpha_other);
+      return;
+
+    case ImageBufferType::UInt64:
+      helpers::BlendPackedMask<uint64_t>(
+            *this, other, *dst, mask, alpha_other);
+      return;
+
+    case ImageBufferType::Float:
+      helpers::BlendPackedMask<float>(
+            *this, other, *dst, mask, alpha_other);
+      return;
+
+    case ImageBufferType::Double:
+      helpers::BlendPackedMask<double>(
+            *this, other, *dst, mask, alpha_other);
+      return;
+
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16:
+      helpers::ThrowHalfPrecisionNotSupported(*this, "Blend");
+  }
+
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(buffer_type);
+  msg += "` was not handled in `Blend` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
+ImageBuffer ImageBuffer::AlphaComposite(const ImageBuffer &overlay) const {
+  ImageBuffer dst;
+  AlphaComposite(&dst, overlay);
+  return dst;
+}
+
+
+void ImageBuffer::AlphaComposite(
+    ImageBuffer *dst, const ImageBuffer &overlay) const {
+  if (!IsValid() || !overlay.IsValid()) {
+    const std::string msg("Cannot composite invalid ImageBuffers!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  if (helpers::IsAliasedOutput(dst, {this, &overlay})) {
+    helpers::AssignOutput(dst, AlphaComposite(overlay));
+    return;
+  }
+
+  switch(buffer_type) {
+    case ImageBufferType::UInt8:
+      helpers::AlphaCompositeImpl<uint8_t>(*this, overlay, *dst);
+      return;
+
+    case ImageBufferType::Float:
+      helpers::AlphaCompositeImpl<float>(*this, overlay, *dst);
+      return;
+
+    case ImageBufferType::Double:
+      helpers::AlphaCompositeImpl<double>(*this, overlay, *dst);
+      return;
+
+    case ImageBufferType::Int16:
+    case ImageBufferType::UInt16:
+    case ImageBufferType::Int32:
+    case ImageBufferType::UInt32:
+    case ImageBufferType::Int64:
+    case ImageBufferType::UInt64:
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16: {
+        std::string msg(
+              "Alpha compositing is only supported for uint8 and floating "
+              "point ImageBuffers, but got ");
+        msg += ToString();
+        msg += '!';
+        SPDLOG_ERROR(msg);
+        throw std::invalid_argument(msg);
+      }
+  }
+
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(buffer_type);
+  msg += "` was not handled in `AlphaComposite` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
+void ImageBuffer::AlphaCompositeInPlace(const ImageBuffer &overlay) {
+  if (!IsValid() || !overlay.IsValid()) {
+    const std::string msg("Cannot composite invalid ImageBuffers!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  // If the inputs share memory, we would overwrite pixels of `overlay`
+  // before they have been composited.
+  if (helpers::Overlaps(*this, overlay)) {
+    AlphaCompositeInPlace(overlay.DeepCopy());
+    return;
+  }
+
+  CheckWriteAccess();
+  DetachIfShared();
+  switch(buffer_type) {
+    case ImageBufferType::UInt8:
+      helpers::AlphaCompositeImpl<uint8_t>(*this, overlay, *this);
+      return;
+
+    case ImageBufferType::Float:
+      helpers::AlphaCompositeImpl<float>(*this, overlay, *this);
+      return;
+
+    case ImageBufferType::Double:
+      helpers::AlphaCompositeImpl<double>(*this, overlay, *this);
+      return;
+
+    case ImageBufferType::Int16:
+    case ImageBufferType::UInt16:
+    case ImageBufferType::Int32:
+    case ImageBufferType::UInt32:
+    case ImageBufferType::Int64:
+    case ImageBufferType::UInt64:
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16: {
+        std::string msg(
+              "Alpha compositing is only supported for uint8 and floating "
+              "point ImageBuffers, but got ");
+        msg += ToString();
+        msg += '!';
+        SPDLOG_ERROR(msg);
+        throw std::invalid_argument(msg);
+      }
+  }
+
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(buffer_type);
+  msg += "` was not handled in `AlphaCompositeInPlace` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
+void ImageBuffer::BlendInPlace(const ImageBuffer &other, double alpha_other) {
+  helpers::CheckInPlaceBlending(*this, other);
+
+  // If the inputs share memory, we would overwrite pixels of `other`
+  // before they have been blended.
+  if (helpers::Overlaps(*this, other)) {
+    BlendInPlace(other.DeepCopy(), alpha_other);
+    return;
+  }
+
+  CheckWriteAccess();
+  DetachIfShared();
+  switch(buffer_type) {
+    case ImageBufferType::UInt8:
+      helpers::BlendConstant<uint8_t>(*this, other, *this, alpha_other);
+      return;
+
+    case ImageBufferType::Int16:
+      helpers::BlendConstant<int16_t>(*this, other, *this, alpha_other);
+      return;
 
     case ImageBufferType::UInt16:
-      return helpers::BlendConstant<uint16_t>(*this, other, alpha_other);
+      helpers::BlendConstant<uint16_t>(*this, other, *this, alpha_other);
+      return;
 
     case ImageBufferType::Int32:
-      return helpers::BlendConstant<int32_t>(*this, other, alpha_other);
+      helpers::BlendConstant<int32_t>(*this, other, *this, alpha_other);
+      return;
 
     case ImageBufferType::UInt32:
-      return helpers::BlendConstant<uint32_t>(*this, other, alpha_other);
+      helpers::BlendConstant<uint32_t>(*this, other, *this, alpha_other);
+      return;
 
     case ImageBufferType::Int64:
-      return helpers::BlendConstant<int64_t>(*this, other, alpha_other);
+      helpers::BlendConstant<int64_t>(*this, other, *this, alpha_other);
+      return;
 
     case ImageBufferType::UInt64:
-      return helpers::BlendConstant<uint64_t>(*this, other, alpha_other);
+      helpers::BlendConstant<uint64_t>(*this, other, *this, alpha_other);
+      return;
 
     case ImageBufferType::Float:
-      return helpers::BlendConstant<float>(*this, other, alpha_other);
+      helpers::BlendConstant<float>(*this, other, *this, alpha_other);
+      return;
 
     case ImageBufferType::Double:
-      return helpers::BlendConstant<double>(*this, other, alpha_other);
+      helpers::BlendConstant<double>(*this, other, *this, alpha_other);
+      return;
+
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16:
+      helpers::ThrowHalfPrecisionNotSupported(*this, "BlendInPlace");
   }
 
-  // Throw an exception as fallback, because due to the default
-  // compiler settings, we would have ignored the warning about
-  // missing case values.
+  // Throw an exception as fallback, because ending up here would be an
+  // implementation error (i.e. we ignored the warning about missing value
+  // in the switch/case above).
   std::string msg("Type `");
   msg += ImageBufferTypeToString(buffer_type);
-  msg += "` was not handled in `Blend` switch!";
+  msg += "` was not handled in `BlendInPlace` switch!";
   SPDLOG_ERROR(msg);
   throw std::logic_error(msg);
 }
 
 
-ImageBuffer ImageBuffer::Blend(
-    const ImageBuffer &other, const ImageBuffer &weights) const {
-  if (!IsValid() || !other.IsValid() || !weights.IsValid()) {
-    const std::string msg("Cannot blend invalid ImageBuffers!");
+void ImageBuffer::BlendInPlace(
+    const ImageBuffer &other, const ImageBuffer &weights) {
+  helpers::CheckInPlaceBlending(*this, other);
+  if (!weights.IsValid()) {
+    const std::string msg("Cannot blend with invalid weights!");
     SPDLOG_ERROR(msg);
     throw std::logic_error(msg);
   }
 
+  if (helpers::Overlaps(*this, other)) {
+    BlendInPlace(other.DeepCopy(), weights);
+    return;
+  }
+
+  if (helpers::Overlaps(*this, weights)) {
+    BlendInPlace(other, weights.DeepCopy());
+    return;
+  }
+
+  CheckWriteAccess();
+  DetachIfShared();
   switch(buffer_type) {
     case ImageBufferType::UInt8:
-      return helpers::BlendWeights<uint8_t>(*this, other, weights);
+      helpers::BlendWeights<uint8_t>(*this, other, *this, weights);
+      return;
 
     case ImageBufferType::Int16:
-      return helpers::BlendWeights<int16_t>(*this, other, weights);
+      helpers::BlendWeights<int16_t>(*this, other, *this, weights);
+      return;
 
     case ImageBufferType::UInt16:
-      return helpers::BlendWeights<uint16_t>(*this, other, weights);
+      helpers::BlendWeights<uint16_t>(*this, other, *this, weights);
+      return;
 
     case ImageBufferType::Int32:
-      return helpers::BlendWeights<int32_t>(*this, other, weights);
+      helpers::BlendWeights<int32_t>(*this, other, *this, weights);
+      return;
 
     case ImageBufferType::UInt32:
-      return helpers::BlendWeights<uint32_t>(*this, other, weights);
+      helpers::BlendWeights<uint32_t>(*this, other, *this, weights);
+      return;
 
     case ImageBufferType::Int64:
-      return helpers::BlendWeights<int64_t>(*this, other, weights);
+      helpers::BlendWeights<int64_t>(*this, other, *this, weights);
+      return;
 
     case ImageBufferType::UInt64:
-      return helpers::BlendWeights<uint64_t>(*this, other, weights);
+      helpers::BlendWeights<uint64_t>(*this, other, *this, weights);
+      return;
 
     case ImageBufferType::Float:
-      return helpers::BlendWeights<float>(*this, other, weights);
+      helpers::BlendWeights<float>(*this, other, *this, weights);
+      return;
 
     case ImageBufferType::Double:
-      return helpers::BlendWeights<double>(*this, other, weights);
+      helpers::BlendWeights<double>(*this, other, *this, weights);
+      return;
+
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16:
+      helpers::ThrowHalfPrecisionNotSupported(*this, "BlendInPlace");
   }
 
   // Throw an exception as fallback, because ending up here would be an
@@ -1082,13 +2334,40 @@ ImageBuffer ImageBuffer::Blend(
   // in the switch/case above).
   std::string msg("Type `");
   msg += ImageBufferTypeToString(buffer_type);
-  msg += "` was not handled in `Blend` switch!";
+  msg += "` was not handled in `BlendInPlace` switch!";
   SPDLOG_ERROR(msg);
   throw std::logic_error(msg);
 }
 
 
+ImageBuffer ImageBuffer::Resize(
+    int new_width, int new_height, Interpolation interpolation) const {
+  ImageBuffer dst;
+  Resize(&dst, new_width, new_height, interpolation);
+  return dst;
+}
+
+
+void ImageBuffer::Resize(
+    ImageBuffer *dst, int new_width, int new_height,
+    Interpolation interpolation) const {
+  if (helpers::IsAliasedOutput(dst, {this})) {
+    helpers::AssignOutput(dst, Resize(new_width, new_height, interpolation));
+    return;
+  }
+
+  helpers::Resize(*this, *dst, new_width, new_height, interpolation);
+}
+
+
 ImageBuffer ImageBuffer::Channel(int channel) const {
+  ImageBuffer dst;
+  Channel(&dst, channel);
+  return dst;
+}
+
+
+void ImageBuffer::Channel(ImageBuffer *dst, int channel) const {
   if ((channel < 0) || (channel >= channels)) {
     std::ostringstream msg;
     msg << "Cannot extract channel #" << channel
@@ -1098,33 +2377,53 @@ ImageBuffer ImageBuffer::Channel(int channel) const {
     throw std::invalid_argument(msg.str());
   }
 
+  if (helpers::IsAliasedOutput(dst, {this})) {
+    helpers::AssignOutput(dst, Channel(channel));
+    return;
+  }
+
   switch (buffer_type) {
     case ImageBufferType::UInt8:
-      return helpers::ExtractChannel<uint8_t>(*this, channel);
+      helpers::ExtractChannel<uint8_t>(*this, *dst, channel);
+      return;
 
     case ImageBufferType::Int16:
-      return helpers::ExtractChannel<int16_t>(*this, channel);
+      helpers::ExtractChannel<int16_t>(*this, *dst, channel);
+      return;
 
     case ImageBufferType::UInt16:
-      return helpers::ExtractChannel<uint16_t>(*this, channel);
+      helpers::ExtractChannel<uint16_t>(*this, *dst, channel);
+      return;
 
     case ImageBufferType::Int32:
-      return helpers::ExtractChannel<int32_t>(*this, channel);
+      helpers::ExtractChannel<int32_t>(*this, *dst, channel);
+      return;
 
     case ImageBufferType::UInt32:
-      return helpers::ExtractChannel<uint32_t>(*this, channel);
+      helpers::ExtractChannel<uint32_t>(*this, *dst, channel);
+      return;
 
     case ImageBufferType::Int64:
-      return helpers::ExtractChannel<int64_t>(*this, channel);
+      helpers::ExtractChannel<int64_t>(*this, *dst, channel);
+      return;
 
     case ImageBufferType::UInt64:
-      return helpers::ExtractChannel<uint64_t>(*this, channel);
+      helpers::ExtractChannel<uint64_t>(*this, *dst, channel);
+      return;
 
     case ImageBufferType::Float:
-      return helpers::ExtractChannel<float>(*this, channel);
+      helpers::ExtractChannel<float>(*this, *dst, channel);
+      return;
 
     case ImageBufferType::Double:
-      return helpers::ExtractChannel<double>(*this, channel);
+      helpers::ExtractChannel<double>(*this, *dst, channel);
+      return;
+
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16:
+      // Channels are copied bitwise, thus the storage type suffices
+      helpers::ExtractChannel<uint16_t>(*this, *dst, channel);
+      return;
   }
 
   // Throw an exception as fallback, because ending up here would be an
@@ -1139,39 +2438,64 @@ ImageBuffer ImageBuffer::Channel(int channel) const {
 
 
 ImageBuffer ImageBuffer::Dim(double alpha) const {
+  ImageBuffer dst;
+  Dim(&dst, alpha);
+  return dst;
+}
+
+
+void ImageBuffer::Dim(ImageBuffer *dst, double alpha) const {
   if (!IsValid()) {
     const std::string msg("Cannot dim an invalid ImageBuffer!");
     SPDLOG_ERROR(msg);
     throw std::logic_error(msg);
   }
 
+  if (helpers::IsAliasedOutput(dst, {this})) {
+    helpers::AssignOutput(dst, Dim(alpha));
+    return;
+  }
+
   switch(buffer_type) {
     case ImageBufferType::UInt8:
-      return helpers::DimImpl<uint8_t>(*this, alpha);
+      helpers::DimImpl<uint8_t>(*this, *dst, alpha);
+      return;
 
     case ImageBufferType::Int16:
-      return helpers::DimImpl<int16_t>(*this, alpha);
+      helpers::DimImpl<int16_t>(*this, *dst, alpha);
+      return;
 
     case ImageBufferType::UInt16:
-      return helpers::DimImpl<uint16_t>(*this, alpha);
+      helpers::DimImpl<uint16_t>(*this, *dst, alpha);
+      return;
 
     case ImageBufferType::Int32:
-      return helpers::DimImpl<int32_t>(*this, alpha);
+      helpers::DimImpl<int32_t>(*this, *dst, alpha);
+      return;
 
     case ImageBufferType::UInt32:
-      return helpers::DimImpl<uint32_t>(*this, alpha);
+      helpers::DimImpl<uint32_t>(*this, *dst, alpha);
+      return;
 
     case ImageBufferType::Int64:
-      return helpers::DimImpl<int64_t>(*this, alpha);
+      helpers::DimImpl<int64_t>(*this, *dst, alpha);
+      return;
 
     case ImageBufferType::UInt64:
-      return helpers::DimImpl<uint64_t>(*this, alpha);
+      helpers::DimImpl<uint64_t>(*this, *dst, alpha);
+      return;
 
     case ImageBufferType::Float:
-      return helpers::DimImpl<float>(*this, alpha);
+      helpers::DimImpl<float>(*this, *dst, alpha);
+      return;
 
     case ImageBufferType::Double:
-      return helpers::DimImpl<double>(*this, alpha);
+      helpers::DimImpl<double>(*this, *dst, alpha);
+      return;
+
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16:
+      helpers::ThrowHalfPrecisionNotSupported(*this, "Dim");
   }
 
   // Throw an exception as fallback, because due to the default
@@ -1185,6 +2509,68 @@ ImageBuffer ImageBuffer::Dim(double alpha) const {
 }
 
 
+void ImageBuffer::DimInPlace(double alpha) {
+  if (!IsValid()) {
+    const std::string msg("Cannot dim an invalid ImageBuffer!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  CheckWriteAccess();
+  DetachIfShared();
+  switch(buffer_type) {
+    case ImageBufferType::UInt8:
+      helpers::DimImpl<uint8_t>(*this, *this, alpha);
+      return;
+
+    case ImageBufferType::Int16:
+      helpers::DimImpl<int16_t>(*this, *this, alpha);
+      return;
+
+    case ImageBufferType::UInt16:
+      helpers::DimImpl<uint16_t>(*this, *this, alpha);
+      return;
+
+    case ImageBufferType::Int32:
+      helpers::DimImpl<int32_t>(*this, *this, alpha);
+      return;
+
+    case ImageBufferType::UInt32:
+      helpers::DimImpl<uint32_t>(*this, *this, alpha);
+      return;
+
+    case ImageBufferType::Int64:
+      helpers::DimImpl<int64_t>(*this, *this, alpha);
+      return;
+
+    case ImageBufferType::UInt64:
+      helpers::DimImpl<uint64_t>(*this, *this, alpha);
+      return;
+
+    case ImageBufferType::Float:
+      helpers::DimImpl<float>(*this, *this, alpha);
+      return;
+
+    case ImageBufferType::Double:
+      helpers::DimImpl<double>(*this, *this, alpha);
+      return;
+
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16:
+      helpers::ThrowHalfPrecisionNotSupported(*this, "DimInPlace");
+  }
+
+  // Throw an exception as fallback, because ending up here would be an
+  // implementation error (i.e. we ignored the warning about missing value
+  // in the switch/case above).
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(buffer_type);
+  msg += "` was not handled in `DimInPlace` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
 bool ImageBuffer::IsValid() const {
   return (data != nullptr);
 }
@@ -1239,6 +2625,16 @@ void ImageBuffer::MinMaxLocation(
       helpers::MinMaxLocation<double>(
             *this, channel, min_val, max_val, min_loc, max_loc);
       return;
+
+    case ImageBufferType::Float16:
+      helpers::MinMaxLocation<float16_t>(
+            *this, channel, min_val, max_val, min_loc, max_loc);
+      return;
+
+    case ImageBufferType::BFloat16:
+      helpers::MinMaxLocation<bfloat16_t>(
+            *this, channel, min_val, max_val, min_loc, max_loc);
+      return;
   }
 
   // Throw an exception as fallback, because ending up here would be an
@@ -1252,6 +2648,68 @@ void ImageBuffer::MinMaxLocation(
 }
 
 
+std::vector<ChannelStatistics> ImageBuffer::Statistics(
+    int num_bins, double histogram_min, double histogram_max) const {
+  if (!IsValid()) {
+    const std::string msg(
+          "Cannot compute statistics of an invalid ImageBuffer!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  switch (buffer_type) {
+    case ImageBufferType::UInt8:
+      return helpers::ComputeStatistics<uint8_t>(
+            *this, num_bins, histogram_min, histogram_max);
+
+    case ImageBufferType::Int16:
+      return helpers::ComputeStatistics<int16_t>(
+            *this, num_bins, histogram_min, histogram_max);
+
+    case ImageBufferType::UInt16:
+      return helpers::ComputeStatistics<uint16_t>(
+            *this, num_bins, histogram_min, histogram_max);
+
+    case ImageBufferType::Int32:
+      return helpers::ComputeStatistics<int32_t>(
+            *this, num_bins, histogram_min, histogram_max);
+
+    case ImageBufferType::UInt32:
+      return helpers::ComputeStatistics<uint32_t>(
+            *this, num_bins, histogram_min, histogram_max);
+
+    case ImageBufferType::Int64:
+      return helpers::ComputeStatistics<int64_t>(
+            *this, num_bins, histogram_min, histogram_max);
+
+    case ImageBufferType::UInt64:
+      return helpers::ComputeStatistics<uint64_t>(
+            *this, num_bins, histogram_min, histogram_max);
+
+    case ImageBufferType::Float:
+      return helpers::ComputeStatistics<float>(
+            *this, num_bins, histogram_min, histogram_max);
+
+    case ImageBufferType::Double:
+      return helpers::ComputeStatistics<double>(
+            *this, num_bins, histogram_min, histogram_max);
+
+    case ImageBufferType::Float16:
+    case ImageBufferType::BFloat16:
+      helpers::ThrowHalfPrecisionNotSupported(*this, "Statistics");
+  }
+
+  // Throw an exception as fallback, because ending up here would be an
+  // implementation error (i.e. we ignored the warning about missing value
+  // in the switch/case above).
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(buffer_type);
+  msg += "` was not handled in `Statistics` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
 std::string ImageBuffer::ToString() const {
   if (!IsValid()) {
     return "ImageBuffer(invalid)";
@@ -1264,6 +2722,8 @@ std::string ImageBuffer::ToString() const {
 
   if (owns_data)
     s << ", copied memory";
+  else if (read_only)
+    s << ", read-only view";
   else
     s << ", shared memory";
 
@@ -1273,14 +2733,31 @@ std::string ImageBuffer::ToString() const {
 }
 
 
+std::string ChannelStatistics::ToString() const {
+  std::ostringstream s;
+  s << "ChannelStatistics(min=" << min << " at " << min_location.ToString()
+    << ", max=" << max << " at " << max_location.ToString()
+    << ", mean=" << mean << ", std=" << StdDev()
+    << ", valid=" << num_valid << ", nan=" << num_nan;
+  if (!histogram.empty()) {
+    s << ", " << histogram.size() << " histogram bins";
+  }
+  s << ')';
+  return s.str();
+}
+
+
 void ImageBuffer::Cleanup() {
   SPDLOG_TRACE("ImageBuffer::Cleanup().");
   if (data && owns_data) {
     SPDLOG_TRACE(
-          "ImageBuffer freeing {:d}x{:d}x{:d}={:d} entries a {:d} byte(s).",
-          width, height, channels, NumElements(), item_size);
-    std::free(data);
+          "ImageBuffer releasing {:d}x{:d}x{:d}={:d} entries a {:d} byte(s), "
+          "storage use count: {:d}.",
+          width, height, channels, NumElements(), element_size,
+          storage.use_count());
   }
+  // The memory will be freed once the last reference is released.
+  storage.reset();
   data = nullptr;
   owns_data = false;
   width = 0;
@@ -1290,11 +2767,78 @@ void ImageBuffer::Cleanup() {
   buffer_type = ImageBufferType::UInt8;
   row_stride = 0;
   pixel_stride = 0;
+  channel_stride = 0;
+  read_only = false;
+  shareable = true;
+}
+
+
+void ImageBuffer::Detach() {
+  SPDLOG_DEBUG(
+        "ImageBuffer::Detach() copies the shared storage of {:s}.",
+        ToString());
+  // Memory which has been handed over via `TakeOwnership` may have any
+  // strides. Thus, we copy the full address range spanned by the pixels
+  // (which also covers the planes of a planar buffer) and keep the
+  // strides, i.e. the memory layout stays the same.
+  int64_t first_byte = 0;
+  int64_t end_byte = element_size;
+  for (const auto &extent : {
+         (height - 1) * row_stride, (width - 1) * pixel_stride,
+         (channels - 1) * channel_stride}) {
+    if (extent < 0) {
+      first_byte += extent;
+    } else {
+      end_byte += extent;
+    }
+  }
+  const int64_t num_bytes = end_byte - first_byte;
+  std::shared_ptr<unsigned char> copy = helpers::AllocateStorage(num_bytes);
+  if (!copy) {
+    std::ostringstream msg;
+    msg << "Cannot allocate " << num_bytes
+        << " bytes to detach the shared ImageBuffer storage!";
+    SPDLOG_ERROR(msg.str());
+    throw std::runtime_error(msg.str());
+  }
+  std::memcpy(
+        copy.get(), data + first_byte, static_cast<std::size_t>(num_bytes));
+  storage = std::move(copy);
+  data = storage.get() - first_byte;
 }
 
 
 ImageBuffer ConvertRGB2HSV(const ImageBuffer &image_rgb, bool is_bgr_format) {
-  return helpers::RGBx2HSV(image_rgb, is_bgr_format);
+  ImageBuffer dst;
+  ConvertRGB2HSV(image_rgb, &dst, is_bgr_format);
+  return dst;
+}
+
+
+void ConvertRGB2HSV(
+    const ImageBuffer &image_rgb, ImageBuffer *dst, bool is_bgr_format) {
+  if (helpers::IsAliasedOutput(dst, {&image_rgb})) {
+    helpers::AssignOutput(dst, ConvertRGB2HSV(image_rgb, is_bgr_format));
+    return;
+  }
+  helpers::RGBx2HSV(image_rgb, *dst, is_bgr_format);
+}
+
+
+ImageBuffer ConvertRGB2Lab(const ImageBuffer &image_rgb, bool is_bgr_format) {
+  ImageBuffer dst;
+  ConvertRGB2Lab(image_rgb, &dst, is_bgr_format);
+  return dst;
+}
+
+
+void ConvertRGB2Lab(
+    const ImageBuffer &image_rgb, ImageBuffer *dst, bool is_bgr_format) {
+  if (helpers::IsAliasedOutput(dst, {&image_rgb})) {
+    helpers::AssignOutput(dst, ConvertRGB2Lab(image_rgb, is_bgr_format));
+    return;
+  }
+  helpers::RGBx2Lab(image_rgb, *dst, is_bgr_format);
 }
 
 
@@ -1310,105 +2854,175 @@ ImageBuffer MaskHSVRange(const ImageBuffer &hsv,
     throw std::invalid_argument(s);
   }
 
-  std::function<unsigned char(float)> cvt_hue = [](float h) {
-    return static_cast<unsigned char>(h / 2.0f);
-  };
-
-  std::function<unsigned char(float)> cvt_sv = [](float v) {
-    return static_cast<unsigned char>(255.0f * v);
-  };
-
+  const helpers::simd::HSVRange range = helpers::QuantizeHSVRange(
+        hue_range, saturation_range, value_range);
   return hsv.MaskRange(
-        cvt_hue(hue_range.first), cvt_hue(hue_range.second),
-        cvt_sv(saturation_range.first), cvt_sv(saturation_range.second),
-        cvt_sv(value_range.first), cvt_sv(value_range.second));
+        range.hue_min, range.hue_max,
+        range.saturation_min, range.saturation_max,
+        range.value_min, range.value_max);
 }
 
 
-ImageBuffer ColorPop(const ImageBuffer &image,
+ImageBuffer MaskColorRange(const ImageBuffer &image,
     const std::pair<float, float> &hue_range,
     const std::pair<float, float> &saturation_range,
     const std::pair<float, float> &value_range,
     bool is_bgr) {
-  if (!image.IsValid()) {
-    throw std::logic_error(
-          "Cannot apply `ColorPop` on invalid ImageBuffer!");
+  helpers::CheckHSVRangeInput(image, "MaskColorRange");
+
+  ImageBuffer mask;
+  helpers::MaskRGBxHSVRange(
+        image, mask,
+        helpers::QuantizeHSVRange(hue_range, saturation_range, value_range),
+        is_bgr);
+  return mask;
+}
+
+
+PackedMask MaskHSVRangePacked(const ImageBuffer &hsv,
+    const std::pair<float, float> &hue_range,
+    const std::pair<float, float> &saturation_range,
+    const std::pair<float, float> &value_range) {
+  if ((hsv.Channels() != 3) || (hsv.BufferType() != ImageBufferType::UInt8)) {
+    std::string s(
+          "Invalid input to `MaskHSVRangePacked`. Expected 3-channel HSV of "
+          "type uint8, but got: ");
+    s += hsv.ToString();
+    s += '!';
+    SPDLOG_ERROR(s);
+    throw std::invalid_argument(s);
   }
 
-  if ((image.Channels() < 2) || (image.Channels() > 4)
-      || (image.BufferType() != ImageBufferType::UInt8)) {
-    std::ostringstream s;
-    s << "`ColorPop` can only be applied on RGB(A)/BGR(A) inputs buffers of "
-         "type `uint8`, but got: " << image.ToString() << '!';
-    throw std::invalid_argument(s.str());
-  }
-
-  const ImageBuffer hsv = ConvertRGB2HSV(image, is_bgr);
-  const ImageBuffer mask = MaskHSVRange(
-        hsv, hue_range, saturation_range, value_range);
-  const ImageBuffer gray = viren2d::ConvertRGB2Gray(image, 1);
-
-  ImageBuffer pop = image.DeepCopy();
-  for (int row = 0; row < image.Height(); ++row) {
-    for (int col = 0; col < image.Width(); ++col) {
-      if (mask.AtUnchecked<unsigned char>(row, col) == 0) {
-        pop.AtUnchecked<unsigned char>(row, col, 0) = gray.AtUnchecked<unsigned char>(row, col);
-        pop.AtUnchecked<unsigned char>(row, col, 1) = gray.AtUnchecked<unsigned char>(row, col);
-        pop.AtUnchecked<unsigned char>(row, col, 2) = gray.AtUnchecked<unsigned char>(row, col);
-      }
+  const helpers::simd::HSVRange range = helpers::QuantizeHSVRange(
+        hue_range, saturation_range, value_range);
+  return hsv.MaskRangePacked(
+        range.hue_min, range.hue_max,
+        range.saturation_min, range.saturation_max,
+        range.value_min, range.value_max);
+}
+
+
+PackedMask MaskColorRangePacked(const ImageBuffer &image,
+    const std::pair<float, float> &hue_range,
+    const std::pair<float, float> &saturation_range,
+    const std::pair<float, float> &value_range,
+    bool is_bgr) {
+  helpers::CheckHSVRangeInput(image, "MaskColorRangePacked");
+
+  const helpers::simd::HSVRange range = helpers::QuantizeHSVRange(
+        hue_range, saturation_range, value_range);
+  const auto &kernels = helpers::simd::Kernels<uint8_t>();
+  const int channels = image.Channels();
+  PackedMask mask(image.Height(), image.Width());
+  helpers::ApplyBitKernel<uint8_t>(
+        image, mask,
+        [&kernels, &range, channels, is_bgr](
+          const uint8_t *src_ptr, uint64_t *bits, int64_t num_pixels) {
+    // Chunks of the byte mask are packed while they are still cached.
+    constexpr int64_t kChunkSize = 1024;
+    uint8_t chunk[kChunkSize];
+    for (int64_t i = 0; i < num_pixels; i += kChunkSize) {
+      const int64_t num_chunk = std::min(kChunkSize, num_pixels - i);
+      kernels.mask_hsv_range(
+            src_ptr + channels * i, chunk, num_chunk, channels, is_bgr, range);
+      kernels.pack_bits(chunk, bits + i / 64, num_chunk, 1);
     }
-  }
+  });
+  return mask;
+}
+
+
+ImageBuffer ColorPop(const ImageBuffer &image,
+    const std::pair<float, float> &hue_range,
+    const std::pair<float, float> &saturation_range,
+    const std::pair<float, float> &value_range,
+    bool is_bgr) {
+  helpers::CheckHSVRangeInput(image, "ColorPop");
+
+  ImageBuffer pop;
+  helpers::ColorPopRGBx(
+        image, pop,
+        helpers::QuantizeHSVRange(hue_range, saturation_range, value_range),
+        is_bgr);
   return pop;
 }
 
 
 ImageBuffer ConvertRGB2Gray(
     const ImageBuffer &color, int output_channels, bool is_bgr_format) {
+  ImageBuffer dst;
+  ConvertRGB2Gray(color, &dst, output_channels, is_bgr_format);
+  return dst;
+}
+
+
+void ConvertRGB2Gray(
+    const ImageBuffer &color, ImageBuffer *dst,
+    int output_channels, bool is_bgr_format) {
   if (!color.IsValid()) {
     throw std::logic_error(
           "Cannot convert an invalid ImageBuffer to grayscale!");
   }
 
   if (color.Channels() == 1) {
-    return color.ToChannels(output_channels);
+    color.ToChannels(dst, output_channels);
   } else if ((color.Channels() == 3)
              || (color.Channels() == 4)) {
+    if (helpers::IsAliasedOutput(dst, {&color})) {
+      helpers::AssignOutput(
+            dst, ConvertRGB2Gray(color, output_channels, is_bgr_format));
+      return;
+    }
+
     switch (color.BufferType()) {
       case ImageBufferType::UInt8:
-        return helpers::RGBx2Gray<uint8_t>(
-              color, output_channels, is_bgr_format);
+        helpers::RGBx2Gray<uint8_t>(
+              color, *dst, output_channels, is_bgr_format);
+        return;
 
       case ImageBufferType::Int16:
-        return helpers::RGBx2Gray<int16_t>(
-              color, output_channels, is_bgr_format);
+        helpers::RGBx2Gray<int16_t>(
+              color, *dst, output_channels, is_bgr_format);
+        return;
 
       case ImageBufferType::UInt16:
-        return helpers::RGBx2Gray<uint16_t>(
-              color, output_channels, is_bgr_format);
+        helpers::RGBx2Gray<uint16_t>(
+              color, *dst, output_channels, is_bgr_format);
+        return;
 
       case ImageBufferType::Int32:
-        return helpers::RGBx2Gray<int32_t>(
-              color, output_channels, is_bgr_format);
+        helpers::RGBx2Gray<int32_t>(
+              color, *dst, output_channels, is_bgr_format);
+        return;
 
       case ImageBufferType::UInt32:
-        return helpers::RGBx2Gray<uint32_t>(
-              color, output_channels, is_bgr_format);
+        helpers::RGBx2Gray<uint32_t>(
+              color, *dst, output_channels, is_bgr_format);
+        return;
 
       case ImageBufferType::Int64:
-        return helpers::RGBx2Gray<int64_t>(
-              color, output_channels, is_bgr_format);
+        helpers::RGBx2Gray<int64_t>(
+              color, *dst, output_channels, is_bgr_format);
+        return;
 
       case ImageBufferType::UInt64:
-        return helpers::RGBx2Gray<uint64_t>(
-              color, output_channels, is_bgr_format);
+        helpers::RGBx2Gray<uint64_t>(
+              color, *dst, output_channels, is_bgr_format);
+        return;
 
       case ImageBufferType::Float:
-        return helpers::RGBx2Gray<float>(
-              color, output_channels, is_bgr_format);
+        helpers::RGBx2Gray<float>(
+              color, *dst, output_channels, is_bgr_format);
+        return;
 
       case ImageBufferType::Double:
-        return helpers::RGBx2Gray<double>(
-              color, output_channels, is_bgr_format);
+        helpers::RGBx2Gray<double>(
+              color, *dst, output_channels, is_bgr_format);
+        return;
+
+      case ImageBufferType::Float16:
+      case ImageBufferType::BFloat16:
+        helpers::ThrowHalfPrecisionNotSupported(color, "ConvertRGB2Gray");
     }
 
     // Throw an exception as fallback, because ending up here would be an
@@ -1436,6 +3050,13 @@ ImageBuffer ConvertHSV2RGB(
 }
 
 
+ImageBuffer ConvertLab2RGB(
+    const ImageBuffer &image_lab, int output_channels,
+    bool output_bgr_format) {
+  return helpers::Lab2RGBx(image_lab, output_channels, output_bgr_format);
+}
+
+
 ImageBuffer LoadImageUInt8(
     const std::string &image_filename,
     int force_num_channels) {
@@ -1466,14 +3087,9 @@ ImageBuffer LoadImageUInt8(
         data, height, width, num_channels,
         width * num_channels, num_channels,
         ImageBufferType::UInt8);
-  // Then, transfer ownership
-  buffer.TakeOwnership();
-  // Alternatively, we could create an explicit copy and free the stbi memory:
-  //     buffer.CreateCopy(data, width, height, num_channels,
-  //                       width * num_channels);
-  //     stbi_image_free(data);
-  // But according to valgrind, the reuse option works as intended, i.e. it
-  // not leak memory (stbi only allocates the data buffer).
+  // Then, transfer ownership. The memory must be released by stbi, as
+  // it might have been allocated by a custom STBI_MALLOC.
+  buffer.TakeOwnership([](unsigned char *ptr) { stbi_image_free(ptr); });
   return buffer;
 }
 
@@ -1499,14 +3115,13 @@ void SaveImageUInt8(
   const std::string fn_lower = werkzeugkiste::strings::Lower(image_filename);
   if (werkzeugkiste::strings::EndsWith(fn_lower, ".jpg")
       || werkzeugkiste::strings::EndsWith(fn_lower, ".jpeg")) {
-    // stbi_write_jpg requires contiguous memory
+    // stbi_write_jpg requires contiguous memory, but buffers will
+    // usually have padded rows. A deep copy is always contiguous, thus
+    // the recursion is guaranteed to end.
     if (!image.IsContiguous()) {
-      const std::string msg(
-            "Cannot save JPEG because image memory is not contiguous!");
-      SPDLOG_ERROR(msg);
-      // TODO we could create a deep copy (which will be contiguous) and
-      // then recurse (but ensure that this is only tried once!)
-      throw std::logic_error(msg);
+      SPDLOG_DEBUG("SaveImage: JPEG output requires a contiguous copy.");
+      SaveImageUInt8(image_filename, image.DeepCopy());
+      return;
     }
     // Default JPEG quality setting: 90%
     stb_result = stbi_write_jpg(
@@ -1514,9 +3129,18 @@ void SaveImageUInt8(
           image.Channels(), image.ImmutableData(), 90);
   } else {
     if (werkzeugkiste::strings::EndsWith(fn_lower, ".png")) {
+      // stbi_write_png supports padded rows, but requires packed pixels.
+      if ((image.PixelStride() != image.Channels())
+          || !image.HasContiguousChannels()
+          || (image.RowStride() < 0)) {
+        SPDLOG_DEBUG("SaveImage: PNG output requires packed pixels.");
+        SaveImageUInt8(image_filename, image.DeepCopy());
+        return;
+      }
       stb_result = stbi_write_png(
             image_filename.c_str(), image.Width(), image.Height(),
-            image.Channels(), image.ImmutableData(), image.RowStride());
+            image.Channels(), image.ImmutableData(),
+            static_cast<int>(image.RowStride()));
     } else {
       const std::string msg(
             "ImageBuffer can only be saved as JPEG or PNG. File extension "
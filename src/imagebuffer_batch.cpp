@@ -0,0 +1,159 @@
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <viren2d/imagebuffer.h>
+
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+ImageBatch::ImageBatch(
+    int num_frames, int h, int w, int ch, ImageBufferType buf_type,
+    ImageLayout layout) {
+  SPDLOG_DEBUG(
+        "ImageBatch constructor allocating memory for {:d} {:d}x{:d}x{:d} "
+        "{:s} images, {:s} layout.", num_frames, h, w, ch,
+        ImageBufferTypeToString(buf_type), ImageLayoutToString(layout));
+  if ((num_frames <= 0) || (h <= 0) || (w <= 0) || (ch <= 0)) {
+    std::ostringstream msg;
+    msg << "Invalid ImageBatch shape " << num_frames << "x" << h << "x"
+        << w << "x" << ch << ", all dimensions must be > 0!";
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  // The frames are stored as a single contiguous image (with N*H rows,
+  // or N*C*H rows for planar batches), which also takes care of using
+  // the currently active allocator. Thus, the number of rows must fit
+  // into an int and the number of bytes into an int64_t.
+  const bool planar = (layout == ImageLayout::Planar);
+  const int64_t rows = static_cast<int64_t>(num_frames) * h * (planar ? ch : 1);
+  const int64_t pixel_bytes = static_cast<int64_t>(planar ? 1 : ch)
+      * ElementSizeFromImageBufferType(buf_type);
+  if ((rows > std::numeric_limits<int>::max())
+      || ((rows * w) > (std::numeric_limits<int64_t>::max() / pixel_bytes))) {
+    std::ostringstream msg;
+    msg << "ImageBatch of " << num_frames << "x" << h << "x" << w << "x"
+        << ch << ' ' << ImageBufferTypeToString(buf_type)
+        << " images exceeds the maximum buffer size!";
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  const ImageBuffer memory(
+        static_cast<int>(rows), w, planar ? 1 : ch, buf_type, 1);
+  if (!memory.IsValid()) {
+    std::ostringstream msg;
+    msg << "Cannot allocate an ImageBatch of " << num_frames << "x" << h
+        << "x" << w << "x" << ch << ' ' << ImageBufferTypeToString(buf_type)
+        << " images!";
+    SPDLOG_ERROR(msg.str());
+    throw std::runtime_error(msg.str());
+  }
+
+  CreateSharedBatch(
+        const_cast<unsigned char *>(memory.ImmutableData()), num_frames,
+        h, w, ch, buf_type, layout);
+  storage_ = memory.storage;
+}
+
+
+void ImageBatch::CreateSharedBatch(
+    unsigned char *buffer, int num_frames, int height, int width,
+    int channels, ImageBufferType buffer_type, ImageLayout layout) {
+  const int64_t element_size = ElementSizeFromImageBufferType(buffer_type);
+  const int64_t frame_stride =
+      static_cast<int64_t>(height) * width * channels * element_size;
+  if (layout == ImageLayout::Planar) {
+    CreateSharedBatch(
+          buffer, num_frames, height, width, channels, frame_stride,
+          width * element_size, element_size,
+          static_cast<int64_t>(height) * width * element_size, buffer_type);
+  } else {
+    CreateSharedBatch(
+          buffer, num_frames, height, width, channels, frame_stride,
+          static_cast<int64_t>(width) * channels * element_size,
+          channels * element_size, element_size, buffer_type);
+  }
+}
+
+
+void ImageBatch::CreateSharedBatch(
+    unsigned char *buffer, int num_frames, int height, int width,
+    int channels, int64_t frame_stride, int64_t row_stride,
+    int64_t pixel_stride, int64_t channel_stride,
+    ImageBufferType buffer_type) {
+  SPDLOG_DEBUG(
+        "ImageBatch::CreateSharedBatch: n={:d}, h={:d}, w={:d}, ch={:d},"
+        " {:s}, frame_stride={:d}, row_stride={:d}, col_stride={:d},"
+        " ch_stride={:d}.", num_frames, height, width, channels,
+        ImageBufferTypeToString(buffer_type), frame_stride, row_stride,
+        pixel_stride, channel_stride);
+  if (!buffer || (num_frames <= 0) || (height <= 0)
+      || (width <= 0) || (channels <= 0)) {
+    std::ostringstream msg;
+    msg << "Invalid ImageBatch data: " << num_frames << "x" << height << "x"
+        << width << "x" << channels << " images, all dimensions must be > 0"
+        << " and the buffer must not be nullptr!";
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  storage_.reset();
+  data_ = buffer;
+  num_frames_ = num_frames;
+  height_ = height;
+  width_ = width;
+  channels_ = channels;
+  frame_stride_ = frame_stride;
+  row_stride_ = row_stride;
+  pixel_stride_ = pixel_stride;
+  channel_stride_ = channel_stride;
+  buffer_type_ = buffer_type;
+}
+
+
+ImageBuffer ImageBatch::Frame(int index) {
+  CheckFrameIndex(index);
+  return ImageBuffer::CreateMappedBuffer(
+        storage_, data_ + index * frame_stride_, height_, width_, channels_,
+        row_stride_, pixel_stride_, channel_stride_, buffer_type_, false);
+}
+
+
+ImageBuffer ImageBatch::FrameView(int index) const {
+  CheckFrameIndex(index);
+  return ImageBuffer::CreateMappedBuffer(
+        storage_, data_ + index * frame_stride_, height_, width_, channels_,
+        row_stride_, pixel_stride_, channel_stride_, buffer_type_, true);
+}
+
+
+std::string ImageBatch::ToString() const {
+  if (!IsValid()) {
+    return "ImageBatch(invalid)";
+  }
+
+  std::ostringstream s;
+  s << "ImageBatch(" << num_frames_ << "x" << width_ << "x" << height_
+    << "x" << channels_ << ", " << ImageBufferTypeToString(buffer_type_)
+    << ", " << ImageLayoutToString(Layout())
+    << (OwnsData() ? ", copied memory)" : ", shared memory)");
+  return s.str();
+}
+
+
+void ImageBatch::CheckFrameIndex(int index) const {
+  if ((index < 0) || (index >= num_frames_)) {
+    std::ostringstream msg;
+    msg << "Frame index " << index << " is out of range for "
+        << ToString() << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::out_of_range(msg.str());
+  }
+}
+}  // namespace viren2d
@@ -0,0 +1,511 @@
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <viren2d/imagebuffer.h>
+
+#include <helpers/imagebuffer_helpers.impl.h>
+#include <helpers/logging.h>
+#include <helpers/parallel.h>
+
+
+namespace viren2d {
+/// A single recorded element-wise operation.
+struct PixelExpression::Operation {
+  enum class Type : int {
+    Normalize,
+    Scale,
+    Clamp,
+    BlendConstant,
+    BlendWeights
+  };
+
+  Type type;
+
+  /// Number of channels before & after this operation.
+  int channels_in;
+  int channels_out;
+
+  /// Normalize: shift_pre, scale & shift_post per channel (i.e. 3 blocks
+  ///   of `channels_in` values).
+  /// Scale: factor.
+  /// Clamp: min & max value.
+  /// BlendConstant: alpha of the other buffer.
+  std::vector<double> params;
+
+  /// Blending inputs.
+  ImageBuffer other;
+  ImageBuffer weights;
+};
+
+
+namespace helpers {
+namespace {
+/// Number of pixels which are processed at once. The intermediate values
+/// of a tile (i.e. a few KB of doubles) should stay in the L1 cache.
+constexpr int kExpressionTileSize = 256;
+
+
+/// Loads `num_pixels` consecutive pixels (starting at row/col) into
+/// the tile, where subsequent pixels are `tile_channels` apart.
+using TileLoader = void (*)(
+    const ImageBuffer &buf, int row, int col, int num_pixels,
+    double *tile, int tile_channels);
+
+
+/// Stores the first `channels` values of each tile pixel.
+using TileStorer = void (*)(
+    const double *tile, int tile_channels, int num_pixels,
+    const PixelWriter &dst, int channels, int row, int col);
+
+
+template <typename _Tp>
+void LoadTile(
+    const ImageBuffer &buf, int row, int col, int num_pixels,
+    double *tile, int tile_channels) {
+  const int channels = buf.Channels();
+  const int64_t pixel_stride = buf.PixelStride();
+  const int64_t channel_stride = buf.ChannelStride();
+  const unsigned char *ptr = buf.ImmutablePtr<unsigned char>(row, col, 0);
+  for (int i = 0; i < num_pixels; ++i) {
+    for (int ch = 0; ch < channels; ++ch) {
+      tile[ch] = static_cast<double>(
+            *reinterpret_cast<const _Tp *>(ptr + ch * channel_stride));
+    }
+    ptr += pixel_stride;
+    tile += tile_channels;
+  }
+}
+
+
+template <typename _Tp>
+void StoreTile(
+    const double *tile, int tile_channels, int num_pixels,
+    const PixelWriter &dst, int channels, int row, int col) {
+  const int64_t pixel_stride = dst.PixelStride();
+  const int64_t channel_stride = dst.ChannelStride();
+  unsigned char *ptr = dst.Ptr<unsigned char>(row, col, 0);
+  for (int i = 0; i < num_pixels; ++i) {
+    for (int ch = 0; ch < channels; ++ch) {
+      *reinterpret_cast<_Tp *>(ptr + ch * channel_stride) =
+          SaturateCast<_Tp>(tile[ch]);
+    }
+    ptr += pixel_stride;
+    tile += tile_channels;
+  }
+}
+
+
+TileLoader GetTileLoader(ImageBufferType type) {
+  switch (type) {
+    case ImageBufferType::UInt8:
+      return LoadTile<uint8_t>;
+
+    case ImageBufferType::Int16:
+      return LoadTile<int16_t>;
+
+    case ImageBufferType::UInt16:
+      return LoadTile<uint16_t>;
+
+    case ImageBufferType::Int32:
+      return LoadTile<int32_t>;
+
+    case ImageBufferType::UInt32:
+      return LoadTile<uint32_t>;
+
+    case ImageBufferType::Int64:
+      return LoadTile<int64_t>;
+
+    case ImageBufferType::UInt64:
+      return LoadTile<uint64_t>;
+
+    case ImageBufferType::Float:
+      return LoadTile<float>;
+
+    case ImageBufferType::Double:
+      return LoadTile<double>;
+
+    case ImageBufferType::Float16:
+      return LoadTile<float16_t>;
+
+    case ImageBufferType::BFloat16:
+      return LoadTile<bfloat16_t>;
+  }
+
+  // Throw an exception as fallback, because ending up here would be an
+  // implementation error (i.e. we ignored the warning about missing value
+  // in the switch/case above).
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(type);
+  msg += "` not handled in `GetTileLoader` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
+TileStorer GetTileStorer(ImageBufferType type) {
+  switch (type) {
+    case ImageBufferType::UInt8:
+      return StoreTile<uint8_t>;
+
+    case ImageBufferType::Int16:
+      return StoreTile<int16_t>;
+
+    case ImageBufferType::UInt16:
+      return StoreTile<uint16_t>;
+
+    case ImageBufferType::Int32:
+      return StoreTile<int32_t>;
+
+    case ImageBufferType::UInt32:
+      return StoreTile<uint32_t>;
+
+    case ImageBufferType::Int64:
+      return StoreTile<int64_t>;
+
+    case ImageBufferType::UInt64:
+      return StoreTile<uint64_t>;
+
+    case ImageBufferType::Float:
+      return StoreTile<float>;
+
+    case ImageBufferType::Double:
+      return StoreTile<double>;
+
+    case ImageBufferType::Float16:
+      return StoreTile<float16_t>;
+
+    case ImageBufferType::BFloat16:
+      return StoreTile<bfloat16_t>;
+  }
+
+  // Throw an exception as fallback, see `GetTileLoader`.
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(type);
+  msg += "` not handled in `GetTileStorer` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
+/// Returns the per-channel values, i.e. replicates a single value.
+std::vector<double> PerChannel(
+    const std::vector<double> &values, int channels, const char *name) {
+  if (values.size() == 1) {
+    return std::vector<double>(channels, values[0]);
+  }
+
+  if (static_cast<int>(values.size()) != channels) {
+    std::ostringstream msg;
+    msg << "`Normalize` expects either a single `" << name
+        << "` or one per channel (i.e. " << channels << "), but got "
+        << values.size() << " values!";
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+  return values;
+}
+}  // anonymous namespace
+}  // namespace helpers
+
+
+PixelExpression::PixelExpression(const ImageBuffer &source)
+  : source_(source), channels_(source.Channels()) {
+  if (!source.IsValid()) {
+    const std::string msg(
+          "Cannot create a pixel expression from an invalid ImageBuffer!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+}
+
+
+int PixelExpression::Height() const {
+  return source_.Height();
+}
+
+
+int PixelExpression::Width() const {
+  return source_.Width();
+}
+
+
+int PixelExpression::Channels() const {
+  return channels_;
+}
+
+
+int PixelExpression::NumOperations() const {
+  return static_cast<int>(operations_.size());
+}
+
+
+PixelExpression &PixelExpression::Normalize(
+    const std::vector<double> &shift_pre,
+    const std::vector<double> &scale,
+    const std::vector<double> &shift_post) {
+  auto op = std::make_shared<Operation>();
+  op->type = Operation::Type::Normalize;
+  op->channels_in = channels_;
+  op->channels_out = channels_;
+  for (const auto &values : {
+         helpers::PerChannel(shift_pre, channels_, "shift_pre"),
+         helpers::PerChannel(scale, channels_, "scale"),
+         helpers::PerChannel(shift_post, channels_, "shift_post")}) {
+    op->params.insert(op->params.end(), values.begin(), values.end());
+  }
+  operations_.push_back(op);
+  return *this;
+}
+
+
+PixelExpression &PixelExpression::Scale(double factor) {
+  auto op = std::make_shared<Operation>();
+  op->type = Operation::Type::Scale;
+  op->channels_in = channels_;
+  op->channels_out = channels_;
+  op->params = {factor};
+  operations_.push_back(op);
+  return *this;
+}
+
+
+PixelExpression &PixelExpression::Clamp(double min_value, double max_value) {
+  if (min_value > max_value) {
+    std::ostringstream msg;
+    msg << "Invalid clamping range [" << min_value << ", "
+        << max_value << "]!";
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  auto op = std::make_shared<Operation>();
+  op->type = Operation::Type::Clamp;
+  op->channels_in = channels_;
+  op->channels_out = channels_;
+  op->params = {min_value, max_value};
+  operations_.push_back(op);
+  return *this;
+}
+
+
+PixelExpression &PixelExpression::Blend(
+    const ImageBuffer &other, double alpha_other) {
+  CheckCompatible(other, "blend with");
+
+  auto op = std::make_shared<Operation>();
+  op->type = Operation::Type::BlendConstant;
+  op->channels_in = channels_;
+  op->channels_out = std::max(channels_, other.Channels());
+  op->params = {alpha_other};
+  op->other = other;
+  operations_.push_back(op);
+  channels_ = op->channels_out;
+  return *this;
+}
+
+
+PixelExpression &PixelExpression::Blend(
+    const ImageBuffer &other, const ImageBuffer &weights) {
+  CheckCompatible(other, "blend with");
+  CheckCompatible(weights, "use as blending weights");
+
+  if ((weights.BufferType() != ImageBufferType::Float)
+      && (weights.BufferType() != ImageBufferType::Double)) {
+    std::string msg(
+          "Blending weights must be single or double precision "
+          "floating points, but got: ");
+    msg += ImageBufferTypeToString(weights.BufferType());
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  auto op = std::make_shared<Operation>();
+  op->type = Operation::Type::BlendWeights;
+  op->channels_in = channels_;
+  op->channels_out = std::max(channels_, other.Channels());
+  op->other = other;
+  op->weights = weights;
+  operations_.push_back(op);
+  channels_ = op->channels_out;
+  return *this;
+}
+
+
+void PixelExpression::CheckCompatible(
+    const ImageBuffer &buffer, const char *what) const {
+  if (!buffer.IsValid()
+      || (buffer.Width() != source_.Width())
+      || (buffer.Height() != source_.Height())) {
+    std::ostringstream msg;
+    msg << "Cannot " << what << ' ' << buffer.ToString()
+        << " in a pixel expression on " << source_.ToString()
+        << ", the buffer must be valid and of the same size!";
+    SPDLOG_ERROR(msg.str());
+    throw std::logic_error(msg.str());
+  }
+}
+
+
+ImageBuffer PixelExpression::Evaluate(ImageBufferType output_type) const {
+  ImageBuffer dst;
+  Evaluate(&dst, output_type);
+  return dst;
+}
+
+
+void PixelExpression::Evaluate(
+    ImageBuffer *dst, ImageBufferType output_type) const {
+  SPDLOG_DEBUG(
+        "Evaluating pixel expression with {:d} operation(s) on {:s} as "
+        "`{:s}`.", NumOperations(), source_.ToString(), output_type);
+
+  // All inputs are read tile by tile, thus the output must not overlap
+  // any of them.
+  std::vector<const ImageBuffer *> inputs{&source_};
+  for (const auto &op : operations_) {
+    inputs.push_back(&op->other);
+    inputs.push_back(&op->weights);
+  }
+  for (const ImageBuffer *input : inputs) {
+    if (helpers::IsAliasedOutput(dst, {input})) {
+      helpers::AssignOutput(dst, Evaluate(output_type));
+      return;
+    }
+  }
+
+  dst->EnsureShape(
+        source_.Height(), source_.Width(), channels_, output_type);
+
+  // Select the type-specific tile accessors once.
+  const helpers::TileLoader load_source =
+      helpers::GetTileLoader(source_.BufferType());
+  const helpers::TileStorer store =
+      helpers::GetTileStorer(output_type);
+  std::vector<helpers::TileLoader> load_other(operations_.size(), nullptr);
+  std::vector<helpers::TileLoader> load_weights(operations_.size(), nullptr);
+
+  int tile_channels = source_.Channels();
+  int weight_channels = 1;
+  bool flattenable = source_.IsFlattenable() && dst->IsFlattenable();
+  for (std::size_t idx = 0; idx < operations_.size(); ++idx) {
+    const Operation &op = *operations_[idx];
+    tile_channels = std::max(tile_channels, op.channels_out);
+    if (op.other.IsValid()) {
+      load_other[idx] = helpers::GetTileLoader(op.other.BufferType());
+      flattenable &= op.other.IsFlattenable();
+    }
+    if (op.weights.IsValid()) {
+      load_weights[idx] = helpers::GetTileLoader(op.weights.BufferType());
+      weight_channels = std::max(weight_channels, op.weights.Channels());
+      flattenable &= op.weights.IsFlattenable();
+    }
+  }
+
+  int rows = source_.Height();
+  int cols = source_.Width();
+  if (flattenable) {
+    cols *= rows;
+    rows = 1;
+  }
+
+  constexpr int tile_size = helpers::kExpressionTileSize;
+  const helpers::PixelWriter out(*dst);
+  helpers::ParallelForPixels(
+        rows, cols, tile_channels * (NumOperations() + 1),
+        [&](int row, int col_begin, int col_end) {
+    std::vector<double> tile(tile_size * tile_channels);
+    std::vector<double> other(tile_size * tile_channels);
+    std::vector<double> weights(tile_size * weight_channels);
+
+    for (int col = col_begin; col < col_end; col += tile_size) {
+      const int num_pixels = std::min(tile_size, col_end - col);
+      const int num_values = num_pixels * tile_channels;
+      load_source(source_, row, col, num_pixels, tile.data(), tile_channels);
+
+      for (std::size_t idx = 0; idx < operations_.size(); ++idx) {
+        const Operation &op = *operations_[idx];
+        switch (op.type) {
+          case Operation::Type::Normalize: {
+              const double *shift_pre = op.params.data();
+              const double *scale = shift_pre + op.channels_in;
+              const double *shift_post = scale + op.channels_in;
+              for (int i = 0; i < num_values; i += tile_channels) {
+                for (int ch = 0; ch < op.channels_in; ++ch) {
+                  tile[i + ch] = ((tile[i + ch] + shift_pre[ch]) * scale[ch])
+                      + shift_post[ch];
+                }
+              }
+              break;
+            }
+
+          case Operation::Type::Scale: {
+              const double factor = op.params[0];
+              for (int i = 0; i < num_values; i += tile_channels) {
+                for (int ch = 0; ch < op.channels_in; ++ch) {
+                  tile[i + ch] *= factor;
+                }
+              }
+              break;
+            }
+
+          case Operation::Type::Clamp: {
+              const double min_value = op.params[0];
+              const double max_value = op.params[1];
+              for (int i = 0; i < num_values; i += tile_channels) {
+                for (int ch = 0; ch < op.channels_in; ++ch) {
+                  tile[i + ch] = std::min(
+                        max_value, std::max(min_value, tile[i + ch]));
+                }
+              }
+              break;
+            }
+
+          case Operation::Type::BlendConstant:
+          case Operation::Type::BlendWeights: {
+              load_other[idx](
+                    op.other, row, col, num_pixels,
+                    other.data(), tile_channels);
+              const bool const_alpha =
+                  (op.type == Operation::Type::BlendConstant);
+              const int wc = const_alpha ? 1 : op.weights.Channels();
+              if (!const_alpha) {
+                load_weights[idx](
+                      op.weights, row, col, num_pixels, weights.data(), wc);
+              }
+
+              // Same channel handling as `ImageBuffer::Blend`: Channels
+              // which exist only in one of the inputs are copied.
+              const int channels_to_blend = std::min(
+                    op.channels_in, op.other.Channels());
+              for (int px = 0; px < num_pixels; ++px) {
+                double *v = tile.data() + px * tile_channels;
+                const double *o = other.data() + px * tile_channels;
+                for (int ch = 0; ch < channels_to_blend; ++ch) {
+                  const double alpha = const_alpha
+                      ? op.params[0]
+                      : weights[px * wc + ((ch < wc) ? ch : 0)];
+                  v[ch] = ((1.0 - alpha) * v[ch]) + (alpha * o[ch]);
+                }
+                for (int ch = op.channels_in; ch < op.channels_out; ++ch) {
+                  v[ch] = o[ch];
+                }
+              }
+              break;
+            }
+        }
+      }
+
+      store(tile.data(), tile_channels, num_pixels, out, channels_, row, col);
+    }
+  });
+}
+
+
+PixelExpression ImageBuffer::Lazy() const {
+  return PixelExpression(*this);
+}
+
+}  // namespace viren2d
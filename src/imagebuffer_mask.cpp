@@ -0,0 +1,339 @@
+#include <bitset>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <viren2d/imagebuffer.h>
+
+#include <helpers/imagebuffer_helpers.impl.h>
+#include <helpers/logging.h>
+#include <helpers/parallel.h>
+#include <helpers/simd_kernels.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// Returns the bits of the last word of a row which correspond to
+/// actual pixels (*i.e.* excluding the padding).
+inline uint64_t LastWordBits(int width) {
+  const int num_bits = width & 63;
+  return (num_bits == 0)
+      ? ~uint64_t(0) : ((uint64_t(1) << num_bits) - 1);
+}
+
+
+template <typename _Tp>
+void MaskRangePackedHelper(
+    const ImageBuffer &src, PackedMask &mask, const _Tp *min_max) {
+  const int channels = src.Channels();
+  if constexpr (HasConversionKernels<_Tp>()) {
+    const auto &kernels = simd::Kernels<_Tp>();
+    ApplyBitKernel<_Tp>(
+          src, mask,
+          [&kernels, channels, min_max](
+            const _Tp *src_ptr, uint64_t *bits, int64_t num_pixels) {
+      kernels.mask_range_bits(src_ptr, bits, num_pixels, channels, min_max);
+    });
+  } else {
+    ApplyBitKernel<_Tp>(
+          src, mask,
+          [channels, min_max](
+            const _Tp *src_ptr, uint64_t *bits, int64_t num_pixels) {
+      for (int64_t i = 0; i < num_pixels; ++i, src_ptr += channels) {
+        bool within_range = true;
+        for (int ch = 0; ch < channels; ++ch) {
+          if ((src_ptr[ch] < min_max[2 * ch])
+              || (src_ptr[ch] > min_max[2 * ch + 1])) {
+            within_range = false;
+          }
+        }
+        if ((i & 63) == 0) {
+          bits[i >> 6] = 0;
+        }
+        bits[i >> 6] |= static_cast<uint64_t>(within_range) << (i & 63);
+      }
+    });
+  }
+}
+
+
+template <typename _Tp>
+void PackBitsHelper(const ImageBuffer &src, PackedMask &mask) {
+  const int channels = src.Channels();
+  if constexpr (HasConversionKernels<_Tp>()) {
+    const auto &kernels = simd::Kernels<_Tp>();
+    ApplyBitKernel<_Tp>(
+          src, mask,
+          [&kernels, channels](
+            const _Tp *src_ptr, uint64_t *bits, int64_t num_pixels) {
+      kernels.pack_bits(src_ptr, bits, num_pixels, channels);
+    });
+  } else {
+    ApplyBitKernel<_Tp>(
+          src, mask,
+          [channels](const _Tp *src_ptr, uint64_t *bits, int64_t num_pixels) {
+      for (int64_t i = 0; i < num_pixels; ++i, src_ptr += channels) {
+        if ((i & 63) == 0) {
+          bits[i >> 6] = 0;
+        }
+        bits[i >> 6] |= static_cast<uint64_t>(
+              src_ptr[0] != static_cast<_Tp>(0)) << (i & 63);
+      }
+    });
+  }
+}
+}  // anonymous namespace
+}  // namespace helpers
+
+
+PackedMask::PackedMask(int height, int width, bool value) {
+  if ((height <= 0) || (width <= 0)) {
+    std::ostringstream msg;
+    msg << "Invalid PackedMask size: " << width << "x" << height << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  height_ = height;
+  width_ = width;
+  words_per_row_ = (static_cast<int64_t>(width) + 63) / 64;
+  words_.assign(
+        static_cast<std::size_t>(words_per_row_ * height),
+        value ? ~uint64_t(0) : uint64_t(0));
+
+  if (value) {
+    // Padding bits must remain 0
+    const uint64_t last = helpers::LastWordBits(width);
+    for (int row = 0; row < height; ++row) {
+      MutableRowPtr(row)[words_per_row_ - 1] = last;
+    }
+  }
+}
+
+
+PackedMask::PackedMask(const ImageBuffer &mask) {
+  if (!mask.IsValid() || (mask.Channels() != 1)) {
+    std::string msg(
+          "A PackedMask can only be created from a valid single-channel "
+          "ImageBuffer, but got ");
+    msg += mask.ToString();
+    msg += '!';
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
+
+  *this = PackedMask(mask.Height(), mask.Width());
+  switch (mask.BufferType()) {
+    case ImageBufferType::UInt8:
+      helpers::PackBitsHelper<uint8_t>(mask, *this);
+      return;
+
+    case ImageBufferType::Int16:
+      helpers::PackBitsHelper<int16_t>(mask, *this);
+      return;
+
+    case ImageBufferType::UInt16:
+      helpers::PackBitsHelper<uint16_t>(mask, *this);
+      return;
+
+    case ImageBufferType::Int32:
+      helpers::PackBitsHelper<int32_t>(mask, *this);
+      return;
+
+    case ImageBufferType::UInt32:
+      helpers::PackBitsHelper<uint32_t>(mask, *this);
+      return;
+
+    case ImageBufferType::Int64:
+      helpers::PackBitsHelper<int64_t>(mask, *this);
+      return;
+
+    case ImageBufferType::UInt64:
+      helpers::PackBitsHelper<uint64_t>(mask, *this);
+      return;
+
+    case ImageBufferType::Float:
+      helpers::PackBitsHelper<float>(mask, *this);
+      return;
+
+    case ImageBufferType::Double:
+      helpers::PackBitsHelper<double>(mask, *this);
+      return;
+
+    case ImageBufferType::Float16:
+      helpers::PackBitsHelper<float16_t>(mask, *this);
+      return;
+
+    case ImageBufferType::BFloat16:
+      helpers::PackBitsHelper<bfloat16_t>(mask, *this);
+      return;
+  }
+
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(mask.BufferType());
+  msg += "` was not handled in `PackedMask` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+
+
+int64_t PackedMask::CountNonZero() const {
+  int64_t num_set = 0;
+  for (const uint64_t word : words_) {
+    num_set += static_cast<int64_t>(std::bitset<64>(word).count());
+  }
+  return num_set;
+}
+
+
+PackedMask PackedMask::Inverted() const {
+  PackedMask inverted(*this);
+  if (!IsValid()) {
+    return inverted;
+  }
+
+  const uint64_t last = helpers::LastWordBits(width_);
+  for (int row = 0; row < height_; ++row) {
+    uint64_t *bits = inverted.MutableRowPtr(row);
+    for (int64_t idx = 0; idx < words_per_row_; ++idx) {
+      bits[idx] = ~bits[idx];
+    }
+    bits[words_per_row_ - 1] &= last;
+  }
+  return inverted;
+}
+
+
+ImageBuffer PackedMask::ToImageBuffer() const {
+  if (!IsValid()) {
+    return ImageBuffer();
+  }
+
+  ImageBuffer dst(height_, width_, 1, ImageBufferType::UInt8);
+  unsigned char *data = helpers::PixelWriter(dst).Data();
+  const int64_t dst_stride = dst.RowStride();
+  helpers::ParallelFor(
+        0, height_, width_,
+        [&](int64_t row_begin, int64_t row_end) {
+    for (int64_t row = row_begin; row < row_end; ++row) {
+      const uint64_t *bits = RowPtr(static_cast<int>(row));
+      unsigned char *dst_ptr = data + row * dst_stride;
+      for (int col = 0; col < width_; ++col) {
+        dst_ptr[col] = ((bits[col >> 6] >> (col & 63)) & 1) ? 255 : 0;
+      }
+    }
+  });
+  return dst;
+}
+
+
+std::string PackedMask::ToString() const {
+  if (!IsValid()) {
+    return "PackedMask(invalid)";
+  }
+
+  std::ostringstream s;
+  s << "PackedMask(" << width_ << "x" << height_ << ", "
+    << CountNonZero() << " set)";
+  return s.str();
+}
+
+
+bool operator==(const PackedMask &lhs, const PackedMask &rhs) {
+  if ((lhs.Width() != rhs.Width()) || (lhs.Height() != rhs.Height())) {
+    return false;
+  }
+
+  for (int row = 0; row < lhs.Height(); ++row) {
+    const uint64_t *lhs_bits = lhs.RowPtr(row);
+    const uint64_t *rhs_bits = rhs.RowPtr(row);
+    for (int64_t idx = 0; idx < lhs.WordsPerRow(); ++idx) {
+      if (lhs_bits[idx] != rhs_bits[idx]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+
+bool operator!=(const PackedMask &lhs, const PackedMask &rhs) {
+  return !(lhs == rhs);
+}
+
+
+PackedMask ImageBuffer::MaskRangePackedImpl(const void *min_max) const {
+  if (!IsValid()) {
+    const std::string msg("Cannot compute `MaskRangePacked` of an invalid ImageBuffer!");
+    SPDLOG_ERROR(msg);
+    throw std::logic_error(msg);
+  }
+
+  PackedMask mask(height, width);
+  switch (buffer_type) {
+    case ImageBufferType::UInt8:
+      helpers::MaskRangePackedHelper<uint8_t>(
+            *this, mask, static_cast<const uint8_t *>(min_max));
+      return mask;
+
+    case ImageBufferType::Int16:
+      helpers::MaskRangePackedHelper<int16_t>(
+            *this, mask, static_cast<const int16_t *>(min_max));
+      return mask;
+
+    case ImageBufferType::UInt16:
+      helpers::MaskRangePackedHelper<uint16_t>(
+            *this, mask, static_cast<const uint16_t *>(min_max));
+      return mask;
+
+    case ImageBufferType::Int32:
+      helpers::MaskRangePackedHelper<int32_t>(
+            *this, mask, static_cast<const int32_t *>(min_max));
+      return mask;
+
+    case ImageBufferType::UInt32:
+      helpers::MaskRangePackedHelper<uint32_t>(
+            *this, mask, static_cast<const uint32_t *>(min_max));
+      return mask;
+
+    case ImageBufferType::Int64:
+      helpers::MaskRangePackedHelper<int64_t>(
+            *this, mask, static_cast<const int64_t *>(min_max));
+      return mask;
+
+    case ImageBufferType::UInt64:
+      helpers::MaskRangePackedHelper<uint64_t>(
+            *this, mask, static_cast<const uint64_t *>(min_max));
+      return mask;
+
+    case ImageBufferType::Float:
+      helpers::MaskRangePackedHelper<float>(
+            *this, mask, static_cast<const float *>(min_max));
+      return mask;
+
+    case ImageBufferType::Double:
+      helpers::MaskRangePackedHelper<double>(
+            *this, mask, static_cast<const double *>(min_max));
+      return mask;
+
+    case ImageBufferType::Float16:
+      helpers::MaskRangePackedHelper<float16_t>(
+            *this, mask, static_cast<const float16_t *>(min_max));
+      return mask;
+
+    case ImageBufferType::BFloat16:
+      helpers::MaskRangePackedHelper<bfloat16_t>(
+            *this, mask, static_cast<const bfloat16_t *>(min_max));
+      return mask;
+  }
+
+  std::string msg("Type `");
+  msg += ImageBufferTypeToString(buffer_type);
+  msg += "` was not handled in `MaskRangePacked` switch!";
+  SPDLOG_ERROR(msg);
+  throw std::logic_error(msg);
+}
+}  // namespace viren2d
@@ -0,0 +1,194 @@
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#include <viren2d/imagebuffer.h>
+
+#include <helpers/imagebuffer_npy.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace {
+/// A memory-mapped file, which will be unmapped once the
+/// last reference to `base` is released.
+struct FileMapping {
+  std::shared_ptr<unsigned char> base;
+  int64_t size = 0;
+};
+
+
+[[noreturn]] void ThrowMappingError(
+    const std::string &filename, const std::string &reason) {
+  std::string msg("Cannot memory-map \"");
+  msg += filename;
+  msg += "\": ";
+  msg += reason;
+  msg += '!';
+  SPDLOG_ERROR(msg);
+  throw std::runtime_error(msg);
+}
+
+
+/// Maps the whole file. A copy-on-write mapping is private, *i.e.* it can
+/// be modified without ever writing the changes back to the file.
+FileMapping MapFile(const std::string &filename, bool copy_on_write) {
+  FileMapping mapping;
+#ifdef _WIN32
+  HANDLE file = CreateFileA(
+        filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    ThrowMappingError(filename, "file cannot be opened");
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || (file_size.QuadPart == 0)) {
+    CloseHandle(file);
+    ThrowMappingError(filename, "file is empty or its size is unknown");
+  }
+  mapping.size = static_cast<int64_t>(file_size.QuadPart);
+
+  HANDLE file_mapping = CreateFileMappingA(
+        file, nullptr, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY,
+        0, 0, nullptr);
+  CloseHandle(file);
+  if (file_mapping == nullptr) {
+    ThrowMappingError(filename, "`CreateFileMapping` failed");
+  }
+
+  void *view = MapViewOfFile(
+        file_mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+  // The view keeps a reference to the mapping object.
+  CloseHandle(file_mapping);
+  if (view == nullptr) {
+    ThrowMappingError(filename, "`MapViewOfFile` failed");
+  }
+
+  mapping.base = std::shared_ptr<unsigned char>(
+        static_cast<unsigned char *>(view),
+        [](unsigned char *ptr) { UnmapViewOfFile(ptr); });
+#else  // _WIN32
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    ThrowMappingError(filename, "file cannot be opened");
+  }
+
+  struct stat file_stat;
+  if ((fstat(fd, &file_stat) != 0) || (file_stat.st_size <= 0)) {
+    close(fd);
+    ThrowMappingError(filename, "file is empty or its size is unknown");
+  }
+  mapping.size = static_cast<int64_t>(file_stat.st_size);
+
+  const std::size_t length = static_cast<std::size_t>(mapping.size);
+  void *view = mmap(
+        nullptr, length,
+        copy_on_write ? (PROT_READ | PROT_WRITE) : PROT_READ,
+        copy_on_write ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+  // The mapping stays valid after closing the descriptor.
+  close(fd);
+  if (view == MAP_FAILED) {
+    ThrowMappingError(filename, "`mmap` failed");
+  }
+
+  mapping.base = std::shared_ptr<unsigned char>(
+        static_cast<unsigned char *>(view),
+        [length](unsigned char *ptr) { munmap(ptr, length); });
+#endif  // _WIN32
+  return mapping;
+}
+
+
+/// Ensures that the mapped file holds the requested data and that
+/// the elements will be properly aligned.
+void CheckMappedRange(
+    const std::string &filename, const FileMapping &mapping,
+    int64_t offset, int64_t num_bytes, ImageBufferType buffer_type) {
+  const int64_t element_size = ElementSizeFromImageBufferType(buffer_type);
+  if ((offset < 0) || ((offset % element_size) != 0)) {
+    std::ostringstream msg;
+    msg << "Data offset " << offset << " of \"" << filename
+        << "\" must be a non-negative multiple of the element size ("
+        << element_size << " bytes for `"
+        << ImageBufferTypeToString(buffer_type) << "`)!";
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  if (offset + num_bytes > mapping.size) {
+    std::ostringstream msg;
+    msg << "File \"" << filename << "\" has " << mapping.size
+        << " bytes, but " << (offset + num_bytes)
+        << " bytes are required to map the requested ImageBuffer!";
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+}
+}  // anonymous namespace
+
+
+ImageBuffer MapRaw(
+    const std::string &filename, int height, int width, int channels,
+    ImageBufferType buffer_type, int64_t offset, bool copy_on_write) {
+  SPDLOG_DEBUG(
+        "MapRaw \"{:s}\" as {:d}x{:d}x{:d} `{:s}` at offset {:d}.",
+        filename, height, width, channels,
+        ImageBufferTypeToString(buffer_type), offset);
+  if ((height <= 0) || (width <= 0) || (channels <= 0)) {
+    std::ostringstream msg;
+    msg << "Invalid dimensions (h=" << height << ", w=" << width
+        << ", ch=" << channels << ") to map \"" << filename << "\"!";
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  const int64_t element_size = ElementSizeFromImageBufferType(buffer_type);
+  const int64_t pixel_stride = element_size * channels;
+  const int64_t row_stride = pixel_stride * width;
+
+  FileMapping mapping = MapFile(filename, copy_on_write);
+  CheckMappedRange(
+        filename, mapping, offset, row_stride * height, buffer_type);
+
+  unsigned char *mapped_data = mapping.base.get() + offset;
+  return ImageBuffer::CreateMappedBuffer(
+        std::move(mapping.base), mapped_data, height, width, channels,
+        row_stride, pixel_stride, element_size, buffer_type, !copy_on_write);
+}
+
+
+ImageBuffer MapNpy(const std::string &filename, bool copy_on_write) {
+  SPDLOG_DEBUG("MapNpy \"{:s}\".", filename);
+  FileMapping mapping = MapFile(filename, copy_on_write);
+  const helpers::NpyHeader header = helpers::ParseNpyHeader(
+        mapping.base.get(), static_cast<std::size_t>(mapping.size), filename);
+  CheckMappedRange(
+        filename, mapping, header.data_offset, header.NumBytes(),
+        header.buffer_type);
+
+  int64_t row_stride, pixel_stride, channel_stride;
+  header.Strides(&row_stride, &pixel_stride, &channel_stride);
+
+  unsigned char *mapped_data = mapping.base.get() + header.data_offset;
+  return ImageBuffer::CreateMappedBuffer(
+        std::move(mapping.base), mapped_data, header.height, header.width,
+        header.channels, row_stride, pixel_stride, channel_stride,
+        header.buffer_type, !copy_on_write);
+}
+
+}  // namespace viren2d
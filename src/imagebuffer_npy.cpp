@@ -0,0 +1,153 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <viren2d/imagebuffer.h>
+
+#include <helpers/imagebuffer_access.h>
+#include <helpers/imagebuffer_npy.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace {
+[[noreturn]] void ThrowNpyIOError(
+    const std::string &filename, const std::string &reason) {
+  std::string msg(reason);
+  msg += " \"";
+  msg += filename;
+  msg += "\"!";
+  SPDLOG_ERROR(msg);
+  throw std::runtime_error(msg);
+}
+}  // anonymous namespace
+
+
+ImageBuffer LoadNpy(const std::string &filename) {
+  SPDLOG_DEBUG("LoadNpy \"{:s}\".", filename);
+  std::ifstream file(filename, std::ios::in | std::ios::binary);
+  if (!file.is_open()) {
+    ThrowNpyIOError(filename, "Could not open NPY file");
+  }
+
+  // The preamble (magic string, version & header length) is followed
+  // by the header, which is padded to (at least) 16 bytes in total.
+  std::vector<unsigned char> header(12);
+  file.read(reinterpret_cast<char *>(header.data()), header.size());
+  if (!file.good()) {
+    ThrowNpyIOError(filename, "Could not read the header of NPY file");
+  }
+  header.resize(helpers::NpyHeaderSize(header.data(), header.size(), filename));
+  file.read(reinterpret_cast<char *>(header.data() + 12), header.size() - 12);
+  if (!file.good()) {
+    ThrowNpyIOError(filename, "Could not read the header of NPY file");
+  }
+
+  const helpers::NpyHeader npy = helpers::ParseNpyHeader(
+        header.data(), header.size(), filename);
+  const int64_t element_size = ElementSizeFromImageBufferType(npy.buffer_type);
+
+  if (npy.fortran_order) {
+    // Column-major arrays are read in a single sweep and
+    // then copied into the default row-major layout.
+    std::vector<unsigned char> array_data(
+          static_cast<std::size_t>(npy.NumBytes()));
+    file.read(
+          reinterpret_cast<char *>(array_data.data()), npy.NumBytes());
+    if (!file.good()) {
+      ThrowNpyIOError(filename, "Truncated array data in NPY file");
+    }
+
+    int64_t row_stride, pixel_stride, channel_stride;
+    npy.Strides(&row_stride, &pixel_stride, &channel_stride);
+    ImageBuffer column_major;
+    column_major.CreateSharedBuffer(
+          array_data.data(), npy.height, npy.width, npy.channels,
+          row_stride, pixel_stride, channel_stride, npy.buffer_type);
+    return column_major.DeepCopy();
+  }
+
+  ImageBuffer buffer(npy.height, npy.width, npy.channels, npy.buffer_type);
+  const int64_t row_bytes = element_size * npy.channels * npy.width;
+  unsigned char *data = helpers::PixelWriter(buffer).Data();
+  if (buffer.RowStride() == row_bytes) {
+    file.read(reinterpret_cast<char *>(data), buffer.NumBytes());
+  } else {
+    // Read each row into the padded buffer.
+    for (int row = 0; (row < npy.height) && file.good(); ++row) {
+      file.read(
+            reinterpret_cast<char *>(data + row * buffer.RowStride()),
+            row_bytes);
+    }
+  }
+
+  if (!file.good()) {
+    ThrowNpyIOError(filename, "Truncated array data in NPY file");
+  }
+  return buffer;
+}
+
+
+void SaveNpy(const std::string &filename, const ImageBuffer &image) {
+  SPDLOG_DEBUG("SaveNpy \"{:s}\", {:s}.", filename, image);
+  if (!image.IsValid()) {
+    const std::string msg("Cannot save an invalid ImageBuffer via `SaveNpy`!");
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
+
+  // The header validates the buffer type, which must happen before
+  // opening (i.e. truncating) an existing file.
+  const std::string header = helpers::NpyHeaderString(
+        image.BufferType(), image.Height(), image.Width(), image.Channels());
+
+  std::ofstream file(filename, std::ios::out | std::ios::binary);
+  if (!file.is_open()) {
+    ThrowNpyIOError(filename, "Could not open NPY file for writing");
+  }
+  file.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+  // Rows are streamed directly from the buffer. Only if the pixels of a
+  // row are not packed (e.g. channel views), each row is gathered first.
+  const int64_t element_size = image.ElementSize();
+  const int64_t row_bytes = element_size * image.Channels() * image.Width();
+  const unsigned char *data = image.ImmutableData();
+  if (image.IsContiguous()) {
+    file.write(reinterpret_cast<const char *>(data), image.NumBytes());
+  } else if (image.HasContiguousChannels()
+             && (image.PixelStride() == element_size * image.Channels())) {
+    for (int row = 0; row < image.Height(); ++row) {
+      file.write(
+            reinterpret_cast<const char *>(data + row * image.RowStride()),
+            row_bytes);
+    }
+  } else {
+    std::vector<unsigned char> row_buffer(static_cast<std::size_t>(row_bytes));
+    for (int row = 0; row < image.Height(); ++row) {
+      unsigned char *out = row_buffer.data();
+      for (int col = 0; col < image.Width(); ++col) {
+        const unsigned char *pixel = data + row * image.RowStride()
+            + col * image.PixelStride();
+        for (int ch = 0; ch < image.Channels(); ++ch) {
+          std::memcpy(
+                out, pixel + ch * image.ChannelStride(),
+                static_cast<std::size_t>(element_size));
+          out += element_size;
+        }
+      }
+      file.write(
+            reinterpret_cast<const char *>(row_buffer.data()), row_bytes);
+    }
+  }
+
+  file.close();
+  if (file.fail()) {
+    ThrowNpyIOError(filename, "Could not write NPY file");
+  }
+}
+
+}  // namespace viren2d
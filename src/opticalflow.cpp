@@ -15,6 +15,8 @@
 // private viren2d headers
 #include <helpers/logging.h>
 #include <helpers/colormaps_helpers.h>
+#include <helpers/imagebuffer_access.h>
+#include <helpers/parallel.h>
 
 #ifndef M_PI
 #  define M_PI 3.14159265358979323846
@@ -128,12 +130,12 @@ ImageBuffer LoadOpticalFlow(const std::string &filename) {
     throw std::logic_error(msg);
   }
 
-  ImageBuffer flow(height.ival, width.ival, 2, ImageBufferType::Float);
-  // Freshly allocated image buffer is always contiguous, so
+  // Allocate a contiguous buffer (i.e. without row padding), so
   // we can read the whole file in a single sweep:
+  ImageBuffer flow(height.ival, width.ival, 2, ImageBufferType::Float, 1);
   file.read(
-        reinterpret_cast<char *>(flow.MutableData()),
-        width.ival * height.ival * 2 * sizeof(float));
+        reinterpret_cast<char *>(helpers::PixelWriter(flow).Data()),
+        flow.NumBytes());
 
   file.close();
   return flow;
@@ -165,7 +167,8 @@ void SaveOpticalFlow(const std::string &filename, const ImageBuffer &flow) {
           float_flow.NumBytes());
   } else {
     // Is a single row contiguous?
-    if (float_flow.PixelStride() == (float_flow.Channels() * float_flow.ElementSize())) {
+    if ((float_flow.PixelStride() == (float_flow.Channels() * float_flow.ElementSize()))
+        && float_flow.HasContiguousChannels()) {
       for (int row = 0; row < float_flow.Height(); ++row) {
         file.write(
               reinterpret_cast<const char *>(float_flow.ImmutablePtr<float>(row, 0, 0)),
@@ -190,32 +193,38 @@ void SaveOpticalFlow(const std::string &filename, const ImageBuffer &flow) {
 }
 
 
-template <typename _Tp>
+/// Colorizes a flow field of type `_Tp`, where the colors are computed
+/// in `_Tc` precision (half precision flow is computed as `float`).
+template <typename _Tp, typename _Tc = _Tp>
 ImageBuffer ColorizeFlowHelper(
-    const ImageBuffer &flow, ColorMap colormap, _Tp max_motion, int output_channels) {
+    const ImageBuffer &flow, ColorMap colormap, _Tc max_motion, int output_channels) {
   const std::pair<const helpers::RGBColor *, std::size_t> map = helpers::GetColorMap(colormap);
 
   ImageBuffer dst(flow.Height(), flow.Width(), output_channels, ImageBufferType::UInt8);
   int rows = flow.Height();
-  int values_per_row = flow.Width() * flow.Channels();
-  if (flow.IsContiguous()) {
-    values_per_row *= rows;
+  int cols = flow.Width();
+  if (flow.IsFlattenable() && dst.IsFlattenable()) {
+    cols *= rows;
     rows = 1;
   }
 
-  for (int row = 0; row < rows; ++row) {
-    const _Tp *flow_ptr = flow.ImmutablePtr<_Tp>(row, 0, 0);
-    unsigned char *dst_ptr = dst.MutablePtr<unsigned char>(row, 0, 0);
+  const helpers::PixelWriter out(dst);
+  helpers::ParallelForPixels(
+        rows, cols, 32,
+        [&](int row, int col_begin, int col_end) {
+    // The flow may be a view, thus it must be accessed via its strides.
+    unsigned char *dst_ptr = out.Ptr<unsigned char>(row, col_begin, 0);
     int dst_col = 0;
 
-    for (int src_element = 0; src_element < values_per_row; src_element += 2) {
-      helpers::ColorizePixelFromFlow(
-            flow_ptr[src_element], flow_ptr[src_element + 1], max_motion,
+    for (int col = col_begin; col < col_end; ++col) {
+      helpers::ColorizePixelFromFlow<_Tc>(
+            static_cast<_Tc>(flow.AtUnchecked<_Tp>(row, col, 0)),
+            static_cast<_Tc>(flow.AtUnchecked<_Tp>(row, col, 1)), max_motion,
             &dst_ptr[dst_col], output_channels, map);
 
       dst_col += output_channels;
     }
-  }
+  });
   return dst;
 }
 
@@ -242,10 +251,20 @@ ImageBuffer ColorizeOpticalFlow(
       return ColorizeFlowHelper<double>(
             flow, colormap, motion_normalizer, output_channels);
 
+    case ImageBufferType::Float16:
+      return ColorizeFlowHelper<float16_t, float>(
+            flow, colormap, static_cast<float>(motion_normalizer),
+            output_channels);
+
+    case ImageBufferType::BFloat16:
+      return ColorizeFlowHelper<bfloat16_t, float>(
+            flow, colormap, static_cast<float>(motion_normalizer),
+            output_channels);
+
     default: {
         std::string msg(
               "Invalid input to `ColorizeOpticalFlow`: Flow values must be of "
-              "type `float` or `double`, but got ");
+              "floating point type, but got ");
         msg += flow.ToString();
         msg += '!';
         SPDLOG_ERROR(msg);
@@ -281,10 +300,11 @@ ImageBuffer OpticalFlowLegend(
   const float interval = 2.0f / (size - 1);
 
   ImageBuffer dst(size, size, output_channels, ImageBufferType::UInt8);
+  const helpers::PixelWriter out(dst);
   float v = -1.0f;
   for (int row = 0; row < size; ++row) {
     float u = -1.0f;
-    unsigned char *dst_ptr = dst.MutablePtr<unsigned char>(row, 0, 0);
+    unsigned char *dst_ptr = out.Row<unsigned char>(row);
 
     for (int col = 0; col < size; ++col) {
       helpers::ColorizePixelFromFlow(
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <viren2d/allocators.h>
+#include <viren2d/parallel.h>
+
+#include <helpers/allocators_helpers.h>
+#include <helpers/parallel.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace helpers {
+/// Returns the number of hardware threads (at least 1).
+int HardwareConcurrency() {
+  const unsigned int num = std::thread::hardware_concurrency();
+  return (num > 0) ? static_cast<int>(num) : 1;
+}
+
+
+std::atomic<int> &GlobalNumThreads() {
+  static std::atomic<int> num_threads(HardwareConcurrency());
+  return num_threads;
+}
+
+
+/// Thread-local override, 0 if not set.
+int &ThreadLocalNumThreads() {
+  thread_local int num_threads = 0;
+  return num_threads;
+}
+
+
+/// Number of chunks per thread. Finer chunks balance the load, if the
+/// cost of the items varies or some threads are busy with other work.
+constexpr int64_t kChunksPerThread = 4;
+
+
+/// Set while the current thread processes a chunk of a `ParallelFor`,
+/// to run nested calls serially (instead of waiting for workers which
+/// might be busy with the outer loop).
+bool &IsInsideParallelRegion() {
+  thread_local bool inside = false;
+  return inside;
+}
+
+
+/// Simple pool of worker threads which process a shared task queue.
+/// Workers are spawned on demand and live until program exit.
+class ThreadPool {
+public:
+  static ThreadPool &Instance() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shutdown_ = true;
+    }
+    condition_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+
+  /// Ensures that at least `num_workers` threads are available.
+  void Reserve(int num_workers) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (static_cast<int>(workers_.size()) < num_workers) {
+      workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+  }
+
+
+  void Submit(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(std::move(task));
+    }
+    condition_.notify_one();
+  }
+
+
+private:
+  ThreadPool() = default;
+
+
+  void WorkerLoop() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this] { return shutdown_ || !tasks_.empty(); });
+        if (shutdown_ && tasks_.empty()) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+
+  std::vector<std::thread> workers_;
+  std::deque<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool shutdown_ = false;
+};
+
+
+/// Shared state of a single `ParallelFor` invocation. Workers may
+/// still hold a reference after the call has returned, but they
+/// will only access `body` after claiming a chunk.
+struct ParallelForState {
+  const std::function<void(int64_t, int64_t)> *body;
+  int64_t begin;
+  int64_t chunk_size;
+  int64_t end;
+  int64_t num_chunks;
+
+  /// Thread-local allocator of the calling thread (empty if not set),
+  /// see `ScopedImageBufferAllocator`.
+  std::shared_ptr<ImageBufferAllocator> allocator;
+
+  /// Thread-local number of threads of the calling thread (0 if not
+  /// set), see `ScopedNumThreads`.
+  int num_threads;
+
+  std::atomic<int64_t> next_chunk{0};
+  std::atomic<int64_t> finished_chunks{0};
+  std::exception_ptr exception;
+  std::mutex mutex;
+  std::condition_variable done;
+
+
+  /// Processes chunks until none are left. The thread-local settings
+  /// (allocator and number of threads) of the calling thread apply.
+  void Run() {
+    const bool was_inside = IsInsideParallelRegion();
+    IsInsideParallelRegion() = true;
+    std::shared_ptr<ImageBufferAllocator> previous_allocator =
+        std::exchange(ThreadLocalAllocator(), allocator);
+    const int previous_num_threads =
+        std::exchange(ThreadLocalNumThreads(), num_threads);
+    int64_t chunk;
+    while ((chunk = next_chunk.fetch_add(1)) < num_chunks) {
+      const int64_t chunk_begin = begin + chunk * chunk_size;
+      const int64_t chunk_end = std::min(end, chunk_begin + chunk_size);
+      try {
+        (*body)(chunk_begin, chunk_end);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!exception) {
+          exception = std::current_exception();
+        }
+      }
+
+      if (finished_chunks.fetch_add(1) + 1 == num_chunks) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.notify_all();
+      }
+    }
+    ThreadLocalNumThreads() = previous_num_threads;
+    ThreadLocalAllocator() = std::move(previous_allocator);
+    IsInsideParallelRegion() = was_inside;
+  }
+};
+
+
+void ParallelFor(
+    int64_t begin, int64_t end, int64_t cost_per_item,
+    const std::function<void(int64_t, int64_t)> &body) {
+  if (end <= begin) {
+    return;
+  }
+
+  const int64_t num_items = end - begin;
+  const int64_t total_cost = num_items * std::max(cost_per_item, int64_t(1));
+  const int64_t max_chunks = std::min(
+        num_items, total_cost / kParallelGrainSize);
+  const int num_threads = GetNumThreads();
+  if ((num_threads <= 1) || (max_chunks <= 1) || IsInsideParallelRegion()) {
+    body(begin, end);
+    return;
+  }
+
+  // The threads claim several smaller chunks each (via an atomic
+  // counter), so faster threads take over the remaining work.
+  const int64_t num_chunks = std::min(
+        max_chunks, kChunksPerThread * num_threads);
+  auto state = std::make_shared<ParallelForState>();
+  state->body = &body;
+  state->allocator = ThreadLocalAllocator();
+  state->num_threads = ThreadLocalNumThreads();
+  state->begin = begin;
+  state->end = end;
+  state->chunk_size = (num_items + num_chunks - 1) / num_chunks;
+  state->num_chunks = (num_items + state->chunk_size - 1) / state->chunk_size;
+
+  // The calling thread participates, so we need one worker less.
+  const int64_t num_workers = std::min(
+        state->num_chunks - 1, static_cast<int64_t>(num_threads - 1));
+  ThreadPool &pool = ThreadPool::Instance();
+  pool.Reserve(static_cast<int>(num_workers));
+  for (int64_t i = 0; i < num_workers; ++i) {
+    pool.Submit([state]() { state->Run(); });
+  }
+
+  state->Run();
+  {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state]() {
+      return state->finished_chunks.load() == state->num_chunks;
+    });
+  }
+
+  if (state->exception) {
+    std::rethrow_exception(state->exception);
+  }
+}
+}  // namespace helpers
+
+
+void SetNumThreads(int num_threads) {
+  if (num_threads <= 0) {
+    num_threads = helpers::HardwareConcurrency();
+  }
+  SPDLOG_DEBUG("Setting number of threads to {:d}.", num_threads);
+  helpers::GlobalNumThreads().store(num_threads);
+}
+
+
+int GetNumThreads() {
+  const int local = helpers::ThreadLocalNumThreads();
+  if (local > 0) {
+    return local;
+  }
+  return helpers::GlobalNumThreads().load();
+}
+
+
+ScopedNumThreads::ScopedNumThreads(int num_threads)
+  : previous_(helpers::ThreadLocalNumThreads()) {
+  helpers::ThreadLocalNumThreads() = (num_threads > 0)
+      ? num_threads : helpers::HardwareConcurrency();
+}
+
+
+ScopedNumThreads::~ScopedNumThreads() {
+  helpers::ThreadLocalNumThreads() = previous_;
+}
+
+}  // namespace viren2d
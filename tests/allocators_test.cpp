@@ -0,0 +1,154 @@
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <viren2d/allocators.h>
+#include <viren2d/imagebuffer.h>
+#include <viren2d/parallel.h>
+#include <helpers/parallel.h>
+
+
+TEST(AllocatorTest, BucketSizes) {
+  using viren2d::PoolAllocator;
+  EXPECT_EQ(PoolAllocator::BucketSize(0), 64u);
+  EXPECT_EQ(PoolAllocator::BucketSize(1), 64u);
+  EXPECT_EQ(PoolAllocator::BucketSize(64), 64u);
+  EXPECT_EQ(PoolAllocator::BucketSize(65), 128u);
+  EXPECT_EQ(PoolAllocator::BucketSize(256), 256u);
+  // 4 size classes per power of two:
+  EXPECT_EQ(PoolAllocator::BucketSize(257), 320u);
+  EXPECT_EQ(PoolAllocator::BucketSize(1024), 1024u);
+  EXPECT_EQ(PoolAllocator::BucketSize(1025), 1280u);
+  EXPECT_EQ(PoolAllocator::BucketSize(1500), 1536u);
+  EXPECT_EQ(PoolAllocator::BucketSize(2000), 2048u);
+
+  for (std::size_t sz = 1; sz < 100000; sz += 77) {
+    const std::size_t bucket = PoolAllocator::BucketSize(sz);
+    EXPECT_GE(bucket, sz);
+    EXPECT_LE(bucket, sz + sz / 4 + 64);
+    EXPECT_EQ(bucket % viren2d::kImageBufferAlignment, 0u);
+  }
+}
+
+
+TEST(AllocatorTest, Pool) {
+  auto pool = std::make_shared<viren2d::PoolAllocator>();
+  EXPECT_EQ(viren2d::GetImageBufferAllocator(),
+            viren2d::DefaultImageBufferAllocator());
+
+  {
+    viren2d::ScopedImageBufferAllocator scope(pool);
+    EXPECT_EQ(viren2d::GetImageBufferAllocator(), pool);
+
+    // Simulate the steady state of a frame processing loop:
+    for (int frame = 0; frame < 5; ++frame) {
+      viren2d::ImageBuffer buf(48, 64, 3, viren2d::ImageBufferType::Float);
+      buf.SetToScalar(0.5f);
+      viren2d::ImageBuffer u8 = buf.ToUInt8(4);
+      EXPECT_EQ(u8.AtChecked<unsigned char>(47, 63, 0), 127);
+      EXPECT_EQ(
+            reinterpret_cast<std::uintptr_t>(u8.ImmutableData())
+              % viren2d::kImageBufferAlignment, 0u);
+    }
+  }
+  // The scope restores the previous allocator
+  EXPECT_EQ(viren2d::GetImageBufferAllocator(),
+            viren2d::DefaultImageBufferAllocator());
+
+  viren2d::PoolAllocatorStatistics stats = pool->Statistics();
+  EXPECT_EQ(stats.misses, 2u);
+  EXPECT_EQ(stats.hits, 8u);
+  EXPECT_EQ(stats.cached_blocks, 2u);
+
+  // Buffers created outside the scope don't use the pool
+  viren2d::ImageBuffer other(48, 64, 3, viren2d::ImageBufferType::Float);
+  EXPECT_EQ(pool->Statistics().misses, 2u);
+
+  // Memory will be returned to the pool, even if the buffer is
+  // released after the scope has been left
+  viren2d::ImageBuffer outlive;
+  {
+    viren2d::ScopedImageBufferAllocator scope(pool);
+    outlive = viren2d::ImageBuffer(10, 10, 1, viren2d::ImageBufferType::UInt8);
+  }
+  stats = pool->Statistics();
+  EXPECT_EQ(stats.cached_blocks, 2u);
+  outlive = viren2d::ImageBuffer();
+  EXPECT_EQ(pool->Statistics().cached_blocks, 3u);
+
+  pool->Clear();
+  pool->ResetStatistics();
+  stats = pool->Statistics();
+  EXPECT_EQ(stats.hits, 0u);
+  EXPECT_EQ(stats.misses, 0u);
+  EXPECT_EQ(stats.cached_blocks, 0u);
+  EXPECT_EQ(stats.cached_bytes, 0u);
+}
+
+
+TEST(AllocatorTest, GlobalAndLimits) {
+  // A pool which can't cache anything
+  auto pool = std::make_shared<viren2d::PoolAllocator>(0);
+  viren2d::SetImageBufferAllocator(pool);
+  EXPECT_EQ(viren2d::GetImageBufferAllocator(), pool);
+
+  // The global allocator is used by all threads
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([]() {
+      for (int j = 0; j < 10; ++j) {
+        viren2d::ImageBuffer buf(16, 16, 2, viren2d::ImageBufferType::Int32);
+        buf.SetToScalar<int32_t>(j);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  viren2d::PoolAllocatorStatistics stats = pool->Statistics();
+  EXPECT_EQ(stats.misses, 40u);
+  EXPECT_EQ(stats.hits, 0u);
+  EXPECT_EQ(stats.cached_bytes, 0u);
+
+  viren2d::SetImageBufferAllocator(nullptr);
+  EXPECT_EQ(viren2d::GetImageBufferAllocator(),
+            viren2d::DefaultImageBufferAllocator());
+}
+
+
+TEST(AllocatorTest, ScopeAppliesToWorkers) {
+  viren2d::ScopedNumThreads threads(4);
+  auto pool = std::make_shared<viren2d::PoolAllocator>();
+  std::atomic<int> num_chunks{0};
+  std::atomic<int> num_pooled{0};
+  const auto count_pooled = [&](int64_t, int64_t) {
+    ++num_chunks;
+    if (viren2d::GetImageBufferAllocator() == pool) {
+      ++num_pooled;
+    }
+    // Give the workers a chance to claim a chunk, too.
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  };
+
+  // Buffers allocated by the workers use the allocator of the caller
+  {
+    viren2d::ScopedImageBufferAllocator scope(pool);
+    viren2d::helpers::ParallelFor(
+          0, 8, viren2d::helpers::kParallelGrainSize, count_pooled);
+  }
+  EXPECT_GT(num_chunks.load(), 1);
+  EXPECT_EQ(num_pooled.load(), num_chunks.load());
+
+  // Afterwards, the workers use their previous allocator again
+  num_chunks = 0;
+  num_pooled = 0;
+  viren2d::helpers::ParallelFor(
+        0, 8, viren2d::helpers::kParallelGrainSize, count_pooled);
+  EXPECT_GT(num_chunks.load(), 1);
+  EXPECT_EQ(num_pooled.load(), 0);
+}
@@ -40,3 +40,72 @@ TEST(ColorMapTest, StringRepresentation) {
   }
   EXPECT_EQ(cnt, cmaps.size());
 }
+
+
+TEST(ColorMapTest, ColorizeViews) {
+  // A 2-channel buffer, where each channel holds different values
+  viren2d::ImageBuffer data(4, 6, 2, viren2d::ImageBufferType::Float);
+  for (int r = 0; r < data.Height(); ++r) {
+    for (int c = 0; c < data.Width(); ++c) {
+      data.AtChecked<float>(r, c, 0) = static_cast<float>(c);
+      data.AtChecked<float>(r, c, 1) = static_cast<float>(r);
+    }
+  }
+
+  // Colorizing a channel view must not require a copy:
+  const viren2d::ImageBuffer &cdata = data;
+  for (int channel = 0; channel < 2; ++channel) {
+    const viren2d::ImageBuffer view = cdata.ChannelView(channel);
+    const viren2d::ImageBuffer copy = data.Channel(channel);
+    const viren2d::ImageBuffer colorized = viren2d::ColorizeScaled(
+          view, viren2d::ColorMap::Turbo, 0.0, 5.0, 4);
+    const viren2d::ImageBuffer expected = viren2d::ColorizeScaled(
+          copy, viren2d::ColorMap::Turbo, 0.0, 5.0, 4);
+    for (int r = 0; r < data.Height(); ++r) {
+      for (int c = 0; c < data.Width(); ++c) {
+        for (int ch = 0; ch < 4; ++ch) {
+          EXPECT_EQ(colorized.AtChecked<unsigned char>(r, c, ch),
+                    expected.AtChecked<unsigned char>(r, c, ch));
+        }
+      }
+    }
+  }
+}
+
+
+TEST(ColorMapTest, ReliefShadingContiguous) {
+  // The shaded output is a deep copy with padded rows, thus contiguous
+  // (e.g. copied or memory-mapped) reliefs must not be processed as a
+  // single flattened row.
+  viren2d::ImageBuffer colorized(7, 5, 3, viren2d::ImageBufferType::UInt8);
+  viren2d::ImageBuffer relief_padded(7, 5, 1, viren2d::ImageBufferType::Float);
+  viren2d::ImageBuffer relief_packed(
+        7, 5, 1, viren2d::ImageBufferType::Float, 1);
+  EXPECT_TRUE(relief_packed.IsContiguous());
+  for (int r = 0; r < colorized.Height(); ++r) {
+    for (int c = 0; c < colorized.Width(); ++c) {
+      const float shade = static_cast<float>(r * 5 + c) / 35.0f;
+      relief_padded.AtChecked<float>(r, c) = shade;
+      relief_packed.AtChecked<float>(r, c) = shade;
+      for (int ch = 0; ch < 3; ++ch) {
+        colorized.AtChecked<unsigned char>(r, c, ch) =
+            static_cast<unsigned char>(200 - 10 * ch);
+      }
+    }
+  }
+
+  const viren2d::ImageBuffer expected =
+      viren2d::ReliefShading(relief_padded, colorized);
+  const viren2d::ImageBuffer shaded =
+      viren2d::ReliefShading(relief_packed, colorized);
+  for (int r = 0; r < colorized.Height(); ++r) {
+    for (int c = 0; c < colorized.Width(); ++c) {
+      for (int ch = 0; ch < 3; ++ch) {
+        EXPECT_EQ(shaded.AtChecked<unsigned char>(r, c, ch),
+                  expected.AtChecked<unsigned char>(r, c, ch));
+      }
+    }
+  }
+  EXPECT_EQ(shaded.AtChecked<unsigned char>(6, 4, 1),
+            static_cast<unsigned char>((34.0f / 35.0f) * 190));
+}
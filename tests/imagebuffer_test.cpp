@@ -1,9 +1,23 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <exception>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include <werkzeugkiste/geometry/utils.h>
 
 #include <viren2d/imagebuffer.h>
+#include <viren2d/parallel.h>
+#include <helpers/imagebuffer_blur.h>
+#include <helpers/imagebuffer_copy.h>
+#include <helpers/imagebuffer_rgba.h>
 
 namespace wgu = werkzeugkiste::geometry;
 
@@ -74,6 +88,14 @@ template <typename _Tp>
     case viren2d::ImageBufferType::Double:
       return CheckChannelConstantHelper<double>(
             buf, channel, value);
+
+    case viren2d::ImageBufferType::Float16:
+      return CheckChannelConstantHelper<viren2d::float16_t>(
+            buf, channel, viren2d::float16_t(static_cast<float>(value)));
+
+    case viren2d::ImageBufferType::BFloat16:
+      return CheckChannelConstantHelper<viren2d::bfloat16_t>(
+            buf, channel, viren2d::bfloat16_t(static_cast<float>(value)));
   }
 
   return ::testing::AssertionFailure() << "ImageBufferType "
@@ -161,6 +183,12 @@ template<typename _Tp>
 
     case viren2d::ImageBufferType::Double:
       return CheckChannelEqualsHelper<double>(buf1, ch1, buf2, ch2);
+
+    case viren2d::ImageBufferType::Float16:
+      return CheckChannelEqualsHelper<viren2d::float16_t>(buf1, ch1, buf2, ch2);
+
+    case viren2d::ImageBufferType::BFloat16:
+      return CheckChannelEqualsHelper<viren2d::bfloat16_t>(buf1, ch1, buf2, ch2);
   }
 
   return ::testing::AssertionFailure() << "ImageBufferType "
@@ -696,3 +724,2569 @@ TEST(ImageBufferTest, ROIInt16) {
   EXPECT_TRUE(CheckChannelConstant(roi, 1, 42));
   EXPECT_TRUE(CheckChannelConstant(roi, 2, 0));
 }
+
+
+TEST(ImageBufferTest, CopyOnWrite) {
+  viren2d::ImageBuffer buf(4, 5, 3, viren2d::ImageBufferType::UInt8);
+  buf.SetToScalar<unsigned char>(17);
+  EXPECT_FALSE(buf.IsStorageShared());
+
+  // A copy shares the storage until one of them is modified:
+  viren2d::ImageBuffer copy(buf);
+  EXPECT_TRUE(copy.OwnsData());
+  EXPECT_TRUE(buf.IsStorageShared());
+  EXPECT_TRUE(copy.IsStorageShared());
+  EXPECT_EQ(buf.ImmutableData(), copy.ImmutableData());
+
+  // Read-only access must not detach:
+  EXPECT_EQ(
+        static_cast<const viren2d::ImageBuffer &>(copy)
+          .AtUnchecked<unsigned char>(1, 2, 0),
+        17);
+  EXPECT_TRUE(copy.IsStorageShared());
+
+  // Writing detaches the modified buffer:
+  copy.AtUnchecked<unsigned char>(1, 2, 0) = 42;
+  EXPECT_FALSE(buf.IsStorageShared());
+  EXPECT_FALSE(copy.IsStorageShared());
+  EXPECT_NE(buf.ImmutableData(), copy.ImmutableData());
+  EXPECT_EQ(buf.AtChecked<unsigned char>(1, 2, 0), 17);
+  EXPECT_EQ(copy.AtChecked<unsigned char>(1, 2, 0), 42);
+  for (int ch = 0; ch < buf.Channels(); ++ch) {
+    EXPECT_TRUE(CheckChannelConstant(buf, ch, static_cast<unsigned char>(17)));
+  }
+
+  // Copy assignment shares the storage, too. The original
+  // storage must outlive the buffer it was created from:
+  viren2d::ImageBuffer assigned;
+  {
+    viren2d::ImageBuffer tmp(2, 2, 1, viren2d::ImageBufferType::Float);
+    tmp.SetToScalar<float>(-1.0f);
+    assigned = tmp;
+    EXPECT_TRUE(assigned.IsStorageShared());
+  }
+  EXPECT_FALSE(assigned.IsStorageShared());
+  EXPECT_TRUE(CheckChannelConstant(assigned, 0, -1.0f));
+
+  // A ROI is a view which doesn't bump the reference count, but
+  // the parent detaches before the view is created:
+  viren2d::ImageBuffer shared(buf);
+  viren2d::ImageBuffer roi = buf.ROI(1, 1, 2, 2);
+  EXPECT_FALSE(roi.OwnsData());
+  EXPECT_FALSE(buf.IsStorageShared());
+  roi.SetToScalar<unsigned char>(0);
+  EXPECT_EQ(buf.AtChecked<unsigned char>(1, 1, 0), 0);
+  EXPECT_EQ(shared.AtChecked<unsigned char>(1, 1, 0), 17);
+
+  // Shared (non-owning) buffers are never detached:
+  viren2d::ImageBuffer view;
+  view.CreateSharedBuffer(
+        buf.MutableData(), buf.Height(), buf.Width(), buf.Channels(),
+        buf.RowStride(), buf.PixelStride(), buf.BufferType());
+  viren2d::ImageBuffer view_copy(view);
+  EXPECT_FALSE(view_copy.OwnsData());
+  EXPECT_EQ(view_copy.MutableData(), buf.ImmutableData());
+}
+
+
+TEST(ImageBufferTest, CopyAfterMutableAccess) {
+  // Writes via a ROI must not become visible in subsequent copies:
+  viren2d::ImageBuffer buf(4, 5, 3, viren2d::ImageBufferType::UInt8);
+  buf.SetToScalar<unsigned char>(17);
+  viren2d::ImageBuffer roi = buf.ROI(1, 1, 2, 2);
+  viren2d::ImageBuffer copy = buf;
+  EXPECT_NE(buf.ImmutableData(), copy.ImmutableData());
+  EXPECT_FALSE(buf.IsStorageShared());
+  roi.SetToScalar<unsigned char>(99);
+  EXPECT_EQ(buf.AtChecked<unsigned char>(1, 1, 0), 99);
+  EXPECT_EQ(copy.AtChecked<unsigned char>(1, 1, 0), 17);
+  for (int ch = 0; ch < copy.Channels(); ++ch) {
+    EXPECT_TRUE(CheckChannelConstant(copy, ch, static_cast<unsigned char>(17)));
+  }
+
+  // Neither must writes via a raw pointer:
+  viren2d::ImageBuffer img(3, 3, 1, viren2d::ImageBufferType::Int16);
+  img.SetToScalar<int16_t>(-3);
+  int16_t *ptr = img.MutablePtr<int16_t>(2, 2, 0);
+  viren2d::ImageBuffer assigned;
+  assigned = img;
+  *ptr = 99;
+  EXPECT_EQ(img.AtChecked<int16_t>(2, 2, 0), 99);
+  EXPECT_EQ(assigned.AtChecked<int16_t>(2, 2, 0), -3);
+
+  unsigned char *data = img.MutableData();
+  viren2d::ImageBuffer copied(img);
+  *reinterpret_cast<int16_t *>(data) = 42;
+  EXPECT_EQ(img.AtChecked<int16_t>(0, 0, 0), 42);
+  EXPECT_EQ(copied.AtChecked<int16_t>(0, 0, 0), -3);
+
+  // Views see the writes, and the pointer stays valid, i.e. the
+  // buffer does not detach from the view:
+  const viren2d::ImageBuffer view = img.ROIView(0, 0, 2, 2);
+  EXPECT_TRUE(img.IsStorageShared());
+  img.AtChecked<int16_t>(1, 1, 0) = 7;
+  EXPECT_EQ(img.MutableData(), data);
+  EXPECT_EQ(view.AtChecked<int16_t>(1, 1, 0), 7);
+  EXPECT_FALSE(img.EnsureShape(3, 3, 1, viren2d::ImageBufferType::Int16));
+  EXPECT_EQ(img.MutableData(), data);
+
+  // Results of operations remain copy-on-write:
+  viren2d::ImageBuffer result = buf.ToFloat();
+  viren2d::ImageBuffer result_copy(result);
+  EXPECT_EQ(result.ImmutableData(), result_copy.ImmutableData());
+}
+
+
+TEST(ImageBufferTest, LargeSizes) {
+  // We only need a valid pointer, the data will not be accessed:
+  unsigned char dummy[4] = {0};
+  const int height = 24000;
+  const int width = 24000;
+  const int channels = 4;
+  const int64_t row_stride = static_cast<int64_t>(width) * channels * 8;
+
+  viren2d::ImageBuffer buf;
+  buf.CreateSharedBuffer(
+        dummy, height, width, channels, row_stride, channels * 8,
+        viren2d::ImageBufferType::Double);
+  EXPECT_EQ(buf.RowStride(), row_stride);
+  EXPECT_EQ(buf.NumPixels(), 576000000LL);
+  EXPECT_EQ(buf.NumElements(), 2304000000LL);
+  EXPECT_EQ(buf.NumBytes(), 18432000000LL);
+  EXPECT_TRUE(buf.IsContiguous());
+  // Too many elements to be scanned as a single row:
+  EXPECT_FALSE(buf.IsFlattenable());
+
+  viren2d::ImageBuffer small(10, 20, 3, viren2d::ImageBufferType::UInt8, 1);
+  EXPECT_TRUE(small.IsFlattenable());
+  EXPECT_FALSE(small.ROI(1, 1, 5, 5).IsFlattenable());
+}
+
+
+TEST(ImageBufferTest, RowAlignment) {
+  EXPECT_EQ(viren2d::GetImageBufferRowAlignment(),
+            viren2d::kImageBufferAlignment);
+  EXPECT_THROW(viren2d::SetImageBufferRowAlignment(0), std::invalid_argument);
+  EXPECT_THROW(viren2d::SetImageBufferRowAlignment(48), std::invalid_argument);
+
+  // By default, the rows will be padded:
+  viren2d::ImageBuffer padded(7, 5, 3, viren2d::ImageBufferType::UInt8);
+  EXPECT_EQ(padded.RowStride(), 64);
+  EXPECT_EQ(padded.PixelStride(), 3);
+  EXPECT_FALSE(padded.IsContiguous());
+  EXPECT_EQ(
+        reinterpret_cast<std::uintptr_t>(padded.ImmutableData())
+          % viren2d::kImageBufferAlignment, 0u);
+
+  viren2d::ImageBuffer dbl(3, 9, 1, viren2d::ImageBufferType::Double);
+  EXPECT_EQ(dbl.RowStride(), 128);
+
+  // Explicit row alignment:
+  viren2d::ImageBuffer packed(7, 5, 3, viren2d::ImageBufferType::UInt8, 1);
+  EXPECT_EQ(packed.RowStride(), 15);
+  EXPECT_TRUE(packed.IsContiguous());
+  viren2d::ImageBuffer aligned4(7, 5, 3, viren2d::ImageBufferType::UInt8, 4);
+  EXPECT_EQ(aligned4.RowStride(), 16);
+  EXPECT_THROW(
+        viren2d::ImageBuffer(2, 2, 1, viren2d::ImageBufferType::UInt8, 3),
+        std::invalid_argument);
+
+  // Change the default:
+  viren2d::SetImageBufferRowAlignment(1);
+  viren2d::ImageBuffer contiguous(7, 5, 3, viren2d::ImageBufferType::Int16);
+  EXPECT_TRUE(contiguous.IsContiguous());
+  viren2d::SetImageBufferRowAlignment(viren2d::kImageBufferAlignment);
+
+  // Conversions must yield the same results for padded and packed inputs:
+  for (int row = 0; row < padded.Height(); ++row) {
+    for (int col = 0; col < padded.Width(); ++col) {
+      for (int ch = 0; ch < padded.Channels(); ++ch) {
+        const unsigned char val = static_cast<unsigned char>(
+              (row * 31 + col * 7 + ch) % 256);
+        padded.AtChecked<unsigned char>(row, col, ch) = val;
+        packed.AtChecked<unsigned char>(row, col, ch) = val;
+      }
+    }
+  }
+
+  viren2d::ImageBuffer copy = padded.DeepCopy();
+  EXPECT_TRUE(copy.IsContiguous());
+  viren2d::ImageBuffer rgba_padded = padded.ToChannels(4);
+  viren2d::ImageBuffer rgba_packed = packed.ToChannels(4);
+  viren2d::ImageBuffer gray_padded = viren2d::ConvertRGB2Gray(padded);
+  viren2d::ImageBuffer gray_packed = viren2d::ConvertRGB2Gray(packed);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(copy, ch, packed, ch));
+    EXPECT_TRUE(CheckChannelEquals(rgba_padded, ch, rgba_packed, ch));
+  }
+  EXPECT_TRUE(CheckChannelConstant(rgba_padded, 3, static_cast<unsigned char>(255)));
+  EXPECT_TRUE(CheckChannelEquals(gray_padded, 0, gray_packed, 0));
+
+  // Outputs have padded rows, so contiguous inputs must not be processed
+  // as a single flattened row:
+  const viren2d::ImageBuffer mask_padded = padded.MaskRange<unsigned char>(
+        0, 200, 50, 255, 0, 255);
+  const viren2d::ImageBuffer mask_packed = packed.MaskRange<unsigned char>(
+        0, 200, 50, 255, 0, 255);
+  EXPECT_TRUE(CheckChannelEquals(mask_padded, 0, mask_packed, 0));
+  EXPECT_EQ(mask_packed.AtChecked<unsigned char>(6, 4),
+            (packed.AtChecked<unsigned char>(6, 4, 0) <= 200)
+            && (packed.AtChecked<unsigned char>(6, 4, 1) >= 50) ? 255 : 0);
+
+  const viren2d::ImageBuffer normalized_padded =
+      padded.Normalize<viren2d::ImageBufferType::Int16, unsigned char>(
+        1, 2, 3, 4, 5, 6, 7, 8, 9);
+  const viren2d::ImageBuffer normalized_packed =
+      packed.Normalize<viren2d::ImageBufferType::Int16, unsigned char>(
+        1, 2, 3, 4, 5, 6, 7, 8, 9);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(normalized_padded, ch, normalized_packed, ch));
+  }
+  EXPECT_EQ(normalized_packed.AtChecked<int16_t>(6, 4, 2),
+            (packed.AtChecked<unsigned char>(6, 4, 2) + 7) * 8 + 9);
+
+  const std::pair<float, float> hue_range{20.0f, 300.0f};
+  const std::pair<float, float> sat_range{0.1f, 0.9f};
+  const std::pair<float, float> val_range{0.2f, 1.0f};
+  EXPECT_TRUE(CheckChannelEquals(
+                viren2d::MaskHSVRange(padded, hue_range, sat_range, val_range), 0,
+                viren2d::MaskHSVRange(packed, hue_range, sat_range, val_range), 0));
+}
+
+
+TEST(ImageBufferTest, IntoOverloads) {
+  viren2d::ImageBuffer rgb(6, 5, 3, viren2d::ImageBufferType::UInt8);
+  for (int row = 0; row < rgb.Height(); ++row) {
+    for (int col = 0; col < rgb.Width(); ++col) {
+      for (int ch = 0; ch < rgb.Channels(); ++ch) {
+        rgb.AtChecked<unsigned char>(row, col, ch) =
+            static_cast<unsigned char>(row * 20 + col * 3 + ch);
+      }
+    }
+  }
+
+  // Empty destination will be allocated:
+  viren2d::ImageBuffer dst;
+  EXPECT_THROW(rgb.ToChannels(nullptr, 4), std::invalid_argument);
+  rgb.ToChannels(&dst, 4);
+  ASSERT_TRUE(dst.IsValid());
+  EXPECT_EQ(dst.Channels(), 4);
+  const unsigned char *ptr = dst.ImmutableData();
+
+  // Matching shape & type reuses the memory:
+  EXPECT_FALSE(dst.EnsureShape(6, 5, 4, viren2d::ImageBufferType::UInt8));
+  rgb.ToChannels(&dst, 4);
+  EXPECT_EQ(dst.ImmutableData(), ptr);
+  viren2d::ImageBuffer dimmed;
+  rgb.Dim(&dimmed, 1.0);
+  EXPECT_EQ(dimmed.Channels(), 3);
+  EXPECT_TRUE(dimmed.EnsureShape(6, 5, 4, viren2d::ImageBufferType::UInt8));
+  EXPECT_EQ(dimmed.Channels(), 4);
+  viren2d::ImageBuffer expected = rgb.ToChannels(4);
+  for (int ch = 0; ch < 4; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(dst, ch, expected, ch));
+  }
+
+  viren2d::ImageBuffer gray(6, 5, 1, viren2d::ImageBufferType::UInt8);
+  ptr = gray.ImmutableData();
+  viren2d::ConvertRGB2Gray(rgb, &gray);
+  EXPECT_EQ(gray.ImmutableData(), ptr);
+  EXPECT_TRUE(CheckChannelEquals(gray, 0, viren2d::ConvertRGB2Gray(rgb), 0));
+
+  viren2d::ImageBuffer hsv(6, 5, 3, viren2d::ImageBufferType::UInt8);
+  ptr = hsv.ImmutableData();
+  viren2d::ConvertRGB2HSV(rgb, &hsv);
+  EXPECT_EQ(hsv.ImmutableData(), ptr);
+  expected = viren2d::ConvertRGB2HSV(rgb);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(hsv, ch, expected, ch));
+  }
+
+  viren2d::ImageBuffer flt(6, 5, 3, viren2d::ImageBufferType::Float);
+  ptr = flt.ImmutableData();
+  rgb.ToFloat(&flt);
+  EXPECT_EQ(flt.ImmutableData(), ptr);
+  EXPECT_FLOAT_EQ(flt.AtChecked<float>(5, 4, 2), (100 + 12 + 2) / 255.0f);
+
+  viren2d::ImageBuffer blended(6, 5, 3, viren2d::ImageBufferType::UInt8);
+  ptr = blended.ImmutableData();
+  rgb.Blend(&blended, rgb.Dim(0.0), 0.5);
+  EXPECT_EQ(blended.ImmutableData(), ptr);
+  expected = rgb.Blend(rgb.Dim(0.0), 0.5);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(blended, ch, expected, ch));
+  }
+
+  // Writing into an external (shared) buffer:
+  std::vector<unsigned char> external(6 * 5, 0);
+  viren2d::ImageBuffer view;
+  view.CreateSharedBuffer(
+        external.data(), 6, 5, 1, 5, 1, viren2d::ImageBufferType::UInt8);
+  rgb.Channel(&view, 1);
+  EXPECT_FALSE(view.OwnsData());
+  EXPECT_EQ(external[5 * 5 + 4], rgb.AtChecked<unsigned char>(5, 4, 1));
+
+  // Destination which overlaps with the input:
+  viren2d::ImageBuffer inplace = rgb.DeepCopy();
+  inplace.ToChannels(&inplace, 4);
+  EXPECT_EQ(inplace.Channels(), 4);
+  expected = rgb.ToChannels(4);
+  for (int ch = 0; ch < 4; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(inplace, ch, expected, ch));
+  }
+
+  view.CreateSharedBuffer(
+        external.data(), 6, 5, 1, 5, 1, viren2d::ImageBufferType::UInt8);
+  view.Dim(&view, 0.5);
+  EXPECT_FALSE(view.OwnsData());
+  EXPECT_EQ(external[5 * 5 + 4], rgb.AtChecked<unsigned char>(5, 4, 1) / 2);
+
+  // Shape mismatch of a shared destination results in reallocation,
+  // i.e. the external memory must not be modified:
+  rgb.ToChannels(&view, 3);
+  EXPECT_TRUE(view.OwnsData());
+  EXPECT_EQ(view.Channels(), 3);
+  EXPECT_EQ(external[5 * 5 + 4], rgb.AtChecked<unsigned char>(5, 4, 1) / 2);
+}
+
+
+TEST(ImageBufferTest, InPlace) {
+  viren2d::ImageBuffer rgb(6, 5, 3, viren2d::ImageBufferType::UInt8);
+  for (int row = 0; row < rgb.Height(); ++row) {
+    for (int col = 0; col < rgb.Width(); ++col) {
+      for (int ch = 0; ch < rgb.Channels(); ++ch) {
+        rgb.AtChecked<unsigned char>(row, col, ch) =
+            static_cast<unsigned char>(row * 20 + col * 3 + ch);
+      }
+    }
+  }
+
+  // Dimming modifies the memory in-place:
+  viren2d::ImageBuffer buf = rgb.DeepCopy();
+  const unsigned char *ptr = buf.ImmutableData();
+  buf.DimInPlace(0.5);
+  EXPECT_EQ(buf.ImmutableData(), ptr);
+  viren2d::ImageBuffer expected = rgb.Dim(0.5);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(buf, ch, expected, ch));
+  }
+
+  // Shared (copy-on-write) storage must be detached first:
+  viren2d::ImageBuffer shared = buf;
+  EXPECT_TRUE(shared.IsStorageShared());
+  shared.DimInPlace(0.0);
+  EXPECT_TRUE(CheckChannelConstant(shared, 0, static_cast<unsigned char>(0)));
+  EXPECT_TRUE(CheckChannelEquals(buf, 0, expected, 0));
+
+  // Views onto external memory are modified:
+  viren2d::ImageBuffer roi = buf.ROI(1, 2, 3, 3);
+  roi.DimInPlace(0.0);
+  EXPECT_EQ(buf.AtChecked<unsigned char>(2, 1, 0), 0);
+  EXPECT_EQ(buf.AtChecked<unsigned char>(4, 3, 2), 0);
+  EXPECT_NE(buf.AtChecked<unsigned char>(5, 4, 2), 0);
+
+  // Blending with a constant weight:
+  buf = rgb.DeepCopy();
+  ptr = buf.ImmutableData();
+  viren2d::ImageBuffer other = rgb.Dim(0.2);
+  buf.BlendInPlace(other, 0.3);
+  EXPECT_EQ(buf.ImmutableData(), ptr);
+  expected = rgb.Blend(other, 0.3);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(buf, ch, expected, ch));
+  }
+
+  // Blending with a weight mask:
+  viren2d::ImageBuffer weights(6, 5, 1, viren2d::ImageBufferType::Float);
+  for (int row = 0; row < weights.Height(); ++row) {
+    for (int col = 0; col < weights.Width(); ++col) {
+      weights.AtChecked<float>(row, col, 0) = (row + col) / 9.0f;
+    }
+  }
+  buf = rgb.DeepCopy();
+  buf.BlendInPlace(other, weights);
+  expected = rgb.Blend(other, weights);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(buf, ch, expected, ch));
+  }
+
+  // Float weights are converted within the SIMD kernels, which must yield
+  // the same results as the (scalar) double weights:
+  viren2d::ImageBuffer weights_double = weights.AsType(
+        viren2d::ImageBufferType::Double);
+  viren2d::ImageBuffer weights_rgb = weights.ToChannels(3);
+  weights_rgb.AtChecked<float>(1, 2, 1) = -0.25f;
+  weights_rgb.AtChecked<float>(2, 2, 2) = 1.5f;
+  weights_rgb.AtChecked<float>(3, 1, 0) = 0.5f / 256.0f;
+  const viren2d::ImageBuffer weights_rgb_double = weights_rgb.AsType(
+        viren2d::ImageBufferType::Double);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(
+                  expected, ch, rgb.Blend(other, weights_double), ch));
+    EXPECT_TRUE(CheckChannelEquals(
+                  rgb.Blend(other, weights_rgb), ch,
+                  rgb.Blend(other, weights_rgb_double), ch));
+  }
+
+  // Overlapping inputs yield the same result as the out-of-place version:
+  buf = rgb.DeepCopy();
+  expected = buf.ROI(0, 0, 4, 4).Blend(buf.ROI(1, 1, 4, 4), 0.5);
+  viren2d::ImageBuffer target = buf.ROI(0, 0, 4, 4);
+  target.BlendInPlace(buf.ROI(1, 1, 4, 4), 0.5);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(target, ch, expected, ch));
+  }
+
+  // The number of channels cannot increase:
+  viren2d::ImageBuffer rgba = rgb.ToChannels(4);
+  EXPECT_THROW(buf.BlendInPlace(rgba, 0.5), std::invalid_argument);
+  rgba.BlendInPlace(other, 0.5);
+  EXPECT_TRUE(CheckChannelConstant(rgba, 3, static_cast<unsigned char>(255)));
+
+  EXPECT_THROW(viren2d::ImageBuffer().DimInPlace(0.5), std::logic_error);
+  EXPECT_THROW(buf.BlendInPlace(viren2d::ImageBuffer(), 0.5), std::logic_error);
+}
+
+
+TEST(ImageBufferTest, FusedRGBA) {
+  viren2d::ImageBuffer rgb(7, 5, 3, viren2d::ImageBufferType::UInt8);
+  for (int row = 0; row < rgb.Height(); ++row) {
+    for (int col = 0; col < rgb.Width(); ++col) {
+      for (int ch = 0; ch < rgb.Channels(); ++ch) {
+        rgb.AtChecked<unsigned char>(row, col, ch) =
+            static_cast<unsigned char>(row * 30 + col * 4 + ch);
+      }
+    }
+  }
+
+  // uint8 inputs yield the same result as the channel conversion:
+  for (const auto &buf : {rgb.Channel(1), rgb, rgb.ToChannels(4)}) {
+    viren2d::ImageBuffer rgba = viren2d::helpers::ToRGBA8(buf);
+    viren2d::ImageBuffer expected = buf.ToChannels(4);
+    EXPECT_EQ(rgba.Channels(), 4);
+    EXPECT_EQ(rgba.BufferType(), viren2d::ImageBufferType::UInt8);
+    for (int ch = 0; ch < 4; ++ch) {
+      EXPECT_TRUE(CheckChannelEquals(rgba, ch, expected, ch));
+    }
+  }
+
+  // Floating point values are scaled and saturated:
+  viren2d::ImageBuffer flt(1, 4, 4, viren2d::ImageBufferType::Float);
+  const float values[] = {-0.5f, 0.5f, 2.0f, std::nanf("")};
+  for (int col = 0; col < 4; ++col) {
+    for (int ch = 0; ch < 4; ++ch) {
+      flt.AtChecked<float>(0, col, ch) = values[(col + ch) % 4];
+    }
+  }
+  viren2d::ImageBuffer rgba = viren2d::helpers::ToRGBA8(flt);
+  const unsigned char expected_flt[] = {0, 127, 255, 0};
+  for (int col = 0; col < 4; ++col) {
+    for (int ch = 0; ch < 4; ++ch) {
+      EXPECT_EQ(rgba.AtChecked<unsigned char>(0, col, ch),
+                expected_flt[(col + ch) % 4]);
+    }
+  }
+
+  // Integral values are saturated:
+  viren2d::ImageBuffer i16(2, 3, 1, viren2d::ImageBufferType::Int16);
+  for (int row = 0; row < i16.Height(); ++row) {
+    for (int col = 0; col < i16.Width(); ++col) {
+      i16.AtChecked<int16_t>(row, col, 0) =
+          static_cast<int16_t>(-200 + row * 300 + col * 60);
+    }
+  }
+  rgba = i16.ToUInt8(4);
+  for (int row = 0; row < i16.Height(); ++row) {
+    for (int col = 0; col < i16.Width(); ++col) {
+      const int value = std::min(
+            255, std::max(0, -200 + row * 300 + col * 60));
+      for (int ch = 0; ch < 3; ++ch) {
+        EXPECT_EQ(rgba.AtChecked<unsigned char>(row, col, ch), value);
+      }
+      EXPECT_EQ(rgba.AtChecked<unsigned char>(row, col, 3), 255);
+    }
+  }
+
+  // Packed rows of all types are converted via the SIMD kernels, which
+  // must match the element-wise conversion of (horizontally flipped)
+  // views. Values cover saturation, NaN and the kernels' tail handling.
+  viren2d::ImageBuffer values_int(3, 37, 4, viren2d::ImageBufferType::Double);
+  viren2d::ImageBuffer values_unit(3, 37, 4, viren2d::ImageBufferType::Double);
+  for (int row = 0; row < values_int.Height(); ++row) {
+    for (int col = 0; col < values_int.Width(); ++col) {
+      for (int ch = 0; ch < 4; ++ch) {
+        const double val = ((row * 37 + col) * 7 + ch * 13) % 700 - 200;
+        values_int.AtChecked<double>(row, col, ch) = val;
+        values_unit.AtChecked<double>(row, col, ch) = val / 300.0;
+      }
+    }
+  }
+  values_unit.AtChecked<double>(1, 5, 2) = std::nan("");
+  for (auto type : {viren2d::ImageBufferType::Int16,
+                    viren2d::ImageBufferType::UInt16,
+                    viren2d::ImageBufferType::Int32,
+                    viren2d::ImageBufferType::UInt32,
+                    viren2d::ImageBufferType::Float,
+                    viren2d::ImageBufferType::Double,
+                    viren2d::ImageBufferType::Float16,
+                    viren2d::ImageBufferType::BFloat16}) {
+    const bool is_int = (type == viren2d::ImageBufferType::Int16)
+        || (type == viren2d::ImageBufferType::UInt16)
+        || (type == viren2d::ImageBufferType::Int32)
+        || (type == viren2d::ImageBufferType::UInt32);
+    const viren2d::ImageBuffer typed = (is_int ? values_int : values_unit)
+        .AsType(type);
+    for (const auto &packed : {typed.Channel(0), typed.ToChannels(3), typed}) {
+      SCOPED_TRACE(packed.ToString());
+      const viren2d::ImageBuffer result = viren2d::helpers::ToRGBA8(packed);
+      const viren2d::ImageBuffer flipped = viren2d::helpers::ToRGBA8(
+            packed.FlipView(true, false));
+      for (int row = 0; row < packed.Height(); ++row) {
+        for (int col = 0; col < packed.Width(); ++col) {
+          for (int ch = 0; ch < 4; ++ch) {
+            EXPECT_EQ(
+                  result.AtChecked<unsigned char>(row, col, ch),
+                  flipped.AtChecked<unsigned char>(
+                    row, packed.Width() - 1 - col, ch));
+          }
+        }
+      }
+    }
+  }
+
+  // The fused kernel doesn't support 2-channel inputs, these must
+  // still be converted by the generic `ToUInt8` implementation:
+  viren2d::ImageBuffer two(2, 3, 2, viren2d::ImageBufferType::Float);
+  for (int row = 0; row < two.Height(); ++row) {
+    for (int col = 0; col < two.Width(); ++col) {
+      two.AtChecked<float>(row, col, 0) = 0.2f * col;
+      two.AtChecked<float>(row, col, 1) = 0.5f * row;
+    }
+  }
+  rgba = two.ToUInt8(4);
+  EXPECT_EQ(rgba.Channels(), 4);
+  for (int row = 0; row < two.Height(); ++row) {
+    for (int col = 0; col < two.Width(); ++col) {
+      const unsigned char first = static_cast<unsigned char>(
+            two.AtChecked<float>(row, col, 0) * 255.0f);
+      EXPECT_EQ(rgba.AtChecked<unsigned char>(row, col, 0), first);
+      EXPECT_EQ(rgba.AtChecked<unsigned char>(row, col, 1),
+                static_cast<unsigned char>(
+                  two.AtChecked<float>(row, col, 1) * 255.0f));
+      EXPECT_EQ(rgba.AtChecked<unsigned char>(row, col, 2), first);
+      EXPECT_EQ(rgba.AtChecked<unsigned char>(row, col, 3), 255);
+    }
+  }
+
+  // Non-packed pixels (e.g. a view onto the first 3 channels of an
+  // RGBA buffer) and custom destination strides:
+  viren2d::ImageBuffer src_rgba = rgb.ToChannels(4);
+  viren2d::ImageBuffer view;
+  view.CreateSharedBuffer(
+        src_rgba.MutableData(), src_rgba.Height(), src_rgba.Width(), 3,
+        src_rgba.RowStride(), src_rgba.PixelStride(),
+        viren2d::ImageBufferType::UInt8);
+  const int64_t dst_stride = 4 * view.Width() + 12;
+  std::vector<unsigned char> dst(dst_stride * view.Height(), 42);
+  viren2d::helpers::ConvertToRGBA8(view, dst.data(), dst_stride);
+  for (int row = 0; row < view.Height(); ++row) {
+    const unsigned char *ptr = dst.data() + row * dst_stride;
+    for (int col = 0; col < view.Width(); ++col) {
+      for (int ch = 0; ch < 3; ++ch) {
+        EXPECT_EQ(ptr[4 * col + ch], rgb.AtChecked<unsigned char>(row, col, ch));
+      }
+      EXPECT_EQ(ptr[4 * col + 3], 255);
+    }
+    // Padding must not be touched
+    for (int64_t idx = 4 * view.Width(); idx < dst_stride; ++idx) {
+      EXPECT_EQ(ptr[idx], 42);
+    }
+  }
+
+  // Invalid inputs:
+  EXPECT_THROW(
+        viren2d::helpers::ToRGBA8(viren2d::ImageBuffer()), std::logic_error);
+  EXPECT_THROW(
+        viren2d::helpers::ToRGBA8(
+          viren2d::ImageBuffer(2, 2, 2, viren2d::ImageBufferType::Float)),
+        std::invalid_argument);
+  EXPECT_THROW(
+        viren2d::helpers::ConvertToRGBA8(rgb, dst.data(), 4 * rgb.Width() - 1),
+        std::invalid_argument);
+}
+
+
+TEST(ImageBufferTest, LazyExpression) {
+  viren2d::ImageBuffer rgb(9, 7, 3, viren2d::ImageBufferType::UInt8);
+  viren2d::ImageBuffer overlay(9, 7, 4, viren2d::ImageBufferType::Float);
+  viren2d::ImageBuffer weights(9, 7, 1, viren2d::ImageBufferType::Double);
+  for (int row = 0; row < rgb.Height(); ++row) {
+    for (int col = 0; col < rgb.Width(); ++col) {
+      for (int ch = 0; ch < 4; ++ch) {
+        if (ch < 3) {
+          rgb.AtChecked<unsigned char>(row, col, ch) =
+              static_cast<unsigned char>(row * 25 + col * 3 + ch);
+        }
+        overlay.AtChecked<float>(row, col, ch) = (row + col + ch) / 20.0f;
+      }
+      weights.AtChecked<double>(row, col, 0) = (row * col) / 48.0;
+    }
+  }
+
+  // Without operations, the expression only converts the type:
+  auto expr = rgb.Lazy();
+  EXPECT_EQ(expr.NumOperations(), 0);
+  EXPECT_EQ(expr.Channels(), 3);
+  viren2d::ImageBuffer result = expr.Evaluate(viren2d::ImageBufferType::Float);
+  viren2d::ImageBuffer expected = rgb.AsType(viren2d::ImageBufferType::Float);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(result, ch, expected, ch));
+  }
+
+  // Chained operations are evaluated in a single pass:
+  expr.Normalize({0.0}, {1.0 / 255.0}, {0.0})
+      .Blend(overlay, 0.25)
+      .Blend(overlay, weights)
+      .Scale(255.0)
+      .Clamp(10.0, 200.0);
+  EXPECT_EQ(expr.NumOperations(), 5);
+  EXPECT_EQ(expr.Channels(), 4);
+  result = expr.Evaluate(viren2d::ImageBufferType::UInt8);
+  EXPECT_EQ(result.Channels(), 4);
+  EXPECT_EQ(result.BufferType(), viren2d::ImageBufferType::UInt8);
+  for (int row = 0; row < rgb.Height(); ++row) {
+    for (int col = 0; col < rgb.Width(); ++col) {
+      const double w = weights.AtChecked<double>(row, col, 0);
+      for (int ch = 0; ch < 4; ++ch) {
+        const double o = overlay.AtChecked<float>(row, col, ch);
+        double v = (ch < 3)
+            ? (0.75 * rgb.AtChecked<unsigned char>(row, col, ch) / 255.0
+               + 0.25 * o)
+            : o;
+        v = (1.0 - w) * v + w * o;
+        v = std::min(200.0, std::max(10.0, 255.0 * v));
+        EXPECT_EQ(
+              result.AtChecked<unsigned char>(row, col, ch),
+              static_cast<unsigned char>(v));
+      }
+    }
+  }
+
+  // Results are saturated:
+  result = rgb.Lazy().Scale(1000.0).Evaluate(viren2d::ImageBufferType::Int16);
+  EXPECT_EQ(result.AtChecked<int16_t>(0, 0, 0), 0);
+  EXPECT_TRUE(CheckChannelConstant(
+                result.ROI(1, 2, 6, 7), 0, std::numeric_limits<int16_t>::max()));
+  result = rgb.Lazy().Normalize({-100.0}, {1.0}, {0.0})
+      .Evaluate(viren2d::ImageBufferType::UInt8);
+  EXPECT_EQ(result.AtChecked<unsigned char>(0, 0, 0), 0);
+  EXPECT_EQ(
+        result.AtChecked<unsigned char>(8, 6, 2),
+        rgb.AtChecked<unsigned char>(8, 6, 2) - 100);
+
+  // The output may overlap the inputs:
+  auto dim = rgb.Lazy().Scale(0.5);
+  viren2d::ImageBuffer backup = rgb.DeepCopy();
+  viren2d::ImageBuffer roi = rgb.ROI(0, 0, 7, 9);
+  dim.Evaluate(&roi, viren2d::ImageBufferType::UInt8);
+  EXPECT_FALSE(roi.OwnsData());
+  expected = backup.Dim(0.5);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(roi, ch, expected, ch));
+  }
+
+  // Invalid inputs:
+  EXPECT_THROW(viren2d::ImageBuffer().Lazy(), std::logic_error);
+  EXPECT_THROW(
+        rgb.Lazy().Blend(
+          viren2d::ImageBuffer(3, 3, 3, viren2d::ImageBufferType::UInt8), 0.5),
+        std::logic_error);
+  EXPECT_THROW(rgb.Lazy().Blend(overlay, rgb), std::logic_error);
+  EXPECT_THROW(
+        rgb.Lazy().Normalize({1.0, 2.0}, {1.0}, {0.0}), std::invalid_argument);
+  EXPECT_THROW(rgb.Lazy().Clamp(1.0, 0.0), std::invalid_argument);
+}
+
+
+TEST(ImageBufferTest, Statistics) {
+  // Values of the first channel are row * width + col, the second
+  // channel holds a constant, the third one is the negated first one.
+  viren2d::ImageBuffer buf(200, 150, 3, viren2d::ImageBufferType::Float);
+  for (int row = 0; row < buf.Height(); ++row) {
+    for (int col = 0; col < buf.Width(); ++col) {
+      const float value = static_cast<float>(row * buf.Width() + col);
+      buf.AtChecked<float>(row, col, 0) = value;
+      buf.AtChecked<float>(row, col, 1) = 3.0f;
+      buf.AtChecked<float>(row, col, 2) = -value;
+    }
+  }
+  buf.AtChecked<float>(0, 0, 1) = std::numeric_limits<float>::quiet_NaN();
+  buf.AtChecked<float>(199, 149, 1) = std::numeric_limits<float>::quiet_NaN();
+
+  const double num = 200.0 * 150.0;
+  auto stats = buf.Statistics(10, 0.0, num);
+  ASSERT_EQ(stats.size(), 3UL);
+
+  EXPECT_DOUBLE_EQ(stats[0].min, 0.0);
+  EXPECT_DOUBLE_EQ(stats[0].max, num - 1);
+  EXPECT_EQ(stats[0].min_location, viren2d::Vec2i(0, 0));
+  EXPECT_EQ(stats[0].max_location, viren2d::Vec2i(149, 199));
+  EXPECT_NEAR(stats[0].mean, (num - 1) / 2.0, 1e-6);
+  EXPECT_NEAR(stats[0].variance, (num * num - 1) / 12.0, 1e-3);
+  EXPECT_EQ(stats[0].num_valid, 30000);
+  EXPECT_EQ(stats[0].num_nan, 0);
+  ASSERT_EQ(stats[0].histogram.size(), 10UL);
+  for (const auto count : stats[0].histogram) {
+    EXPECT_EQ(count, 3000);
+  }
+
+  EXPECT_DOUBLE_EQ(stats[1].min, 3.0);
+  EXPECT_DOUBLE_EQ(stats[1].max, 3.0);
+  // Ties report the first occurrence:
+  EXPECT_EQ(stats[1].min_location, viren2d::Vec2i(1, 0));
+  EXPECT_EQ(stats[1].max_location, viren2d::Vec2i(1, 0));
+  EXPECT_DOUBLE_EQ(stats[1].mean, 3.0);
+  EXPECT_DOUBLE_EQ(stats[1].variance, 0.0);
+  EXPECT_EQ(stats[1].num_valid, 29998);
+  EXPECT_EQ(stats[1].num_nan, 2);
+  EXPECT_EQ(stats[1].histogram[0], 29998);
+
+  EXPECT_DOUBLE_EQ(stats[2].min, -(num - 1));
+  EXPECT_EQ(stats[2].min_location, viren2d::Vec2i(149, 199));
+  EXPECT_EQ(stats[2].max_location, viren2d::Vec2i(0, 0));
+  EXPECT_NEAR(stats[2].StdDev(), stats[0].StdDev(), 1e-6);
+  EXPECT_EQ(stats[2].histogram[0], 1);
+
+  // Results are identical for any number of threads and layout:
+  for (int num_threads : {1, 3}) {
+    viren2d::ScopedNumThreads scope(num_threads);
+    for (const auto &other : {buf.Statistics(7, -100.0, 100.0),
+                              buf.DeepCopy().Statistics(7, -100.0, 100.0)}) {
+      const auto expected = buf.Statistics(7, -100.0, 100.0);
+      for (std::size_t ch = 0; ch < expected.size(); ++ch) {
+        EXPECT_EQ(other[ch].mean, expected[ch].mean);
+        EXPECT_EQ(other[ch].variance, expected[ch].variance);
+        EXPECT_EQ(other[ch].histogram, expected[ch].histogram);
+      }
+    }
+  }
+
+  // Integral types and non-contiguous buffers:
+  viren2d::ImageBuffer u8(4, 5, 1, viren2d::ImageBufferType::UInt8);
+  for (int row = 0; row < u8.Height(); ++row) {
+    for (int col = 0; col < u8.Width(); ++col) {
+      u8.AtChecked<unsigned char>(row, col, 0) =
+          static_cast<unsigned char>(row * 60 + col);
+    }
+  }
+  auto roi = u8.ROI(1, 1, 3, 2).Statistics(4);
+  ASSERT_EQ(roi.size(), 1UL);
+  EXPECT_DOUBLE_EQ(roi[0].min, 61.0);
+  EXPECT_DOUBLE_EQ(roi[0].max, 123.0);
+  EXPECT_EQ(roi[0].max_location, viren2d::Vec2i(2, 1));
+  EXPECT_DOUBLE_EQ(roi[0].mean, 92.0);
+  EXPECT_EQ(roi[0].num_nan, 0);
+  EXPECT_EQ(roi[0].histogram, std::vector<int64_t>({3, 3, 0, 0}));
+
+  // Without any valid values:
+  viren2d::ImageBuffer nan(2, 2, 1, viren2d::ImageBufferType::Double);
+  for (int row = 0; row < 2; ++row) {
+    for (int col = 0; col < 2; ++col) {
+      nan.AtChecked<double>(row, col, 0) =
+          std::numeric_limits<double>::quiet_NaN();
+    }
+  }
+  auto nan_stats = nan.Statistics();
+  EXPECT_TRUE(std::isnan(nan_stats[0].mean));
+  EXPECT_TRUE(std::isnan(nan_stats[0].min));
+  EXPECT_EQ(nan_stats[0].min_location, viren2d::Vec2i(-1, -1));
+  EXPECT_EQ(nan_stats[0].num_nan, 4);
+  EXPECT_TRUE(nan_stats[0].histogram.empty());
+
+  EXPECT_THROW(viren2d::ImageBuffer().Statistics(), std::logic_error);
+  EXPECT_THROW(u8.Statistics(-1), std::invalid_argument);
+  EXPECT_THROW(u8.Statistics(10, 5.0, 5.0), std::invalid_argument);
+}
+
+
+TEST(ImageBufferTest, Resize) {
+  EXPECT_EQ(viren2d::InterpolationFromString("Bilinear"),
+            viren2d::Interpolation::Bilinear);
+  EXPECT_EQ(viren2d::InterpolationFromString(" area"),
+            viren2d::Interpolation::Area);
+  EXPECT_EQ(viren2d::InterpolationFromString(
+              viren2d::InterpolationToString(viren2d::Interpolation::Nearest)),
+            viren2d::Interpolation::Nearest);
+  EXPECT_THROW(viren2d::InterpolationFromString("cubic"), std::invalid_argument);
+
+  // A single row with 2 columns (and 2 channels):
+  viren2d::ImageBuffer row(1, 2, 2, viren2d::ImageBufferType::UInt8);
+  row.AtChecked<unsigned char>(0, 0, 0) = 0;
+  row.AtChecked<unsigned char>(0, 1, 0) = 100;
+  row.AtChecked<unsigned char>(0, 0, 1) = 200;
+  row.AtChecked<unsigned char>(0, 1, 1) = 0;
+
+  viren2d::ImageBuffer up = row.Resize(4, 3, viren2d::Interpolation::Nearest);
+  EXPECT_EQ(up.Width(), 4);
+  EXPECT_EQ(up.Height(), 3);
+  EXPECT_EQ(up.Channels(), 2);
+  const unsigned char expected_nn[] = {0, 0, 100, 100};
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 4; ++c) {
+      EXPECT_EQ(up.AtChecked<unsigned char>(r, c, 0), expected_nn[c]);
+    }
+  }
+
+  up = row.Resize(4, 1, viren2d::Interpolation::Bilinear);
+  const unsigned char expected_bl[] = {0, 25, 75, 100};
+  const unsigned char expected_bl1[] = {200, 150, 50, 0};
+  for (int c = 0; c < 4; ++c) {
+    EXPECT_EQ(up.AtChecked<unsigned char>(0, c, 0), expected_bl[c]);
+    EXPECT_EQ(up.AtChecked<unsigned char>(0, c, 1), expected_bl1[c]);
+  }
+
+  // Area interpolation averages the covered pixels (and rounds):
+  viren2d::ImageBuffer down = up.Resize(2, 1, viren2d::Interpolation::Area);
+  EXPECT_EQ(down.AtChecked<unsigned char>(0, 0, 0), 13);
+  EXPECT_EQ(down.AtChecked<unsigned char>(0, 1, 0), 88);
+  EXPECT_EQ(down.AtChecked<unsigned char>(0, 0, 1), 175);
+  EXPECT_EQ(down.AtChecked<unsigned char>(0, 1, 1), 25);
+
+  // Non-integral scaling factor: output pixel 0 covers 1.5 input pixels
+  viren2d::ImageBuffer flt(3, 3, 1, viren2d::ImageBufferType::Double);
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 3; ++c) {
+      flt.AtChecked<double>(r, c, 0) = c * 3.0;
+    }
+  }
+  viren2d::ImageBuffer area = flt.Resize(2, 3, viren2d::Interpolation::Area);
+  EXPECT_DOUBLE_EQ(area.AtChecked<double>(1, 0, 0), (0.0 + 0.5 * 3.0) / 1.5);
+  EXPECT_DOUBLE_EQ(area.AtChecked<double>(1, 1, 0), (0.5 * 3.0 + 6.0) / 1.5);
+
+  // Resizing to the same size yields an identical copy:
+  for (auto mode : {viren2d::Interpolation::Nearest,
+                    viren2d::Interpolation::Bilinear,
+                    viren2d::Interpolation::Area}) {
+    viren2d::ImageBuffer same = flt.Resize(3, 3, mode);
+    EXPECT_TRUE(CheckChannelEquals(same, 0, flt, 0));
+  }
+
+  // Constant images remain constant, also for large factors and
+  // non-contiguous inputs of other types:
+  viren2d::ImageBuffer i16(300, 500, 3, viren2d::ImageBufferType::Int16);
+  for (int r = 0; r < i16.Height(); ++r) {
+    for (int c = 0; c < i16.Width(); ++c) {
+      for (int ch = 0; ch < 3; ++ch) {
+        i16.AtChecked<int16_t>(r, c, ch) = static_cast<int16_t>(-1000 * ch);
+      }
+    }
+  }
+  viren2d::ImageBuffer roi = i16.ROI(13, 7, 421, 263);
+  for (auto mode : {viren2d::Interpolation::Nearest,
+                    viren2d::Interpolation::Bilinear,
+                    viren2d::Interpolation::Area}) {
+    for (const auto &size : {std::make_pair(17, 9), std::make_pair(800, 601)}) {
+      viren2d::ImageBuffer resized = roi.Resize(size.first, size.second, mode);
+      EXPECT_EQ(resized.BufferType(), viren2d::ImageBufferType::Int16);
+      for (int ch = 0; ch < 3; ++ch) {
+        EXPECT_TRUE(CheckChannelConstant(
+                      resized, ch, static_cast<int16_t>(-1000 * ch)));
+      }
+    }
+  }
+
+  // Results do not depend on the number of threads:
+  viren2d::ImageBuffer gradient(211, 307, 3, viren2d::ImageBufferType::Float);
+  for (int r = 0; r < gradient.Height(); ++r) {
+    for (int c = 0; c < gradient.Width(); ++c) {
+      for (int ch = 0; ch < 3; ++ch) {
+        gradient.AtChecked<float>(r, c, ch) = std::sin(0.1f * r * c + ch);
+      }
+    }
+  }
+  for (auto mode : {viren2d::Interpolation::Bilinear,
+                    viren2d::Interpolation::Area}) {
+    viren2d::ImageBuffer serial;
+    viren2d::ImageBuffer parallel;
+    {
+      viren2d::ScopedNumThreads scope(1);
+      serial = gradient.Resize(101, 77, mode);
+    }
+    {
+      viren2d::ScopedNumThreads scope(4);
+      parallel = gradient.Resize(101, 77, mode);
+    }
+    for (int ch = 0; ch < 3; ++ch) {
+      EXPECT_TRUE(CheckChannelEquals(serial, ch, parallel, ch));
+    }
+  }
+
+  EXPECT_THROW(viren2d::ImageBuffer().Resize(3, 3), std::logic_error);
+  EXPECT_THROW(flt.Resize(0, 3), std::invalid_argument);
+  EXPECT_THROW(flt.Resize(3, -1), std::invalid_argument);
+}
+
+
+TEST(ImageBufferTest, StridedViews) {
+  viren2d::ImageBuffer rgba(5, 7, 4, viren2d::ImageBufferType::UInt8);
+  for (int r = 0; r < rgba.Height(); ++r) {
+    for (int c = 0; c < rgba.Width(); ++c) {
+      for (int ch = 0; ch < 4; ++ch) {
+        rgba.AtChecked<unsigned char>(r, c, ch) =
+            static_cast<unsigned char>(r * 50 + c * 4 + ch);
+      }
+    }
+  }
+  EXPECT_EQ(rgba.ChannelStride(), 1);
+  EXPECT_FALSE(rgba.IsReadOnly());
+
+  // Single channel view: no copy, but not contiguous either
+  const viren2d::ImageBuffer &crgba = rgba;
+  viren2d::ImageBuffer alpha = crgba.ChannelView(3);
+  EXPECT_TRUE(alpha.IsReadOnly());
+  EXPECT_FALSE(alpha.OwnsData());
+  EXPECT_FALSE(alpha.IsContiguous());
+  EXPECT_EQ(alpha.Channels(), 1);
+  EXPECT_EQ(alpha.PixelStride(), 4);
+  EXPECT_EQ(alpha.ImmutableData(), rgba.ImmutableData() + 3);
+  EXPECT_TRUE(CheckChannelEquals(alpha, 0, rgba, 3));
+  EXPECT_THROW(alpha.MutableData(), std::logic_error);
+  EXPECT_THROW(alpha.AtChecked<unsigned char>(0, 0, 0) = 1, std::logic_error);
+  EXPECT_THROW(alpha.DimInPlace(0.5), std::logic_error);
+  EXPECT_THROW(alpha.TakeOwnership(), std::logic_error);
+  EXPECT_THROW(crgba.ChannelView(4), std::out_of_range);
+  EXPECT_THROW(crgba.ChannelView(1, 3, 2), std::out_of_range);
+  EXPECT_THROW(crgba.ChannelView(0, 2, 0), std::out_of_range);
+
+  // Reversed channel order (BGR) via a negative channel stride
+  viren2d::ImageBuffer bgr = crgba.ChannelView(2, 3, -1);
+  EXPECT_EQ(bgr.Channels(), 3);
+  EXPECT_EQ(bgr.ChannelStride(), -1);
+  EXPECT_FALSE(bgr.HasContiguousChannels());
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(bgr, ch, rgba, 2 - ch));
+  }
+
+  // Deep copies and transformations yield packed, writeable buffers
+  viren2d::ImageBuffer copy = bgr.DeepCopy();
+  EXPECT_TRUE(copy.IsContiguous());
+  EXPECT_FALSE(copy.IsReadOnly());
+  viren2d::ImageBuffer gray = bgr.ToChannels(4);
+  viren2d::ImageBuffer rgba8 = bgr.ToUInt8(4);
+  viren2d::ImageBuffer dimmed = bgr.Dim(0.5);
+  viren2d::ImageBuffer resized = bgr.Resize(
+        7, 5, viren2d::Interpolation::Nearest);
+  viren2d::ImageBuffer lazy = bgr.Lazy().Scale(1.0).Evaluate(
+        viren2d::ImageBufferType::UInt8);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(copy, ch, rgba, 2 - ch));
+    EXPECT_TRUE(CheckChannelEquals(gray, ch, rgba, 2 - ch));
+    EXPECT_TRUE(CheckChannelEquals(rgba8, ch, rgba, 2 - ch));
+    EXPECT_TRUE(CheckChannelEquals(resized, ch, rgba, 2 - ch));
+    EXPECT_TRUE(CheckChannelEquals(lazy, ch, rgba, 2 - ch));
+    for (int r = 0; r < rgba.Height(); ++r) {
+      for (int c = 0; c < rgba.Width(); ++c) {
+        EXPECT_EQ(dimmed.AtChecked<unsigned char>(r, c, ch),
+                  static_cast<unsigned char>(
+                    0.5 * rgba.AtChecked<unsigned char>(r, c, 2 - ch)));
+      }
+    }
+  }
+  EXPECT_EQ(rgba8.AtChecked<unsigned char>(3, 3, 3), 255);
+
+  // Flipped view via negative row and pixel strides
+  const viren2d::ImageBuffer flipped = crgba.FlipView(true, true);
+  EXPECT_EQ(flipped.RowStride(), -rgba.RowStride());
+  EXPECT_EQ(flipped.PixelStride(), -4);
+  for (int r = 0; r < rgba.Height(); ++r) {
+    for (int c = 0; c < rgba.Width(); ++c) {
+      EXPECT_EQ(flipped.AtChecked<unsigned char>(r, c, 1),
+                rgba.AtChecked<unsigned char>(4 - r, 6 - c, 1));
+    }
+  }
+  EXPECT_TRUE(CheckChannelEquals(
+                flipped.FlipView(true, true).DeepCopy(), 2, rgba, 2));
+
+  // A view onto a view
+  const viren2d::ImageBuffer roi = crgba.ROIView(2, 1, 3, 2).ChannelView(1);
+  EXPECT_EQ(roi.Width(), 3);
+  EXPECT_EQ(roi.Height(), 2);
+  EXPECT_EQ(roi.AtChecked<unsigned char>(1, 2, 0),
+            rgba.AtChecked<unsigned char>(2, 4, 1));
+  EXPECT_THROW(crgba.ROIView(5, 0, 3, 1), std::out_of_range);
+
+  // Views are read-only, even if they are not declared const
+  viren2d::ImageBuffer mutable_view = crgba.FlipView(false, true);
+  EXPECT_THROW(mutable_view.AtUnchecked<unsigned char>(0, 0, 0), std::logic_error);
+
+  // Views keep the pixels alive and are not affected by later changes
+  // of the source buffer (which detaches from the storage).
+  const viren2d::ImageBuffer red = crgba.ChannelView(0);
+  rgba.AtChecked<unsigned char>(0, 0, 0) = 123;
+  EXPECT_EQ(red.AtChecked<unsigned char>(0, 0, 0), 0);
+  rgba = viren2d::ImageBuffer();
+  EXPECT_EQ(red.AtChecked<unsigned char>(4, 6, 0), 224);
+
+  // Statistics & other read-only kernels accept views directly
+  viren2d::ImageBuffer flow(4, 6, 2, viren2d::ImageBufferType::Float);
+  for (int r = 0; r < flow.Height(); ++r) {
+    for (int c = 0; c < flow.Width(); ++c) {
+      flow.AtChecked<float>(r, c, 0) = static_cast<float>(c);
+      flow.AtChecked<float>(r, c, 1) = static_cast<float>(-r);
+    }
+  }
+  const viren2d::ImageBuffer &cflow = flow;
+  const auto stats_v = cflow.ChannelView(1).Statistics();
+  const auto stats_all = flow.Statistics();
+  ASSERT_EQ(stats_v.size(), 1);
+  EXPECT_DOUBLE_EQ(stats_v[0].mean, stats_all[1].mean);
+  EXPECT_DOUBLE_EQ(stats_v[0].min, -3.0);
+  EXPECT_EQ(stats_v[0].min_location, viren2d::Vec2i(0, 3));
+
+  const auto stats_swapped = cflow.ChannelView(1, 2, -1).Statistics();
+  EXPECT_DOUBLE_EQ(stats_swapped[0].variance, stats_all[1].variance);
+  EXPECT_DOUBLE_EQ(stats_swapped[1].variance, stats_all[0].variance);
+
+  viren2d::ImageBuffer mag = cflow.ChannelView(0).Magnitude();
+  EXPECT_TRUE(CheckChannelEquals(mag, 0, flow, 0));
+
+  // A read-only view as output will be replaced
+  viren2d::ImageBuffer out = cflow.ChannelView(0);
+  flow.Dim(&out, 2.0);
+  EXPECT_FALSE(out.IsReadOnly());
+  EXPECT_FLOAT_EQ(out.AtChecked<float>(3, 5, 1), -6.0f);
+  EXPECT_FLOAT_EQ(flow.AtChecked<float>(3, 5, 1), -3.0f);
+}
+
+
+namespace {
+void WriteBytes(const std::string &filename, const std::string &bytes) {
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+
+/// Returns a version 1.0 `.npy` file which stores the given array data.
+std::string NpyFile(
+    const std::string &descr, const std::string &shape,
+    bool fortran_order, const std::string &array_data) {
+  std::string dict = "{'descr': '" + descr + "', 'fortran_order': "
+      + (fortran_order ? "True" : "False") + ", 'shape': (" + shape + "), }";
+  // Total header size must be a multiple of 64 bytes, terminated by '\n'.
+  while ((10 + dict.size() + 1) % 64 != 0) {
+    dict += ' ';
+  }
+  dict += '\n';
+  std::string bytes("\x93NUMPY\x01\x00", 8);
+  bytes += static_cast<char>(dict.size() & 0xFF);
+  bytes += static_cast<char>((dict.size() >> 8) & 0xFF);
+  return bytes + dict + array_data;
+}
+}  // anonymous namespace
+
+
+TEST(ImageBufferTest, MemoryMapped) {
+  const std::string raw_filename = ::testing::TempDir() + "viren2d-mmap.raw";
+  const std::string npy_filename = ::testing::TempDir() + "viren2d-mmap.npy";
+
+  // 3x4x2 int16 raster, preceded by a 6 byte custom header.
+  std::vector<int16_t> values(24);
+  for (std::size_t idx = 0; idx < values.size(); ++idx) {
+    values[idx] = static_cast<int16_t>(idx * 10 - 50);
+  }
+  const std::string array_data(
+        reinterpret_cast<const char *>(values.data()), values.size() * 2);
+  WriteBytes(raw_filename, "HEADER" + array_data);
+
+  // Misaligned offset, too large rasters & invalid dimensions
+  EXPECT_THROW(
+        viren2d::MapRaw(
+          raw_filename, 3, 4, 2, viren2d::ImageBufferType::Int16, 5),
+        std::invalid_argument);
+  EXPECT_THROW(
+        viren2d::MapRaw(
+          raw_filename, 4, 4, 2, viren2d::ImageBufferType::Int16, 6),
+        std::invalid_argument);
+  EXPECT_THROW(
+        viren2d::MapRaw(
+          raw_filename, 0, 4, 2, viren2d::ImageBufferType::Int16, 6),
+        std::invalid_argument);
+  EXPECT_THROW(
+        viren2d::MapRaw(
+          raw_filename + ".missing", 3, 4, 2,
+          viren2d::ImageBufferType::Int16),
+        std::runtime_error);
+
+  viren2d::ImageBuffer roi;
+  {
+    const viren2d::ImageBuffer mapped = viren2d::MapRaw(
+          raw_filename, 3, 4, 2, viren2d::ImageBufferType::Int16, 6);
+    EXPECT_TRUE(mapped.IsValid());
+    EXPECT_TRUE(mapped.IsReadOnly());
+    EXPECT_FALSE(mapped.OwnsData());
+    EXPECT_TRUE(mapped.IsContiguous());
+    for (int row = 0; row < 3; ++row) {
+      for (int col = 0; col < 4; ++col) {
+        for (int ch = 0; ch < 2; ++ch) {
+          EXPECT_EQ(
+                mapped.AtChecked<int16_t>(row, col, ch),
+                values[(row * 4 + col) * 2 + ch]);
+        }
+      }
+    }
+
+    // Views keep the mapping alive.
+    roi = mapped.ROIView(1, 1, 2, 2);
+  }
+  const viren2d::ImageBuffer &roi_view = roi;
+  EXPECT_EQ(roi_view.AtChecked<int16_t>(0, 0, 1), values[11]);
+  EXPECT_EQ(roi_view.AtChecked<int16_t>(1, 1, 0), values[20]);
+  EXPECT_THROW(roi.AtChecked<int16_t>(0, 0, 0) = 3, std::logic_error);
+
+  // A copy-on-write mapping can be modified without changing the file.
+  {
+    viren2d::ImageBuffer mapped = viren2d::MapRaw(
+          raw_filename, 3, 4, 2, viren2d::ImageBufferType::Int16, 6, true);
+    EXPECT_FALSE(mapped.IsReadOnly());
+    viren2d::ImageBuffer writeable_roi = mapped.ROI(2, 1, 2, 2);
+    writeable_roi.AtChecked<int16_t>(0, 0, 0) = 1234;
+    EXPECT_EQ(mapped.AtChecked<int16_t>(1, 2, 0), 1234);
+
+    const viren2d::ImageBuffer reloaded = viren2d::MapRaw(
+          raw_filename, 3, 4, 2, viren2d::ImageBufferType::Int16, 6);
+    EXPECT_EQ(reloaded.AtChecked<int16_t>(1, 2, 0), values[12]);
+  }
+
+  // C-order .npy file (HxWxC)
+  WriteBytes(npy_filename, NpyFile("<i2", "3, 4, 2", false, array_data));
+  const viren2d::ImageBuffer npy = viren2d::MapNpy(npy_filename);
+  EXPECT_EQ(npy.BufferType(), viren2d::ImageBufferType::Int16);
+  EXPECT_EQ(npy.Height(), 3);
+  EXPECT_EQ(npy.Width(), 4);
+  EXPECT_EQ(npy.Channels(), 2);
+  EXPECT_TRUE(npy.IsReadOnly());
+  EXPECT_EQ(npy.AtChecked<int16_t>(2, 3, 1), values[23]);
+  EXPECT_EQ(npy.AtChecked<int16_t>(1, 0, 0), values[8]);
+
+  // Fortran-order .npy file (HxW), i.e. the same data is interpreted
+  // as a column-major 4x6 matrix.
+  WriteBytes(npy_filename, NpyFile("<i2", "4, 6", true, array_data));
+  const viren2d::ImageBuffer fortran = viren2d::MapNpy(npy_filename);
+  EXPECT_EQ(fortran.Height(), 4);
+  EXPECT_EQ(fortran.Width(), 6);
+  EXPECT_EQ(fortran.Channels(), 1);
+  EXPECT_FALSE(fortran.IsContiguous());
+  for (int row = 0; row < 4; ++row) {
+    for (int col = 0; col < 6; ++col) {
+      EXPECT_EQ(
+            fortran.AtChecked<int16_t>(row, col, 0), values[col * 4 + row]);
+    }
+  }
+  const viren2d::ImageBuffer copy = fortran.DeepCopy();
+  EXPECT_TRUE(copy.IsContiguous());
+  EXPECT_EQ(copy.AtChecked<int16_t>(3, 1, 0), values[7]);
+
+  // Unsupported & malformed files
+  WriteBytes(npy_filename, NpyFile("<c8", "3, 4", false, array_data));
+  EXPECT_THROW(viren2d::MapNpy(npy_filename), std::invalid_argument);
+  WriteBytes(npy_filename, NpyFile("<i2", "2, 3, 2, 2", false, array_data));
+  EXPECT_THROW(viren2d::MapNpy(npy_filename), std::invalid_argument);
+  WriteBytes(npy_filename, NpyFile("<i2", "5, 4, 2", false, array_data));
+  EXPECT_THROW(viren2d::MapNpy(npy_filename), std::invalid_argument);
+  WriteBytes(npy_filename, "NUMPY" + array_data);
+  EXPECT_THROW(viren2d::MapNpy(npy_filename), std::runtime_error);
+
+  std::remove(raw_filename.c_str());
+  std::remove(npy_filename.c_str());
+}
+
+
+template <typename _Tp>
+void CheckNpyRoundTrip(viren2d::ImageBufferType buffer_type) {
+  const std::string filename = ::testing::TempDir() + "viren2d-io.npy";
+  viren2d::ImageBuffer buf(5, 7, 3, buffer_type);
+  for (int row = 0; row < buf.Height(); ++row) {
+    for (int col = 0; col < buf.Width(); ++col) {
+      for (int ch = 0; ch < buf.Channels(); ++ch) {
+        buf.AtChecked<_Tp>(row, col, ch) = static_cast<_Tp>(
+              (row * buf.Width() + col) * buf.Channels() + ch + 1);
+      }
+    }
+  }
+
+  // Padded rows, a strided channel view and a flipped view
+  const std::vector<viren2d::ImageBuffer> inputs{
+    buf, buf.ChannelView(2, 2, -2), buf.FlipView(true, true)};
+  for (const auto &input : inputs) {
+    viren2d::SaveNpy(filename, input);
+    const viren2d::ImageBuffer loaded = viren2d::LoadNpy(filename);
+    EXPECT_EQ(loaded.BufferType(), buffer_type);
+    EXPECT_EQ(loaded.Height(), input.Height());
+    EXPECT_EQ(loaded.Width(), input.Width());
+    EXPECT_EQ(loaded.Channels(), input.Channels());
+    EXPECT_FALSE(loaded.IsReadOnly());
+    for (int row = 0; row < input.Height(); ++row) {
+      for (int col = 0; col < input.Width(); ++col) {
+        for (int ch = 0; ch < input.Channels(); ++ch) {
+          EXPECT_EQ(
+                loaded.AtChecked<_Tp>(row, col, ch),
+                input.AtChecked<_Tp>(row, col, ch))
+              << loaded.ToString() << " at row " << row << ", col " << col
+              << ", ch " << ch;
+        }
+      }
+    }
+
+    // The data is aligned, so the file can also be mapped.
+    const viren2d::ImageBuffer mapped = viren2d::MapNpy(filename);
+    EXPECT_TRUE(mapped.IsContiguous());
+    EXPECT_EQ(
+          mapped.AtChecked<_Tp>(mapped.Height() - 1, 0, 0),
+          input.AtChecked<_Tp>(input.Height() - 1, 0, 0));
+  }
+  std::remove(filename.c_str());
+}
+
+
+TEST(ImageBufferTest, NpyIO) {
+  CheckNpyRoundTrip<uint8_t>(viren2d::ImageBufferType::UInt8);
+  CheckNpyRoundTrip<int16_t>(viren2d::ImageBufferType::Int16);
+  CheckNpyRoundTrip<uint16_t>(viren2d::ImageBufferType::UInt16);
+  CheckNpyRoundTrip<int32_t>(viren2d::ImageBufferType::Int32);
+  CheckNpyRoundTrip<uint32_t>(viren2d::ImageBufferType::UInt32);
+  CheckNpyRoundTrip<int64_t>(viren2d::ImageBufferType::Int64);
+  CheckNpyRoundTrip<uint64_t>(viren2d::ImageBufferType::UInt64);
+  CheckNpyRoundTrip<float>(viren2d::ImageBufferType::Float);
+  CheckNpyRoundTrip<double>(viren2d::ImageBufferType::Double);
+
+  const std::string filename = ::testing::TempDir() + "viren2d-io.npy";
+  std::vector<float> values(12);
+  for (std::size_t idx = 0; idx < values.size(); ++idx) {
+    values[idx] = 0.5f * idx;
+  }
+  const std::string array_data(
+        reinterpret_cast<const char *>(values.data()), values.size() * 4);
+
+  // Fortran-order arrays are loaded in row-major layout.
+  WriteBytes(filename, NpyFile("<f4", "3, 4", true, array_data));
+  const viren2d::ImageBuffer loaded = viren2d::LoadNpy(filename);
+  EXPECT_EQ(loaded.BufferType(), viren2d::ImageBufferType::Float);
+  EXPECT_EQ(loaded.Height(), 3);
+  EXPECT_EQ(loaded.Width(), 4);
+  EXPECT_EQ(loaded.Channels(), 1);
+  EXPECT_EQ(loaded.PixelStride(), 4);
+  for (int row = 0; row < 3; ++row) {
+    for (int col = 0; col < 4; ++col) {
+      EXPECT_FLOAT_EQ(loaded.AtChecked<float>(row, col, 0), values[col * 3 + row]);
+    }
+  }
+
+  // Truncated & invalid files
+  WriteBytes(filename, NpyFile("<f4", "4, 4", false, array_data));
+  EXPECT_THROW(viren2d::LoadNpy(filename), std::runtime_error);
+  WriteBytes(filename, "NPY");
+  EXPECT_THROW(viren2d::LoadNpy(filename), std::runtime_error);
+  EXPECT_THROW(
+        viren2d::LoadNpy(filename + ".missing"), std::runtime_error);
+  EXPECT_THROW(
+        viren2d::SaveNpy(filename, viren2d::ImageBuffer()),
+        std::invalid_argument);
+
+  // A rejected save must not truncate an existing file.
+  viren2d::SaveNpy(filename, loaded);
+  EXPECT_THROW(
+        viren2d::SaveNpy(
+          filename,
+          viren2d::ImageBuffer(2, 2, 1, viren2d::ImageBufferType::BFloat16)),
+        std::invalid_argument);
+  const viren2d::ImageBuffer kept = viren2d::LoadNpy(filename);
+  ASSERT_EQ(kept.Height(), 3);
+  ASSERT_EQ(kept.Width(), 4);
+  EXPECT_FLOAT_EQ(kept.AtChecked<float>(2, 3, 0), values[3 * 3 + 2]);
+  std::remove(filename.c_str());
+}
+
+
+/// Brute-force box filter of a single pixel (replicated border).
+double BoxFilterReference(
+    const viren2d::ImageBuffer &img, int row, int col, int ch, int radius) {
+  double sum = 0.0;
+  for (int y = row - radius; y <= row + radius; ++y) {
+    for (int x = col - radius; x <= col + radius; ++x) {
+      sum += img.AtChecked<uint8_t>(
+            std::min(std::max(y, 0), img.Height() - 1),
+            std::min(std::max(x, 0), img.Width() - 1), ch);
+    }
+  }
+  return sum / ((2 * radius + 1) * (2 * radius + 1));
+}
+
+
+template <typename _Tp>
+void CheckBlurConstant(viren2d::ImageBufferType buffer_type) {
+  viren2d::ImageBuffer buf(40, 50, 2, buffer_type);
+  buf.SetToPixel<_Tp>(static_cast<_Tp>(7), static_cast<_Tp>(100));
+  buf.Blur({viren2d::Rect(25, 20, 50, 40)}, 9, viren2d::BlurKind::Gaussian);
+  EXPECT_TRUE(CheckChannelConstant(buf, 0, 7));
+  EXPECT_TRUE(CheckChannelConstant(buf, 1, 100));
+}
+
+
+TEST(ImageBufferTest, Blur) {
+  // The cascaded boxes approximate the requested variance.
+  for (double sigma : {2.0, 5.0, 12.5}) {
+    const std::vector<int> radii = viren2d::helpers::GaussianBoxRadii(sigma);
+    EXPECT_EQ(radii.size(), 3u);
+    double variance = 0.0;
+    for (int radius : radii) {
+      const int width = 2 * radius + 1;
+      variance += (width * width - 1) / 12.0;
+    }
+    EXPECT_NEAR(variance, sigma * sigma, sigma);
+  }
+  // Small (positive) sigmas must still blur
+  for (double sigma : {0.1, 1.0 / 3.0, 0.5}) {
+    for (int radius : viren2d::helpers::GaussianBoxRadii(sigma)) {
+      EXPECT_GE(radius, 1) << "sigma = " << sigma;
+    }
+  }
+  viren2d::ImageBuffer spot(9, 9, 1, viren2d::ImageBufferType::UInt8);
+  spot.SetToScalar<uint8_t>(0);
+  spot.AtChecked<uint8_t>(4, 4, 0) = 255;
+  spot.Blur({viren2d::Rect(4.5, 4.5, 9, 9)}, 1);
+  EXPECT_LT(spot.AtChecked<uint8_t>(4, 4, 0), 255);
+  EXPECT_GT(spot.AtChecked<uint8_t>(4, 5, 0), 0);
+
+  // Non-finite values only affect the windows which contain them, i.e.
+  // they must not corrupt the running sums.
+  viren2d::ImageBuffer nonfinite(20, 30, 2, viren2d::ImageBufferType::Float);
+  nonfinite.SetToScalar<float>(1.0f);
+  nonfinite.AtChecked<float>(2, 3, 0) = std::numeric_limits<float>::quiet_NaN();
+  nonfinite.AtChecked<float>(12, 20, 1) = std::numeric_limits<float>::infinity();
+  nonfinite.AtChecked<float>(14, 20, 1) = -std::numeric_limits<float>::infinity();
+  nonfinite.Blur({viren2d::Rect(15, 10, 30, 20)}, 1, viren2d::BlurKind::Box);
+  for (int row = 0; row < nonfinite.Height(); ++row) {
+    for (int col = 0; col < nonfinite.Width(); ++col) {
+      const bool near_nan = (std::abs(row - 2) <= 1) && (std::abs(col - 3) <= 1);
+      const float value0 = nonfinite.AtChecked<float>(row, col, 0);
+      if (near_nan) {
+        EXPECT_TRUE(std::isnan(value0)) << "at row " << row << ", col " << col;
+      } else {
+        EXPECT_FLOAT_EQ(value0, 1.0f) << "at row " << row << ", col " << col;
+      }
+
+      const bool near_pos = (std::abs(row - 12) <= 1) && (std::abs(col - 20) <= 1);
+      const bool near_neg = (std::abs(row - 14) <= 1) && (std::abs(col - 20) <= 1);
+      const float value1 = nonfinite.AtChecked<float>(row, col, 1);
+      if (near_pos && near_neg) {
+        EXPECT_TRUE(std::isnan(value1)) << "at row " << row << ", col " << col;
+      } else if (near_pos) {
+        EXPECT_EQ(value1, std::numeric_limits<float>::infinity());
+      } else if (near_neg) {
+        EXPECT_EQ(value1, -std::numeric_limits<float>::infinity());
+      } else {
+        EXPECT_FLOAT_EQ(value1, 1.0f) << "at row " << row << ", col " << col;
+      }
+    }
+  }
+
+  viren2d::ImageBuffer img(60, 80, 3, viren2d::ImageBufferType::UInt8);
+  for (int row = 0; row < img.Height(); ++row) {
+    for (int col = 0; col < img.Width(); ++col) {
+      for (int ch = 0; ch < 3; ++ch) {
+        img.AtChecked<uint8_t>(row, col, ch) = static_cast<uint8_t>(
+              (row * 37 + col * 101 + ch * 53 + row * col) % 256);
+      }
+    }
+  }
+  const viren2d::ImageBuffer original = img.DeepCopy();
+
+  // Box blur of a region at the top-left image corner (which is
+  // partially outside of the image) and a center region.
+  const int radius = 3;
+  const std::vector<viren2d::Rect> rois{
+    viren2d::Rect(2, 3, 12, 10), viren2d::Rect(50, 30, 20, 16)};
+  img.Blur(rois, radius, viren2d::BlurKind::Box);
+  for (int row = 0; row < img.Height(); ++row) {
+    for (int col = 0; col < img.Width(); ++col) {
+      const bool inside = ((row < 8) && (col < 8))
+          || ((row >= 22) && (row < 38) && (col >= 40) && (col < 60));
+      for (int ch = 0; ch < 3; ++ch) {
+        const double expected = inside
+            ? BoxFilterReference(original, row, col, ch, radius)
+            : original.AtChecked<uint8_t>(row, col, ch);
+        EXPECT_NEAR(img.AtChecked<uint8_t>(row, col, ch), expected, 0.51)
+            << "at row " << row << ", col " << col << ", ch " << ch;
+      }
+    }
+  }
+
+  // Many regions are blurred in parallel, with the same result as
+  // blurring them one after the other.
+  std::vector<viren2d::Rect> faces;
+  for (int row = 0; row < 6; ++row) {
+    for (int col = 0; col < 8; ++col) {
+      faces.push_back(viren2d::Rect(col * 10 + 5, row * 10 + 5, 8, 8));
+    }
+  }
+  viren2d::ImageBuffer parallel = original.DeepCopy();
+  parallel.Blur(faces, 5);
+  for (const auto &face : faces) {
+    viren2d::ImageBuffer single = original.DeepCopy();
+    single.Blur({face}, 5);
+    const int left = static_cast<int>(face.cx - 5);
+    const int top = static_cast<int>(face.cy - 5);
+    for (int ch = 0; ch < 3; ++ch) {
+      EXPECT_TRUE(CheckChannelEquals(
+                    parallel.ROIView(left, top, 10, 10), ch,
+                    single.ROIView(left, top, 10, 10), ch));
+    }
+  }
+
+  // Overlapping regions: later ones overwrite earlier ones
+  viren2d::ImageBuffer overlap = original.DeepCopy();
+  overlap.Blur(
+        {viren2d::Rect(40, 30, 40, 40), viren2d::Rect(40, 30, 10, 10)},
+        2, viren2d::BlurKind::Box);
+  viren2d::ImageBuffer later = original.DeepCopy();
+  later.Blur({viren2d::Rect(40, 30, 10, 10)}, 2, viren2d::BlurKind::Box);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(
+                  overlap.ROIView(35, 25, 10, 10), ch,
+                  later.ROIView(35, 25, 10, 10), ch));
+  }
+
+  // Averages of constant images are exact for all types
+  CheckBlurConstant<uint8_t>(viren2d::ImageBufferType::UInt8);
+  CheckBlurConstant<int16_t>(viren2d::ImageBufferType::Int16);
+  CheckBlurConstant<uint16_t>(viren2d::ImageBufferType::UInt16);
+  CheckBlurConstant<int32_t>(viren2d::ImageBufferType::Int32);
+  CheckBlurConstant<uint32_t>(viren2d::ImageBufferType::UInt32);
+  CheckBlurConstant<int64_t>(viren2d::ImageBufferType::Int64);
+  CheckBlurConstant<uint64_t>(viren2d::ImageBufferType::UInt64);
+  CheckBlurConstant<float>(viren2d::ImageBufferType::Float);
+  CheckBlurConstant<double>(viren2d::ImageBufferType::Double);
+
+  // Regions outside of the image are ignored
+  viren2d::ImageBuffer outside = original.DeepCopy();
+  outside.Blur({viren2d::Rect(-20, -20, 10, 10)}, 3);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(outside, ch, original, ch));
+  }
+
+  // Invalid inputs
+  EXPECT_THROW(img.Blur(rois, 0), std::invalid_argument);
+  EXPECT_THROW(
+        img.Blur({viren2d::Rect(20, 20, 10, 10, 45.0)}, 3),
+        std::invalid_argument);
+  EXPECT_THROW(viren2d::ImageBuffer().Blur(rois, 3), std::logic_error);
+  viren2d::ImageBuffer view = original.ROIView(0, 0, 20, 20);
+  EXPECT_THROW(view.Blur(rois, 3), std::logic_error);
+  EXPECT_EQ(viren2d::BlurKindFromString("Gaussian"), viren2d::BlurKind::Gaussian);
+  EXPECT_EQ(viren2d::BlurKindToString(viren2d::BlurKind::Box), "box");
+  EXPECT_THROW(viren2d::BlurKindFromString("median"), std::invalid_argument);
+}
+
+
+TEST(ImageBufferTest, ColorPop) {
+  viren2d::ImageBuffer rgba(23, 37, 4, viren2d::ImageBufferType::UInt8);
+  for (int row = 0; row < rgba.Height(); ++row) {
+    for (int col = 0; col < rgba.Width(); ++col) {
+      for (int ch = 0; ch < 4; ++ch) {
+        rgba.AtChecked<uint8_t>(row, col, ch) = static_cast<uint8_t>(
+              (row * 29 + col * 71 + ch * 97 + row * col * (ch + 1)) % 256);
+      }
+    }
+    // Include achromatic pixels
+    rgba.AtChecked<uint8_t>(row, 0, 1) = rgba.AtChecked<uint8_t>(row, 0, 0);
+    rgba.AtChecked<uint8_t>(row, 0, 2) = rgba.AtChecked<uint8_t>(row, 0, 0);
+  }
+  const viren2d::ImageBuffer rgb = rgba.ToChannels(3);
+
+  const std::pair<float, float> hue_range{30.0f, 250.0f};
+  const std::pair<float, float> sat_range{0.2f, 0.9f};
+  const std::pair<float, float> val_range{0.1f, 1.0f};
+
+  // The fused implementations must yield the same results as the
+  // separate conversions, for packed and strided (flipped) inputs.
+  for (const auto &image : {rgb, rgba, rgb.FlipView(true, false),
+                            rgba.ChannelView(0, 3, 1),
+                            rgba.ChannelView(2, 3, -1)}) {
+    for (bool is_bgr : {false, true}) {
+      const viren2d::ImageBuffer mask = viren2d::MaskHSVRange(
+            viren2d::ConvertRGB2HSV(image, is_bgr),
+            hue_range, sat_range, val_range);
+      const viren2d::ImageBuffer gray = viren2d::ConvertRGB2Gray(
+            image, 1, is_bgr);
+
+      const viren2d::ImageBuffer fused_mask = viren2d::MaskColorRange(
+            image, hue_range, sat_range, val_range, is_bgr);
+      EXPECT_TRUE(CheckChannelEquals(fused_mask, 0, mask, 0));
+
+      const viren2d::ImageBuffer pop = viren2d::ColorPop(
+            image, hue_range, sat_range, val_range, is_bgr);
+      ASSERT_EQ(pop.Channels(), image.Channels());
+      int num_popped = 0;
+      for (int row = 0; row < image.Height(); ++row) {
+        for (int col = 0; col < image.Width(); ++col) {
+          const bool within = mask.AtChecked<uint8_t>(row, col) > 0;
+          num_popped += within ? 1 : 0;
+          for (int ch = 0; ch < image.Channels(); ++ch) {
+            const uint8_t expected = (within || (ch == 3))
+                ? image.AtChecked<uint8_t>(row, col, ch)
+                : gray.AtChecked<uint8_t>(row, col);
+            EXPECT_EQ(pop.AtChecked<uint8_t>(row, col, ch), expected);
+          }
+        }
+      }
+      EXPECT_GT(num_popped, 0);
+      EXPECT_LT(num_popped, image.Width() * image.Height());
+    }
+  }
+
+  // Invalid inputs
+  EXPECT_THROW(
+        viren2d::ColorPop(viren2d::ImageBuffer(), hue_range, sat_range, val_range),
+        std::logic_error);
+  EXPECT_THROW(
+        viren2d::ColorPop(rgba.ToChannels(2), hue_range, sat_range, val_range),
+        std::invalid_argument);
+  EXPECT_THROW(
+        viren2d::MaskColorRange(rgb.ToFloat(), hue_range, sat_range, val_range),
+        std::invalid_argument);
+}
+
+
+/// Double-precision reference of the sRGB (D65) to L*a*b* conversion.
+void ReferenceRGB2Lab(double red, double green, double blue, double *lab) {
+  const auto linearize = [](double c) {
+    return (c <= 0.04045) ? (c / 12.92) : std::pow((c + 0.055) / 1.055, 2.4);
+  };
+  const auto f = [](double t) {
+    return (t > 216.0 / 24389.0)
+        ? std::cbrt(t) : ((24389.0 / 27.0 * t + 16.0) / 116.0);
+  };
+  red = linearize(red);
+  green = linearize(green);
+  blue = linearize(blue);
+  const double x = (0.4124564 * red + 0.3575761 * green + 0.1804375 * blue) / 0.95047;
+  const double y = 0.2126729 * red + 0.7151522 * green + 0.0721750 * blue;
+  const double z = (0.0193339 * red + 0.1191920 * green + 0.9503041 * blue) / 1.08883;
+  lab[0] = 116.0 * f(y) - 16.0;
+  lab[1] = 500.0 * (f(x) - f(y));
+  lab[2] = 200.0 * (f(y) - f(z));
+}
+
+
+TEST(ImageBufferTest, ColorSpaces) {
+  viren2d::ImageBuffer rgba(19, 41, 4, viren2d::ImageBufferType::UInt8);
+  for (int row = 0; row < rgba.Height(); ++row) {
+    for (int col = 0; col < rgba.Width(); ++col) {
+      for (int ch = 0; ch < 4; ++ch) {
+        rgba.AtChecked<uint8_t>(row, col, ch) = static_cast<uint8_t>(
+              (row * 37 + col * 59 + ch * 83 + row * col * (ch + 2)) % 256);
+      }
+    }
+  }
+  // Include black, white and primary colors
+  for (int ch = 0; ch < 3; ++ch) {
+    rgba.AtChecked<uint8_t>(0, 0, ch) = 0;
+    rgba.AtChecked<uint8_t>(0, 1, ch) = 255;
+    rgba.AtChecked<uint8_t>(0, 2, ch) = (ch == 0) ? 255 : 0;
+    rgba.AtChecked<uint8_t>(0, 3, ch) = (ch == 2) ? 255 : 0;
+  }
+  const viren2d::ImageBuffer rgb = rgba.ToChannels(3);
+  const viren2d::ImageBuffer rgb_float = rgb.ToFloat();
+
+  // L*a*b* conversion of uint8 and float images
+  const viren2d::ImageBuffer lab = viren2d::ConvertRGB2Lab(rgb);
+  const viren2d::ImageBuffer lab_float = viren2d::ConvertRGB2Lab(rgb_float);
+  ASSERT_EQ(lab.BufferType(), viren2d::ImageBufferType::UInt8);
+  ASSERT_EQ(lab_float.BufferType(), viren2d::ImageBufferType::Float);
+  ASSERT_EQ(lab.Channels(), 3);
+  ASSERT_EQ(lab_float.Channels(), 3);
+  double expected[3];
+  for (int row = 0; row < rgb.Height(); ++row) {
+    for (int col = 0; col < rgb.Width(); ++col) {
+      ReferenceRGB2Lab(
+            rgb_float.AtChecked<float>(row, col, 0),
+            rgb_float.AtChecked<float>(row, col, 1),
+            rgb_float.AtChecked<float>(row, col, 2), expected);
+      EXPECT_NEAR(lab_float.AtChecked<float>(row, col, 0), expected[0], 0.01);
+      EXPECT_NEAR(lab_float.AtChecked<float>(row, col, 1), expected[1], 0.01);
+      EXPECT_NEAR(lab_float.AtChecked<float>(row, col, 2), expected[2], 0.01);
+
+      EXPECT_NEAR(lab.AtChecked<uint8_t>(row, col, 0),
+                  expected[0] * 255.0 / 100.0, 1.0);
+      EXPECT_NEAR(lab.AtChecked<uint8_t>(row, col, 1),
+                  expected[1] + 128.0, 1.0);
+      EXPECT_NEAR(lab.AtChecked<uint8_t>(row, col, 2),
+                  expected[2] + 128.0, 1.0);
+    }
+  }
+  EXPECT_NEAR(lab_float.AtChecked<float>(0, 0, 0), 0.0f, 1e-3f);
+  EXPECT_NEAR(lab_float.AtChecked<float>(0, 1, 0), 100.0f, 1e-3f);
+  EXPECT_NEAR(lab_float.AtChecked<float>(0, 1, 1), 0.0f, 1e-3f);
+  EXPECT_NEAR(lab_float.AtChecked<float>(0, 1, 2), 0.0f, 1e-3f);
+
+  // Float round trip & alpha channel
+  const viren2d::ImageBuffer restored = viren2d::ConvertLab2RGB(lab_float, 4);
+  ASSERT_EQ(restored.Channels(), 4);
+  for (int row = 0; row < rgb.Height(); ++row) {
+    for (int col = 0; col < rgb.Width(); ++col) {
+      for (int ch = 0; ch < 3; ++ch) {
+        EXPECT_NEAR(restored.AtChecked<float>(row, col, ch),
+                    rgb_float.AtChecked<float>(row, col, ch), 1e-3f);
+      }
+      EXPECT_FLOAT_EQ(restored.AtChecked<float>(row, col, 3), 1.0f);
+    }
+  }
+  const viren2d::ImageBuffer restored_uint8 = viren2d::ConvertLab2RGB(lab);
+  EXPECT_EQ(restored_uint8.BufferType(), viren2d::ImageBufferType::UInt8);
+  EXPECT_EQ(restored_uint8.AtChecked<uint8_t>(0, 1, 1), 255);
+  EXPECT_EQ(restored_uint8.AtChecked<uint8_t>(0, 0, 1), 0);
+
+  // Strided inputs & BGR format: The reversed channel view of the
+  // RGBA image is the BGR version of the RGB image.
+  const viren2d::ImageBuffer &bgr_view = rgba.ChannelView(2, 3, -1);
+  EXPECT_TRUE(CheckChannelEquals(
+                viren2d::ConvertRGB2Lab(bgr_view, true), 1, lab, 1));
+  const viren2d::ImageBuffer bgr = viren2d::ConvertLab2RGB(lab, 3, true);
+  EXPECT_TRUE(CheckChannelEquals(bgr, 0, restored_uint8, 2));
+  viren2d::ImageBuffer lab_into;
+  viren2d::ConvertRGB2Lab(rgba, &lab_into);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(lab_into, ch, lab, ch));
+  }
+
+  // HSV conversion of strided inputs must match the packed results
+  const viren2d::ImageBuffer hsv = viren2d::ConvertRGB2HSV(rgb);
+  const viren2d::ImageBuffer hsv_view = viren2d::ConvertRGB2HSV(bgr_view, true);
+  const viren2d::ImageBuffer back = viren2d::ConvertHSV2RGB(hsv, 4);
+  const viren2d::ImageBuffer &hsv_flipped = hsv.FlipView(true, true);
+  const viren2d::ImageBuffer back_flipped = viren2d::ConvertHSV2RGB(hsv_flipped);
+  for (int row = 0; row < rgb.Height(); ++row) {
+    for (int col = 0; col < rgb.Width(); ++col) {
+      for (int ch = 0; ch < 3; ++ch) {
+        EXPECT_EQ(hsv_view.AtChecked<uint8_t>(row, col, ch),
+                  hsv.AtChecked<uint8_t>(row, col, ch));
+        EXPECT_EQ(back_flipped.AtChecked<uint8_t>(
+                    rgb.Height() - 1 - row, rgb.Width() - 1 - col, ch),
+                  back.AtChecked<uint8_t>(row, col, ch));
+      }
+      EXPECT_EQ(back.AtChecked<uint8_t>(row, col, 3), 255);
+    }
+  }
+  // Primary colors survive the HSV round trip
+  for (int col = 0; col < 4; ++col) {
+    for (int ch = 0; ch < 3; ++ch) {
+      EXPECT_EQ(back.AtChecked<uint8_t>(0, col, ch),
+                rgb.AtChecked<uint8_t>(0, col, ch));
+    }
+  }
+
+  // Invalid inputs
+  EXPECT_THROW(viren2d::ConvertRGB2Lab(viren2d::ImageBuffer()), std::logic_error);
+  EXPECT_THROW(viren2d::ConvertRGB2Lab(rgb.ToChannels(1)), std::invalid_argument);
+  EXPECT_THROW(
+        viren2d::ConvertRGB2Lab(viren2d::ImageBuffer(
+          3, 3, 3, viren2d::ImageBufferType::Int16)),
+        std::invalid_argument);
+  EXPECT_THROW(viren2d::ConvertLab2RGB(lab, 2), std::invalid_argument);
+  EXPECT_THROW(viren2d::ConvertLab2RGB(rgba), std::invalid_argument);
+  EXPECT_THROW(viren2d::ConvertHSV2RGB(hsv, 5), std::invalid_argument);
+  EXPECT_THROW(viren2d::ConvertRGB2HSV(rgba.ToChannels(2)), std::invalid_argument);
+}
+
+
+TEST(ImageBufferTest, PackedMasks) {
+  // Width > 64 to cover multiple words per row and a partial last word
+  viren2d::ImageBuffer rgba(19, 83, 4, viren2d::ImageBufferType::UInt8);
+  for (int row = 0; row < rgba.Height(); ++row) {
+    for (int col = 0; col < rgba.Width(); ++col) {
+      for (int ch = 0; ch < 4; ++ch) {
+        rgba.AtChecked<uint8_t>(row, col, ch) = static_cast<uint8_t>(
+              (row * 31 + col * 67 + ch * 89 + row * col * (ch + 2)) % 256);
+      }
+    }
+  }
+  const viren2d::ImageBuffer rgb = rgba.ToChannels(3);
+
+  const auto check_packed = [](
+      const viren2d::PackedMask &packed, const viren2d::ImageBuffer &mask) {
+    if ((packed.Width() != mask.Width())
+        || (packed.Height() != mask.Height())) {
+      return false;
+    }
+    for (int row = 0; row < mask.Height(); ++row) {
+      for (int col = 0; col < mask.Width(); ++col) {
+        if (packed.IsSet(row, col) != (mask.AtChecked<uint8_t>(row, col) > 0)) {
+          return false;
+        }
+      }
+      // Padding bits must be 0
+      const int num_tail = mask.Width() % 64;
+      if ((num_tail > 0)
+          && ((packed.RowPtr(row)[packed.WordsPerRow() - 1] >> num_tail) != 0)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  // Packed range masks must match the byte masks, for contiguous
+  // buffers as well as views.
+  for (const auto &image : {rgba, rgba.ROIView(3, 2, 70, 15),
+                            rgba.FlipView(true, false)}) {
+    const viren2d::PackedMask packed = image.MaskRangePacked<uint8_t>(
+          20, 230, 10, 200, 0, 255, 50, 250);
+    EXPECT_TRUE(check_packed(
+                  packed, image.MaskRange<uint8_t>(
+                    20, 230, 10, 200, 0, 255, 50, 250)));
+    EXPECT_GT(packed.CountNonZero(), 0);
+    EXPECT_LT(packed.CountNonZero(), image.Width() * image.Height());
+  }
+  for (const auto &image : {rgb, rgb.FlipView(false, true)}) {
+    EXPECT_TRUE(check_packed(
+                  image.MaskRangePacked<uint8_t>(0, 128, 64, 255, 10, 240),
+                  image.MaskRange<uint8_t>(0, 128, 64, 255, 10, 240)));
+  }
+  const viren2d::ImageBuffer gray_float = viren2d::ConvertRGB2Gray(
+        rgb, 1).ToFloat();
+  EXPECT_TRUE(check_packed(
+                gray_float.MaskRangePacked<float>(0.2f, 0.7f),
+                gray_float.MaskRange<float>(0.2f, 0.7f)));
+  EXPECT_THROW(rgb.MaskRangePacked<uint8_t>(0, 255), std::invalid_argument);
+
+  const std::pair<float, float> hue_range{30.0f, 250.0f};
+  const std::pair<float, float> sat_range{0.2f, 0.9f};
+  const std::pair<float, float> val_range{0.1f, 1.0f};
+  for (const auto &image : {rgb, rgba, rgba.ChannelView(2, 3, -1)}) {
+    for (bool is_bgr : {false, true}) {
+      const viren2d::ImageBuffer hsv = viren2d::ConvertRGB2HSV(image, is_bgr);
+      EXPECT_TRUE(check_packed(
+                    viren2d::MaskHSVRangePacked(
+                      hsv, hue_range, sat_range, val_range),
+                    viren2d::MaskHSVRange(
+                      hsv, hue_range, sat_range, val_range)));
+      EXPECT_TRUE(check_packed(
+                    viren2d::MaskColorRangePacked(
+                      image, hue_range, sat_range, val_range, is_bgr),
+                    viren2d::MaskColorRange(
+                      image, hue_range, sat_range, val_range, is_bgr)));
+    }
+  }
+
+  // Round trip, inversion & comparison
+  const viren2d::ImageBuffer byte_mask = rgba.MaskRange<uint8_t>(
+        0, 127, 0, 255, 0, 255, 0, 255);
+  const viren2d::PackedMask packed(byte_mask);
+  EXPECT_TRUE(check_packed(packed, byte_mask));
+  EXPECT_TRUE(CheckChannelEquals(packed.ToImageBuffer(), 0, byte_mask, 0));
+  EXPECT_EQ(packed, viren2d::PackedMask(byte_mask.ToFloat()));
+  EXPECT_EQ(packed, rgba.MaskRangePacked<uint8_t>(
+              0, 127, 0, 255, 0, 255, 0, 255));
+
+  const viren2d::PackedMask inverted = packed.Inverted();
+  EXPECT_NE(packed, inverted);
+  EXPECT_EQ(packed.CountNonZero() + inverted.CountNonZero(),
+            rgba.Width() * rgba.Height());
+  EXPECT_TRUE(check_packed(inverted.Inverted(), byte_mask));
+  EXPECT_EQ(packed.NumBytes(), 2 * 8 * rgba.Height());
+
+  viren2d::PackedMask manual(2, 70);
+  EXPECT_EQ(manual.CountNonZero(), 0);
+  manual.Set(1, 69);
+  manual.Set(0, 3);
+  manual.Set(0, 3, false);
+  EXPECT_TRUE(manual.IsSet(1, 69));
+  EXPECT_FALSE(manual.IsSet(0, 3));
+  EXPECT_EQ(manual.CountNonZero(), 1);
+  EXPECT_EQ(viren2d::PackedMask(3, 65, true).CountNonZero(), 3 * 65);
+
+  // Blending only affects the masked pixels
+  viren2d::ImageBuffer overlay(rgba.Height(), rgba.Width(), 3,
+                               viren2d::ImageBufferType::UInt8);
+  for (int row = 0; row < overlay.Height(); ++row) {
+    for (int col = 0; col < overlay.Width(); ++col) {
+      overlay.AtChecked<uint8_t>(row, col, 0) = 200;
+      overlay.AtChecked<uint8_t>(row, col, 1) = static_cast<uint8_t>(col);
+      overlay.AtChecked<uint8_t>(row, col, 2) = static_cast<uint8_t>(row * 3);
+    }
+  }
+  for (double alpha : {1.0, 0.4}) {
+    const viren2d::ImageBuffer blended = rgba.Blend(overlay, packed, alpha);
+    const viren2d::ImageBuffer blended_all = rgba.Blend(overlay, alpha);
+    ASSERT_EQ(blended.Channels(), 4);
+    for (int row = 0; row < rgba.Height(); ++row) {
+      for (int col = 0; col < rgba.Width(); ++col) {
+        for (int ch = 0; ch < 4; ++ch) {
+          const uint8_t expected = packed.IsSet(row, col)
+              ? blended_all.AtChecked<uint8_t>(row, col, ch)
+              : rgba.AtChecked<uint8_t>(row, col, ch);
+          EXPECT_EQ(blended.AtChecked<uint8_t>(row, col, ch), expected);
+        }
+      }
+    }
+
+    viren2d::ImageBuffer into = rgba.DeepCopy();
+    into.Blend(&into, overlay, packed, alpha);
+    EXPECT_TRUE(CheckChannelEquals(into, 0, blended, 0));
+    EXPECT_TRUE(CheckChannelEquals(into, 2, blended, 2));
+  }
+
+  // Invalid inputs
+  EXPECT_THROW(viren2d::PackedMask(0, 10), std::invalid_argument);
+  EXPECT_THROW(viren2d::PackedMask{rgb}, std::invalid_argument);
+  EXPECT_THROW(viren2d::PackedMask(viren2d::ImageBuffer()), std::invalid_argument);
+  EXPECT_THROW(rgba.Blend(overlay, viren2d::PackedMask(3, 3)), std::logic_error);
+  EXPECT_THROW(rgba.Blend(overlay, viren2d::PackedMask()), std::logic_error);
+  EXPECT_THROW(
+        viren2d::MaskColorRangePacked(rgb.ToFloat(), hue_range, sat_range, val_range),
+        std::invalid_argument);
+  EXPECT_THROW(
+        viren2d::MaskHSVRangePacked(rgba, hue_range, sat_range, val_range),
+        std::invalid_argument);
+}
+
+
+TEST(ImageBufferTest, FixedPointBlending) {
+  viren2d::ImageBuffer rgba(21, 53, 4, viren2d::ImageBufferType::UInt8);
+  viren2d::ImageBuffer overlay(21, 53, 4, viren2d::ImageBufferType::UInt8);
+  viren2d::ImageBuffer weights(21, 53, 1, viren2d::ImageBufferType::Float);
+  for (int row = 0; row < rgba.Height(); ++row) {
+    for (int col = 0; col < rgba.Width(); ++col) {
+      for (int ch = 0; ch < 4; ++ch) {
+        rgba.AtChecked<uint8_t>(row, col, ch) = static_cast<uint8_t>(
+              (row * 13 + col * 41 + ch * 67) % 256);
+        overlay.AtChecked<uint8_t>(row, col, ch) = static_cast<uint8_t>(
+              (row * col + ch * 111 + 7) % 256);
+      }
+      weights.AtChecked<float>(row, col, 0) = ((row + 2 * col) % 37) / 36.0f;
+    }
+    // Fully transparent & opaque overlay pixels
+    overlay.AtChecked<uint8_t>(row, 0, 3) = 0;
+    overlay.AtChecked<uint8_t>(row, 1, 3) = 255;
+  }
+  const viren2d::ImageBuffer rgb = rgba.ToChannels(3);
+  const viren2d::ImageBuffer overlay_rgb = overlay.ToChannels(3);
+
+  const auto blend = [](int value1, int value2, double alpha) {
+    const int weight = static_cast<int>(alpha * 256.0 + 0.5);
+    return static_cast<uint8_t>(
+          (value1 * (256 - weight) + value2 * weight + 128) >> 8);
+  };
+
+  // Constant alpha: Packed and strided inputs must yield the same
+  // (rounded) results.
+  for (double alpha : {0.0, 0.3, 0.5, 1.0}) {
+    for (const auto &pair : {
+           std::make_pair(rgb, overlay_rgb),
+           std::make_pair(rgb.FlipView(true, false),
+                          overlay_rgb.FlipView(true, false)),
+           std::make_pair(rgba.ChannelView(0, 3, 1), overlay_rgb)}) {
+      const viren2d::ImageBuffer &image = pair.first;
+      const viren2d::ImageBuffer &other = pair.second;
+      const viren2d::ImageBuffer blended = image.Blend(other, alpha);
+      for (int row = 0; row < image.Height(); ++row) {
+        for (int col = 0; col < image.Width(); ++col) {
+          for (int ch = 0; ch < 3; ++ch) {
+            EXPECT_EQ(blended.AtChecked<uint8_t>(row, col, ch),
+                      blend(image.AtChecked<uint8_t>(row, col, ch),
+                            other.AtChecked<uint8_t>(row, col, ch), alpha));
+          }
+        }
+      }
+    }
+  }
+
+  // Per-pixel weights (float & double, single- and multi-channel)
+  const viren2d::ImageBuffer weights3 = weights.ToChannels(3);
+  for (const auto &w : {weights, weights.AsType(viren2d::ImageBufferType::Double),
+                        weights3}) {
+    const viren2d::ImageBuffer blended = rgb.Blend(overlay_rgb, w);
+    const viren2d::ImageBuffer blended_view = rgb.FlipView(false, true).Blend(
+          overlay_rgb.FlipView(false, true), w.FlipView(false, true));
+    for (int row = 0; row < rgb.Height(); ++row) {
+      for (int col = 0; col < rgb.Width(); ++col) {
+        const double alpha = weights.AtChecked<float>(row, col, 0);
+        for (int ch = 0; ch < 3; ++ch) {
+          const uint8_t expected = blend(
+                rgb.AtChecked<uint8_t>(row, col, ch),
+                overlay_rgb.AtChecked<uint8_t>(row, col, ch), alpha);
+          EXPECT_EQ(blended.AtChecked<uint8_t>(row, col, ch), expected);
+          EXPECT_EQ(blended_view.AtChecked<uint8_t>(
+                      rgb.Height() - 1 - row, col, ch), expected);
+        }
+      }
+    }
+  }
+
+  // Alpha compositing
+  for (const auto &image : {rgb, rgba, rgba.FlipView(true, true)}) {
+    const viren2d::ImageBuffer &over = (image.IsContiguous())
+        ? overlay : overlay.FlipView(true, true);
+    const viren2d::ImageBuffer composite = image.AlphaComposite(over);
+    ASSERT_EQ(composite.Channels(), image.Channels());
+    for (int row = 0; row < image.Height(); ++row) {
+      for (int col = 0; col < image.Width(); ++col) {
+        const int alpha = over.AtChecked<uint8_t>(row, col, 3);
+        const int weight = alpha + (alpha >> 7);
+        for (int ch = 0; ch < 3; ++ch) {
+          const int value = image.AtChecked<uint8_t>(row, col, ch);
+          const int expected = (value * (256 - weight)
+              + over.AtChecked<uint8_t>(row, col, ch) * weight + 128) >> 8;
+          EXPECT_EQ(composite.AtChecked<uint8_t>(row, col, ch), expected);
+        }
+        if (image.Channels() == 4) {
+          const int expected = alpha
+              + ((image.AtChecked<uint8_t>(row, col, 3) * (256 - weight)
+                  + 128) >> 8);
+          EXPECT_EQ(composite.AtChecked<uint8_t>(row, col, 3), expected);
+        }
+      }
+    }
+  }
+  // Fully transparent and opaque overlays
+  const viren2d::ImageBuffer composite = rgba.AlphaComposite(overlay);
+  for (int row = 0; row < rgba.Height(); ++row) {
+    for (int ch = 0; ch < 4; ++ch) {
+      EXPECT_EQ(composite.AtChecked<uint8_t>(row, 0, ch),
+                rgba.AtChecked<uint8_t>(row, 0, ch));
+      EXPECT_EQ(composite.AtChecked<uint8_t>(row, 1, ch),
+                overlay.AtChecked<uint8_t>(row, 1, ch));
+    }
+  }
+
+  // In-place & into overloads
+  viren2d::ImageBuffer inplace = rgb.DeepCopy();
+  inplace.AlphaCompositeInPlace(overlay);
+  const viren2d::ImageBuffer expected = rgb.AlphaComposite(overlay);
+  viren2d::ImageBuffer into(rgb.Height(), rgb.Width(), 3,
+                            viren2d::ImageBufferType::UInt8);
+  const unsigned char *ptr = into.ImmutableData();
+  rgb.AlphaComposite(&into, overlay);
+  EXPECT_EQ(into.ImmutableData(), ptr);
+  for (int ch = 0; ch < 3; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(inplace, ch, expected, ch));
+    EXPECT_TRUE(CheckChannelEquals(into, ch, expected, ch));
+  }
+
+  // Floating point compositing
+  const viren2d::ImageBuffer rgba_float =
+      rgba.AsType(viren2d::ImageBufferType::Float);
+  viren2d::ImageBuffer overlay_float =
+      overlay.AsType(viren2d::ImageBufferType::Float);
+  for (int row = 0; row < overlay.Height(); ++row) {
+    for (int col = 0; col < overlay.Width(); ++col) {
+      overlay_float.AtChecked<float>(row, col, 3) /= 255.0f;
+    }
+  }
+  const viren2d::ImageBuffer composite_float =
+      rgba_float.AlphaComposite(overlay_float);
+  const viren2d::ImageBuffer composite_double =
+      rgba_float.AsType(viren2d::ImageBufferType::Double).AlphaComposite(
+        overlay_float.AsType(viren2d::ImageBufferType::Double));
+  for (int row = 0; row < rgba.Height(); ++row) {
+    for (int col = 0; col < rgba.Width(); ++col) {
+      const double alpha = overlay_float.AtChecked<float>(row, col, 3);
+      for (int ch = 0; ch < 3; ++ch) {
+        const double value = (1.0 - alpha) * rgba.AtChecked<uint8_t>(row, col, ch)
+            + alpha * overlay.AtChecked<uint8_t>(row, col, ch);
+        EXPECT_NEAR(composite_float.AtChecked<float>(row, col, ch), value, 1e-3);
+        EXPECT_NEAR(composite_double.AtChecked<double>(row, col, ch), value, 1e-3);
+        // Fixed-point results deviate by at most 1
+        EXPECT_LE(std::abs(composite.AtChecked<uint8_t>(row, col, ch) - value), 1.0);
+      }
+      EXPECT_NEAR(
+            composite_float.AtChecked<float>(row, col, 3),
+            alpha + rgba_float.AtChecked<float>(row, col, 3) * (1.0 - alpha),
+            1e-3);
+    }
+  }
+
+  // Invalid inputs
+  EXPECT_THROW(rgb.AlphaComposite(overlay_rgb), std::invalid_argument);
+  EXPECT_THROW(rgba.ChannelView(0, 2).AlphaComposite(overlay), std::invalid_argument);
+  EXPECT_THROW(rgb.AlphaComposite(overlay.ROI(0, 0, 10, 10)), std::logic_error);
+  EXPECT_THROW(rgb.AlphaComposite(overlay_float), std::logic_error);
+  EXPECT_THROW(
+        rgba.AsType(viren2d::ImageBufferType::Int16).AlphaComposite(
+          overlay.AsType(viren2d::ImageBufferType::Int16)),
+        std::invalid_argument);
+  EXPECT_THROW(rgb.AlphaComposite(viren2d::ImageBuffer()), std::logic_error);
+}
+
+
+TEST(ImageBufferTest, HalfPrecision) {
+  using viren2d::ImageBufferType;
+  EXPECT_EQ(2, viren2d::ElementSizeFromImageBufferType(ImageBufferType::Float16));
+  EXPECT_EQ(2, viren2d::ElementSizeFromImageBufferType(ImageBufferType::BFloat16));
+  EXPECT_EQ(ImageBufferType::Float16,
+            viren2d::ImageBufferTypeFromString(
+              viren2d::ImageBufferTypeToString(ImageBufferType::Float16)));
+  EXPECT_EQ(ImageBufferType::BFloat16,
+            viren2d::ImageBufferTypeFromString(
+              viren2d::ImageBufferTypeToString(ImageBufferType::BFloat16)));
+
+  // Scalar conversions, including rounding to nearest even, overflow
+  // and subnormals
+  EXPECT_EQ(viren2d::float16_t(1.0f).bits, 0x3C00);
+  EXPECT_EQ(viren2d::float16_t(-2.0f).bits, 0xC000);
+  EXPECT_EQ(viren2d::float16_t(65504.0f).bits, 0x7BFF);
+  EXPECT_EQ(viren2d::float16_t(65520.0f).bits, 0x7C00);
+  EXPECT_EQ(viren2d::float16_t(1.0f + 1.0f / 2048.0f).bits, 0x3C00);
+  EXPECT_EQ(viren2d::float16_t(1.0f + 3.0f / 2048.0f).bits, 0x3C02);
+  EXPECT_EQ(viren2d::float16_t(std::ldexp(1.0f, -24)).bits, 0x0001);
+  EXPECT_EQ(viren2d::float16_t(std::ldexp(1.0f, -25)).bits, 0x0000);
+  EXPECT_TRUE(std::isnan(static_cast<float>(
+      viren2d::float16_t(std::numeric_limits<float>::quiet_NaN()))));
+  EXPECT_FLOAT_EQ(static_cast<float>(viren2d::float16_t::FromBits(0x0001)),
+                  std::ldexp(1.0f, -24));
+  EXPECT_EQ(viren2d::bfloat16_t(1.0f).bits, 0x3F80);
+  EXPECT_EQ(viren2d::bfloat16_t(viren2d::BitsToFloat(0x3F808000u)).bits, 0x3F80);
+  EXPECT_EQ(viren2d::bfloat16_t(viren2d::BitsToFloat(0x3F818000u)).bits, 0x3F82);
+  EXPECT_FLOAT_EQ(static_cast<float>(
+      std::numeric_limits<viren2d::float16_t>::max()), 65504.0f);
+  using half_limits = std::numeric_limits<viren2d::float16_t>;
+  using bfloat_limits = std::numeric_limits<viren2d::bfloat16_t>;
+  EXPECT_EQ(static_cast<float>(half_limits::denorm_min()),
+            std::ldexp(1.0f, -24));
+  EXPECT_EQ(static_cast<float>(half_limits::epsilon()), std::ldexp(1.0f, -10));
+  EXPECT_EQ(static_cast<float>(half_limits::round_error()), 0.5f);
+  EXPECT_TRUE(std::isnan(static_cast<float>(half_limits::signaling_NaN())));
+  EXPECT_EQ(half_limits::digits10, 3);
+  EXPECT_EQ(half_limits::max_exponent10, 4);
+  EXPECT_TRUE(half_limits::is_iec559);
+  EXPECT_EQ(half_limits::round_style, std::round_to_nearest);
+  EXPECT_EQ(static_cast<float>(bfloat_limits::denorm_min()),
+            std::ldexp(1.0f, -133));
+  EXPECT_EQ(static_cast<float>(bfloat_limits::min()),
+            std::numeric_limits<float>::min());
+  EXPECT_EQ(static_cast<float>(bfloat_limits::epsilon()),
+            std::ldexp(1.0f, -7));
+  EXPECT_EQ(static_cast<float>(bfloat_limits::round_error()), 0.5f);
+  EXPECT_TRUE(std::isnan(static_cast<float>(bfloat_limits::signaling_NaN())));
+  EXPECT_EQ(bfloat_limits::radix, 2);
+  EXPECT_EQ(bfloat_limits::min_exponent,
+            std::numeric_limits<float>::min_exponent);
+  EXPECT_EQ(bfloat_limits::max_exponent,
+            std::numeric_limits<float>::max_exponent);
+  EXPECT_EQ(bfloat_limits::has_denorm, std::denorm_present);
+
+  // Round trip via the (vectorized) buffer conversions
+  viren2d::ImageBuffer values(17, 23, 3, ImageBufferType::Float);
+  for (int row = 0; row < values.Height(); ++row) {
+    for (int col = 0; col < values.Width(); ++col) {
+      for (int ch = 0; ch < 3; ++ch) {
+        values.AtUnchecked<float>(row, col, ch) =
+            (row - 8) * 0.25f + col * 0.125f + ch * 100.0f;
+      }
+    }
+  }
+  values.AtUnchecked<float>(3, 5, 1) = -1000.0f;
+  values.AtUnchecked<float>(11, 2, 1) = 1000.0f;
+
+  for (auto type : {ImageBufferType::Float16, ImageBufferType::BFloat16}) {
+    SCOPED_TRACE(viren2d::ImageBufferTypeToString(type));
+    const viren2d::ImageBuffer half = values.AsType(type);
+    EXPECT_EQ(half.BufferType(), type);
+    EXPECT_EQ(half.ElementSize(), 2);
+    EXPECT_EQ(half.Channels(), 3);
+
+    // All values are exactly representable, except for the
+    // 1/8 steps of bfloat16 beyond 16.
+    const double tolerance = (type == ImageBufferType::Float16) ? 0.0 : 2.0;
+    const viren2d::ImageBuffer restored = half.ToFloat();
+    const viren2d::ImageBuffer as_double = half.AsType(ImageBufferType::Double);
+    const viren2d::ImageBuffer roi = half.ROIView(2, 1, 13, 9).ToFloat();
+    for (int row = 0; row < values.Height(); ++row) {
+      for (int col = 0; col < values.Width(); ++col) {
+        for (int ch = 0; ch < 3; ++ch) {
+          const float expected = values.AtUnchecked<float>(row, col, ch);
+          EXPECT_NEAR(restored.AtChecked<float>(row, col, ch), expected, tolerance);
+          EXPECT_DOUBLE_EQ(as_double.AtChecked<double>(row, col, ch),
+                           restored.AtChecked<float>(row, col, ch));
+          if ((row >= 1) && (row < 10) && (col >= 2) && (col < 15)) {
+            EXPECT_FLOAT_EQ(roi.AtChecked<float>(row - 1, col - 2, ch),
+                            restored.AtChecked<float>(row, col, ch));
+          }
+        }
+      }
+    }
+
+    double minval, maxval;
+    viren2d::Vec2i minloc, maxloc;
+    half.MinMaxLocation(&minval, &maxval, &minloc, &maxloc, 1);
+    EXPECT_DOUBLE_EQ(minval, -1000.0);
+    EXPECT_DOUBLE_EQ(maxval, 1000.0);
+    EXPECT_EQ(minloc, viren2d::Vec2i(5, 3));
+    EXPECT_EQ(maxloc, viren2d::Vec2i(2, 11));
+
+    // Type-agnostic operations
+    viren2d::ImageBuffer swapped = half.DeepCopy();
+    swapped.SwapChannels(0, 2);
+    EXPECT_TRUE(CheckChannelEquals(swapped, 0, half, 2));
+    EXPECT_TRUE(CheckChannelEquals(swapped, 2, half, 0));
+    EXPECT_EQ(half.Channel(1).BufferType(), type);
+    EXPECT_EQ(half.ToChannels(4).BufferType(), type);
+    EXPECT_EQ(half.Resize(11, 8).BufferType(), type);
+
+    // Conversion to uint8 expects [0, 1]
+    const viren2d::ImageBuffer unit = values.ROI(0, 0, 3, 2).AsType(type, 1.0 / 400.0);
+    const viren2d::ImageBuffer u8 = unit.ToUInt8(4);
+    EXPECT_EQ(u8.AtChecked<uint8_t>(0, 0, 0), 0);
+    EXPECT_EQ(u8.AtChecked<uint8_t>(0, 0, 3), 255);
+    EXPECT_EQ(u8.AtChecked<uint8_t>(1, 2, 2), static_cast<uint8_t>(
+        unit.ToFloat().AtChecked<float>(1, 2, 2) * 255.0f));
+
+    // Arithmetic operations require single precision
+    EXPECT_THROW(half.Dim(0.5), std::invalid_argument);
+    EXPECT_THROW(half.Blend(half, 0.5), std::invalid_argument);
+    EXPECT_THROW(half.Statistics(), std::invalid_argument);
+    EXPECT_THROW(half.AtChecked<float>(0, 0, 0), std::logic_error);
+  }
+
+  // Half precision views may not be packed
+  const viren2d::ImageBuffer half = values.AsType(ImageBufferType::Float16);
+  const viren2d::ImageBuffer channel = half.ChannelView(1, 1).ToFloat();
+  for (int row = 0; row < half.Height(); ++row) {
+    for (int col = 0; col < half.Width(); ++col) {
+      EXPECT_FLOAT_EQ(channel.AtChecked<float>(row, col, 0),
+                      values.AtUnchecked<float>(row, col, 1));
+    }
+  }
+}
+
+
+TEST(ImageBufferTest, PlanarAndBatch) {
+  using viren2d::ImageBufferType;
+  using viren2d::ImageLayout;
+
+  EXPECT_EQ(viren2d::ImageLayoutFromString("CHW"), ImageLayout::Planar);
+  EXPECT_EQ(viren2d::ImageLayoutFromString("nhwc"), ImageLayout::Interleaved);
+  EXPECT_THROW(viren2d::ImageLayoutFromString("hcw"), std::invalid_argument);
+
+  // Planar (C x H x W) data can be used like any interleaved buffer:
+  const int height = 5, width = 7, channels = 3;
+  std::vector<float> chw(height * width * channels);
+  viren2d::ImageBuffer interleaved(height, width, channels, ImageBufferType::Float);
+  for (int ch = 0; ch < channels; ++ch) {
+    for (int row = 0; row < height; ++row) {
+      for (int col = 0; col < width; ++col) {
+        const float value = (ch * 100.0f + row * width + col) / 400.0f;
+        chw[(ch * height + row) * width + col] = value;
+        interleaved.AtUnchecked<float>(row, col, ch) = value;
+      }
+    }
+  }
+
+  viren2d::ImageBuffer planar;
+  planar.CreateSharedBuffer(
+        reinterpret_cast<unsigned char *>(chw.data()), height, width, channels,
+        ImageBufferType::Float, ImageLayout::Planar);
+  EXPECT_EQ(planar.Layout(), ImageLayout::Planar);
+  EXPECT_EQ(interleaved.Layout(), ImageLayout::Interleaved);
+  EXPECT_FALSE(planar.OwnsData());
+  EXPECT_EQ(planar.ChannelStride(),
+            static_cast<int64_t>(height * width * sizeof(float)));
+  for (int ch = 0; ch < channels; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(planar, ch, interleaved, ch));
+  }
+  EXPECT_TRUE(CheckChannelEquals(
+                planar.ChannelView(2), 0, interleaved, 2));
+  const viren2d::ImageBuffer u8_planar = planar.ToUInt8(4);
+  const viren2d::ImageBuffer u8_interleaved = interleaved.ToUInt8(4);
+  for (int ch = 0; ch < 4; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(u8_planar, ch, u8_interleaved, ch));
+  }
+  chw[0] = 1.0f;
+  EXPECT_FLOAT_EQ(planar.AtChecked<float>(0, 0, 0), 1.0f);
+
+  // Owning planar buffers must copy all planes upon detaching:
+  viren2d::ImageBuffer owning(height, width, channels,
+                              ImageBufferType::Float, ImageLayout::Planar);
+  EXPECT_TRUE(owning.OwnsData());
+  EXPECT_EQ(owning.Layout(), ImageLayout::Planar);
+  for (int ch = 0; ch < channels; ++ch) {
+    for (int row = 0; row < height; ++row) {
+      for (int col = 0; col < width; ++col) {
+        owning.AtUnchecked<float>(row, col, ch) = planar.AtUnchecked<float>(
+            row, col, ch);
+      }
+    }
+  }
+  viren2d::ImageBuffer detached(owning);
+  detached.AtUnchecked<float>(0, 0, 0) = -1.0f;
+  EXPECT_EQ(detached.Layout(), ImageLayout::Planar);
+  EXPECT_FLOAT_EQ(owning.AtChecked<float>(0, 0, 0), 1.0f);
+  for (int ch = 1; ch < channels; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(detached, ch, planar, ch));
+  }
+
+  // Batches of both layouts:
+  for (const ImageLayout layout : {ImageLayout::Interleaved, ImageLayout::Planar}) {
+    viren2d::ImageBatch batch(4, height, width, channels,
+                              ImageBufferType::UInt8, layout);
+    EXPECT_TRUE(batch.IsValid());
+    EXPECT_TRUE(batch.OwnsData());
+    EXPECT_EQ(batch.NumFrames(), 4);
+    EXPECT_EQ(batch.Layout(), layout);
+    EXPECT_EQ(batch.FrameStride(), height * width * channels);
+
+    for (int idx = 0; idx < batch.NumFrames(); ++idx) {
+      viren2d::ImageBuffer frame = batch.Frame(idx);
+      EXPECT_FALSE(frame.IsReadOnly());
+      EXPECT_EQ(frame.Layout(), layout);
+      frame.SetToScalar<unsigned char>(static_cast<unsigned char>(10 * idx));
+    }
+
+    viren2d::ImageBuffer view;
+    {
+      viren2d::ImageBatch copy(batch);
+      view = copy.FrameView(3);
+    }
+    EXPECT_TRUE(view.IsReadOnly());
+    for (int ch = 0; ch < channels; ++ch) {
+      EXPECT_TRUE(CheckChannelConstant(view, ch, static_cast<unsigned char>(30)));
+      EXPECT_TRUE(CheckChannelConstant(
+                    batch.FrameView(1), ch, static_cast<unsigned char>(10)));
+    }
+    EXPECT_EQ(batch.FrameView(2).ImmutableData(),
+              batch.FrameView(0).ImmutableData() + 2 * batch.FrameStride());
+
+    EXPECT_THROW(batch.Frame(4), std::out_of_range);
+    EXPECT_THROW(batch.FrameView(-1), std::out_of_range);
+  }
+
+  // Shared batches reference external memory:
+  std::vector<float> nchw(2 * chw.size());
+  std::copy(chw.begin(), chw.end(), nchw.begin() + chw.size());
+  viren2d::ImageBatch shared;
+  EXPECT_FALSE(shared.IsValid());
+  shared.CreateSharedBatch(
+        reinterpret_cast<unsigned char *>(nchw.data()), 2, height, width,
+        channels, ImageBufferType::Float, ImageLayout::Planar);
+  EXPECT_FALSE(shared.OwnsData());
+  for (int ch = 0; ch < channels; ++ch) {
+    EXPECT_TRUE(CheckChannelEquals(shared.FrameView(1), ch, planar, ch));
+    EXPECT_TRUE(CheckChannelConstant(shared.FrameView(0), ch, 0.0f));
+  }
+
+  EXPECT_THROW(viren2d::ImageBatch(0, 2, 2, 1, ImageBufferType::UInt8),
+               std::invalid_argument);
+  // The total number of rows (N*H, or N*C*H for planar batches) would
+  // overflow an int.
+  EXPECT_THROW(viren2d::ImageBatch(1 << 16, 1 << 15, 1, 1,
+                                   ImageBufferType::UInt8),
+               std::invalid_argument);
+  EXPECT_THROW(viren2d::ImageBatch(1 << 12, 1 << 12, 1, 1 << 8,
+                                   ImageBufferType::UInt8, ImageLayout::Planar),
+               std::invalid_argument);
+  EXPECT_THROW(shared.CreateSharedBatch(
+                 nullptr, 1, 2, 2, 1, ImageBufferType::UInt8,
+                 ImageLayout::Interleaved),
+               std::invalid_argument);
+}
+
+
+TEST(ImageBufferTest, StridedCopy) {
+  using viren2d::helpers::StridedCopyKind;
+  using viren2d::helpers::SelectStridedCopy;
+
+  // Source memory, large enough for all strides below:
+  const int height = 37, width = 45;
+  std::vector<unsigned char> memory(height * width * 4 * 8 * 2);
+  for (std::size_t idx = 0; idx < memory.size(); ++idx) {
+    memory[idx] = static_cast<unsigned char>((idx * 31 + 7) % 251);
+  }
+
+  struct CopyCase {
+    StridedCopyKind expected;
+    int height, width, channels, element_size;
+    int64_t row_stride, pixel_stride, channel_stride, offset;
+  };
+
+  std::vector<CopyCase> cases;
+  for (int es : {1, 2, 4, 8}) {
+    for (int ch : {1, 2, 3, 4}) {
+      const int64_t px = ch * es;
+      // Row padding & vertical flip
+      cases.push_back({StridedCopyKind::Contiguous, height, width, ch, es,
+                       width * px, px, es, 0});
+      cases.push_back({StridedCopyKind::PackedRows, height, width, ch, es,
+                       width * px + 8, px, es, 0});
+      cases.push_back({StridedCopyKind::PackedRows, height, width, ch, es,
+                       -width * px, px, es, (height - 1) * width * px});
+      // Horizontal flip, column slice & channel gap
+      cases.push_back({StridedCopyKind::PackedPixels, height, width, ch, es,
+                       width * px, -px, es, (width - 1) * px});
+      cases.push_back({StridedCopyKind::PackedPixels, height, width / 2, ch, es,
+                       width * px, 2 * px, es, 0});
+      cases.push_back({StridedCopyKind::PackedPixels, height, width, ch, es,
+                       width * (px + es), px + es, es, 0});
+      // Transposed, incl. planar to interleaved
+      cases.push_back({StridedCopyKind::Transposed, width, height, ch, es,
+                       px, height * px, es, 0});
+      if (ch > 1) {
+        cases.push_back({StridedCopyKind::Transposed, width, height, ch, es,
+                         es, height * es, height * width * es, 0});
+        // Reversed channels, e.g. numpy's `[..., ::-1]`
+        cases.push_back({StridedCopyKind::ReversedChannels, height, width, ch, es,
+                         width * px, px, -es, (ch - 1) * es});
+        cases.push_back({StridedCopyKind::ReversedChannels, height, width, ch, es,
+                         -width * px, -px, -es,
+                         (height * width - 1) * px + (ch - 1) * es});
+        // Planar
+        cases.push_back({StridedCopyKind::Generic, height, width, ch, es,
+                         width * es, es, height * width * es, 0});
+      }
+    }
+  }
+  // Single rows/columns
+  cases.push_back({StridedCopyKind::Contiguous, 1, width, 3, 1, 1, 3, 1, 0});
+  cases.push_back({StridedCopyKind::PackedRows, height, 1, 3, 1, 7, 100, 1, 0});
+
+  for (const CopyCase &c : cases) {
+    std::ostringstream msg;
+    msg << c.height << "x" << c.width << "x" << c.channels << " (" << c.element_size
+        << " bytes), strides " << c.row_stride << "/" << c.pixel_stride << "/"
+        << c.channel_stride;
+    SCOPED_TRACE(msg.str());
+    EXPECT_EQ(SelectStridedCopy(
+                c.height, c.width, c.channels, c.row_stride, c.pixel_stride,
+                c.channel_stride, c.element_size), c.expected);
+
+    const viren2d::ImageBufferType type = (c.element_size == 1)
+        ? viren2d::ImageBufferType::UInt8
+        : ((c.element_size == 2) ? viren2d::ImageBufferType::Int16
+        : ((c.element_size == 4) ? viren2d::ImageBufferType::Float
+        : viren2d::ImageBufferType::Double));
+    const unsigned char *src = memory.data() + c.offset;
+    viren2d::ImageBuffer copy;
+    copy.CreateCopiedBuffer(
+          src, c.height, c.width, c.channels, c.row_stride,
+          c.pixel_stride, c.channel_stride, type);
+    ASSERT_TRUE(copy.IsValid());
+    EXPECT_EQ(copy.RowStride(), c.width * c.channels * c.element_size);
+
+    bool equal = true;
+    for (int row = 0; row < c.height; ++row) {
+      for (int col = 0; col < c.width; ++col) {
+        for (int ch = 0; ch < c.channels; ++ch) {
+          equal &= (std::memcmp(
+                copy.ImmutablePtr<unsigned char>(row, col, ch),
+                src + row * c.row_stride + col * c.pixel_stride
+                  + ch * c.channel_stride,
+                c.element_size) == 0);
+        }
+      }
+    }
+    EXPECT_TRUE(equal);
+  }
+}
+
+
+TEST(ImageBufferTest, OwnershipTransfer) {
+  using viren2d::ImageBufferType;
+
+  // Hand over memory with a custom deleter, e.g. of a memory pool:
+  int num_released = 0;
+  const int height = 6, width = 5, channels = 3;
+  unsigned char *memory = new unsigned char[height * width * channels];
+  for (int idx = 0; idx < height * width * channels; ++idx) {
+    memory[idx] = static_cast<unsigned char>(idx);
+  }
+  {
+    // View the memory upside down to check that detaching
+    // supports arbitrary strides.
+    viren2d::ImageBuffer flipped;
+    flipped.CreateSharedBuffer(
+          memory + (height - 1) * width * channels, height, width, channels,
+          -width * channels, channels, 1, ImageBufferType::UInt8);
+    EXPECT_FALSE(flipped.OwnsData());
+    // The deleter receives the data pointer, i.e. the last row
+    flipped.TakeOwnership([memory, &num_released](unsigned char *ptr) {
+      EXPECT_EQ(ptr, memory + (height - 1) * width * channels);
+      delete[] memory;
+      ++num_released;
+    });
+    EXPECT_TRUE(flipped.OwnsData());
+    EXPECT_EQ(flipped.ImmutableData(), memory + (height - 1) * width * channels);
+    EXPECT_THROW(flipped.TakeOwnership(
+                   [](unsigned char *) {}), std::logic_error);
+    EXPECT_NO_THROW(flipped.TakeOwnership());
+
+    viren2d::ImageBuffer copy(flipped);
+    const viren2d::ImageBuffer view = flipped.ROIView(1, 1, 3, 3);
+    EXPECT_TRUE(copy.IsStorageShared());
+    copy.AtUnchecked<unsigned char>(0, 0, 0) = 255;
+    EXPECT_EQ(copy.RowStride(), flipped.RowStride());
+    EXPECT_EQ(num_released, 0);
+    for (int row = 0; row < height; ++row) {
+      for (int col = 0; col < width; ++col) {
+        for (int ch = 0; ch < channels; ++ch) {
+          const unsigned char expected = static_cast<unsigned char>(
+                ((height - 1 - row) * width + col) * channels + ch);
+          EXPECT_EQ(flipped.AtChecked<unsigned char>(row, col, ch), expected);
+          if (row || col || ch) {
+            EXPECT_EQ(copy.AtChecked<unsigned char>(row, col, ch), expected);
+          }
+        }
+      }
+    }
+    EXPECT_EQ(copy.AtChecked<unsigned char>(0, 0, 0), 255);
+
+    // Views keep the transferred memory alive
+    flipped = viren2d::ImageBuffer();
+    EXPECT_EQ(num_released, 0);
+    EXPECT_EQ(view.AtChecked<unsigned char>(0, 0, 0), static_cast<unsigned char>(
+                ((height - 2) * width + 1) * channels));
+  }
+  EXPECT_EQ(num_released, 1);
+
+  // Invalid hand-overs
+  viren2d::ImageBuffer invalid;
+  EXPECT_THROW(invalid.TakeOwnership([](unsigned char *) {}), std::logic_error);
+  viren2d::ImageBuffer owning(2, 2, 1, ImageBufferType::UInt8);
+  EXPECT_THROW(owning.TakeOwnership([](unsigned char *) {}), std::logic_error);
+  std::vector<unsigned char> external(4, 0);
+  viren2d::ImageBuffer shared;
+  shared.CreateSharedBuffer(external.data(), 2, 2, 1, 2, 1, ImageBufferType::UInt8);
+  EXPECT_THROW(shared.TakeOwnership(viren2d::ImageBufferDeleter()),
+               std::invalid_argument);
+  EXPECT_FALSE(shared.OwnsData());
+
+  // Shared memory which is kept alive by a handle, e.g. a python array
+  {
+    std::shared_ptr<void> owner(
+          new std::vector<unsigned char>(external),
+          [&num_released](void *ptr) {
+      delete static_cast<std::vector<unsigned char> *>(ptr);
+      ++num_released;
+    });
+    unsigned char *data =
+        static_cast<std::vector<unsigned char> *>(owner.get())->data();
+    viren2d::ImageBuffer handled;
+    handled.CreateSharedBuffer(
+          data, 2, 2, 1, 2, 1, 1, ImageBufferType::UInt8, std::move(owner));
+    EXPECT_FALSE(handled.OwnsData());
+    EXPECT_THROW(handled.TakeOwnership(), std::logic_error);
+
+    viren2d::ImageBuffer copy(handled);
+    handled = viren2d::ImageBuffer();
+    EXPECT_EQ(num_released, 1);
+
+    // Shared memory is modified in-place, i.e. without detaching
+    copy.AtUnchecked<unsigned char>(1, 1, 0) = 42;
+    EXPECT_EQ(copy.ImmutableData(), data);
+    EXPECT_EQ(data[3], 42);
+  }
+  EXPECT_EQ(num_released, 2);
+}
+
+
+TEST(ImageBufferTest, SaturatingCasts) {
+  using viren2d::ImageBufferType;
+
+  // 16-bit inputs (e.g. depth) with values outside of [0, 255]. The
+  // row length is odd to exercise the scalar tails of the kernels.
+  viren2d::ImageBuffer i16(7, 13, 3, ImageBufferType::Int16);
+  viren2d::ImageBuffer u16(7, 13, 1, ImageBufferType::UInt16);
+  viren2d::ImageBuffer i32(7, 13, 1, ImageBufferType::Int32);
+  for (int row = 0; row < i16.Height(); ++row) {
+    for (int col = 0; col < i16.Width(); ++col) {
+      for (int ch = 0; ch < i16.Channels(); ++ch) {
+        i16.AtChecked<int16_t>(row, col, ch) = static_cast<int16_t>(
+              -400 + row * 150 + col * 7 + ch);
+      }
+      u16.AtChecked<uint16_t>(row, col, 0) = static_cast<uint16_t>(
+            row * 9000 + col * 11);
+      i32.AtChecked<int32_t>(row, col, 0) = (row - 3) * 100000 + col * 20;
+    }
+  }
+
+  for (const auto &src : {i16, i16.ROIView(1, 2, 10, 4), i16.ChannelView(1)}) {
+    SCOPED_TRACE(src.ToString());
+    const viren2d::ImageBuffer u8 = src.ToUInt8(src.Channels());
+    const viren2d::ImageBuffer u8_rgb = src.ToUInt8(3);
+    const viren2d::ImageBuffer flt = src.ToFloat();
+    const viren2d::ImageBuffer flt_as = src.AsType(ImageBufferType::Float);
+    const viren2d::ImageBuffer sat = src.AsType(
+          ImageBufferType::UInt8, 1.0, true);
+    for (int row = 0; row < src.Height(); ++row) {
+      for (int col = 0; col < src.Width(); ++col) {
+        for (int ch = 0; ch < src.Channels(); ++ch) {
+          const int16_t value = src.AtChecked<int16_t>(row, col, ch);
+          const int expected = std::min(255, std::max(0, static_cast<int>(value)));
+          EXPECT_EQ(u8.AtChecked<uint8_t>(row, col, ch), expected);
+          EXPECT_EQ(u8_rgb.AtChecked<uint8_t>(row, col, ch), expected);
+          EXPECT_EQ(sat.AtChecked<uint8_t>(row, col, ch), expected);
+          EXPECT_EQ(flt.AtChecked<float>(row, col, ch),
+                    static_cast<float>(value) * (1.0f / 255.0f));
+          EXPECT_EQ(flt_as.AtChecked<float>(row, col, ch),
+                    static_cast<float>(value));
+        }
+      }
+    }
+  }
+
+  const viren2d::ImageBuffer u16_u8 = u16.ToUInt8(1);
+  const viren2d::ImageBuffer u16_flt = u16.ToFloat();
+  const viren2d::ImageBuffer i32_u8 = i32.AsType(ImageBufferType::UInt8, 1.0, true);
+  const viren2d::ImageBuffer i32_flt = i32.AsType(ImageBufferType::Float);
+  const viren2d::ImageBuffer i32_i16 = i32.AsType(ImageBufferType::Int16, 1.0, true);
+  for (int row = 0; row < u16.Height(); ++row) {
+    for (int col = 0; col < u16.Width(); ++col) {
+      const uint16_t depth = u16.AtChecked<uint16_t>(row, col, 0);
+      EXPECT_EQ(u16_u8.AtChecked<uint8_t>(row, col, 0), std::min(255, static_cast<int>(depth)));
+      EXPECT_EQ(u16_flt.AtChecked<float>(row, col, 0),
+                static_cast<float>(depth) * (1.0f / 255.0f));
+
+      const int32_t value = i32.AtChecked<int32_t>(row, col, 0);
+      EXPECT_EQ(i32_u8.AtChecked<uint8_t>(row, col, 0), std::min(255, std::max(0, value)));
+      EXPECT_EQ(i32_flt.AtChecked<float>(row, col, 0), static_cast<float>(value));
+      EXPECT_EQ(i32_i16.AtChecked<int16_t>(row, col, 0),
+                std::min(32767, std::max(-32768, value)));
+    }
+  }
+
+  // Floating point values (e.g. network outputs) are scaled by 255,
+  // saturated and NaN becomes 0.
+  const std::vector<double> values{
+    std::numeric_limits<double>::quiet_NaN(), -0.5, -0.0, 0.0, 0.5, 0.999,
+    1.0, 1.5, std::numeric_limits<double>::infinity(),
+    -std::numeric_limits<double>::infinity(), 0.25, 1e10, -1e10,
+    0.1, 0.2, 0.3, 0.4, 0.6, 0.7};
+  const std::vector<int> expected_u8{
+    0, 0, 0, 0, 127, 254, 255, 255, 255, 0, 63, 255, 0, 25, 51, 76, 102, 153, 178};
+  viren2d::ImageBuffer dbl(1, static_cast<int>(values.size()), 1, ImageBufferType::Double);
+  for (std::size_t idx = 0; idx < values.size(); ++idx) {
+    dbl.AtChecked<double>(0, static_cast<int>(idx), 0) = values[idx];
+  }
+  const viren2d::ImageBuffer flt = dbl.AsType(ImageBufferType::Float);
+  for (const auto &src : {dbl, flt}) {
+    SCOPED_TRACE(src.ToString());
+    const viren2d::ImageBuffer u8 = src.ToUInt8(1);
+    const viren2d::ImageBuffer u8_rgba = src.ToUInt8(4);
+    const viren2d::ImageBuffer sat = src.AsType(ImageBufferType::UInt8, 255.0, true);
+    const viren2d::ImageBuffer sat_unscaled = src.AsType(
+          ImageBufferType::UInt8, 1.0, true);
+    const viren2d::ImageBuffer sat_i16 = src.AsType(
+          ImageBufferType::Int16, 1e5, true);
+    for (int col = 0; col < src.Width(); ++col) {
+      EXPECT_EQ(u8.AtChecked<uint8_t>(0, col, 0), expected_u8[col]) << "col " << col;
+      EXPECT_EQ(u8_rgba.AtChecked<uint8_t>(0, col, 0), expected_u8[col]) << "col " << col;
+      EXPECT_EQ(sat.AtChecked<uint8_t>(0, col, 0), expected_u8[col]) << "col " << col;
+
+      const double value = values[col];
+      EXPECT_EQ(sat_unscaled.AtChecked<uint8_t>(0, col, 0),
+                std::isnan(value) ? 0 : static_cast<int>(std::min(255.0, std::max(0.0, value))));
+      if (std::isnan(value)) {
+        EXPECT_EQ(sat_i16.AtChecked<int16_t>(0, col, 0), 0);
+      } else if (std::abs(value) >= 1.0) {
+        EXPECT_EQ(sat_i16.AtChecked<int16_t>(0, col, 0), (value > 0) ? 32767 : -32768);
+      }
+    }
+  }
+}
@@ -0,0 +1,154 @@
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <viren2d/imagebuffer.h>
+#include <viren2d/parallel.h>
+#include <helpers/parallel.h>
+
+
+TEST(ParallelTest, NumThreads) {
+  const int num_default = viren2d::GetNumThreads();
+  EXPECT_GE(num_default, 1);
+
+  viren2d::SetNumThreads(3);
+  EXPECT_EQ(viren2d::GetNumThreads(), 3);
+  {
+    viren2d::ScopedNumThreads scope(1);
+    EXPECT_EQ(viren2d::GetNumThreads(), 1);
+    {
+      viren2d::ScopedNumThreads nested(5);
+      EXPECT_EQ(viren2d::GetNumThreads(), 5);
+    }
+    EXPECT_EQ(viren2d::GetNumThreads(), 1);
+  }
+  EXPECT_EQ(viren2d::GetNumThreads(), 3);
+
+  viren2d::SetNumThreads(0);
+  EXPECT_EQ(viren2d::GetNumThreads(), num_default);
+}
+
+
+TEST(ParallelTest, ParallelFor) {
+  viren2d::SetNumThreads(4);
+
+  // Each item must be visited exactly once, for both small (serial)
+  // and large ranges.
+  for (int64_t num_items : {0, 1, 17, 1000, 100003}) {
+    std::vector<int> visits(num_items, 0);
+    std::atomic<int> num_chunks{0};
+    viren2d::helpers::ParallelFor(
+          0, num_items, 8, [&](int64_t begin, int64_t end) {
+      ++num_chunks;
+      for (int64_t i = begin; i < end; ++i) {
+        ++visits[i];
+      }
+    });
+    for (int64_t i = 0; i < num_items; ++i) {
+      EXPECT_EQ(visits[i], 1);
+    }
+    if (num_items < 1000) {
+      EXPECT_LE(num_chunks.load(), 1);
+    } else if (num_items > 100000) {
+      // Several chunks per thread
+      EXPECT_EQ(num_chunks.load(), 16);
+    }
+  }
+
+  // Nested loops are processed serially by the worker:
+  std::atomic<int64_t> sum{0};
+  viren2d::helpers::ParallelFor(
+        0, 100, viren2d::helpers::kParallelGrainSize,
+        [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      viren2d::helpers::ParallelFor(
+            0, 1000, viren2d::helpers::kParallelGrainSize,
+            [&](int64_t b, int64_t e) { sum += (e - b); });
+    }
+  });
+  EXPECT_EQ(sum.load(), 100000);
+
+  // Workers use the thread-local settings of the caller:
+  std::atomic<int> num_scoped{0};
+  std::atomic<int> num_calls{0};
+  {
+    viren2d::ScopedNumThreads scope(3);
+    viren2d::helpers::ParallelFor(
+          0, 12, viren2d::helpers::kParallelGrainSize,
+          [&](int64_t, int64_t) {
+      ++num_calls;
+      if (viren2d::GetNumThreads() == 3) {
+        ++num_scoped;
+      }
+    });
+  }
+  EXPECT_EQ(num_calls.load(), 12);
+  EXPECT_EQ(num_scoped.load(), 12);
+  EXPECT_EQ(viren2d::GetNumThreads(), 4);
+
+  // Exceptions are propagated to the caller:
+  EXPECT_THROW(
+        viren2d::helpers::ParallelFor(
+          0, 100000, 8, [](int64_t begin, int64_t) {
+            if (begin > 0) {
+              throw std::runtime_error("Failed chunk");
+            }
+          }),
+        std::runtime_error);
+
+  viren2d::SetNumThreads(0);
+}
+
+
+TEST(ParallelTest, ImageBufferResults) {
+  // Parallel processing must yield the same results as the serial one,
+  // for contiguous buffers, as well as for (non-flattenable) ROIs.
+  viren2d::ImageBuffer img(512, 431, 3, viren2d::ImageBufferType::UInt8);
+  for (int row = 0; row < img.Height(); ++row) {
+    for (int col = 0; col < img.Width(); ++col) {
+      for (int ch = 0; ch < 3; ++ch) {
+        img.AtUnchecked<uint8_t>(row, col, ch) =
+            static_cast<uint8_t>((row * 7 + col * 3 + ch * 50) % 256);
+      }
+    }
+  }
+
+  for (const auto &src : {img, img.ROI(3, 10, 400, 500)}) {
+    std::vector<viren2d::ImageBuffer> serial;
+    std::vector<viren2d::ImageBuffer> parallel;
+    for (int num_threads : {1, 4}) {
+      viren2d::ScopedNumThreads scope(num_threads);
+      auto &results = (num_threads == 1) ? serial : parallel;
+      results.push_back(src.ToChannels(4));
+      results.push_back(viren2d::ConvertRGB2Gray(src, 1));
+      results.push_back(src.ToFloat());
+      results.push_back(src.Dim(0.3));
+      results.push_back(src.Blend(src.Dim(0.5), 0.3));
+      results.push_back(viren2d::ConvertRGB2HSV(src));
+      results.push_back(src.ToFloat().Magnitude());
+      results.push_back(
+            src.Lazy().Scale(0.5).Blend(src.ToFloat(), 0.3)
+            .Evaluate(viren2d::ImageBufferType::Float));
+    }
+
+    for (std::size_t i = 0; i < serial.size(); ++i) {
+      ASSERT_EQ(serial[i].NumElements(), parallel[i].NumElements());
+      for (int row = 0; row < serial[i].Height(); ++row) {
+        for (int col = 0; col < serial[i].Width(); ++col) {
+          for (int ch = 0; ch < serial[i].Channels(); ++ch) {
+            if (serial[i].BufferType() == viren2d::ImageBufferType::Float) {
+              EXPECT_EQ(serial[i].AtChecked<float>(row, col, ch),
+                        parallel[i].AtChecked<float>(row, col, ch));
+            } else {
+              EXPECT_EQ(serial[i].AtChecked<uint8_t>(row, col, ch),
+                        parallel[i].AtChecked<uint8_t>(row, col, ch));
+            }
+          }
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,779 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <viren2d/imagebuffer.h>
+#include <helpers/simd_kernels.h>
+
+
+namespace simd = viren2d::helpers::simd;
+
+
+namespace {
+template <typename _Tp>
+std::vector<_Tp> RandomValues(std::size_t num) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> dist(0, 255);
+  std::vector<_Tp> values(num);
+  for (auto &v : values) {
+    v = static_cast<_Tp>(dist(rng));
+    if (std::is_floating_point<_Tp>::value) {
+      v /= static_cast<_Tp>(3);
+    }
+  }
+  return values;
+}
+
+
+/// Compares the kernels of the active instruction set against the scalar
+/// ones for various lengths (to cover the tail handling).
+template <typename _Tp>
+void CompareKernels() {
+  const auto &vectorized = simd::Kernels<_Tp>();
+  const auto &scalar = simd::KernelsScalar<_Tp>();
+
+  for (int64_t num_pixels : {0, 1, 3, 5, 7, 15, 16, 17, 31, 33, 64, 101}) {
+    const auto src = RandomValues<_Tp>(4 * num_pixels + 16);
+    std::vector<_Tp> expected(4 * num_pixels + 16, 0);
+    std::vector<_Tp> result(4 * num_pixels + 16, 0);
+
+    using Kernel = void (*)(const _Tp *, _Tp *, int64_t);
+    for (auto member : {&simd::ConversionKernels<_Tp>::rgb2rgba,
+                        &simd::ConversionKernels<_Tp>::rgba2rgb,
+                        &simd::ConversionKernels<_Tp>::gray2rgb,
+                        &simd::ConversionKernels<_Tp>::gray2rgba}) {
+      std::fill(expected.begin(), expected.end(), static_cast<_Tp>(0));
+      std::fill(result.begin(), result.end(), static_cast<_Tp>(0));
+      Kernel kernel_ref = scalar.*member;
+      Kernel kernel_vec = vectorized.*member;
+      kernel_ref(src.data(), expected.data(), num_pixels);
+      kernel_vec(src.data(), result.data(), num_pixels);
+      // Also checks that nothing has been written beyond the last pixel
+      EXPECT_EQ(expected, result) << "num_pixels = " << num_pixels;
+    }
+
+    // Blending kernels (including the in-place variants)
+    const int64_t num_elements = 3 * num_pixels + 5;
+    // Float weights, including values which must be clamped, NaN and
+    // the rounding boundaries of the fixed-point conversion
+    std::vector<float> weights(num_elements);
+    for (int64_t i = 0; i < num_elements; ++i) {
+      switch (i % 7) {
+        case 0:
+          weights[i] = std::numeric_limits<float>::quiet_NaN();
+          break;
+        case 1:
+          weights[i] = -0.5f + 0.01f * i;
+          break;
+        case 2:
+          weights[i] = 1.0f + 0.01f * i;
+          break;
+        case 3:
+          weights[i] = ((i % 256) + 0.5f) / 256.0f;
+          break;
+        case 4:
+          weights[i] = std::nextafter(((i % 256) + 0.5f) / 256.0f, 0.0f);
+          break;
+        default:
+          weights[i] = static_cast<float>((i * 37) % 257) / 256.0f;
+      }
+    }
+    const std::vector<_Tp> other(src.rbegin(), src.rend());
+    for (uint16_t weight : {0, 1, 77, 128, 255, 256}) {
+      std::fill(expected.begin(), expected.end(), static_cast<_Tp>(0));
+      result = src;
+      scalar.blend_constant(
+            src.data(), other.data(), expected.data(), num_elements, weight);
+      vectorized.blend_constant(
+            result.data(), other.data(), result.data(), num_elements, weight);
+      EXPECT_TRUE(std::equal(
+                    expected.begin(), expected.begin() + num_elements,
+                    result.begin()))
+          << "num_pixels = " << num_pixels << ", weight = " << weight;
+    }
+    std::fill(expected.begin(), expected.end(), static_cast<_Tp>(0));
+    std::fill(result.begin(), result.end(), static_cast<_Tp>(0));
+    scalar.blend_weights(
+          src.data(), other.data(), weights.data(), expected.data(),
+          num_elements, 1, 1);
+    vectorized.blend_weights(
+          src.data(), other.data(), weights.data(), result.data(),
+          num_elements, 1, 1);
+    EXPECT_EQ(expected, result) << "num_pixels = " << num_pixels;
+
+    // Per-pixel and per-element weights of multi-channel images
+    for (int channels : {3, 4}) {
+      for (int weight_channels : {1, channels}) {
+        std::fill(expected.begin(), expected.end(), static_cast<_Tp>(0));
+        std::fill(result.begin(), result.end(), static_cast<_Tp>(0));
+        const int64_t num_blended = std::min(
+              num_pixels, num_elements / weight_channels);
+        scalar.blend_weights(
+              src.data(), other.data(), weights.data(), expected.data(),
+              num_blended, channels, weight_channels);
+        vectorized.blend_weights(
+              src.data(), other.data(), weights.data(), result.data(),
+              num_blended, channels, weight_channels);
+        EXPECT_EQ(expected, result)
+            << "num_pixels = " << num_pixels << ", channels = " << channels
+            << ", weight_channels = " << weight_channels;
+      }
+    }
+
+    for (int channels : {3, 4}) {
+      // For float, the overlay alpha must be in [0, 1]
+      std::vector<_Tp> overlay(src);
+      for (std::size_t idx = 3; idx < overlay.size(); idx += 4) {
+        if (std::is_floating_point<_Tp>::value) {
+          overlay[idx] /= static_cast<_Tp>(85);
+        } else if (idx % 3 == 0) {
+          overlay[idx] = static_cast<_Tp>((idx % 2) ? 255 : 0);
+        }
+      }
+      std::fill(expected.begin(), expected.end(), static_cast<_Tp>(0));
+      result = src;
+      scalar.alpha_composite(
+            src.data(), overlay.data(), expected.data(), num_pixels, channels);
+      vectorized.alpha_composite(
+            result.data(), overlay.data(), result.data(), num_pixels, channels);
+      EXPECT_TRUE(std::equal(
+                    expected.begin(), expected.begin() + channels * num_pixels,
+                    result.begin()))
+          << "num_pixels = " << num_pixels << ", channels = " << channels;
+    }
+
+    for (int channels : {3, 4}) {
+      for (auto swap : {std::make_pair(0, 2), std::make_pair(1, 3),
+                        std::make_pair(2, 2)}) {
+        if (swap.second >= channels) {
+          continue;
+        }
+        expected = src;
+        result = src;
+        scalar.swap_channels(
+              expected.data(), num_pixels, channels, swap.first, swap.second);
+        vectorized.swap_channels(
+              result.data(), num_pixels, channels, swap.first, swap.second);
+        EXPECT_EQ(expected, result)
+            << "num_pixels = " << num_pixels << ", channels = " << channels;
+      }
+
+      for (int dst_channels = 1; dst_channels <= 4; ++dst_channels) {
+        for (bool is_bgr : {false, true}) {
+          std::fill(expected.begin(), expected.end(), static_cast<_Tp>(0));
+          std::fill(result.begin(), result.end(), static_cast<_Tp>(0));
+          scalar.rgbx2gray(
+                src.data(), expected.data(), num_pixels,
+                channels, dst_channels, is_bgr);
+          vectorized.rgbx2gray(
+                src.data(), result.data(), num_pixels,
+                channels, dst_channels, is_bgr);
+          EXPECT_EQ(expected, result)
+              << "num_pixels = " << num_pixels << ", channels = " << channels
+              << " --> " << dst_channels << ", bgr = " << is_bgr;
+        }
+      }
+
+      for (const simd::HSVRange &range : {simd::HSVRange{0, 180, 0, 255, 0, 255},
+                                          simd::HSVRange{20, 120, 30, 250, 10, 240},
+                                          simd::HSVRange{0, 0, 0, 0, 0, 255}}) {
+        for (bool is_bgr : {false, true}) {
+          std::vector<uint8_t> mask_expected(num_pixels + 16, 0);
+          std::vector<uint8_t> mask_result(num_pixels + 16, 0);
+          scalar.mask_hsv_range(
+                src.data(), mask_expected.data(), num_pixels,
+                channels, is_bgr, range);
+          vectorized.mask_hsv_range(
+                src.data(), mask_result.data(), num_pixels,
+                channels, is_bgr, range);
+          EXPECT_EQ(mask_expected, mask_result)
+              << "num_pixels = " << num_pixels << ", channels = " << channels
+              << ", bgr = " << is_bgr;
+
+          std::fill(expected.begin(), expected.end(), static_cast<_Tp>(0));
+          std::fill(result.begin(), result.end(), static_cast<_Tp>(0));
+          scalar.color_pop(
+                src.data(), expected.data(), num_pixels,
+                channels, is_bgr, range);
+          vectorized.color_pop(
+                src.data(), result.data(), num_pixels,
+                channels, is_bgr, range);
+          EXPECT_EQ(expected, result)
+              << "num_pixels = " << num_pixels << ", channels = " << channels
+              << ", bgr = " << is_bgr;
+        }
+      }
+
+      // Range tests packed into bit masks. Each word is compared, i.e.
+      // this also checks that the padding bits are 0.
+      const int64_t num_words = (num_pixels + 63) / 64;
+      for (int mask_channels : {1, channels}) {
+        for (const std::vector<_Tp> &min_max : {
+               std::vector<_Tp>{0, 255, 0, 255, 0, 255, 0, 255},
+               std::vector<_Tp>{20, 120, 30, 250, 10, 240, 0, 200},
+               std::vector<_Tp>{50, 50, 0, 255, 0, 255, 0, 255}}) {
+          std::vector<uint64_t> bits_expected(num_words + 1, 0);
+          std::vector<uint64_t> bits_result(num_words + 1, 0);
+          scalar.mask_range_bits(
+                src.data(), bits_expected.data(), num_pixels,
+                mask_channels, min_max.data());
+          vectorized.mask_range_bits(
+                src.data(), bits_result.data(), num_pixels,
+                mask_channels, min_max.data());
+          EXPECT_EQ(bits_expected, bits_result)
+              << "num_pixels = " << num_pixels
+              << ", channels = " << mask_channels;
+        }
+
+        std::vector<uint64_t> bits_expected(num_words + 1, 0);
+        std::vector<uint64_t> bits_result(num_words + 1, 0);
+        std::vector<_Tp> sparse(src);
+        for (std::size_t idx = 0; idx < sparse.size(); idx += 3) {
+          sparse[idx] = static_cast<_Tp>(0);
+        }
+        scalar.pack_bits(
+              sparse.data(), bits_expected.data(), num_pixels, mask_channels);
+        vectorized.pack_bits(
+              sparse.data(), bits_result.data(), num_pixels, mask_channels);
+        EXPECT_EQ(bits_expected, bits_result)
+            << "num_pixels = " << num_pixels
+            << ", channels = " << mask_channels;
+      }
+
+      // Color space conversions in both directions (for the inverse
+      // conversions, the random values are interpreted as HSV/Lab).
+      for (bool is_bgr : {false, true}) {
+        for (auto member : {&simd::ConversionKernels<_Tp>::rgbx2hsv,
+                            &simd::ConversionKernels<_Tp>::hsv2rgbx,
+                            &simd::ConversionKernels<_Tp>::rgbx2lab,
+                            &simd::ConversionKernels<_Tp>::lab2rgbx}) {
+          std::fill(expected.begin(), expected.end(), static_cast<_Tp>(0));
+          std::fill(result.begin(), result.end(), static_cast<_Tp>(0));
+          (scalar.*member)(
+                src.data(), expected.data(), num_pixels, channels, is_bgr);
+          (vectorized.*member)(
+                src.data(), result.data(), num_pixels, channels, is_bgr);
+          EXPECT_EQ(expected, result)
+              << "num_pixels = " << num_pixels << ", channels = " << channels
+              << ", bgr = " << is_bgr;
+        }
+      }
+    }
+  }
+}
+
+
+/// Restores the detected instruction set after each test.
+class SIMDKernelsTest : public ::testing::Test {
+protected:
+  void TearDown() override {
+    simd::SetInstructionSet(simd::DetectInstructionSet());
+  }
+};
+
+
+/// Runs the scalar and vectorized type casts on `src` (also from an odd
+/// offset to cover the tail handling) and compares the results bitwise.
+template <typename _Tdst, typename _Tsrc, typename _Scalar, typename _Vectorized>
+void CompareCastKernels(
+    const std::vector<_Tsrc> &src, _Scalar scalar, _Vectorized vectorized) {
+  std::vector<_Tdst> expected(src.size());
+  std::vector<_Tdst> result(src.size());
+  for (std::size_t offset : {0, 3}) {
+    const int64_t num = static_cast<int64_t>(src.size() - offset);
+    scalar(src.data() + offset, expected.data(), num);
+    vectorized(src.data() + offset, result.data(), num);
+    EXPECT_EQ(0, std::memcmp(expected.data(), result.data(), sizeof(_Tdst) * num))
+        << "offset = " << offset;
+  }
+}
+}  // anonymous namespace
+
+
+TEST_F(SIMDKernelsTest, Dispatch) {
+  EXPECT_EQ(simd::ActiveInstructionSet(), simd::DetectInstructionSet());
+
+  EXPECT_EQ(simd::SetInstructionSet(simd::InstructionSet::Scalar),
+            simd::InstructionSet::Scalar);
+  EXPECT_EQ(&simd::Kernels<uint8_t>(), &simd::KernelsScalar<uint8_t>());
+  EXPECT_EQ(&simd::Kernels<float>(), &simd::KernelsScalar<float>());
+
+  EXPECT_EQ(simd::InstructionSetToString(simd::InstructionSet::AVX2), "avx2");
+}
+
+
+TEST_F(SIMDKernelsTest, MatchScalarKernels) {
+  for (auto isa : {simd::InstructionSet::SSE41, simd::InstructionSet::AVX2,
+                   simd::InstructionSet::NEON}) {
+    if (simd::SetInstructionSet(isa) != isa) {
+      continue;
+    }
+    SCOPED_TRACE(simd::InstructionSetToString(isa));
+    CompareKernels<uint8_t>();
+    CompareKernels<float>();
+  }
+}
+
+
+TEST_F(SIMDKernelsTest, HSVRangeAllColors) {
+  // The vectorized HSV & Lab computations must match the scalar ones
+  // for every 8-bit color (including ties & achromatic colors).
+  std::vector<uint8_t> rgb(3 * 256 * 256);
+  std::vector<uint8_t> expected(256 * 256);
+  std::vector<uint8_t> result(256 * 256);
+  const simd::HSVRange ranges[] = {
+    simd::HSVRange{0, 0, 0, 255, 0, 255},
+    simd::HSVRange{25, 95, 40, 160, 30, 200},
+    simd::HSVRange{179, 180, 1, 254, 1, 254}};
+
+  for (auto isa : {simd::InstructionSet::SSE41, simd::InstructionSet::AVX2,
+                   simd::InstructionSet::NEON}) {
+    if (simd::SetInstructionSet(isa) != isa) {
+      continue;
+    }
+    SCOPED_TRACE(simd::InstructionSetToString(isa));
+    const auto &vectorized = simd::Kernels<uint8_t>();
+    const auto &scalar = simd::KernelsScalar<uint8_t>();
+    for (int blue = 0; blue < 256; ++blue) {
+      for (int idx = 0; idx < 256 * 256; ++idx) {
+        rgb[3 * idx] = static_cast<uint8_t>(idx / 256);
+        rgb[3 * idx + 1] = static_cast<uint8_t>(idx % 256);
+        rgb[3 * idx + 2] = static_cast<uint8_t>(blue);
+      }
+      for (const auto &range : ranges) {
+        scalar.mask_hsv_range(
+              rgb.data(), expected.data(), 256 * 256, 3, false, range);
+        vectorized.mask_hsv_range(
+              rgb.data(), result.data(), 256 * 256, 3, false, range);
+        ASSERT_EQ(expected, result) << "blue = " << blue;
+      }
+
+      // The buffer is also used as HSV/Lab input for the inverse conversions
+      for (auto member : {&simd::ConversionKernels<uint8_t>::rgbx2hsv,
+                          &simd::ConversionKernels<uint8_t>::hsv2rgbx,
+                          &simd::ConversionKernels<uint8_t>::rgbx2lab,
+                          &simd::ConversionKernels<uint8_t>::lab2rgbx}) {
+        std::vector<uint8_t> converted_expected(3 * 256 * 256);
+        std::vector<uint8_t> converted_result(3 * 256 * 256);
+        (scalar.*member)(
+              rgb.data(), converted_expected.data(), 256 * 256, 3, false);
+        (vectorized.*member)(
+              rgb.data(), converted_result.data(), 256 * 256, 3, false);
+        ASSERT_EQ(converted_expected, converted_result) << "blue = " << blue;
+      }
+    }
+  }
+}
+
+
+TEST_F(SIMDKernelsTest, ImageBufferDispatch) {
+  // Compares the dispatched conversions on contiguous and
+  // non-contiguous (ROI) buffers against the scalar fallback.
+  viren2d::ImageBuffer rgba(37, 53, 4, viren2d::ImageBufferType::UInt8);
+  const auto values = RandomValues<uint8_t>(37 * 53 * 4);
+  for (int row = 0; row < rgba.Height(); ++row) {
+    for (int col = 0; col < rgba.Width(); ++col) {
+      for (int ch = 0; ch < 4; ++ch) {
+        rgba.AtUnchecked<uint8_t>(row, col, ch) =
+            values[(row * rgba.Width() + col) * 4 + ch];
+      }
+    }
+  }
+  viren2d::ImageBuffer roi = rgba.ROI(3, 5, 29, 17);
+
+  const auto convert = [](const viren2d::ImageBuffer &src) {
+    std::vector<viren2d::ImageBuffer> out;
+    out.push_back(src.ToChannels(3));
+    out.push_back(out.back().ToChannels(4));
+    out.push_back(viren2d::ConvertRGB2Gray(src, 1, false));
+    out.push_back(out.back().ToChannels(4));
+    out.push_back(viren2d::ConvertRGB2Gray(src, 3, true));
+    out.push_back(src.ToFloat());
+    out.push_back(viren2d::ConvertRGB2Gray(out.back(), 4, false));
+    viren2d::ImageBuffer swapped = src.DeepCopy();
+    swapped.SwapChannels(0, 2);
+    out.push_back(swapped);
+    return out;
+  };
+
+  for (const auto &src : {rgba, roi}) {
+    simd::SetInstructionSet(simd::InstructionSet::Scalar);
+    const auto expected = convert(src);
+    simd::SetInstructionSet(simd::DetectInstructionSet());
+    const auto result = convert(src);
+
+    ASSERT_EQ(expected.size(), result.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+      ASSERT_EQ(expected[i].Width(), result[i].Width());
+      ASSERT_EQ(expected[i].Height(), result[i].Height());
+      ASSERT_EQ(expected[i].Channels(), result[i].Channels());
+      ASSERT_EQ(expected[i].BufferType(), result[i].BufferType());
+      for (int row = 0; row < expected[i].Height(); ++row) {
+        EXPECT_EQ(0, std::memcmp(
+                    expected[i].ImmutablePtr<uint8_t>(row, 0, 0),
+                    result[i].ImmutablePtr<uint8_t>(row, 0, 0),
+                    expected[i].Width() * expected[i].PixelStride()))
+            << "Conversion #" << i << ", row " << row;
+      }
+    }
+  }
+}
+
+TEST_F(SIMDKernelsTest, StatisticsDispatch) {
+  // Single-channel images span several statistics blocks, so the row
+  // segments passed to the reduction kernels are split at arbitrary
+  // positions. The ROIs have gaps between the rows.
+  viren2d::ImageBuffer gray(211, 307, 1, viren2d::ImageBufferType::UInt8);
+  const auto values = RandomValues<uint8_t>(211 * 307);
+  for (int row = 0; row < gray.Height(); ++row) {
+    for (int col = 0; col < gray.Width(); ++col) {
+      gray.AtUnchecked<uint8_t>(row, col, 0) = values[row * gray.Width() + col];
+    }
+  }
+  viren2d::ImageBuffer flt = gray.ToFloat();
+  for (int row = 0; row < flt.Height(); row += 7) {
+    flt.AtUnchecked<float>(row, (row * 13) % flt.Width(), 0) =
+        std::numeric_limits<float>::quiet_NaN();
+  }
+  // An entire block without valid values
+  for (int row = 0; row < 60; ++row) {
+    for (int col = 0; col < flt.Width(); ++col) {
+      flt.AtUnchecked<float>(row, col, 0) =
+          std::numeric_limits<float>::quiet_NaN();
+    }
+  }
+
+  for (const auto &src : {gray, gray.ROI(3, 5, 290, 190),
+                          flt, flt.ROI(1, 50, 300, 100)}) {
+    SCOPED_TRACE(src.ToString());
+    simd::SetInstructionSet(simd::InstructionSet::Scalar);
+    const auto expected = src.Statistics(16, 0.0, 256.0);
+    simd::SetInstructionSet(simd::DetectInstructionSet());
+    const auto result = src.Statistics(16, 0.0, 256.0);
+
+    ASSERT_EQ(1, expected.size());
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(expected[0].num_valid, result[0].num_valid);
+    EXPECT_EQ(expected[0].num_nan, result[0].num_nan);
+    EXPECT_EQ(expected[0].min, result[0].min);
+    EXPECT_EQ(expected[0].max, result[0].max);
+    EXPECT_EQ(expected[0].min_location, result[0].min_location);
+    EXPECT_EQ(expected[0].max_location, result[0].max_location);
+    EXPECT_EQ(expected[0].histogram, result[0].histogram);
+    if (src.BufferType() == viren2d::ImageBufferType::UInt8) {
+      EXPECT_EQ(expected[0].mean, result[0].mean);
+      EXPECT_EQ(expected[0].variance, result[0].variance);
+    } else {
+      EXPECT_NEAR(expected[0].mean, result[0].mean, 1e-9);
+      EXPECT_NEAR(expected[0].variance, result[0].variance, 1e-7);
+    }
+  }
+}
+
+
+TEST_F(SIMDKernelsTest, HalfPrecisionMatchScalar) {
+  // All half/bfloat16 bit patterns (including subnormals, infinity & NaN).
+  std::vector<uint16_t> halves(1 << 16);
+  for (std::size_t idx = 0; idx < halves.size(); ++idx) {
+    halves[idx] = static_cast<uint16_t>(idx);
+  }
+
+  // Floats around all rounding ties of both half precision types, *i.e.*
+  // midpoints between neighboring halves (which also covers the overflow
+  // and subnormal boundaries) and +/- 1 ulp.
+  std::vector<uint32_t> float_bits;
+  for (uint32_t idx = 0; idx < (1u << 16); ++idx) {
+    for (uint32_t low : {0x0000u, 0x0001u, 0x7FFFu, 0x8000u, 0x8001u}) {
+      float_bits.push_back((idx << 16) | low);
+    }
+    if ((idx & 0x7C00u) != 0x7C00u) {
+      const float mid = (viren2d::HalfBitsToFloat(static_cast<uint16_t>(idx))
+          + viren2d::HalfBitsToFloat(static_cast<uint16_t>(idx + 1))) / 2.0f;
+      const uint32_t bits = viren2d::FloatToBits(mid);
+      float_bits.push_back(bits - 1);
+      float_bits.push_back(bits);
+      float_bits.push_back(bits + 1);
+    }
+  }
+
+  const int64_t num_halves = static_cast<int64_t>(halves.size());
+  const int64_t num_floats = static_cast<int64_t>(float_bits.size());
+  std::vector<float> expected_float(float_bits.size());
+  std::vector<float> result_float(float_bits.size());
+  std::vector<uint16_t> expected_half(float_bits.size());
+  std::vector<uint16_t> result_half(float_bits.size());
+  std::vector<float> floats(float_bits.size());
+  std::memcpy(floats.data(), float_bits.data(), 4 * float_bits.size());
+
+  const auto &scalar = simd::HalfKernelsScalar();
+  for (auto isa : {simd::InstructionSet::SSE41, simd::InstructionSet::AVX2,
+                   simd::InstructionSet::NEON}) {
+    if (simd::SetInstructionSet(isa) != isa) {
+      continue;
+    }
+    SCOPED_TRACE(simd::InstructionSetToString(isa));
+    const auto &vectorized = simd::HalfKernels();
+
+    const auto *src16 = reinterpret_cast<const viren2d::float16_t *>(halves.data());
+    const auto *srcbf = reinterpret_cast<const viren2d::bfloat16_t *>(halves.data());
+    auto *expected16 = reinterpret_cast<viren2d::float16_t *>(expected_half.data());
+    auto *result16 = reinterpret_cast<viren2d::float16_t *>(result_half.data());
+    auto *expectedbf = reinterpret_cast<viren2d::bfloat16_t *>(expected_half.data());
+    auto *resultbf = reinterpret_cast<viren2d::bfloat16_t *>(result_half.data());
+
+    // Odd lengths exercise the scalar tail handling, too.
+    for (int64_t offset : {0, 3}) {
+      scalar.float16_to_float(src16 + offset, expected_float.data(), num_halves - offset);
+      vectorized.float16_to_float(src16 + offset, result_float.data(), num_halves - offset);
+      EXPECT_EQ(0, std::memcmp(expected_float.data(), result_float.data(),
+                               4 * (num_halves - offset)));
+
+      scalar.bfloat16_to_float(srcbf + offset, expected_float.data(), num_halves - offset);
+      vectorized.bfloat16_to_float(srcbf + offset, result_float.data(), num_halves - offset);
+      EXPECT_EQ(0, std::memcmp(expected_float.data(), result_float.data(),
+                               4 * (num_halves - offset)));
+
+      scalar.float_to_float16(floats.data() + offset, expected16, num_floats - offset);
+      vectorized.float_to_float16(floats.data() + offset, result16, num_floats - offset);
+      for (int64_t idx = 0; idx < num_floats - offset; ++idx) {
+        ASSERT_EQ(expected_half[idx], result_half[idx])
+            << "float16 of 0x" << std::hex << float_bits[idx + offset];
+      }
+
+      scalar.float_to_bfloat16(floats.data() + offset, expectedbf, num_floats - offset);
+      vectorized.float_to_bfloat16(floats.data() + offset, resultbf, num_floats - offset);
+      for (int64_t idx = 0; idx < num_floats - offset; ++idx) {
+        ASSERT_EQ(expected_half[idx], result_half[idx])
+            << "bfloat16 of 0x" << std::hex << float_bits[idx + offset];
+      }
+    }
+  }
+}
+
+
+TEST_F(SIMDKernelsTest, TypeCastsMatchScalar) {
+  // All 16-bit values, wide & random integers, as well as special
+  // floating point values (NaN, infinity, signed zero, rounding ties)
+  std::vector<uint8_t> uint8s(256);
+  std::vector<int16_t> int16s(1 << 16);
+  std::vector<uint16_t> uint16s(1 << 16);
+  for (int idx = 0; idx < (1 << 16); ++idx) {
+    if (idx < 256) {
+      uint8s[idx] = static_cast<uint8_t>(idx);
+    }
+    int16s[idx] = static_cast<int16_t>(idx - 32768);
+    uint16s[idx] = static_cast<uint16_t>(idx);
+  }
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int32_t> int_dist(
+        std::numeric_limits<int32_t>::lowest(),
+        std::numeric_limits<int32_t>::max());
+  std::uniform_real_distribution<double> real_dist(-2.0, 3.0);
+  std::vector<int32_t> int32s{
+    std::numeric_limits<int32_t>::lowest(), std::numeric_limits<int32_t>::max(),
+    -65536, -256, -1, 0, 1, 254, 255, 256, 65535, 65536, 16777217};
+  std::vector<double> doubles{
+    std::numeric_limits<double>::quiet_NaN(),
+    std::numeric_limits<double>::infinity(),
+    -std::numeric_limits<double>::infinity(),
+    std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(),
+    -0.0, 0.0, 1e-300, -1e-300, 254.5 / 255.0, 1.0, 1.0 + 1e-9, 1e10, -1e10};
+  for (int idx = 0; idx < 2000; ++idx) {
+    int32s.push_back(int_dist(rng));
+    int32s.push_back(int_dist(rng) % 300);
+    doubles.push_back(real_dist(rng));
+    doubles.push_back(static_cast<double>(int_dist(rng) % 300));
+  }
+  std::vector<float> floats(doubles.size());
+  std::transform(doubles.begin(), doubles.end(), floats.begin(),
+                 [](double v) { return static_cast<float>(v); });
+
+  const auto &scalar = simd::CastKernelsScalar();
+  // Sanity checks of the reference implementation
+  uint8_t values[4];
+  const int16_t ints[4] = {-5, 0, 255, 300};
+  scalar.int16_to_uint8(ints, values, 4);
+  EXPECT_EQ(0, values[0]);
+  EXPECT_EQ(0, values[1]);
+  EXPECT_EQ(255, values[2]);
+  EXPECT_EQ(255, values[3]);
+  scalar.float_to_uint8(floats.data(), values, 4, 255.0f);
+  EXPECT_EQ(0, values[0]);
+  EXPECT_EQ(255, values[1]);
+  EXPECT_EQ(0, values[2]);
+  EXPECT_EQ(255, values[3]);
+
+  const float to_float = 1.0f / 255.0f;
+  for (auto isa : {simd::InstructionSet::SSE41, simd::InstructionSet::AVX2,
+                   simd::InstructionSet::NEON}) {
+    if (simd::SetInstructionSet(isa) != isa) {
+      continue;
+    }
+    SCOPED_TRACE(simd::InstructionSetToString(isa));
+    const auto &vectorized = simd::CastKernels();
+
+    CompareCastKernels<uint8_t>(
+          int16s, scalar.int16_to_uint8, vectorized.int16_to_uint8);
+    CompareCastKernels<uint8_t>(
+          uint16s, scalar.uint16_to_uint8, vectorized.uint16_to_uint8);
+    CompareCastKernels<uint8_t>(
+          int32s, scalar.int32_to_uint8, vectorized.int32_to_uint8);
+
+    for (float scale : {1.0f, 255.0f}) {
+      SCOPED_TRACE("scale = " + std::to_string(scale));
+      CompareCastKernels<uint8_t>(
+            floats,
+            [&](const float *src, uint8_t *dst, int64_t num) {
+              scalar.float_to_uint8(src, dst, num, scale); },
+            [&](const float *src, uint8_t *dst, int64_t num) {
+              vectorized.float_to_uint8(src, dst, num, scale); });
+      CompareCastKernels<uint8_t>(
+            doubles,
+            [&](const double *src, uint8_t *dst, int64_t num) {
+              scalar.double_to_uint8(src, dst, num, scale); },
+            [&](const double *src, uint8_t *dst, int64_t num) {
+              vectorized.double_to_uint8(src, dst, num, scale); });
+    }
+
+    for (float scale : {1.0f, to_float}) {
+      SCOPED_TRACE("scale = " + std::to_string(scale));
+      CompareCastKernels<float>(
+            uint8s,
+            [&](const uint8_t *src, float *dst, int64_t num) {
+              scalar.uint8_to_float(src, dst, num, scale); },
+            [&](const uint8_t *src, float *dst, int64_t num) {
+              vectorized.uint8_to_float(src, dst, num, scale); });
+      CompareCastKernels<float>(
+            int16s,
+            [&](const int16_t *src, float *dst, int64_t num) {
+              scalar.int16_to_float(src, dst, num, scale); },
+            [&](const int16_t *src, float *dst, int64_t num) {
+              vectorized.int16_to_float(src, dst, num, scale); });
+      CompareCastKernels<float>(
+            uint16s,
+            [&](const uint16_t *src, float *dst, int64_t num) {
+              scalar.uint16_to_float(src, dst, num, scale); },
+            [&](const uint16_t *src, float *dst, int64_t num) {
+              vectorized.uint16_to_float(src, dst, num, scale); });
+      CompareCastKernels<float>(
+            int32s,
+            [&](const int32_t *src, float *dst, int64_t num) {
+              scalar.int32_to_float(src, dst, num, scale); },
+            [&](const int32_t *src, float *dst, int64_t num) {
+              vectorized.int32_to_float(src, dst, num, scale); });
+      CompareCastKernels<float>(
+            doubles,
+            [&](const double *src, float *dst, int64_t num) {
+              scalar.double_to_float(src, dst, num, scale); },
+            [&](const double *src, float *dst, int64_t num) {
+              vectorized.double_to_float(src, dst, num, scale); });
+    }
+  }
+}
+
+
+TEST_F(SIMDKernelsTest, ReductionsMatchScalar) {
+  // Long enough to flush the 32-bit accumulators of the uint8 squares,
+  // followed by an odd tail.
+  std::vector<uint8_t> uint8s = RandomValues<uint8_t>((1 << 17) + 77);
+  uint8s[3] = 0;
+  uint8s[uint8s.size() - 2] = 255;
+  std::vector<float> floats = RandomValues<float>(1029);
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const float inf = std::numeric_limits<float>::infinity();
+  floats[0] = nan;
+  floats[5] = nan;
+  floats[17] = -0.0f;
+  floats[18] = 0.0f;
+  floats[1028] = nan;
+  std::vector<float> extremes(floats);
+  extremes[40] = -inf;
+  extremes[41] = inf;
+  extremes[42] = -inf;
+  std::vector<float> nans(13, nan);
+  std::vector<float> zeros{0.0f, -0.0f, 0.0f, -0.0f, -0.0f, 0.0f};
+
+  const auto &scalar = simd::ReduceKernelsScalar();
+  simd::RangeStatistics<uint8_t> expected_u8;
+  scalar.uint8_statistics(uint8s.data(), 7, 3.0, &expected_u8);
+  EXPECT_EQ(7, expected_u8.num_valid);
+  EXPECT_EQ(0, expected_u8.num_nan);
+  EXPECT_EQ(0, expected_u8.min_val);
+  EXPECT_EQ(3, expected_u8.min_idx);
+
+  for (auto isa : {simd::InstructionSet::SSE41, simd::InstructionSet::AVX2,
+                   simd::InstructionSet::NEON}) {
+    if (simd::SetInstructionSet(isa) != isa) {
+      continue;
+    }
+    SCOPED_TRACE(simd::InstructionSetToString(isa));
+    const auto &vectorized = simd::ReduceKernels();
+
+    for (std::size_t offset : {0, 1, 5}) {
+      for (std::size_t num : {std::size_t(0), std::size_t(1), std::size_t(15),
+                              std::size_t(33), std::size_t(1000),
+                              uint8s.size() - offset}) {
+        SCOPED_TRACE("uint8, offset = " + std::to_string(offset)
+                     + ", num = " + std::to_string(num));
+        simd::RangeStatistics<uint8_t> expected;
+        simd::RangeStatistics<uint8_t> result;
+        for (double centered : {0.0, 17.0}) {
+          scalar.uint8_statistics(
+                uint8s.data() + offset, num, centered, &expected);
+          vectorized.uint8_statistics(
+                uint8s.data() + offset, num, centered, &result);
+          EXPECT_EQ(expected.num_valid, result.num_valid);
+          EXPECT_EQ(expected.num_nan, result.num_nan);
+          EXPECT_EQ(expected.sum, result.sum);
+          EXPECT_EQ(expected.sum_squares, result.sum_squares);
+          EXPECT_EQ(expected.min_val, result.min_val);
+          EXPECT_EQ(expected.max_val, result.max_val);
+          EXPECT_EQ(expected.min_idx, result.min_idx);
+          EXPECT_EQ(expected.max_idx, result.max_idx);
+        }
+      }
+    }
+
+    for (const auto *values : {&floats, &extremes, &nans, &zeros}) {
+      for (std::size_t offset : {0, 1, 3}) {
+        for (std::size_t num = 0; num + offset <= values->size();
+             num += (num < 20) ? 1 : 97) {
+          SCOPED_TRACE("float, offset = " + std::to_string(offset)
+                       + ", num = " + std::to_string(num));
+          simd::RangeStatistics<float> expected;
+          simd::RangeStatistics<float> result;
+          scalar.float_statistics(values->data() + offset, num, 1.5, &expected);
+          vectorized.float_statistics(
+                values->data() + offset, num, 1.5, &result);
+          EXPECT_EQ(expected.num_valid, result.num_valid);
+          EXPECT_EQ(expected.num_nan, result.num_nan);
+          EXPECT_EQ(expected.min_idx, result.min_idx);
+          EXPECT_EQ(expected.max_idx, result.max_idx);
+          EXPECT_EQ(std::signbit(expected.min_val),
+                    std::signbit(result.min_val));
+          if (expected.num_valid > 0) {
+            EXPECT_EQ(expected.min_val, result.min_val);
+            EXPECT_EQ(expected.max_val, result.max_val);
+          }
+          if (std::isfinite(expected.sum)) {
+            EXPECT_NEAR(expected.sum, result.sum,
+                        1e-12 * std::abs(expected.sum_squares) + 1e-12);
+            EXPECT_NEAR(expected.sum_squares, result.sum_squares,
+                        1e-12 * std::abs(expected.sum_squares) + 1e-12);
+          } else {
+            EXPECT_EQ(std::isnan(expected.sum), std::isnan(result.sum));
+          }
+        }
+      }
+    }
+  }
+}
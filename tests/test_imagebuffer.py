@@ -1,3 +1,4 @@
+import gc
 import pytest
 import numpy as np
 import viren2d
@@ -171,9 +172,9 @@ def test_buffer_side_effects():
 def test_dtypes():
     supported_types = [
         np.uint8, np.int16, np.uint16, np.int32, np.uint32,
-        np.int64, np.uint64, np.float32, np.float64]
+        np.int64, np.uint64, np.float32, np.float64, np.float16]
     not_supported_types = [
-        np.int8, np.float16, '?', bool]
+        np.int8, '?', bool]
 
     for channels in [1, 2, 3]:
         for tp in supported_types:
@@ -318,6 +319,115 @@ def test_pixelation():
     assert np.all(img_np[:, :2, 1] == 42)
     assert np.all(img_np[3:, 2:, 1] == 33)
 
+
+def test_output_buffers():
+    img_np = (255 * np.random.rand(6, 5, 3)).astype(np.uint8)
+    buf = viren2d.ImageBuffer(img_np, copy=True)
+
+    # Destination ImageBuffer will be allocated/reused
+    out = viren2d.ImageBuffer(np.zeros((6, 5, 4), dtype=np.uint8), copy=True)
+    res = buf.to_channels(4, out=out)
+    assert res is out
+    assert out.shape == (6, 5, 4)
+    assert np.array_equal(np.array(out, copy=False), np.array(buf.to_channels(4)))
+
+    res = buf.dim(0.5, out=out)
+    assert res is out
+    assert out.shape == (6, 5, 3)
+
+    # Results are written into a numpy array of matching shape & dtype
+    gray_np = np.zeros((6, 5), dtype=np.uint8)
+    res = viren2d.convert_rgb2gray(buf, out=gray_np)
+    assert res is gray_np
+    expected = np.array(viren2d.convert_rgb2gray(buf), copy=False)
+    assert np.array_equal(gray_np, expected[:, :, 0])
+
+    flt_np = np.zeros((6, 5, 3), dtype=np.float32)
+    buf.to_float32(out=flt_np)
+    assert np.allclose(flt_np, img_np.astype(np.float32) / 255.0)
+
+    hsv_np = np.zeros((6, 5, 3), dtype=np.uint8)
+    viren2d.convert_rgb2hsv(img_np, out=hsv_np)
+    assert np.array_equal(hsv_np, np.array(viren2d.convert_rgb2hsv(img_np)))
+
+    small_np = np.zeros((3, 4, 3), dtype=np.uint8)
+    res = buf.resize(4, 3, out=small_np)
+    assert res is small_np
+    assert np.array_equal(small_np, np.array(buf.resize(4, 3)))
+
+    blended_np = np.zeros((6, 5, 4), dtype=np.uint8)
+    buf.blend_constant(buf.to_channels(4), 0.5, out=blended_np)
+    assert np.array_equal(
+        blended_np, np.array(buf.blend_constant(buf.to_channels(4), 0.5)))
+
+    # In-place operation on the same array
+    viren2d.ImageBuffer(img_np, copy=False).dim(0.0, out=img_np)
+    assert np.all(img_np == 0)
+
+    # A numpy array cannot be reallocated
+    with pytest.raises(ValueError):
+        buf.to_channels(4, out=np.zeros((6, 5, 3), dtype=np.uint8))
+    with pytest.raises(ValueError):
+        buf.channel(0, out=np.zeros((6, 5), dtype=np.float32))
+    with pytest.raises(ValueError):
+        buf.channel(0, out=np.zeros((5, 6), dtype=np.uint8).T)
+    with pytest.raises(ValueError):
+        buf.channel(0, out='invalid')
+    # The shape & dtype are checked before anything is computed
+    with pytest.raises(ValueError):
+        buf.resize(3, 4, out=small_np)
+    with pytest.raises(ValueError):
+        buf.blend_constant(buf, 0.5, out=blended_np)
+
+
+
+def test_inplace():
+    img_np = np.random.randint(0, 256, (30, 40, 3), dtype=np.uint8)
+    other_np = np.random.randint(0, 256, (30, 40, 3), dtype=np.uint8)
+    img = viren2d.ImageBuffer(img_np.copy())
+    other = viren2d.ImageBuffer(other_np)
+
+    expected = np.array(img.dim(0.4))
+    view_np = img_np.copy()
+    view = viren2d.ImageBuffer(view_np, copy=False)
+    view.dim_inplace(0.4)
+    assert np.array_equal(view_np, expected)
+
+    expected = np.array(img.blend_constant(other, 0.3))
+    view_np = img_np.copy()
+    view = viren2d.ImageBuffer(view_np, copy=False)
+    view.blend_constant_inplace(other, 0.3)
+    assert np.array_equal(view_np, expected)
+
+    mask = np.random.rand(30, 40).astype(np.float32)
+    expected = np.array(img.blend_mask(other, mask))
+    view_np = img_np.copy()
+    view = viren2d.ImageBuffer(view_np, copy=False)
+    view.blend_mask_inplace(other, mask)
+    assert np.array_equal(view_np, expected)
+
+    # Number of channels cannot change
+    with pytest.raises(ValueError):
+        view.blend_constant_inplace(other.to_channels(4), 0.5)
+
+
+def test_num_threads():
+    default_threads = viren2d.get_num_threads()
+    assert default_threads >= 1
+
+    img = np.random.randint(0, 256, (300, 400, 3), dtype=np.uint8)
+    viren2d.set_num_threads(1)
+    assert viren2d.get_num_threads() == 1
+    serial = np.array(viren2d.convert_rgb2gray(img))
+
+    viren2d.set_num_threads(4)
+    assert viren2d.get_num_threads() == 4
+    assert np.array_equal(serial, np.array(viren2d.convert_rgb2gray(img)))
+
+    viren2d.set_num_threads(0)
+    assert viren2d.get_num_threads() == default_threads
+
+
 #FIXME test color conversions:
 # convert_gray2rgb
 # convert_rgb2gray
@@ -330,3 +440,485 @@ def test_pixelation():
 #TODO test: blend_constant
 #TODO test: blend_masked
 #TODO test: dim (incl. clipping)
+
+
+def test_lazy_expression():
+    img_np = np.random.randint(0, 256, (30, 40, 3), dtype=np.uint8)
+    overlay_np = np.random.rand(30, 40, 3).astype(np.float32)
+    img = viren2d.ImageBuffer(img_np)
+
+    expr = img.lazy().normalize(0, 1 / 255, 0).blend_constant(
+        overlay_np, 0.25).scale(255).clamp(0, 200)
+    assert expr.num_operations == 4
+    assert expr.channels == 3
+    result = expr.evaluate(np.float64)
+    assert result.dtype == np.float64
+
+    expected = np.clip(
+        255 * (0.75 * img_np.astype(np.float64) / 255 + 0.25 * overlay_np),
+        0, 200)
+    assert np.allclose(np.array(result), expected)
+
+    # Results are saturated
+    result = img.lazy().scale(-1).evaluate(np.uint8)
+    assert np.all(np.array(result) == 0)
+
+    # Evaluate into a numpy array
+    out = np.zeros((30, 40, 3), dtype=np.uint8)
+    expr.evaluate(np.uint8, out=out)
+    assert np.all(np.abs(out.astype(np.int32) - expected.astype(np.int32)) <= 1)
+
+    # Per-channel parameters must match
+    with pytest.raises(ValueError):
+        img.lazy().normalize([1, 2], 1, 0)
+
+
+def test_statistics():
+    data = np.random.rand(40, 30, 2).astype(np.float32)
+    data[3, 4, 1] = np.nan
+    img = viren2d.ImageBuffer(data)
+
+    stats = img.statistics(num_bins=5, histogram_min=0, histogram_max=1)
+    assert len(stats) == 2
+    for ch in range(2):
+        values = data[:, :, ch]
+        assert stats[ch].min == pytest.approx(np.nanmin(values))
+        assert stats[ch].max == pytest.approx(np.nanmax(values))
+        assert stats[ch].mean == pytest.approx(np.nanmean(values), rel=1e-6)
+        assert stats[ch].std == pytest.approx(np.nanstd(values), rel=1e-5)
+        row, col = np.unravel_index(np.nanargmin(values), values.shape)
+        assert stats[ch].min_location.x == col
+        assert stats[ch].min_location.y == row
+        hist, _ = np.histogram(values[~np.isnan(values)], bins=5, range=(0, 1))
+        assert stats[ch].histogram == hist.tolist()
+    assert stats[0].num_nan == 0
+    assert stats[1].num_nan == 1
+    assert stats[1].num_valid == 40 * 30 - 1
+
+
+def test_resize():
+    data = np.random.randint(0, 256, (40, 60, 3), dtype=np.uint8)
+    img = viren2d.ImageBuffer(data)
+
+    for mode in ['nearest', 'bilinear', viren2d.Interpolation.Area]:
+        res = img.resize(30, 20, mode)
+        assert res.width == 30
+        assert res.height == 20
+        assert res.channels == 3
+        assert res.dtype == np.uint8
+
+    # Area downscaling by an integral factor averages the blocks
+    res = np.array(img.to_float32().resize(30, 20, 'area'))
+    expected = data.astype(np.float32).reshape(20, 2, 30, 2, 3).mean(axis=(1, 3)) / 255
+    assert np.allclose(res, expected, atol=1e-5)
+
+    # Nearest neighbor upscaling replicates the pixels
+    res = np.array(img.resize(120, 80, 'nearest'))
+    assert np.array_equal(res, np.repeat(np.repeat(data, 2, axis=0), 2, axis=1))
+
+    with pytest.raises(ValueError):
+        img.resize(0, 10)
+
+
+def test_views():
+    data = np.random.randint(0, 256, (20, 30, 4), dtype=np.uint8)
+    img = viren2d.ImageBuffer(data)
+
+    # Channel views are zero-copy & read-only
+    alpha = img.channel_view(3)
+    assert alpha.read_only
+    assert not alpha.owns_data
+    assert alpha.shape == (20, 30, 1)
+    assert alpha.pixel_stride == 4
+    assert np.array_equal(np.array(alpha)[:, :, 0], data[:, :, 3])
+    with pytest.raises(ValueError):
+        np.array(alpha, copy=False)[0, 0, 0] = 0
+    with pytest.raises(RuntimeError):
+        alpha.dim_inplace(0.5)
+
+    bgr = img.channel_view(2, 3, -1)
+    assert bgr.channel_stride == -1
+    assert np.array_equal(np.array(bgr), data[:, :, 2::-1])
+    assert np.array_equal(np.array(bgr.to_uint8(4)), np.dstack(
+        (data[:, :, 2::-1], np.full((20, 30), 255, dtype=np.uint8))))
+
+    flipped = img.flip_view(horizontal=True, vertical=True)
+    assert np.array_equal(np.array(flipped), data[::-1, ::-1, :])
+
+    roi = img.roi_view(left=5, top=3, width=10, height=7)
+    assert np.array_equal(np.array(roi.copy()), data[3:10, 5:15, :])
+
+    with pytest.raises(IndexError):
+        img.channel_view(4)
+    with pytest.raises(IndexError):
+        img.roi_view(25, 0, 10, 10)
+
+    # Read-only kernels accept views directly
+    stats = img.channel_view(1).statistics()
+    assert stats[0].mean == pytest.approx(np.mean(data[:, :, 1]))
+
+
+def test_memory_mapped(tmp_path):
+    data = np.random.uniform(-5, 5, (30, 40, 2)).astype(np.float32)
+
+    # Raw file with a custom 8 byte header
+    raw_file = tmp_path / 'raster.raw'
+    with open(raw_file, 'wb') as f:
+        f.write(b'RAWIMAGE')
+        f.write(data.tobytes())
+    mapped = viren2d.map_raw(raw_file, 30, 40, 2, np.float32, offset=8)
+    assert mapped.read_only
+    assert mapped.dtype == np.float32
+    assert np.array_equal(np.array(mapped, copy=False), data)
+
+    roi = mapped.roi_view(5, 10, 20, 15)
+    assert np.array_equal(np.array(roi, copy=False), data[10:25, 5:25])
+
+    with pytest.raises(ValueError):
+        viren2d.map_raw(raw_file, 31, 40, 2, np.float32, offset=8)
+    with pytest.raises(ValueError):
+        viren2d.map_raw(raw_file, 30, 40, 2, np.float32, offset=3)
+
+    # NumPy files in C & Fortran order
+    npy_file = tmp_path / 'raster.npy'
+    for arr in [data, np.asfortranarray(data[:, :, 0]), data[:, :, 1:].copy()]:
+        np.save(npy_file, arr)
+        mapped = viren2d.map_npy(npy_file)
+        assert mapped.read_only
+        np.testing.assert_array_equal(
+            np.array(mapped, copy=False).reshape(arr.shape), arr)
+        del mapped
+
+    # Copy-on-write mappings can be modified, but the file stays unchanged
+    np.save(npy_file, data)
+    mapped = viren2d.map_npy(npy_file, copy_on_write=True)
+    assert not mapped.read_only
+    np.array(mapped, copy=False)[3, 4, 1] = 42.0
+    assert np.array(mapped, copy=False)[3, 4, 1] == pytest.approx(42.0)
+    assert np.load(npy_file)[3, 4, 1] == data[3, 4, 1]
+
+    np.save(npy_file, data.astype(np.complex64))
+    with pytest.raises(ValueError):
+        viren2d.map_npy(npy_file)
+
+
+@pytest.mark.parametrize('dtype', [
+    np.uint8, np.int16, np.uint16, np.int32, np.uint32,
+    np.int64, np.uint64, np.float32, np.float64, np.float16])
+def test_npy_io(tmp_path, dtype):
+    data = np.random.randint(0, 100, (12, 9, 3)).astype(dtype)
+    img = viren2d.ImageBuffer(data)
+    filename = tmp_path / 'buffer.npy'
+
+    viren2d.save_npy(filename, img)
+    assert np.array_equal(np.load(filename), data)
+    loaded = viren2d.load_npy(filename)
+    assert loaded.dtype == dtype
+    assert np.array_equal(np.array(loaded, copy=False), data)
+
+    # Views are written without a contiguous copy
+    viren2d.save_npy(filename, img.channel_view(1))
+    assert np.array_equal(np.load(filename), data[:, :, 1])
+    viren2d.save_npy(filename, img.flip_view(True, False))
+    assert np.array_equal(np.load(filename), data[:, ::-1, :])
+
+    # Fortran-order arrays saved by numpy
+    np.save(filename, np.asfortranarray(data[:, :, 2]))
+    loaded = viren2d.load_npy(filename)
+    assert np.array_equal(
+        np.array(loaded, copy=False).reshape(12, 9), data[:, :, 2])
+
+
+@pytest.mark.parametrize('dtype', [np.uint8, np.int32, np.float32, np.float64])
+def test_blur(dtype):
+    data = np.random.randint(0, 200, (60, 80, 3)).astype(dtype)
+    img = viren2d.ImageBuffer(data.copy())
+
+    # Box blur of a center region
+    img.blur([viren2d.Rect(40, 30, 20, 10)], radius=2, kind='box')
+    blurred = np.array(img, copy=False)
+    padded = data[18:42, 28:52].astype(np.float64)
+    expected = np.zeros((20, 20, 3))
+    for dy in range(-2, 3):
+        for dx in range(-2, 3):
+            expected += padded[2 + dy:22 + dy, 2 + dx:22 + dx]
+    expected /= 25
+    np.testing.assert_allclose(
+        blurred[25:35, 30:50], expected[5:15, 10:30], atol=0.51)
+
+    # Pixels outside of the regions are not modified
+    mask = np.ones(data.shape[:2], dtype=bool)
+    mask[25:35, 30:50] = False
+    assert np.array_equal(blurred[mask], data[mask])
+
+    # Many regions (given as tuples) with Gaussian blur
+    img = viren2d.ImageBuffer(data.copy())
+    img.blur(
+        [(x, y, 10, 10) for x in range(5, 80, 15) for y in range(5, 60, 15)],
+        radius=6, kind=viren2d.BlurKind.Gaussian)
+    blurred = np.array(img, copy=False)
+    assert not np.array_equal(blurred[:10, :10], data[:10, :10])
+    assert np.array_equal(blurred[11:14, 11:14], data[11:14, 11:14])
+
+    with pytest.raises(ValueError):
+        img.blur([(10, 10, 5, 5)], radius=0)
+
+
+def test_color_pop():
+    data = np.random.randint(0, 256, (31, 47, 4)).astype(np.uint8)
+    hue_range = (40, 200)
+    sat_range = (0.3, 1.0)
+    val_range = (0.1, 0.9)
+    for channels in [3, 4]:
+        img = data[:, :, :channels].copy()
+        for is_bgr in [False, True]:
+            hsv = np.array(viren2d.convert_rgb2hsv(img, is_bgr=is_bgr), copy=False)
+            within = (hsv[:, :, 0] >= 20) & (hsv[:, :, 0] <= 100) \
+                & (hsv[:, :, 1] >= 76) & (hsv[:, :, 2] >= 25) \
+                & (hsv[:, :, 2] <= 229)
+
+            mask = viren2d.mask_color_range(
+                img, hue_range, sat_range, val_range, is_bgr=is_bgr)
+            assert np.array_equal(
+                np.array(mask, copy=False)[:, :, 0], within * 255)
+
+            pop = np.array(viren2d.color_pop(
+                img, hue_range, sat_range, val_range, is_bgr=is_bgr), copy=False)
+            gray = np.array(
+                viren2d.convert_rgb2gray(img, is_bgr=is_bgr), copy=False)
+            assert pop.shape == img.shape
+            assert np.array_equal(pop[within], img[within])
+            for ch in range(3):
+                assert np.array_equal(pop[~within][:, ch], gray[~within][:, 0])
+            if channels == 4:
+                assert np.array_equal(pop[:, :, 3], img[:, :, 3])
+
+    with pytest.raises(ValueError):
+        viren2d.color_pop(data[:, :, :2].copy(), hue_range)
+
+
+def test_lab_conversion():
+    data = np.random.randint(0, 256, (23, 41, 4)).astype(np.uint8)
+    data[0, 0, :3] = 0
+    data[0, 1, :3] = 255
+    for channels in [3, 4]:
+        img = data[:, :, :channels].copy()
+        img_float = img.astype(np.float32) / 255.0
+        for is_bgr in [False, True]:
+            lab = np.array(viren2d.convert_rgb2lab(img, is_bgr=is_bgr), copy=False)
+            lab_float = np.array(
+                viren2d.convert_rgb2lab(img_float, is_bgr=is_bgr), copy=False)
+            assert lab.dtype == np.uint8
+            assert lab_float.dtype == np.float32
+            assert lab.shape == (23, 41, 3)
+            assert lab_float.shape == (23, 41, 3)
+            # Black & white
+            assert lab_float[0, 0] == pytest.approx([0, 0, 0], abs=1e-3)
+            assert lab_float[0, 1] == pytest.approx([100, 0, 0], abs=1e-3)
+            # uint8 encoding
+            expected = np.stack([
+                lab_float[:, :, 0] * 255 / 100,
+                lab_float[:, :, 1] + 128,
+                lab_float[:, :, 2] + 128], axis=-1)
+            assert np.all(np.abs(lab.astype(np.float32) - expected) <= 1)
+
+            # Round trip
+            restored = np.array(viren2d.convert_lab2rgb(
+                lab_float, output_channels=channels, output_bgr=is_bgr),
+                copy=False)
+            assert restored.shape == img.shape
+            assert restored[:, :, :3] == pytest.approx(
+                img_float[:, :, :3], abs=1e-3)
+            if channels == 4:
+                assert np.all(restored[:, :, 3] == 1)
+
+            # Reuse output buffer
+            out = np.zeros((23, 41, 3), dtype=np.uint8)
+            viren2d.convert_rgb2lab(img, is_bgr=is_bgr, out=out)
+            assert np.array_equal(out, lab)
+
+    with pytest.raises(ValueError):
+        viren2d.convert_rgb2lab(data[:, :, :2].copy())
+    with pytest.raises(ValueError):
+        viren2d.convert_rgb2lab(data.astype(np.int16))
+    with pytest.raises(ValueError):
+        viren2d.convert_lab2rgb(data)
+
+
+def test_packed_mask():
+    data = np.random.randint(0, 256, (29, 75, 3)).astype(np.uint8)
+    hue_range = (40, 200)
+    sat_range = (0.3, 1.0)
+    mask = viren2d.mask_color_range(data, hue_range, sat_range)
+    packed = viren2d.mask_color_range_packed(data, hue_range, sat_range)
+    assert packed.width == 75
+    assert packed.height == 29
+    assert packed.nbytes == 29 * 16
+    within = np.array(mask, copy=False)[:, :, 0] > 0
+    assert packed.count_nonzero() == np.count_nonzero(within)
+    assert np.array_equal(
+        np.array(packed.to_image(), copy=False)[:, :, 0], within * 255)
+    assert packed == viren2d.PackedMask(mask)
+    assert packed != packed.inverted()
+    assert packed.inverted().count_nonzero() == 29 * 75 - np.count_nonzero(within)
+    assert viren2d.PackedMask(3, 5, True).count_nonzero() == 15
+
+    overlay = np.full((29, 75, 3), 200, dtype=np.uint8)
+    blended = np.array(
+        viren2d.ImageBuffer(data).blend_packed_mask(overlay, packed), copy=False)
+    assert np.array_equal(blended[within], overlay[within])
+    assert np.array_equal(blended[~within], data[~within])
+
+    with pytest.raises(ValueError):
+        viren2d.PackedMask(data)
+    with pytest.raises(RuntimeError):
+        viren2d.ImageBuffer(data).blend_packed_mask(
+            overlay, viren2d.PackedMask(3, 3))
+
+
+def test_alpha_composite():
+    data = np.random.randint(0, 256, (31, 17, 3)).astype(np.uint8)
+    overlay = np.random.randint(0, 256, (31, 17, 4)).astype(np.uint8)
+    overlay[:, 0, 3] = 0
+    overlay[:, 1, 3] = 255
+    img = viren2d.ImageBuffer(data)
+    res = np.array(img.alpha_composite(overlay), copy=False)
+    assert res.shape == data.shape
+    # Fixed-point "over" compositing
+    weight = overlay[:, :, 3:].astype(np.int32)
+    weight += weight >> 7
+    expected = (data.astype(np.int32) * (256 - weight)
+                + overlay[:, :, :3].astype(np.int32) * weight + 128) >> 8
+    assert np.array_equal(res, expected.astype(np.uint8))
+    assert np.array_equal(res[:, 0], data[:, 0])
+    assert np.array_equal(res[:, 1], overlay[:, 1, :3])
+
+    img.alpha_composite_inplace(overlay)
+    assert np.array_equal(np.array(img, copy=False), res)
+
+    with pytest.raises(ValueError):
+        img.alpha_composite(data)
+    with pytest.raises(RuntimeError):
+        img.alpha_composite(overlay[:10])
+
+
+def test_half_precision():
+    data = (np.random.rand(21, 13, 2).astype(np.float32) - 0.5) * 40
+    data16 = data.astype(np.float16)
+    img = viren2d.ImageBuffer(data16, copy=False)
+    assert img.dtype == np.float16
+    assert img.itemsize == 2
+    # Buffer protocol shares the memory
+    assert np.array_equal(np.array(img, copy=False), data16)
+    data16[3, 4, 1] = 7
+    assert np.array(img, copy=False)[3, 4, 1] == 7
+
+    # Conversions are exact (and round-to-nearest-even, same as numpy)
+    assert np.array_equal(
+        np.array(img.to_float32(), copy=False), data16.astype(np.float32))
+    res = viren2d.ImageBuffer(data).to_float32()
+    half = res.lazy().evaluate(dtype=np.float16)
+    assert half.dtype == np.float16
+    assert np.array_equal(np.array(half, copy=False), data16)
+
+    vmin, vmax, _, _ = img.min_max(channel=1)
+    assert vmin == data16[:, :, 1].min()
+    assert vmax == data16[:, :, 1].max()
+
+    # Non-contiguous inputs are copied
+    view = viren2d.ImageBuffer(data16[::2, ::-1])
+    assert np.array_equal(np.array(view, copy=False), data16[::2, ::-1])
+
+    # Visualization
+    vis = viren2d.colorize_optical_flow(img, 'optical-flow', 20)
+    expected = viren2d.colorize_optical_flow(
+        data16.astype(np.float32), 'optical-flow', 20)
+    assert np.array_equal(
+        np.array(vis, copy=False), np.array(expected, copy=False))
+    vis = viren2d.colorize_scaled(data16[:, :, 0], low=-20, high=20)
+    expected = viren2d.colorize_scaled(
+        data16[:, :, 0].astype(np.float32), low=-20, high=20)
+    assert np.array_equal(
+        np.array(vis, copy=False), np.array(expected, copy=False))
+
+    # Arithmetic operations need to be performed in single precision
+    with pytest.raises(ValueError):
+        img.dim(0.5)
+
+
+def test_planar_and_batch():
+    assert viren2d.ImageLayout('chw') == viren2d.ImageLayout.Planar
+    assert viren2d.ImageLayout('nhwc') == viren2d.ImageLayout.Interleaved
+    with pytest.raises(ValueError):
+        viren2d.ImageLayout('hcw')
+
+    # Planar arrays are shared without transposing them
+    chw = np.random.rand(3, 20, 30).astype(np.float32)
+    img = viren2d.ImageBuffer(chw, layout='chw')
+    assert not img.owns_data
+    assert img.layout == viren2d.ImageLayout.Planar
+    assert img.shape == (20, 30, 3)
+    assert np.array_equal(np.array(img, copy=False), chw.transpose(1, 2, 0))
+    chw[1, 2, 3] = 5
+    assert np.array(img, copy=False)[2, 3, 1] == 5
+
+    # Copies are interleaved
+    img = viren2d.ImageBuffer(chw, layout='chw', copy=True)
+    assert img.owns_data
+    assert img.layout == viren2d.ImageLayout.Interleaved
+    assert np.array_equal(np.array(img, copy=False), chw.transpose(1, 2, 0))
+
+    # Batches of planar images, e.g. network outputs
+    nchw = np.random.rand(4, 2, 20, 30).astype(np.float32)
+    batch = viren2d.ImageBatch(nchw, layout='nchw')
+    assert len(batch) == 4
+    assert not batch.owns_data
+    assert batch.layout == viren2d.ImageLayout.Planar
+    assert (batch.height, batch.width, batch.channels) == (20, 30, 2)
+    assert batch.dtype == np.float32
+    assert np.array_equal(np.array(batch, copy=False),
+                          nchw.transpose(0, 2, 3, 1))
+    for idx, frame in enumerate(batch):
+        assert np.array_equal(np.array(frame, copy=False),
+                              nchw[idx].transpose(1, 2, 0))
+    assert np.array_equal(np.array(batch[-1], copy=False),
+                          nchw[3].transpose(1, 2, 0))
+    with pytest.raises(IndexError):
+        batch[4]
+
+    # Frames reference the batch memory
+    frame = batch[1]
+    np.array(frame, copy=False)[0, 0, 0] = -3
+    assert nchw[1, 0, 0, 0] == -3
+
+    vis = viren2d.colorize_scaled(batch[2].channel_view(0), low=0, high=1)
+    expected = viren2d.colorize_scaled(
+        np.ascontiguousarray(nchw[2, 0]), low=0, high=1)
+    assert np.array_equal(np.array(vis, copy=False),
+                          np.array(expected, copy=False))
+
+    # Non-contiguous batches are copied
+    nhw = np.arange(60, dtype=np.uint8).reshape(3, 5, 4)[:, :, ::-1]
+    batch = viren2d.ImageBatch(nhw)
+    assert batch.owns_data
+    assert batch.channels == 1
+    assert np.array_equal(np.array(batch, copy=False)[:, :, :, 0], nhw)
+
+
+def test_shared_lifetime():
+    # Shared buffers keep the array alive
+    data = np.arange(60, dtype=np.float32).reshape(4, 5, 3)
+    expected = data.copy()
+    buf = viren2d.ImageBuffer(data, copy=False)
+    assert not buf.owns_data
+    del data
+    gc.collect()
+    assert np.array_equal(np.array(buf, copy=False), expected)
+
+    # Including planar arrays and views onto the buffer
+    chw = np.ascontiguousarray(expected.transpose(2, 0, 1))
+    planar = viren2d.ImageBuffer(chw, layout='chw')
+    roi = planar.roi(1, 1, 2, 2)
+    del chw, planar
+    gc.collect()
+    assert np.array_equal(np.array(roi, copy=False), expected[1:3, 1:3])